@@ -92,6 +92,29 @@
  */
 #define THING_NAME_LENGTH                           ( ( uint16_t ) ( sizeof( democonfigTHING_NAME ) - 1 ) )
 
+/**
+ * @brief Topics and response types of the report format in use.
+ */
+#if ( democonfigUSE_CBOR_REPORTS == 1 )
+    #define DEFENDER_PUBLISH_TOPIC                  DEFENDER_API_CBOR_PUBLISH( democonfigTHING_NAME )
+    #define DEFENDER_PUBLISH_TOPIC_LENGTH           DEFENDER_API_LENGTH_CBOR_PUBLISH( THING_NAME_LENGTH )
+    #define DEFENDER_ACCEPTED_TOPIC                 DEFENDER_API_CBOR_ACCEPTED( democonfigTHING_NAME )
+    #define DEFENDER_ACCEPTED_TOPIC_LENGTH          DEFENDER_API_LENGTH_CBOR_ACCEPTED( THING_NAME_LENGTH )
+    #define DEFENDER_REJECTED_TOPIC                 DEFENDER_API_CBOR_REJECTED( democonfigTHING_NAME )
+    #define DEFENDER_REJECTED_TOPIC_LENGTH          DEFENDER_API_LENGTH_CBOR_REJECTED( THING_NAME_LENGTH )
+    #define DEFENDER_REPORT_ACCEPTED_API            DefenderCborReportAccepted
+    #define DEFENDER_REPORT_REJECTED_API            DefenderCborReportRejected
+#else
+    #define DEFENDER_PUBLISH_TOPIC                  DEFENDER_API_JSON_PUBLISH( democonfigTHING_NAME )
+    #define DEFENDER_PUBLISH_TOPIC_LENGTH           DEFENDER_API_LENGTH_JSON_PUBLISH( THING_NAME_LENGTH )
+    #define DEFENDER_ACCEPTED_TOPIC                 DEFENDER_API_JSON_ACCEPTED( democonfigTHING_NAME )
+    #define DEFENDER_ACCEPTED_TOPIC_LENGTH          DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH )
+    #define DEFENDER_REJECTED_TOPIC                 DEFENDER_API_JSON_REJECTED( democonfigTHING_NAME )
+    #define DEFENDER_REJECTED_TOPIC_LENGTH          DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH )
+    #define DEFENDER_REPORT_ACCEPTED_API            DefenderJsonReportAccepted
+    #define DEFENDER_REPORT_REJECTED_API            DefenderJsonReportRejected
+#endif
+
 /**
  * @brief Number of seconds to wait for the response from AWS IoT Device
  * Defender service.
@@ -209,8 +232,30 @@ static ReportStatus_t xReportStatus;
 
 /**
  * @brief Buffer for generating the Device Defender report.
+ *
+ * This is the payload handed to coreMQTT, which writes it to the network
+ * after the PUBLISH header without copying it.
  */
-static char pcDeviceMetricsJsonReport[ democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE ];
+static char pcDeviceMetricsReport[ democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE ];
+
+#if ( democonfigUSE_CBOR_REPORTS == 1 )
+
+/**
+ * @brief The lists sent in the last report accepted by the service. Lists
+ * that are still the same are left out of the next CBOR report.
+ */
+    static uint16_t pusReportedTcpPorts[ democonfigOPEN_TCP_PORTS_ARRAY_SIZE ];
+    static size_t uxNumReportedTcpPorts = 0UL;
+    static uint16_t pusReportedUdpPorts[ democonfigOPEN_UDP_PORTS_ARRAY_SIZE ];
+    static size_t uxNumReportedUdpPorts = 0UL;
+    static Connection_t pxReportedConnections[ democonfigESTABLISHED_CONNECTIONS_ARRAY_SIZE ];
+    static size_t uxNumReportedConnections = 0UL;
+
+/**
+ * @brief Whether the lists above hold an accepted report yet.
+ */
+    static bool xMetricsReported = false;
+#endif /* democonfigUSE_CBOR_REPORTS == 1 */
 
 /**
  * @brief Report ID sent in the defender report.
@@ -240,6 +285,51 @@ static void prvPublishCallback( MQTTContext_t * pxMqttContext,
  */
 static bool prvCollectDeviceMetrics( void );
 
+#if ( democonfigUSE_CBOR_REPORTS == 1 )
+
+/**
+ * @brief Sort an array of ports, so that it can be compared with the one
+ * previously reported whatever order the sockets were listed in.
+ *
+ * @param[in,out] pusPorts The ports.
+ * @param[in] xNumPorts The number of ports.
+ */
+    static void prvSortPorts( uint16_t * pusPorts,
+                              size_t xNumPorts );
+
+/**
+ * @brief Sort an array of connections by every field of Connection_t, so
+ * that two scans of the same connections give arrays equal under memcmp().
+ *
+ * @param[in,out] pxConnections The connections.
+ * @param[in] xNumConnections The number of connections.
+ */
+    static void prvSortConnections( Connection_t * pxConnections,
+                                    size_t xNumConnections );
+
+/**
+ * @brief Order two connections by local address, then remote address.
+ *
+ * @param[in] pxFirst The first connection.
+ * @param[in] pxSecond The second connection.
+ *
+ * @return true if pxFirst sorts before pxSecond or is equal to it.
+ */
+    static bool prvConnectionNotAfter( const Connection_t * pxFirst,
+                                       const Connection_t * pxSecond );
+
+/**
+ * @brief Mark which lists in xDeviceMetrics differ from the last accepted
+ * report.
+ */
+    static void prvMarkChangedMetrics( void );
+
+/**
+ * @brief Remember the lists of xDeviceMetrics as accepted by the service.
+ */
+    static void prvRecordReportedMetrics( void );
+#endif /* democonfigUSE_CBOR_REPORTS == 1 */
+
 /**
  * @brief Generate the Device Defender report.
  *
@@ -293,54 +383,27 @@ static bool prvValidateDefenderResponse( const char * pcDefenderResponse,
 
 /*-----------------------------------------------------------*/
 
-static bool prvValidateDefenderResponse( const char * pcDefenderResponse,
-                                         size_t xDefenderResponseLength )
-{
-    bool xStatus = false;
-    JSONStatus_t eJsonResult = JSONSuccess;
-    char * ucReportIdString = NULL;
-    size_t xReportIdStringLength;
-    uint32_t ulReportIdInResponse;
-
-    configASSERT( pcDefenderResponse != NULL );
+#if ( democonfigUSE_CBOR_REPORTS == 1 )
 
-    /* Is the response a valid JSON? */
-    eJsonResult = JSON_Validate( pcDefenderResponse, xDefenderResponseLength );
-
-    if( eJsonResult != JSONSuccess )
+    static bool prvValidateDefenderResponse( const char * pcDefenderResponse,
+                                             size_t xDefenderResponseLength )
     {
-        LogError( ( "Invalid response from AWS IoT Device Defender Service: %.*s.",
-                    ( int ) xDefenderResponseLength,
-                    pcDefenderResponse ) );
-    }
+        bool xStatus = false;
+        uint32_t ulReportIdInResponse = 0UL;
 
-    if( eJsonResult == JSONSuccess )
-    {
-        /* Search the ReportId key in the response. */
-        eJsonResult = JSON_Search( ( char * ) pcDefenderResponse,
-                                   xDefenderResponseLength,
-                                   DEFENDER_RESPONSE_REPORT_ID_FIELD,
-                                   DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH,
-                                   &( ucReportIdString ),
-                                   &( xReportIdStringLength ) );
+        configASSERT( pcDefenderResponse != NULL );
 
-        if( eJsonResult != JSONSuccess )
+        /* Search the ReportId key in the response. */
+        if( eGetCborResponseReportId( ( const uint8_t * ) pcDefenderResponse,
+                                      xDefenderResponseLength,
+                                      &( ulReportIdInResponse ) ) != eReportBuilderSuccess )
         {
-            LogError( ( "%s key not found in the response from the"
-                        "AWS IoT Device Defender Service: %.*s.",
-                        DEFENDER_RESPONSE_REPORT_ID_FIELD,
-                        ( int ) xDefenderResponseLength,
-                        pcDefenderResponse ) );
+            LogError( ( "Invalid CBOR response of %u bytes from AWS IoT Device Defender Service.",
+                        ( unsigned int ) xDefenderResponseLength ) );
         }
-    }
-
-    if( eJsonResult == JSONSuccess )
-    {
-        ulReportIdInResponse = ( uint32_t ) strtoul( ucReportIdString, NULL, 10 );
-
         /* Is the report ID present in the response same as was sent in the
          * published report? */
-        if( ulReportIdInResponse == ulReportId )
+        else if( ulReportIdInResponse == ulReportId )
         {
             LogInfo( ( "A valid response with report ID %u received from the "
                        "AWS IoT Device Defender Service.", ulReportId ) );
@@ -349,18 +412,87 @@ static bool prvValidateDefenderResponse( const char * pcDefenderResponse,
         else
         {
             LogError( ( "Unexpected %s found in the response from the AWS"
-                        "IoT Device Defender Service. Expected: %u, Found: %u, "
-                        "Complete Response: %.*s.",
+                        "IoT Device Defender Service. Expected: %u, Found: %u.",
                         DEFENDER_RESPONSE_REPORT_ID_FIELD,
                         ulReportId,
-                        ulReportIdInResponse,
+                        ulReportIdInResponse ) );
+        }
+
+        return xStatus;
+    }
+
+#else /* democonfigUSE_CBOR_REPORTS == 1 */
+
+    static bool prvValidateDefenderResponse( const char * pcDefenderResponse,
+                                             size_t xDefenderResponseLength )
+    {
+        bool xStatus = false;
+        JSONStatus_t eJsonResult = JSONSuccess;
+        char * ucReportIdString = NULL;
+        size_t xReportIdStringLength;
+        uint32_t ulReportIdInResponse;
+
+        configASSERT( pcDefenderResponse != NULL );
+
+        /* Is the response a valid JSON? */
+        eJsonResult = JSON_Validate( pcDefenderResponse, xDefenderResponseLength );
+
+        if( eJsonResult != JSONSuccess )
+        {
+            LogError( ( "Invalid response from AWS IoT Device Defender Service: %.*s.",
                         ( int ) xDefenderResponseLength,
                         pcDefenderResponse ) );
         }
+
+        if( eJsonResult == JSONSuccess )
+        {
+            /* Search the ReportId key in the response. */
+            eJsonResult = JSON_Search( ( char * ) pcDefenderResponse,
+                                       xDefenderResponseLength,
+                                       DEFENDER_RESPONSE_REPORT_ID_FIELD,
+                                       DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH,
+                                       &( ucReportIdString ),
+                                       &( xReportIdStringLength ) );
+
+            if( eJsonResult != JSONSuccess )
+            {
+                LogError( ( "%s key not found in the response from the"
+                            "AWS IoT Device Defender Service: %.*s.",
+                            DEFENDER_RESPONSE_REPORT_ID_FIELD,
+                            ( int ) xDefenderResponseLength,
+                            pcDefenderResponse ) );
+            }
+        }
+
+        if( eJsonResult == JSONSuccess )
+        {
+            ulReportIdInResponse = ( uint32_t ) strtoul( ucReportIdString, NULL, 10 );
+
+            /* Is the report ID present in the response same as was sent in the
+             * published report? */
+            if( ulReportIdInResponse == ulReportId )
+            {
+                LogInfo( ( "A valid response with report ID %u received from the "
+                           "AWS IoT Device Defender Service.", ulReportId ) );
+                xStatus = true;
+            }
+            else
+            {
+                LogError( ( "Unexpected %s found in the response from the AWS"
+                            "IoT Device Defender Service. Expected: %u, Found: %u, "
+                            "Complete Response: %.*s.",
+                            DEFENDER_RESPONSE_REPORT_ID_FIELD,
+                            ulReportId,
+                            ulReportIdInResponse,
+                            ( int ) xDefenderResponseLength,
+                            pcDefenderResponse ) );
+            }
+        }
+
+        return xStatus;
     }
 
-    return xStatus;
-}
+#endif /* democonfigUSE_CBOR_REPORTS == 1 */
 /*-----------------------------------------------------------*/
 
 static void prvPublishCallback( MQTTContext_t * pxMqttContext,
@@ -399,7 +531,7 @@ static void prvPublishCallback( MQTTContext_t * pxMqttContext,
 
         if( xStatus == DefenderSuccess )
         {
-            if( xApi == DefenderJsonReportAccepted )
+            if( xApi == DEFENDER_REPORT_ACCEPTED_API )
             {
                 /* Check if the response is valid and is for the report we
                  * published. If so, report was accepted. */
@@ -408,13 +540,18 @@ static void prvPublishCallback( MQTTContext_t * pxMqttContext,
 
                 if( xValidationResult == true )
                 {
-                    LogInfo( ( "The defender report was accepted by the service. Response: %.*s.",
-                               ( int ) pxPublishInfo->payloadLength,
-                               ( const char * ) pxPublishInfo->pPayload ) );
+                    #if ( democonfigUSE_CBOR_REPORTS == 1 )
+                        LogInfo( ( "The defender report was accepted by the service. Response of %u bytes.",
+                                   ( unsigned int ) pxPublishInfo->payloadLength ) );
+                    #else
+                        LogInfo( ( "The defender report was accepted by the service. Response: %.*s.",
+                                   ( int ) pxPublishInfo->payloadLength,
+                                   ( const char * ) pxPublishInfo->pPayload ) );
+                    #endif
                     xReportStatus = ReportStatusAccepted;
                 }
             }
-            else if( xApi == DefenderJsonReportRejected )
+            else if( xApi == DEFENDER_REPORT_REJECTED_API )
             {
                 /* Check if the response is valid and is for the report we
                  * published. If so, report was rejected. */
@@ -423,9 +560,14 @@ static void prvPublishCallback( MQTTContext_t * pxMqttContext,
 
                 if( xValidationResult == true )
                 {
-                    LogError( ( "The defender report was rejected by the service. Response: %.*s.",
-                                ( int ) pxPublishInfo->payloadLength,
-                                ( const char * ) pxPublishInfo->pPayload ) );
+                    #if ( democonfigUSE_CBOR_REPORTS == 1 )
+                        LogError( ( "The defender report was rejected by the service. Response of %u bytes.",
+                                    ( unsigned int ) pxPublishInfo->payloadLength ) );
+                    #else
+                        LogError( ( "The defender report was rejected by the service. Response: %.*s.",
+                                    ( int ) pxPublishInfo->payloadLength,
+                                    ( const char * ) pxPublishInfo->pPayload ) );
+                    #endif
                     xReportStatus = ReportStatusRejected;
                 }
             }
@@ -462,57 +604,25 @@ static bool prvCollectDeviceMetrics( void )
     TaskStatus_t pxTaskStatus = { 0 };
     TaskStatus_t * pxTaskStatusArray = NULL;
 
-    /* Collect bytes and packets sent and received. */
-    eStatus = eGetNetworkStats( &( xNetworkStats ) );
+    /* Collect bytes and packets sent and received, open TCP and UDP ports
+     * and established connections from one snapshot. */
+    eStatus = eGetAllMetrics( &( xNetworkStats ),
+                              &( pusOpenTcpPorts[ 0 ] ),
+                              democonfigOPEN_TCP_PORTS_ARRAY_SIZE,
+                              &( uxNumOpenTcpPorts ),
+                              &( pusOpenUdpPorts[ 0 ] ),
+                              democonfigOPEN_UDP_PORTS_ARRAY_SIZE,
+                              &( uxNumOpenUdpPorts ),
+                              &( pxEstablishedConnections[ 0 ] ),
+                              democonfigESTABLISHED_CONNECTIONS_ARRAY_SIZE,
+                              &( uxNumEstablishedConnections ) );
 
     if( eStatus != eMetricsCollectorSuccess )
     {
-        LogError( ( "xGetNetworkStats failed. Status: %d.",
+        LogError( ( "eGetAllMetrics failed. Status: %d.",
                     eStatus ) );
     }
 
-    /* Collect a list of open TCP ports. */
-    if( eStatus == eMetricsCollectorSuccess )
-    {
-        eStatus = eGetOpenTcpPorts( &( pusOpenTcpPorts[ 0 ] ),
-                                    democonfigOPEN_TCP_PORTS_ARRAY_SIZE,
-                                    &( uxNumOpenTcpPorts ) );
-
-        if( eStatus != eMetricsCollectorSuccess )
-        {
-            LogError( ( "xGetOpenTcpPorts failed. Status: %d.",
-                        eStatus ) );
-        }
-    }
-
-    /* Collect a list of open UDP ports. */
-    if( eStatus == eMetricsCollectorSuccess )
-    {
-        eStatus = eGetOpenUdpPorts( &( pusOpenUdpPorts[ 0 ] ),
-                                    democonfigOPEN_UDP_PORTS_ARRAY_SIZE,
-                                    &( uxNumOpenUdpPorts ) );
-
-        if( eStatus != eMetricsCollectorSuccess )
-        {
-            LogError( ( "xGetOpenUdpPorts failed. Status: %d.",
-                        eStatus ) );
-        }
-    }
-
-    /* Collect a list of established connections. */
-    if( eStatus == eMetricsCollectorSuccess )
-    {
-        eStatus = eGetEstablishedConnections( &( pxEstablishedConnections[ 0 ] ),
-                                              democonfigESTABLISHED_CONNECTIONS_ARRAY_SIZE,
-                                              &( uxNumEstablishedConnections ) );
-
-        if( eStatus != eMetricsCollectorSuccess )
-        {
-            LogError( ( "GetEstablishedConnections failed. Status: %d.",
-                        eStatus ) );
-        }
-    }
-
     if( eStatus == eMetricsCollectorSuccess )
     {
         /* Get task count */
@@ -575,6 +685,13 @@ static bool prvCollectDeviceMetrics( void )
         xDeviceMetrics.ulStackHighWaterMark = pxTaskStatus.usStackHighWaterMark;
         xDeviceMetrics.pxTaskStatusArray = pxTaskStatusArray;
         xDeviceMetrics.xTaskStatusArrayLength = uxTasksWritten;
+        xDeviceMetrics.xTcpPortsChanged = true;
+        xDeviceMetrics.xUdpPortsChanged = true;
+        xDeviceMetrics.xConnectionsChanged = true;
+
+        #if ( democonfigUSE_CBOR_REPORTS == 1 )
+            prvMarkChangedMetrics();
+        #endif
     }
     else
     {
@@ -590,6 +707,139 @@ static bool prvCollectDeviceMetrics( void )
 }
 /*-----------------------------------------------------------*/
 
+#if ( democonfigUSE_CBOR_REPORTS == 1 )
+
+    static void prvSortPorts( uint16_t * pusPorts,
+                              size_t xNumPorts )
+    {
+        size_t uxIdx;
+        size_t uxInsert;
+        uint16_t usPort;
+
+        /* Insertion sort, as the arrays hold a handful of ports. */
+        for( uxIdx = 1U; uxIdx < xNumPorts; uxIdx++ )
+        {
+            usPort = pusPorts[ uxIdx ];
+
+            for( uxInsert = uxIdx; ( uxInsert > 0U ) && ( pusPorts[ uxInsert - 1U ] > usPort ); uxInsert-- )
+            {
+                pusPorts[ uxInsert ] = pusPorts[ uxInsert - 1U ];
+            }
+
+            pusPorts[ uxInsert ] = usPort;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvSortConnections( Connection_t * pxConnections,
+                                    size_t xNumConnections )
+    {
+        size_t uxIdx;
+        size_t uxInsert;
+        Connection_t xConnection;
+        const Connection_t * pxPrevious;
+
+        for( uxIdx = 1U; uxIdx < xNumConnections; uxIdx++ )
+        {
+            xConnection = pxConnections[ uxIdx ];
+
+            for( uxInsert = uxIdx; uxInsert > 0U; uxInsert-- )
+            {
+                pxPrevious = &( pxConnections[ uxInsert - 1U ] );
+
+                if( prvConnectionNotAfter( pxPrevious, &xConnection ) == true )
+                {
+                    break;
+                }
+
+                pxConnections[ uxInsert ] = *pxPrevious;
+            }
+
+            pxConnections[ uxInsert ] = xConnection;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static bool prvConnectionNotAfter( const Connection_t * pxFirst,
+                                       const Connection_t * pxSecond )
+    {
+        bool xNotAfter;
+
+        if( pxFirst->ulLocalIp != pxSecond->ulLocalIp )
+        {
+            xNotAfter = ( pxFirst->ulLocalIp < pxSecond->ulLocalIp );
+        }
+        else if( pxFirst->usLocalPort != pxSecond->usLocalPort )
+        {
+            xNotAfter = ( pxFirst->usLocalPort < pxSecond->usLocalPort );
+        }
+        else if( pxFirst->ulRemoteIp != pxSecond->ulRemoteIp )
+        {
+            xNotAfter = ( pxFirst->ulRemoteIp < pxSecond->ulRemoteIp );
+        }
+        else
+        {
+            xNotAfter = ( pxFirst->usRemotePort <= pxSecond->usRemotePort );
+        }
+
+        return xNotAfter;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvMarkChangedMetrics( void )
+    {
+        prvSortPorts( xDeviceMetrics.pusOpenTcpPortsArray, xDeviceMetrics.xOpenTcpPortsArrayLength );
+        prvSortPorts( xDeviceMetrics.pusOpenUdpPortsArray, xDeviceMetrics.xOpenUdpPortsArrayLength );
+        prvSortConnections( xDeviceMetrics.pxEstablishedConnectionsArray, xDeviceMetrics.xEstablishedConnectionsArrayLength );
+
+        /* The first report carries every list. Connection_t has no padding, so
+         * the arrays can be compared with memcmp(). */
+        if( xMetricsReported == true )
+        {
+            xDeviceMetrics.xTcpPortsChanged =
+                ( xDeviceMetrics.xOpenTcpPortsArrayLength != uxNumReportedTcpPorts ) ||
+                ( memcmp( xDeviceMetrics.pusOpenTcpPortsArray,
+                          pusReportedTcpPorts,
+                          uxNumReportedTcpPorts * sizeof( uint16_t ) ) != 0 );
+            xDeviceMetrics.xUdpPortsChanged =
+                ( xDeviceMetrics.xOpenUdpPortsArrayLength != uxNumReportedUdpPorts ) ||
+                ( memcmp( xDeviceMetrics.pusOpenUdpPortsArray,
+                          pusReportedUdpPorts,
+                          uxNumReportedUdpPorts * sizeof( uint16_t ) ) != 0 );
+            xDeviceMetrics.xConnectionsChanged =
+                ( xDeviceMetrics.xEstablishedConnectionsArrayLength != uxNumReportedConnections ) ||
+                ( memcmp( xDeviceMetrics.pxEstablishedConnectionsArray,
+                          pxReportedConnections,
+                          uxNumReportedConnections * sizeof( Connection_t ) ) != 0 );
+        }
+
+        LogDebug( ( "Lists changed since the last report: TCP ports %d, UDP ports %d, connections %d.",
+                    xDeviceMetrics.xTcpPortsChanged,
+                    xDeviceMetrics.xUdpPortsChanged,
+                    xDeviceMetrics.xConnectionsChanged ) );
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvRecordReportedMetrics( void )
+    {
+        uxNumReportedTcpPorts = xDeviceMetrics.xOpenTcpPortsArrayLength;
+        memcpy( pusReportedTcpPorts,
+                xDeviceMetrics.pusOpenTcpPortsArray,
+                uxNumReportedTcpPorts * sizeof( uint16_t ) );
+        uxNumReportedUdpPorts = xDeviceMetrics.xOpenUdpPortsArrayLength;
+        memcpy( pusReportedUdpPorts,
+                xDeviceMetrics.pusOpenUdpPortsArray,
+                uxNumReportedUdpPorts * sizeof( uint16_t ) );
+        uxNumReportedConnections = xDeviceMetrics.xEstablishedConnectionsArrayLength;
+        memcpy( pxReportedConnections,
+                xDeviceMetrics.pxEstablishedConnectionsArray,
+                uxNumReportedConnections * sizeof( Connection_t ) );
+        xMetricsReported = true;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* democonfigUSE_CBOR_REPORTS == 1 */
+
 static bool prvGenerateDeviceMetricsReport( size_t * pxOutReportLength )
 {
     bool xStatus = false;
@@ -597,24 +847,39 @@ static bool prvGenerateDeviceMetricsReport( size_t * pxOutReportLength )
 
     /* Generate the metrics report in the format expected by the AWS IoT Device
      * Defender Service. */
-    eReportBuilderStatus = eGenerateJsonReport( &( pcDeviceMetricsJsonReport[ 0 ] ),
-                                                democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE,
-                                                &( xDeviceMetrics ),
-                                                democonfigDEVICE_METRICS_REPORT_MAJOR_VERSION,
-                                                democonfigDEVICE_METRICS_REPORT_MINOR_VERSION,
-                                                ulReportId,
-                                                pxOutReportLength );
+    #if ( democonfigUSE_CBOR_REPORTS == 1 )
+        eReportBuilderStatus = eGenerateCborReport( ( uint8_t * ) &( pcDeviceMetricsReport[ 0 ] ),
+                                                    democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE,
+                                                    &( xDeviceMetrics ),
+                                                    democonfigDEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                    democonfigDEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                    ulReportId,
+                                                    pxOutReportLength );
+    #else
+        eReportBuilderStatus = eGenerateJsonReport( &( pcDeviceMetricsReport[ 0 ] ),
+                                                    democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE,
+                                                    &( xDeviceMetrics ),
+                                                    democonfigDEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                    democonfigDEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                    ulReportId,
+                                                    pxOutReportLength );
+    #endif
 
     if( eReportBuilderStatus != eReportBuilderSuccess )
     {
-        LogError( ( "GenerateJsonReport failed. Status: %d.",
+        LogError( ( "Generating the report failed. Status: %d.",
                     eReportBuilderStatus ) );
     }
     else
     {
-        LogDebug( ( "Generated Report: %.*s.",
-                    *pxOutReportLength,
-                    &( pcDeviceMetricsJsonReport[ 0 ] ) ) );
+        #if ( democonfigUSE_CBOR_REPORTS == 1 )
+            LogDebug( ( "Generated CBOR report of %u bytes.",
+                        ( unsigned int ) *pxOutReportLength ) );
+        #else
+            LogDebug( ( "Generated Report: %.*s.",
+                        *pxOutReportLength,
+                        &( pcDeviceMetricsReport[ 0 ] ) ) );
+        #endif
         xStatus = true;
     }
 
@@ -628,28 +893,28 @@ static bool prvSubscribeToDefenderTopics( void )
 
     /* Subscribe to defender topic for responses for accepted reports. */
     xStatus = xSubscribeToTopic( &xMqttContext,
-                                 DEFENDER_API_JSON_ACCEPTED( democonfigTHING_NAME ),
-                                 DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ) );
+                                 DEFENDER_ACCEPTED_TOPIC,
+                                 DEFENDER_ACCEPTED_TOPIC_LENGTH );
 
     if( xStatus == false )
     {
         LogError( ( "Failed to subscribe to defender topic: %.*s.",
-                    DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ),
-                    DEFENDER_API_JSON_ACCEPTED( democonfigTHING_NAME ) ) );
+                    DEFENDER_ACCEPTED_TOPIC_LENGTH,
+                    DEFENDER_ACCEPTED_TOPIC ) );
     }
 
     if( xStatus == true )
     {
         /* Subscribe to defender topic for responses for rejected reports. */
         xStatus = xSubscribeToTopic( &xMqttContext,
-                                     DEFENDER_API_JSON_REJECTED( democonfigTHING_NAME ),
-                                     DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ) );
+                                     DEFENDER_REJECTED_TOPIC,
+                                     DEFENDER_REJECTED_TOPIC_LENGTH );
 
         if( xStatus == false )
         {
             LogError( ( "Failed to subscribe to defender topic: %.*s.",
-                        DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ),
-                        DEFENDER_API_JSON_REJECTED( democonfigTHING_NAME ) ) );
+                        DEFENDER_REJECTED_TOPIC_LENGTH,
+                        DEFENDER_REJECTED_TOPIC ) );
         }
     }
 
@@ -663,15 +928,15 @@ static bool prvUnsubscribeFromDefenderTopics( void )
 
     /* Unsubscribe from defender accepted topic. */
     xStatus = xUnsubscribeFromTopic( &xMqttContext,
-                                     DEFENDER_API_JSON_ACCEPTED( democonfigTHING_NAME ),
-                                     DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ) );
+                                     DEFENDER_ACCEPTED_TOPIC,
+                                     DEFENDER_ACCEPTED_TOPIC_LENGTH );
 
     if( xStatus == true )
     {
         /* Unsubscribe from defender rejected topic. */
         xStatus = xUnsubscribeFromTopic( &xMqttContext,
-                                         DEFENDER_API_JSON_REJECTED( democonfigTHING_NAME ),
-                                         DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ) );
+                                         DEFENDER_REJECTED_TOPIC,
+                                         DEFENDER_REJECTED_TOPIC_LENGTH );
     }
 
     return xStatus;
@@ -681,9 +946,9 @@ static bool prvUnsubscribeFromDefenderTopics( void )
 static bool prvPublishDeviceMetricsReport( size_t xReportLength )
 {
     return xPublishToTopic( &xMqttContext,
-                            DEFENDER_API_JSON_PUBLISH( democonfigTHING_NAME ),
-                            DEFENDER_API_LENGTH_JSON_PUBLISH( THING_NAME_LENGTH ),
-                            &( pcDeviceMetricsJsonReport[ 0 ] ),
+                            DEFENDER_PUBLISH_TOPIC,
+                            DEFENDER_PUBLISH_TOPIC_LENGTH,
+                            &( pcDeviceMetricsReport[ 0 ] ),
                             xReportLength );
 }
 /*-----------------------------------------------------------*/
@@ -757,9 +1022,9 @@ void prvDefenderDemoTask( void * pvParameters )
         /******************** Subscribe to Defender topics. *******************/
 
         /* Attempt to subscribe to the AWS IoT Device Defender topics.
-         * Since this demo is using JSON, in prvSubscribeToDefenderTopics() we
-         * subscribe to the topics to which accepted and rejected responses are
-         * received from after publishing a JSON report.
+         * In prvSubscribeToDefenderTopics() we subscribe to the topics to which
+         * accepted and rejected responses are received from after publishing a
+         * report in the format selected by democonfigUSE_CBOR_REPORTS.
          *
          * This demo uses a constant #democonfigTHING_NAME known at compile time
          * therefore we use macros to assemble defender topic strings.
@@ -817,8 +1082,8 @@ void prvDefenderDemoTask( void * pvParameters )
 
         /********************** Generate defender report. *********************/
 
-        /* The data needs to be incorporated into a JSON formatted report,
-         * which follows the format expected by the Device Defender service.
+        /* The data needs to be incorporated into a JSON or CBOR formatted
+         * report, which follows the format expected by the Device Defender service.
          * This format is documented here:
          * https://docs.aws.amazon.com/iot/latest/developerguide/detect-device-side-metrics.html
          */
@@ -883,6 +1148,15 @@ void prvDefenderDemoTask( void * pvParameters )
             xStatus = false;
         }
 
+        #if ( democonfigUSE_CBOR_REPORTS == 1 )
+            if( xReportStatus == ReportStatusAccepted )
+            {
+                /* Only lists the service has accepted are left out of later
+                 * reports. */
+                prvRecordReportedMetrics();
+            }
+        #endif
+
         /**************************** Disconnect. *****************************/
 
         /* Unsubscribe and disconnect if MQTT session was established. Per the MQTT
@@ -275,6 +275,16 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigDEVICE_METRICS_REPORT_BUFFER_SIZE      1000
 
+/**
+ * @brief Set to 1 to send the device defender report in CBOR instead of JSON.
+ *
+ * A CBOR report is encoded straight into the buffer that is published, and
+ * numbers take a few bytes instead of up to ten characters. It also leaves out
+ * the port and connection lists that are the same as in the last report the
+ * service accepted; the service only evaluates the metrics a report carries.
+ */
+#define democonfigUSE_CBOR_REPORTS                       0
+
 /**
  * @brief Major version number of the device defender report.
  */
@@ -50,20 +50,162 @@
 #include "metrics_collector.h"
 /*-----------------------------------------------------------*/
 
-eMetricsCollectorStatus eGetNetworkStats( NetworkStats_t * pxOutNetworkStats )
+/**
+ * @brief Copy the network stats out of a tcp_netstat snapshot.
+ *
+ * @param[in] pxMetrics The snapshot.
+ * @param[out] pxOutNetworkStats The network stats.
+ */
+static void prvCopyNetworkStats( const MetricsType_t * pxMetrics,
+                                 NetworkStats_t * pxOutNetworkStats );
+
+/**
+ * @brief Copy a list of open ports out of a tcp_netstat snapshot.
+ *
+ * @param[in] pusPortList The ports of the snapshot.
+ * @param[in] uxPortCount The number of entries in pusPortList.
+ * @param[out] pusOutPortsArray The array to write the ports into. Can be
+ * NULL, if only the number of open ports is needed.
+ * @param[in] xPortsArrayLength Length of pusOutPortsArray.
+ * @param[out] pxOutNumOpenPorts Number of open ports if @p pusOutPortsArray
+ * is NULL, else number of ports written.
+ */
+static void prvCopyPorts( const uint16_t * pusPortList,
+                          size_t uxPortCount,
+                          uint16_t * pusOutPortsArray,
+                          size_t xPortsArrayLength,
+                          size_t * pxOutNumOpenPorts );
+
+/**
+ * @brief Copy the established connections out of a tcp_netstat snapshot.
+ *
+ * @param[in] pxMetrics The snapshot.
+ * @param[out] pxOutConnectionsArray The array to write the connections into.
+ * Can be NULL, if only the number of established connections is needed.
+ * @param[in] xConnectionsArrayLength Length of pxOutConnectionsArray.
+ * @param[out] pxOutNumEstablishedConnections Number of established
+ * connections if @p pxOutConnectionsArray is NULL, else number written.
+ */
+static void prvCopyConnections( const MetricsType_t * pxMetrics,
+                                Connection_t * pxOutConnectionsArray,
+                                size_t xConnectionsArrayLength,
+                                size_t * pxOutNumEstablishedConnections );
+
+/**
+ * @brief Take a snapshot with the FreeRTOS+TCP tcp_netstat utility.
+ *
+ * @param[out] pxMetrics The snapshot.
+ *
+ * @return #eMetricsCollectorSuccess or #eMetricsCollectorCollectionFailed.
+ */
+static eMetricsCollectorStatus prvGetMetrics( MetricsType_t * pxMetrics );
+/*-----------------------------------------------------------*/
+
+static void prvCopyNetworkStats( const MetricsType_t * pxMetrics,
+                                 NetworkStats_t * pxOutNetworkStats )
 {
-    eMetricsCollectorStatus eStatus = eMetricsCollectorSuccess;
+    LogDebug( ( "Network stats read. Bytes received: %lu, packets received: %lu, "
+                "bytes sent: %lu, packets sent: %lu.",
+                ( unsigned long ) pxMetrics->xInput.uxByteCount,
+                ( unsigned long ) pxMetrics->xInput.uxPacketCount,
+                ( unsigned long ) pxMetrics->xOutput.uxByteCount,
+                ( unsigned long ) pxMetrics->xOutput.uxPacketCount ) );
+
+    pxOutNetworkStats->uxBytesReceived = pxMetrics->xInput.uxByteCount;
+    pxOutNetworkStats->uxPacketsReceived = pxMetrics->xInput.uxPacketCount;
+    pxOutNetworkStats->uxBytesSent = pxMetrics->xOutput.uxByteCount;
+    pxOutNetworkStats->uxPacketsSent = pxMetrics->xOutput.uxPacketCount;
+}
+/*-----------------------------------------------------------*/
 
-    MetricsType_t xMetrics = { 0 };
-    BaseType_t xMetricsStatus = 0;
+static void prvCopyPorts( const uint16_t * pusPortList,
+                          size_t uxPortCount,
+                          uint16_t * pusOutPortsArray,
+                          size_t xPortsArrayLength,
+                          size_t * pxOutNumOpenPorts )
+{
+    size_t xCopyAmount = 0UL;
 
-    configASSERT( pxOutNetworkStats != NULL );
+    /* Fill the output array with as many ports as will fit in the given
+     * array. */
+    if( pusOutPortsArray != NULL )
+    {
+        xCopyAmount = uxPortCount;
 
-    /* Start with everything as zero. */
-    memset( pxOutNetworkStats, 0, sizeof( NetworkStats_t ) );
+        /* Limit the copied ports to what can fit in the output array. */
+        if( xPortsArrayLength < uxPortCount )
+        {
+            LogWarn( ( "Ports returned truncated due to insufficient buffer size." ) );
+            xCopyAmount = xPortsArrayLength;
+        }
+
+        memcpy( pusOutPortsArray, pusPortList, xCopyAmount * sizeof( uint16_t ) );
+
+        /* Return the number of elements copied to the array. */
+        *pxOutNumOpenPorts = xCopyAmount;
+    }
+    else
+    {
+        /* Return the total number of open ports. */
+        *pxOutNumOpenPorts = uxPortCount;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyConnections( const MetricsType_t * pxMetrics,
+                                Connection_t * pxOutConnectionsArray,
+                                size_t xConnectionsArrayLength,
+                                size_t * pxOutNumEstablishedConnections )
+{
+    size_t xCopyAmount = 0UL;
+    size_t uxIdx;
+    uint32_t ulLocalIp = 0UL;
+
+    /* Fill the output array with as many TCP socket infos as will fit in
+     * the given array. */
+    if( pxOutConnectionsArray != NULL )
+    {
+        xCopyAmount = pxMetrics->xTCPSocketList.uxCount;
+
+        /* Get local IP as the tcp_netstat utility does not give it. */
+        ulLocalIp = FreeRTOS_GetIPAddress();
+
+        /* Limit the outputted connections to what can fit in the output array. */
+        if( xConnectionsArrayLength < pxMetrics->xTCPSocketList.uxCount )
+        {
+            LogWarn( ( "Ports returned truncated due to insufficient buffer size." ) );
+            xCopyAmount = xConnectionsArrayLength;
+        }
+
+        for( uxIdx = 0; uxIdx < xCopyAmount; uxIdx++ )
+        {
+            pxOutConnectionsArray[ uxIdx ].ulLocalIp = ulLocalIp;
+            pxOutConnectionsArray[ uxIdx ].usLocalPort =
+                pxMetrics->xTCPSocketList.xTCPList[ uxIdx ].usLocalPort;
+            pxOutConnectionsArray[ uxIdx ].ulRemoteIp =
+                pxMetrics->xTCPSocketList.xTCPList[ uxIdx ].ulRemoteIP;
+            pxOutConnectionsArray[ uxIdx ].usRemotePort =
+                pxMetrics->xTCPSocketList.xTCPList[ uxIdx ].usRemotePort;
+        }
+
+        /* Return the number of elements copied to the array. */
+        *pxOutNumEstablishedConnections = xCopyAmount;
+    }
+    else
+    {
+        /* Return the total number of established connections. */
+        *pxOutNumEstablishedConnections = pxMetrics->xTCPSocketList.uxCount;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static eMetricsCollectorStatus prvGetMetrics( MetricsType_t * pxMetrics )
+{
+    eMetricsCollectorStatus eStatus = eMetricsCollectorSuccess;
+    BaseType_t xMetricsStatus = 0;
 
     /* Get metrics from FreeRTOS+TCP tcp_netstat utility. */
-    xMetricsStatus = vGetMetrics( &xMetrics );
+    xMetricsStatus = vGetMetrics( pxMetrics );
 
     if( xMetricsStatus != 0 )
     {
@@ -72,20 +214,26 @@ eMetricsCollectorStatus eGetNetworkStats( NetworkStats_t * pxOutNetworkStats )
         eStatus = eMetricsCollectorCollectionFailed;
     }
 
+    return eStatus;
+}
+/*-----------------------------------------------------------*/
+
+eMetricsCollectorStatus eGetNetworkStats( NetworkStats_t * pxOutNetworkStats )
+{
+    eMetricsCollectorStatus eStatus;
+    MetricsType_t xMetrics = { 0 };
+
+    configASSERT( pxOutNetworkStats != NULL );
+
+    /* Start with everything as zero. */
+    memset( pxOutNetworkStats, 0, sizeof( NetworkStats_t ) );
+
+    eStatus = prvGetMetrics( &xMetrics );
+
     /* Fill our response with values gotten from FreeRTOS+TCP. */
     if( eStatus == eMetricsCollectorSuccess )
     {
-        LogDebug( ( "Network stats read. Bytes received: %lu, packets received: %lu, "
-                    "bytes sent: %lu, packets sent: %lu.",
-                    ( unsigned long ) xMetrics.xInput.uxByteCount,
-                    ( unsigned long ) xMetrics.xInput.uxPacketCount,
-                    ( unsigned long ) xMetrics.xOutput.uxByteCount,
-                    ( unsigned long ) xMetrics.xOutput.uxPacketCount ) );
-
-        pxOutNetworkStats->uxBytesReceived = xMetrics.xInput.uxByteCount;
-        pxOutNetworkStats->uxPacketsReceived = xMetrics.xInput.uxPacketCount;
-        pxOutNetworkStats->uxBytesSent = xMetrics.xOutput.uxByteCount;
-        pxOutNetworkStats->uxPacketsSent = xMetrics.xOutput.uxPacketCount;
+        prvCopyNetworkStats( &xMetrics, pxOutNetworkStats );
     }
 
     return eStatus;
@@ -96,50 +244,21 @@ eMetricsCollectorStatus eGetOpenTcpPorts( uint16_t * pusOutTcpPortsArray,
                                           size_t xTcpPortsArrayLength,
                                           size_t * pxOutNumTcpOpenPorts )
 {
-    eMetricsCollectorStatus eStatus = eMetricsCollectorSuccess;
-
+    eMetricsCollectorStatus eStatus;
     MetricsType_t xMetrics = { 0 };
-    BaseType_t xMetricsStatus = 0;
-    size_t xCopyAmount = 0UL;
 
     /* pusOutTcpPortsArray can be NULL. */
     configASSERT( pxOutNumTcpOpenPorts != NULL );
 
-    /* Get metrics from FreeRTOS+TCP tcp_netstat utility. */
-    xMetricsStatus = vGetMetrics( &xMetrics );
-
-    if( xMetricsStatus != 0 )
-    {
-        LogError( ( "Failed to acquire metrics from FreeRTOS+TCP tcp_netstat utility. Status: %d.",
-                    ( int ) xMetricsStatus ) );
-        eStatus = eMetricsCollectorCollectionFailed;
-    }
+    eStatus = prvGetMetrics( &xMetrics );
 
     if( eStatus == eMetricsCollectorSuccess )
     {
-        /* Fill the output array with as many TCP ports as will fit in the
-         * given array. */
-        if( pusOutTcpPortsArray != NULL )
-        {
-            xCopyAmount = xMetrics.xTCPPortList.uxCount;
-
-            /* Limit the copied ports to what can fit in the output array. */
-            if( xTcpPortsArrayLength < xMetrics.xTCPPortList.uxCount )
-            {
-                LogWarn( ( "Ports returned truncated due to insufficient buffer size." ) );
-                xCopyAmount = xTcpPortsArrayLength;
-            }
-
-            memcpy( pusOutTcpPortsArray, &xMetrics.xTCPPortList.usTCPPortList, xCopyAmount * sizeof( uint16_t ) );
-
-            /* Return the number of elements copied to the array. */
-            *pxOutNumTcpOpenPorts = xCopyAmount;
-        }
-        else
-        {
-            /* Return the total number of open ports. */
-            *pxOutNumTcpOpenPorts = xMetrics.xTCPPortList.uxCount;
-        }
+        prvCopyPorts( xMetrics.xTCPPortList.usTCPPortList,
+                      xMetrics.xTCPPortList.uxCount,
+                      pusOutTcpPortsArray,
+                      xTcpPortsArrayLength,
+                      pxOutNumTcpOpenPorts );
     }
 
     return eStatus;
@@ -150,50 +269,21 @@ eMetricsCollectorStatus eGetOpenUdpPorts( uint16_t * pusOutUdpPortsArray,
                                           size_t xUdpPortsArrayLength,
                                           size_t * pxOutNumUdpOpenPorts )
 {
-    eMetricsCollectorStatus eStatus = eMetricsCollectorSuccess;
-
+    eMetricsCollectorStatus eStatus;
     MetricsType_t xMetrics = { 0 };
-    BaseType_t xMetricsStatus = 0;
-    size_t xCopyAmount = 0UL;
 
     /* pusOutUdpPortsArray can be NULL. */
     configASSERT( pxOutNumUdpOpenPorts != NULL );
 
-    /* Get metrics from FreeRTOS+TCP tcp_netstat utility. */
-    xMetricsStatus = vGetMetrics( &xMetrics );
-
-    if( xMetricsStatus != 0 )
-    {
-        LogError( ( "Failed to acquire metrics from FreeRTOS+TCP tcp_netstat utility. Status: %d.",
-                    ( int ) xMetricsStatus ) );
-        eStatus = eMetricsCollectorCollectionFailed;
-    }
+    eStatus = prvGetMetrics( &xMetrics );
 
     if( eStatus == eMetricsCollectorSuccess )
     {
-        /* Fill the output array with as many UDP ports as will fit in the
-         * given array. */
-        if( pusOutUdpPortsArray != NULL )
-        {
-            xCopyAmount = xMetrics.xUDPPortList.uxCount;
-
-            /* Limit the copied ports to what can fit in the output array. */
-            if( xUdpPortsArrayLength < xMetrics.xUDPPortList.uxCount )
-            {
-                LogWarn( ( "Ports returned truncated due to insufficient buffer size." ) );
-                xCopyAmount = xUdpPortsArrayLength;
-            }
-
-            memcpy( pusOutUdpPortsArray, &xMetrics.xUDPPortList.usUDPPortList, xCopyAmount * sizeof( uint16_t ) );
-
-            /* Return the number of elements copied to the array. */
-            *pxOutNumUdpOpenPorts = xCopyAmount;
-        }
-        else
-        {
-            /* Return the total number of open ports. */
-            *pxOutNumUdpOpenPorts = xMetrics.xUDPPortList.uxCount;
-        }
+        prvCopyPorts( xMetrics.xUDPPortList.usUDPPortList,
+                      xMetrics.xUDPPortList.uxCount,
+                      pusOutUdpPortsArray,
+                      xUdpPortsArrayLength,
+                      pxOutNumUdpOpenPorts );
     }
 
     return eStatus;
@@ -205,64 +295,68 @@ eMetricsCollectorStatus eGetEstablishedConnections( Connection_t * pxOutConnecti
                                                     size_t xConnectionsArrayLength,
                                                     size_t * pxOutNumEstablishedConnections )
 {
-    eMetricsCollectorStatus eStatus = eMetricsCollectorSuccess;
-
+    eMetricsCollectorStatus eStatus;
     MetricsType_t xMetrics = { 0 };
-    BaseType_t xMetricsStatus = 0;
-    size_t xCopyAmount = 0UL;
-    size_t uxIdx;
-    uint32_t ulLocalIp = 0UL;
 
     /* pxOutConnectionsArray can be NULL. */
     configASSERT( pxOutNumEstablishedConnections != NULL );
 
-    /* Get metrics from FreeRTOS+TCP tcp_netstat utility. */
-    xMetricsStatus = vGetMetrics( &xMetrics );
+    eStatus = prvGetMetrics( &xMetrics );
 
-    if( xMetricsStatus != 0 )
+    if( eStatus == eMetricsCollectorSuccess )
     {
-        LogError( ( "Failed to acquire metrics from FreeRTOS+TCP tcp_netstat utility. Status: %d.",
-                    ( int ) xMetricsStatus ) );
-        eStatus = eMetricsCollectorCollectionFailed;
+        prvCopyConnections( &xMetrics,
+                            pxOutConnectionsArray,
+                            xConnectionsArrayLength,
+                            pxOutNumEstablishedConnections );
     }
 
+    return eStatus;
+}
+/*-----------------------------------------------------------*/
+
+eMetricsCollectorStatus eGetAllMetrics( NetworkStats_t * pxOutNetworkStats,
+                                        uint16_t * pusOutTcpPortsArray,
+                                        size_t xTcpPortsArrayLength,
+                                        size_t * pxOutNumTcpOpenPorts,
+                                        uint16_t * pusOutUdpPortsArray,
+                                        size_t xUdpPortsArrayLength,
+                                        size_t * pxOutNumUdpOpenPorts,
+                                        Connection_t * pxOutConnectionsArray,
+                                        size_t xConnectionsArrayLength,
+                                        size_t * pxOutNumEstablishedConnections )
+{
+    eMetricsCollectorStatus eStatus;
+    MetricsType_t xMetrics = { 0 };
+
+    configASSERT( pxOutNetworkStats != NULL );
+    configASSERT( pxOutNumTcpOpenPorts != NULL );
+    configASSERT( pxOutNumUdpOpenPorts != NULL );
+    configASSERT( pxOutNumEstablishedConnections != NULL );
+
+    memset( pxOutNetworkStats, 0, sizeof( NetworkStats_t ) );
+
+    /* One snapshot serves every metric, so they are consistent with each
+     * other and the socket lists are only walked once. */
+    eStatus = prvGetMetrics( &xMetrics );
+
     if( eStatus == eMetricsCollectorSuccess )
     {
-        /* Fill the output array with as many TCP socket infos as will fit in
-         * the given array. */
-        if( pxOutConnectionsArray != NULL )
-        {
-            xCopyAmount = xMetrics.xTCPSocketList.uxCount;
-
-            /* Get local IP as the tcp_netstat utility does not give it. */
-            ulLocalIp = FreeRTOS_GetIPAddress();
-
-            /* Limit the outputted connections to what can fit in the output array. */
-            if( xConnectionsArrayLength < xMetrics.xTCPSocketList.uxCount )
-            {
-                LogWarn( ( "Ports returned truncated due to insufficient buffer size." ) );
-                xCopyAmount = xConnectionsArrayLength;
-            }
-
-            for( uxIdx = 0; uxIdx < xCopyAmount; uxIdx++ )
-            {
-                pxOutConnectionsArray[ uxIdx ].ulLocalIp = ulLocalIp;
-                pxOutConnectionsArray[ uxIdx ].usLocalPort =
-                    xMetrics.xTCPSocketList.xTCPList[ uxIdx ].usLocalPort;
-                pxOutConnectionsArray[ uxIdx ].ulRemoteIp =
-                    xMetrics.xTCPSocketList.xTCPList[ uxIdx ].ulRemoteIP;
-                pxOutConnectionsArray[ uxIdx ].usRemotePort =
-                    xMetrics.xTCPSocketList.xTCPList[ uxIdx ].usRemotePort;
-            }
-
-            /* Return the number of elements copied to the array. */
-            *pxOutNumEstablishedConnections = xCopyAmount;
-        }
-        else
-        {
-            /* Return the total number of established connections. */
-            *pxOutNumEstablishedConnections = xMetrics.xTCPSocketList.uxCount;
-        }
+        prvCopyNetworkStats( &xMetrics, pxOutNetworkStats );
+        prvCopyPorts( xMetrics.xTCPPortList.usTCPPortList,
+                      xMetrics.xTCPPortList.uxCount,
+                      pusOutTcpPortsArray,
+                      xTcpPortsArrayLength,
+                      pxOutNumTcpOpenPorts );
+        prvCopyPorts( xMetrics.xUDPPortList.usUDPPortList,
+                      xMetrics.xUDPPortList.uxCount,
+                      pusOutUdpPortsArray,
+                      xUdpPortsArrayLength,
+                      pxOutNumUdpOpenPorts );
+        prvCopyConnections( &xMetrics,
+                            pxOutConnectionsArray,
+                            xConnectionsArrayLength,
+                            pxOutNumEstablishedConnections );
     }
 
     return eStatus;
@@ -146,4 +146,26 @@ eMetricsCollectorStatus eGetEstablishedConnections( Connection_t * pxOutConnecti
                                                     size_t xConnectionsArrayLength,
                                                     size_t * pxOutNumEstablishedConnections );
 
+/**
+ * @brief Get the network stats, open ports and established connections from
+ * a single snapshot.
+ *
+ * Equivalent to calling eGetNetworkStats(), eGetOpenTcpPorts(),
+ * eGetOpenUdpPorts() and eGetEstablishedConnections() in turn, but the
+ * tcp_netstat utility is only run once.
+ *
+ * @return #eMetricsCollectorSuccess if the metrics are successfully obtained;
+ * #eMetricsCollectorCollectionFailed if the collection methods failed.
+ */
+eMetricsCollectorStatus eGetAllMetrics( NetworkStats_t * pxOutNetworkStats,
+                                        uint16_t * pusOutTcpPortsArray,
+                                        size_t xTcpPortsArrayLength,
+                                        size_t * pxOutNumTcpOpenPorts,
+                                        uint16_t * pusOutUdpPortsArray,
+                                        size_t xUdpPortsArrayLength,
+                                        size_t * pxOutNumUdpOpenPorts,
+                                        Connection_t * pxOutConnectionsArray,
+                                        size_t xConnectionsArrayLength,
+                                        size_t * pxOutNumEstablishedConnections );
+
 #endif /* ifndef METRICS_COLLECTOR_H_ */
@@ -39,12 +39,21 @@
 /* Device Defender Client Library. */
 #include "defender.h"
 
+/* TinyCBOR library for CBOR encoding and decoding operations. */
+#include "cbor.h"
+
 /* Interface include. */
 #include "report_builder.h"
 
 /* Helper macro to check if snprintf was successful. */
 #define reportbuilderSNPRINTF_SUCCESS( retVal, bufLen )    ( ( retVal > 0 ) && ( ( uint32_t ) retVal < bufLen ) )
 
+/* Room for the longest text value of a report, "255.255.255.255:65535". */
+#define reportbuilderCBOR_TEXT_BUFFER_LENGTH    ( 22U )
+
+/* Helper macro to encode a key given as a string literal. */
+#define reportbuilderCBOR_ENCODE_KEY( pxEncoder, key )    cbor_encode_text_string( ( pxEncoder ), ( key ), sizeof( key ) - 1U )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -124,6 +133,33 @@ static eReportBuilderStatus prvWriteTaskIdArray( char * pcBuffer,
                                                  const TaskStatus_t * pxTaskStatusArray,
                                                  size_t xTaskStatusArrayLength,
                                                  size_t * pxOutCharsWritten );
+
+/**
+ * @brief Encode a listening ports object, that is the ports array followed by
+ * the total, as a CBOR map.
+ *
+ * @param[in] pxEncoder The encoder of the enclosing map.
+ * @param[in] pusOpenPortsArray The array containing the open ports.
+ * @param[in] xOpenPortsArrayLength Length of the pusOpenPortsArray array.
+ *
+ * @return The tinycbor errors of all the encoder calls, OR-ed together.
+ */
+static CborError prvCborEncodePorts( CborEncoder * pxEncoder,
+                                     const uint16_t * pusOpenPortsArray,
+                                     size_t xOpenPortsArrayLength );
+
+/**
+ * @brief Encode a TCP connections object as a CBOR map.
+ *
+ * @param[in] pxEncoder The encoder of the enclosing map.
+ * @param[in] pxConnectionsArray The array containing the established connections.
+ * @param[in] xConnectionsArrayLength Length of the pxConnectionsArray array.
+ *
+ * @return The tinycbor errors of all the encoder calls, OR-ed together.
+ */
+static CborError prvCborEncodeConnections( CborEncoder * pxEncoder,
+                                           const Connection_t * pxConnectionsArray,
+                                           size_t xConnectionsArrayLength );
 /*-----------------------------------------------------------*/
 
 static eReportBuilderStatus prvWritePortsArray( char * pcBuffer,
@@ -621,3 +657,296 @@ eReportBuilderStatus eGenerateJsonReport( char * pcBuffer,
     return eStatus;
 }
 /*-----------------------------------------------------------*/
+
+static CborError prvCborEncodePorts( CborEncoder * pxEncoder,
+                                     const uint16_t * pusOpenPortsArray,
+                                     size_t xOpenPortsArrayLength )
+{
+    CborEncoder xPortsMap, xPortsArray, xPortMap;
+    CborError xCborRet;
+    size_t uxIdx;
+
+    configASSERT( ( pusOpenPortsArray != NULL ) || ( xOpenPortsArrayLength == 0U ) );
+
+    xCborRet = cbor_encoder_create_map( pxEncoder, &xPortsMap, 2U );
+
+    xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xPortsMap, DEFENDER_REPORT_PORTS_KEY );
+    xCborRet |= cbor_encoder_create_array( &xPortsMap, &xPortsArray, xOpenPortsArrayLength );
+
+    for( uxIdx = 0U; uxIdx < xOpenPortsArrayLength; uxIdx++ )
+    {
+        xCborRet |= cbor_encoder_create_map( &xPortsArray, &xPortMap, 1U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xPortMap, DEFENDER_REPORT_PORT_KEY );
+        xCborRet |= cbor_encode_uint( &xPortMap, pusOpenPortsArray[ uxIdx ] );
+        xCborRet |= cbor_encoder_close_container( &xPortsArray, &xPortMap );
+    }
+
+    xCborRet |= cbor_encoder_close_container( &xPortsMap, &xPortsArray );
+
+    xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xPortsMap, DEFENDER_REPORT_TOTAL_KEY );
+    xCborRet |= cbor_encode_uint( &xPortsMap, xOpenPortsArrayLength );
+
+    xCborRet |= cbor_encoder_close_container( pxEncoder, &xPortsMap );
+
+    return xCborRet;
+}
+/*-----------------------------------------------------------*/
+
+static CborError prvCborEncodeConnections( CborEncoder * pxEncoder,
+                                           const Connection_t * pxConnectionsArray,
+                                           size_t xConnectionsArrayLength )
+{
+    CborEncoder xOuterMap, xConnectionsMap, xConnectionsArray, xConnectionMap;
+    CborError xCborRet;
+    char cRemoteAddress[ reportbuilderCBOR_TEXT_BUFFER_LENGTH ];
+    int32_t lCharactersWritten;
+    size_t uxIdx;
+    const Connection_t * pxConn;
+
+    configASSERT( ( pxConnectionsArray != NULL ) || ( xConnectionsArrayLength == 0U ) );
+
+    xCborRet = cbor_encoder_create_map( pxEncoder, &xOuterMap, 1U );
+    xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xOuterMap, DEFENDER_REPORT_ESTABLISHED_CONNECTIONS_KEY );
+    xCborRet |= cbor_encoder_create_map( &xOuterMap, &xConnectionsMap, 2U );
+
+    xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xConnectionsMap, DEFENDER_REPORT_CONNECTIONS_KEY );
+    xCborRet |= cbor_encoder_create_array( &xConnectionsMap, &xConnectionsArray, xConnectionsArrayLength );
+
+    for( uxIdx = 0U; uxIdx < xConnectionsArrayLength; uxIdx++ )
+    {
+        pxConn = &( pxConnectionsArray[ uxIdx ] );
+        lCharactersWritten = snprintf( cRemoteAddress,
+                                       sizeof( cRemoteAddress ),
+                                       "%u.%u.%u.%u:%u",
+                                       ( unsigned int ) ( pxConn->ulRemoteIp >> 24 ) & 0xFF,
+                                       ( unsigned int ) ( pxConn->ulRemoteIp >> 16 ) & 0xFF,
+                                       ( unsigned int ) ( pxConn->ulRemoteIp >> 8 ) & 0xFF,
+                                       ( unsigned int ) ( pxConn->ulRemoteIp ) & 0xFF,
+                                       ( unsigned int ) pxConn->usRemotePort );
+
+        /* The buffer is sized for the longest address, so this cannot fail. */
+        configASSERT( reportbuilderSNPRINTF_SUCCESS( lCharactersWritten, sizeof( cRemoteAddress ) ) );
+
+        xCborRet |= cbor_encoder_create_map( &xConnectionsArray, &xConnectionMap, 2U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xConnectionMap, DEFENDER_REPORT_LOCAL_PORT_KEY );
+        xCborRet |= cbor_encode_uint( &xConnectionMap, pxConn->usLocalPort );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xConnectionMap, DEFENDER_REPORT_REMOTE_ADDR_KEY );
+        xCborRet |= cbor_encode_text_string( &xConnectionMap, cRemoteAddress, ( size_t ) lCharactersWritten );
+        xCborRet |= cbor_encoder_close_container( &xConnectionsArray, &xConnectionMap );
+    }
+
+    xCborRet |= cbor_encoder_close_container( &xConnectionsMap, &xConnectionsArray );
+
+    xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xConnectionsMap, DEFENDER_REPORT_TOTAL_KEY );
+    xCborRet |= cbor_encode_uint( &xConnectionsMap, xConnectionsArrayLength );
+
+    xCborRet |= cbor_encoder_close_container( &xOuterMap, &xConnectionsMap );
+    xCborRet |= cbor_encoder_close_container( pxEncoder, &xOuterMap );
+
+    return xCborRet;
+}
+/*-----------------------------------------------------------*/
+
+eReportBuilderStatus eGenerateCborReport( uint8_t * pucBuffer,
+                                          size_t xBufferLength,
+                                          const ReportMetrics_t * pxMetrics,
+                                          uint32_t ulMajorReportVersion,
+                                          uint32_t ulMinorReportVersion,
+                                          uint32_t ulReportId,
+                                          size_t * pxOutReportLength )
+{
+    CborEncoder xEncoder, xReportMap, xHeaderMap, xMetricsMap, xNetworkStatsMap;
+    CborEncoder xCustomMetricsMap, xMetricArray, xMetricMap, xNumberListArray;
+    CborError xCborRet;
+    char cVersion[ reportbuilderCBOR_TEXT_BUFFER_LENGTH ];
+    int32_t lCharactersWritten;
+    size_t uxIdx;
+    size_t xMetricsCount = 1U;
+    size_t xReportLength;
+    eReportBuilderStatus eStatus = eReportBuilderSuccess;
+
+    configASSERT( pxMetrics != NULL );
+    configASSERT( pxOutReportLength != NULL );
+
+    if( ( pxMetrics == NULL ) ||
+        ( pxOutReportLength == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pMetrics: %p, pOutReportLength: %p.",
+                    pxMetrics,
+                    pxOutReportLength ) );
+        eStatus = eReportBuilderBadParameter;
+    }
+
+    if( eStatus == eReportBuilderSuccess )
+    {
+        lCharactersWritten = snprintf( cVersion,
+                                       sizeof( cVersion ),
+                                       "%u.%u",
+                                       ( unsigned int ) ulMajorReportVersion,
+                                       ( unsigned int ) ulMinorReportVersion );
+        configASSERT( reportbuilderSNPRINTF_SUCCESS( lCharactersWritten, sizeof( cVersion ) ) );
+
+        /* Network stats are always sent; the lists only when they changed. */
+        xMetricsCount += ( pxMetrics->xTcpPortsChanged == true ) ? 1U : 0U;
+        xMetricsCount += ( pxMetrics->xUdpPortsChanged == true ) ? 1U : 0U;
+        xMetricsCount += ( pxMetrics->xConnectionsChanged == true ) ? 1U : 0U;
+
+        /* With a NULL buffer every call reports CborErrorOutOfMemory, but
+         * tinycbor carries on counting the bytes the report needs. */
+        cbor_encoder_init( &xEncoder, pucBuffer, ( pucBuffer != NULL ) ? xBufferLength : 0U, 0 );
+
+        xCborRet = cbor_encoder_create_map( &xEncoder, &xReportMap, 3U );
+
+        /* Header. */
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xReportMap, DEFENDER_REPORT_HEADER_KEY );
+        xCborRet |= cbor_encoder_create_map( &xReportMap, &xHeaderMap, 2U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xHeaderMap, DEFENDER_REPORT_ID_KEY );
+        xCborRet |= cbor_encode_uint( &xHeaderMap, ulReportId );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xHeaderMap, DEFENDER_REPORT_VERSION_KEY );
+        xCborRet |= cbor_encode_text_string( &xHeaderMap, cVersion, ( size_t ) lCharactersWritten );
+        xCborRet |= cbor_encoder_close_container( &xReportMap, &xHeaderMap );
+
+        /* Metrics. */
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xReportMap, DEFENDER_REPORT_METRICS_KEY );
+        xCborRet |= cbor_encoder_create_map( &xReportMap, &xMetricsMap, xMetricsCount );
+
+        if( pxMetrics->xTcpPortsChanged == true )
+        {
+            xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricsMap, DEFENDER_REPORT_TCP_LISTENING_PORTS_KEY );
+            xCborRet |= prvCborEncodePorts( &xMetricsMap,
+                                            pxMetrics->pusOpenTcpPortsArray,
+                                            pxMetrics->xOpenTcpPortsArrayLength );
+        }
+
+        if( pxMetrics->xUdpPortsChanged == true )
+        {
+            xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricsMap, DEFENDER_REPORT_UDP_LISTENING_PORTS_KEY );
+            xCborRet |= prvCborEncodePorts( &xMetricsMap,
+                                            pxMetrics->pusOpenUdpPortsArray,
+                                            pxMetrics->xOpenUdpPortsArrayLength );
+        }
+
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricsMap, DEFENDER_REPORT_NETWORK_STATS_KEY );
+        xCborRet |= cbor_encoder_create_map( &xMetricsMap, &xNetworkStatsMap, 4U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xNetworkStatsMap, DEFENDER_REPORT_BYTES_IN_KEY );
+        xCborRet |= cbor_encode_uint( &xNetworkStatsMap, pxMetrics->pxNetworkStats->uxBytesReceived );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xNetworkStatsMap, DEFENDER_REPORT_BYTES_OUT_KEY );
+        xCborRet |= cbor_encode_uint( &xNetworkStatsMap, pxMetrics->pxNetworkStats->uxBytesSent );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xNetworkStatsMap, DEFENDER_REPORT_PKTS_IN_KEY );
+        xCborRet |= cbor_encode_uint( &xNetworkStatsMap, pxMetrics->pxNetworkStats->uxPacketsReceived );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xNetworkStatsMap, DEFENDER_REPORT_PKTS_OUT_KEY );
+        xCborRet |= cbor_encode_uint( &xNetworkStatsMap, pxMetrics->pxNetworkStats->uxPacketsSent );
+        xCborRet |= cbor_encoder_close_container( &xMetricsMap, &xNetworkStatsMap );
+
+        if( pxMetrics->xConnectionsChanged == true )
+        {
+            xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricsMap, DEFENDER_REPORT_TCP_CONNECTIONS_KEY );
+            xCborRet |= prvCborEncodeConnections( &xMetricsMap,
+                                                  pxMetrics->pxEstablishedConnectionsArray,
+                                                  pxMetrics->xEstablishedConnectionsArrayLength );
+        }
+
+        xCborRet |= cbor_encoder_close_container( &xReportMap, &xMetricsMap );
+
+        /* Custom metrics. */
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xReportMap, DEFENDER_REPORT_CUSTOM_METRICS_KEY );
+        xCborRet |= cbor_encoder_create_map( &xReportMap, &xCustomMetricsMap, 2U );
+
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xCustomMetricsMap, "stack_high_water_mark" );
+        xCborRet |= cbor_encoder_create_array( &xCustomMetricsMap, &xMetricArray, 1U );
+        xCborRet |= cbor_encoder_create_map( &xMetricArray, &xMetricMap, 1U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricMap, DEFENDER_REPORT_NUMBER_KEY );
+        xCborRet |= cbor_encode_uint( &xMetricMap, pxMetrics->ulStackHighWaterMark );
+        xCborRet |= cbor_encoder_close_container( &xMetricArray, &xMetricMap );
+        xCborRet |= cbor_encoder_close_container( &xCustomMetricsMap, &xMetricArray );
+
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xCustomMetricsMap, "task_numbers" );
+        xCborRet |= cbor_encoder_create_array( &xCustomMetricsMap, &xMetricArray, 1U );
+        xCborRet |= cbor_encoder_create_map( &xMetricArray, &xMetricMap, 1U );
+        xCborRet |= reportbuilderCBOR_ENCODE_KEY( &xMetricMap, DEFENDER_REPORT_NUMBER_LIST_KEY );
+        xCborRet |= cbor_encoder_create_array( &xMetricMap, &xNumberListArray, pxMetrics->xTaskStatusArrayLength );
+
+        for( uxIdx = 0U; uxIdx < pxMetrics->xTaskStatusArrayLength; uxIdx++ )
+        {
+            xCborRet |= cbor_encode_uint( &xNumberListArray, pxMetrics->pxTaskStatusArray[ uxIdx ].xTaskNumber );
+        }
+
+        xCborRet |= cbor_encoder_close_container( &xMetricMap, &xNumberListArray );
+        xCborRet |= cbor_encoder_close_container( &xMetricArray, &xMetricMap );
+        xCborRet |= cbor_encoder_close_container( &xCustomMetricsMap, &xMetricArray );
+        xCborRet |= cbor_encoder_close_container( &xReportMap, &xCustomMetricsMap );
+
+        xCborRet |= cbor_encoder_close_container( &xEncoder, &xReportMap );
+
+        /* Every item of the report is valid CBOR, so running out of buffer is
+         * the only error expected. */
+        configASSERT( ( xCborRet & ~CborErrorOutOfMemory ) == CborNoError );
+
+        if( xCborRet == CborNoError )
+        {
+            *pxOutReportLength = cbor_encoder_get_buffer_size( &xEncoder, pucBuffer );
+        }
+        else
+        {
+            xReportLength = ( ( pucBuffer != NULL ) ? xBufferLength : 0U ) +
+                            cbor_encoder_get_extra_bytes_needed( &xEncoder );
+
+            if( pucBuffer == NULL )
+            {
+                *pxOutReportLength = xReportLength;
+            }
+            else
+            {
+                LogError( ( "CBOR report of %u bytes does not fit in %u bytes.",
+                            ( unsigned int ) xReportLength,
+                            ( unsigned int ) xBufferLength ) );
+                eStatus = eReportBuilderBufferTooSmall;
+            }
+        }
+    }
+
+    return eStatus;
+}
+/*-----------------------------------------------------------*/
+
+eReportBuilderStatus eGetCborResponseReportId( const uint8_t * pucResponse,
+                                               size_t xResponseLength,
+                                               uint32_t * pulOutReportId )
+{
+    CborParser xParser;
+    CborValue xMap, xValue;
+    CborError xCborRet;
+    uint64_t ullReportId = 0U;
+    eReportBuilderStatus eStatus = eReportBuilderMalformedResponse;
+
+    configASSERT( pucResponse != NULL );
+    configASSERT( pulOutReportId != NULL );
+
+    xCborRet = cbor_parser_init( pucResponse, xResponseLength, 0, &xParser, &xMap );
+
+    if( ( xCborRet == CborNoError ) && cbor_value_is_map( &xMap ) )
+    {
+        /* A missing key leaves xValue invalid, which is not an integer. */
+        xCborRet = cbor_value_map_find_value( &xMap, "reportId", &xValue );
+
+        if( ( xCborRet == CborNoError ) && cbor_value_is_unsigned_integer( &xValue ) )
+        {
+            ( void ) cbor_value_get_uint64( &xValue, &ullReportId );
+
+            if( ullReportId <= UINT32_MAX )
+            {
+                *pulOutReportId = ( uint32_t ) ullReportId;
+                eStatus = eReportBuilderSuccess;
+            }
+        }
+    }
+
+    if( xCborRet != CborNoError )
+    {
+        LogError( ( "Failed to parse the CBOR response: %s",
+                    cbor_error_string( xCborRet ) ) );
+    }
+
+    return eStatus;
+}
+/*-----------------------------------------------------------*/
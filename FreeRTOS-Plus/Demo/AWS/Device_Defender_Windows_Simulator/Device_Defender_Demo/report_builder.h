@@ -27,6 +27,9 @@
 #ifndef REPORT_BUILDER_H_
 #define REPORT_BUILDER_H_
 
+/* Standard includes. */
+#include <stdbool.h>
+
 /* Metrics collector. */
 #include "metrics_collector.h"
 
@@ -37,7 +40,8 @@ typedef enum
 {
     eReportBuilderSuccess = 0,
     eReportBuilderBadParameter,
-    eReportBuilderBufferTooSmall
+    eReportBuilderBufferTooSmall,
+    eReportBuilderMalformedResponse
 } eReportBuilderStatus;
 
 /**
@@ -58,6 +62,12 @@ typedef struct ReportMetrics
     size_t xOpenUdpPortsArrayLength;
     Connection_t * pxEstablishedConnectionsArray;
     size_t xEstablishedConnectionsArrayLength;
+    /* A CBOR report leaves out the lists whose flag is false, because they
+     * are the same as in the last report the service accepted. The JSON
+     * report always carries every list. */
+    bool xTcpPortsChanged;
+    bool xUdpPortsChanged;
+    bool xConnectionsChanged;
     /* Custom metrics */
     uint32_t ulStackHighWaterMark;
     TaskStatus_t * pxTaskStatusArray;
@@ -88,4 +98,48 @@ eReportBuilderStatus eGenerateJsonReport( char * pcBuffer,
                                           uint32_t ulReportId,
                                           size_t * pxOutReportLength );
 
+/**
+ * @brief Generate a CBOR report in the format expected by the AWS IoT Device
+ * Defender Service.
+ *
+ * The report has the same keys as the JSON one, but numbers are binary and
+ * the port and connection lists that have not changed are left out.
+ *
+ * @param[in] pucBuffer The buffer to write the report into, or NULL to only
+ * compute the length of the report.
+ * @param[in] xBufferLength The length of the buffer.
+ * @param[in] pxMetrics Metrics to write in the generated report.
+ * @param[in] ulMajorReportVersion Major version of the report.
+ * @param[in] ulMinorReportVersion Minor version of the report.
+ * @param[in] ulReportId Value to be used as the ulReportId in the generated report.
+ * @param[out] pxOutReportLength The length of the generated report.
+ *
+ * @return #eReportBuilderSuccess if the report is successfully generated;
+ * #eReportBuilderBadParameter if invalid parameters are passed;
+ * #eReportBuilderBufferTooSmall if the buffer cannot hold the full report.
+ */
+eReportBuilderStatus eGenerateCborReport( uint8_t * pucBuffer,
+                                          size_t xBufferLength,
+                                          const ReportMetrics_t * pxMetrics,
+                                          uint32_t ulMajorReportVersion,
+                                          uint32_t ulMinorReportVersion,
+                                          uint32_t ulReportId,
+                                          size_t * pxOutReportLength );
+
+/**
+ * @brief Read the report ID from a CBOR response of the AWS IoT Device
+ * Defender Service.
+ *
+ * @param[in] pucResponse The response.
+ * @param[in] xResponseLength The length of the response.
+ * @param[out] pulOutReportId The "reportId" of the response.
+ *
+ * @return #eReportBuilderSuccess if the report ID is found;
+ * #eReportBuilderMalformedResponse if the response is not a CBOR map with an
+ * unsigned "reportId".
+ */
+eReportBuilderStatus eGetCborResponseReportId( const uint8_t * pucResponse,
+                                               size_t xResponseLength,
+                                               uint32_t * pulOutReportId );
+
 #endif /* ifndef REPORT_BUILDER_H_ */
@@ -62,6 +62,7 @@
 
 /* JSON library includes. */
 #include "core_json.h"
+#include "json_stream.h"
 
 /* Include MQTT demo helpers header. */
 #include "mqtt_demo_helpers.h"
@@ -214,8 +215,27 @@
  */
 #define SHADOW_NAME_LENGTH    ( ( uint16_t ) ( sizeof( democonfigSHADOW_NAME ) - 1 ) )
 
+/**
+ * @brief Size of the buffers holding the numbers read from /update/delta,
+ * including the terminating NUL.
+ */
+#define SHADOW_DELTA_NUMBER_BUFFER_SIZE    ( 12U )
+
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief The values of an /update/delta document used by this demo.
+ */
+typedef struct ShadowDelta
+{
+    char cVersion[ SHADOW_DELTA_NUMBER_BUFFER_SIZE ];
+    size_t xVersionLength;
+    BaseType_t xVersionFound;
+    char cPowerOn[ SHADOW_DELTA_NUMBER_BUFFER_SIZE ];
+    size_t xPowerOnLength;
+    BaseType_t xPowerOnFound;
+} ShadowDelta_t;
+
 /**
  * @brief Each compilation unit that consumes the NetworkContext must define it.
  * It should contain a single pointer to the type of your desired transport.
@@ -331,6 +351,16 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
  */
 static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo );
 
+/**
+ * @brief Picks "version" and "state.powerOn" out of an /update/delta document
+ * as it is parsed.
+ *
+ * @param[in] pvContext The #ShadowDelta_t to fill in.
+ * @param[in] pxEvent The JSON event.
+ */
+static void prvUpdateDeltaFieldCallback( void * pvContext,
+                                         const JsonStreamEvent_t * pxEvent );
+
 /**
  * @brief Process payload from /update/accepted topic.
  *
@@ -472,19 +502,49 @@ static void prvDeleteRejectedHandler( MQTTPublishInfo_t * pxPublishInfo )
 
 /*-----------------------------------------------------------*/
 
+static void prvUpdateDeltaFieldCallback( void * pvContext,
+                                         const JsonStreamEvent_t * pxEvent )
+{
+    ShadowDelta_t * pxDelta = ( ShadowDelta_t * ) pvContext;
+
+    /* Numbers are copied with room left for a terminating NUL. */
+    if( pxEvent->pcValue == NULL )
+    {
+        /* Not a value. */
+    }
+    else if( xJsonStream_PathIs( pxEvent, "version", sizeof( "version" ) - 1 ) == pdTRUE )
+    {
+        pxDelta->xVersionFound = xJsonStream_CopyValue( pxEvent,
+                                                        pxDelta->cVersion,
+                                                        sizeof( pxDelta->cVersion ) - 1U,
+                                                        &( pxDelta->xVersionLength ) );
+    }
+    else if( xJsonStream_PathIs( pxEvent, "state.powerOn", sizeof( "state.powerOn" ) - 1 ) == pdTRUE )
+    {
+        pxDelta->xPowerOnFound = xJsonStream_CopyValue( pxEvent,
+                                                        pxDelta->cPowerOn,
+                                                        sizeof( pxDelta->cPowerOn ) - 1U,
+                                                        &( pxDelta->xPowerOnLength ) );
+    }
+    else
+    {
+        /* Not a value used by this demo. */
+    }
+}
+
 static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo )
 {
     static uint32_t ulCurrentVersion = 0; /* Remember the latestVersion # we've ever received */
     uint32_t ulVersion = 0U;
     uint32_t ulNewState = 0U;
-    char * pcOutValue = NULL;
-    uint32_t ulOutValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
+    ShadowDelta_t xDelta = { 0 };
 
     configASSERT( pxPublishInfo != NULL );
     configASSERT( pxPublishInfo->pPayload != NULL );
 
-    LogInfo( ( "/update/delta json payload:%s.", ( const char * ) pxPublishInfo->pPayload ) );
+    LogInfo( ( "/update/delta json payload:%.*s.",
+               pxPublishInfo->payloadLength,
+               ( const char * ) pxPublishInfo->pPayload ) );
 
     /* The payload will look similar to this:
      * {
@@ -500,94 +560,79 @@ static void prvUpdateDeltaHandler( MQTTPublishInfo_t * pxPublishInfo )
      *      },
      *      "clientToken": "388062"
      *  }
-     */
-
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pxPublishInfo->pPayload,
-                            pxPublishInfo->payloadLength );
-
-    if( result == JSONSuccess )
+     *
+     * A single pass over the document both validates it and picks out the
+     * "version" and "state.powerOn" values. */
+    if( xJsonStream_Parse( ( const char * ) pxPublishInfo->pPayload,
+                           pxPublishInfo->payloadLength,
+                           prvUpdateDeltaFieldCallback,
+                           &xDelta ) != pdPASS )
     {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
+        LogError( ( "The json document is invalid!!" ) );
+        xUpdateDeltaReturn = pdFAIL;
     }
-    else
+    else if( xDelta.xVersionFound != pdPASS )
     {
-        LogError( ( "The json document is invalid!!" ) );
+        LogError( ( "No version in json document!!" ) );
+        xUpdateDeltaReturn = pdFAIL;
     }
-
-    if( result == JSONSuccess )
+    else
     {
         LogInfo( ( "version: %.*s",
-                   ulOutValueLength,
-                   pcOutValue ) );
+                   xDelta.xVersionLength,
+                   xDelta.cVersion ) );
 
         /* Convert the extracted value to an unsigned integer value. */
-        ulVersion = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
-    }
-    else
-    {
-        LogError( ( "No version in json document!!" ) );
-    }
+        xDelta.cVersion[ xDelta.xVersionLength ] = '\0';
+        ulVersion = ( uint32_t ) strtoul( xDelta.cVersion, NULL, 10 );
 
-    LogInfo( ( "version:%d, ulCurrentVersion:%d \r\n", ulVersion, ulCurrentVersion ) );
+        LogInfo( ( "version:%d, ulCurrentVersion:%d \r\n", ulVersion, ulCurrentVersion ) );
 
-    /* When the version is much newer than the one we retained, that means the powerOn
-     * state is valid for us. */
-    if( ulVersion > ulCurrentVersion )
-    {
-        /* Set to received version as the current version. */
-        ulCurrentVersion = ulVersion;
+        /* When the version is much newer than the one we retained, that means the powerOn
+         * state is valid for us. */
+        if( ulVersion <= ulCurrentVersion )
+        {
+            /* In this demo, we discard the incoming message
+             * if the version number is not newer than the latest
+             * that we've received before. Your application may use a
+             * different approach.
+             */
+            LogWarn( ( "The received version is smaller than current one!!" ) );
+        }
+        else if( xDelta.xPowerOnFound != pdPASS )
+        {
+            /* Set to received version as the current version. */
+            ulCurrentVersion = ulVersion;
 
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                              pxPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              &pcOutValue,
-                              ( size_t * ) &ulOutValueLength );
-    }
-    else
-    {
-        /* In this demo, we discard the incoming message
-         * if the version number is not newer than the latest
-         * that we've received before. Your application may use a
-         * different approach.
-         */
-        LogWarn( ( "The received version is smaller than current one!!" ) );
-    }
+            LogError( ( "No powerOn in json document!!" ) );
+            xUpdateDeltaReturn = pdFAIL;
+        }
+        else
+        {
+            /* Set to received version as the current version. */
+            ulCurrentVersion = ulVersion;
 
-    if( result == JSONSuccess )
-    {
-        /* Convert the powerOn state value to an unsigned integer value. */
-        ulNewState = ( uint32_t ) strtoul( pcOutValue, NULL, 10 );
+            /* Convert the powerOn state value to an unsigned integer value. */
+            xDelta.cPowerOn[ xDelta.xPowerOnLength ] = '\0';
+            ulNewState = ( uint32_t ) strtoul( xDelta.cPowerOn, NULL, 10 );
 
-        LogInfo( ( "The new power on state newState:%d, ulCurrentPowerOnState:%d \r\n",
-                   ulNewState, ulCurrentPowerOnState ) );
+            LogInfo( ( "The new power on state newState:%d, ulCurrentPowerOnState:%d \r\n",
+                       ulNewState, ulCurrentPowerOnState ) );
 
-        if( ulNewState != ulCurrentPowerOnState )
-        {
-            /* The received powerOn state is different from the one we retained before, so we switch them
-             * and set the flag. */
-            ulCurrentPowerOnState = ulNewState;
-
-            /* State change will be handled in main(), where we will publish a "reported"
-             * state to the device shadow. We do not do it here because we are inside of
-             * a callback from the MQTT library, so that we don't re-enter
-             * the MQTT library. */
-            stateChanged = true;
+            if( ulNewState != ulCurrentPowerOnState )
+            {
+                /* The received powerOn state is different from the one we retained before, so we switch them
+                 * and set the flag. */
+                ulCurrentPowerOnState = ulNewState;
+
+                /* State change will be handled in main(), where we will publish a "reported"
+                 * state to the device shadow. We do not do it here because we are inside of
+                 * a callback from the MQTT library, so that we don't re-enter
+                 * the MQTT library. */
+                stateChanged = true;
+            }
         }
     }
-    else
-    {
-        LogError( ( "No powerOn in json document!!" ) );
-        xUpdateDeltaReturn = pdFAIL;
-    }
 }
 
 /*-----------------------------------------------------------*/
@@ -74,11 +74,15 @@
 #include "jobs.h"
 
 /* JSON library includes. */
-#include "core_json.h"
+#include "json_stream.h"
 
 /* Include common MQTT demo helpers. */
 #include "mqtt_demo_helpers.h"
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+    #include "mqtt_publish_journal_store_file.h"
+#endif
+
 /*------------- Demo configurations -------------------------*/
 
 #ifndef democonfigTHING_NAME
@@ -137,13 +141,12 @@
 #define jobsexampleQUERY_KEY_FOR_JOBS_DOC_LENGTH    ( sizeof( jobsexampleQUERY_KEY_FOR_JOBS_DOC ) - 1 )
 
 /**
- * @brief The query key to use for searching the Action key in Jobs document
- * from AWS IoT Jobs service.
+ * @brief The path of the Action key in messages from AWS IoT Jobs service.
  *
  * This demo program expects this key to be in the Job document. It is a key
  * specific to this demo.
  */
-#define jobsexampleQUERY_KEY_FOR_ACTION             "action"
+#define jobsexampleQUERY_KEY_FOR_ACTION             jobsexampleQUERY_KEY_FOR_JOBS_DOC  ".action"
 
 /**
  * @brief The length of #jobsexampleQUERY_KEY_FOR_ACTION.
@@ -151,14 +154,13 @@
 #define jobsexampleQUERY_KEY_FOR_ACTION_LENGTH      ( sizeof( jobsexampleQUERY_KEY_FOR_ACTION ) - 1 )
 
 /**
- * @brief The query key to use for searching the Message key in Jobs document
- * from AWS IoT Jobs service.
+ * @brief The path of the Message key in messages from AWS IoT Jobs service.
  *
  * This demo program expects this key to be in the Job document if the "action"
  * is either "publish" or "print". It represents the message that should be
  * published or printed, respectively.
  */
-#define jobsexampleQUERY_KEY_FOR_MESSAGE            "message"
+#define jobsexampleQUERY_KEY_FOR_MESSAGE            jobsexampleQUERY_KEY_FOR_JOBS_DOC  ".message"
 
 /**
  * @brief The length of #jobsexampleQUERY_KEY_FOR_MESSAGE.
@@ -166,20 +168,50 @@
 #define jobsexampleQUERY_KEY_FOR_MESSAGE_LENGTH     ( sizeof( jobsexampleQUERY_KEY_FOR_MESSAGE ) - 1 )
 
 /**
- * @brief The query key to use for searching the topic key in Jobs document
- * from AWS IoT Jobs service.
+ * @brief The path of the topic key in messages from AWS IoT Jobs service.
  *
  * This demo program expects this key to be in the Job document if the "action"
  * is "publish". It represents the MQTT topic on which the message should be
  * published.
  */
-#define jobsexampleQUERY_KEY_FOR_TOPIC              "topic"
+#define jobsexampleQUERY_KEY_FOR_TOPIC              jobsexampleQUERY_KEY_FOR_JOBS_DOC  ".topic"
 
 /**
  * @brief The length of #jobsexampleQUERY_KEY_FOR_TOPIC.
  */
 #define jobsexampleQUERY_KEY_FOR_TOPIC_LENGTH       ( sizeof( jobsexampleQUERY_KEY_FOR_TOPIC ) - 1 )
 
+/**
+ * @brief Size of the buffer for the "action" of a job document. None of the
+ * actions supported by this demo are longer.
+ */
+#define jobsexampleMAX_ACTION_LENGTH                ( 16U )
+
+/**
+ * @brief Size of the buffer for the "topic" of a job document.
+ *
+ * Jobs with a longer "action", "message" or "topic" are reported as failed.
+ */
+#ifndef jobsexampleMAX_TOPIC_LENGTH
+    #define jobsexampleMAX_TOPIC_LENGTH             ( 128U )
+#endif
+
+/**
+ * @brief Size of the buffer for the "message" of a job document.
+ */
+#ifndef jobsexampleMAX_MESSAGE_LENGTH
+    #define jobsexampleMAX_MESSAGE_LENGTH           ( 512U )
+#endif
+
+/**
+ * @brief Bits of JobExecution_t::ucFieldsFound.
+ */
+#define jobsexampleFIELD_JOB_ID                     ( 1U << 0 )
+#define jobsexampleFIELD_JOBS_DOC                   ( 1U << 1 )
+#define jobsexampleFIELD_ACTION                     ( 1U << 2 )
+#define jobsexampleFIELD_MESSAGE                    ( 1U << 3 )
+#define jobsexampleFIELD_TOPIC                      ( 1U << 4 )
+
 /**
  * @brief Utility macro to generate the PUBLISH topic string to the
  * DescribeJobExecution API of AWS IoT Jobs service for requesting
@@ -243,6 +275,26 @@ typedef enum JobActionType
     JOB_ACTION_UNKNOWN  /**< Unknown action. */
 } JobActionType;
 
+/**
+ * @brief The parts of a next job message that this demo uses.
+ *
+ * They are picked out of the payload while it is parsed in the MQTT event
+ * callback, so neither the payload nor the job document is copied.
+ */
+typedef struct JobExecution
+{
+    char cJobId[ JOBS_JOBID_MAX_LENGTH ];
+    size_t xJobIdLength;
+    char cAction[ jobsexampleMAX_ACTION_LENGTH ];
+    size_t xActionLength;
+    char cMessage[ jobsexampleMAX_MESSAGE_LENGTH ];
+    size_t xMessageLength;
+    char cTopic[ jobsexampleMAX_TOPIC_LENGTH ];
+    size_t xTopicLength;
+    uint8_t ucFieldsFound;    /**< Bit mask of the jobsexampleFIELD_* values present. */
+    uint8_t ucFieldsTooLong;  /**< Bit mask of the values that did not fit their buffer. */
+} JobExecution_t;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -279,21 +331,6 @@ static TlsTransportParams_t xTlsTransportParams;
  */
 static uint8_t usMqttConnectionBuffer[ democonfigNETWORK_BUFFER_SIZE ];
 
-/**
- * @brief Static buffer used to hold the job ID of the single job that
- * is executed at a time in the demo. This buffer allows re-use of the MQTT
- * connection context for sending status updates of a job while it is being
- * processed.
- */
-static uint8_t usJobIdBuffer[ democonfigNETWORK_BUFFER_SIZE ];
-
-/**
- * @brief Static buffer used to hold the job document of the single job that
- * is executed at a time in the demo. This buffer allows re-use of the MQTT
- * connection context for sending status updates of a job while it is being processed.
- */
-static uint8_t usJobsDocumentBuffer[ democonfigNETWORK_BUFFER_SIZE ];
-
 /**
  * @brief Static buffer used to hold MQTT messages being sent and received.
  */
@@ -318,10 +355,22 @@ static BaseType_t xExitActionJobReceived = pdFALSE;
 static BaseType_t xDemoEncounteredError = pdFALSE;
 
 /**
- * @brief Queue used to pass incoming Jobs messages to a task to handle them.
+ * @brief Queue used to pass the #JobExecution_t parsed from incoming Jobs
+ * messages to a task to handle them.
  */
 static QueueHandle_t xJobMessageQueue;
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+
+/**
+ * @brief The journal keeping the publishes of the demo until they are
+ * acknowledged, and the file it is stored in.
+ */
+    static PublishJournal_t xPublishJournal;
+    static PublishJournalStore_t xPublishJournalStore;
+    static PublishJournalFileStore_t xPublishJournalFileStore;
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -351,16 +400,25 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
                               MQTTDeserializedInfo_t * pxDeserializedInfo );
 
 /**
- * @brief Process payload from NextJobExecutionChanged and DescribeJobExecution
- * API MQTT topics of AWS IoT Jobs service.
+ * @brief Picks the values used by this demo out of a message from the
+ * NextJobExecutionChanged and DescribeJobExecution APIs as it is parsed.
  *
- * This handler parses the received payload about the next pending job, identifies
- * the action requested in the job document, and executes the action.
+ * @param[in] pvContext The #JobExecution_t to fill in.
+ * @param[in] pxEvent The JSON event.
+ */
+static void prvJobFieldCallback( void * pvContext,
+                                 const JsonStreamEvent_t * pxEvent );
+
+/**
+ * @brief Process a job received from the NextJobExecutionChanged and
+ * DescribeJobExecution API MQTT topics of AWS IoT Jobs service.
  *
- * @param[in] pPublishInfo Deserialized publish info pointer for the incoming
- * packet.
+ * This handler identifies the action requested in the job document, and
+ * executes the action.
+ *
+ * @param[in] pxJob The job, as parsed by the MQTT event callback.
  */
-static void prvNextJobHandler( MQTTPublishInfo_t * pxPublishInfo );
+static void prvNextJobHandler( JobExecution_t * pxJob );
 
 /**
  * @brief Sends an update for a job to the UpdateJobExecution API of the AWS IoT Jobs service.
@@ -376,19 +434,11 @@ static void prvSendUpdateForJob( char * pcJobId,
 
 /**
  * @brief Executes a job received from AWS IoT Jobs service and sends an update back to the service.
- * It parses the received job document, executes the job depending on the job "Action" type, and
- * sends an update to AWS for the Job.
+ * It executes the job depending on the job "Action" type, and sends an update to AWS for the Job.
  *
- * @param[in] pcJobId The ID of the job to execute.
- * @param[in] usJobIdLength The length of the job ID string.
- * @param[in] pcJobDocument The JSON document associated with the @a pcJobID job
- * that is to be processed.
- * @param[in] usDocumentLength The length of the job document.
+ * @param[in] pxJob The job to execute.
  */
-static void prvProcessJobDocument( char * pcJobId,
-                                   uint16_t usJobIdLength,
-                                   char * pcJobDocument,
-                                   uint16_t jobDocumentLength );
+static void prvProcessJobDocument( JobExecution_t * pxJob );
 
 /**
  * @brief The task used to demonstrate the Jobs library API.
@@ -470,28 +520,14 @@ static void prvSendUpdateForJob( char * pcJobId,
     }
 }
 
-static void prvProcessJobDocument( char * pcJobId,
-                                   uint16_t usJobIdLength,
-                                   char * pcJobDocument,
-                                   uint16_t jobDocumentLength )
+static void prvProcessJobDocument( JobExecution_t * pxJob )
 {
-    char * pcAction = NULL;
-    size_t uActionLength = 0U;
-    JSONStatus_t xJsonStatus = JSONSuccess;
+    char * pcJobId = pxJob->cJobId;
+    uint16_t usJobIdLength = ( uint16_t ) pxJob->xJobIdLength;
 
-    configASSERT( pcJobId != NULL );
     configASSERT( usJobIdLength > 0 );
-    configASSERT( pcJobDocument != NULL );
-    configASSERT( jobDocumentLength > 0 );
-
-    xJsonStatus = JSON_Search( pcJobDocument,
-                               jobDocumentLength,
-                               jobsexampleQUERY_KEY_FOR_ACTION,
-                               jobsexampleQUERY_KEY_FOR_ACTION_LENGTH,
-                               &pcAction,
-                               &uActionLength );
 
-    if( xJsonStatus != JSONSuccess )
+    if( ( pxJob->ucFieldsFound & jobsexampleFIELD_ACTION ) == 0U )
     {
         LogError( ( "Job document schema is invalid. Missing expected \"action\" key in document." ) );
         prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "FAILED" ) );
@@ -499,10 +535,8 @@ static void prvProcessJobDocument( char * pcJobId,
     else
     {
         JobActionType xActionType = JOB_ACTION_UNKNOWN;
-        char * pcMessage = NULL;
-        size_t ulMessageLength = 0U;
 
-        xActionType = prvGetAction( pcAction, uActionLength );
+        xActionType = prvGetAction( pxJob->cAction, pxJob->xActionLength );
 
         switch( xActionType )
         {
@@ -515,14 +549,7 @@ static void prvProcessJobDocument( char * pcJobId,
             case JOB_ACTION_PRINT:
                 LogInfo( ( "Received job contains \"print\" action." ) );
 
-                xJsonStatus = JSON_Search( pcJobDocument,
-                                           jobDocumentLength,
-                                           jobsexampleQUERY_KEY_FOR_MESSAGE,
-                                           jobsexampleQUERY_KEY_FOR_MESSAGE_LENGTH,
-                                           &pcMessage,
-                                           &ulMessageLength );
-
-                if( xJsonStatus == JSONSuccess )
+                if( ( pxJob->ucFieldsFound & jobsexampleFIELD_MESSAGE ) != 0U )
                 {
                     /* Print the given message if the action is "print". */
                     LogInfo( ( "\r\n"
@@ -531,7 +558,7 @@ static void prvProcessJobDocument( char * pcJobId,
                                "%.*s\r\n"
                                "\r\n"
                                "/*-----------------------------------------------------------*/\r\n"
-                               "\r\n", ulMessageLength, pcMessage ) );
+                               "\r\n", pxJob->xMessageLength, pxJob->cMessage ) );
                     prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "SUCCEEDED" ) );
                 }
                 else
@@ -544,136 +571,150 @@ static void prvProcessJobDocument( char * pcJobId,
 
             case JOB_ACTION_PUBLISH:
                 LogInfo( ( "Received job contains \"publish\" action." ) );
-                char * pcTopic = NULL;
-                size_t ulTopicLength = 0U;
-
-                xJsonStatus = JSON_Search( pcJobDocument,
-                                           jobDocumentLength,
-                                           jobsexampleQUERY_KEY_FOR_TOPIC,
-                                           jobsexampleQUERY_KEY_FOR_TOPIC_LENGTH,
-                                           &pcTopic,
-                                           &ulTopicLength );
-
-                /* Search for "topic" key in the Jobs document.*/
-                if( xJsonStatus != JSONSuccess )
+
+                /* Check for "topic" key in the Jobs document.*/
+                if( ( pxJob->ucFieldsFound & jobsexampleFIELD_TOPIC ) == 0U )
                 {
                     LogError( ( "Job document schema is invalid. Missing \"topic\" key for \"publish\" action type." ) );
                     prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "FAILED" ) );
                 }
-                else
+                /* Check for "message" key in Jobs document.*/
+                else if( ( pxJob->ucFieldsFound & jobsexampleFIELD_MESSAGE ) != 0U )
                 {
-                    xJsonStatus = JSON_Search( pcJobDocument,
-                                               jobDocumentLength,
-                                               jobsexampleQUERY_KEY_FOR_MESSAGE,
-                                               jobsexampleQUERY_KEY_FOR_MESSAGE_LENGTH,
-                                               &pcMessage,
-                                               &ulMessageLength );
-
-                    /* Search for "message" key in Jobs document.*/
-                    if( xJsonStatus == JSONSuccess )
+                    /* Publish to the parsed MQTT topic with the message obtained from
+                     * the Jobs document.*/
+                    if( xPublishToTopic( &xMqttContext,
+                                         pxJob->cTopic,
+                                         pxJob->xTopicLength,
+                                         pxJob->cMessage,
+                                         pxJob->xMessageLength ) == pdFALSE )
                     {
-                        /* Publish to the parsed MQTT topic with the message obtained from
-                         * the Jobs document.*/
-                        if( xPublishToTopic( &xMqttContext,
-                                             pcTopic,
-                                             ulTopicLength,
-                                             pcMessage,
-                                             ulMessageLength ) == pdFALSE )
-                        {
-                            /* Set global flag to terminate demo as PUBLISH operation to execute job failed. */
-                            xDemoEncounteredError = pdTRUE;
-
-                            LogError( ( "Failed to execute job with \"publish\" action: Failed to publish to topic. "
-                                        "JobID=%.*s, Topic=%.*s",
-                                        usJobIdLength, pcJobId, ulTopicLength, pcTopic ) );
-                        }
-
-                        prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "SUCCEEDED" ) );
-                    }
-                    else
-                    {
-                        LogError( ( "Job document schema is invalid. Missing \"message\" key for \"publish\" action type." ) );
-                        prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "FAILED" ) );
+                        /* Set global flag to terminate demo as PUBLISH operation to execute job failed. */
+                        xDemoEncounteredError = pdTRUE;
+
+                        LogError( ( "Failed to execute job with \"publish\" action: Failed to publish to topic. "
+                                    "JobID=%.*s, Topic=%.*s",
+                                    usJobIdLength, pcJobId, pxJob->xTopicLength, pxJob->cTopic ) );
                     }
+
+                    prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "SUCCEEDED" ) );
+                }
+                else
+                {
+                    LogError( ( "Job document schema is invalid. Missing \"message\" key for \"publish\" action type." ) );
+                    prvSendUpdateForJob( pcJobId, usJobIdLength, MAKE_STATUS_REPORT( "FAILED" ) );
                 }
 
                 break;
 
             default:
                 configPRINTF( ( "Received Job document with unknown action %.*s.",
-                                uActionLength, pcAction ) );
+                                pxJob->xActionLength, pxJob->cAction ) );
                 break;
         }
     }
 }
 
-static void prvNextJobHandler( MQTTPublishInfo_t * pxPublishInfo )
+static void prvNextJobHandler( JobExecution_t * pxJob )
 {
-    configASSERT( pxPublishInfo != NULL );
-    configASSERT( ( pxPublishInfo->pPayload != NULL ) && ( pxPublishInfo->payloadLength > 0 ) );
+    configASSERT( pxJob != NULL );
+    configASSERT( ( pxJob->ucFieldsFound & jobsexampleFIELD_JOB_ID ) != 0U );
+    configASSERT( ( pxJob->ucFieldsTooLong & jobsexampleFIELD_JOB_ID ) == 0U );
+
+    LogInfo( ( "Received a Job from AWS IoT Jobs service: JobId=%.*s",
+               pxJob->xJobIdLength, pxJob->cJobId ) );
 
-    /* Check validity of JSON message response from server.*/
-    if( JSON_Validate( pxPublishInfo->pPayload, pxPublishInfo->payloadLength ) != JSONSuccess )
+    if( ( pxJob->ucFieldsFound & jobsexampleFIELD_JOBS_DOC ) == 0U )
     {
-        LogError( ( "Received invalid JSON payload from AWS IoT Jobs service" ) );
+        LogWarn( ( "Failed to parse document of next job received from AWS IoT Jobs service: "
+                   "JobID=%.*s",
+                   pxJob->xJobIdLength, pxJob->cJobId ) );
+    }
+    else if( pxJob->ucFieldsTooLong != 0U )
+    {
+        LogError( ( "Job document has a value too long for this demo: JobID=%.*s",
+                    pxJob->xJobIdLength, pxJob->cJobId ) );
+        prvSendUpdateForJob( pxJob->cJobId, ( uint16_t ) pxJob->xJobIdLength, MAKE_STATUS_REPORT( "FAILED" ) );
+    }
+    else
+    {
+        /* Process the Job document and execute the job. */
+        prvProcessJobDocument( pxJob );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvJobFieldCallback( void * pvContext,
+                                 const JsonStreamEvent_t * pxEvent )
+{
+    JobExecution_t * pxJob = ( JobExecution_t * ) pvContext;
+    char * pcBuffer = NULL;
+    size_t xBufferSize = 0U;
+    size_t * pxLength = NULL;
+    uint8_t ucField = 0U;
+
+    if( pxEvent->pcValue == NULL )
+    {
+        /* Objects and arrays are not copied, only their presence is noted. */
+        if( xJsonStream_PathIs( pxEvent,
+                                jobsexampleQUERY_KEY_FOR_JOBS_DOC,
+                                jobsexampleQUERY_KEY_FOR_JOBS_DOC_LENGTH ) == pdTRUE )
+        {
+            pxJob->ucFieldsFound |= jobsexampleFIELD_JOBS_DOC;
+        }
+    }
+    else if( xJsonStream_PathIs( pxEvent,
+                                 jobsexampleQUERY_KEY_FOR_JOB_ID,
+                                 jobsexampleQUERY_KEY_FOR_JOB_ID_LENGTH ) == pdTRUE )
+    {
+        /* Keep the Job ID shorter than JOBS_JOBID_MAX_LENGTH, as Jobs_Update() requires. */
+        pcBuffer = pxJob->cJobId;
+        xBufferSize = sizeof( pxJob->cJobId ) - 1U;
+        pxLength = &( pxJob->xJobIdLength );
+        ucField = jobsexampleFIELD_JOB_ID;
+    }
+    else if( xJsonStream_PathIs( pxEvent,
+                                 jobsexampleQUERY_KEY_FOR_ACTION,
+                                 jobsexampleQUERY_KEY_FOR_ACTION_LENGTH ) == pdTRUE )
+    {
+        pcBuffer = pxJob->cAction;
+        xBufferSize = sizeof( pxJob->cAction );
+        pxLength = &( pxJob->xActionLength );
+        ucField = jobsexampleFIELD_ACTION;
+    }
+    else if( xJsonStream_PathIs( pxEvent,
+                                 jobsexampleQUERY_KEY_FOR_MESSAGE,
+                                 jobsexampleQUERY_KEY_FOR_MESSAGE_LENGTH ) == pdTRUE )
+    {
+        pcBuffer = pxJob->cMessage;
+        xBufferSize = sizeof( pxJob->cMessage );
+        pxLength = &( pxJob->xMessageLength );
+        ucField = jobsexampleFIELD_MESSAGE;
+    }
+    else if( xJsonStream_PathIs( pxEvent,
+                                 jobsexampleQUERY_KEY_FOR_TOPIC,
+                                 jobsexampleQUERY_KEY_FOR_TOPIC_LENGTH ) == pdTRUE )
+    {
+        pcBuffer = pxJob->cTopic;
+        xBufferSize = sizeof( pxJob->cTopic );
+        pxLength = &( pxJob->xTopicLength );
+        ucField = jobsexampleFIELD_TOPIC;
     }
     else
     {
-        char * pcJobId = NULL;
-        size_t ulJobIdLength = 0UL;
-
-        /* Parse the Job ID of the next pending job execution from the JSON payload. */
-        if( JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                         pxPublishInfo->payloadLength,
-                         jobsexampleQUERY_KEY_FOR_JOB_ID,
-                         jobsexampleQUERY_KEY_FOR_JOB_ID_LENGTH,
-                         &pcJobId,
-                         &ulJobIdLength ) != JSONSuccess )
+        /* Not a value used by this demo. */
+    }
+
+    if( pcBuffer != NULL )
+    {
+        if( xJsonStream_CopyValue( pxEvent, pcBuffer, xBufferSize, pxLength ) == pdPASS )
         {
-            LogWarn( ( "Failed to parse Job ID in message received from AWS IoT Jobs service: "
-                       "IncomingTopic=%.*s, Payload=%.*s",
-                       pxPublishInfo->topicNameLength, pxPublishInfo->pTopicName,
-                       pxPublishInfo->payloadLength, pxPublishInfo->pPayload ) );
+            pxJob->ucFieldsFound |= ucField;
         }
         else
         {
-            char * pcJobDocLoc = NULL;
-            size_t ulJobDocLength = 0UL;
-
-            configASSERT( ulJobIdLength < JOBS_JOBID_MAX_LENGTH );
-            LogInfo( ( "Received a Job from AWS IoT Jobs service: JobId=%.*s",
-                       ulJobIdLength, pcJobId ) );
-
-            /* Copy the Job ID in the global buffer. This is done so that
-             * the MQTT context's network buffer can be used for sending jobs
-             * status updates to the AWS IoT Jobs service. */
-            memcpy( usJobIdBuffer, pcJobId, ulJobIdLength );
-
-            /* Search for the jobs document in the payload. */
-            if( JSON_Search( ( char * ) pxPublishInfo->pPayload,
-                             pxPublishInfo->payloadLength,
-                             jobsexampleQUERY_KEY_FOR_JOBS_DOC,
-                             jobsexampleQUERY_KEY_FOR_JOBS_DOC_LENGTH,
-                             &pcJobDocLoc,
-                             &ulJobDocLength ) != JSONSuccess )
-            {
-                LogWarn( ( "Failed to parse document of next job received from AWS IoT Jobs service: "
-                           "Topic=%.*s, JobID=%.*s",
-                           pxPublishInfo->topicNameLength, pxPublishInfo->pTopicName,
-                           ulJobIdLength, pcJobId ) );
-            }
-            else
-            {
-                /* Copy the Job document in buffer. This is done so that the MQTT connection buffer can
-                 * be used for sending jobs status updates to the AWS IoT Jobs service. */
-                memcpy( usJobsDocumentBuffer, pcJobDocLoc, ulJobDocLength );
-
-                /* Process the Job document and execute the job. */
-                prvProcessJobDocument( usJobIdBuffer,
-                                       ( uint16_t ) ulJobIdLength,
-                                       usJobsDocumentBuffer,
-                                       ulJobDocLength );
-            }
+            pxJob->ucFieldsTooLong |= ucField;
         }
     }
 }
@@ -726,50 +767,43 @@ static void prvEventCallback( MQTTContext_t * pxMqttContext,
             /* Upon successful return, the messageType has been filled in. */
             if( ( topicType == JobsDescribeSuccess ) || ( topicType == JobsNextJobChanged ) )
             {
-                MQTTPublishInfo_t * pxJobMessagePublishInfo = NULL;
-                char * pcTopicName = NULL;
-                char * pcPayload = NULL;
+                JobExecution_t * pxJob = NULL;
 
-                /* Copy message to pass into queue. */
-                pxJobMessagePublishInfo = ( MQTTPublishInfo_t * ) pvPortMalloc( sizeof( MQTTPublishInfo_t ) );
-                pcTopicName = ( char * ) pvPortMalloc( pxDeserializedInfo->pPublishInfo->topicNameLength );
-                pcPayload = ( char * ) pvPortMalloc( pxDeserializedInfo->pPublishInfo->payloadLength );
+                /* Parse the message here, while it is still in the MQTT network
+                 * buffer, keeping only the values needed to execute the job. */
+                pxJob = ( JobExecution_t * ) pvPortMalloc( sizeof( JobExecution_t ) );
 
-                if( ( pxJobMessagePublishInfo == NULL ) || ( pcTopicName == NULL ) || ( pcPayload == NULL ) )
+                if( pxJob == NULL )
                 {
-                    LogError( ( "Malloc failed for copying job publish info." ) );
+                    LogError( ( "Malloc failed for parsing job publish info." ) );
+                }
+                else
+                {
+                    memset( pxJob, 0, sizeof( JobExecution_t ) );
 
-                    if( pxJobMessagePublishInfo != NULL )
+                    if( xJsonStream_Parse( ( const char * ) pxDeserializedInfo->pPublishInfo->pPayload,
+                                           pxDeserializedInfo->pPublishInfo->payloadLength,
+                                           prvJobFieldCallback,
+                                           pxJob ) != pdPASS )
                     {
-                        vPortFree( pxJobMessagePublishInfo );
+                        LogError( ( "Received invalid JSON payload from AWS IoT Jobs service" ) );
+                        vPortFree( pxJob );
                     }
-
-                    if( pcTopicName != NULL )
+                    else if( ( ( pxJob->ucFieldsFound & jobsexampleFIELD_JOB_ID ) == 0U ) ||
+                             ( ( pxJob->ucFieldsTooLong & jobsexampleFIELD_JOB_ID ) != 0U ) )
                     {
-                        vPortFree( pcTopicName );
+                        LogWarn( ( "Failed to parse Job ID in message received from AWS IoT Jobs service: "
+                                   "IncomingTopic=%.*s, Payload=%.*s",
+                                   pxDeserializedInfo->pPublishInfo->topicNameLength,
+                                   pxDeserializedInfo->pPublishInfo->pTopicName,
+                                   pxDeserializedInfo->pPublishInfo->payloadLength,
+                                   pxDeserializedInfo->pPublishInfo->pPayload ) );
+                        vPortFree( pxJob );
                     }
-
-                    if( pcPayload != NULL )
-                    {
-                        vPortFree( pcPayload );
-                    }
-                }
-                else
-                {
-                    memcpy( pxJobMessagePublishInfo, pxDeserializedInfo->pPublishInfo, sizeof( MQTTPublishInfo_t ) );
-                    memcpy( pcTopicName, pxDeserializedInfo->pPublishInfo->pTopicName, pxDeserializedInfo->pPublishInfo->topicNameLength );
-                    memcpy( pcPayload, pxDeserializedInfo->pPublishInfo->pPayload, pxDeserializedInfo->pPublishInfo->payloadLength );
-
-                    pxJobMessagePublishInfo->pTopicName = pcTopicName;
-                    pxJobMessagePublishInfo->pPayload = pcPayload;
-
-                    if( xQueueSend( xJobMessageQueue, &pxJobMessagePublishInfo, 0 ) == errQUEUE_FULL )
+                    else if( xQueueSend( xJobMessageQueue, &pxJob, 0 ) == errQUEUE_FULL )
                     {
                         LogError( ( "Could not enqueue Jobs message." ) );
-
-                        vPortFree( pxJobMessagePublishInfo );
-                        vPortFree( pcTopicName );
-                        vPortFree( pcPayload );
+                        vPortFree( pxJob );
                     }
                 }
             }
@@ -853,9 +887,28 @@ void prvJobsDemoTask( void * pvParameters )
     xNetworkContext.pParams = &xTlsTransportParams;
 
     /* Initialize Jobs message queue. */
-    xJobMessageQueue = xQueueCreate( JOBS_MESSAGE_QUEUE_LEN, sizeof( MQTTPublishInfo_t * ) );
+    xJobMessageQueue = xQueueCreate( JOBS_MESSAGE_QUEUE_LEN, sizeof( JobExecution_t * ) );
     configASSERT( xJobMessageQueue != NULL );
 
+    #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+        /* Open the journal before connecting, so publishes left over from an
+         * earlier run are sent again once the connection is up. */
+        vPublishJournalFileStore_Init( &xPublishJournalStore,
+                                       &xPublishJournalFileStore,
+                                       democonfigPUBLISH_JOURNAL_PATH,
+                                       democonfigPUBLISH_JOURNAL_REWRITE_PATH );
+
+        if( xPublishJournal_Open( &xPublishJournal, &xPublishJournalStore ) == pdPASS )
+        {
+            vSetPublishJournal( &xPublishJournal );
+        }
+        else
+        {
+            LogWarn( ( "Could not open the publish journal %s. Publishes are not journaled.",
+                       democonfigPUBLISH_JOURNAL_PATH ) );
+        }
+    #endif
+
     /* This demo runs a single loop unless there are failures in the demo execution.
      * In case of failures in the demo execution, demo loop will be retried for up to
      * JOBS_MAX_DEMO_LOOP_COUNT times. */
@@ -956,21 +1009,28 @@ void prvJobsDemoTask( void * pvParameters )
                ( xDemoEncounteredError == pdFALSE ) &&
                ( xDemoStatus == pdPASS ) )
         {
-            MQTTPublishInfo_t * pxJobMessagePublishInfo;
+            JobExecution_t * pxJob;
             MQTTStatus_t xMqttStatus = MQTTSuccess;
 
             /* Check if we have notification for the next pending job in the queue from the
              * NextJobExecutionChanged API of the AWS IoT Jobs service. */
             xMqttStatus = MQTT_ProcessLoop( &xMqttContext );
 
+            #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                if( xMqttStatus == MQTTSuccess )
+                {
+                    /* Send journaled publishes that were waiting for the
+                     * acknowledgments just received. */
+                    vResendJournaledPublishes( &xMqttContext );
+                }
+            #endif
+
             /* Receive any incoming Jobs message. */
-            if( xQueueReceive( xJobMessageQueue, &pxJobMessagePublishInfo, 0 ) == pdTRUE )
+            if( xQueueReceive( xJobMessageQueue, &pxJob, 0 ) == pdTRUE )
             {
-                /* Handler function to process Jobs message payload. */
-                prvNextJobHandler( pxJobMessagePublishInfo );
-                vPortFree( pxJobMessagePublishInfo->pTopicName );
-                vPortFree( pxJobMessagePublishInfo->pPayload );
-                vPortFree( pxJobMessagePublishInfo );
+                /* Handler function to process the job. */
+                prvNextJobHandler( pxJob );
+                vPortFree( pxJob );
             }
 
             if( xMqttStatus != MQTTSuccess )
@@ -1037,6 +1097,11 @@ void prvJobsDemoTask( void * pvParameters )
         }
     } while( retryDemoLoop == pdTRUE );
 
+    #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+        vSetPublishJournal( NULL );
+        vPublishJournal_Close( &xPublishJournal );
+    #endif
+
     if( ( xDemoEncounteredError == pdFALSE ) && ( xDemoStatus == pdPASS ) )
     {
         LogInfo( ( "Demo completed successfully." ) );
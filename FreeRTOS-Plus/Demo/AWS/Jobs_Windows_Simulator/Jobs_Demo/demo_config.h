@@ -229,4 +229,17 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigNETWORK_BUFFER_SIZE    ( 1024U )
 
+/**
+ * @brief Keep the publishes made by the demo in a journal until they are
+ * acknowledged, so those made before a reset are sent again on reconnection.
+ */
+#define democonfigUSE_PUBLISH_JOURNAL                  1
+
+/**
+ * @brief Path of the publish journal, and of the file used while compacting
+ * it.  Both must be on the same file system.
+ */
+#define democonfigPUBLISH_JOURNAL_PATH                 "jobs_publish_journal.bin"
+#define democonfigPUBLISH_JOURNAL_REWRITE_PATH         "jobs_publish_journal.tmp"
+
 #endif /* DEMO_CONFIG_H */
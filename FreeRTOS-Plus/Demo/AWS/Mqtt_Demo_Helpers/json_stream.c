@@ -0,0 +1,702 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file json_stream.c
+ * @brief Implements the incremental JSON tokenizer.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+#include "json_stream.h"
+
+/*-----------------------------------------------------------*/
+
+/* Tokenizer states. */
+#define jsonstreamSTATE_VALUE               ( 0U ) /* Expecting a value. */
+#define jsonstreamSTATE_FIRST_VALUE         ( 1U ) /* After '[', expecting a value or ']'. */
+#define jsonstreamSTATE_FIRST_KEY           ( 2U ) /* After '{', expecting a key or '}'. */
+#define jsonstreamSTATE_KEY                 ( 3U ) /* After ',' in an object, expecting a key. */
+#define jsonstreamSTATE_IN_KEY              ( 4U )
+#define jsonstreamSTATE_COLON               ( 5U )
+#define jsonstreamSTATE_IN_STRING           ( 6U )
+#define jsonstreamSTATE_IN_NUMBER           ( 7U )
+#define jsonstreamSTATE_IN_LITERAL          ( 8U )
+#define jsonstreamSTATE_AFTER_VALUE         ( 9U ) /* Expecting ',' or the end of the container. */
+#define jsonstreamSTATE_ERROR               ( 10U )
+
+/* Number states, following the JSON number grammar. */
+#define jsonstreamNUMBER_SIGN               ( 0U ) /* After '-'. */
+#define jsonstreamNUMBER_ZERO               ( 1U ) /* After a leading '0'. */
+#define jsonstreamNUMBER_INTEGER            ( 2U )
+#define jsonstreamNUMBER_POINT              ( 3U )
+#define jsonstreamNUMBER_FRACTION           ( 4U )
+#define jsonstreamNUMBER_EXPONENT           ( 5U ) /* After 'e' or 'E'. */
+#define jsonstreamNUMBER_EXPONENT_SIGN      ( 6U )
+#define jsonstreamNUMBER_EXPONENT_DIGITS    ( 7U )
+
+/* Escape states.  Values above jsonstreamESCAPE_BACKSLASH count the hex
+ * digits of a \u escape still expected, plus one. */
+#define jsonstreamESCAPE_NONE               ( 0U )
+#define jsonstreamESCAPE_BACKSLASH          ( 1U )
+#define jsonstreamESCAPE_UNICODE            ( 5U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Report an event for the current path.
+ */
+static void prvEmit( JsonStreamParser_t * pxParser,
+                     JsonStreamEventType_t eType,
+                     const char * pcValue,
+                     size_t xValueLength,
+                     BaseType_t xLastFragment );
+
+/**
+ * @brief Append text to the current path, or mark it truncated if it does not
+ * fit.
+ */
+static void prvAppendPath( JsonStreamParser_t * pxParser,
+                           const char * pcText,
+                           size_t xLength );
+
+/**
+ * @brief Set the current path to the member of the innermost array about to
+ * be parsed.
+ */
+static void prvSetElementPath( JsonStreamParser_t * pxParser );
+
+/**
+ * @brief Handle the first character of a value.
+ *
+ * @return The offset in the chunk at which the value's first fragment
+ * starts.
+ */
+static size_t prvBeginValue( JsonStreamParser_t * pxParser,
+                             char cChar,
+                             size_t xOffset );
+
+/**
+ * @brief Close the innermost object or array.
+ */
+static void prvEndContainer( JsonStreamParser_t * pxParser,
+                             char cChar );
+
+/**
+ * @brief Advance the number state machine.
+ *
+ * @return pdTRUE if the character continues the number.
+ */
+static BaseType_t prvNumberContinues( JsonStreamParser_t * pxParser,
+                                      char cChar );
+
+/**
+ * @brief Advance the escape state of a string or key.
+ *
+ * @return pdFALSE if the character is not allowed at this point.
+ */
+static BaseType_t prvStringCharacterValid( JsonStreamParser_t * pxParser,
+                                           char cChar );
+
+/*-----------------------------------------------------------*/
+
+static void prvEmit( JsonStreamParser_t * pxParser,
+                     JsonStreamEventType_t eType,
+                     const char * pcValue,
+                     size_t xValueLength,
+                     BaseType_t xLastFragment )
+{
+    JsonStreamEvent_t xEvent;
+
+    xEvent.eType = eType;
+    xEvent.pcPath = ( pxParser->xPathTruncated == pdFALSE ) ? pxParser->cPath : NULL;
+    xEvent.xPathLength = ( pxParser->xPathTruncated == pdFALSE ) ? pxParser->xPathLength : 0U;
+    xEvent.pcValue = pcValue;
+    xEvent.xValueLength = xValueLength;
+    xEvent.xFirstFragment = ( pxParser->xValueStarted == pdFALSE ) ? pdTRUE : pdFALSE;
+    xEvent.xLastFragment = xLastFragment;
+
+    pxParser->xValueStarted = ( xLastFragment == pdFALSE ) ? pdTRUE : pdFALSE;
+
+    pxParser->xCallback( pxParser->pvContext, &xEvent );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvAppendPath( JsonStreamParser_t * pxParser,
+                           const char * pcText,
+                           size_t xLength )
+{
+    if( pxParser->xPathTruncated == pdFALSE )
+    {
+        if( xLength > ( sizeof( pxParser->cPath ) - pxParser->xPathLength ) )
+        {
+            pxParser->xPathTruncated = pdTRUE;
+        }
+        else
+        {
+            ( void ) memcpy( &( pxParser->cPath[ pxParser->xPathLength ] ), pcText, xLength );
+            pxParser->xPathLength += xLength;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSetElementPath( JsonStreamParser_t * pxParser )
+{
+    char cIndex[ 12 ];
+    size_t xIndexStart = sizeof( cIndex );
+    uint32_t ulIndex = pxParser->ulIndex[ pxParser->uxDepth - 1U ];
+
+    /* Write "[n]" right aligned in cIndex. */
+    xIndexStart--;
+    cIndex[ xIndexStart ] = ']';
+
+    do
+    {
+        xIndexStart--;
+        cIndex[ xIndexStart ] = ( char ) ( '0' + ( ulIndex % 10U ) );
+        ulIndex /= 10U;
+    } while( ulIndex > 0U );
+
+    xIndexStart--;
+    cIndex[ xIndexStart ] = '[';
+
+    pxParser->xPathLength = pxParser->xBase[ pxParser->uxDepth - 1U ];
+    pxParser->xPathTruncated = pxParser->xBaseTruncated[ pxParser->uxDepth - 1U ];
+    prvAppendPath( pxParser, &( cIndex[ xIndexStart ] ), sizeof( cIndex ) - xIndexStart );
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvBeginValue( JsonStreamParser_t * pxParser,
+                             char cChar,
+                             size_t xOffset )
+{
+    size_t xFragmentStart = xOffset;
+
+    if( ( pxParser->uxDepth > 0U ) && ( pxParser->cContainer[ pxParser->uxDepth - 1U ] == '[' ) )
+    {
+        prvSetElementPath( pxParser );
+    }
+
+    switch( cChar )
+    {
+        case '{':
+        case '[':
+
+            if( pxParser->uxDepth == jsonstreamMAX_DEPTH )
+            {
+                pxParser->ucState = jsonstreamSTATE_ERROR;
+            }
+            else
+            {
+                prvEmit( pxParser,
+                         ( cChar == '{' ) ? eJsonStreamObjectStart : eJsonStreamArrayStart,
+                         NULL,
+                         0U,
+                         pdTRUE );
+
+                pxParser->cContainer[ pxParser->uxDepth ] = cChar;
+                pxParser->ulIndex[ pxParser->uxDepth ] = 0U;
+                pxParser->xBase[ pxParser->uxDepth ] = pxParser->xPathLength;
+                pxParser->xBaseTruncated[ pxParser->uxDepth ] = pxParser->xPathTruncated;
+                pxParser->uxDepth++;
+                pxParser->ucState = ( cChar == '{' ) ? jsonstreamSTATE_FIRST_KEY : jsonstreamSTATE_FIRST_VALUE;
+            }
+
+            break;
+
+        case '"':
+            pxParser->ucState = jsonstreamSTATE_IN_STRING;
+            pxParser->ucEscape = jsonstreamESCAPE_NONE;
+            xFragmentStart = xOffset + 1U;
+            break;
+
+        case 't':
+        case 'f':
+        case 'n':
+            pxParser->pcLiteral = ( cChar == 't' ) ? "true" : ( ( cChar == 'f' ) ? "false" : "null" );
+            pxParser->xLiteralIndex = 1U;
+            pxParser->ucState = jsonstreamSTATE_IN_LITERAL;
+            break;
+
+        default:
+            pxParser->ucState = jsonstreamSTATE_IN_NUMBER;
+            pxParser->ucNumberState = jsonstreamNUMBER_SIGN;
+
+            if( cChar == '0' )
+            {
+                pxParser->ucNumberState = jsonstreamNUMBER_ZERO;
+            }
+            else if( ( cChar >= '1' ) && ( cChar <= '9' ) )
+            {
+                pxParser->ucNumberState = jsonstreamNUMBER_INTEGER;
+            }
+            else if( cChar != '-' )
+            {
+                pxParser->ucState = jsonstreamSTATE_ERROR;
+            }
+
+            break;
+    }
+
+    return xFragmentStart;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvEndContainer( JsonStreamParser_t * pxParser,
+                             char cChar )
+{
+    char cOpening = ( cChar == '}' ) ? '{' : '[';
+
+    if( ( pxParser->uxDepth == 0U ) || ( pxParser->cContainer[ pxParser->uxDepth - 1U ] != cOpening ) )
+    {
+        pxParser->ucState = jsonstreamSTATE_ERROR;
+    }
+    else
+    {
+        pxParser->uxDepth--;
+        pxParser->xPathLength = pxParser->xBase[ pxParser->uxDepth ];
+        pxParser->xPathTruncated = pxParser->xBaseTruncated[ pxParser->uxDepth ];
+        prvEmit( pxParser,
+                 ( cChar == '}' ) ? eJsonStreamObjectEnd : eJsonStreamArrayEnd,
+                 NULL,
+                 0U,
+                 pdTRUE );
+        pxParser->ucState = jsonstreamSTATE_AFTER_VALUE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvNumberContinues( JsonStreamParser_t * pxParser,
+                                      char cChar )
+{
+    BaseType_t xDigit = ( ( cChar >= '0' ) && ( cChar <= '9' ) ) ? pdTRUE : pdFALSE;
+    uint8_t ucNext = pxParser->ucNumberState;
+    BaseType_t xContinues = pdTRUE;
+
+    switch( pxParser->ucNumberState )
+    {
+        case jsonstreamNUMBER_SIGN:
+            ucNext = ( cChar == '0' ) ? jsonstreamNUMBER_ZERO : jsonstreamNUMBER_INTEGER;
+            xContinues = xDigit;
+            break;
+
+        case jsonstreamNUMBER_ZERO:
+        case jsonstreamNUMBER_INTEGER:
+
+            if( ( xDigit == pdTRUE ) && ( pxParser->ucNumberState == jsonstreamNUMBER_INTEGER ) )
+            {
+                ucNext = jsonstreamNUMBER_INTEGER;
+            }
+            else if( cChar == '.' )
+            {
+                ucNext = jsonstreamNUMBER_POINT;
+            }
+            else if( ( cChar == 'e' ) || ( cChar == 'E' ) )
+            {
+                ucNext = jsonstreamNUMBER_EXPONENT;
+            }
+            else
+            {
+                xContinues = pdFALSE;
+            }
+
+            break;
+
+        case jsonstreamNUMBER_POINT:
+        case jsonstreamNUMBER_FRACTION:
+
+            if( xDigit == pdTRUE )
+            {
+                ucNext = jsonstreamNUMBER_FRACTION;
+            }
+            else if( ( ( cChar == 'e' ) || ( cChar == 'E' ) ) && ( pxParser->ucNumberState == jsonstreamNUMBER_FRACTION ) )
+            {
+                ucNext = jsonstreamNUMBER_EXPONENT;
+            }
+            else
+            {
+                xContinues = pdFALSE;
+            }
+
+            break;
+
+        case jsonstreamNUMBER_EXPONENT:
+
+            if( ( cChar == '+' ) || ( cChar == '-' ) )
+            {
+                ucNext = jsonstreamNUMBER_EXPONENT_SIGN;
+            }
+            else
+            {
+                ucNext = jsonstreamNUMBER_EXPONENT_DIGITS;
+                xContinues = xDigit;
+            }
+
+            break;
+
+        default:
+            ucNext = jsonstreamNUMBER_EXPONENT_DIGITS;
+            xContinues = xDigit;
+            break;
+    }
+
+    if( xContinues == pdTRUE )
+    {
+        pxParser->ucNumberState = ucNext;
+    }
+
+    return xContinues;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvStringCharacterValid( JsonStreamParser_t * pxParser,
+                                           char cChar )
+{
+    BaseType_t xValid = pdTRUE;
+
+    if( pxParser->ucEscape == jsonstreamESCAPE_BACKSLASH )
+    {
+        if( cChar == 'u' )
+        {
+            pxParser->ucEscape = jsonstreamESCAPE_UNICODE;
+        }
+        else
+        {
+            xValid = ( strchr( "\"\\/bfnrt", cChar ) != NULL ) ? pdTRUE : pdFALSE;
+            pxParser->ucEscape = jsonstreamESCAPE_NONE;
+        }
+    }
+    else if( pxParser->ucEscape > jsonstreamESCAPE_BACKSLASH )
+    {
+        xValid = ( ( ( cChar >= '0' ) && ( cChar <= '9' ) ) ||
+                   ( ( cChar >= 'a' ) && ( cChar <= 'f' ) ) ||
+                   ( ( cChar >= 'A' ) && ( cChar <= 'F' ) ) ) ? pdTRUE : pdFALSE;
+        pxParser->ucEscape--;
+
+        if( pxParser->ucEscape == jsonstreamESCAPE_BACKSLASH )
+        {
+            pxParser->ucEscape = jsonstreamESCAPE_NONE;
+        }
+    }
+    else if( cChar == '\\' )
+    {
+        pxParser->ucEscape = jsonstreamESCAPE_BACKSLASH;
+    }
+    else if( ( ( unsigned char ) cChar ) < 0x20U )
+    {
+        /* Control characters must be escaped. */
+        xValid = pdFALSE;
+    }
+    else
+    {
+        /* Any other character, including UTF-8 sequences, is taken as is. */
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+void vJsonStream_Init( JsonStreamParser_t * pxParser,
+                       JsonStreamCallback_t xCallback,
+                       void * pvContext )
+{
+    configASSERT( ( pxParser != NULL ) && ( xCallback != NULL ) );
+
+    ( void ) memset( pxParser, 0x00, sizeof( JsonStreamParser_t ) );
+    pxParser->xCallback = xCallback;
+    pxParser->pvContext = pvContext;
+    pxParser->ucState = jsonstreamSTATE_VALUE;
+    pxParser->xValueStarted = pdFALSE;
+    pxParser->xPathTruncated = pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xJsonStream_Feed( JsonStreamParser_t * pxParser,
+                             const char * pcData,
+                             size_t xLength )
+{
+    size_t xOffset = 0U;
+    size_t xFragmentStart = 0U;
+    char cChar;
+
+    configASSERT( pxParser != NULL );
+    configASSERT( ( pcData != NULL ) || ( xLength == 0U ) );
+
+    while( ( xOffset < xLength ) && ( pxParser->ucState != jsonstreamSTATE_ERROR ) )
+    {
+        cChar = pcData[ xOffset ];
+
+        switch( pxParser->ucState )
+        {
+            case jsonstreamSTATE_IN_STRING:
+
+                if( ( cChar == '"' ) && ( pxParser->ucEscape == jsonstreamESCAPE_NONE ) )
+                {
+                    prvEmit( pxParser, eJsonStreamString, &( pcData[ xFragmentStart ] ), xOffset - xFragmentStart, pdTRUE );
+                    pxParser->ucState = jsonstreamSTATE_AFTER_VALUE;
+                }
+                else if( prvStringCharacterValid( pxParser, cChar ) == pdFALSE )
+                {
+                    pxParser->ucState = jsonstreamSTATE_ERROR;
+                }
+                else
+                {
+                    /* Part of the string. */
+                }
+
+                xOffset++;
+                break;
+
+            case jsonstreamSTATE_IN_KEY:
+
+                if( ( cChar == '"' ) && ( pxParser->ucEscape == jsonstreamESCAPE_NONE ) )
+                {
+                    pxParser->ucState = jsonstreamSTATE_COLON;
+                }
+                else if( prvStringCharacterValid( pxParser, cChar ) == pdFALSE )
+                {
+                    pxParser->ucState = jsonstreamSTATE_ERROR;
+                }
+                else
+                {
+                    prvAppendPath( pxParser, &cChar, 1U );
+                }
+
+                xOffset++;
+                break;
+
+            case jsonstreamSTATE_IN_NUMBER:
+
+                if( prvNumberContinues( pxParser, cChar ) == pdTRUE )
+                {
+                    xOffset++;
+                }
+                else if( ( pxParser->ucNumberState == jsonstreamNUMBER_ZERO ) ||
+                         ( pxParser->ucNumberState == jsonstreamNUMBER_INTEGER ) ||
+                         ( pxParser->ucNumberState == jsonstreamNUMBER_FRACTION ) ||
+                         ( pxParser->ucNumberState == jsonstreamNUMBER_EXPONENT_DIGITS ) )
+                {
+                    /* The character ends the number and is parsed again in the
+                     * next state. */
+                    prvEmit( pxParser, eJsonStreamNumber, &( pcData[ xFragmentStart ] ), xOffset - xFragmentStart, pdTRUE );
+                    pxParser->ucState = jsonstreamSTATE_AFTER_VALUE;
+                }
+                else
+                {
+                    pxParser->ucState = jsonstreamSTATE_ERROR;
+                }
+
+                break;
+
+            case jsonstreamSTATE_IN_LITERAL:
+
+                if( cChar != pxParser->pcLiteral[ pxParser->xLiteralIndex ] )
+                {
+                    pxParser->ucState = jsonstreamSTATE_ERROR;
+                }
+                else
+                {
+                    pxParser->xLiteralIndex++;
+
+                    if( pxParser->pcLiteral[ pxParser->xLiteralIndex ] == '\0' )
+                    {
+                        prvEmit( pxParser, eJsonStreamLiteral, pxParser->pcLiteral, pxParser->xLiteralIndex, pdTRUE );
+                        pxParser->ucState = jsonstreamSTATE_AFTER_VALUE;
+                    }
+                }
+
+                xOffset++;
+                break;
+
+            default:
+
+                if( ( cChar == ' ' ) || ( cChar == '\t' ) || ( cChar == '\r' ) || ( cChar == '\n' ) )
+                {
+                    /* Whitespace between tokens. */
+                }
+                else if( ( pxParser->ucState == jsonstreamSTATE_VALUE ) ||
+                         ( ( pxParser->ucState == jsonstreamSTATE_FIRST_VALUE ) && ( cChar != ']' ) ) )
+                {
+                    xFragmentStart = prvBeginValue( pxParser, cChar, xOffset );
+                }
+                else if( ( pxParser->ucState == jsonstreamSTATE_FIRST_VALUE ) ||
+                         ( ( pxParser->ucState == jsonstreamSTATE_FIRST_KEY ) && ( cChar == '}' ) ) )
+                {
+                    prvEndContainer( pxParser, cChar );
+                }
+                else if( ( ( pxParser->ucState == jsonstreamSTATE_FIRST_KEY ) || ( pxParser->ucState == jsonstreamSTATE_KEY ) ) &&
+                         ( cChar == '"' ) )
+                {
+                    pxParser->xPathLength = pxParser->xBase[ pxParser->uxDepth - 1U ];
+                    pxParser->xPathTruncated = pxParser->xBaseTruncated[ pxParser->uxDepth - 1U ];
+
+                    if( pxParser->xPathLength > 0U )
+                    {
+                        prvAppendPath( pxParser, ".", 1U );
+                    }
+
+                    pxParser->ucState = jsonstreamSTATE_IN_KEY;
+                    pxParser->ucEscape = jsonstreamESCAPE_NONE;
+                }
+                else if( ( pxParser->ucState == jsonstreamSTATE_COLON ) && ( cChar == ':' ) )
+                {
+                    pxParser->ucState = jsonstreamSTATE_VALUE;
+                }
+                else if( ( pxParser->ucState == jsonstreamSTATE_AFTER_VALUE ) && ( pxParser->uxDepth > 0U ) && ( cChar == ',' ) )
+                {
+                    if( pxParser->cContainer[ pxParser->uxDepth - 1U ] == '[' )
+                    {
+                        pxParser->ulIndex[ pxParser->uxDepth - 1U ]++;
+                        pxParser->ucState = jsonstreamSTATE_VALUE;
+                    }
+                    else
+                    {
+                        pxParser->ucState = jsonstreamSTATE_KEY;
+                    }
+                }
+                else if( ( pxParser->ucState == jsonstreamSTATE_AFTER_VALUE ) && ( ( cChar == '}' ) || ( cChar == ']' ) ) )
+                {
+                    prvEndContainer( pxParser, cChar );
+                }
+                else
+                {
+                    pxParser->ucState = jsonstreamSTATE_ERROR;
+                }
+
+                xOffset++;
+                break;
+        }
+    }
+
+    /* Report what the chunk holds of a string or number that continues in the
+     * next one. */
+    if( ( pxParser->ucState == jsonstreamSTATE_IN_STRING ) || ( pxParser->ucState == jsonstreamSTATE_IN_NUMBER ) )
+    {
+        if( xLength > xFragmentStart )
+        {
+            prvEmit( pxParser,
+                     ( pxParser->ucState == jsonstreamSTATE_IN_STRING ) ? eJsonStreamString : eJsonStreamNumber,
+                     &( pcData[ xFragmentStart ] ),
+                     xLength - xFragmentStart,
+                     pdFALSE );
+        }
+    }
+
+    return ( pxParser->ucState != jsonstreamSTATE_ERROR ) ? pdPASS : pdFAIL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xJsonStream_Finish( JsonStreamParser_t * pxParser )
+{
+    configASSERT( pxParser != NULL );
+
+    /* A top level number only ends with the document. */
+    if( ( pxParser->ucState == jsonstreamSTATE_IN_NUMBER ) && ( pxParser->uxDepth == 0U ) &&
+        ( ( pxParser->ucNumberState == jsonstreamNUMBER_ZERO ) ||
+          ( pxParser->ucNumberState == jsonstreamNUMBER_INTEGER ) ||
+          ( pxParser->ucNumberState == jsonstreamNUMBER_FRACTION ) ||
+          ( pxParser->ucNumberState == jsonstreamNUMBER_EXPONENT_DIGITS ) ) )
+    {
+        prvEmit( pxParser, eJsonStreamNumber, "", 0U, pdTRUE );
+        pxParser->ucState = jsonstreamSTATE_AFTER_VALUE;
+    }
+
+    return ( ( pxParser->ucState == jsonstreamSTATE_AFTER_VALUE ) && ( pxParser->uxDepth == 0U ) ) ? pdPASS : pdFAIL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xJsonStream_Parse( const char * pcData,
+                              size_t xLength,
+                              JsonStreamCallback_t xCallback,
+                              void * pvContext )
+{
+    JsonStreamParser_t xParser;
+    BaseType_t xResult;
+
+    vJsonStream_Init( &xParser, xCallback, pvContext );
+    xResult = xJsonStream_Feed( &xParser, pcData, xLength );
+
+    if( xResult == pdPASS )
+    {
+        xResult = xJsonStream_Finish( &xParser );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xJsonStream_PathIs( const JsonStreamEvent_t * pxEvent,
+                               const char * pcPath,
+                               size_t xPathLength )
+{
+    configASSERT( ( pxEvent != NULL ) && ( pcPath != NULL ) );
+
+    return ( ( pxEvent->pcPath != NULL ) &&
+             ( pxEvent->xPathLength == xPathLength ) &&
+             ( memcmp( pxEvent->pcPath, pcPath, xPathLength ) == 0 ) ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xJsonStream_CopyValue( const JsonStreamEvent_t * pxEvent,
+                                  char * pcBuffer,
+                                  size_t xBufferSize,
+                                  size_t * pxLength )
+{
+    BaseType_t xResult = pdFAIL;
+
+    configASSERT( ( pxEvent != NULL ) && ( pcBuffer != NULL ) && ( pxLength != NULL ) );
+
+    if( pxEvent->xFirstFragment == pdTRUE )
+    {
+        *pxLength = 0U;
+    }
+
+    if( ( pxEvent->pcValue != NULL ) && ( pxEvent->xValueLength <= ( xBufferSize - *pxLength ) ) )
+    {
+        ( void ) memcpy( &( pcBuffer[ *pxLength ] ), pxEvent->pcValue, pxEvent->xValueLength );
+        *pxLength += pxEvent->xValueLength;
+        xResult = pdPASS;
+    }
+
+    return xResult;
+}
@@ -0,0 +1,208 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file json_stream.h
+ * @brief Incremental, SAX-style JSON tokenizer.
+ *
+ * A document is fed in chunks of any size with xJsonStream_Feed().  Every
+ * value is reported to a callback together with its path, written the way
+ * coreJSON queries are, for example "execution.jobDocument.action" or
+ * "items[2]".  Strings and numbers are not copied: they are reported as one
+ * or more fragments pointing into the chunk being parsed, so a value split
+ * across chunks arrives in several pieces.  Only the path of the current
+ * value is kept, which bounds the RAM needed regardless of document size.
+ *
+ * Strings are reported as they appear in the document, without the quotes
+ * and with escape sequences left in place, as JSON_Search() does.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/**
+ * @brief Maximum nesting of objects and arrays.  Deeper documents are
+ * rejected.
+ */
+#ifndef jsonstreamMAX_DEPTH
+    #define jsonstreamMAX_DEPTH          ( 8U )
+#endif
+
+/**
+ * @brief Size of the buffer holding the path of the current value.  Values
+ * whose path does not fit are still parsed, but reported without a path.
+ */
+#ifndef jsonstreamMAX_PATH_LENGTH
+    #define jsonstreamMAX_PATH_LENGTH    ( 64U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Kinds of event reported by the tokenizer.
+ */
+typedef enum JsonStreamEventType
+{
+    eJsonStreamObjectStart, /**< @brief '{' of an object. */
+    eJsonStreamObjectEnd,   /**< @brief '}' of an object. */
+    eJsonStreamArrayStart,  /**< @brief '[' of an array. */
+    eJsonStreamArrayEnd,    /**< @brief ']' of an array. */
+    eJsonStreamString,      /**< @brief A fragment of a string value. */
+    eJsonStreamNumber,      /**< @brief A fragment of a number. */
+    eJsonStreamLiteral      /**< @brief true, false or null, never fragmented. */
+} JsonStreamEventType_t;
+
+/**
+ * @brief An event reported by the tokenizer.  Only valid during the callback.
+ */
+typedef struct JsonStreamEvent
+{
+    JsonStreamEventType_t eType;
+    const char * pcPath;        /**< @brief Path of the value, not NUL terminated.  NULL if it did not fit. */
+    size_t xPathLength;         /**< @brief Length of pcPath.  0 for the top level value. */
+    const char * pcValue;       /**< @brief The fragment of a string, number or literal.  NULL otherwise. */
+    size_t xValueLength;        /**< @brief Length of pcValue, which may be 0 for a fragment. */
+    BaseType_t xFirstFragment;  /**< @brief pdTRUE on the first fragment of a value. */
+    BaseType_t xLastFragment;   /**< @brief pdTRUE on the last fragment of a value. */
+} JsonStreamEvent_t;
+
+/**
+ * @brief Called for each event.
+ *
+ * @param[in] pvContext The context passed to vJsonStream_Init().
+ * @param[in] pxEvent The event.
+ */
+typedef void ( * JsonStreamCallback_t )( void * pvContext,
+                                         const JsonStreamEvent_t * pxEvent );
+
+/**
+ * @brief A tokenizer.  The members are private to json_stream.c.
+ */
+typedef struct JsonStreamParser
+{
+    JsonStreamCallback_t xCallback;
+    void * pvContext;
+    uint8_t ucState;
+    uint8_t ucNumberState;
+    uint8_t ucEscape;
+    const char * pcLiteral;
+    size_t xLiteralIndex;
+    BaseType_t xValueStarted;
+    UBaseType_t uxDepth;
+    char cContainer[ jsonstreamMAX_DEPTH ];
+    uint32_t ulIndex[ jsonstreamMAX_DEPTH ];
+    size_t xBase[ jsonstreamMAX_DEPTH ];
+    BaseType_t xBaseTruncated[ jsonstreamMAX_DEPTH ];
+    char cPath[ jsonstreamMAX_PATH_LENGTH ];
+    size_t xPathLength;
+    BaseType_t xPathTruncated;
+} JsonStreamParser_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Prepare a tokenizer for a new document.
+ *
+ * @param[out] pxParser The tokenizer.
+ * @param[in] xCallback Called for each event.
+ * @param[in] pvContext Passed to xCallback.
+ */
+void vJsonStream_Init( JsonStreamParser_t * pxParser,
+                       JsonStreamCallback_t xCallback,
+                       void * pvContext );
+
+/**
+ * @brief Parse the next chunk of a document.
+ *
+ * @param[in] pxParser The tokenizer.
+ * @param[in] pcData The chunk.  Only needs to remain valid during the call.
+ * @param[in] xLength Length of the chunk.
+ *
+ * @return pdPASS if the chunk is valid so far, pdFAIL if the document is
+ * malformed or nested too deeply.  The tokenizer must be initialized again
+ * after a failure.
+ */
+BaseType_t xJsonStream_Feed( JsonStreamParser_t * pxParser,
+                             const char * pcData,
+                             size_t xLength );
+
+/**
+ * @brief Signal the end of the document.
+ *
+ * @param[in] pxParser The tokenizer.
+ *
+ * @return pdPASS if exactly one complete value was parsed, otherwise pdFAIL.
+ */
+BaseType_t xJsonStream_Finish( JsonStreamParser_t * pxParser );
+
+/**
+ * @brief Parse a document held in one buffer, as received in an MQTT publish.
+ *
+ * @return pdPASS if the document is valid, otherwise pdFAIL.
+ */
+BaseType_t xJsonStream_Parse( const char * pcData,
+                              size_t xLength,
+                              JsonStreamCallback_t xCallback,
+                              void * pvContext );
+
+/**
+ * @brief Check whether an event is for the value at a path.
+ *
+ * @param[in] pxEvent The event.
+ * @param[in] pcPath The path, in the form used by JSON_Search().
+ * @param[in] xPathLength Length of pcPath.
+ *
+ * @return pdTRUE if the event's path is pcPath, otherwise pdFALSE.
+ */
+BaseType_t xJsonStream_PathIs( const JsonStreamEvent_t * pxEvent,
+                               const char * pcPath,
+                               size_t xPathLength );
+
+/**
+ * @brief Append a string or number fragment to a buffer, so that a value
+ * split across chunks can be reassembled.
+ *
+ * @param[in] pxEvent A string, number or literal event.
+ * @param[in,out] pcBuffer The buffer.
+ * @param[in] xBufferSize Size of pcBuffer.
+ * @param[in,out] pxLength Bytes already in pcBuffer.  Reset to 0 on the first
+ * fragment of a value.
+ *
+ * @return pdPASS if the fragment fit, otherwise pdFAIL.
+ */
+BaseType_t xJsonStream_CopyValue( const JsonStreamEvent_t * pxEvent,
+                                  char * pcBuffer,
+                                  size_t xBufferSize,
+                                  size_t * pxLength );
+
+#endif /* JSON_STREAM_H */
@@ -59,6 +59,15 @@
 /* Demo specific config. */
 #include "demo_config.h"
 
+/**
+ * @brief Set to 1 in demo_config.h to keep QoS1 publishes in a publish journal
+ * set with vSetPublishJournal().  mqtt_publish_journal.c must then be built,
+ * as the Jobs demo does.
+ */
+#ifndef democonfigUSE_PUBLISH_JOURNAL
+    #define democonfigUSE_PUBLISH_JOURNAL    0
+#endif
+
 /*------------- Demo configurations -------------------------*/
 
 /**
@@ -200,6 +209,19 @@ typedef struct PublishPackets
     MQTTPublishInfo_t pubInfo;
 } PublishPackets_t;
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+
+/**
+ * @brief Context passed to #prvResendJournaledPublish while replaying the
+ * publish journal.
+ */
+    typedef struct JournalReplayContext
+    {
+        MQTTContext_t * pxMqttContext;
+        BaseType_t xOutOfRecords; /**< @brief Set when the replay stopped for want of an outgoing publish record. */
+    } JournalReplayContext_t;
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -267,6 +289,21 @@ static MQTTPubAckInfo_t pOutgoingPublishRecords[ mqttexampleOUTGOING_PUBLISH_REC
  */
 static MQTTPubAckInfo_t pIncomingPublishRecords[ mqttexampleINCOMING_PUBLISH_RECORD_LEN ];
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+
+/**
+ * @brief The journal QoS1 publishes are written to before they are sent, or
+ * NULL if none was set.
+ */
+    static PublishJournal_t * pxPublishJournal = NULL;
+
+/**
+ * @brief Buffer the topic and payload of journaled publishes are read into
+ * when they are resent.
+ */
+    static uint8_t ucJournalReplayBuffer[ publishjournalMAX_PUBLISH_LENGTH ];
+#endif
+
 
 /*-----------------------------------------------------------*/
 
@@ -342,6 +379,28 @@ static void vCleanupOutgoingPublishWithPacketID( uint16_t usPacketId );
  */
 static BaseType_t xHandlePublishResend( MQTTContext_t * pxMqttContext );
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+
+/**
+ * @brief Send a publish read back from the journal.  Publishes the resumed
+ * session already knows keep their packet identifier and are sent as
+ * duplicates, unless #xHandlePublishResend already resent them.  Other
+ * publishes are only sent while an outgoing publish record is free for them,
+ * beyond those kept for xPublishToTopic().
+ *
+ * Implements #PublishJournalReplayCallback_t.
+ */
+    static BaseType_t prvResendJournaledPublish( void * pvContext,
+                                                 MQTTPublishInfo_t * pxPublishInfo,
+                                                 uint16_t usPreviousPacketId,
+                                                 uint16_t * pusPacketId );
+
+/**
+ * @brief Count the outgoing publish records coreMQTT is not using.
+ */
+    static UBaseType_t prvGetFreeOutgoingPublishRecordCount( void );
+#endif /* if ( democonfigUSE_PUBLISH_JOURNAL == 1 ) */
+
 /**
  * @brief The timer query function provided to the MQTT context.
  *
@@ -615,6 +674,36 @@ void vHandleOtherIncomingPacket( MQTTPacketInfo_t * pxPacketInfo,
                        usPacketIdentifier ) );
             /* Cleanup publish packet when a PUBACK is received. */
             vCleanupOutgoingPublishWithPacketID( usPacketIdentifier );
+
+            #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                if( pxPublishJournal != NULL )
+                {
+                    ( void ) xPublishJournal_Acknowledge( pxPublishJournal,
+                                                          usPacketIdentifier,
+                                                          MQTT_PACKET_TYPE_PUBACK );
+                }
+            #endif
+            break;
+
+        case MQTT_PACKET_TYPE_PUBREC:
+            /* The library answers with a PUBREL.  The QoS2 publish is not
+             * delivered until the PUBCOMP arrives. */
+            LogInfo( ( "PUBREC received for packet id %u.\n\n",
+                       usPacketIdentifier ) );
+            break;
+
+        case MQTT_PACKET_TYPE_PUBCOMP:
+            LogInfo( ( "PUBCOMP received for packet id %u.\n\n",
+                       usPacketIdentifier ) );
+
+            #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                if( pxPublishJournal != NULL )
+                {
+                    ( void ) xPublishJournal_Acknowledge( pxPublishJournal,
+                                                          usPacketIdentifier,
+                                                          MQTT_PACKET_TYPE_PUBCOMP );
+                }
+            #endif
             break;
 
         /* Any other packet type is invalid. */
@@ -671,6 +760,124 @@ static BaseType_t xHandlePublishResend( MQTTContext_t * pxMqttContext )
 
 /*-----------------------------------------------------------*/
 
+#if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+
+    static BaseType_t prvResendJournaledPublish( void * pvContext,
+                                                 MQTTPublishInfo_t * pxPublishInfo,
+                                                 uint16_t usPreviousPacketId,
+                                                 uint16_t * pusPacketId )
+    {
+        JournalReplayContext_t * pxReplay = ( JournalReplayContext_t * ) pvContext;
+        BaseType_t xReturnStatus = pdPASS;
+        BaseType_t xSend = pdTRUE;
+        MQTTStatus_t xMQTTStatus;
+        uint8_t ucIndex;
+
+        if( usPreviousPacketId != MQTT_PACKET_ID_INVALID )
+        {
+            /* Packet identifiers are only kept when the session was resumed,
+             * and the session still holds a record for this publish. */
+            *pusPacketId = usPreviousPacketId;
+            pxPublishInfo->dup = true;
+
+            for( ucIndex = 0U; ucIndex < MAX_OUTGOING_PUBLISHES; ucIndex++ )
+            {
+                if( outgoingPublishPackets[ ucIndex ].packetId == usPreviousPacketId )
+                {
+                    xSend = pdFALSE;
+                }
+            }
+        }
+        else if( prvGetFreeOutgoingPublishRecordCount() <= MAX_OUTGOING_PUBLISHES )
+        {
+            /* MQTT_Publish() would fail with MQTTNoMemory.  The replay carries
+             * on from here once acknowledgments free some records. */
+            pxReplay->xOutOfRecords = pdTRUE;
+            xSend = pdFALSE;
+            xReturnStatus = pdFAIL;
+        }
+        else
+        {
+            *pusPacketId = MQTT_GetPacketId( pxReplay->pxMqttContext );
+        }
+
+        if( xSend == pdTRUE )
+        {
+            xMQTTStatus = MQTT_Publish( pxReplay->pxMqttContext, pxPublishInfo, *pusPacketId );
+
+            if( xMQTTStatus != MQTTSuccess )
+            {
+                LogError( ( "Resending journaled PUBLISH failed with status %s.",
+                            MQTT_Status_strerror( xMQTTStatus ) ) );
+                xReturnStatus = pdFAIL;
+            }
+            else
+            {
+                LogInfo( ( "Resent journaled PUBLISH with packet id %u.", *pusPacketId ) );
+            }
+        }
+
+        return xReturnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static UBaseType_t prvGetFreeOutgoingPublishRecordCount( void )
+    {
+        UBaseType_t uxFree = 0U;
+        uint8_t ucIndex;
+
+        for( ucIndex = 0U; ucIndex < mqttexampleOUTGOING_PUBLISH_RECORD_LEN; ucIndex++ )
+        {
+            if( pOutgoingPublishRecords[ ucIndex ].packetId == MQTT_PACKET_ID_INVALID )
+            {
+                uxFree++;
+            }
+        }
+
+        return uxFree;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void vResendJournaledPublishes( MQTTContext_t * pxMqttContext )
+    {
+        JournalReplayContext_t xReplay;
+
+        if( pxPublishJournal != NULL )
+        {
+            xReplay.pxMqttContext = pxMqttContext;
+            xReplay.xOutOfRecords = pdFALSE;
+
+            if( xPublishJournal_Replay( pxPublishJournal,
+                                        prvResendJournaledPublish,
+                                        &xReplay,
+                                        ucJournalReplayBuffer ) != pdPASS )
+            {
+                if( xReplay.xOutOfRecords == pdTRUE )
+                {
+                    LogDebug( ( "Journal replay waits for free outgoing publish records." ) );
+                }
+                else
+                {
+                    /* The rest are tried again by the next call. */
+                    LogWarn( ( "Not every journaled publish could be resent." ) );
+                }
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    void vSetPublishJournal( PublishJournal_t * pxJournal )
+    {
+        pxPublishJournal = pxJournal;
+    }
+
+#endif /* if ( democonfigUSE_PUBLISH_JOURNAL == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 BaseType_t xEstablishMqttSession( MQTTContext_t * pxMqttContext,
                                   NetworkContext_t * pxNetworkContext,
                                   MQTTFixedBuffer_t * pxNetworkBuffer,
@@ -745,6 +952,15 @@ BaseType_t xEstablishMqttSession( MQTTContext_t * pxMqttContext,
                  * gets disconnected. */
                 xConnectInfo.cleanSession = true;
 
+                #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                    /* Journaled publishes are only resent as duplicates of the
+                     * ones the broker has seen if it resumes the session. */
+                    if( pxPublishJournal != NULL )
+                    {
+                        xConnectInfo.cleanSession = false;
+                    }
+                #endif
+
                 /* The client identifier is used to uniquely identify this MQTT client to
                  * the MQTT broker. In a production device the identifier can be something
                  * unique, such as a device serial number. */
@@ -797,7 +1013,7 @@ BaseType_t xEstablishMqttSession( MQTTContext_t * pxMqttContext,
             }
         }
 
-        if( xReturnStatus == pdFAIL )
+        if( xReturnStatus == pdPASS )
         {
             /* Keep a flag for indicating if MQTT session is established. This
              * flag will mark that an MQTT DISCONNECT has to be sent at the end
@@ -805,7 +1021,7 @@ BaseType_t xEstablishMqttSession( MQTTContext_t * pxMqttContext,
             xMqttSessionEstablished = true;
         }
 
-        if( xReturnStatus == pdFAIL )
+        if( xReturnStatus == pdPASS )
         {
             /* Check if session is present and if there are any outgoing publishes
              * that need to resend. This is only valid if the broker is
@@ -827,6 +1043,17 @@ BaseType_t xEstablishMqttSession( MQTTContext_t * pxMqttContext,
                  * connection doesn't re-establish an existing session. */
                 vCleanupOutgoingPublishes();
             }
+
+            #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                if( ( xReturnStatus == pdPASS ) && ( pxPublishJournal != NULL ) )
+                {
+                    vPublishJournal_StartConnection( pxPublishJournal, sessionPresent );
+
+                    LogInfo( ( "Replaying %u journaled publishes.",
+                               ( unsigned ) uxPublishJournal_GetCount( pxPublishJournal ) ) );
+                    vResendJournaledPublishes( pxMqttContext );
+                }
+            #endif
         }
     }
 
@@ -844,6 +1071,14 @@ BaseType_t xDisconnectMqttSession( MQTTContext_t * pxMqttContext,
     configASSERT( pxMqttContext != NULL );
     configASSERT( pxNetworkContext != NULL );
 
+    #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+        if( pxPublishJournal != NULL )
+        {
+            /* Record the acknowledgments received so far. */
+            ( void ) xPublishJournal_Flush( pxPublishJournal );
+        }
+    #endif
+
     if( xMqttSessionEstablished == true )
     {
         /* Send DISCONNECT. */
@@ -995,6 +1230,10 @@ BaseType_t xPublishToTopic( MQTTContext_t * pxMqttContext,
     MQTTStatus_t xMQTTStatus = MQTTSuccess;
     uint8_t ucPublishIndex = MAX_OUTGOING_PUBLISHES;
 
+    #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+        uint32_t ulJournalSequence = 0U;
+    #endif
+
     configASSERT( pxMqttContext != NULL );
     configASSERT( pcTopicFilter != NULL );
     configASSERT( topicFilterLength > 0 );
@@ -1022,39 +1261,73 @@ BaseType_t xPublishToTopic( MQTTContext_t * pxMqttContext,
         /* Get a new packet id. */
         outgoingPublishPackets[ ucPublishIndex ].packetId = MQTT_GetPacketId( pxMqttContext );
 
-        /* Send PUBLISH packet. */
-        xMQTTStatus = MQTT_Publish( pxMqttContext,
-                                    &outgoingPublishPackets[ ucPublishIndex ].pubInfo,
-                                    outgoingPublishPackets[ ucPublishIndex ].packetId );
+        #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+            if( pxPublishJournal != NULL )
+            {
+                /* Journal the publish before sending it, so it is resent even
+                 * if the device resets before the PUBACK arrives. */
+                xReturnStatus = xPublishJournal_Append( pxPublishJournal,
+                                                        &outgoingPublishPackets[ ucPublishIndex ].pubInfo,
+                                                        &ulJournalSequence );
 
-        if( xMQTTStatus != MQTTSuccess )
-        {
-            LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
-                        MQTT_Status_strerror( xMQTTStatus ) ) );
-            vCleanupOutgoingPublishAt( ucPublishIndex );
-            xReturnStatus = pdFAIL;
-        }
-        else
+                if( xReturnStatus == pdPASS )
+                {
+                    vPublishJournal_SetPacketId( pxPublishJournal,
+                                                 ulJournalSequence,
+                                                 outgoingPublishPackets[ ucPublishIndex ].packetId );
+                }
+                else
+                {
+                    vCleanupOutgoingPublishAt( ucPublishIndex );
+                }
+            }
+        #endif /* if ( democonfigUSE_PUBLISH_JOURNAL == 1 ) */
+
+        if( xReturnStatus == pdPASS )
         {
-            LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.\n\n",
-                       topicFilterLength,
-                       pcTopicFilter,
-                       outgoingPublishPackets[ ucPublishIndex ].packetId ) );
-
-            /* Calling MQTT_ProcessLoop to process incoming publish echo, since
-             * application subscribed to the same topic the broker will send
-             * publish message back to the application. This function also
-             * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
-             * has expired since the last MQTT packet sent and receive
-             * ping responses. */
-            xMQTTStatus = prvProcessLoopWithTimeout( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+            /* Send PUBLISH packet. */
+            xMQTTStatus = MQTT_Publish( pxMqttContext,
+                                        &outgoingPublishPackets[ ucPublishIndex ].pubInfo,
+                                        outgoingPublishPackets[ ucPublishIndex ].packetId );
 
             if( xMQTTStatus != MQTTSuccess )
             {
-                LogError( ( "MQTT_ProcessLoop returned with status = %s.",
+                LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
                             MQTT_Status_strerror( xMQTTStatus ) ) );
+                vCleanupOutgoingPublishAt( ucPublishIndex );
                 xReturnStatus = pdFAIL;
             }
+            else
+            {
+                LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.\n\n",
+                           topicFilterLength,
+                           pcTopicFilter,
+                           outgoingPublishPackets[ ucPublishIndex ].packetId ) );
+
+                /* Calling MQTT_ProcessLoop to process incoming publish echo, since
+                 * application subscribed to the same topic the broker will send
+                 * publish message back to the application. This function also
+                 * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
+                 * has expired since the last MQTT packet sent and receive
+                 * ping responses. */
+                xMQTTStatus = prvProcessLoopWithTimeout( pxMqttContext, mqttexamplePROCESS_LOOP_TIMEOUT_MS );
+
+                if( xMQTTStatus != MQTTSuccess )
+                {
+                    LogError( ( "MQTT_ProcessLoop returned with status = %s.",
+                                MQTT_Status_strerror( xMQTTStatus ) ) );
+                    xReturnStatus = pdFAIL;
+                }
+
+                #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+                    else
+                    {
+                        /* Acknowledgments may have freed records for publishes
+                         * still waiting in the journal. */
+                        vResendJournaledPublishes( pxMqttContext );
+                    }
+                #endif
+            }
         }
     }
 
@@ -1080,6 +1353,10 @@ BaseType_t xProcessLoop( MQTTContext_t * pxMqttContext,
     {
         LogDebug( ( "MQTT_ProcessLoop successful." ) );
         xReturnStatus = pdPASS;
+
+        #if ( democonfigUSE_PUBLISH_JOURNAL == 1 )
+            vResendJournaledPublishes( pxMqttContext );
+        #endif
     }
 
     return xReturnStatus;
@@ -33,6 +33,9 @@
 /* Transport interface implementation include header for TLS. */
 #include "transport_mbedtls.h"
 
+/* Outgoing publish journal. */
+#include "mqtt_publish_journal.h"
+
 /**
  * @brief Establish a MQTT connection.
  *
@@ -134,4 +137,38 @@ BaseType_t xPublishToTopic( MQTTContext_t * pxMqttContext,
 BaseType_t xProcessLoop( MQTTContext_t * pxMqttContext,
                          uint32_t ulTimeoutMs );
 
+/**
+ * @brief Keep QoS1 publishes made with xPublishToTopic() in a journal until
+ * they are acknowledged.
+ *
+ * Each publish is appended to the journal before it is sent.  When
+ * xEstablishMqttSession() connects, the publishes still in the journal are
+ * sent again, including those made before a reset.  QoS2 publishes leave the
+ * journal on PUBCOMP.  While a journal is set, xEstablishMqttSession() connects
+ * without a clean session, so that a resumed session resends them as
+ * duplicates.
+ *
+ * @note Only available when democonfigUSE_PUBLISH_JOURNAL is set to 1 in
+ * demo_config.h.
+ *
+ * @param[in] pxJournal A journal opened with xPublishJournal_Open(), or NULL
+ * to stop journaling.
+ */
+void vSetPublishJournal( PublishJournal_t * pxJournal );
+
+/**
+ * @brief Send the journaled publishes not yet sent on this connection, for as
+ * long as coreMQTT has outgoing publish records free for them.
+ *
+ * xEstablishMqttSession(), xPublishToTopic() and xProcessLoop() call this.
+ * Demos that call MQTT_ProcessLoop() directly should call it afterwards, so
+ * the rest of the journal is sent as acknowledgments arrive.
+ *
+ * @note Only available when democonfigUSE_PUBLISH_JOURNAL is set to 1 in
+ * demo_config.h.
+ *
+ * @param[in] pxMqttContext MQTT context pointer.
+ */
+void vResendJournaledPublishes( MQTTContext_t * pxMqttContext );
+
 #endif /* ifndef MQTT_DEMO_HELPERS_H */
@@ -0,0 +1,872 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mqtt_publish_journal.c
+ * @brief Implements the append-only outgoing publish journal.
+ *
+ * Every record starts with a 16 byte header, stored little endian:
+ *
+ * - byte 0: record type, publish or acknowledgment.
+ * - byte 1: for a publish, the QoS in bits 0-1 and the retain flag in bit 2.
+ * - bytes 2-3: for a publish, the topic name length.
+ * - bytes 4-7: for a publish, its sequence number; for an acknowledgment
+ *   record, the number of sequence numbers it holds.
+ * - bytes 8-11: length of the body following the header.
+ * - bytes 12-15: CRC-32 of bytes 0-11 and the body.
+ *
+ * A publish body is the topic name followed by the payload.  An
+ * acknowledgment body is a list of 32-bit sequence numbers.
+ */
+
+#include "logging_levels.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "PublishJournal"
+#endif /* LIBRARY_LOG_NAME */
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif /* LIBRARY_LOG_LEVEL */
+
+#include "logging_stack.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Journal include. */
+#include "mqtt_publish_journal.h"
+
+/*-----------------------------------------------------------*/
+
+#define publishjournalHEADER_LENGTH        ( 16U )
+#define publishjournalRECORD_PUBLISH       ( 0xA1U )
+#define publishjournalRECORD_ACK           ( 0xA2U )
+#define publishjournalFLAG_QOS_MASK        ( 0x03U )
+#define publishjournalFLAG_RETAIN          ( 0x04U )
+#define publishjournalCRC_OFFSET           ( 12U )
+
+/**
+ * @brief Size of the stack buffer used to check and copy records.
+ */
+#define publishjournalCOPY_CHUNK_LENGTH    ( 64U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Decoded record header.
+ */
+typedef struct RecordHeader
+{
+    uint8_t ucType;
+    uint8_t ucFlags;
+    uint16_t usTopicLength;
+    uint32_t ulSequenceOrCount;
+    uint32_t ulBodyLength;
+    uint32_t ulCrc;
+} RecordHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3) with more data.  Start with 0.
+ */
+static uint32_t prvCrc32( uint32_t ulCrc,
+                          const uint8_t * pucData,
+                          size_t xLength );
+
+/**
+ * @brief Encode a record header, leaving the CRC field as 0.
+ */
+static void prvEncodeHeader( uint8_t * pucHeader,
+                             uint8_t ucType,
+                             uint8_t ucFlags,
+                             uint16_t usTopicLength,
+                             uint32_t ulSequenceOrCount,
+                             uint32_t ulBodyLength );
+
+/**
+ * @brief Read and decode the header at ulOffset.
+ *
+ * @return pdPASS if a complete header was read, otherwise pdFAIL.
+ */
+static BaseType_t prvReadHeader( const PublishJournal_t * pxJournal,
+                                 uint32_t ulOffset,
+                                 RecordHeader_t * pxHeader,
+                                 uint8_t * pucRawHeader );
+
+/**
+ * @brief Check the CRC of a record whose header has been read.  An
+ * acknowledgment body is copied into pulAcks.
+ */
+static BaseType_t prvCheckRecord( const PublishJournal_t * pxJournal,
+                                  uint32_t ulOffset,
+                                  const RecordHeader_t * pxHeader,
+                                  const uint8_t * pucRawHeader,
+                                  uint32_t * pulAcks );
+
+/**
+ * @brief Drop the index entry at uxIndex, keeping the others in order.
+ */
+static void prvRemoveEntry( PublishJournal_t * pxJournal,
+                            UBaseType_t uxIndex );
+
+/**
+ * @brief Append the pending acknowledgments as one record, without syncing.
+ */
+static BaseType_t prvWriteAcks( PublishJournal_t * pxJournal );
+
+/**
+ * @brief Rewrite the journal with only the unacknowledged publishes.
+ */
+static BaseType_t prvCompact( PublishJournal_t * pxJournal );
+
+/**
+ * @brief Compact the journal once acknowledged publishes and acknowledgment
+ * records take publishjournalCOMPACT_THRESHOLD_BYTES.
+ */
+static BaseType_t prvCompactIfDue( PublishJournal_t * pxJournal );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCrc32( uint32_t ulCrc,
+                          const uint8_t * pucData,
+                          size_t xLength )
+{
+    size_t x;
+    uint8_t ucBit;
+
+    ulCrc = ~ulCrc;
+
+    for( x = 0; x < xLength; x++ )
+    {
+        ulCrc ^= pucData[ x ];
+
+        for( ucBit = 0U; ucBit < 8U; ucBit++ )
+        {
+            ulCrc = ( ulCrc >> 1 ) ^ ( 0xEDB88320UL & ( 0UL - ( ulCrc & 1UL ) ) );
+        }
+    }
+
+    return ~ulCrc;
+}
+/*-----------------------------------------------------------*/
+
+static void prvEncodeHeader( uint8_t * pucHeader,
+                             uint8_t ucType,
+                             uint8_t ucFlags,
+                             uint16_t usTopicLength,
+                             uint32_t ulSequenceOrCount,
+                             uint32_t ulBodyLength )
+{
+    pucHeader[ 0 ] = ucType;
+    pucHeader[ 1 ] = ucFlags;
+    pucHeader[ 2 ] = ( uint8_t ) usTopicLength;
+    pucHeader[ 3 ] = ( uint8_t ) ( usTopicLength >> 8 );
+    pucHeader[ 4 ] = ( uint8_t ) ulSequenceOrCount;
+    pucHeader[ 5 ] = ( uint8_t ) ( ulSequenceOrCount >> 8 );
+    pucHeader[ 6 ] = ( uint8_t ) ( ulSequenceOrCount >> 16 );
+    pucHeader[ 7 ] = ( uint8_t ) ( ulSequenceOrCount >> 24 );
+    pucHeader[ 8 ] = ( uint8_t ) ulBodyLength;
+    pucHeader[ 9 ] = ( uint8_t ) ( ulBodyLength >> 8 );
+    pucHeader[ 10 ] = ( uint8_t ) ( ulBodyLength >> 16 );
+    pucHeader[ 11 ] = ( uint8_t ) ( ulBodyLength >> 24 );
+    ( void ) memset( &( pucHeader[ publishjournalCRC_OFFSET ] ), 0, 4U );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadHeader( const PublishJournal_t * pxJournal,
+                                 uint32_t ulOffset,
+                                 RecordHeader_t * pxHeader,
+                                 uint8_t * pucRawHeader )
+{
+    const PublishJournalStore_t * pxStore = pxJournal->pxStore;
+    BaseType_t xReturn = pdFAIL;
+
+    if( pxStore->lRead( pxStore->pvContext, ulOffset, pucRawHeader, publishjournalHEADER_LENGTH ) == ( int32_t ) publishjournalHEADER_LENGTH )
+    {
+        pxHeader->ucType = pucRawHeader[ 0 ];
+        pxHeader->ucFlags = pucRawHeader[ 1 ];
+        pxHeader->usTopicLength = ( uint16_t ) ( pucRawHeader[ 2 ] | ( ( uint16_t ) pucRawHeader[ 3 ] << 8 ) );
+        pxHeader->ulSequenceOrCount = ( uint32_t ) pucRawHeader[ 4 ] |
+                                      ( ( uint32_t ) pucRawHeader[ 5 ] << 8 ) |
+                                      ( ( uint32_t ) pucRawHeader[ 6 ] << 16 ) |
+                                      ( ( uint32_t ) pucRawHeader[ 7 ] << 24 );
+        pxHeader->ulBodyLength = ( uint32_t ) pucRawHeader[ 8 ] |
+                                 ( ( uint32_t ) pucRawHeader[ 9 ] << 8 ) |
+                                 ( ( uint32_t ) pucRawHeader[ 10 ] << 16 ) |
+                                 ( ( uint32_t ) pucRawHeader[ 11 ] << 24 );
+        pxHeader->ulCrc = ( uint32_t ) pucRawHeader[ 12 ] |
+                          ( ( uint32_t ) pucRawHeader[ 13 ] << 8 ) |
+                          ( ( uint32_t ) pucRawHeader[ 14 ] << 16 ) |
+                          ( ( uint32_t ) pucRawHeader[ 15 ] << 24 );
+        xReturn = pdPASS;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCheckRecord( const PublishJournal_t * pxJournal,
+                                  uint32_t ulOffset,
+                                  const RecordHeader_t * pxHeader,
+                                  const uint8_t * pucRawHeader,
+                                  uint32_t * pulAcks )
+{
+    const PublishJournalStore_t * pxStore = pxJournal->pxStore;
+    uint8_t ucChunk[ publishjournalCOPY_CHUNK_LENGTH ];
+    uint32_t ulCrc;
+    uint32_t ulDone = 0U;
+    uint32_t ulChunkLength;
+    uint32_t ulAckBytes = 0U;
+    BaseType_t xReturn = pdPASS;
+
+    if( pxHeader->ucType == publishjournalRECORD_PUBLISH )
+    {
+        if( ( pxHeader->ulBodyLength > publishjournalMAX_PUBLISH_LENGTH ) ||
+            ( pxHeader->usTopicLength > pxHeader->ulBodyLength ) )
+        {
+            xReturn = pdFAIL;
+        }
+    }
+    else if( pxHeader->ucType == publishjournalRECORD_ACK )
+    {
+        if( ( pxHeader->ulSequenceOrCount > publishjournalACK_BATCH_LENGTH ) ||
+            ( pxHeader->ulBodyLength != ( pxHeader->ulSequenceOrCount * 4U ) ) )
+        {
+            xReturn = pdFAIL;
+        }
+    }
+    else
+    {
+        xReturn = pdFAIL;
+    }
+
+    ulCrc = prvCrc32( 0U, pucRawHeader, publishjournalCRC_OFFSET );
+
+    while( ( xReturn == pdPASS ) && ( ulDone < pxHeader->ulBodyLength ) )
+    {
+        ulChunkLength = pxHeader->ulBodyLength - ulDone;
+
+        if( ulChunkLength > publishjournalCOPY_CHUNK_LENGTH )
+        {
+            ulChunkLength = publishjournalCOPY_CHUNK_LENGTH;
+        }
+
+        if( pxStore->lRead( pxStore->pvContext,
+                            ulOffset + publishjournalHEADER_LENGTH + ulDone,
+                            ucChunk,
+                            ulChunkLength ) != ( int32_t ) ulChunkLength )
+        {
+            xReturn = pdFAIL;
+        }
+        else
+        {
+            ulCrc = prvCrc32( ulCrc, ucChunk, ulChunkLength );
+
+            if( pxHeader->ucType == publishjournalRECORD_ACK )
+            {
+                /* The body is at most publishjournalACK_BATCH_LENGTH words,
+                 * checked above. */
+                ( void ) memcpy( &( ( ( uint8_t * ) pulAcks )[ ulAckBytes ] ), ucChunk, ulChunkLength );
+                ulAckBytes += ulChunkLength;
+            }
+
+            ulDone += ulChunkLength;
+        }
+    }
+
+    if( ( xReturn == pdPASS ) && ( ulCrc != pxHeader->ulCrc ) )
+    {
+        xReturn = pdFAIL;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveEntry( PublishJournal_t * pxJournal,
+                            UBaseType_t uxIndex )
+{
+    pxJournal->ulLiveBytes -= pxJournal->xEntries[ uxIndex ].ulLength;
+    pxJournal->uxEntryCount--;
+
+    ( void ) memmove( &( pxJournal->xEntries[ uxIndex ] ),
+                      &( pxJournal->xEntries[ uxIndex + 1U ] ),
+                      ( pxJournal->uxEntryCount - uxIndex ) * sizeof( PublishJournalEntry_t ) );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWriteAcks( PublishJournal_t * pxJournal )
+{
+    const PublishJournalStore_t * pxStore = pxJournal->pxStore;
+    uint8_t ucRecord[ publishjournalHEADER_LENGTH + ( publishjournalACK_BATCH_LENGTH * 4U ) ];
+    uint32_t ulBodyLength = ( uint32_t ) pxJournal->uxPendingAckCount * 4U;
+    uint32_t ulCrc;
+    UBaseType_t x;
+    BaseType_t xReturn = pdPASS;
+
+    if( pxJournal->uxPendingAckCount > 0U )
+    {
+        prvEncodeHeader( ucRecord,
+                         publishjournalRECORD_ACK,
+                         0U,
+                         0U,
+                         ( uint32_t ) pxJournal->uxPendingAckCount,
+                         ulBodyLength );
+
+        for( x = 0; x < pxJournal->uxPendingAckCount; x++ )
+        {
+            ucRecord[ publishjournalHEADER_LENGTH + ( x * 4U ) ] = ( uint8_t ) pxJournal->ulPendingAcks[ x ];
+            ucRecord[ publishjournalHEADER_LENGTH + ( x * 4U ) + 1U ] = ( uint8_t ) ( pxJournal->ulPendingAcks[ x ] >> 8 );
+            ucRecord[ publishjournalHEADER_LENGTH + ( x * 4U ) + 2U ] = ( uint8_t ) ( pxJournal->ulPendingAcks[ x ] >> 16 );
+            ucRecord[ publishjournalHEADER_LENGTH + ( x * 4U ) + 3U ] = ( uint8_t ) ( pxJournal->ulPendingAcks[ x ] >> 24 );
+        }
+
+        ulCrc = prvCrc32( 0U, ucRecord, publishjournalCRC_OFFSET );
+        ulCrc = prvCrc32( ulCrc, &( ucRecord[ publishjournalHEADER_LENGTH ] ), ulBodyLength );
+        ucRecord[ 12 ] = ( uint8_t ) ulCrc;
+        ucRecord[ 13 ] = ( uint8_t ) ( ulCrc >> 8 );
+        ucRecord[ 14 ] = ( uint8_t ) ( ulCrc >> 16 );
+        ucRecord[ 15 ] = ( uint8_t ) ( ulCrc >> 24 );
+
+        if( pxStore->xAppend( pxStore->pvContext, ucRecord, publishjournalHEADER_LENGTH + ulBodyLength ) == pdPASS )
+        {
+            pxJournal->ulJournalSize += publishjournalHEADER_LENGTH + ulBodyLength;
+            pxJournal->uxPendingAckCount = 0U;
+        }
+        else
+        {
+            /* Part of the record may have been written.  Rewriting the journal
+             * removes it, and drops the acknowledged publishes along with it. */
+            LogError( ( "Failed to append acknowledgment record, compacting." ) );
+            xReturn = prvCompact( pxJournal );
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCompact( PublishJournal_t * pxJournal )
+{
+    const PublishJournalStore_t * pxStore = pxJournal->pxStore;
+    uint8_t ucChunk[ publishjournalCOPY_CHUNK_LENGTH ];
+    uint32_t ulNewOffset = 0U;
+    uint32_t ulDone;
+    uint32_t ulChunkLength;
+    UBaseType_t x;
+    BaseType_t xReturn;
+
+    xReturn = pxStore->xRewriteBegin( pxStore->pvContext );
+
+    for( x = 0; ( xReturn == pdPASS ) && ( x < pxJournal->uxEntryCount ); x++ )
+    {
+        for( ulDone = 0U; ( xReturn == pdPASS ) && ( ulDone < pxJournal->xEntries[ x ].ulLength ); ulDone += ulChunkLength )
+        {
+            ulChunkLength = pxJournal->xEntries[ x ].ulLength - ulDone;
+
+            if( ulChunkLength > publishjournalCOPY_CHUNK_LENGTH )
+            {
+                ulChunkLength = publishjournalCOPY_CHUNK_LENGTH;
+            }
+
+            if( pxStore->lRead( pxStore->pvContext,
+                                pxJournal->xEntries[ x ].ulOffset + ulDone,
+                                ucChunk,
+                                ulChunkLength ) != ( int32_t ) ulChunkLength )
+            {
+                xReturn = pdFAIL;
+            }
+            else
+            {
+                xReturn = pxStore->xRewriteAppend( pxStore->pvContext, ucChunk, ulChunkLength );
+            }
+        }
+    }
+
+    if( xReturn == pdPASS )
+    {
+        xReturn = pxStore->xRewriteCommit( pxStore->pvContext );
+    }
+
+    if( xReturn == pdPASS )
+    {
+        /* Only move the index once the new journal is in place, so a failed
+         * rewrite leaves it describing the old one. */
+        for( x = 0; x < pxJournal->uxEntryCount; x++ )
+        {
+            pxJournal->xEntries[ x ].ulOffset = ulNewOffset;
+            ulNewOffset += pxJournal->xEntries[ x ].ulLength;
+        }
+
+        /* Acknowledged publishes are not in the index, so the new journal
+         * already accounts for any acknowledgment not yet written. */
+        pxJournal->uxPendingAckCount = 0U;
+        pxJournal->ulJournalSize = ulNewOffset;
+        pxJournal->ulLiveBytes = ulNewOffset;
+
+        LogDebug( ( "Compacted journal to %u bytes holding %u publishes.",
+                    ( unsigned ) ulNewOffset,
+                    ( unsigned ) pxJournal->uxEntryCount ) );
+    }
+    else
+    {
+        LogError( ( "Failed to compact the publish journal." ) );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCompactIfDue( PublishJournal_t * pxJournal )
+{
+    BaseType_t xReturn = pdPASS;
+
+    if( ( pxJournal->ulJournalSize - pxJournal->ulLiveBytes ) >= publishjournalCOMPACT_THRESHOLD_BYTES )
+    {
+        xReturn = prvCompact( pxJournal );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPublishJournal_Open( PublishJournal_t * pxJournal,
+                                 const PublishJournalStore_t * pxStore )
+{
+    RecordHeader_t xHeader;
+    uint8_t ucRawHeader[ publishjournalHEADER_LENGTH ];
+    uint32_t ulAcks[ publishjournalACK_BATCH_LENGTH ];
+    uint32_t ulOffset = 0U;
+    uint32_t ulRecordLength;
+    uint32_t ulSequence;
+    UBaseType_t x;
+    UBaseType_t y;
+    BaseType_t xTorn = pdFALSE;
+    BaseType_t xReturn;
+
+    configASSERT( pxJournal != NULL );
+    configASSERT( pxStore != NULL );
+
+    ( void ) memset( pxJournal, 0, sizeof( PublishJournal_t ) );
+    pxJournal->pxStore = pxStore;
+
+    xReturn = pxStore->xOpen( pxStore->pvContext );
+
+    while( xReturn == pdPASS )
+    {
+        if( prvReadHeader( pxJournal, ulOffset, &xHeader, ucRawHeader ) != pdPASS )
+        {
+            /* Either the end of the journal or a header cut short by a reset.
+             * The store reports how many bytes remain, so distinguish the two
+             * with a one byte read. */
+            xTorn = ( pxStore->lRead( pxStore->pvContext, ulOffset, ucRawHeader, 1U ) > 0 ) ? pdTRUE : pdFALSE;
+            break;
+        }
+
+        if( prvCheckRecord( pxJournal, ulOffset, &xHeader, ucRawHeader, ulAcks ) != pdPASS )
+        {
+            xTorn = pdTRUE;
+            break;
+        }
+
+        ulRecordLength = publishjournalHEADER_LENGTH + xHeader.ulBodyLength;
+
+        if( xHeader.ucType == publishjournalRECORD_PUBLISH )
+        {
+            ulSequence = xHeader.ulSequenceOrCount;
+
+            if( pxJournal->uxEntryCount < publishjournalMAX_ENTRIES )
+            {
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].ulSequence = ulSequence;
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].ulOffset = ulOffset;
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].ulLength = ulRecordLength;
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].usPacketId = MQTT_PACKET_ID_INVALID;
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].ucQoS = ( uint8_t ) ( xHeader.ucFlags & publishjournalFLAG_QOS_MASK );
+                pxJournal->xEntries[ pxJournal->uxEntryCount ].ucSent = 0U;
+                pxJournal->uxEntryCount++;
+                pxJournal->ulLiveBytes += ulRecordLength;
+            }
+            else
+            {
+                LogError( ( "Journal holds more than publishjournalMAX_ENTRIES publishes, "
+                            "dropping sequence %u.",
+                            ( unsigned ) ulSequence ) );
+            }
+
+            if( ( ulSequence + 1U ) > pxJournal->ulNextSequence )
+            {
+                pxJournal->ulNextSequence = ulSequence + 1U;
+            }
+        }
+        else
+        {
+            for( x = 0; x < xHeader.ulSequenceOrCount; x++ )
+            {
+                /* The words were stored little endian. */
+                ulSequence = ( uint32_t ) ( ( uint8_t * ) ulAcks )[ ( x * 4U ) ] |
+                             ( ( uint32_t ) ( ( uint8_t * ) ulAcks )[ ( x * 4U ) + 1U ] << 8 ) |
+                             ( ( uint32_t ) ( ( uint8_t * ) ulAcks )[ ( x * 4U ) + 2U ] << 16 ) |
+                             ( ( uint32_t ) ( ( uint8_t * ) ulAcks )[ ( x * 4U ) + 3U ] << 24 );
+
+                for( y = 0; y < pxJournal->uxEntryCount; y++ )
+                {
+                    if( pxJournal->xEntries[ y ].ulSequence == ulSequence )
+                    {
+                        prvRemoveEntry( pxJournal, y );
+                        break;
+                    }
+                }
+            }
+        }
+
+        ulOffset += ulRecordLength;
+    }
+
+    pxJournal->ulJournalSize = ulOffset;
+
+    if( ( xReturn == pdPASS ) && ( xTorn == pdTRUE ) )
+    {
+        /* Appending after a damaged record would hide the new records from
+         * the next scan, so rewrite the journal without it. */
+        LogWarn( ( "Publish journal damaged at offset %u, recovering.", ( unsigned ) ulOffset ) );
+        xReturn = prvCompact( pxJournal );
+    }
+
+    if( xReturn == pdPASS )
+    {
+        LogInfo( ( "Publish journal opened with %u unacknowledged publishes.",
+                   ( unsigned ) pxJournal->uxEntryCount ) );
+    }
+    else
+    {
+        LogError( ( "Failed to open the publish journal." ) );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPublishJournal_Append( PublishJournal_t * pxJournal,
+                                   const MQTTPublishInfo_t * pxPublishInfo,
+                                   uint32_t * pulSequence )
+{
+    const PublishJournalStore_t * pxStore;
+    uint8_t ucHeader[ publishjournalHEADER_LENGTH ];
+    uint32_t ulBodyLength;
+    uint32_t ulCrc;
+    uint8_t ucFlags;
+    BaseType_t xReturn = pdPASS;
+
+    configASSERT( pxJournal != NULL );
+    configASSERT( pxPublishInfo != NULL );
+    configASSERT( pulSequence != NULL );
+
+    pxStore = pxJournal->pxStore;
+    ulBodyLength = ( uint32_t ) pxPublishInfo->topicNameLength + ( uint32_t ) pxPublishInfo->payloadLength;
+
+    if( ( pxPublishInfo->qos == MQTTQoS0 ) ||
+        ( ulBodyLength > publishjournalMAX_PUBLISH_LENGTH ) ||
+        ( pxJournal->uxEntryCount >= publishjournalMAX_ENTRIES ) )
+    {
+        LogError( ( "Publish cannot be journaled: QoS %d, %u bytes, %u entries in use.",
+                    ( int ) pxPublishInfo->qos,
+                    ( unsigned ) ulBodyLength,
+                    ( unsigned ) pxJournal->uxEntryCount ) );
+        xReturn = pdFAIL;
+    }
+    else
+    {
+        xReturn = prvWriteAcks( pxJournal );
+    }
+
+    if( xReturn == pdPASS )
+    {
+        /* A failed compaction leaves the journal as it was, so the publish
+         * can still be appended. */
+        ( void ) prvCompactIfDue( pxJournal );
+
+        ucFlags = ( uint8_t ) ( ( uint8_t ) pxPublishInfo->qos & publishjournalFLAG_QOS_MASK );
+
+        if( pxPublishInfo->retain )
+        {
+            ucFlags |= publishjournalFLAG_RETAIN;
+        }
+
+        prvEncodeHeader( ucHeader,
+                         publishjournalRECORD_PUBLISH,
+                         ucFlags,
+                         pxPublishInfo->topicNameLength,
+                         pxJournal->ulNextSequence,
+                         ulBodyLength );
+
+        ulCrc = prvCrc32( 0U, ucHeader, publishjournalCRC_OFFSET );
+        ulCrc = prvCrc32( ulCrc, ( const uint8_t * ) pxPublishInfo->pTopicName, pxPublishInfo->topicNameLength );
+        ulCrc = prvCrc32( ulCrc, ( const uint8_t * ) pxPublishInfo->pPayload, pxPublishInfo->payloadLength );
+        ucHeader[ 12 ] = ( uint8_t ) ulCrc;
+        ucHeader[ 13 ] = ( uint8_t ) ( ulCrc >> 8 );
+        ucHeader[ 14 ] = ( uint8_t ) ( ulCrc >> 16 );
+        ucHeader[ 15 ] = ( uint8_t ) ( ulCrc >> 24 );
+
+        xReturn = pxStore->xAppend( pxStore->pvContext, ucHeader, publishjournalHEADER_LENGTH );
+
+        if( xReturn == pdPASS )
+        {
+            xReturn = pxStore->xAppend( pxStore->pvContext, pxPublishInfo->pTopicName, pxPublishInfo->topicNameLength );
+        }
+
+        if( ( xReturn == pdPASS ) && ( pxPublishInfo->payloadLength > 0U ) )
+        {
+            xReturn = pxStore->xAppend( pxStore->pvContext, pxPublishInfo->pPayload, ( uint32_t ) pxPublishInfo->payloadLength );
+        }
+
+        if( xReturn == pdPASS )
+        {
+            xReturn = pxStore->xSync( pxStore->pvContext );
+        }
+
+        if( xReturn == pdPASS )
+        {
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].ulSequence = pxJournal->ulNextSequence;
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].ulOffset = pxJournal->ulJournalSize;
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].ulLength = publishjournalHEADER_LENGTH + ulBodyLength;
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].usPacketId = MQTT_PACKET_ID_INVALID;
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].ucQoS = ( uint8_t ) pxPublishInfo->qos;
+            pxJournal->xEntries[ pxJournal->uxEntryCount ].ucSent = 0U;
+            pxJournal->uxEntryCount++;
+            pxJournal->ulJournalSize += publishjournalHEADER_LENGTH + ulBodyLength;
+            pxJournal->ulLiveBytes += publishjournalHEADER_LENGTH + ulBodyLength;
+
+            *pulSequence = pxJournal->ulNextSequence;
+            pxJournal->ulNextSequence++;
+        }
+        else
+        {
+            /* Drop whatever part of the record reached the store. */
+            LogError( ( "Failed to append publish to the journal." ) );
+            ( void ) prvCompact( pxJournal );
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPublishJournal_SetPacketId( PublishJournal_t * pxJournal,
+                                  uint32_t ulSequence,
+                                  uint16_t usPacketId )
+{
+    UBaseType_t x;
+
+    configASSERT( pxJournal != NULL );
+
+    for( x = 0; x < pxJournal->uxEntryCount; x++ )
+    {
+        if( pxJournal->xEntries[ x ].ulSequence == ulSequence )
+        {
+            pxJournal->xEntries[ x ].usPacketId = usPacketId;
+            pxJournal->xEntries[ x ].ucSent = 1U;
+            break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPublishJournal_Acknowledge( PublishJournal_t * pxJournal,
+                                        uint16_t usPacketId,
+                                        uint8_t ucPacketType )
+{
+    UBaseType_t x;
+    uint8_t ucQoS;
+    BaseType_t xReturn = pdFAIL;
+
+    configASSERT( pxJournal != NULL );
+    configASSERT( ( ucPacketType == MQTT_PACKET_TYPE_PUBACK ) || ( ucPacketType == MQTT_PACKET_TYPE_PUBCOMP ) );
+
+    /* Only the last acknowledgment of each QoS completes a delivery. */
+    ucQoS = ( ucPacketType == MQTT_PACKET_TYPE_PUBCOMP ) ? ( uint8_t ) MQTTQoS2 : ( uint8_t ) MQTTQoS1;
+
+    for( x = 0; ( usPacketId != MQTT_PACKET_ID_INVALID ) && ( x < pxJournal->uxEntryCount ); x++ )
+    {
+        if( ( pxJournal->xEntries[ x ].usPacketId == usPacketId ) &&
+            ( pxJournal->xEntries[ x ].ucQoS == ucQoS ) )
+        {
+            /* The batch can only still be full if writing it failed before.
+             * The publish is then replayed after a reset, which is allowed. */
+            if( pxJournal->uxPendingAckCount < publishjournalACK_BATCH_LENGTH )
+            {
+                pxJournal->ulPendingAcks[ pxJournal->uxPendingAckCount ] = pxJournal->xEntries[ x ].ulSequence;
+                pxJournal->uxPendingAckCount++;
+            }
+
+            prvRemoveEntry( pxJournal, x );
+            xReturn = pdPASS;
+            break;
+        }
+    }
+
+    if( ( xReturn == pdPASS ) && ( pxJournal->uxPendingAckCount == publishjournalACK_BATCH_LENGTH ) )
+    {
+        xReturn = prvWriteAcks( pxJournal );
+
+        /* The acknowledgments are recorded whether or not this succeeds. */
+        if( xReturn == pdPASS )
+        {
+            ( void ) prvCompactIfDue( pxJournal );
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPublishJournal_Flush( PublishJournal_t * pxJournal )
+{
+    const PublishJournalStore_t * pxStore;
+    BaseType_t xReturn = pdPASS;
+
+    configASSERT( pxJournal != NULL );
+
+    pxStore = pxJournal->pxStore;
+
+    if( pxJournal->uxPendingAckCount > 0U )
+    {
+        xReturn = prvWriteAcks( pxJournal );
+
+        if( xReturn == pdPASS )
+        {
+            xReturn = pxStore->xSync( pxStore->pvContext );
+        }
+    }
+
+    if( xReturn == pdPASS )
+    {
+        xReturn = prvCompactIfDue( pxJournal );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPublishJournal_StartConnection( PublishJournal_t * pxJournal,
+                                      bool xSessionPresent )
+{
+    UBaseType_t x;
+
+    configASSERT( pxJournal != NULL );
+
+    for( x = 0; x < pxJournal->uxEntryCount; x++ )
+    {
+        pxJournal->xEntries[ x ].ucSent = 0U;
+
+        if( xSessionPresent == false )
+        {
+            pxJournal->xEntries[ x ].usPacketId = MQTT_PACKET_ID_INVALID;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPublishJournal_Replay( PublishJournal_t * pxJournal,
+                                   PublishJournalReplayCallback_t xCallback,
+                                   void * pvContext,
+                                   uint8_t * pucBuffer )
+{
+    const PublishJournalStore_t * pxStore;
+    RecordHeader_t xHeader;
+    uint8_t ucRawHeader[ publishjournalHEADER_LENGTH ];
+    MQTTPublishInfo_t xPublishInfo;
+    uint16_t usPacketId;
+    UBaseType_t x;
+    BaseType_t xReturn = pdPASS;
+
+    configASSERT( pxJournal != NULL );
+    configASSERT( xCallback != NULL );
+    configASSERT( pucBuffer != NULL );
+
+    pxStore = pxJournal->pxStore;
+
+    for( x = 0; ( xReturn == pdPASS ) && ( x < pxJournal->uxEntryCount ); x++ )
+    {
+        if( pxJournal->xEntries[ x ].ucSent == 0U )
+        {
+            xReturn = prvReadHeader( pxJournal, pxJournal->xEntries[ x ].ulOffset, &xHeader, ucRawHeader );
+
+            if( ( xReturn == pdPASS ) &&
+                ( pxStore->lRead( pxStore->pvContext,
+                                  pxJournal->xEntries[ x ].ulOffset + publishjournalHEADER_LENGTH,
+                                  pucBuffer,
+                                  xHeader.ulBodyLength ) != ( int32_t ) xHeader.ulBodyLength ) )
+            {
+                xReturn = pdFAIL;
+            }
+
+            if( xReturn == pdPASS )
+            {
+                ( void ) memset( &xPublishInfo, 0, sizeof( xPublishInfo ) );
+                xPublishInfo.qos = ( MQTTQoS_t ) ( xHeader.ucFlags & publishjournalFLAG_QOS_MASK );
+                xPublishInfo.retain = ( ( xHeader.ucFlags & publishjournalFLAG_RETAIN ) != 0U );
+                xPublishInfo.pTopicName = ( const char * ) pucBuffer;
+                xPublishInfo.topicNameLength = xHeader.usTopicLength;
+                xPublishInfo.pPayload = &( pucBuffer[ xHeader.usTopicLength ] );
+                xPublishInfo.payloadLength = xHeader.ulBodyLength - xHeader.usTopicLength;
+
+                usPacketId = MQTT_PACKET_ID_INVALID;
+                xReturn = xCallback( pvContext, &xPublishInfo, pxJournal->xEntries[ x ].usPacketId, &usPacketId );
+
+                if( xReturn == pdPASS )
+                {
+                    pxJournal->xEntries[ x ].usPacketId = usPacketId;
+                    pxJournal->xEntries[ x ].ucSent = 1U;
+                }
+            }
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPublishJournal_GetCount( const PublishJournal_t * pxJournal )
+{
+    configASSERT( pxJournal != NULL );
+
+    return pxJournal->uxEntryCount;
+}
+/*-----------------------------------------------------------*/
+
+void vPublishJournal_Close( PublishJournal_t * pxJournal )
+{
+    configASSERT( pxJournal != NULL );
+
+    ( void ) xPublishJournal_Flush( pxJournal );
+    pxJournal->pxStore->vClose( pxJournal->pxStore->pvContext );
+}
+/*-----------------------------------------------------------*/
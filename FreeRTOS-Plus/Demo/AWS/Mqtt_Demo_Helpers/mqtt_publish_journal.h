@@ -0,0 +1,338 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mqtt_publish_journal.h
+ * @brief Append-only journal that keeps outgoing QoS1 and QoS2 publishes in
+ * non-volatile storage until they are acknowledged, so they survive a reset.
+ *
+ * Each publish is appended as one record before it is sent.  Acknowledgments
+ * are collected in RAM and appended in batches, so the common case costs one
+ * write per publish.  Once enough acknowledged records accumulate the journal
+ * is compacted by rewriting only the records still waiting for an
+ * acknowledgment, then atomically replacing the old journal.
+ *
+ * Opening the journal scans it once to rebuild a small in-RAM index of the
+ * unacknowledged publishes.  Their topics and payloads stay in storage and are
+ * only read back by xPublishJournal_Replay().  A record torn by a reset during
+ * a write fails its CRC check, which ends the scan.
+ *
+ * The storage is reached through a PublishJournalStore_t.  Stores for a host
+ * file system (mqtt_publish_journal_store_file.c) and for Reliance Edge
+ * (mqtt_publish_journal_store_reliance_edge.c) are provided.
+ *
+ * @note A journal is not thread safe.  It should only be used from the task
+ * that owns the MQTT connection.
+ */
+
+#ifndef MQTT_PUBLISH_JOURNAL_H
+#define MQTT_PUBLISH_JOURNAL_H
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/**
+ * @brief Maximum number of unacknowledged publishes the journal can hold.
+ */
+#ifndef publishjournalMAX_ENTRIES
+    #define publishjournalMAX_ENTRIES               ( 32U )
+#endif
+
+/**
+ * @brief Maximum topic name length plus payload length of a journaled
+ * publish.  Buffers passed to xPublishJournal_Replay() must be this large.
+ */
+#ifndef publishjournalMAX_PUBLISH_LENGTH
+    #define publishjournalMAX_PUBLISH_LENGTH        ( 512U )
+#endif
+
+/**
+ * @brief Number of acknowledgments collected before they are written out as
+ * one record.
+ */
+#ifndef publishjournalACK_BATCH_LENGTH
+    #define publishjournalACK_BATCH_LENGTH          ( 8U )
+#endif
+
+/**
+ * @brief Number of bytes taken by acknowledged publishes and acknowledgment
+ * records at which the journal is compacted.
+ */
+#ifndef publishjournalCOMPACT_THRESHOLD_BYTES
+    #define publishjournalCOMPACT_THRESHOLD_BYTES    ( 4096U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Storage operations used by the journal.
+ *
+ * Functions returning BaseType_t return pdPASS on success and pdFAIL
+ * otherwise.
+ */
+typedef struct PublishJournalStore
+{
+    /**
+     * @brief Passed unchanged to every function below.
+     */
+    void * pvContext;
+
+    /**
+     * @brief Open the journal, creating an empty one if none exists.  If a
+     * rewrite was interrupted after the old journal was removed, the rewritten
+     * journal must be used.
+     */
+    BaseType_t ( * xOpen )( void * pvContext );
+
+    /**
+     * @brief Read up to ulLength bytes starting at ulOffset.
+     *
+     * @return The number of bytes read, which is less than ulLength only at the
+     * end of the journal, or a negative value on error.
+     */
+    int32_t ( * lRead )( void * pvContext,
+                         uint32_t ulOffset,
+                         void * pvBuffer,
+                         uint32_t ulLength );
+
+    /**
+     * @brief Append ulLength bytes to the end of the journal.
+     */
+    BaseType_t ( * xAppend )( void * pvContext,
+                              const void * pvData,
+                              uint32_t ulLength );
+
+    /**
+     * @brief Make everything appended so far survive a reset.
+     */
+    BaseType_t ( * xSync )( void * pvContext );
+
+    /**
+     * @brief Start writing a new, empty journal alongside the current one.
+     */
+    BaseType_t ( * xRewriteBegin )( void * pvContext );
+
+    /**
+     * @brief Append ulLength bytes to the journal started by xRewriteBegin().
+     */
+    BaseType_t ( * xRewriteAppend )( void * pvContext,
+                                     const void * pvData,
+                                     uint32_t ulLength );
+
+    /**
+     * @brief Make the new journal durable and replace the current one with it.
+     * Following calls to lRead() and xAppend() use the new journal.
+     */
+    BaseType_t ( * xRewriteCommit )( void * pvContext );
+
+    /**
+     * @brief Close the journal.
+     */
+    void ( * vClose )( void * pvContext );
+} PublishJournalStore_t;
+
+/**
+ * @brief In-RAM index entry for one unacknowledged publish.
+ */
+typedef struct PublishJournalEntry
+{
+    uint32_t ulSequence; /**< @brief Position of the publish in the order it was journaled. */
+    uint32_t ulOffset;   /**< @brief Offset of the record in the journal. */
+    uint32_t ulLength;   /**< @brief Length of the record, including its header. */
+    uint16_t usPacketId; /**< @brief Packet identifier used in the current session, or MQTT_PACKET_ID_INVALID. */
+    uint8_t ucQoS;       /**< @brief QoS of the publish, which decides the acknowledgment that removes it. */
+    uint8_t ucSent;      /**< @brief Set once the publish has been sent on the current connection. */
+} PublishJournalEntry_t;
+
+/**
+ * @brief A publish journal.  The members are private to mqtt_publish_journal.c.
+ */
+typedef struct PublishJournal
+{
+    const PublishJournalStore_t * pxStore;
+    PublishJournalEntry_t xEntries[ publishjournalMAX_ENTRIES ];
+    UBaseType_t uxEntryCount;
+    uint32_t ulPendingAcks[ publishjournalACK_BATCH_LENGTH ];
+    UBaseType_t uxPendingAckCount;
+    uint32_t ulNextSequence;
+    uint32_t ulJournalSize;
+    uint32_t ulLiveBytes;
+} PublishJournal_t;
+
+/**
+ * @brief Called by xPublishJournal_Replay() for each unacknowledged publish
+ * not yet sent on the current connection.
+ *
+ * @param[in] pvContext The context passed to xPublishJournal_Replay().
+ * @param[in] pxPublishInfo The publish, read back from the journal.  The topic
+ * and payload are only valid during the call.
+ * @param[in] usPreviousPacketId Packet identifier the publish was last sent
+ * with in this boot, or MQTT_PACKET_ID_INVALID if it has not been sent yet.
+ * @param[out] pusPacketId Set to the packet identifier the publish was sent
+ * with.
+ *
+ * @return pdPASS if the publish was sent, pdFAIL to stop the replay.  A
+ * publish that was not sent is passed again by the next replay.
+ */
+typedef BaseType_t ( * PublishJournalReplayCallback_t )( void * pvContext,
+                                                         MQTTPublishInfo_t * pxPublishInfo,
+                                                         uint16_t usPreviousPacketId,
+                                                         uint16_t * pusPacketId );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Open a journal and index the publishes it holds that were never
+ * acknowledged.
+ *
+ * @param[out] pxJournal The journal to initialize.
+ * @param[in] pxStore The storage holding the journal.  Must remain valid until
+ * vPublishJournal_Close() is called.
+ *
+ * @return pdPASS if the journal was opened, otherwise pdFAIL.
+ */
+BaseType_t xPublishJournal_Open( PublishJournal_t * pxJournal,
+                                 const PublishJournalStore_t * pxStore );
+
+/**
+ * @brief Durably append a publish to the journal.  Call this before sending
+ * the publish, then record the packet identifier it was sent with using
+ * vPublishJournal_SetPacketId().
+ *
+ * Any acknowledgments collected since the last write are written first, and
+ * one sync covers both.
+ *
+ * @param[in] pxJournal The journal.
+ * @param[in] pxPublishInfo The publish.  QoS0 publishes are rejected.
+ * @param[out] pulSequence Identifies the publish in the journal.
+ *
+ * @return pdPASS if the publish is stored, otherwise pdFAIL.
+ */
+BaseType_t xPublishJournal_Append( PublishJournal_t * pxJournal,
+                                   const MQTTPublishInfo_t * pxPublishInfo,
+                                   uint32_t * pulSequence );
+
+/**
+ * @brief Record the packet identifier a journaled publish was sent with, so
+ * the acknowledgment can be matched to it.  The publish then counts as sent
+ * on the current connection.
+ *
+ * @param[in] pxJournal The journal.
+ * @param[in] ulSequence The value returned by xPublishJournal_Append().
+ * @param[in] usPacketId The packet identifier.
+ */
+void vPublishJournal_SetPacketId( PublishJournal_t * pxJournal,
+                                  uint32_t ulSequence,
+                                  uint16_t usPacketId );
+
+/**
+ * @brief Mark the publish sent with usPacketId as acknowledged.  Call this on
+ * PUBACK and on PUBCOMP.  A QoS1 publish is only removed by a PUBACK and a
+ * QoS2 publish only by a PUBCOMP, as a PUBREC does not end its delivery.
+ *
+ * The acknowledgment is held in RAM until publishjournalACK_BATCH_LENGTH have
+ * been collected, the next append, or xPublishJournal_Flush().  A publish
+ * whose acknowledgment is lost in a reset is replayed again, which QoS1 and
+ * QoS2 receivers must tolerate anyway.  Writing a batch, like an append,
+ * compacts the journal once publishjournalCOMPACT_THRESHOLD_BYTES of it is
+ * taken by acknowledged publishes and acknowledgment records.
+ *
+ * @param[in] pxJournal The journal.
+ * @param[in] usPacketId The packet identifier from the acknowledgment.
+ * @param[in] ucPacketType MQTT_PACKET_TYPE_PUBACK or MQTT_PACKET_TYPE_PUBCOMP.
+ *
+ * @return pdPASS if the acknowledgment completed a journaled publish and any
+ * resulting write succeeded, otherwise pdFAIL.
+ */
+BaseType_t xPublishJournal_Acknowledge( PublishJournal_t * pxJournal,
+                                        uint16_t usPacketId,
+                                        uint8_t ucPacketType );
+
+/**
+ * @brief Write any pending acknowledgments, then compact the journal if the
+ * acknowledged records exceed publishjournalCOMPACT_THRESHOLD_BYTES.
+ *
+ * @param[in] pxJournal The journal.
+ *
+ * @return pdPASS on success, otherwise pdFAIL.
+ */
+BaseType_t xPublishJournal_Flush( PublishJournal_t * pxJournal );
+
+/**
+ * @brief Mark every journaled publish as not yet sent on the connection just
+ * established, so that xPublishJournal_Replay() passes it again.
+ *
+ * @param[in] pxJournal The journal.
+ * @param[in] xSessionPresent Whether the broker resumed the previous session.
+ * If not, the packet identifiers of the publishes are forgotten, as the broker
+ * no longer knows them.
+ */
+void vPublishJournal_StartConnection( PublishJournal_t * pxJournal,
+                                      bool xSessionPresent );
+
+/**
+ * @brief Pass each unacknowledged publish not yet sent on the current
+ * connection, oldest first, to xCallback.
+ *
+ * The replay can be stopped by xCallback, for example while no outgoing
+ * publish record is free, and carried on later by calling this again.
+ *
+ * @param[in] pxJournal The journal.
+ * @param[in] xCallback Sends the publish.
+ * @param[in] pvContext Passed unchanged to xCallback.
+ * @param[in] pucBuffer Scratch buffer of at least
+ * publishjournalMAX_PUBLISH_LENGTH bytes for the topic and payload.
+ *
+ * @return pdPASS if every such publish was sent, otherwise pdFAIL.
+ */
+BaseType_t xPublishJournal_Replay( PublishJournal_t * pxJournal,
+                                   PublishJournalReplayCallback_t xCallback,
+                                   void * pvContext,
+                                   uint8_t * pucBuffer );
+
+/**
+ * @brief Get the number of publishes waiting for an acknowledgment.
+ *
+ * @param[in] pxJournal The journal.
+ *
+ * @return The number of journaled publishes not yet acknowledged.
+ */
+UBaseType_t uxPublishJournal_GetCount( const PublishJournal_t * pxJournal );
+
+/**
+ * @brief Flush and close the journal.
+ *
+ * @param[in] pxJournal The journal.
+ */
+void vPublishJournal_Close( PublishJournal_t * pxJournal );
+
+#endif /* ifndef MQTT_PUBLISH_JOURNAL_H */
@@ -0,0 +1,284 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mqtt_publish_journal_store_file.c
+ * @brief Publish journal store backed by a host file, using stdio.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+
+#if defined( _WIN32 )
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Store include. */
+#include "mqtt_publish_journal_store_file.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Flush stdio's buffer and ask the host to write the file to disk.
+ */
+static BaseType_t prvSyncFile( FILE * pxFile );
+
+static BaseType_t prvOpen( void * pvContext );
+static int32_t prvRead( void * pvContext,
+                        uint32_t ulOffset,
+                        void * pvBuffer,
+                        uint32_t ulLength );
+static BaseType_t prvAppend( void * pvContext,
+                             const void * pvData,
+                             uint32_t ulLength );
+static BaseType_t prvSync( void * pvContext );
+static BaseType_t prvRewriteBegin( void * pvContext );
+static BaseType_t prvRewriteAppend( void * pvContext,
+                                    const void * pvData,
+                                    uint32_t ulLength );
+static BaseType_t prvRewriteCommit( void * pvContext );
+static void prvClose( void * pvContext );
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSyncFile( FILE * pxFile )
+{
+    BaseType_t xReturn = pdFAIL;
+
+    if( fflush( pxFile ) == 0 )
+    {
+        #if defined( _WIN32 )
+            xReturn = ( _commit( _fileno( pxFile ) ) == 0 ) ? pdPASS : pdFAIL;
+        #else
+            xReturn = ( fsync( fileno( pxFile ) ) == 0 ) ? pdPASS : pdFAIL;
+        #endif
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvOpen( void * pvContext )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+    FILE * pxRewriteFile;
+
+    pxContext->pxFile = fopen( pxContext->pcPath, "r+b" );
+
+    if( pxContext->pxFile != NULL )
+    {
+        /* A rewrite that did not complete.  The journal is still intact. */
+        ( void ) remove( pxContext->pcRewritePath );
+    }
+    else
+    {
+        pxRewriteFile = fopen( pxContext->pcRewritePath, "rb" );
+
+        if( pxRewriteFile != NULL )
+        {
+            /* The old journal was removed but the rewritten one not yet
+             * renamed.  The rewritten one was synced before the removal. */
+            ( void ) fclose( pxRewriteFile );
+            ( void ) rename( pxContext->pcRewritePath, pxContext->pcPath );
+            pxContext->pxFile = fopen( pxContext->pcPath, "r+b" );
+        }
+        else
+        {
+            pxContext->pxFile = fopen( pxContext->pcPath, "w+b" );
+        }
+    }
+
+    return ( pxContext->pxFile != NULL ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvRead( void * pvContext,
+                        uint32_t ulOffset,
+                        void * pvBuffer,
+                        uint32_t ulLength )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+    int32_t lReturn = -1;
+    size_t xRead;
+
+    if( fseek( pxContext->pxFile, ( long ) ulOffset, SEEK_SET ) == 0 )
+    {
+        xRead = fread( pvBuffer, 1U, ulLength, pxContext->pxFile );
+
+        if( ferror( pxContext->pxFile ) == 0 )
+        {
+            lReturn = ( int32_t ) xRead;
+        }
+    }
+
+    return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAppend( void * pvContext,
+                             const void * pvData,
+                             uint32_t ulLength )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+    BaseType_t xReturn = pdFAIL;
+
+    /* The seek is also required by stdio when switching from reading to
+     * writing. */
+    if( fseek( pxContext->pxFile, 0L, SEEK_END ) == 0 )
+    {
+        if( fwrite( pvData, 1U, ulLength, pxContext->pxFile ) == ulLength )
+        {
+            xReturn = pdPASS;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSync( void * pvContext )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+
+    return prvSyncFile( pxContext->pxFile );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteBegin( void * pvContext )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+
+    pxContext->pxRewriteFile = fopen( pxContext->pcRewritePath, "wb" );
+
+    return ( pxContext->pxRewriteFile != NULL ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteAppend( void * pvContext,
+                                    const void * pvData,
+                                    uint32_t ulLength )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+    BaseType_t xReturn = pdFAIL;
+
+    if( fwrite( pvData, 1U, ulLength, pxContext->pxRewriteFile ) == ulLength )
+    {
+        xReturn = pdPASS;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteCommit( void * pvContext )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+    BaseType_t xReturn;
+
+    xReturn = prvSyncFile( pxContext->pxRewriteFile );
+
+    if( fclose( pxContext->pxRewriteFile ) != 0 )
+    {
+        xReturn = pdFAIL;
+    }
+
+    pxContext->pxRewriteFile = NULL;
+
+    if( xReturn == pdPASS )
+    {
+        ( void ) fclose( pxContext->pxFile );
+
+        #if defined( _WIN32 )
+            /* rename() does not replace an existing file on Windows.  prvOpen()
+             * finishes the job if a reset happens in between. */
+            ( void ) remove( pxContext->pcPath );
+        #endif
+
+        if( rename( pxContext->pcRewritePath, pxContext->pcPath ) != 0 )
+        {
+            xReturn = pdFAIL;
+        }
+
+        /* Reopen whichever journal is now in place. */
+        pxContext->pxFile = fopen( pxContext->pcPath, "r+b" );
+
+        if( pxContext->pxFile == NULL )
+        {
+            xReturn = pdFAIL;
+        }
+    }
+    else
+    {
+        ( void ) remove( pxContext->pcRewritePath );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvClose( void * pvContext )
+{
+    PublishJournalFileStore_t * pxContext = ( PublishJournalFileStore_t * ) pvContext;
+
+    if( pxContext->pxFile != NULL )
+    {
+        ( void ) fclose( pxContext->pxFile );
+        pxContext->pxFile = NULL;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPublishJournalFileStore_Init( PublishJournalStore_t * pxStore,
+                                    PublishJournalFileStore_t * pxContext,
+                                    const char * pcPath,
+                                    const char * pcRewritePath )
+{
+    configASSERT( pxStore != NULL );
+    configASSERT( pxContext != NULL );
+    configASSERT( pcPath != NULL );
+    configASSERT( pcRewritePath != NULL );
+
+    pxContext->pcPath = pcPath;
+    pxContext->pcRewritePath = pcRewritePath;
+    pxContext->pxFile = NULL;
+    pxContext->pxRewriteFile = NULL;
+
+    pxStore->pvContext = pxContext;
+    pxStore->xOpen = prvOpen;
+    pxStore->lRead = prvRead;
+    pxStore->xAppend = prvAppend;
+    pxStore->xSync = prvSync;
+    pxStore->xRewriteBegin = prvRewriteBegin;
+    pxStore->xRewriteAppend = prvRewriteAppend;
+    pxStore->xRewriteCommit = prvRewriteCommit;
+    pxStore->vClose = prvClose;
+}
+/*-----------------------------------------------------------*/
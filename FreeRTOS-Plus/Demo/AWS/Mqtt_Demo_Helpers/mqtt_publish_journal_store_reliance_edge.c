@@ -0,0 +1,250 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mqtt_publish_journal_store_reliance_edge.c
+ * @brief Publish journal store backed by a file on a Reliance Edge volume.
+ */
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Reliance Edge includes. */
+#include "redposix.h"
+
+/* Store include. */
+#include "mqtt_publish_journal_store_reliance_edge.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Value of a file descriptor that is not open.
+ */
+#define journalredNO_FILE    ( -1 )
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvOpen( void * pvContext );
+static int32_t prvRead( void * pvContext,
+                        uint32_t ulOffset,
+                        void * pvBuffer,
+                        uint32_t ulLength );
+static BaseType_t prvAppend( void * pvContext,
+                             const void * pvData,
+                             uint32_t ulLength );
+static BaseType_t prvSync( void * pvContext );
+static BaseType_t prvRewriteBegin( void * pvContext );
+static BaseType_t prvRewriteAppend( void * pvContext,
+                                    const void * pvData,
+                                    uint32_t ulLength );
+static BaseType_t prvRewriteCommit( void * pvContext );
+static void prvClose( void * pvContext );
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvOpen( void * pvContext )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+    int32_t lRewriteFile;
+
+    pxContext->lFile = red_open( pxContext->pcPath, RED_O_RDWR );
+
+    if( pxContext->lFile >= 0 )
+    {
+        /* A rewrite that did not complete.  The journal is still intact. */
+        ( void ) red_unlink( pxContext->pcRewritePath );
+    }
+    else
+    {
+        lRewriteFile = red_open( pxContext->pcRewritePath, RED_O_RDONLY );
+
+        if( lRewriteFile >= 0 )
+        {
+            /* Only reachable without REDCONF_RENAME_ATOMIC, if a reset hit
+             * between the unlink and the rename in prvRewriteCommit(). */
+            ( void ) red_close( lRewriteFile );
+            ( void ) red_rename( pxContext->pcRewritePath, pxContext->pcPath );
+            pxContext->lFile = red_open( pxContext->pcPath, RED_O_RDWR );
+        }
+        else
+        {
+            pxContext->lFile = red_open( pxContext->pcPath, RED_O_RDWR | RED_O_CREAT );
+        }
+    }
+
+    return ( pxContext->lFile >= 0 ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvRead( void * pvContext,
+                        uint32_t ulOffset,
+                        void * pvBuffer,
+                        uint32_t ulLength )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+    int32_t lReturn = -1;
+
+    if( red_lseek( pxContext->lFile, ( int64_t ) ulOffset, RED_SEEK_SET ) >= 0 )
+    {
+        lReturn = red_read( pxContext->lFile, pvBuffer, ulLength );
+    }
+
+    return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAppend( void * pvContext,
+                             const void * pvData,
+                             uint32_t ulLength )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+    BaseType_t xReturn = pdFAIL;
+
+    if( red_lseek( pxContext->lFile, 0, RED_SEEK_END ) >= 0 )
+    {
+        if( red_write( pxContext->lFile, pvData, ulLength ) == ( int32_t ) ulLength )
+        {
+            xReturn = pdPASS;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSync( void * pvContext )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+
+    return ( red_fsync( pxContext->lFile ) == 0 ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteBegin( void * pvContext )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+
+    pxContext->lRewriteFile = red_open( pxContext->pcRewritePath,
+                                        RED_O_WRONLY | RED_O_CREAT | RED_O_TRUNC );
+
+    return ( pxContext->lRewriteFile >= 0 ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteAppend( void * pvContext,
+                                    const void * pvData,
+                                    uint32_t ulLength )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+
+    return ( red_write( pxContext->lRewriteFile, pvData, ulLength ) == ( int32_t ) ulLength ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRewriteCommit( void * pvContext )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+    BaseType_t xReturn;
+
+    xReturn = ( red_fsync( pxContext->lRewriteFile ) == 0 ) ? pdPASS : pdFAIL;
+
+    if( red_close( pxContext->lRewriteFile ) != 0 )
+    {
+        xReturn = pdFAIL;
+    }
+
+    pxContext->lRewriteFile = journalredNO_FILE;
+
+    if( xReturn == pdPASS )
+    {
+        ( void ) red_close( pxContext->lFile );
+
+        #if ( REDCONF_RENAME_ATOMIC == 0 )
+            /* The rename fails if the destination exists.  prvOpen() finishes
+             * the job if a reset happens in between. */
+            ( void ) red_unlink( pxContext->pcPath );
+        #endif
+
+        if( red_rename( pxContext->pcRewritePath, pxContext->pcPath ) != 0 )
+        {
+            xReturn = pdFAIL;
+        }
+
+        /* Reopen whichever journal is now in place. */
+        pxContext->lFile = red_open( pxContext->pcPath, RED_O_RDWR );
+
+        if( pxContext->lFile < 0 )
+        {
+            xReturn = pdFAIL;
+        }
+    }
+    else
+    {
+        ( void ) red_unlink( pxContext->pcRewritePath );
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvClose( void * pvContext )
+{
+    PublishJournalRedStore_t * pxContext = ( PublishJournalRedStore_t * ) pvContext;
+
+    if( pxContext->lFile >= 0 )
+    {
+        ( void ) red_close( pxContext->lFile );
+        pxContext->lFile = journalredNO_FILE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPublishJournalRedStore_Init( PublishJournalStore_t * pxStore,
+                                   PublishJournalRedStore_t * pxContext,
+                                   const char * pcPath,
+                                   const char * pcRewritePath )
+{
+    configASSERT( pxStore != NULL );
+    configASSERT( pxContext != NULL );
+    configASSERT( pcPath != NULL );
+    configASSERT( pcRewritePath != NULL );
+
+    pxContext->pcPath = pcPath;
+    pxContext->pcRewritePath = pcRewritePath;
+    pxContext->lFile = journalredNO_FILE;
+    pxContext->lRewriteFile = journalredNO_FILE;
+
+    pxStore->pvContext = pxContext;
+    pxStore->xOpen = prvOpen;
+    pxStore->lRead = prvRead;
+    pxStore->xAppend = prvAppend;
+    pxStore->xSync = prvSync;
+    pxStore->xRewriteBegin = prvRewriteBegin;
+    pxStore->xRewriteAppend = prvRewriteAppend;
+    pxStore->xRewriteCommit = prvRewriteCommit;
+    pxStore->vClose = prvClose;
+}
+/*-----------------------------------------------------------*/
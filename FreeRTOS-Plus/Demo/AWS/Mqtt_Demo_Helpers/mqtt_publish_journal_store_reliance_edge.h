@@ -0,0 +1,73 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mqtt_publish_journal_store_reliance_edge.h
+ * @brief Publish journal store that keeps the journal in a file on a
+ * Reliance Edge volume.
+ */
+
+#ifndef MQTT_PUBLISH_JOURNAL_STORE_RELIANCE_EDGE_H
+#define MQTT_PUBLISH_JOURNAL_STORE_RELIANCE_EDGE_H
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Journal include. */
+#include "mqtt_publish_journal.h"
+
+/**
+ * @brief State of a Reliance Edge store.  The members are private to
+ * mqtt_publish_journal_store_reliance_edge.c.
+ */
+typedef struct PublishJournalRedStore
+{
+    const char * pcPath;
+    const char * pcRewritePath;
+    int32_t lFile;
+    int32_t lRewriteFile;
+} PublishJournalRedStore_t;
+
+/**
+ * @brief Set up pxStore to keep the journal in the file at pcPath.
+ *
+ * The volume holding pcPath must already be mounted.  Durability relies on
+ * red_fsync() and red_rename() being transaction points, which they are with
+ * the default REDCONF_TRANSACT_DEFAULT mask.
+ *
+ * @param[out] pxStore The store to pass to xPublishJournal_Open().
+ * @param[in] pxContext Storage for the state of the store.  Must remain valid
+ * as long as pxStore is used.
+ * @param[in] pcPath Path of the journal file, including the volume prefix.
+ * @param[in] pcRewritePath Path of the file used while compacting, on the
+ * same volume as pcPath.
+ */
+void vPublishJournalRedStore_Init( PublishJournalStore_t * pxStore,
+                                   PublishJournalRedStore_t * pxContext,
+                                   const char * pcPath,
+                                   const char * pcRewritePath );
+
+#endif /* ifndef MQTT_PUBLISH_JOURNAL_STORE_RELIANCE_EDGE_H */
@@ -33,13 +33,41 @@
 #ifndef CODE_SIGNATURE_VERIFICATION_H
 #define CODE_SIGNATURE_VERIFICATION_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "FreeRTOS.h"
 
 /**
- * @brief Validate the integrity of the new image to be activated.
- * @param[in] pFileContext pointer to File context
+ * @brief Start hashing an image to be activated. The blocks of the image can
+ * be added to the hash as they are received, instead of once it is complete.
+ * @return The verification context, or NULL if there is no memory for it.
+ */
+void * pvImageSignatureStart( void );
+
+/**
+ * @brief Add the next bytes of the image to the hash.
+ * @param[in] pvContext Context returned by pvImageSignatureStart().
+ * @param[in] pucData Bytes that follow the ones added so far.
+ * @param[in] xDataLength Number of bytes at pucData.
+ */
+void vImageSignatureUpdate( void * pvContext,
+                            const uint8_t * pucData,
+                            size_t xDataLength );
+
+/**
+ * @brief Check the signature of the image against its hash, and free the context.
+ * @param[in] pvContext Context returned by pvImageSignatureStart().
+ * @param[in] pFileContext pointer to File context, for the signature and signer certificate.
  * @return OtaPalMainStatus_t , OtaPalSuccess if the signature of the image is valid.
  */
-OtaPalMainStatus_t xValidateImageSignature( OtaFileContext_t * const pFileContext );
+OtaPalMainStatus_t xImageSignatureFinish( void * pvContext,
+                                          OtaFileContext_t * const pFileContext );
+
+/**
+ * @brief Free a context without checking a signature.
+ * @param[in] pvContext Context returned by pvImageSignatureStart(), or NULL.
+ */
+void vImageSignatureAbort( void * pvContext );
 
 #endif
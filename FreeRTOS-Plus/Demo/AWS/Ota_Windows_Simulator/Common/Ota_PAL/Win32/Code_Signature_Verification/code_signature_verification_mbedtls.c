@@ -62,9 +62,6 @@
  */
 #define SHA256_DIGEST_BYTES           32
 
-/* Size of buffer used in file operations on this platform (Windows). */
-#define OTA_PAL_WIN_BUF_SIZE          ( ( size_t ) 4096UL )
-
 /**
  * @brief Library-independent cryptographic algorithm identifiers.
  */
@@ -389,77 +386,71 @@ static BaseType_t prvSignatureVerificationFinal( void * pvContext,
     return xResult;
 }
 
-/* Verify the signature of the specified file. */
-OtaPalMainStatus_t xValidateImageSignature( OtaFileContext_t * const C )
+/*-----------------------------------------------------------*/
+
+void * pvImageSignatureStart( void )
 {
-    OtaPalMainStatus_t eResult = OtaPalSuccess;
-    uint32_t ulBytesRead;
-    uint32_t ulSignerCertSize;
-    uint8_t * pucBuf, * pucSignerCert;
-    void * pvSigVerifyContext;
+    void * pvSigVerifyContext = NULL;
 
     /* Verify an ECDSA-SHA256 signature. */
     if( pdFALSE == prvSignatureVerificationStart( &pvSigVerifyContext, ASYMMETRIC_ALGORITHM_ECDSA, HASH_ALGORITHM_SHA256 ) )
     {
-        eResult = OtaPalSignatureCheckFailed;
+        pvSigVerifyContext = NULL;
     }
-    else
-    {
-        LogInfo( ( "Started %s signature verification, file: %s\r\n",
-                   OTA_JsonFileSignatureKey, ( const char * ) C->pCertFilepath ) );
-        pucSignerCert = otaPal_ReadAndAssumeCertificate( ( const uint8_t * const ) C->pCertFilepath, &ulSignerCertSize );
 
-        if( pucSignerCert != NULL )
-        {
-            pucBuf = pvPortMalloc( OTA_PAL_WIN_BUF_SIZE ); /*lint !e9079 Allow conversion. */
+    return pvSigVerifyContext;
+}
 
-            if( pucBuf != NULL )
-            {
-                /* Rewind the received file to the beginning. */
-                if( fseek( C->pFile, 0L, SEEK_SET ) == 0 ) /*lint !e586
-                                                            * C standard library call is being used for portability. */
-                {
-                    do
-                    {
-                        ulBytesRead = fread( pucBuf, 1, OTA_PAL_WIN_BUF_SIZE, C->pFile ); /*lint !e586
-                                                                                           * C standard library call is being used for portability. */
-                                                                                          /* Include the file chunk in the signature validation. Zero size is OK. */
-                        prvSignatureVerificationUpdate( pvSigVerifyContext, pucBuf, ulBytesRead );
-                    } while( ulBytesRead > 0UL );
-
-                    if( pdFALSE == prvSignatureVerificationFinal( pvSigVerifyContext,
-                                                                  ( char * ) pucSignerCert,
-                                                                  ( size_t ) ulSignerCertSize,
-                                                                  C->pSignature->data,
-                                                                  C->pSignature->size ) ) /*lint !e732 !e9034 Allow comparison in this context. */
-                    {
-                        eResult = OtaPalSignatureCheckFailed;
-                    }
-
-                    pvSigVerifyContext = NULL; /* The context has been freed by prvSignatureVerificationFinal(). */
-                }
-                else
-                {
-                    /* Nothing special to do. */
-                }
-
-                /* Free the temporary file page buffer. */
-                vPortFree( pucBuf );
-            }
-            else
-            {
-                LogError( ( "Failed to allocate buffer memory.\r\n" ) );
-                eResult = OtaPalOutOfMemory;
-            }
+/*-----------------------------------------------------------*/
 
-            /* Free the signer certificate that we now own after prvReadAndAssumeCertificate(). */
-            vPortFree( pucSignerCert );
-        }
-        else
+void vImageSignatureUpdate( void * pvContext,
+                            const uint8_t * pucData,
+                            size_t xDataLength )
+{
+    prvSignatureVerificationUpdate( pvContext, pucData, xDataLength );
+}
+
+/*-----------------------------------------------------------*/
+
+OtaPalMainStatus_t xImageSignatureFinish( void * pvContext,
+                                          OtaFileContext_t * const C )
+{
+    OtaPalMainStatus_t eResult = OtaPalSuccess;
+    uint32_t ulSignerCertSize;
+    uint8_t * pucSignerCert;
+
+    LogInfo( ( "Finishing %s signature verification, file: %s\r\n",
+               OTA_JsonFileSignatureKey, ( const char * ) C->pCertFilepath ) );
+    pucSignerCert = otaPal_ReadAndAssumeCertificate( ( const uint8_t * const ) C->pCertFilepath, &ulSignerCertSize );
+
+    if( pucSignerCert != NULL )
+    {
+        if( pdFALSE == prvSignatureVerificationFinal( pvContext,
+                                                      ( char * ) pucSignerCert,
+                                                      ( size_t ) ulSignerCertSize,
+                                                      C->pSignature->data,
+                                                      C->pSignature->size ) ) /*lint !e732 !e9034 Allow comparison in this context. */
         {
-            eResult = OtaPalBadSignerCert;
+            eResult = OtaPalSignatureCheckFailed;
         }
+
+        /* Free the signer certificate that we now own after prvReadAndAssumeCertificate(). */
+        vPortFree( pucSignerCert );
+    }
+    else
+    {
+        /* Only free the context. */
+        ( void ) prvSignatureVerificationFinal( pvContext, NULL, 0, NULL, 0 );
+        eResult = OtaPalBadSignerCert;
     }
 
     return eResult;
 }
+
+/*-----------------------------------------------------------*/
+
+void vImageSignatureAbort( void * pvContext )
+{
+    /* Called with only the context, the function frees it. */
+    ( void ) prvSignatureVerificationFinal( pvContext, NULL, 0, NULL, 0 );
+}
@@ -32,9 +32,12 @@
 /* Standard includes. */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* Kernel includes. */
 #include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 
 /* Library config includes. */
 #include "ota_config.h"
@@ -45,9 +48,92 @@
 
 #include "code_signature_verification.h"
 
+/**
+ * @brief Write the image to a file on a Reliance Edge volume instead of a file
+ * of the host file system. The volume must be mounted by the application.
+ *
+ * When this is 1, otaconfigOTA_FILE_TYPE must be int32_t, as C->pFile then
+ * points to the Reliance Edge file descriptor.
+ */
+#ifndef otapalconfigUSE_RELIANCE_EDGE
+    #define otapalconfigUSE_RELIANCE_EDGE    0
+#endif
+
+/**
+ * @brief Size of each of the two buffers consecutive blocks are gathered in
+ * before they are written. While one buffer is written by a separate task, the
+ * agent fills the other one. 0 writes each block as it is received.
+ */
+#ifndef otapalconfigWRITE_BUFFER_SIZE
+    #define otapalconfigWRITE_BUFFER_SIZE    0
+#endif
+
+/**
+ * @brief Stack size of the task that writes the buffers.
+ */
+#ifndef otapalconfigWRITE_TASK_STACK_SIZE
+    #define otapalconfigWRITE_TASK_STACK_SIZE    ( configMINIMAL_STACK_SIZE )
+#endif
+
+/**
+ * @brief Priority of the task that writes the buffers.
+ */
+#ifndef otapalconfigWRITE_TASK_PRIORITY
+    #define otapalconfigWRITE_TASK_PRIORITY    ( tskIDLE_PRIORITY )
+#endif
+
+#if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+    #include "redposix.h"
+
+/* Error code of the last failed file system call. */
+    #define otapalSTORE_ERRNO    red_errno
+#else
+    #define otapalSTORE_ERRNO    errno
+#endif
+
+/* Size of buffer used in file operations on this platform (Windows), when the
+ * image is read back to be hashed. */
+#define OTA_PAL_WIN_BUF_SIZE    ( ( size_t ) 4096UL )
+
 /* Specify the OTA signature algorithm we support on this platform. */
 const char OTA_JsonFileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
 
+/**
+ * @brief State of the file being received.
+ *
+ * The blocks are hashed as they are written, as long as they are written in
+ * order. This is the case over HTTP. Over MQTT blocks can come out of order, and
+ * then the image is read back and hashed when it is closed.
+ */
+typedef struct OtaPalFileState
+{
+    void * pvHashContext;
+    uint32_t ulHashedLength;    /**< @brief Bytes of the image added to the hash. */
+    BaseType_t xHashInOrder;    /**< @brief pdFALSE once a block was written out of order. */
+
+    #if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+        uint8_t * pucBuffers[ 2 ];
+        UBaseType_t uxFillBuffer;  /**< @brief Index of the buffer blocks are added to. */
+        uint32_t ulFillOffset;     /**< @brief File offset of the first byte of the fill buffer. */
+        uint32_t ulFillLength;
+        UBaseType_t uxWriteBuffer; /**< @brief Index of the buffer given to the write task. */
+        uint32_t ulWriteOffset;
+        uint32_t ulWriteLength;
+        OtaFileContext_t * pxWriteFile;
+        TaskHandle_t xWriteTask;
+        SemaphoreHandle_t xWriteIdle;   /**< @brief Available while the write task is not writing. */
+        int32_t lWriteError;            /**< @brief Error of the last write that failed, or 0. */
+    #endif
+} OtaPalFileState_t;
+
+static OtaPalFileState_t xFileState;
+
+#if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+
+/* Descriptor of the file being received. C->pFile points to it. */
+    static int32_t lRedFile = -1;
+#endif
+
 static OtaPalMainStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C );
 
 /*-----------------------------------------------------------*/
@@ -61,6 +147,327 @@ static inline BaseType_t prvContextValidate( OtaFileContext_t * pFileContext )
 /* Used to set the high bit of Windows error codes for a negative return value. */
 #define OTA_PAL_INT16_NEGATIVE_MASK    ( 1 << 15 )
 
+/*-----------------------------------------------------------*/
+
+/* The functions below are the only ones that access the storage the image is
+ * written to. A port to a flash partition replaces them. */
+
+static BaseType_t prvStoreOpen( OtaFileContext_t * const C )
+{
+    #if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+        lRedFile = red_open( ( const char * ) C->pFilePath, RED_O_RDWR | RED_O_CREAT | RED_O_TRUNC );
+        C->pFile = ( lRedFile >= 0 ) ? &lRedFile : NULL;
+    #else
+        C->pFile = fopen( ( const char * ) C->pFilePath, "w+b" ); /*lint !e586
+                                                                   * C standard library call is being used for portability. */
+    #endif
+
+    return ( C->pFile != NULL ) ? pdPASS : pdFAIL;
+}
+
+static int32_t prvStoreWrite( OtaFileContext_t * const C,
+                              uint32_t ulOffset,
+                              const uint8_t * pucData,
+                              uint32_t ulLength )
+{
+    int32_t lResult;
+
+    #if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+        lResult = ( red_lseek( *( C->pFile ), ( int64_t ) ulOffset, RED_SEEK_SET ) >= 0 ) ? 0 : -1;
+
+        if( 0 == lResult )
+        {
+            lResult = red_write( *( C->pFile ), pucData, ulLength );
+        }
+        else
+        {
+            LogError( ( "ERROR - red_lseek failed\r\n" ) );
+        }
+    #else /* if ( otapalconfigUSE_RELIANCE_EDGE == 1 ) */
+        lResult = fseek( C->pFile, ulOffset, SEEK_SET ); /*lint !e586 !e713 !e9034
+                                                          * C standard library call is being used for portability. */
+
+        if( 0 == lResult )
+        {
+            lResult = ( int32_t ) fwrite( pucData, 1, ulLength, C->pFile ); /*lint !e586 !e713 !e9034
+                                                                             * C standard library call is being used for portability. */
+
+            if( lResult != ( int32_t ) ulLength )
+            {
+                lResult = -1;
+            }
+        }
+        else
+        {
+            LogError( ( "ERROR - fseek failed\r\n" ) );
+            lResult = -1;
+        }
+    #endif /* if ( otapalconfigUSE_RELIANCE_EDGE == 1 ) */
+
+    return lResult;
+}
+
+static int32_t prvStoreRead( OtaFileContext_t * const C,
+                             uint32_t ulOffset,
+                             uint8_t * pucBuffer,
+                             uint32_t ulLength )
+{
+    int32_t lResult = -1;
+
+    #if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+        if( red_lseek( *( C->pFile ), ( int64_t ) ulOffset, RED_SEEK_SET ) >= 0 )
+        {
+            lResult = red_read( *( C->pFile ), pucBuffer, ulLength );
+        }
+    #else
+        if( fseek( C->pFile, ulOffset, SEEK_SET ) == 0 ) /*lint !e586
+                                                          * C standard library call is being used for portability. */
+        {
+            lResult = ( int32_t ) fread( pucBuffer, 1, ulLength, C->pFile ); /*lint !e586
+                                                                              * C standard library call is being used for portability. */
+        }
+    #endif
+
+    return lResult;
+}
+
+static int32_t prvStoreClose( OtaFileContext_t * const C )
+{
+    int32_t lResult;
+
+    #if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+        lResult = red_close( *( C->pFile ) );
+        lRedFile = -1;
+    #else
+        lResult = fclose( C->pFile ); /*lint !e482 !e586
+                                       * C standard library call is being used for portability. */
+    #endif
+
+    C->pFile = NULL;
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvHashBlock( uint32_t ulOffset,
+                          const uint8_t * pucData,
+                          uint32_t ulLength )
+{
+    if( ( xFileState.xHashInOrder == pdTRUE ) && ( ulOffset == xFileState.ulHashedLength ) )
+    {
+        vImageSignatureUpdate( xFileState.pvHashContext, pucData, ulLength );
+        xFileState.ulHashedLength += ulLength;
+    }
+    else if( xFileState.xHashInOrder == pdTRUE )
+    {
+        /* Even a block written again may differ from the one hashed. */
+        LogInfo( ( "Block at offset %u is out of order. The file will be hashed when it is closed.\r\n",
+                   ( unsigned ) ulOffset ) );
+        xFileState.xHashInOrder = pdFALSE;
+    }
+    else
+    {
+        /* The hash is done when the file is closed. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+
+    static void prvWriteTask( void * pvParameters )
+    {
+        int32_t lResult;
+
+        ( void ) pvParameters;
+
+        for( ; ; )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+            lResult = prvStoreWrite( xFileState.pxWriteFile,
+                                     xFileState.ulWriteOffset,
+                                     xFileState.pucBuffers[ xFileState.uxWriteBuffer ],
+                                     xFileState.ulWriteLength );
+
+            if( lResult != ( int32_t ) xFileState.ulWriteLength )
+            {
+                LogError( ( "ERROR - Write of %u bytes at offset %u failed\r\n",
+                            ( unsigned ) xFileState.ulWriteLength,
+                            ( unsigned ) xFileState.ulWriteOffset ) );
+                xFileState.lWriteError = OTA_PAL_INT16_NEGATIVE_MASK | otapalSTORE_ERRNO;
+            }
+
+            ( void ) xSemaphoreGive( xFileState.xWriteIdle );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/* Waits for the write task to finish the buffer it is writing. */
+    static int32_t prvWaitForWrite( void )
+    {
+        ( void ) xSemaphoreTake( xFileState.xWriteIdle, portMAX_DELAY );
+        ( void ) xSemaphoreGive( xFileState.xWriteIdle );
+
+        return xFileState.lWriteError;
+    }
+
+/*-----------------------------------------------------------*/
+
+/* Gives the fill buffer to the write task, once it is done with the other one,
+ * and starts to fill the other one. */
+    static int32_t prvSubmitFillBuffer( OtaFileContext_t * const C )
+    {
+        if( xFileState.ulFillLength > 0U )
+        {
+            ( void ) xSemaphoreTake( xFileState.xWriteIdle, portMAX_DELAY );
+
+            if( xFileState.lWriteError == 0 )
+            {
+                xFileState.pxWriteFile = C;
+                xFileState.uxWriteBuffer = xFileState.uxFillBuffer;
+                xFileState.ulWriteOffset = xFileState.ulFillOffset;
+                xFileState.ulWriteLength = xFileState.ulFillLength;
+                ( void ) xTaskNotifyGive( xFileState.xWriteTask );
+
+                xFileState.uxFillBuffer ^= 1U;
+            }
+            else
+            {
+                /* Nothing more is written once a write failed. */
+                ( void ) xSemaphoreGive( xFileState.xWriteIdle );
+            }
+
+            xFileState.ulFillLength = 0U;
+        }
+
+        return xFileState.lWriteError;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int32_t prvBufferBlock( OtaFileContext_t * const C,
+                                   uint32_t ulOffset,
+                                   const uint8_t * pucData,
+                                   uint32_t ulBlockSize )
+    {
+        int32_t lResult = 0;
+
+        /* A block that does not follow the ones in the fill buffer, or does
+         * not fit, starts a new buffer. */
+        if( ( ulOffset != ( xFileState.ulFillOffset + xFileState.ulFillLength ) ) ||
+            ( ulBlockSize > ( otapalconfigWRITE_BUFFER_SIZE - xFileState.ulFillLength ) ) )
+        {
+            lResult = prvSubmitFillBuffer( C );
+        }
+
+        if( 0 == lResult )
+        {
+            if( ulBlockSize > otapalconfigWRITE_BUFFER_SIZE )
+            {
+                /* Larger than a buffer. The write task must be done with the
+                 * file before it is written from here. */
+                lResult = prvWaitForWrite();
+
+                if( 0 == lResult )
+                {
+                    lResult = prvStoreWrite( C, ulOffset, pucData, ulBlockSize );
+                    lResult = ( lResult == ( int32_t ) ulBlockSize ) ? 0 : ( OTA_PAL_INT16_NEGATIVE_MASK | otapalSTORE_ERRNO );
+                }
+            }
+            else
+            {
+                if( xFileState.ulFillLength == 0U )
+                {
+                    xFileState.ulFillOffset = ulOffset;
+                }
+
+                memcpy( &( xFileState.pucBuffers[ xFileState.uxFillBuffer ][ xFileState.ulFillLength ] ), pucData, ulBlockSize );
+                xFileState.ulFillLength += ulBlockSize;
+
+                if( xFileState.ulFillLength == otapalconfigWRITE_BUFFER_SIZE )
+                {
+                    lResult = prvSubmitFillBuffer( C );
+                }
+            }
+        }
+
+        return ( 0 == lResult ) ? ( int32_t ) ulBlockSize : lResult;
+    }
+
+/*-----------------------------------------------------------*/
+
+/* Waits for the write in progress, and frees the write task and buffers.
+ * Returns the error of any write that failed. */
+    static int32_t prvStopWriteTask( void )
+    {
+        int32_t lResult = 0;
+
+        if( xFileState.xWriteTask != NULL )
+        {
+            lResult = prvWaitForWrite();
+            vTaskDelete( xFileState.xWriteTask );
+            xFileState.xWriteTask = NULL;
+        }
+
+        if( xFileState.xWriteIdle != NULL )
+        {
+            vSemaphoreDelete( xFileState.xWriteIdle );
+            xFileState.xWriteIdle = NULL;
+        }
+
+        vPortFree( xFileState.pucBuffers[ 0 ] );
+        vPortFree( xFileState.pucBuffers[ 1 ] );
+        xFileState.pucBuffers[ 0 ] = NULL;
+        xFileState.pucBuffers[ 1 ] = NULL;
+        xFileState.ulFillLength = 0U;
+
+        return lResult;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvStartWriteTask( void )
+    {
+        xFileState.pucBuffers[ 0 ] = pvPortMalloc( otapalconfigWRITE_BUFFER_SIZE );
+        xFileState.pucBuffers[ 1 ] = pvPortMalloc( otapalconfigWRITE_BUFFER_SIZE );
+        xFileState.xWriteIdle = xSemaphoreCreateBinary();
+        xFileState.xWriteTask = NULL;
+        xFileState.uxFillBuffer = 0U;
+        xFileState.ulFillOffset = 0U;
+        xFileState.ulFillLength = 0U;
+        xFileState.lWriteError = 0;
+
+        if( ( xFileState.pucBuffers[ 0 ] != NULL ) &&
+            ( xFileState.pucBuffers[ 1 ] != NULL ) &&
+            ( xFileState.xWriteIdle != NULL ) )
+        {
+            ( void ) xSemaphoreGive( xFileState.xWriteIdle );
+
+            if( xTaskCreate( prvWriteTask,
+                             "OTA write",
+                             otapalconfigWRITE_TASK_STACK_SIZE,
+                             NULL,
+                             otapalconfigWRITE_TASK_PRIORITY,
+                             &( xFileState.xWriteTask ) ) != pdPASS )
+            {
+                xFileState.xWriteTask = NULL;
+            }
+        }
+
+        if( xFileState.xWriteTask == NULL )
+        {
+            LogWarn( ( "Could not start the write task. Blocks will be written as they are received.\r\n" ) );
+            ( void ) prvStopWriteTask();
+        }
+    }
+
+#endif /* otapalconfigWRITE_BUFFER_SIZE > 0 */
+
+/*-----------------------------------------------------------*/
+
 /* Attempt to create a new receive file for the file chunks as they come in. */
 
 OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
@@ -72,18 +479,24 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
     {
         if( C->pFilePath != NULL )
         {
-            C->pFile = fopen( ( const char * ) C->pFilePath, "w+b" ); /*lint !e586
-                                                                       * C standard library call is being used for portability. */
-
-            if( C->pFile != NULL )
+            if( prvStoreOpen( C ) == pdPASS )
             {
                 mainErr = OtaPalSuccess;
                 LogInfo( ( "Receive file created.\r\n" ) );
+
+                /* Without a context, the file is hashed when it is closed. */
+                xFileState.pvHashContext = pvImageSignatureStart();
+                xFileState.ulHashedLength = 0U;
+                xFileState.xHashInOrder = ( xFileState.pvHashContext != NULL ) ? pdTRUE : pdFALSE;
+
+                #if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+                    prvStartWriteTask();
+                #endif
             }
             else
             {
                 mainErr = OtaPalRxFileCreateFailed;
-                subErr = errno;
+                subErr = otapalSTORE_ERRNO;
                 LogError( ( "ERROR - Failed to start operation: already active!\r\n" ) );
             }
         }
@@ -117,9 +530,15 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const C )
         /* Close the OTA update file if it's open. */
         if( NULL != C->pFile )
         {
-            lFileCloseResult = fclose( C->pFile ); /*lint !e482 !e586
-                                                    * Context file handle state is managed by this API. */
-            C->pFile = NULL;
+            #if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+                /* The blocks still buffered are dropped. */
+                ( void ) prvStopWriteTask();
+            #endif
+
+            vImageSignatureAbort( xFileState.pvHashContext );
+            xFileState.pvHashContext = NULL;
+
+            lFileCloseResult = prvStoreClose( C );
 
             if( 0 == lFileCloseResult )
             {
@@ -130,7 +549,7 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const C )
             {
                 LogError( ( "ERROR - Closing file failed.\r\n" ) );
                 mainErr = OtaPalFileAbort;
-                subErr = errno;
+                subErr = otapalSTORE_ERRNO;
             }
         }
         else
@@ -158,31 +577,30 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const C,
 
     if( prvContextValidate( C ) == pdTRUE )
     {
-        lResult = fseek( C->pFile, ulOffset, SEEK_SET ); /*lint !e586 !e713 !e9034
-                                                          * C standard library call is being used for portability. */
+        /* Hashed here so that it overlaps with the write of the buffer before. */
+        prvHashBlock( ulOffset, pacData, ulBlockSize );
 
-        if( 0 == lResult )
+        #if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+            if( xFileState.xWriteTask != NULL )
+            {
+                /* A failed write is reported by the next block, as the
+                 * buffer the block is in is written later. */
+                lResult = prvBufferBlock( C, ulOffset, pacData, ulBlockSize );
+            }
+            else
+        #endif
         {
-            lResult = fwrite( pacData, 1, ulBlockSize, C->pFile ); /*lint !e586 !e713 !e9034
-                                                                    * C standard library call is being used for portability. */
+            lResult = prvStoreWrite( C, ulOffset, pacData, ulBlockSize );
 
             if( lResult < 0 )
             {
-                LogError( ( "ERROR - fwrite failed\r\n" ) );
+                LogError( ( "ERROR - write failed\r\n" ) );
                 /* Mask to return a negative value. */
-                lResult = OTA_PAL_INT16_NEGATIVE_MASK | errno; /*lint !e40 !e9027
-                                                                * Errno is being used in accordance with host API documentation.
-                                                                * Bitmasking is being used to preserve host API error with library status code. */
+                lResult = OTA_PAL_INT16_NEGATIVE_MASK | otapalSTORE_ERRNO; /*lint !e40 !e9027
+                                                                            * Errno is being used in accordance with host API documentation.
+                                                                            * Bitmasking is being used to preserve host API error with library status code. */
             }
         }
-        else
-        {
-            LogError( ( "ERROR - fseek failed\r\n" ) );
-            /* Mask to return a negative value. */
-            lResult = OTA_PAL_INT16_NEGATIVE_MASK | errno; /*lint !e40 !e9027
-                                                            * Errno is being used in accordance with host API documentation.
-                                                            * Bitmasking is being used to preserve host API error with library status code. */
-        }
     }
     else /* Invalid context or file pointer provided. */
     {
@@ -203,7 +621,25 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
 
     if( prvContextValidate( C ) == pdTRUE )
     {
-        if( C->pSignature != NULL )
+        #if ( otapalconfigWRITE_BUFFER_SIZE > 0 )
+            if( xFileState.xWriteTask != NULL )
+            {
+                /* The signature check may read the file back, so the blocks
+                 * still buffered are written first. Stopping the task returns
+                 * the error of any write that failed. */
+                ( void ) prvSubmitFillBuffer( C );
+                lWindowsError = prvStopWriteTask();
+            }
+        #endif
+
+        if( lWindowsError != 0 )
+        {
+            LogError( ( "Failed to write OTA update file.\r\n" ) );
+            vImageSignatureAbort( xFileState.pvHashContext );
+            mainErr = OtaPalFileClose;
+            subErr = ( OtaPalSubStatus_t ) ( lWindowsError & ~OTA_PAL_INT16_NEGATIVE_MASK );
+        }
+        else if( C->pSignature != NULL )
         {
             /* Verify the file signature, close the file and return the signature verification result. */
             mainErr = otaPal_CheckFileSignature( C );
@@ -211,19 +647,20 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
         else
         {
             LogError( ( "NULL OTA Signature structure.\r\n" ) );
+            vImageSignatureAbort( xFileState.pvHashContext );
             mainErr = OtaPalSignatureCheckFailed;
         }
 
+        xFileState.pvHashContext = NULL;
+
         /* Close the file. */
-        lWindowsError = fclose( C->pFile ); /*lint !e482 !e586
-                                             * C standard library call is being used for portability. */
-        C->pFile = NULL;
+        lWindowsError = prvStoreClose( C );
 
         if( lWindowsError != 0 )
         {
             LogError( ( "Failed to close OTA update file.\r\n" ) );
             mainErr = OtaPalFileClose;
-            subErr = errno;
+            subErr = otapalSTORE_ERRNO;
         }
 
         if( mainErr == OtaPalSuccess )
@@ -255,10 +692,59 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
 static OtaPalMainStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C )
 {
     OtaPalMainStatus_t eResult = OtaPalSignatureCheckFailed;
+    uint8_t * pucBuf;
+    uint32_t ulOffset = 0U;
+    int32_t lBytesRead;
 
     if( prvContextValidate( C ) == pdTRUE )
     {
-        eResult = xValidateImageSignature( C );
+        if( ( xFileState.xHashInOrder == pdTRUE ) && ( xFileState.ulHashedLength == C->fileSize ) )
+        {
+            /* Every block was hashed as it was written. */
+            eResult = xImageSignatureFinish( xFileState.pvHashContext, C );
+        }
+        else
+        {
+            /* Hash the file as it is stored. */
+            vImageSignatureAbort( xFileState.pvHashContext );
+            xFileState.pvHashContext = pvImageSignatureStart();
+            pucBuf = pvPortMalloc( OTA_PAL_WIN_BUF_SIZE ); /*lint !e9079 Allow conversion. */
+
+            if( ( xFileState.pvHashContext != NULL ) && ( pucBuf != NULL ) )
+            {
+                do
+                {
+                    lBytesRead = prvStoreRead( C, ulOffset, pucBuf, OTA_PAL_WIN_BUF_SIZE );
+
+                    if( lBytesRead > 0 )
+                    {
+                        vImageSignatureUpdate( xFileState.pvHashContext, pucBuf, ( size_t ) lBytesRead );
+                        ulOffset += ( uint32_t ) lBytesRead;
+                    }
+                } while( lBytesRead > 0 );
+
+                if( lBytesRead == 0 )
+                {
+                    eResult = xImageSignatureFinish( xFileState.pvHashContext, C );
+                }
+                else
+                {
+                    LogError( ( "Failed to read back the OTA update file.\r\n" ) );
+                    vImageSignatureAbort( xFileState.pvHashContext );
+                }
+            }
+            else
+            {
+                LogError( ( "Failed to allocate memory to hash the OTA update file.\r\n" ) );
+                vImageSignatureAbort( xFileState.pvHashContext );
+                eResult = OtaPalOutOfMemory;
+            }
+
+            vPortFree( pucBuf );
+        }
+
+        /* The context was freed by the calls above. */
+        xFileState.pvHashContext = NULL;
     }
     else
     {
@@ -69,6 +69,9 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Pipelined HTTP requests. */
+#include "http_pipeline.h"
+
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
@@ -323,6 +326,19 @@
 /* HTTP buffers used for http request and response. */
 #define HTTP_USER_BUFFER_LENGTH                     ( otaconfigFILE_BLOCK_SIZE + HTTP_HEADER_SIZE_MAX )
 
+/**
+ * @brief Number of file block requests kept in flight on the HTTPS connection.
+ */
+#ifndef democonfigOTA_HTTP_PIPELINE_DEPTH
+    #define democonfigOTA_HTTP_PIPELINE_DEPTH       ( 1 )
+#endif
+
+/**
+ * @brief The name of the header that holds the size of the file in a partial
+ * content response.
+ */
+#define HTTP_CONTENT_RANGE_HEADER_FIELD             "Content-Range"
+
 /* Compile time error for some undefined configs, and provide default values
  * for others. */
 #ifndef democonfigMQTT_BROKER_ENDPOINT
@@ -655,6 +671,52 @@ static TransportInterface_t xTransportInterfaceHttp;
  */
 static const char * pcPath;
 
+#if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 )
+
+/**
+ * @brief A file block request that has been sent, and whose response has not
+ * been read yet.
+ */
+    typedef struct OtaHttpBlockRequest
+    {
+        uint32_t ulRangeStart;
+        uint32_t ulRangeEnd;
+    } OtaHttpBlockRequest_t;
+
+/**
+ * @brief The requests in flight on the HTTPS connection, oldest first.
+ */
+    static OtaHttpBlockRequest_t xInFlight[ democonfigOTA_HTTP_PIPELINE_DEPTH ];
+
+/**
+ * @brief Index in xInFlight of the oldest request.
+ */
+    static UBaseType_t uxInFlightHead;
+
+/**
+ * @brief Number of requests in xInFlight.
+ */
+    static UBaseType_t uxInFlightCount;
+
+/**
+ * @brief Size of the file being downloaded, taken from the first response. The
+ * blocks that follow are only requested ahead once it is known.
+ */
+    static uint32_t ulHttpFileSize;
+
+/**
+ * @brief Buffer the requests are serialized to. The requests that are sent
+ * ahead cannot share aucHttpUserBuffer, as responses may be waiting in it.
+ */
+    static uint8_t aucHttpRequestBuffer[ HTTP_HEADER_SIZE_MAX ];
+
+/**
+ * @brief Writes the requests to the HTTPS connection and reads the responses
+ * into aucHttpUserBuffer.
+ */
+    static HTTPPipeline_t xHttpPipeline;
+#endif /* democonfigOTA_HTTP_PIPELINE_DEPTH > 1 */
+
 /*---------------------------------------------------------*/
 
 /**
@@ -1847,6 +1909,148 @@ static OtaHttpStatus_t handleHttpResponse( const HTTPResponse_t * pResponse )
     return ret;
 }
 
+#if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 )
+
+    static void prvPipelineReset( void )
+    {
+        uxInFlightHead = 0U;
+        uxInFlightCount = 0U;
+        vHTTPPipeline_Reset( &xHttpPipeline );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static HTTPStatus_t prvPipelineSend( uint32_t ulRangeStart,
+                                         uint32_t ulRangeEnd )
+    {
+        HTTPStatus_t xHTTPStatus;
+
+        xHTTPStatus = xHTTPPipeline_Send( &xHttpPipeline, ulRangeStart, ulRangeEnd );
+
+        if( xHTTPStatus == HTTPSuccess )
+        {
+            xInFlight[ ( uxInFlightHead + uxInFlightCount ) % democonfigOTA_HTTP_PIPELINE_DEPTH ].ulRangeStart = ulRangeStart;
+            xInFlight[ ( uxInFlightHead + uxInFlightCount ) % democonfigOTA_HTTP_PIPELINE_DEPTH ].ulRangeEnd = ulRangeEnd;
+            uxInFlightCount++;
+        }
+
+        return xHTTPStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static HTTPStatus_t prvPipelineReceive( HTTPResponse_t * pxResponse )
+    {
+        const OtaHttpBlockRequest_t * pxRequest = &( xInFlight[ uxInFlightHead ] );
+
+        uxInFlightHead = ( uxInFlightHead + 1U ) % democonfigOTA_HTTP_PIPELINE_DEPTH;
+        uxInFlightCount--;
+
+        return xHTTPPipeline_Receive( &xHttpPipeline, pxRequest->ulRangeStart, pxRequest->ulRangeEnd, pxResponse );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvReadFileSize( const HTTPResponse_t * pxResponse )
+    {
+        const char * pcValue = NULL;
+        size_t xValueLength = 0U;
+        size_t xIndex = 0U;
+        uint32_t ulFileSize = 0U;
+
+        if( HTTPClient_ReadHeader( pxResponse,
+                                   HTTP_CONTENT_RANGE_HEADER_FIELD,
+                                   sizeof( HTTP_CONTENT_RANGE_HEADER_FIELD ) - 1,
+                                   &pcValue,
+                                   &xValueLength ) == HTTPSuccess )
+        {
+            /* The value has the form "bytes <first>-<last>/<size>". */
+            while( ( xIndex < xValueLength ) && ( pcValue[ xIndex ] != '/' ) )
+            {
+                xIndex++;
+            }
+
+            for( xIndex++; ( xIndex < xValueLength ) && ( pcValue[ xIndex ] >= '0' ) && ( pcValue[ xIndex ] <= '9' ); xIndex++ )
+            {
+                ulFileSize = ( ulFileSize * 10U ) + ( uint32_t ) ( pcValue[ xIndex ] - '0' );
+            }
+
+            ulHttpFileSize = ulFileSize;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static HTTPStatus_t prvPipelinedRequest( uint32_t ulRangeStart,
+                                             uint32_t ulRangeEnd,
+                                             HTTPResponse_t * pxResponse )
+    {
+        HTTPStatus_t xHTTPStatus = HTTPSuccess;
+        const OtaHttpBlockRequest_t * pxRequest;
+        uint32_t ulBlockLength = ulRangeEnd - ulRangeStart + 1U;
+        uint32_t ulNextStart;
+        uint32_t ulNextEnd;
+
+        /* The agent asks for a block again when it did not get it in time, so
+         * the block asked for need not be the next one in flight. The responses
+         * ahead of it are read and dropped. */
+        while( ( xHTTPStatus == HTTPSuccess ) && ( uxInFlightCount > 0U ) )
+        {
+            pxRequest = &( xInFlight[ uxInFlightHead ] );
+
+            if( ( pxRequest->ulRangeStart == ulRangeStart ) && ( pxRequest->ulRangeEnd == ulRangeEnd ) )
+            {
+                break;
+            }
+
+            LogDebug( ( "Dropping the prefetched bytes %u to %u.",
+                        ( unsigned ) pxRequest->ulRangeStart,
+                        ( unsigned ) pxRequest->ulRangeEnd ) );
+            xHTTPStatus = prvPipelineReceive( pxResponse );
+        }
+
+        if( ( xHTTPStatus == HTTPSuccess ) && ( uxInFlightCount == 0U ) )
+        {
+            xHTTPStatus = prvPipelineSend( ulRangeStart, ulRangeEnd );
+        }
+
+        /* Request the blocks that follow, so that the server is sending them
+         * while the agent processes this one. */
+        while( ( xHTTPStatus == HTTPSuccess ) &&
+               ( ulHttpFileSize > 0U ) &&
+               ( uxInFlightCount < democonfigOTA_HTTP_PIPELINE_DEPTH ) )
+        {
+            pxRequest = &( xInFlight[ ( uxInFlightHead + uxInFlightCount - 1U ) % democonfigOTA_HTTP_PIPELINE_DEPTH ] );
+            ulNextStart = pxRequest->ulRangeEnd + 1U;
+
+            if( ulNextStart >= ulHttpFileSize )
+            {
+                break;
+            }
+
+            ulNextEnd = ( ulBlockLength < ( ulHttpFileSize - ulNextStart ) ) ? ( ulNextStart + ulBlockLength - 1U ) : ( ulHttpFileSize - 1U );
+            xHTTPStatus = prvPipelineSend( ulNextStart, ulNextEnd );
+        }
+
+        if( xHTTPStatus == HTTPSuccess )
+        {
+            xHTTPStatus = prvPipelineReceive( pxResponse );
+        }
+
+        if( ( xHTTPStatus == HTTPSuccess ) &&
+            ( ulHttpFileSize == 0U ) &&
+            ( pxResponse->statusCode == HTTP_RESPONSE_PARTIAL_CONTENT ) )
+        {
+            prvReadFileSize( pxResponse );
+        }
+
+        return xHTTPStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* democonfigOTA_HTTP_PIPELINE_DEPTH > 1 */
+
 static OtaHttpStatus_t httpInit( char * pUrl )
 {
     /* OTA lib return error code. */
@@ -1895,6 +2099,27 @@ static OtaHttpStatus_t httpInit( char * pUrl )
                                  &xPathLen );
 
         ret = ( httpStatus == HTTPSuccess ) ? OtaHttpSuccess : OtaHttpInitFailed;
+
+        #if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 )
+            ( void ) memset( &xHttpPipeline, 0, sizeof( xHttpPipeline ) );
+            xHttpPipeline.xTransport = xTransportInterfaceHttp;
+            xHttpPipeline.pcHost = acServerHost;
+            xHttpPipeline.xHostLength = xServerHostLength;
+            xHttpPipeline.pucRequestBuffer = aucHttpRequestBuffer;
+            xHttpPipeline.xRequestBufferLength = sizeof( aucHttpRequestBuffer );
+            xHttpPipeline.pucResponseBuffer = aucHttpUserBuffer;
+            xHttpPipeline.xResponseBufferLength = HTTP_USER_BUFFER_LENGTH;
+
+            if( httpStatus == HTTPSuccess )
+            {
+                xHttpPipeline.pcPath = pcPath;
+                xHttpPipeline.xPathLength = strlen( pcPath );
+            }
+
+            /* The URL may be for another file. */
+            prvPipelineReset();
+            ulHttpFileSize = 0U;
+        #endif
     }
     else
     {
@@ -1915,13 +2140,15 @@ static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
     /* OTA lib return error code. */
     OtaHttpStatus_t ret = OtaHttpSuccess;
 
-    /* Configurations of the initial request headers that are passed to
-     * #HTTPClient_InitializeRequestHeaders. */
-    HTTPRequestInfo_t requestInfo;
+    #if ( democonfigOTA_HTTP_PIPELINE_DEPTH <= 1 )
+        /* Configurations of the initial request headers that are passed to
+         * #HTTPClient_InitializeRequestHeaders. */
+        HTTPRequestInfo_t requestInfo;
+        /* Represents header data that will be sent in an HTTP request. */
+        HTTPRequestHeaders_t requestHeaders;
+    #endif
     /* Represents a response returned from an HTTP server. */
     HTTPResponse_t response;
-    /* Represents header data that will be sent in an HTTP request. */
-    HTTPRequestHeaders_t requestHeaders;
 
     /* Return value of all methods from the HTTP Client library API. */
     HTTPStatus_t httpStatus = HTTPSuccess;
@@ -1929,52 +2156,65 @@ static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
     /* Reconnection required flag. */
     bool reconnectRequired = false;
 
-    /* Initialize all HTTP Client library API structs to 0. */
-    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
-    ( void ) memset( &response, 0, sizeof( response ) );
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
-
-    /* Initialize the request object. */
-    requestInfo.pHost = acServerHost;
-    requestInfo.hostLen = xServerHostLength;
-    requestInfo.pMethod = HTTP_METHOD_GET;
-    requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
-    requestInfo.pPath = pcPath;
-    requestInfo.pathLen = strlen( pcPath );
-
-    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
-     * can be sent over the same established TCP connection. */
-    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
-
-    /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = aucHttpUserBuffer;
-    requestHeaders.bufferLen = HTTP_USER_BUFFER_LENGTH;
-
-    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                      &requestInfo );
-
-    HTTPClient_AddRangeHeader( &requestHeaders, rangeStart, rangeEnd );
-
-    if( httpStatus == HTTPSuccess )
-    {
-        /* Initialize the response object. The same buffer used for storing
-         * request headers is reused here. */
-        response.pBuffer = aucHttpUserBuffer;
-        response.bufferLen = HTTP_USER_BUFFER_LENGTH;
-
-        /* Send the request and receive the response. */
-        httpStatus = HTTPClient_Send( &xTransportInterfaceHttp,
-                                      &requestHeaders,
-                                      NULL,
-                                      0,
-                                      &response,
-                                      0 );
-    }
-    else
-    {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
-                    HTTPClient_strerror( httpStatus ) ) );
-    }
+    #if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 )
+        ( void ) memset( &response, 0, sizeof( response ) );
+
+        httpStatus = prvPipelinedRequest( rangeStart, rangeEnd, &response );
+
+        /* After an error, where the next response starts is not known, so
+         * the requests in flight are dropped with the connection. */
+        if( httpStatus != HTTPSuccess )
+        {
+            reconnectRequired = true;
+        }
+    #else /* if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 ) */
+        /* Initialize all HTTP Client library API structs to 0. */
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        ( void ) memset( &response, 0, sizeof( response ) );
+        ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+
+        /* Initialize the request object. */
+        requestInfo.pHost = acServerHost;
+        requestInfo.hostLen = xServerHostLength;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
+        requestInfo.pPath = pcPath;
+        requestInfo.pathLen = strlen( pcPath );
+
+        /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
+         * can be sent over the same established TCP connection. */
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* Set the buffer used for storing request headers. */
+        requestHeaders.pBuffer = aucHttpUserBuffer;
+        requestHeaders.bufferLen = HTTP_USER_BUFFER_LENGTH;
+
+        httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                          &requestInfo );
+
+        HTTPClient_AddRangeHeader( &requestHeaders, rangeStart, rangeEnd );
+
+        if( httpStatus == HTTPSuccess )
+        {
+            /* Initialize the response object. The same buffer used for storing
+             * request headers is reused here. */
+            response.pBuffer = aucHttpUserBuffer;
+            response.bufferLen = HTTP_USER_BUFFER_LENGTH;
+
+            /* Send the request and receive the response. */
+            httpStatus = HTTPClient_Send( &xTransportInterfaceHttp,
+                                          &requestHeaders,
+                                          NULL,
+                                          0,
+                                          &response,
+                                          0 );
+        }
+        else
+        {
+            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+        }
+    #endif /* if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 ) */
 
     if( httpStatus != HTTPSuccess )
     {
@@ -2004,6 +2244,11 @@ static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
 
     if( reconnectRequired == true )
     {
+        #if ( democonfigOTA_HTTP_PIPELINE_DEPTH > 1 )
+            /* The requests in flight are lost with the connection. */
+            prvPipelineReset();
+        #endif
+
         /* End TLS session, then close TCP connection. */
         TLS_FreeRTOS_Disconnect( &xNetworkContextHttp );
 
@@ -244,6 +244,16 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigDISABLE_SNI                ( pdFALSE )
 
+/**
+ * @brief Number of file block requests kept in flight on the HTTPS connection.
+ *
+ * The OTA agent asks for one block at a time. When this is more than 1, the
+ * requests for the blocks that follow are sent before the response to the
+ * current one is read, so that the server is streaming them while the agent
+ * writes and hashes the current block. 1 sends one request at a time.
+ */
+#define democonfigOTA_HTTP_PIPELINE_DEPTH    ( 1 )
+
 /**
  * @brief Configuration that indicates if the demo connection is made to the AWS IoT Core MQTT broker.
  *
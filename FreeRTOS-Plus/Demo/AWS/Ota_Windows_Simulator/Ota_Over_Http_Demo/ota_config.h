@@ -197,4 +197,25 @@ extern void vLoggingPrintf( const char * pcFormatString,
 
 #define configOTA_PRIMARY_DATA_PROTOCOL    ( OTA_DATA_OVER_HTTP )
 
+/**
+ * @brief Size of each of the two buffers the Windows PAL gathers received blocks in.
+ *
+ * While a separate task writes one buffer to the image file, the OTA agent hashes the
+ * next blocks and copies them to the other one. Set this to 0 to write each block as
+ * it is received.
+ */
+#define otapalconfigWRITE_BUFFER_SIZE    0
+
+/**
+ * @brief Write the image to a file on a Reliance Edge volume instead of a Windows file.
+ *
+ * The application must mount the volume before an update starts, and the Reliance Edge
+ * sources must be added to the project. The file descriptor is then the OTA file type.
+ */
+#define otapalconfigUSE_RELIANCE_EDGE    0
+
+#if ( otapalconfigUSE_RELIANCE_EDGE == 1 )
+    #define otaconfigOTA_FILE_TYPE    int32_t
+#endif
+
 #endif /* OTA_CONFIG_H_ */
@@ -33,6 +33,7 @@
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
 
 /* FreeRTOS+TCP includes. */
 #include "FreeRTOS_IP.h"
@@ -51,10 +52,26 @@
     static void prvReceiveNewClient( TCPServer_t * pxServer,
                                      BaseType_t xIndex,
                                      Socket_t xNexSocket );
+/* Returns pdTRUE if the last select() reported an event for one of the
+ * sockets of the client. */
+    static BaseType_t prvClientIsReady( TCPServer_t * pxServer,
+                                        TCPClient_t * pxClient );
     static char * strnew( const char * pcString );
 /* Remove slashes at the end of a path. */
     static void prvRemoveSlash( char * pcDir );
 
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+        static void prvCreateWorkers( TCPServer_t * pxServer,
+                                      const struct xSERVER_CONFIG * pxConfigs,
+                                      BaseType_t xCount );
+        static void prvWorkerTask( void * pvParameters );
+/* Give a new client to the worker with the fewest clients. */
+        static BaseType_t prvHandOverClient( TCPServer_t * pxServer,
+                                             TCPClient_t * pxClient );
+/* Called by a worker to take the clients handed over to it. */
+        static void prvAdoptNewClients( TCPServer_t * pxWorker );
+    #endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+
     TCPServer_t * FreeRTOS_CreateTCPServer( const struct xSERVER_CONFIG * pxConfigs,
                                             BaseType_t xCount )
     {
@@ -144,6 +161,12 @@
                         }
                     }
                 }
+
+                #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+                {
+                    prvCreateWorkers( pxServer, pxConfigs, xCount );
+                }
+                #endif
             }
             else
             {
@@ -203,31 +226,15 @@
             pxClient = ( TCPClient_t * ) pvPortMallocLarge( xSize );
         }
 
-        if( pxClient != NULL )
-        {
-            memset( pxClient, '\0', xSize );
-
-            /* Put the new client in front of the list. */
-            pxClient->eType = pxServer->xServers[ xIndex ].eType;
-            pxClient->pcRootDir = pxServer->xServers[ xIndex ].pcRootDir;
-            pxClient->pxParent = pxServer;
-            pxClient->xSocket = xNexSocket;
-            pxClient->pxNextClient = pxServer->pxClients;
-            pxClient->fWorkFunction = fWorkFunc;
-            pxClient->fDeleteFunction = fDeleteFunc;
-            pxServer->pxClients = pxClient;
-
-            FreeRTOS_FD_SET( xNexSocket, pxServer->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
-        }
-        else
+        if( pxClient == NULL )
         {
             pcType = "closed";
-            FreeRTOS_closesocket( xNexSocket );
         }
 
+        /* Log before the client is handed over, a worker may close it at once. */
         {
             struct freertos_sockaddr xRemoteAddress;
-            FreeRTOS_GetRemoteAddress( pxClient->xSocket, &xRemoteAddress );
+            FreeRTOS_GetRemoteAddress( xNexSocket, &xRemoteAddress );
             #if defined( ipconfigIPv4_BACKWARD_COMPATIBLE ) && ( ipconfigIPv4_BACKWARD_COMPATIBLE == 0 )
             {
                 FreeRTOS_printf( ( "TPC-server: new %s client %xip\n", pcType, ( unsigned ) FreeRTOS_ntohl( xRemoteAddress.sin_address.ulIP_IPv4 ) ) );
@@ -239,6 +246,35 @@
             #endif /* defined( ipconfigIPv4_BACKWARD_COMPATIBLE ) && ( ipconfigIPv4_BACKWARD_COMPATIBLE == 0 ) */
         }
 
+        if( pxClient != NULL )
+        {
+            memset( pxClient, '\0', xSize );
+
+            pxClient->eType = pxServer->xServers[ xIndex ].eType;
+            pxClient->pcRootDir = pxServer->xServers[ xIndex ].pcRootDir;
+            pxClient->pxParent = pxServer;
+            pxClient->xSocket = xNexSocket;
+            pxClient->fWorkFunction = fWorkFunc;
+            pxClient->fDeleteFunction = fDeleteFunc;
+            /* Let the work function run once, e.g. to send a welcome message. */
+            pxClient->xWorkPending = pdTRUE;
+
+            #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+                if( prvHandOverClient( pxServer, pxClient ) == pdFALSE )
+            #endif
+            {
+                /* Put the new client in front of the list. */
+                pxClient->pxNextClient = pxServer->pxClients;
+                pxServer->pxClients = pxClient;
+
+                FreeRTOS_FD_SET( xNexSocket, pxServer->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
+            }
+        }
+        else
+        {
+            FreeRTOS_closesocket( xNexSocket );
+        }
+
         /* Remove compiler warnings in case FreeRTOS_printf() is not used. */
         ( void ) pcType;
     }
@@ -250,6 +286,18 @@
         TCPClient_t ** ppxClient;
         BaseType_t xIndex;
         BaseType_t xRc;
+        BaseType_t xResult;
+
+        /* Do not block when a client wants to be called without waiting for an
+         * event. */
+        for( ppxClient = &pxServer->pxClients; ( *ppxClient ) != NULL; ppxClient = &( ( *ppxClient )->pxNextClient ) )
+        {
+            if( ( *ppxClient )->xWorkPending != pdFALSE )
+            {
+                xBlockingTime = 0;
+                break;
+            }
+        }
 
         /* Let the server do one working cycle */
         xRc = FreeRTOS_select( pxServer->xSocketSet, xBlockingTime );
@@ -262,7 +310,8 @@
                 Socket_t xNexSocket;
                 socklen_t xSocketLength;
 
-                if( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET )
+                if( ( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET ) ||
+                    ( FreeRTOS_FD_ISSET( pxServer->xServers[ xIndex ].xSocket, pxServer->xSocketSet ) == 0 ) )
                 {
                     continue;
                 }
@@ -277,22 +326,48 @@
             }
         }
 
+        #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+        {
+            if( pxServer->xNewClients != NULL )
+            {
+                prvAdoptNewClients( pxServer );
+            }
+        }
+        #endif
+
         ppxClient = &pxServer->pxClients;
 
         while( ( *ppxClient ) != NULL )
         {
             TCPClient_t * pxThis = *ppxClient;
 
+            /* Only clients with an event, or which asked for it, are called.
+             * Idle connections cost nothing. */
+            if( ( pxThis->xWorkPending == pdFALSE ) &&
+                ( ( xRc == 0 ) || ( prvClientIsReady( pxServer, pxThis ) == pdFALSE ) ) )
+            {
+                ppxClient = &( pxThis->pxNextClient );
+                continue;
+            }
+
+            pxThis->xWorkPending = pdFALSE;
+
             /* Almost C++ */
-            xRc = pxThis->fWorkFunction( pxThis );
+            xResult = pxThis->fWorkFunction( pxThis );
 
-            if( xRc < 0 )
+            if( xResult < 0 )
             {
                 *ppxClient = pxThis->pxNextClient;
                 /* Close handles, resources */
                 pxThis->fDeleteFunction( pxThis );
                 /* Free the space */
                 vPortFreeLarge( pxThis );
+
+                #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+                {
+                    pxServer->uxClientsReleased++;
+                }
+                #endif
             }
             else
             {
@@ -302,6 +377,150 @@
     }
 /*-----------------------------------------------------------*/
 
+    static BaseType_t prvClientIsReady( TCPServer_t * pxServer,
+                                        TCPClient_t * pxClient )
+    {
+        BaseType_t xReady = pdFALSE;
+
+        if( ( pxClient->xSocket != FREERTOS_NO_SOCKET ) &&
+            ( FreeRTOS_FD_ISSET( pxClient->xSocket, pxServer->xSocketSet ) != 0 ) )
+        {
+            xReady = pdTRUE;
+        }
+
+        #if ( ipconfigUSE_FTP != 0 )
+        {
+            /* An FTP client also owns a data socket. */
+            if( ( xReady == pdFALSE ) && ( pxClient->eType == eSERVER_FTP ) )
+            {
+                FTPClient_t * pxFTPClient = ( FTPClient_t * ) pxClient;
+
+                if( ( pxFTPClient->xTransferSocket != FREERTOS_NO_SOCKET ) &&
+                    ( FreeRTOS_FD_ISSET( pxFTPClient->xTransferSocket, pxServer->xSocketSet ) != 0 ) )
+                {
+                    xReady = pdTRUE;
+                }
+            }
+        }
+        #endif /* ipconfigUSE_FTP != 0 */
+
+        return xReady;
+    }
+/*-----------------------------------------------------------*/
+
+    BaseType_t xTCPServerSendFile( Socket_t xSocket,
+                                   FF_FILE * pxFile,
+                                   size_t * puxBytesLeft,
+                                   char * pcBuffer,
+                                   size_t uxBufferSize,
+                                   BaseType_t xCloseWhenDone )
+    {
+        BaseType_t xTotal = 0;
+        BaseType_t xRc = 0;
+
+        while( *puxBytesLeft > 0u )
+        {
+            size_t uxAvailable = ( size_t ) FreeRTOS_tx_space( xSocket );
+            size_t uxCount;
+            char * pcData = NULL;
+
+            if( uxAvailable > *puxBytesLeft )
+            {
+                uxAvailable = *puxBytesLeft;
+            }
+
+            uxCount = uxAvailable;
+
+            if( uxCount == 0u )
+            {
+                /* The TX stream is full. */
+                break;
+            }
+
+            #if ( ipconfigTCP_SERVER_TX_ZERO_COPY != 0 )
+            {
+                BaseType_t xStreamLength = 0;
+
+                /* The space up to the end of the circular TX stream. */
+                pcData = ( char * ) FreeRTOS_get_tx_head( xSocket, &xStreamLength );
+
+                if( ( pcData != NULL ) && ( xStreamLength > 0 ) )
+                {
+                    if( uxCount > ( size_t ) xStreamLength )
+                    {
+                        uxCount = ( size_t ) xStreamLength;
+                    }
+
+                    /* Keep reading whole sectors, except at the end of the file. */
+                    if( ( uxCount < *puxBytesLeft ) && ( uxCount >= 512u ) )
+                    {
+                        uxCount &= ~( ( size_t ) 512u - 1u );
+                    }
+                    else if( uxCount < *puxBytesLeft )
+                    {
+                        /* Just a few bytes before the stream wraps, use the
+                         * buffer so that the data can wrap with it. */
+                        pcData = NULL;
+                    }
+                }
+                else
+                {
+                    pcData = NULL;
+                }
+            }
+            #endif /* ipconfigTCP_SERVER_TX_ZERO_COPY */
+
+            if( pcData == NULL )
+            {
+                uxCount = uxAvailable;
+
+                if( uxCount > uxBufferSize )
+                {
+                    uxCount = uxBufferSize;
+                }
+
+                if( ff_fread( pcBuffer, 1, uxCount, pxFile ) != uxCount )
+                {
+                    xRc = -pdFREERTOS_ERRNO_EIO;
+                    break;
+                }
+            }
+            else if( ff_fread( pcData, 1, uxCount, pxFile ) != uxCount )
+            {
+                xRc = -pdFREERTOS_ERRNO_EIO;
+                break;
+            }
+
+            *puxBytesLeft -= uxCount;
+
+            if( ( *puxBytesLeft == 0u ) && ( xCloseWhenDone != pdFALSE ) )
+            {
+                BaseType_t xTrueValue = 1;
+
+                FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+            }
+
+            /* A NULL buffer tells FreeRTOS_send() that the data is already in
+             * the TX stream. */
+            xRc = FreeRTOS_send( xSocket, ( pcData == NULL ) ? pcBuffer : NULL, uxCount, 0 );
+
+            if( xRc < 0 )
+            {
+                break;
+            }
+
+            xTotal += xRc;
+        }
+
+        if( xRc >= 0 )
+        {
+            xRc = xTotal;
+        }
+
+        return xRc;
+    }
+/*-----------------------------------------------------------*/
+
     static char * strnew( const char * pcString )
     {
         BaseType_t xLength;
@@ -330,6 +549,167 @@
     }
 /*-----------------------------------------------------------*/
 
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+
+        static void prvCreateWorkers( TCPServer_t * pxServer,
+                                      const struct xSERVER_CONFIG * pxConfigs,
+                                      BaseType_t xCount )
+        {
+            UBaseType_t uxQueueLength = 1u;
+            BaseType_t xIndex;
+
+            /* A worker can not be handed more clients than the listening sockets
+             * can queue. */
+            for( xIndex = 0; xIndex < xCount; xIndex++ )
+            {
+                uxQueueLength += ( UBaseType_t ) pxConfigs[ xIndex ].xBackLog;
+            }
+
+            for( xIndex = 0; xIndex < ipconfigTCP_SERVER_WORKER_COUNT; xIndex++ )
+            {
+                TCPServer_t * pxWorker;
+
+                pxWorker = ( TCPServer_t * ) pvPortMallocLarge( sizeof( *pxWorker ) );
+
+                if( pxWorker == NULL )
+                {
+                    break;
+                }
+
+                /* A worker is a server without listening sockets. */
+                memset( pxWorker, '\0', sizeof( *pxWorker ) );
+                pxWorker->xSocketSet = FreeRTOS_CreateSocketSet();
+                pxWorker->xNewClients = xQueueCreate( uxQueueLength, sizeof( TCPClient_t * ) );
+                pxWorker->xSignalSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP );
+
+                if( ( pxWorker->xSocketSet != NULL ) &&
+                    ( pxWorker->xNewClients != NULL ) &&
+                    ( pxWorker->xSignalSocket != FREERTOS_INVALID_SOCKET ) )
+                {
+                    /* This socket never receives data.  It is only there so that
+                     * FreeRTOS_SignalSocket() can interrupt the worker's select(). */
+                    FreeRTOS_FD_SET( pxWorker->xSignalSocket, pxWorker->xSocketSet, eSELECT_READ );
+
+                    if( xTaskCreate( prvWorkerTask, "TCPWork", ipconfigTCP_SERVER_WORKER_STACK_SIZE,
+                                     ( void * ) pxWorker, ipconfigTCP_SERVER_WORKER_PRIORITY, NULL ) == pdPASS )
+                    {
+                        pxServer->pxWorkers[ pxServer->xWorkerCount++ ] = pxWorker;
+                        continue;
+                    }
+                }
+
+                if( pxWorker->xSignalSocket != FREERTOS_INVALID_SOCKET )
+                {
+                    FreeRTOS_closesocket( pxWorker->xSignalSocket );
+                }
+
+                if( pxWorker->xNewClients != NULL )
+                {
+                    vQueueDelete( pxWorker->xNewClients );
+                }
+
+                if( pxWorker->xSocketSet != NULL )
+                {
+                    FreeRTOS_DeleteSocketSet( pxWorker->xSocketSet );
+                }
+
+                vPortFreeLarge( pxWorker );
+                break;
+            }
+
+            /* Without workers, the clients are served by the listening task. */
+            FreeRTOS_printf( ( "TCP-server: %d worker tasks\n", ( int ) pxServer->xWorkerCount ) );
+        }
+
+    #endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+
+        static void prvWorkerTask( void * pvParameters )
+        {
+            TCPServer_t * pxWorker = ( TCPServer_t * ) pvParameters;
+
+            for( ; ; )
+            {
+                /* Sleeps until one of its clients has an event, or until the
+                 * listening task hands over a new client. */
+                FreeRTOS_TCPServerWork( pxWorker, portMAX_DELAY );
+            }
+        }
+
+    #endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+
+        static BaseType_t prvHandOverClient( TCPServer_t * pxServer,
+                                             TCPClient_t * pxClient )
+        {
+            TCPServer_t * pxWorker = NULL;
+            UBaseType_t uxLowest = 0u;
+            BaseType_t xIndex;
+            BaseType_t xResult = pdFALSE;
+
+            for( xIndex = 0; xIndex < pxServer->xWorkerCount; xIndex++ )
+            {
+                TCPServer_t * pxCandidate = pxServer->pxWorkers[ xIndex ];
+                UBaseType_t uxCount = pxCandidate->uxClientsAssigned - pxCandidate->uxClientsReleased;
+
+                if( ( pxWorker == NULL ) || ( uxCount < uxLowest ) )
+                {
+                    pxWorker = pxCandidate;
+                    uxLowest = uxCount;
+                }
+            }
+
+            if( pxWorker != NULL )
+            {
+                /* The socket set and its buffers will be those of the worker. */
+                pxClient->pxParent = pxWorker;
+
+                /* A new socket inherits the socket set of the listening
+                 * socket.  Leave that set before the worker can adopt the
+                 * socket and add it to its own set. */
+                FreeRTOS_FD_CLR( pxClient->xSocket, pxServer->xSocketSet, eSELECT_ALL );
+
+                if( xQueueSend( pxWorker->xNewClients, &pxClient, 0 ) == pdPASS )
+                {
+                    pxWorker->uxClientsAssigned++;
+                    FreeRTOS_SignalSocket( pxWorker->xSignalSocket );
+                    xResult = pdTRUE;
+                }
+                else
+                {
+                    pxClient->pxParent = pxServer;
+                    FreeRTOS_FD_SET( pxClient->xSocket, pxServer->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
+                }
+            }
+
+            return xResult;
+        }
+
+    #endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+
+        static void prvAdoptNewClients( TCPServer_t * pxWorker )
+        {
+            TCPClient_t * pxClient;
+
+            while( xQueueReceive( pxWorker->xNewClients, &pxClient, 0 ) == pdPASS )
+            {
+                pxClient->pxNextClient = pxWorker->pxClients;
+                pxWorker->pxClients = pxClient;
+
+                FreeRTOS_FD_SET( pxClient->xSocket, pxWorker->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
+            }
+        }
+
+    #endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
     #if ( ipconfigSUPPORT_SIGNALS != 0 )
 
 /* FreeRTOS_TCPServerWork() calls select().
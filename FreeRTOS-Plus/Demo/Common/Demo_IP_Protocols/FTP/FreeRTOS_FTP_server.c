@@ -96,6 +96,27 @@
         #define ipconfigFTP_ZERO_COPY_ALIGNED_WRITES    0
     #endif
 
+/*
+ * The buffer and window sizes of a data connection.  ipconfigFTP_TX_BUFSIZE
+ * and ipconfigFTP_TX_WINSIZE are used for the direction that carries a file or
+ * a listing to the client, ipconfigFTP_RX_BUFSIZE and ipconfigFTP_RX_WINSIZE
+ * for a file that is stored.  The other direction of a transfer only carries
+ * ACKs, so it gets ipconfigFTP_ACK_BUFSIZE bytes and a window of one segment.
+ * The streams are only allocated when data flows, so large bulk sizes cost no
+ * memory on an idle data connection.  Concurrent transfers are served in
+ * parallel when ipconfigTCP_SERVER_WORKER_COUNT is non-zero.
+ */
+    #if ( ipconfigFTP_TX_BUFSIZE > 0 )
+        #ifndef ipconfigFTP_ACK_BUFSIZE
+            #define ipconfigFTP_ACK_BUFSIZE    ( ipconfigTCP_MSS )
+        #endif
+    #endif
+
+/* The direction of a transfer, see prvTransferSetSizes(). */
+    #define ftpTRANSFER_UNKNOWN    0
+    #define ftpTRANSFER_SEND       1
+    #define ftpTRANSFER_RECEIVE    2
+
 /*
  * This module only has 2 public functions:
  */
@@ -115,6 +136,16 @@
     static BaseType_t prvTransferConnect( FTPClient_t * pxClient,
                                           BaseType_t xDoListen );
 
+/*
+ * Give the data socket the buffer and window sizes for a transfer in the
+ * direction xDirection.  The sizes can only be changed as long as no data has
+ * been exchanged.
+ */
+    #if ( ipconfigFTP_TX_BUFSIZE > 0 )
+        static void prvTransferSetSizes( Socket_t xSocket,
+                                         BaseType_t xDirection );
+    #endif
+
 /*
  * Either call listen() or connect() to start the transfer connection.
  */
@@ -255,6 +286,13 @@
     static BaseType_t prvGetFileInfoStat( FF_DirEnt_t * pxEntry,
                                           char * pcLine,
                                           BaseType_t xMaxLength );
+    static char * prvAppendString( char * pcPtr,
+                                   const char * pcString,
+                                   BaseType_t xWidth );
+    static char * prvAppendNumber( char * pcPtr,
+                                   uint32_t ulValue,
+                                   BaseType_t xWidth,
+                                   char cPadding );
 
 /*
  * Send a reply to a socket, either the command- or the data-socket.
@@ -285,9 +323,11 @@
  ####     #### ####           ## ##   ####  ####    ##   ##
  ####
  *	xFTPClientWork()
- *	will be called by FreeRTOS_TCPServerWork(), after select has expired().
- *	FD_ISSET will not be used.  This work function will always be called at
- *	regular intervals, and also after a select() event has occurred.
+ *	will be called by FreeRTOS_TCPServerWork() once after the client has
+ *	connected, and after that only when select() reports an event for either
+ *	the command socket or the data socket.  Whatever must be done later, must
+ *	be waited for with FreeRTOS_FD_SET(), e.g. eSELECT_WRITE while a transfer
+ *	is waiting for space in the TX stream.
  */
     BaseType_t xFTPClientWork( TCPClient_t * pxTCPClient )
     {
@@ -840,6 +880,18 @@
                             prvTransferCheck( pxClient );
                         }
 
+                        #if ( ipconfigFTP_TX_BUFSIZE > 0 )
+                        {
+                            /* Now that the direction is known, shrink the
+                             * buffer of the side that only carries ACKs. */
+                            if( pxClient->xTransferSocket != FREERTOS_NO_SOCKET )
+                            {
+                                prvTransferSetSizes( pxClient->xTransferSocket,
+                                                     ( pxFTPCommand->ucCommandType == ECMD_STOR ) ? ftpTRANSFER_RECEIVE : ftpTRANSFER_SEND );
+                            }
+                        }
+                        #endif /* ipconfigFTP_TX_BUFSIZE > 0 */
+
                         switch( pxFTPCommand->ucCommandType )
                         {
                             case ECMD_LIST:
@@ -936,10 +988,6 @@
             BaseType_t xSmallTimeout = pdMS_TO_TICKS( 100 );
             struct freertos_sockaddr xAddress;
 
-            #if ( ipconfigFTP_TX_BUFSIZE > 0 )
-                WinProperties_t xWinProps;
-            #endif
-
             #if defined( ipconfigIPv4_BACKWARD_COMPATIBLE ) && ( ipconfigIPv4_BACKWARD_COMPATIBLE == 0 )
             {
                 xAddress.sin_address.ulIP_IPv4 = FreeRTOS_GetIPAddress(); /* Single NIC, currently not used */
@@ -964,15 +1012,11 @@
 
             #if ( ipconfigFTP_TX_BUFSIZE > 0 )
             {
-                /* Fill in the buffer and window sizes that will be used by the
-                 * socket. */
-                xWinProps.lTxBufSize = ipconfigFTP_TX_BUFSIZE;
-                xWinProps.lTxWinSize = ipconfigFTP_TX_WINSIZE;
-                xWinProps.lRxBufSize = ipconfigFTP_RX_BUFSIZE;
-                xWinProps.lRxWinSize = ipconfigFTP_RX_WINSIZE;
-
-                /* Set the window and buffer sizes. */
-                FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_WIN_PROPERTIES, ( void * ) &xWinProps, sizeof( xWinProps ) );
+                /* The direction is not known until RETR, STOR or LIST is
+                 * received.  A passive connection may be made before that, and
+                 * the window scaling is settled in the SYN, so start with the
+                 * bulk sizes in both directions. */
+                prvTransferSetSizes( xSocket, ftpTRANSFER_UNKNOWN );
             }
             #endif /* if ( ipconfigFTP_TX_BUFSIZE > 0 ) */
 
@@ -1018,6 +1062,51 @@
     }
 /*-----------------------------------------------------------*/
 
+    #if ( ipconfigFTP_TX_BUFSIZE > 0 )
+
+        static void prvTransferSetSizes( Socket_t xSocket,
+                                         BaseType_t xDirection )
+        {
+            WinProperties_t xWinProps;
+            BaseType_t xResult;
+
+            /* Fill in the buffer and window sizes that will be used by the
+             * socket. */
+            if( xDirection == ftpTRANSFER_RECEIVE )
+            {
+                xWinProps.lTxBufSize = ipconfigFTP_ACK_BUFSIZE;
+                xWinProps.lTxWinSize = 1;
+            }
+            else
+            {
+                xWinProps.lTxBufSize = ipconfigFTP_TX_BUFSIZE;
+                xWinProps.lTxWinSize = ipconfigFTP_TX_WINSIZE;
+            }
+
+            if( xDirection == ftpTRANSFER_SEND )
+            {
+                xWinProps.lRxBufSize = ipconfigFTP_ACK_BUFSIZE;
+                xWinProps.lRxWinSize = 1;
+            }
+            else
+            {
+                xWinProps.lRxBufSize = ipconfigFTP_RX_BUFSIZE;
+                xWinProps.lRxWinSize = ipconfigFTP_RX_WINSIZE;
+            }
+
+            /* Set the window and buffer sizes.  This fails once a stream has
+             * been created, the sizes of the previous call remain in use. */
+            xResult = FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_WIN_PROPERTIES, ( void * ) &xWinProps, sizeof( xWinProps ) );
+
+            if( xResult != 0 )
+            {
+                FreeRTOS_printf( ( "prvTransferSetSizes: direction %d: rc %d\n", ( int ) xDirection, ( int ) xResult ) );
+            }
+        }
+
+    #endif /* ipconfigFTP_TX_BUFSIZE > 0 */
+/*-----------------------------------------------------------*/
+
     static BaseType_t prvTransferStart( FTPClient_t * pxClient )
     {
         BaseType_t xResult;
@@ -1802,144 +1891,24 @@
 
     static BaseType_t prvRetrieveFileWork( FTPClient_t * pxClient )
     {
-        size_t uxSpace;
-        size_t uxCount, uxItemsRead;
-        BaseType_t xRc = 0;
+        BaseType_t xRc;
         BaseType_t xSetEvent = pdFALSE;
 
-        do
-        {
-            #if ( ipconfigFTP_TX_ZERO_COPY != 0 )
-                char * pcBuffer;
-                BaseType_t xBufferLength;
-            #endif /* ipconfigFTP_TX_ZERO_COPY */
-
-            /* Take the lesser of the two: tx_space (number of bytes that can be
-             * queued for transmission) and uxBytesLeft (the number of bytes left to
-             * read from the file) */
-            uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
-
-            if( uxSpace == 0 )
-            {
-                FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE | eSELECT_EXCEPT );
-                xRc = FreeRTOS_select( pxClient->pxParent->xSocketSet, 200 );
-                uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
-            }
-
-            uxCount = FreeRTOS_min_uint32( pxClient->uxBytesLeft, uxSpace );
-
-            if( uxCount == 0 )
-            {
-                break;
-            }
-
-            #if ( ipconfigFTP_TX_ZERO_COPY == 0 )
-            {
-                if( uxCount > sizeof( pcFILE_BUFFER ) )
-                {
-                    uxCount = sizeof( pcFILE_BUFFER );
-                }
-
-                uxItemsRead = ff_fread( pcFILE_BUFFER, 1, uxCount, pxClient->pxReadHandle );
-
-                if( uxItemsRead != uxCount )
-                {
-                    FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
-                    xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-                    pxClient->uxBytesLeft = 0u;
-                    break;
-                }
-
-                pxClient->uxBytesLeft -= uxCount;
-
-                if( pxClient->uxBytesLeft == 0u )
-                {
-                    BaseType_t xTrueValue = 1;
-
-                    FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
-                }
-
-                xRc = FreeRTOS_send( pxClient->xTransferSocket, pcFILE_BUFFER, uxCount, 0 );
-            }
-            #else /* ipconfigFTP_TX_ZERO_COPY != 0 */
-            {
-                /* Use zero-copy transmission:
-                 * FreeRTOS_get_tx_head() returns a direct pointer to the TX stream and
-                 * set xBufferLength to know how much space there is left. */
-                pcBuffer = ( char * ) FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xBufferLength );
-
-                if( ( pcBuffer != NULL ) && ( xBufferLength >= 512 ) )
-                {
-                    /* Will read disk data directly to the TX stream of the socket. */
-                    uxCount = FreeRTOS_min_uint32( uxCount, ( uint32_t ) xBufferLength );
-
-                    if( uxCount > ( size_t ) 0x40000u )
-                    {
-                        uxCount = ( size_t ) 0x40000u;
-                    }
-                }
-                else
-                {
-                    /* Use the normal file i/o buffer. */
-                    pcBuffer = pcFILE_BUFFER;
-
-                    if( uxCount > sizeof( pcFILE_BUFFER ) )
-                    {
-                        uxCount = sizeof( pcFILE_BUFFER );
-                    }
-                }
-
-                if( pxClient->uxBytesLeft >= 1024u )
-                {
-                    uxCount &= ~( ( size_t ) 512u - 1u );
-                }
-
-                if( uxCount <= 0u )
-                {
-                    /* Nothing to send after rounding down to a multiple of a sector size. */
-                    break;
-                }
-
-                uxItemsRead = ff_fread( pcBuffer, 1, uxCount, pxClient->pxReadHandle );
-
-                if( uxCount != uxItemsRead )
-                {
-                    FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
-                    xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-                    pxClient->uxBytesLeft = 0u;
-                    break;
-                }
-
-                pxClient->uxBytesLeft -= uxCount;
-
-                if( pxClient->uxBytesLeft == 0u )
-                {
-                    BaseType_t xTrueValue = 1;
-
-                    FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
-                }
-
-                if( pcBuffer != pcFILE_BUFFER )
-                {
-                    pcBuffer = NULL;
-                }
-
-                xRc = FreeRTOS_send( pxClient->xTransferSocket, pcBuffer, uxCount, 0 );
-            }
-            #endif /* ipconfigFTP_TX_ZERO_COPY */
-
-            if( xRc < 0 )
-            {
-                break;
-            }
+        /* Fill the TX stream as far as it goes, preferably by reading the file
+         * straight into it.  The connection will be closed after the last byte. */
+        xRc = xTCPServerSendFile( pxClient->xTransferSocket, pxClient->pxReadHandle, &( pxClient->uxBytesLeft ),
+                                  pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), pdTRUE );
 
+        if( xRc == -pdFREERTOS_ERRNO_EIO )
+        {
+            FreeRTOS_printf( ( "prvRetrieveFileWork: read error, %u bytes left\n", ( unsigned ) pxClient->uxBytesLeft ) );
+            xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+            pxClient->uxBytesLeft = 0u;
+        }
+        else if( xRc > 0 )
+        {
             pxClient->ulRecvBytes += xRc;
-
-            if( pxClient->uxBytesLeft == 0u )
-            {
-                break;
-            }
-        } while( uxCount > 0u );
+        }
 
         if( xRc < 0 )
         {
@@ -2040,7 +2009,9 @@
     }
 /*-----------------------------------------------------------*/
 
-    #define MAX_DIR_LIST_ENTRY_SIZE    256
+/* The longest line of a listing: the fields before the name take less than
+ * 64 bytes. */
+    #define MAX_DIR_LIST_ENTRY_SIZE    ( 64 + ffconfigMAX_FILENAME )
 
     static BaseType_t prvListSendWork( FTPClient_t * pxClient )
     {
@@ -2048,9 +2019,15 @@
 
         while( pxClient->bits1.bClientConnected != pdFALSE_UNSIGNED )
         {
-            char * pcWritePtr = pcCOMMAND_BUFFER;
+            char * pcWriteStart = pcCOMMAND_BUFFER;
+            char * pcWritePtr;
             BaseType_t xWriteLength;
 
+            #if ( ipconfigTCP_SERVER_TX_ZERO_COPY != 0 )
+                BaseType_t xStreamLength = 0;
+                char * pcHead;
+            #endif
+
             xTxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
 
             if( xTxSpace > ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) )
@@ -2058,6 +2035,23 @@
                 xTxSpace = sizeof( pcCOMMAND_BUFFER );
             }
 
+            #if ( ipconfigTCP_SERVER_TX_ZERO_COPY != 0 )
+            {
+                pcHead = ( char * ) FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xStreamLength );
+
+                if( ( pcHead != NULL ) && ( xStreamLength >= MAX_DIR_LIST_ENTRY_SIZE ) )
+                {
+                    /* Write the lines straight into the TX stream, up to the
+                     * point where it wraps.  Near the end of the stream, the
+                     * command buffer is used, so that the lines can wrap. */
+                    pcWriteStart = pcHead;
+                    xTxSpace = xStreamLength;
+                }
+            }
+            #endif /* ipconfigTCP_SERVER_TX_ZERO_COPY */
+
+            pcWritePtr = pcWriteStart;
+
             while( ( xTxSpace >= MAX_DIR_LIST_ENTRY_SIZE ) && ( pxClient->bits1.bDirHasEntry != pdFALSE_UNSIGNED ) )
             {
                 BaseType_t xLength, xEndOfDir;
@@ -2085,7 +2079,7 @@
                 }
             }
 
-            xWriteLength = ( BaseType_t ) ( pcWritePtr - pcCOMMAND_BUFFER );
+            xWriteLength = ( BaseType_t ) ( pcWritePtr - pcWriteStart );
 
             if( xWriteLength == 0 )
             {
@@ -2119,7 +2113,11 @@
                     FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
                 }
 
-                prvSendReply( pxClient->xTransferSocket, pcCOMMAND_BUFFER, xWriteLength );
+                /* A NULL buffer tells FreeRTOS_send() that the data is already
+                 * in the TX stream. */
+                FreeRTOS_send( pxClient->xTransferSocket,
+                               ( pcWriteStart == pcCOMMAND_BUFFER ) ? pcCOMMAND_BUFFER : NULL,
+                               xWriteLength, 0 );
             }
 
             if( pxClient->bits1.bDirHasEntry == pdFALSE_UNSIGNED )
@@ -2129,6 +2127,21 @@
             }
         } /* while( pxClient->bits1.bClientConnected )  */
 
+        /* Before the connection is made, eSELECT_WRITE waits for connect(). */
+        if( ( pxClient->xTransferSocket != FREERTOS_NO_SOCKET ) &&
+            ( pxClient->bits1.bClientConnected != pdFALSE_UNSIGNED ) )
+        {
+            if( pxClient->bits1.bDirHasEntry != pdFALSE_UNSIGNED )
+            {
+                /* Continue the listing when there is space in the TX stream. */
+                FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+            }
+            else
+            {
+                FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+            }
+        }
+
         return 0;
     }
 /*-----------------------------------------------------------*/
@@ -2146,11 +2159,61 @@
     }
 /*-----------------------------------------------------------*/
 
+    static char * prvAppendString( char * pcPtr,
+                                   const char * pcString,
+                                   BaseType_t xWidth )
+    {
+        BaseType_t xLength = 0;
+
+        /* Left-aligned in a field of at least xWidth characters. */
+        while( pcString[ xLength ] != '\0' )
+        {
+            *( pcPtr++ ) = pcString[ xLength++ ];
+        }
+
+        for( ; xLength < xWidth; xLength++ )
+        {
+            *( pcPtr++ ) = ' ';
+        }
+
+        return pcPtr;
+    }
+/*-----------------------------------------------------------*/
+
+    static char * prvAppendNumber( char * pcPtr,
+                                   uint32_t ulValue,
+                                   BaseType_t xWidth,
+                                   char cPadding )
+    {
+        char pcDigits[ 10 ];
+        BaseType_t xCount = 0;
+
+        /* Right-aligned in a field of xWidth characters. */
+        do
+        {
+            pcDigits[ xCount++ ] = ( char ) ( '0' + ( ulValue % 10u ) );
+            ulValue /= 10u;
+        } while( ulValue != 0u );
+
+        for( ; xWidth > xCount; xWidth-- )
+        {
+            *( pcPtr++ ) = cPadding;
+        }
+
+        while( xCount > 0 )
+        {
+            *( pcPtr++ ) = pcDigits[ --xCount ];
+        }
+
+        return pcPtr;
+    }
+/*-----------------------------------------------------------*/
+
     static BaseType_t prvGetFileInfoStat( FF_DirEnt_t * pxEntry,
                                           char * pcLine,
                                           BaseType_t xMaxLength )
     {
-        char date[ 16 ];
+        char * pcPtr = pcLine;
         char mode[ 11 ] = "----------";
         BaseType_t st_nlink = 1;
         const char user[ 9 ] = "freertos";
@@ -2205,21 +2268,49 @@
         mode[ 8 ] = '-';
         mode[ 9 ] = '-'; /* x for executable. */
 
+        /* The line is composed by hand, a listing of a large directory would
+         * spend most of its time in snprintf().  The fields up to the name
+         * take less than 64 bytes, see MAX_DIR_LIST_ENTRY_SIZE. */
+        pcPtr = prvAppendString( pcPtr, mode, 0 );
+        *( pcPtr++ ) = ' ';
+        pcPtr = prvAppendNumber( pcPtr, ( uint32_t ) st_nlink, 3, ' ' );
+        *( pcPtr++ ) = ' ';
+        pcPtr = prvAppendString( pcPtr, user, 4 );
+        *( pcPtr++ ) = ' ';
+        pcPtr = prvAppendString( pcPtr, group, 4 );
+        *( pcPtr++ ) = ' ';
+        pcPtr = prvAppendNumber( pcPtr, ( uint32_t ) ulSize, 8, ' ' );
+        *( pcPtr++ ) = ' ';
+
         if( pxCreateTime->Month && pxCreateTime->Day )
         {
-            snprintf( date, sizeof( date ), "%-3.3s %02d %02d:%02d",
-                      pcMonthAbbrev( pxCreateTime->Month ),
-                      pxCreateTime->Day,
-                      pxCreateTime->Hour,
-                      pxCreateTime->Minute );
+            /* "Sep 01 00:17" */
+            memcpy( pcPtr, pcMonthAbbrev( pxCreateTime->Month ), 3 );
+            pcPtr += 3;
+            *( pcPtr++ ) = ' ';
+            pcPtr = prvAppendNumber( pcPtr, pxCreateTime->Day, 2, '0' );
+            *( pcPtr++ ) = ' ';
+            pcPtr = prvAppendNumber( pcPtr, pxCreateTime->Hour, 2, '0' );
+            *( pcPtr++ ) = ':';
+            pcPtr = prvAppendNumber( pcPtr, pxCreateTime->Minute, 2, '0' );
         }
         else
         {
-            snprintf( date, sizeof( date ), "Jan 01 1970" );
+            pcPtr = prvAppendString( pcPtr, " Jan 01 1970", 0 );
         }
 
-        return snprintf( pcLine, xMaxLength, "%s %3ld %-4s %-4s %8d %12s %s\r\n",
-                         mode, st_nlink, user, group, ( int ) ulSize, date, pcFileName );
+        *( pcPtr++ ) = ' ';
+
+        /* Leave space for the CR/LF. */
+        while( ( *pcFileName != '\0' ) && ( ( pcPtr - pcLine ) < ( xMaxLength - 2 ) ) )
+        {
+            *( pcPtr++ ) = *( pcFileName++ );
+        }
+
+        *( pcPtr++ ) = '\r';
+        *( pcPtr++ ) = '\n';
+
+        return ( BaseType_t ) ( pcPtr - pcLine );
     }
 /*-----------------------------------------------------------*/
 
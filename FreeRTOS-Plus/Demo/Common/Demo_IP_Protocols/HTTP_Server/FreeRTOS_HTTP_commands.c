@@ -58,12 +58,21 @@ const char * webCodename( int aCode )
 {
     switch( aCode )
     {
+        case WEB_CONTINUE: /* 100 */
+            return "Continue";
+
         case WEB_REPLY_OK: /*  = 200, */
             return "OK";
 
+        case WEB_CREATED: /* 201 */
+            return "Created";
+
         case WEB_NO_CONTENT: /* 204 */
             return "No content";
 
+        case WEB_NOT_MODIFIED: /* 304 */
+            return "Not Modified";
+
         case WEB_BAD_REQUEST: /*  = 400, */
             return "Bad request";
 
@@ -76,11 +85,17 @@ const char * webCodename( int aCode )
         case WEB_GONE: /*  = 410, */
             return "Done";
 
+        case WEB_LENGTH_REQUIRED: /* 411 */
+            return "Length Required";
+
         case WEB_PRECONDITION_FAILED: /*  = 412, */
             return "Precondition Failed";
 
         case WEB_INTERNAL_SERVER_ERROR: /*  = 500, */
             return "Internal Server Error";
+
+        case WEB_NOT_IMPLEMENTED: /*  = 501, */
+            return "Not Implemented";
     }
 
     return "Unknown";
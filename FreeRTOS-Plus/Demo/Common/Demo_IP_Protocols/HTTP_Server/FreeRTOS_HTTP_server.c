@@ -34,6 +34,8 @@
 /* Standard includes. */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
@@ -75,6 +77,62 @@
         #define ipconfigHTTP_REQUEST_CHARACTER    '?'
     #endif
 
+/*
+ * ipconfigHTTP_CACHE_ENTRIES: the number of small files that are kept in RAM,
+ * together with their reply headers.  Every task that serves clients has its
+ * own cache, so no locking is needed.  An entry is checked against the size
+ * and the modification time of the file for every request, so the cache
+ * needs ffconfigTIME_SUPPORT.
+ */
+    #ifndef ipconfigHTTP_CACHE_ENTRIES
+        #define ipconfigHTTP_CACHE_ENTRIES        ( 0 )
+    #endif
+
+/* Larger files are never cached. */
+    #ifndef ipconfigHTTP_CACHE_MAX_FILE_SIZE
+        #define ipconfigHTTP_CACHE_MAX_FILE_SIZE    ( 4096 )
+    #endif
+
+/*
+ * ipconfigHTTP_ALLOW_UPLOADS: when defined as non-zero, the body of a POST or a
+ * PUT request is written to the file that is named by the URL.  Any client can
+ * then write any file below the root directory, so only enable it on a
+ * trusted network.
+ */
+    #ifndef ipconfigHTTP_ALLOW_UPLOADS
+        #define ipconfigHTTP_ALLOW_UPLOADS    ( 0 )
+    #endif
+
+/* The states of the reception of a request body, see 'xBodyState'. */
+    enum
+    {
+        eBODY_NONE = 0,   /* No body is being received. */
+        eBODY_DATA,       /* Data, 'uxBodyLeft' bytes are expected. */
+        eBODY_CHUNK_SIZE, /* The line with the size of the next chunk. */
+        eBODY_CHUNK_END,  /* The empty line after the data of a chunk. */
+        eBODY_TRAILER     /* Lines after the last chunk, up to an empty line. */
+    };
+
+/* ETag and Last-Modified are made from the size and the time of a file. */
+    #define httpUSE_VALIDATORS                    ( ffconfigTIME_SUPPORT != 0 )
+    #define httpUSE_CACHE                         ( ( ipconfigHTTP_CACHE_ENTRIES > 0 ) && httpUSE_VALIDATORS )
+
+    #if ( httpUSE_CACHE != 0 )
+
+/* A cached file.  pcData holds the reply headers, without the Connection
+ * line, followed by the contents of the file. */
+        typedef struct xHTTP_CACHE_ENTRY
+        {
+            char pcFilename[ ffconfigMAX_FILENAME ];
+            char pcETag[ 24 ];
+            char * pcData;
+            size_t uxHeaderLength;
+            size_t uxFileSize;
+            UBaseType_t uxUsers; /* The number of replies that are being sent from this entry. */
+            TickType_t xLastUsed;
+        } HTTPCacheEntry_t;
+    #endif /* httpUSE_CACHE */
+
 /*_RB_ Need comment block, although fairly self evident. */
     static void prvFileClose( HTTPClient_t * pxClient );
     static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
@@ -84,8 +142,61 @@
     static BaseType_t prvSendFile( HTTPClient_t * pxClient );
     static BaseType_t prvSendReply( HTTPClient_t * pxClient,
                                     BaseType_t xCode );
+    static BaseType_t prvFormatReply( HTTPClient_t * pxClient,
+                                      BaseType_t xCode,
+                                      char * pcBuffer,
+                                      size_t uxBufferSize );
+
+/* Feed received bytes to the request parser.  Returns the number of bytes
+ * used, which is less than xLength when the request is complete before the
+ * end of the data. */
+    static BaseType_t prvParseRequest( HTTPClient_t * pxClient,
+                                       const char * pcData,
+                                       BaseType_t xLength,
+                                       BaseType_t * pxComplete );
+/* Returns pdTRUE when the line that ends the request headers was parsed. */
+    static BaseType_t prvParseLine( HTTPClient_t * pxClient );
+    static void prvParseRequestLine( HTTPClient_t * pxClient );
+    static BaseType_t prvHeaderValue( const char * pcLine,
+                                      const char * pcName,
+                                      const char ** ppcValue );
+/* Returns pdTRUE while the body of a reply is being sent. */
+    static BaseType_t prvReplyBusy( HTTPClient_t * pxClient );
+    static void prvReplyDone( HTTPClient_t * pxClient );
+
+    static void prvMakeFilename( HTTPClient_t * pxClient );
+
+    #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+        static BaseType_t prvStartUpload( HTTPClient_t * pxClient );
+/* Write the part of the body that has been received to the file. */
+        static BaseType_t prvReceiveBody( HTTPClient_t * pxClient );
+/* Parse a line of a chunked body.  Returns a status code when the body ends,
+ * or 0 when more is expected. */
+        static BaseType_t prvParseChunkLine( HTTPClient_t * pxClient );
+        static void prvEndUpload( HTTPClient_t * pxClient,
+                                  BaseType_t xCode );
+    #endif
+
+    #if ( httpUSE_VALIDATORS != 0 )
+        static void prvMakeValidators( const FF_Stat_t * pxStat,
+                                       char * pcETag,
+                                       size_t uxETagSize,
+                                       char * pcDate,
+                                       size_t uxDateSize );
+        static BaseType_t prvIsNotModified( HTTPClient_t * pxClient,
+                                            const char * pcETag,
+                                            const char * pcDate );
+    #endif
 
-    static const char pcEmptyString[ 1 ] = { '\0' };
+    #if ( httpUSE_CACHE != 0 )
+        static HTTPCacheEntry_t * prvCacheFind( HTTPClient_t * pxClient,
+                                                const char * pcETag );
+        static HTTPCacheEntry_t * prvCacheStore( HTTPClient_t * pxClient,
+                                                 const char * pcETag );
+        static BaseType_t prvSendFromCache( HTTPClient_t * pxClient,
+                                            HTTPCacheEntry_t * pxEntry );
+        static void prvSendCached( HTTPClient_t * pxClient );
+    #endif
 
     typedef struct xTYPE_COUPLE
     {
@@ -123,6 +234,28 @@
         }
 
         prvFileClose( pxClient );
+
+        #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+        {
+            if( pxClient->pxWriteHandle != NULL )
+            {
+                /* The connection was lost during an upload. */
+                ff_fclose( pxClient->pxWriteHandle );
+                pxClient->pxWriteHandle = NULL;
+                ff_remove( pxClient->pcCurrentFilename );
+            }
+        }
+        #endif
+
+        #if ( httpUSE_CACHE != 0 )
+        {
+            if( pxClient->pxCacheEntry != NULL )
+            {
+                pxClient->pxCacheEntry->uxUsers--;
+                pxClient->pxCacheEntry = NULL;
+            }
+        }
+        #endif
     }
 /*-----------------------------------------------------------*/
 
@@ -137,31 +270,68 @@
     }
 /*-----------------------------------------------------------*/
 
-    static BaseType_t prvSendReply( HTTPClient_t * pxClient,
-                                    BaseType_t xCode )
+    static BaseType_t prvFormatReply( HTTPClient_t * pxClient,
+                                      BaseType_t xCode,
+                                      char * pcBuffer,
+                                      size_t uxBufferSize )
     {
         struct xTCP_SERVER * pxParent = pxClient->pxParent;
+        const char * pcContentsType = pxParent->pcContentsType[ 0 ] ? pxParent->pcContentsType : "text/html";
+        const char * pcExtraContents = pxParent->pcExtraContents;
         BaseType_t xRc;
 
-        /* A normal command reply on the main socket (port 21). */
-        char * pcBuffer = pxParent->pcFileBuffer;
+        if( xCode == WEB_NOT_MODIFIED )
+        {
+            /* A 304 reply only repeats the validators. */
+            pcContentsType = NULL;
+        }
+        else if( pcExtraContents[ 0 ] == '\0' )
+        {
+            /* Without a length, the client would wait for the connection to
+             * close before it sees the end of the reply. */
+            pcExtraContents = "Content-Length: 0\r\n";
+        }
 
-        xRc = snprintf( pcBuffer, sizeof( pxParent->pcFileBuffer ),
+        xRc = snprintf( pcBuffer, uxBufferSize,
                         "HTTP/1.1 %d %s\r\n"
                         #if USE_HTML_CHUNKS
                             "Transfer-Encoding: chunked\r\n"
                         #endif
-                        "Content-Type: %s\r\n"
-                        "Connection: keep-alive\r\n"
-                        "%s\r\n",
+                        "%s%s%s"
+                        "%s",
                         ( int ) xCode,
                         webCodename( xCode ),
-                        pxParent->pcContentsType[ 0 ] ? pxParent->pcContentsType : "text/html",
-                        pxParent->pcExtraContents );
+                        pcContentsType != NULL ? "Content-Type: " : "",
+                        pcContentsType != NULL ? pcContentsType : "",
+                        pcContentsType != NULL ? "\r\n" : "",
+                        pcExtraContents );
 
         pxParent->pcContentsType[ 0 ] = '\0';
         pxParent->pcExtraContents[ 0 ] = '\0';
 
+        if( xRc >= ( BaseType_t ) uxBufferSize )
+        {
+            xRc = ( BaseType_t ) uxBufferSize - 1;
+        }
+
+        return xRc;
+    }
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvSendReply( HTTPClient_t * pxClient,
+                                    BaseType_t xCode )
+    {
+        struct xTCP_SERVER * pxParent = pxClient->pxParent;
+        BaseType_t xRc;
+
+        /* A normal command reply on the main socket (port 21). */
+        char * pcBuffer = pxParent->pcFileBuffer;
+
+        xRc = prvFormatReply( pxClient, xCode, pcBuffer, sizeof( pxParent->pcFileBuffer ) );
+        xRc += snprintf( pcBuffer + xRc, sizeof( pxParent->pcFileBuffer ) - xRc,
+                         "Connection: %s\r\n\r\n",
+                         pxClient->bits.bKeepAlive != pdFALSE_UNSIGNED ? "keep-alive" : "close" );
+
         xRc = FreeRTOS_send( pxClient->xSocket, ( const void * ) pcBuffer, xRc, 0 );
         pxClient->bits.bReplySent = pdTRUE_UNSIGNED;
 
@@ -171,8 +341,6 @@
 
     static BaseType_t prvSendFile( HTTPClient_t * pxClient )
     {
-        size_t uxSpace;
-        size_t uxCount;
         BaseType_t xRc = 0;
 
         if( pxClient->bits.bReplySent == pdFALSE_UNSIGNED )
@@ -189,61 +357,333 @@
 
         if( xRc >= 0 )
         {
-            do
+            /* Fill the TX stream as far as it goes, preferably by reading the
+             * file straight into it. */
+            xRc = xTCPServerSendFile( pxClient->xSocket, pxClient->pxFileHandle, &( pxClient->uxBytesLeft ),
+                                      pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), pdFALSE );
+        }
+
+        if( xRc < 0 )
+        {
+            /* The file can not be read, or the connection is gone.  The reply
+             * can not be completed, so close the connection. */
+            FreeRTOS_printf( ( "prvSendFile: %s: rc %ld\n", pxClient->pcCurrentFilename, xRc ) );
+            pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+            pxClient->uxBytesLeft = 0u;
+        }
+
+        if( pxClient->uxBytesLeft == 0u )
+        {
+            prvFileClose( pxClient );
+        }
+
+        return xRc;
+    }
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_VALIDATORS != 0 )
+
+        static void prvMakeValidators( const FF_Stat_t * pxStat,
+                                       char * pcETag,
+                                       size_t uxETagSize,
+                                       char * pcDate,
+                                       size_t uxDateSize )
+        {
+            static const char * const pcDays[ 7 ] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+            static const char * const pcMonths[ 12 ] =
             {
-                uxSpace = FreeRTOS_tx_space( pxClient->xSocket );
+                "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+            };
+            FF_TimeStruct_t xTime;
+            time_t xSeconds = ( time_t ) pxStat->st_mtime;
+
+            /* The file changes when its size or its time changes. */
+            snprintf( pcETag, uxETagSize, "\"%lx-%lx\"",
+                      ( unsigned long ) pxStat->st_size,
+                      ( unsigned long ) pxStat->st_mtime );
+
+            FreeRTOS_gmtime_r( &xSeconds, &xTime );
+            snprintf( pcDate, uxDateSize, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                      pcDays[ xTime.tm_wday % 7 ],
+                      ( int ) xTime.tm_mday,
+                      pcMonths[ xTime.tm_mon % 12 ],
+                      ( int ) xTime.tm_year + 1900,
+                      ( int ) xTime.tm_hour,
+                      ( int ) xTime.tm_min,
+                      ( int ) xTime.tm_sec );
+        }
+
+    #endif /* httpUSE_VALIDATORS */
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_VALIDATORS != 0 )
 
-                if( pxClient->uxBytesLeft < uxSpace )
+        static BaseType_t prvIsNotModified( HTTPClient_t * pxClient,
+                                            const char * pcETag,
+                                            const char * pcDate )
+        {
+            BaseType_t xNotModified = pdFALSE;
+
+            if( pxClient->pcIfNoneMatch[ 0 ] != '\0' )
+            {
+                /* If-None-Match takes precedence over If-Modified-Since.  It may
+                 * hold a list of tags, weak or strong. */
+                if( ( strcmp( pxClient->pcIfNoneMatch, "*" ) == 0 ) ||
+                    ( strstr( pxClient->pcIfNoneMatch, pcETag ) != NULL ) )
                 {
-                    uxCount = pxClient->uxBytesLeft;
+                    xNotModified = pdTRUE;
+                }
+            }
+            else if( pxClient->pcIfModifiedSince[ 0 ] != '\0' )
+            {
+                /* Clients return the Last-Modified date that they were given,
+                 * so the dates are not parsed, but compared as text.  Another
+                 * date just leads to a full reply. */
+                if( strcmp( pxClient->pcIfModifiedSince, pcDate ) == 0 )
+                {
+                    xNotModified = pdTRUE;
+                }
+            }
+
+            return xNotModified;
+        }
+
+    #endif /* httpUSE_VALIDATORS */
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_CACHE != 0 )
+
+        static HTTPCacheEntry_t * prvCacheFind( HTTPClient_t * pxClient,
+                                                const char * pcETag )
+        {
+            HTTPCacheEntry_t * pxCache = pxClient->pxParent->pxHTTPCache;
+            HTTPCacheEntry_t * pxResult = NULL;
+            BaseType_t xIndex;
+
+            for( xIndex = 0; ( pxCache != NULL ) && ( xIndex < ipconfigHTTP_CACHE_ENTRIES ); xIndex++ )
+            {
+                HTTPCacheEntry_t * pxEntry = &( pxCache[ xIndex ] );
+
+                if( ( pxEntry->pcData == NULL ) ||
+                    ( strcmp( pxEntry->pcFilename, pxClient->pcCurrentFilename ) != 0 ) )
+                {
+                    continue;
+                }
+
+                if( strcmp( pxEntry->pcETag, pcETag ) == 0 )
+                {
+                    pxEntry->xLastUsed = xTaskGetTickCount();
+                    pxResult = pxEntry;
+                }
+                else if( pxEntry->uxUsers == 0u )
+                {
+                    /* The file has changed since it was cached. */
+                    vPortFree( pxEntry->pcData );
+                    pxEntry->pcData = NULL;
+                }
+            }
+
+            return pxResult;
+        }
+
+    #endif /* httpUSE_CACHE */
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_CACHE != 0 )
+
+        static HTTPCacheEntry_t * prvCacheStore( HTTPClient_t * pxClient,
+                                                 const char * pcETag )
+        {
+            struct xTCP_SERVER * pxParent = pxClient->pxParent;
+            HTTPCacheEntry_t * pxEntry = NULL;
+            size_t uxFileSize = ( size_t ) pxClient->pxFileHandle->ulFileSize;
+            BaseType_t xIndex;
+
+            if( pxParent->pxHTTPCache == NULL )
+            {
+                pxParent->pxHTTPCache = ( HTTPCacheEntry_t * ) pvPortMalloc( ipconfigHTTP_CACHE_ENTRIES * sizeof( HTTPCacheEntry_t ) );
+
+                if( pxParent->pxHTTPCache != NULL )
+                {
+                    memset( pxParent->pxHTTPCache, '\0', ipconfigHTTP_CACHE_ENTRIES * sizeof( HTTPCacheEntry_t ) );
+                }
+            }
+
+            /* Take a free entry, or else the least recently used one which is
+             * not being sent. */
+            for( xIndex = 0; ( pxParent->pxHTTPCache != NULL ) && ( xIndex < ipconfigHTTP_CACHE_ENTRIES ); xIndex++ )
+            {
+                HTTPCacheEntry_t * pxCandidate = &( pxParent->pxHTTPCache[ xIndex ] );
+
+                if( pxCandidate->pcData == NULL )
+                {
+                    pxEntry = pxCandidate;
+                    break;
+                }
+
+                if( ( pxCandidate->uxUsers == 0u ) &&
+                    ( ( pxEntry == NULL ) || ( ( TickType_t ) ( pxEntry->xLastUsed - pxCandidate->xLastUsed ) < ( ( TickType_t ) ~0u >> 1 ) ) ) )
+                {
+                    pxEntry = pxCandidate;
+                }
+            }
+
+            if( pxEntry != NULL )
+            {
+                BaseType_t xHeaderLength;
+
+                if( pxEntry->pcData != NULL )
+                {
+                    vPortFree( pxEntry->pcData );
+                    pxEntry->pcData = NULL;
+                }
+
+                /* The headers are made once, only the Connection line is added
+                 * for each reply. */
+                xHeaderLength = prvFormatReply( pxClient, WEB_REPLY_OK, pcFILE_BUFFER, sizeof( pcFILE_BUFFER ) );
+                pxEntry->pcData = ( char * ) pvPortMalloc( ( size_t ) xHeaderLength + uxFileSize );
+
+                if( pxEntry->pcData == NULL )
+                {
+                    pxEntry = NULL;
+                }
+                else if( ff_fread( pxEntry->pcData + xHeaderLength, 1, uxFileSize, pxClient->pxFileHandle ) != uxFileSize )
+                {
+                    vPortFree( pxEntry->pcData );
+                    pxEntry->pcData = NULL;
+                    pxEntry = NULL;
                 }
                 else
                 {
-                    uxCount = uxSpace;
+                    memcpy( pxEntry->pcData, pcFILE_BUFFER, ( size_t ) xHeaderLength );
+                    snprintf( pxEntry->pcFilename, sizeof( pxEntry->pcFilename ), "%s", pxClient->pcCurrentFilename );
+                    snprintf( pxEntry->pcETag, sizeof( pxEntry->pcETag ), "%s", pcETag );
+                    pxEntry->uxHeaderLength = ( size_t ) xHeaderLength;
+                    pxEntry->uxFileSize = uxFileSize;
+                    pxEntry->uxUsers = 0u;
+                    pxEntry->xLastUsed = xTaskGetTickCount();
                 }
+            }
+
+            return pxEntry;
+        }
+
+    #endif /* httpUSE_CACHE */
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_CACHE != 0 )
+
+        static BaseType_t prvSendFromCache( HTTPClient_t * pxClient,
+                                            HTTPCacheEntry_t * pxEntry )
+        {
+            BaseType_t xRc;
+
+            memcpy( pcFILE_BUFFER, pxEntry->pcData, pxEntry->uxHeaderLength );
+            xRc = ( BaseType_t ) pxEntry->uxHeaderLength;
+            xRc += snprintf( pcFILE_BUFFER + xRc, sizeof( pcFILE_BUFFER ) - xRc,
+                             "Connection: %s\r\n\r\n",
+                             pxClient->bits.bKeepAlive != pdFALSE_UNSIGNED ? "keep-alive" : "close" );
+
+            pxClient->pxParent->pcContentsType[ 0 ] = '\0';
+            pxClient->pxParent->pcExtraContents[ 0 ] = '\0';
+            pxClient->bits.bReplySent = pdTRUE_UNSIGNED;
+
+            xRc = FreeRTOS_send( pxClient->xSocket, pcFILE_BUFFER, xRc, 0 );
+
+            if( ( xRc >= 0 ) && ( pxClient->bits.bHeadOnly == pdFALSE_UNSIGNED ) )
+            {
+                pxEntry->uxUsers++;
+                pxClient->pxCacheEntry = pxEntry;
+                pxClient->uxBytesLeft = pxEntry->uxFileSize;
+                prvSendCached( pxClient );
+            }
+
+            return xRc;
+        }
+
+    #endif /* httpUSE_CACHE */
+/*-----------------------------------------------------------*/
+
+    #if ( httpUSE_CACHE != 0 )
+
+        static void prvSendCached( HTTPClient_t * pxClient )
+        {
+            HTTPCacheEntry_t * pxEntry = pxClient->pxCacheEntry;
+
+            while( pxClient->uxBytesLeft > 0u )
+            {
+                size_t uxCount = ( size_t ) FreeRTOS_tx_space( pxClient->xSocket );
+                BaseType_t xRc;
 
-                if( uxCount > 0u )
+                if( uxCount > pxClient->uxBytesLeft )
                 {
-                    if( uxCount > sizeof( pxClient->pxParent->pcFileBuffer ) )
-                    {
-                        uxCount = sizeof( pxClient->pxParent->pcFileBuffer );
-                    }
+                    uxCount = pxClient->uxBytesLeft;
+                }
 
-                    ff_fread( pxClient->pxParent->pcFileBuffer, 1, uxCount, pxClient->pxFileHandle );
-                    pxClient->uxBytesLeft -= uxCount;
+                if( uxCount == 0u )
+                {
+                    break;
+                }
 
-                    xRc = FreeRTOS_send( pxClient->xSocket, pxClient->pxParent->pcFileBuffer, uxCount, 0 );
+                xRc = FreeRTOS_send( pxClient->xSocket,
+                                     pxEntry->pcData + pxEntry->uxHeaderLength + ( pxEntry->uxFileSize - pxClient->uxBytesLeft ),
+                                     uxCount, 0 );
 
-                    if( xRc < 0 )
-                    {
-                        break;
-                    }
+                if( xRc < 0 )
+                {
+                    pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                    pxClient->uxBytesLeft = 0u;
+                }
+                else
+                {
+                    pxClient->uxBytesLeft -= ( size_t ) xRc;
                 }
-            } while( uxCount > 0u );
+            }
+
+            if( pxClient->uxBytesLeft == 0u )
+            {
+                pxEntry->uxUsers--;
+                pxClient->pxCacheEntry = NULL;
+            }
         }
 
-        if( pxClient->uxBytesLeft == 0u )
+    #endif /* httpUSE_CACHE */
+/*-----------------------------------------------------------*/
+
+    static void prvMakeFilename( HTTPClient_t * pxClient )
+    {
+        char pcSlash[ 2 ];
+
+        if( pxClient->pcUrlData[ 0 ] != '/' )
         {
-            /* Writing is ready, no need for further 'eSELECT_WRITE' events. */
-            FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
-            prvFileClose( pxClient );
+            /* Insert a slash before the file name. */
+            pcSlash[ 0 ] = '/';
+            pcSlash[ 1 ] = '\0';
         }
         else
         {
-            /* Wake up the TCP task as soon as this socket may be written to. */
-            FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+            /* The browser provided a starting '/' already. */
+            pcSlash[ 0 ] = '\0';
         }
 
-        return xRc;
+        snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
+                  pxClient->pcRootDir,
+                  pcSlash,
+                  pxClient->pcUrlData );
     }
 /*-----------------------------------------------------------*/
 
     static BaseType_t prvOpenURL( HTTPClient_t * pxClient )
     {
         BaseType_t xRc;
-        char pcSlash[ 2 ];
 
-        pxClient->bits.ulFlags = 0;
+        #if ( httpUSE_VALIDATORS != 0 )
+            FF_Stat_t xStat;
+            char pcETag[ 24 ];
+            char pcDate[ 32 ];
+        #endif
+
+        pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
 
         #if ( ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK != 0 )
         {
@@ -260,7 +700,7 @@
                               "Content-Length: %d\r\n", ( int ) xResult );
                     xRc = prvSendReply( pxClient, WEB_REPLY_OK ); /* "Requested file action OK" */
 
-                    if( xRc > 0 )
+                    if( ( xRc > 0 ) && ( pxClient->bits.bHeadOnly == pdFALSE_UNSIGNED ) )
                     {
                         xRc = FreeRTOS_send( pxClient->xSocket, pxClient->pcCurrentFilename, xResult, 0 );
                     }
@@ -273,22 +713,39 @@
         }
         #endif /* ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK */
 
-        if( pxClient->pcUrlData[ 0 ] != '/' )
-        {
-            /* Insert a slash before the file name. */
-            pcSlash[ 0 ] = '/';
-            pcSlash[ 1 ] = '\0';
-        }
-        else
+        prvMakeFilename( pxClient );
+
+        #if ( httpUSE_VALIDATORS != 0 )
         {
-            /* The browser provided a starting '/' already. */
-            pcSlash[ 0 ] = '\0';
-        }
+            /* The validators only need the directory entry, the contents of
+             * the file are not read to answer a conditional request. */
+            if( ff_stat( pxClient->pcCurrentFilename, &xStat ) != 0 )
+            {
+                /* "404 File not found". */
+                return prvSendReply( pxClient, WEB_NOT_FOUND );
+            }
 
-        snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
-                  pxClient->pcRootDir,
-                  pcSlash,
-                  pxClient->pcUrlData );
+            prvMakeValidators( &xStat, pcETag, sizeof( pcETag ), pcDate, sizeof( pcDate ) );
+
+            if( prvIsNotModified( pxClient, pcETag, pcDate ) != pdFALSE )
+            {
+                snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+                          "ETag: %s\r\nLast-Modified: %s\r\n", pcETag, pcDate );
+                return prvSendReply( pxClient, WEB_NOT_MODIFIED );
+            }
+
+            #if ( httpUSE_CACHE != 0 )
+            {
+                HTTPCacheEntry_t * pxEntry = prvCacheFind( pxClient, pcETag );
+
+                if( pxEntry != NULL )
+                {
+                    return prvSendFromCache( pxClient, pxEntry );
+                }
+            }
+            #endif /* httpUSE_CACHE */
+        }
+        #endif /* httpUSE_VALIDATORS */
 
         pxClient->pxFileHandle = ff_fopen( pxClient->pcCurrentFilename, "rb" );
 
@@ -303,28 +760,351 @@
         else
         {
             pxClient->uxBytesLeft = ( size_t ) pxClient->pxFileHandle->ulFileSize;
-            xRc = prvSendFile( pxClient );
+
+            strcpy( pxClient->pxParent->pcContentsType, pcGetContentsType( pxClient->pcCurrentFilename ) );
+            #if ( httpUSE_VALIDATORS != 0 )
+            {
+                snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+                          "Content-Length: %u\r\nETag: %s\r\nLast-Modified: %s\r\n",
+                          ( unsigned ) pxClient->uxBytesLeft, pcETag, pcDate );
+            }
+            #else
+            {
+                snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+                          "Content-Length: %u\r\n", ( unsigned ) pxClient->uxBytesLeft );
+            }
+            #endif /* httpUSE_VALIDATORS */
+
+            #if ( httpUSE_CACHE != 0 )
+            {
+                if( pxClient->uxBytesLeft <= ( size_t ) ipconfigHTTP_CACHE_MAX_FILE_SIZE )
+                {
+                    HTTPCacheEntry_t * pxEntry = prvCacheStore( pxClient, pcETag );
+
+                    if( pxEntry != NULL )
+                    {
+                        prvFileClose( pxClient );
+
+                        /* Although against the coding standard of FreeRTOS, a
+                         * return is done here to simplify this conditional code. */
+                        return prvSendFromCache( pxClient, pxEntry );
+                    }
+
+                    /* prvCacheStore() may have used the headers. */
+                    strcpy( pxClient->pxParent->pcContentsType, pcGetContentsType( pxClient->pcCurrentFilename ) );
+                    snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+                              "Content-Length: %u\r\nETag: %s\r\nLast-Modified: %s\r\n",
+                              ( unsigned ) pxClient->uxBytesLeft, pcETag, pcDate );
+                    ff_fseek( pxClient->pxFileHandle, 0, FF_SEEK_SET );
+                }
+            }
+            #endif /* httpUSE_CACHE */
+
+            /* "Requested file action OK". */
+            xRc = prvSendReply( pxClient, WEB_REPLY_OK );
+
+            if( ( xRc < 0 ) || ( pxClient->bits.bHeadOnly != pdFALSE_UNSIGNED ) )
+            {
+                prvFileClose( pxClient );
+            }
+            else
+            {
+                xRc = prvSendFile( pxClient );
+            }
         }
 
         return xRc;
     }
 /*-----------------------------------------------------------*/
 
-    static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
-                                     BaseType_t xIndex )
+    #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+
+        static BaseType_t prvStartUpload( HTTPClient_t * pxClient )
+        {
+            FF_Stat_t xStat;
+            BaseType_t xRc;
+
+            pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
+
+            if( ( pxClient->bits.bHasLength == pdFALSE_UNSIGNED ) && ( pxClient->bits.bChunked == pdFALSE_UNSIGNED ) )
+            {
+                /* The end of the body can not be found. */
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                return prvSendReply( pxClient, WEB_LENGTH_REQUIRED );
+            }
+
+            if( ( strstr( pxClient->pcUrlData, ".." ) != NULL ) || ( strchr( pxClient->pcUrlData, ipconfigHTTP_REQUEST_CHARACTER ) != NULL ) )
+            {
+                /* Only files below the root directory can be written. */
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                return prvSendReply( pxClient, WEB_BAD_REQUEST );
+            }
+
+            prvMakeFilename( pxClient );
+            pxClient->bits.bCreated = ( ff_stat( pxClient->pcCurrentFilename, &xStat ) != 0 );
+            pxClient->pxWriteHandle = ff_fopen( pxClient->pcCurrentFilename, "wb" );
+
+            FreeRTOS_printf( ( "Upload to '%s': %s\n", pxClient->pcCurrentFilename,
+                               pxClient->pxWriteHandle != NULL ? "Ok" : strerror( stdioGET_ERRNO() ) ) );
+
+            if( pxClient->pxWriteHandle == NULL )
+            {
+                /* The body has not been read, so the connection can not be
+                 * used for another request. */
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                return prvSendReply( pxClient, WEB_INTERNAL_SERVER_ERROR );
+            }
+
+            if( pxClient->bits.bExpectContinue != pdFALSE_UNSIGNED )
+            {
+                /* The client waits for this before it sends the body. */
+                xRc = snprintf( pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), "HTTP/1.1 %d %s\r\n\r\n",
+                                WEB_CONTINUE, webCodename( WEB_CONTINUE ) );
+                FreeRTOS_send( pxClient->xSocket, pcFILE_BUFFER, xRc, 0 );
+            }
+
+            /* A chunked transfer encoding overrides the Content-Length. */
+            pxClient->xBodyState = ( pxClient->bits.bChunked != pdFALSE_UNSIGNED ) ? eBODY_CHUNK_SIZE : eBODY_DATA;
+            pxClient->uxLineLength = 0u;
+
+            /* The body may have arrived together with the request. */
+            return prvReceiveBody( pxClient );
+        }
+
+    #endif /* ipconfigHTTP_ALLOW_UPLOADS */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+
+        static void prvEndUpload( HTTPClient_t * pxClient,
+                                  BaseType_t xCode )
+        {
+            BaseType_t xCloseError;
+
+            pxClient->xBodyState = eBODY_NONE;
+            xCloseError = ff_fclose( pxClient->pxWriteHandle );
+            pxClient->pxWriteHandle = NULL;
+
+            if( ( xCode == WEB_REPLY_OK ) && ( xCloseError != 0 ) )
+            {
+                /* The last data could not be flushed to the disk. */
+                xCode = WEB_INTERNAL_SERVER_ERROR;
+            }
+
+            if( xCode == WEB_REPLY_OK )
+            {
+                FreeRTOS_printf( ( "Upload to '%s' done\n", pxClient->pcCurrentFilename ) );
+                xCode = ( pxClient->bits.bCreated != pdFALSE_UNSIGNED ) ? WEB_CREATED : WEB_NO_CONTENT;
+            }
+            else
+            {
+                /* Do not leave a partial file behind.  The rest of the body will
+                 * not be read, so the connection must be closed. */
+                FreeRTOS_printf( ( "Upload to '%s' failed: %d\n", pxClient->pcCurrentFilename, ( int ) xCode ) );
+                ff_remove( pxClient->pcCurrentFilename );
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+            }
+
+            prvSendReply( pxClient, xCode );
+        }
+
+    #endif /* ipconfigHTTP_ALLOW_UPLOADS */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+
+        static BaseType_t prvParseChunkLine( HTTPClient_t * pxClient )
+        {
+            BaseType_t xResult = 0;
+            char * pcEnd;
+
+            pxClient->pcLine[ pxClient->uxLineLength ] = '\0';
+
+            if( ( pxClient->uxLineLength > 0u ) && ( pxClient->pcLine[ pxClient->uxLineLength - 1u ] == '\r' ) )
+            {
+                pxClient->pcLine[ pxClient->uxLineLength - 1u ] = '\0';
+            }
+
+            pxClient->uxLineLength = 0u;
+
+            switch( pxClient->xBodyState )
+            {
+                case eBODY_CHUNK_SIZE:
+                    /* A hexadecimal size, optionally followed by extensions. */
+                    pxClient->uxBodyLeft = ( size_t ) strtoul( pxClient->pcLine, &pcEnd, 16 );
+
+                    if( ( pcEnd == pxClient->pcLine ) || ( ( *pcEnd != '\0' ) && ( *pcEnd != ';' ) && ( *pcEnd != ' ' ) ) )
+                    {
+                        xResult = WEB_BAD_REQUEST;
+                    }
+                    else if( pxClient->uxBodyLeft == 0u )
+                    {
+                        /* The last chunk, optional trailer fields may follow. */
+                        pxClient->xBodyState = eBODY_TRAILER;
+                    }
+                    else
+                    {
+                        pxClient->xBodyState = eBODY_DATA;
+                    }
+
+                    break;
+
+                case eBODY_CHUNK_END:
+
+                    /* The CRLF that follows the data of a chunk. */
+                    if( pxClient->pcLine[ 0 ] != '\0' )
+                    {
+                        xResult = WEB_BAD_REQUEST;
+                    }
+                    else
+                    {
+                        pxClient->xBodyState = eBODY_CHUNK_SIZE;
+                    }
+
+                    break;
+
+                case eBODY_TRAILER:
+                default:
+
+                    /* Trailer fields are not used. */
+                    if( pxClient->pcLine[ 0 ] == '\0' )
+                    {
+                        xResult = WEB_REPLY_OK;
+                    }
+
+                    break;
+            }
+
+            return xResult;
+        }
+
+    #endif /* ipconfigHTTP_ALLOW_UPLOADS */
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+
+        static BaseType_t prvReceiveBody( HTTPClient_t * pxClient )
+        {
+            BaseType_t xRc = 0;
+
+            /* The data is written to the file straight from the RX stream of
+             * the socket.  While the file is being written, the IP-task goes on
+             * receiving into the same stream, and only when the stream is full,
+             * the TCP window closes and the peer has to wait. */
+            while( pxClient->xBodyState != eBODY_NONE )
+            {
+                BaseType_t xEndCode = 0;
+                BaseType_t xUsed = 0;
+                char * pcData;
+
+                if( ( pxClient->xBodyState == eBODY_DATA ) &&
+                    ( pxClient->uxBodyLeft == 0u ) &&
+                    ( pxClient->bits.bChunked == pdFALSE_UNSIGNED ) )
+                {
+                    prvEndUpload( pxClient, WEB_REPLY_OK );
+                    break;
+                }
+
+                /* The "zero-copy" method: */
+                xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) &pcData,
+                                     0x20000u, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT );
+
+                if( xRc <= 0 )
+                {
+                    /* No more data yet, or the connection was closed before the
+                     * body was complete.  In the latter case the client will be
+                     * deleted. */
+                    break;
+                }
+
+                if( pxClient->xBodyState == eBODY_DATA )
+                {
+                    xUsed = ( ( size_t ) xRc < pxClient->uxBodyLeft ) ? xRc : ( BaseType_t ) pxClient->uxBodyLeft;
+
+                    if( ff_fwrite( pcData, 1, xUsed, pxClient->pxWriteHandle ) != ( size_t ) xUsed )
+                    {
+                        xEndCode = WEB_INTERNAL_SERVER_ERROR;
+                    }
+
+                    pxClient->uxBodyLeft -= ( size_t ) xUsed;
+
+                    if( ( pxClient->uxBodyLeft == 0u ) && ( pxClient->bits.bChunked != pdFALSE_UNSIGNED ) )
+                    {
+                        pxClient->xBodyState = eBODY_CHUNK_END;
+                    }
+                }
+                else
+                {
+                    /* The size lines of a chunked body are collected in pcLine. */
+                    while( xUsed < xRc )
+                    {
+                        char cChar = pcData[ xUsed++ ];
+
+                        if( cChar == '\n' )
+                        {
+                            xEndCode = prvParseChunkLine( pxClient );
+                            break;
+                        }
+
+                        if( pxClient->uxLineLength < ( sizeof( pxClient->pcLine ) - 1u ) )
+                        {
+                            pxClient->pcLine[ pxClient->uxLineLength++ ] = cChar;
+                        }
+                    }
+                }
+
+                /* Now release the bytes from the RX stream. */
+                FreeRTOS_recv( pxClient->xSocket, ( void * ) NULL, xUsed, 0 );
+
+                if( xEndCode != 0 )
+                {
+                    prvEndUpload( pxClient, xEndCode );
+                }
+            }
+
+            return xRc;
+        }
+
+    #endif /* ipconfigHTTP_ALLOW_UPLOADS */
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
+                                     BaseType_t xIndex )
     {
         BaseType_t xResult = 0;
 
+        if( pxClient->bits.bBadRequest != pdFALSE_UNSIGNED )
+        {
+            pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+            return prvSendReply( pxClient, WEB_BAD_REQUEST );
+        }
+
         /* A new command has been received. Process it. */
         switch( xIndex )
         {
             case ECMD_GET:
+            case ECMD_HEAD:
+
+                if( ( pxClient->bits.bChunked != pdFALSE_UNSIGNED ) || ( pxClient->uxBodyLeft != 0u ) )
+                {
+                    /* An unexpected body is not read, close after the reply. */
+                    pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                }
+
+                pxClient->bits.bHeadOnly = ( xIndex == ECMD_HEAD );
                 xResult = prvOpenURL( pxClient );
                 break;
 
-            case ECMD_HEAD:
             case ECMD_POST:
             case ECMD_PUT:
+                #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+                {
+                    xResult = prvStartUpload( pxClient );
+                    break;
+                }
+                #endif
+
+            /* Fall through. */
             case ECMD_DELETE:
             case ECMD_TRACE:
             case ECMD_OPTIONS:
@@ -333,6 +1113,10 @@
             case ECMD_UNK:
                 FreeRTOS_printf( ( "prvProcessCmd: Not implemented: %s\n",
                                    xWebCommands[ xIndex ].pcCommandName ) );
+
+                /* A body may follow, which would be taken for the next request. */
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+                xResult = prvSendReply( pxClient, WEB_NOT_IMPLEMENTED );
                 break;
         }
 
@@ -340,84 +1124,307 @@
     }
 /*-----------------------------------------------------------*/
 
-    BaseType_t xHTTPClientWork( TCPClient_t * pxTCPClient )
+    static BaseType_t prvHeaderValue( const char * pcLine,
+                                      const char * pcName,
+                                      const char ** ppcValue )
     {
-        BaseType_t xRc;
-        HTTPClient_t * pxClient = ( HTTPClient_t * ) pxTCPClient;
+        BaseType_t xMatch = pdTRUE;
 
-        if( pxClient->pxFileHandle != NULL )
+        /* Header names are not case sensitive. */
+        while( *pcName != '\0' )
         {
-            prvSendFile( pxClient );
+            if( tolower( ( unsigned char ) *pcLine ) != *pcName )
+            {
+                xMatch = pdFALSE;
+                break;
+            }
+
+            pcLine++;
+            pcName++;
+        }
+
+        if( xMatch != pdFALSE )
+        {
+            while( ( *pcLine == ' ' ) || ( *pcLine == '\t' ) )
+            {
+                pcLine++;
+            }
+
+            *ppcValue = pcLine;
         }
 
-        xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+        return xMatch;
+    }
+/*-----------------------------------------------------------*/
 
-        if( xRc > 0 )
+    static void prvParseRequestLine( HTTPClient_t * pxClient )
+    {
+        const char * pcLine = pxClient->pcLine;
+        const struct xWEB_COMMAND * curCmd = xWebCommands;
+        const char * pcUrl;
+        const char * pcEndOfUrl;
+        BaseType_t xIndex;
+
+        pxClient->bits.bInRequest = pdTRUE_UNSIGNED;
+        pxClient->bits.bBadRequest = pxClient->bits.bLineTooLong;
+        pxClient->pcIfNoneMatch[ 0 ] = '\0';
+        pxClient->pcIfModifiedSince[ 0 ] = '\0';
+        pxClient->uxBodyLeft = 0u;
+        pxClient->bits.bHasLength = pdFALSE_UNSIGNED;
+        pxClient->bits.bChunked = pdFALSE_UNSIGNED;
+        pxClient->bits.bExpectContinue = pdFALSE_UNSIGNED;
+        pxClient->pcUrl[ 0 ] = '\0';
+        pxClient->pcUrlData = pxClient->pcUrl;
+
+        /* Last entry is "ECMD_UNK". */
+        for( xIndex = 0; xIndex < WEB_CMD_COUNT - 1; xIndex++, curCmd++ )
         {
-            BaseType_t xIndex;
-            const char * pcEndOfCmd;
-            const struct xWEB_COMMAND * curCmd;
-            char * pcBuffer = pcCOMMAND_BUFFER;
+            BaseType_t xLength = curCmd->xCommandLength;
 
-            if( xRc < ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) )
+            if( ( memcmp( curCmd->pcCommandName, pcLine, xLength ) == 0 ) && ( pcLine[ xLength ] == ' ' ) )
             {
-                pcBuffer[ xRc ] = '\0';
+                break;
             }
+        }
+
+        pxClient->xCommand = xIndex;
+
+        /* "GET /index.html HTTP/1.1" */
+        pcUrl = strchr( pcLine, ' ' );
+        pcEndOfUrl = ( pcUrl != NULL ) ? strchr( pcUrl + 1, ' ' ) : NULL;
 
-            while( xRc && ( pcBuffer[ xRc - 1 ] == 13 || pcBuffer[ xRc - 1 ] == 10 ) )
+        if( pcEndOfUrl == NULL )
+        {
+            pxClient->bits.bBadRequest = pdTRUE_UNSIGNED;
+        }
+        else
+        {
+            pcUrl++;
+            snprintf( pxClient->pcUrl, sizeof( pxClient->pcUrl ), "%.*s", ( int ) ( pcEndOfUrl - pcUrl ), pcUrl );
+
+            /* HTTP/1.1 connections are persistent unless the client says
+             * otherwise, HTTP/1.0 connections are only when asked for. */
+            pxClient->bits.bKeepAlive = ( strcmp( pcEndOfUrl + 1, "HTTP/1.0" ) != 0 );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvParseLine( HTTPClient_t * pxClient )
+    {
+        const char * pcLine = pxClient->pcLine;
+        const char * pcValue;
+        BaseType_t xComplete = pdFALSE;
+
+        if( pxClient->bits.bInRequest == pdFALSE_UNSIGNED )
+        {
+            /* Empty lines before a request are ignored. */
+            if( pcLine[ 0 ] != '\0' )
             {
-                pcBuffer[ --xRc ] = '\0';
+                prvParseRequestLine( pxClient );
             }
+        }
+        else if( pcLine[ 0 ] == '\0' )
+        {
+            /* The empty line after the headers. */
+            pxClient->bits.bInRequest = pdFALSE_UNSIGNED;
+            xComplete = pdTRUE;
+        }
+        else if( prvHeaderValue( pcLine, "connection:", &pcValue ) != pdFALSE )
+        {
+            if( prvHeaderValue( pcValue, "close", &pcValue ) != pdFALSE )
+            {
+                pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+            }
+            else if( prvHeaderValue( pcValue, "keep-alive", &pcValue ) != pdFALSE )
+            {
+                pxClient->bits.bKeepAlive = pdTRUE_UNSIGNED;
+            }
+        }
+        else if( prvHeaderValue( pcLine, "if-none-match:", &pcValue ) != pdFALSE )
+        {
+            snprintf( pxClient->pcIfNoneMatch, sizeof( pxClient->pcIfNoneMatch ), "%s", pcValue );
+        }
+        else if( prvHeaderValue( pcLine, "if-modified-since:", &pcValue ) != pdFALSE )
+        {
+            snprintf( pxClient->pcIfModifiedSince, sizeof( pxClient->pcIfModifiedSince ), "%s", pcValue );
+        }
+        else if( prvHeaderValue( pcLine, "content-length:", &pcValue ) != pdFALSE )
+        {
+            char * pcEnd;
+
+            pxClient->uxBodyLeft = ( size_t ) strtoul( pcValue, &pcEnd, 10 );
+            pxClient->bits.bHasLength = pdTRUE_UNSIGNED;
 
-            pcEndOfCmd = pcBuffer + xRc;
+            if( ( pcEnd == pcValue ) || ( *pcValue == '-' ) )
+            {
+                pxClient->bits.bBadRequest = pdTRUE_UNSIGNED;
+            }
+        }
+        else if( prvHeaderValue( pcLine, "transfer-encoding:", &pcValue ) != pdFALSE )
+        {
+            /* "chunked" must be the last coding, other codings are not
+             * supported. */
+            pxClient->bits.bChunked = pdTRUE_UNSIGNED;
 
-            curCmd = xWebCommands;
+            if( prvHeaderValue( pcValue, "chunked", &pcValue ) == pdFALSE )
+            {
+                pxClient->bits.bBadRequest = pdTRUE_UNSIGNED;
+            }
+        }
+        else if( prvHeaderValue( pcLine, "expect:", &pcValue ) != pdFALSE )
+        {
+            pxClient->bits.bExpectContinue = ( prvHeaderValue( pcValue, "100-continue", &pcValue ) != pdFALSE );
+        }
 
-            /* Pointing to "/index.html HTTP/1.1". */
-            pxClient->pcUrlData = pcBuffer;
+        return xComplete;
+    }
+/*-----------------------------------------------------------*/
 
-            /* Pointing to "HTTP/1.1". */
-            pxClient->pcRestData = pcEmptyString;
+    static BaseType_t prvParseRequest( HTTPClient_t * pxClient,
+                                       const char * pcData,
+                                       BaseType_t xLength,
+                                       BaseType_t * pxComplete )
+    {
+        BaseType_t xIndex = 0;
 
-            /* Last entry is "ECMD_UNK". */
-            for( xIndex = 0; xIndex < WEB_CMD_COUNT - 1; xIndex++, curCmd++ )
-            {
-                BaseType_t xLength;
+        *pxComplete = pdFALSE;
 
-                xLength = curCmd->xCommandLength;
+        while( ( xIndex < xLength ) && ( *pxComplete == pdFALSE ) )
+        {
+            char cChar = pcData[ xIndex++ ];
 
-                if( ( xRc >= xLength ) && ( memcmp( curCmd->pcCommandName, pcBuffer, xLength ) == 0 ) )
+            if( cChar == '\n' )
+            {
+                if( ( pxClient->uxLineLength > 0u ) && ( pxClient->pcLine[ pxClient->uxLineLength - 1u ] == '\r' ) )
                 {
-                    char * pcLastPtr;
+                    pxClient->uxLineLength--;
+                }
 
-                    pxClient->pcUrlData += xLength + 1;
+                pxClient->pcLine[ pxClient->uxLineLength ] = '\0';
+                *pxComplete = prvParseLine( pxClient );
+                pxClient->uxLineLength = 0u;
+                pxClient->bits.bLineTooLong = pdFALSE_UNSIGNED;
+            }
+            else if( pxClient->uxLineLength < ( sizeof( pxClient->pcLine ) - 1u ) )
+            {
+                pxClient->pcLine[ pxClient->uxLineLength++ ] = cChar;
+            }
+            else
+            {
+                /* Only the start of a long line is kept. */
+                pxClient->bits.bLineTooLong = pdTRUE_UNSIGNED;
+            }
+        }
 
-                    for( pcLastPtr = ( char * ) pxClient->pcUrlData; pcLastPtr < pcEndOfCmd; pcLastPtr++ )
-                    {
-                        char ch = *pcLastPtr;
+        return xIndex;
+    }
+/*-----------------------------------------------------------*/
 
-                        if( ( ch == '\0' ) || ( strchr( "\n\r \t", ch ) != NULL ) )
-                        {
-                            *pcLastPtr = '\0';
-                            pxClient->pcRestData = pcLastPtr + 1;
-                            break;
-                        }
-                    }
+    static BaseType_t prvReplyBusy( HTTPClient_t * pxClient )
+    {
+        return ( pxClient->pxFileHandle != NULL ) || ( pxClient->pxCacheEntry != NULL ) ||
+               ( pxClient->xBodyState != eBODY_NONE );
+    }
+/*-----------------------------------------------------------*/
 
-                    break;
-                }
+    static void prvReplyDone( HTTPClient_t * pxClient )
+    {
+        if( ( pxClient->bits.bKeepAlive == pdFALSE_UNSIGNED ) && ( pxClient->bits.bClosing == pdFALSE_UNSIGNED ) )
+        {
+            /* The FIN will be sent after the data that is still queued. */
+            FreeRTOS_shutdown( pxClient->xSocket, FREERTOS_SHUT_RDWR );
+            pxClient->bits.bClosing = pdTRUE_UNSIGNED;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    BaseType_t xHTTPClientWork( TCPClient_t * pxTCPClient )
+    {
+        BaseType_t xRc = 0;
+        HTTPClient_t * pxClient = ( HTTPClient_t * ) pxTCPClient;
+
+        /* Continue the reply that is being sent. */
+        if( pxClient->pxFileHandle != NULL )
+        {
+            prvSendFile( pxClient );
+        }
+
+        #if ( httpUSE_CACHE != 0 )
+            else if( pxClient->pxCacheEntry != NULL )
+            {
+                prvSendCached( pxClient );
             }
+        #endif
 
-            if( xIndex < ( WEB_CMD_COUNT - 1 ) )
+        #if ( ipconfigHTTP_ALLOW_UPLOADS != 0 )
+            else if( pxClient->xBodyState != eBODY_NONE )
             {
-                xRc = prvProcessCmd( pxClient, xIndex );
+                /* Continue receiving the body of a POST or PUT request. */
+                xRc = prvReceiveBody( pxClient );
             }
+        #endif
+
+        if( ( prvReplyBusy( pxClient ) == pdFALSE ) && ( pxClient->bits.bReplySent != pdFALSE_UNSIGNED ) )
+        {
+            pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
+            prvReplyDone( pxClient );
         }
-        else if( xRc < 0 )
+
+        if( pxClient->bits.bClosing != pdFALSE_UNSIGNED )
+        {
+            /* Wait for the connection to close, and drop whatever comes in. */
+            xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+        }
+
+        /* Requests are handled one at a time.  Pipelined requests stay in the
+         * RX stream until the reply to the previous one has been queued. */
+        while( ( prvReplyBusy( pxClient ) == pdFALSE ) && ( pxClient->bits.bClosing == pdFALSE_UNSIGNED ) )
+        {
+            BaseType_t xComplete;
+            BaseType_t xUsed;
+
+            xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), FREERTOS_MSG_PEEK );
+
+            if( xRc <= 0 )
+            {
+                break;
+            }
+
+            /* Only take the bytes of this request out of the RX stream. */
+            xUsed = prvParseRequest( pxClient, pcCOMMAND_BUFFER, xRc, &xComplete );
+            xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, xUsed, 0 );
+
+            if( ( xRc <= 0 ) || ( xComplete == pdFALSE ) )
+            {
+                break;
+            }
+
+            prvProcessCmd( pxClient, pxClient->xCommand );
+
+            if( prvReplyBusy( pxClient ) == pdFALSE )
+            {
+                pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
+                prvReplyDone( pxClient );
+            }
+        }
+
+        if( xRc < 0 )
         {
             /* The connection will be closed and the client will be deleted. */
             FreeRTOS_printf( ( "xHTTPClientWork: rc = %ld\n", xRc ) );
         }
+        else if( ( prvReplyBusy( pxClient ) != pdFALSE ) && ( pxClient->xBodyState == eBODY_NONE ) )
+        {
+            /* Wake up as soon as there is space in the TX stream.  The next
+             * request need not wake up this task before that. */
+            FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_READ );
+            FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+        }
+        else
+        {
+            FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+            FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_READ );
+        }
 
         return xRc;
     }
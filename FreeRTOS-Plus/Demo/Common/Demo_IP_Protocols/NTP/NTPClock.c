@@ -0,0 +1,474 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ *!
+ *! The protocols implemented in this file are intended to be demo quality only,
+ *! and not for production devices.
+ *!
+ *
+ * NTPClock.c
+ *
+ * A clock that is disciplined by NTP samples, see NTPClock.h.
+ *
+ * The local time is a linear function of the counter:
+ *
+ *     time = base + elapsed + elapsed * frequency + min( elapsed, slew ) * slew_rate
+ *
+ * in which 'elapsed' is the nominal number of nanoseconds counted since the
+ * base.  Each sample that is used moves the base to the current time, so the
+ * clock stays continuous, and sets new rates.  The rates are fractions in units
+ * of 2^-32, so that reading the time needs no division by a variable.
+ *
+ * The clock filter keeps the last ntpclockFILTER_SIZE samples and uses the one
+ * with the shortest round trip, as that one has the smallest error.  A sample
+ * is only used when it is newer than the last one used.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+
+#include "NTPClock.h"
+
+/*
+ * ipconfigNTP_CLOCK_COUNTER(): returns a free running 64-bit counter, which
+ * counts at ipconfigNTP_CLOCK_COUNTER_HZ.  The default is the tick count,
+ * extended to 64 bits.
+ */
+#ifndef ipconfigNTP_CLOCK_COUNTER
+    #define ipconfigNTP_CLOCK_COUNTER()     prvGetTickCount64()
+    #define ipconfigNTP_CLOCK_COUNTER_HZ    configTICK_RATE_HZ
+    #define ntpclockUSE_TICK_COUNT          1
+#endif
+
+#ifndef ipconfigNTP_CLOCK_COUNTER_HZ
+    #error ipconfigNTP_CLOCK_COUNTER_HZ must be defined along with ipconfigNTP_CLOCK_COUNTER()
+#endif
+
+/* An offset above this is corrected by stepping the clock.  Smaller offsets
+ * are slewed at ntpclockMAX_SLEW_RATE, 0.5 ms per second.  Must be less than
+ * 1000 ms. */
+#ifndef ipconfigNTP_STEP_THRESHOLD_MS
+    #define ipconfigNTP_STEP_THRESHOLD_MS    128
+#endif
+
+/* Range of the interval between requests. */
+#ifndef ipconfigNTP_MIN_POLL_SECONDS
+    #define ipconfigNTP_MIN_POLL_SECONDS    16U
+#endif
+
+#ifndef ipconfigNTP_MAX_POLL_SECONDS
+    #define ipconfigNTP_MAX_POLL_SECONDS    1024U
+#endif
+
+#define ntpclockFILTER_SIZE       8
+
+/* 500 ppm in units of 2^-32. */
+#define ntpclockMAX_FREQUENCY     ( ( int32_t ) 2147484 )
+#define ntpclockMAX_SLEW_RATE     ( ( int32_t ) 2147484 )
+
+/* A frequency estimate changes the current one by 1 / ntpclockFLL_GAIN of the
+ * difference, to average out the jitter of the samples. */
+#define ntpclockFLL_GAIN          4
+
+/* The poll interval doubles while the offsets stay below the first limit, and
+ * halves when one exceeds the second. */
+#define ntpclockPOLL_UP_NS        ( 2LL * 1000000LL )
+#define ntpclockPOLL_DOWN_NS      ( 16LL * 1000000LL )
+
+#define ntpclockSTEP_THRESHOLD_NS ( ( int64_t ) ipconfigNTP_STEP_THRESHOLD_MS * 1000000LL )
+
+/*-----------------------------------------------------------*/
+
+typedef struct xNTP_CLOCK_MODEL
+{
+    uint64_t ullBaseCounter; /* Counter value at which 'llBaseNs' was the time. */
+    int64_t llBaseNs;        /* Time in ns since 1-1-1970. */
+    uint64_t ullSlewNs;      /* Nominal ns after the base during which the slew rate applies. */
+    int32_t lFrequency;      /* Rate correction in units of 2^-32. */
+    int32_t lSlewRate;       /* Rate correction in units of 2^-32. */
+} NTPClockModel_t;
+
+typedef struct xNTP_CLOCK_SAMPLE
+{
+    int64_t llResidualNs; /* Offset minus the part of it that was still being slewed. */
+    int64_t llDelayNs;
+    int64_t llLocalNs;    /* Local time at which the sample was taken. */
+} NTPClockSample_t;
+
+/*-----------------------------------------------------------*/
+
+/* The model is written by xNTPClockAddSample() only, within a critical section,
+ * and read without a lock: a reader repeats its copy when the sequence number
+ * was odd or has changed. */
+static volatile NTPClockModel_t xModel;
+static volatile uint32_t ulSequence;
+
+/* The fields below are only accessed by the task that passes the samples,
+ * except for 'xStatus', which is copied within a critical section. */
+static NTPClockSample_t xSamples[ ntpclockFILTER_SIZE ];
+static BaseType_t xSampleCount;
+static BaseType_t xSampleHead;
+static int64_t llLastUsedNs;
+static BaseType_t xFrequencySet;
+static NTPClockStatus_t xStatus = { 0, 0, 0, ipconfigNTP_MIN_POLL_SECONDS, 0, pdFALSE };
+
+/*-----------------------------------------------------------*/
+
+#ifdef ntpclockUSE_TICK_COUNT
+    static uint64_t prvGetTickCount64( void )
+    {
+        TimeOut_t xTimeOut;
+
+        /* vTaskSetTimeOutState() reads the tick count and the number of times
+         * it overflowed within one critical section. */
+        vTaskSetTimeOutState( &xTimeOut );
+
+        /* Shift in two steps, so that a 64-bit TickType_t does not shift by
+         * the width of the type. */
+        return ( ( ( uint64_t ) ( UBaseType_t ) xTimeOut.xOverflowCount << ( 4U * sizeof( TickType_t ) ) ) << ( 4U * sizeof( TickType_t ) ) ) |
+               ( uint64_t ) xTimeOut.xTimeOnEntering;
+    }
+#endif /* ntpclockUSE_TICK_COUNT */
+/*-----------------------------------------------------------*/
+
+static uint64_t prvCountsToNs( uint64_t ullCounts )
+{
+    const uint64_t ullHz = ( uint64_t ) ipconfigNTP_CLOCK_COUNTER_HZ;
+    uint64_t ullResult;
+
+    /* Both branches are resolved by the compiler. */
+    if( ( ( uint64_t ) ntpclockNS_PER_SEC % ullHz ) == 0U )
+    {
+        ullResult = ullCounts * ( ( uint64_t ) ntpclockNS_PER_SEC / ullHz );
+    }
+    else
+    {
+        ullResult = ( ( ullCounts / ullHz ) * ( uint64_t ) ntpclockNS_PER_SEC ) +
+                    ( ( ( ullCounts % ullHz ) * ( uint64_t ) ntpclockNS_PER_SEC ) / ullHz );
+    }
+
+    return ullResult;
+}
+/*-----------------------------------------------------------*/
+
+/* Multiply a number of ns by a rate in units of 2^-32, in two halves so that
+ * the product can not overflow. */
+static int64_t prvScale( uint64_t ullNs,
+                         int32_t lRate )
+{
+    int64_t llHigh = ( int64_t ) ( ullNs >> 32 ) * lRate;
+    int64_t llLow = ( int64_t ) ( ullNs & 0xFFFFFFFFULL ) * lRate;
+
+    return llHigh + ( llLow / 4294967296LL );
+}
+/*-----------------------------------------------------------*/
+
+static int64_t prvEvaluate( const NTPClockModel_t * pxModel,
+                            uint64_t ullCounter )
+{
+    uint64_t ullElapsed = prvCountsToNs( ullCounter - pxModel->ullBaseCounter );
+    uint64_t ullSlewed = ( ullElapsed < pxModel->ullSlewNs ) ? ullElapsed : pxModel->ullSlewNs;
+
+    return pxModel->llBaseNs + ( int64_t ) ullElapsed +
+           prvScale( ullElapsed, pxModel->lFrequency ) +
+           prvScale( ullSlewed, pxModel->lSlewRate );
+}
+/*-----------------------------------------------------------*/
+
+/* Copy the model and read the counter.  The counter is read after the copy,
+ * so it can not be older than the base. */
+static uint64_t prvReadModel( NTPClockModel_t * pxModel )
+{
+    uint32_t ulSeq;
+    uint64_t ullCounter;
+
+    for( ; ; )
+    {
+        ulSeq = ulSequence;
+        portMEMORY_BARRIER();
+        *pxModel = xModel;
+        ullCounter = ipconfigNTP_CLOCK_COUNTER();
+        portMEMORY_BARRIER();
+
+        if( ( ( ulSeq & 1U ) == 0U ) && ( ulSeq == ulSequence ) )
+        {
+            break;
+        }
+    }
+
+    return ullCounter;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteModel( const NTPClockModel_t * pxModel )
+{
+    /* The critical section keeps a reader from preempting the update and
+     * waiting for it forever. */
+    taskENTER_CRITICAL();
+    {
+        ulSequence++;
+        portMEMORY_BARRIER();
+        xModel = *pxModel;
+        portMEMORY_BARRIER();
+        ulSequence++;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+/* The part of the slew that has not been applied yet, 'ullElapsed' ns after
+ * the base. */
+static int64_t prvRemainingSlew( const NTPClockModel_t * pxModel,
+                                 uint64_t ullElapsed )
+{
+    uint64_t ullSlewed = ( ullElapsed < pxModel->ullSlewNs ) ? ullElapsed : pxModel->ullSlewNs;
+
+    return prvScale( pxModel->ullSlewNs, pxModel->lSlewRate ) - prvScale( ullSlewed, pxModel->lSlewRate );
+}
+/*-----------------------------------------------------------*/
+
+static int64_t prvAbs( int64_t llValue )
+{
+    return ( llValue < 0 ) ? -llValue : llValue;
+}
+/*-----------------------------------------------------------*/
+
+int64_t llNTPClockGetTimeNs( void )
+{
+    NTPClockModel_t xCopy;
+    uint64_t ullCounter;
+
+    ullCounter = prvReadModel( &xCopy );
+
+    return prvEvaluate( &xCopy, ullCounter );
+}
+/*-----------------------------------------------------------*/
+
+time_t xNTPClockGetTime( uint32_t * pulNanoSeconds )
+{
+    int64_t llNow = llNTPClockGetTimeNs();
+
+    if( pulNanoSeconds != NULL )
+    {
+        *pulNanoSeconds = ( uint32_t ) ( llNow % ntpclockNS_PER_SEC );
+    }
+
+    return ( time_t ) ( llNow / ntpclockNS_PER_SEC );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetStatus( int64_t llOffset,
+                          int64_t llDelay,
+                          int32_t lFrequency,
+                          uint32_t ulPollSeconds,
+                          BaseType_t xStepped )
+{
+    taskENTER_CRITICAL();
+    {
+        xStatus.llOffsetNs = llOffset;
+        xStatus.llDelayNs = llDelay;
+        /* 2^-32 to ppb: 10^9 / 2^32 = 0.2328. */
+        xStatus.lFrequencyPPB = ( int32_t ) ( ( ( int64_t ) lFrequency * ntpclockNS_PER_SEC ) / 4294967296LL );
+        xStatus.ulPollSeconds = ulPollSeconds;
+        xStatus.xSynchronised = pdTRUE;
+
+        if( xStepped != pdFALSE )
+        {
+            xStatus.ulSteps++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNTPClockAddSample( int64_t llT1,
+                               int64_t llT2,
+                               int64_t llT3,
+                               int64_t llT4 )
+{
+    NTPClockModel_t xCurrent;
+    NTPClockModel_t xNew;
+    NTPClockSample_t * pxBest;
+    uint64_t ullCounter;
+    uint64_t ullElapsed;
+    int64_t llNow;
+    int64_t llOffset;
+    int64_t llDelay;
+    int64_t llRemaining;
+    int64_t llAmount;
+    uint32_t ulPollSeconds = xStatus.ulPollSeconds;
+    BaseType_t xIndex;
+
+    llOffset = ( ( llT2 - llT1 ) + ( llT3 - llT4 ) ) / 2;
+    llDelay = ( llT4 - llT1 ) - ( llT3 - llT2 );
+
+    if( llDelay < 0 )
+    {
+        /* Possible when the resolution of the local clock is coarse. */
+        llDelay = 0;
+    }
+
+    ullCounter = prvReadModel( &xCurrent );
+    ullElapsed = prvCountsToNs( ullCounter - xCurrent.ullBaseCounter );
+    llNow = prvEvaluate( &xCurrent, ullCounter );
+    llRemaining = prvRemainingSlew( &xCurrent, ullElapsed );
+
+    xNew = xCurrent;
+    xNew.ullBaseCounter = ullCounter;
+    xNew.llBaseNs = llNow;
+
+    if( ( xStatus.xSynchronised == pdFALSE ) || ( prvAbs( llOffset ) > ntpclockSTEP_THRESHOLD_NS ) )
+    {
+        /* Set the time and cancel any slew.  The samples in the filter were
+         * taken on the old time scale and are dropped. */
+        xNew.llBaseNs = llNow + llOffset;
+        xNew.lSlewRate = 0;
+        xNew.ullSlewNs = 0U;
+        prvWriteModel( &xNew );
+
+        xSampleCount = 0;
+        xSampleHead = 0;
+        llLastUsedNs = llT4 + llOffset;
+        prvSetStatus( llOffset, llDelay, xNew.lFrequency, ipconfigNTP_MIN_POLL_SECONDS, pdTRUE );
+
+        return pdTRUE;
+    }
+
+    xSamples[ xSampleHead ].llResidualNs = llOffset - llRemaining;
+    xSamples[ xSampleHead ].llDelayNs = llDelay;
+    xSamples[ xSampleHead ].llLocalNs = llT4;
+    xSampleHead = ( xSampleHead + 1 ) % ntpclockFILTER_SIZE;
+
+    if( xSampleCount < ntpclockFILTER_SIZE )
+    {
+        xSampleCount++;
+    }
+
+    pxBest = &( xSamples[ 0 ] );
+
+    for( xIndex = 1; xIndex < xSampleCount; xIndex++ )
+    {
+        if( xSamples[ xIndex ].llDelayNs < pxBest->llDelayNs )
+        {
+            pxBest = &( xSamples[ xIndex ] );
+        }
+    }
+
+    if( pxBest->llLocalNs <= llLastUsedNs )
+    {
+        /* The best sample has been used already, or is older than one that
+         * was used. */
+        return pdFALSE;
+    }
+
+    /* What remains after the earlier corrections has built up since the last
+     * sample used, because of the frequency error. */
+    if( ( pxBest->llLocalNs - llLastUsedNs ) >= ( ( ( int64_t ) ipconfigNTP_MIN_POLL_SECONDS * ntpclockNS_PER_SEC ) / 2 ) )
+    {
+        int64_t llError = ( pxBest->llResidualNs * 4294967296LL ) / ( pxBest->llLocalNs - llLastUsedNs );
+
+        if( xFrequencySet != pdFALSE )
+        {
+            llError /= ntpclockFLL_GAIN;
+        }
+
+        llError += xNew.lFrequency;
+
+        if( llError > ntpclockMAX_FREQUENCY )
+        {
+            llError = ntpclockMAX_FREQUENCY;
+        }
+        else if( llError < -ntpclockMAX_FREQUENCY )
+        {
+            llError = -ntpclockMAX_FREQUENCY;
+        }
+        else
+        {
+            /* The estimate is within range. */
+        }
+
+        xNew.lFrequency = ( int32_t ) llError;
+        xFrequencySet = pdTRUE;
+    }
+
+    /* Slew away the offset of the sample and what was still left of the
+     * previous slew. */
+    llAmount = pxBest->llResidualNs + llRemaining;
+    xNew.lSlewRate = ( llAmount < 0 ) ? -ntpclockMAX_SLEW_RATE : ntpclockMAX_SLEW_RATE;
+    xNew.ullSlewNs = ( uint64_t ) ( ( prvAbs( llAmount ) * 4294967296LL ) / ntpclockMAX_SLEW_RATE );
+    prvWriteModel( &xNew );
+
+    if( prvAbs( pxBest->llResidualNs ) < ntpclockPOLL_UP_NS )
+    {
+        if( ulPollSeconds < ipconfigNTP_MAX_POLL_SECONDS )
+        {
+            ulPollSeconds *= 2U;
+        }
+    }
+    else if( prvAbs( pxBest->llResidualNs ) > ntpclockPOLL_DOWN_NS )
+    {
+        if( ulPollSeconds > ipconfigNTP_MIN_POLL_SECONDS )
+        {
+            ulPollSeconds /= 2U;
+        }
+    }
+    else
+    {
+        /* Keep the interval. */
+    }
+
+    llLastUsedNs = pxBest->llLocalNs;
+    prvSetStatus( pxBest->llResidualNs, pxBest->llDelayNs, xNew.lFrequency, ulPollSeconds, pdFALSE );
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+TickType_t xNTPClockPollInterval( void )
+{
+    return ( TickType_t ) xStatus.ulPollSeconds * ( TickType_t ) configTICK_RATE_HZ;
+}
+/*-----------------------------------------------------------*/
+
+void vNTPClockGetStatus( NTPClockStatus_t * pxStatus )
+{
+    taskENTER_CRITICAL();
+    {
+        *pxStatus = xStatus;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
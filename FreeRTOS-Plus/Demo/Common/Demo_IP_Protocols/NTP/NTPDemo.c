@@ -35,6 +35,9 @@
  * An example of how to lookup a domain using DNS
  * And also how to send and receive UDP messages to get the NTP time
  *
+ * The replies are passed to NTPClock.c, which disciplines a local clock.  The
+ * server is asked again after the poll interval that NTPClock.c chooses.
+ *
  */
 
 /* Standard includes. */
@@ -59,6 +62,7 @@
 
 #include "NTPDemo.h"
 #include "ntpClient.h"
+#include "NTPClock.h"
 
 #include "date_and_time.h"
 
@@ -94,6 +98,11 @@ static Socket_t xUDPSocket = NULL;
 static TaskHandle_t xNTPTaskhandle = NULL;
 static TickType_t uxSendTime;
 
+/* The transmit time of the last request, which the server returns as the
+ * originate time, in host order and in ns. */
+static SNtpTimestamp xRequestTimestamp;
+static int64_t llRequestTimeNs;
+
 static void prvNTPTask( void * pvParameters );
 
 static void vSignalTask( void )
@@ -237,6 +246,25 @@ static void prvSwapFields( struct SNtpPacket * pxPacket )
 }
 /*-----------------------------------------------------------*/
 
+static int64_t prvNTPToNs( const SNtpTimestamp * pxTimestamp )
+{
+    /* The unsigned subtraction keeps working after the NTP era rolls over
+     * in 2036. */
+    uint32_t ulSeconds = pxTimestamp->seconds - ( uint32_t ) TIME1970;
+
+    return ( ( int64_t ) ulSeconds * ntpclockNS_PER_SEC ) +
+           ( int64_t ) ( ( ( uint64_t ) pxTimestamp->fraction * ( uint64_t ) ntpclockNS_PER_SEC ) >> 32 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvNsToNTP( int64_t llNs,
+                        SNtpTimestamp * pxTimestamp )
+{
+    pxTimestamp->seconds = ( quint32 ) ( llNs / ntpclockNS_PER_SEC ) + ( quint32 ) TIME1970;
+    pxTimestamp->fraction = ( quint32 ) ( ( ( uint64_t ) ( llNs % ntpclockNS_PER_SEC ) << 32 ) / ( uint64_t ) ntpclockNS_PER_SEC );
+}
+/*-----------------------------------------------------------*/
+
 static void prvNTPPacketInit()
 {
     memset( &xNTPPacket, '\0', sizeof( xNTPPacket ) );
@@ -247,80 +275,66 @@ static void prvNTPPacketInit()
     xNTPPacket.rootDelay = 0x5D2E;          /* 0x5D2E = 23854 or (23854/65535)= 0.3640 sec */
     xNTPPacket.rootDispersion = 0x0008CAC8; /* 0x0008CAC8 = 8.7912  seconds */
 
-    /* use the recorded NTP time */
-    time_t uxSecs = FreeRTOS_time( NULL );          /* apTime may be NULL, returns seconds */
+    /* The server copies the transmit time to the originate time of its reply,
+     * which identifies the reply and gives the first of the four timestamps. */
+    llRequestTimeNs = llNTPClockGetTimeNs();
+    prvNsToNTP( llRequestTimeNs, &xRequestTimestamp );
 
-    xNTPPacket.referenceTimestamp.seconds = uxSecs; /* Current time */
-    xNTPPacket.transmitTimestamp.seconds = uxSecs + 3;
+    xNTPPacket.referenceTimestamp = xRequestTimestamp;
+    xNTPPacket.transmitTimestamp = xRequestTimestamp;
 
     /* Transform the contents of the fields from native to big endian. */
     prvSwapFields( &xNTPPacket );
 }
 /*-----------------------------------------------------------*/
 
-static void prvReadTime( struct SNtpPacket * pxPacket )
+static BaseType_t prvReadTime( struct SNtpPacket * pxPacket )
 {
     FF_TimeStruct_t xTimeStruct;
-    time_t uxPreviousSeconds;
-    time_t uxPreviousMS;
-
+    NTPClockStatus_t xClockStatus;
+    int64_t llReceiveTimeNs;
     time_t uxCurrentSeconds;
     time_t uxCurrentMS;
-
-    const char * pcTimeUnit;
-    int32_t ilDiff;
+    uint32_t ulNanoSeconds;
     TickType_t uxTravelTime;
 
+    /* The fourth timestamp: the time of arrival. */
+    llReceiveTimeNs = llNTPClockGetTimeNs();
     uxTravelTime = xTaskGetTickCount() - uxSendTime;
 
     /* Transform the contents of the fields from big to native endian. */
     prvSwapFields( pxPacket );
 
-    uxCurrentSeconds = pxPacket->receiveTimestamp.seconds - TIME1970;
-    uxCurrentMS = pxPacket->receiveTimestamp.fraction / 4294967;
-    uxCurrentSeconds += uxCurrentMS / 1000;
-    uxCurrentMS = uxCurrentMS % 1000;
+    if( ( pxPacket->originateTimestamp.seconds != xRequestTimestamp.seconds ) ||
+        ( pxPacket->originateTimestamp.fraction != xRequestTimestamp.fraction ) ||
+        ( pxPacket->stratum == 0U ) )
+    {
+        /* A reply to an earlier request, or a kiss-of-death message. */
+        FreeRTOS_printf( ( "NTP reply ignored (stratum %u)\n", ( unsigned ) pxPacket->stratum ) );
+        return pdFALSE;
+    }
 
-    /* Get the last time recorded */
-    uxPreviousSeconds = FreeRTOS_get_secs_msec( &uxPreviousMS );
+    ( void ) xNTPClockAddSample( llRequestTimeNs,
+                                 prvNTPToNs( &( pxPacket->receiveTimestamp ) ),
+                                 prvNTPToNs( &( pxPacket->transmitTimestamp ) ),
+                                 llReceiveTimeNs );
 
-    /* Set the new time with precision in msec. * / */
+    /* Let FreeRTOS_time() follow the disciplined clock. */
+    uxCurrentSeconds = xNTPClockGetTime( &ulNanoSeconds );
+    uxCurrentMS = ( time_t ) ( ulNanoSeconds / 1000000U );
     FreeRTOS_set_secs_msec( &uxCurrentSeconds, &uxCurrentMS );
 
-    if( uxCurrentSeconds >= uxPreviousSeconds )
-    {
-        ilDiff = ( int32_t ) ( uxCurrentSeconds - uxPreviousSeconds );
-    }
-    else
-    {
-        ilDiff = 0 - ( int32_t ) ( uxPreviousSeconds - uxCurrentSeconds );
-    }
-
-    if( ( ilDiff < -5 ) || ( ilDiff > 5 ) )
-    {
-        /* More than 5 seconds difference. */
-        pcTimeUnit = "sec";
-    }
-    else
-    {
-        /* Less than or equal to 5 second difference. */
-        pcTimeUnit = "ms";
-        uint32_t ulLowest = ( uxCurrentSeconds <= uxPreviousSeconds ) ? uxCurrentSeconds : uxPreviousSeconds;
-        int32_t iCurMS = 1000 * ( uxCurrentSeconds - ulLowest ) + uxCurrentMS;
-        int32_t iPrevMS = 1000 * ( uxPreviousSeconds - ulLowest ) + uxPreviousMS;
-        ilDiff = iCurMS - iPrevMS;
-    }
+    vNTPClockGetStatus( &xClockStatus );
 
     uxCurrentSeconds -= iTimeZone;
 
     FreeRTOS_gmtime_r( &uxCurrentSeconds, &xTimeStruct );
 
     /*
-     *  378.067 [NTP client] NTP time: 9/11/2015 16:11:19.559 Diff -20 ms (289 ms)
-     *  379.441 [NTP client] NTP time: 9/11/2015 16:11:20.933 Diff 0 ms (263 ms)
+     *  378.067 [NTP client] NTP time: 9/11/2015 16:11:19.559 Offset -20113 us delay 2871 us freq -31250 ppb poll 16 s (289 ms)
      */
 
-    FreeRTOS_printf( ( "NTP time: %d/%d/%02d %2d:%02d:%02d.%03u Diff %d %s (%lu ms)\n",
+    FreeRTOS_printf( ( "NTP time: %d/%d/%02d %2d:%02d:%02d.%03u Offset %ld us delay %lu us freq %ld ppb poll %lu s (%lu ms)\n",
                        xTimeStruct.tm_mday,
                        xTimeStruct.tm_mon + 1,
                        xTimeStruct.tm_year + 1900,
@@ -328,13 +342,17 @@ static void prvReadTime( struct SNtpPacket * pxPacket )
                        xTimeStruct.tm_min,
                        xTimeStruct.tm_sec,
                        ( unsigned ) uxCurrentMS,
-                       ( unsigned ) ilDiff,
-                       pcTimeUnit,
-                       uxTravelTime ) );
+                       ( long ) ( xClockStatus.llOffsetNs / 1000 ),
+                       ( unsigned long ) ( xClockStatus.llDelayNs / 1000 ),
+                       ( long ) xClockStatus.lFrequencyPPB,
+                       ( unsigned long ) xClockStatus.ulPollSeconds,
+                       ( unsigned long ) uxTravelTime ) );
 
     /* Remove compiler warnings in case FreeRTOS_printf() is not used. */
-    ( void ) pcTimeUnit;
     ( void ) uxTravelTime;
+    ( void ) xClockStatus;
+
+    return pdTRUE;
 }
 /*-----------------------------------------------------------*/
 
@@ -348,9 +366,7 @@ static void prvReadTime( struct SNtpPacket * pxPacket )
     {
         if( xLength >= sizeof( xNTPPacket ) )
         {
-            prvReadTime( ( struct SNtpPacket * ) pvData );
-
-            if( xStatus != EStatusPause )
+            if( prvReadTime( ( struct SNtpPacket * ) pvData ) != pdFALSE )
             {
                 xStatus = EStatusPause;
             }
@@ -395,6 +411,13 @@ static void prvNTPTask( void * pvParameters )
 
     for( ; ; )
     {
+        if( ( xStatus == EStatusPause ) &&
+            ( ( xTaskGetTickCount() - uxSendTime ) >= xNTPClockPollInterval() ) )
+        {
+            /* Time for the next sample. */
+            xStatus = EStatusAsking;
+        }
+
         switch( xStatus )
         {
             case EStatusLookup:
@@ -420,8 +443,6 @@ static void prvNTPTask( void * pvParameters )
                {
                    char pcBuf[ 16 ];
 
-                   prvNTPPacketInit();
-
                    #if defined( ipconfigIPv4_BACKWARD_COMPATIBLE ) && ( ipconfigIPv4_BACKWARD_COMPATIBLE == 0 )
                    {
                        xAddress.sin_address.ulIP_IPv4 = ulIPAddressFound;
@@ -442,6 +463,8 @@ static void prvNTPTask( void * pvParameters )
                                       pcBuf,
                                       FreeRTOS_ntohs( xAddress.sin_port ) ) );
 
+                   /* Take the transmit time as late as possible. */
+                   prvNTPPacketInit();
                    uxSendTime = xTaskGetTickCount();
                    FreeRTOS_sendto( xUDPSocket, ( void * ) &xNTPPacket, sizeof( xNTPPacket ), 0, &xAddress, sizeof( xAddress ) );
                }
@@ -481,9 +504,7 @@ static void prvNTPTask( void * pvParameters )
                     }
                     else
                     {
-                        prvReadTime( ( struct SNtpPacket * ) cRecvBuffer );
-
-                        if( xStatus != EStatusPause )
+                        if( prvReadTime( ( struct SNtpPacket * ) cRecvBuffer ) != pdFALSE )
                         {
                             xStatus = EStatusPause;
                         }
@@ -39,6 +39,12 @@
 /* Each HTTP server has 1, at most 2 sockets */
 #define HTTP_SOCKET_COUNT    2
 
+/* The longest line of an HTTP request that is stored.  The request line must
+ * fit, longer header lines are cut short. */
+#ifndef ipconfigHTTP_LINE_LENGTH
+    #define ipconfigHTTP_LINE_LENGTH    ( ffconfigMAX_FILENAME + 32 )
+#endif
+
 /*
  * ipconfigTCP_COMMAND_BUFFER_SIZE sets the size of:
  *     pcCommandBuffer': a buffer to receive and send TCP commands
@@ -57,7 +63,53 @@
     #define ipconfigTCP_FILE_BUFFER_SIZE    ( 2048 )
 #endif
 
+/*
+ * ipconfigTCP_SERVER_TX_ZERO_COPY: when non-zero, xTCPServerSendFile() reads
+ * file data straight into the TX stream of the socket, see
+ * FreeRTOS_get_tx_head().  Otherwise the data is read into pcFileBuffer and
+ * copied by FreeRTOS_send().  ipconfigFTP_TX_ZERO_COPY is the old name.
+ */
+#if defined( ipconfigFTP_TX_ZERO_COPY ) && !defined( ipconfigTCP_SERVER_TX_ZERO_COPY )
+    #define ipconfigTCP_SERVER_TX_ZERO_COPY    ipconfigFTP_TX_ZERO_COPY
+#endif
+
+#ifndef ipconfigTCP_SERVER_TX_ZERO_COPY
+    #define ipconfigTCP_SERVER_TX_ZERO_COPY    ( 1 )
+#endif
+
+/*
+ * ipconfigTCP_SERVER_WORKER_COUNT sets the number of worker tasks that serve
+ * the clients of a server.  When zero, the clients are served by the task that
+ * calls FreeRTOS_TCPServerWork().  Otherwise that task only accepts new
+ * connections, and hands each new client to the worker which has the fewest
+ * clients.  Each worker has its own socket set and its own buffers.
+ * The workers are woken up with FreeRTOS_SignalSocket(), so
+ * ipconfigSUPPORT_SIGNALS must be enabled.
+ */
+#ifndef ipconfigTCP_SERVER_WORKER_COUNT
+    #define ipconfigTCP_SERVER_WORKER_COUNT    ( 0 )
+#endif
+
+#if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+    #if ( ipconfigSUPPORT_SIGNALS == 0 )
+        #error ipconfigTCP_SERVER_WORKER_COUNT requires ipconfigSUPPORT_SIGNALS
+    #endif
+
+    #include "queue.h"
+
+    #ifndef ipconfigTCP_SERVER_WORKER_STACK_SIZE
+        #define ipconfigTCP_SERVER_WORKER_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 8 )
+    #endif
+
+/* By default the workers run at the priority of the task that creates the
+ * server. */
+    #ifndef ipconfigTCP_SERVER_WORKER_PRIORITY
+        #define ipconfigTCP_SERVER_WORKER_PRIORITY    ( uxTaskPriorityGet( NULL ) )
+    #endif
+#endif /* ipconfigTCP_SERVER_WORKER_COUNT > 0 */
+
 struct xTCP_CLIENT;
+struct xHTTP_CACHE_ENTRY;
 
 typedef BaseType_t ( * FTCPWorkFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
 typedef void ( * FTCPDeleteFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
@@ -69,7 +121,8 @@ typedef void ( * FTCPDeleteFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
     const char * pcRootDir;             \
     FTCPWorkFunction fWorkFunction;     \
     FTCPDeleteFunction fDeleteFunction; \
-    struct xTCP_CLIENT * pxNextClient
+    struct xTCP_CLIENT * pxNextClient;  \
+    BaseType_t xWorkPending
 
 typedef struct xTCP_CLIENT
 {
@@ -85,16 +138,40 @@ struct xHTTP_CLIENT
     /* --- Keep at the top  --- */
 
     const char * pcUrlData;
-    const char * pcRestData;
     char pcCurrentFilename[ ffconfigMAX_FILENAME ];
     size_t uxBytesLeft;
     FF_FILE * pxFileHandle;
+    /* Set while the reply is sent from the cache of the server. */
+    struct xHTTP_CACHE_ENTRY * pxCacheEntry;
+    /* The file that a POST or PUT body is written to. */
+    FF_FILE * pxWriteHandle;
+    size_t uxBodyLeft;  /* Bytes left in the body, or in the current chunk. */
+    BaseType_t xBodyState;
+
+    /* The request that is being received.  A request may arrive in pieces,
+     * it is parsed line by line. */
+    char pcLine[ ipconfigHTTP_LINE_LENGTH ];
+    size_t uxLineLength;
+    BaseType_t xCommand;
+    char pcUrl[ ffconfigMAX_FILENAME ];
+    char pcIfNoneMatch[ 48 ];
+    char pcIfModifiedSince[ 32 ];
     union
     {
         struct
         {
             uint32_t
-                bReplySent : 1;
+                bReplySent : 1,
+                bInRequest : 1,  /* The request line has been received. */
+                bBadRequest : 1, /* The request line could not be parsed. */
+                bLineTooLong : 1,
+                bHeadOnly : 1,   /* A HEAD request: no body in the reply. */
+                bKeepAlive : 1,  /* Leave the connection open after the reply. */
+                bClosing : 1,    /* FreeRTOS_shutdown() has been called. */
+                bHasLength : 1,  /* The request has a Content-Length. */
+                bChunked : 1,    /* The request body is sent in chunks. */
+                bExpectContinue : 1,
+                bCreated : 1;    /* The upload created a new file. */
         };
         uint32_t ulFlags;
     }
@@ -163,6 +240,21 @@ BaseType_t xFTPClientWork( TCPClient_t * pxClient );
 void vHTTPClientDelete( TCPClient_t * pxClient );
 void vFTPClientDelete( TCPClient_t * pxClient );
 
+/*
+ * Send file data until the TX stream of xSocket is full, or until
+ * *puxBytesLeft bytes have been sent.  *puxBytesLeft is decremented by the
+ * amount read from the file.  pcBuffer is used when the data can not be read
+ * into the TX stream directly.  With xCloseWhenDone, the connection is closed
+ * once the last byte has been sent.  Returns the number of bytes queued, or a
+ * negative errno.
+ */
+BaseType_t xTCPServerSendFile( Socket_t xSocket,
+                               FF_FILE * pxFile,
+                               size_t * puxBytesLeft,
+                               char * pcBuffer,
+                               size_t uxBufferSize,
+                               BaseType_t xCloseWhenDone );
+
 BaseType_t xMakeAbsolute( struct xFTP_CLIENT * pxClient,
                           char * pcBuffer,
                           BaseType_t xBufferLength,
@@ -184,11 +276,26 @@ struct xTCP_SERVER
         char pcNewDir[ ffconfigMAX_FILENAME ];
     #endif
     #if ( ipconfigUSE_HTTP != 0 )
-        char pcContentsType[ 40 ];  /* Space for the msg: "text/javascript" */
-        char pcExtraContents[ 40 ]; /* Space for the msg: "Content-Length: 346500" */
+        char pcContentsType[ 40 ];   /* Space for the msg: "text/javascript" */
+        char pcExtraContents[ 128 ]; /* Space for the Content-Length, ETag and Last-Modified lines. */
+        /* Small files kept in RAM, see ipconfigHTTP_CACHE_ENTRIES. */
+        struct xHTTP_CACHE_ENTRY * pxHTTPCache;
     #endif
     BaseType_t xServerCount;
     TCPClient_t * pxClients;
+    #if ( ipconfigTCP_SERVER_WORKER_COUNT > 0 )
+        /* Used by a worker: clients handed over by the listening task, and a
+         * socket which is signalled to interrupt select(). */
+        QueueHandle_t xNewClients;
+        Socket_t xSignalSocket;
+        /* Written by the listening task and by the worker respectively.  The
+         * difference is the number of clients that the worker serves. */
+        UBaseType_t uxClientsAssigned;
+        UBaseType_t uxClientsReleased;
+        /* Used by the listening task. */
+        BaseType_t xWorkerCount;
+        struct xTCP_SERVER * pxWorkers[ ipconfigTCP_SERVER_WORKER_COUNT ];
+    #endif
     struct xSERVER
     {
         enum eSERVER_TYPE eType; /* eSERVER_HTTP | eSERVER_FTP */
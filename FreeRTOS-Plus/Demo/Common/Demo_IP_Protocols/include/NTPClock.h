@@ -0,0 +1,99 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ * NTPClock.h
+ *
+ * A wall clock that is disciplined by the samples of NTPDemo.c.  The time is
+ * derived from a free running counter, corrected for the frequency error that
+ * is estimated from successive samples.  Small offsets are slewed away, so the
+ * time does not jump; only an offset above ipconfigNTP_STEP_THRESHOLD_MS steps
+ * the clock.
+ *
+ * The counter is read through ipconfigNTP_CLOCK_COUNTER(), which counts at
+ * ipconfigNTP_CLOCK_COUNTER_HZ.  By default this is the tick count, so the
+ * resolution is one tick.  A faster counter gives sub-millisecond time stamps,
+ * e.g. on the POSIX port, whose run time counter counts nanoseconds of
+ * CLOCK_MONOTONIC:
+ *
+ *     #define ipconfigNTP_CLOCK_COUNTER()       ( ( uint64_t ) ulGetRunTimeCounterValue() )
+ *     #define ipconfigNTP_CLOCK_COUNTER_HZ      ( 1000000000ULL )
+ */
+
+#ifndef NTPCLOCK_H
+
+#define NTPCLOCK_H
+
+/* Nanoseconds per second. */
+#define ntpclockNS_PER_SEC    1000000000LL
+
+typedef struct xNTP_CLOCK_STATUS
+{
+    int64_t llOffsetNs;       /* Offset of the last sample that was used: server minus local time. */
+    int64_t llDelayNs;        /* Round trip delay of that sample. */
+    int32_t lFrequencyPPB;    /* Correction applied to the rate of the counter, in parts per billion. */
+    uint32_t ulPollSeconds;   /* Current interval between two requests. */
+    uint32_t ulSteps;         /* Number of times that the clock was stepped. */
+    BaseType_t xSynchronised; /* pdTRUE once the clock has been set. */
+} NTPClockStatus_t;
+
+/*
+ * Return the time in nanoseconds since 1-1-1970.  This is cheap and does not
+ * block: it reads the counter and scales it, using a copy of the clock state
+ * that is taken without a lock.  It may be called from an ISR if
+ * ipconfigNTP_CLOCK_COUNTER() may be.
+ */
+int64_t llNTPClockGetTimeNs( void );
+
+/*
+ * The same time, split in seconds since 1-1-1970 and nanoseconds.
+ */
+time_t xNTPClockGetTime( uint32_t * pulNanoSeconds );
+
+/*
+ * Feed one NTP exchange to the clock, all times in nanoseconds since 1-1-1970:
+ * llT1: local time at which the request was sent.
+ * llT2: server time at which the request was received.
+ * llT3: server time at which the reply was sent.
+ * llT4: local time at which the reply was received.
+ * Returns pdTRUE if the sample was used to correct the clock.  Samples must be
+ * passed by one task only.
+ */
+BaseType_t xNTPClockAddSample( int64_t llT1,
+                               int64_t llT2,
+                               int64_t llT3,
+                               int64_t llT4 );
+
+/*
+ * Return the number of ticks to wait before the next request.  The interval
+ * grows while the clock stays close to the server, up to
+ * ipconfigNTP_MAX_POLL_SECONDS.
+ */
+TickType_t xNTPClockPollInterval( void );
+
+void vNTPClockGetStatus( NTPClockStatus_t * pxStatus );
+
+#endif /* NTPCLOCK_H */
@@ -67,6 +67,13 @@
  * The task that implements the command console processing.
  */
 static void prvUARTCommandConsoleTask( void * pvParameters );
+
+/*
+ * Write the output of a command to the UART.
+ */
+static BaseType_t prvOutputToUART( void * pvOutputContext,
+                                   const char * pcData,
+                                   size_t xDataLength );
 void vUARTCommandConsoleStart( uint16_t usStackSize,
                                UBaseType_t uxPriority );
 void vOutputString( const char * const pcMessage );
@@ -85,6 +92,10 @@ static SemaphoreHandle_t xTxMutex = NULL;
 /* The handle to the UART port, which is not used by all ports. */
 static xComPortHandle xPort = 0;
 
+/* The command interpreter state of this console, so that other consoles can
+ * process commands at the same time. */
+static CLI_Session_t xSession;
+
 /*-----------------------------------------------------------*/
 
 void vUARTCommandConsoleStart( uint16_t usStackSize,
@@ -110,14 +121,15 @@ static void prvUARTCommandConsoleTask( void * pvParameters )
     uint8_t ucInputIndex = 0;
     char * pcOutputString;
     static char cInputString[ cmdMAX_INPUT_SIZE ], cLastInputString[ cmdMAX_INPUT_SIZE ];
-    BaseType_t xReturned;
 
     ( void ) pvParameters;
 
     /* Obtain the address of the output buffer.  Note there is no mutual
-     * exclusion on this buffer as it is assumed only one command console interface
-     * will be used at any one time. */
+     * exclusion on this buffer as it is assumed that this is the only command
+     * console that uses it.  Consoles that run at the same time each need a
+     * buffer of their own. */
     pcOutputString = FreeRTOS_CLIGetOutputBuffer();
+    FreeRTOS_CLISessionInit( &xSession, prvOutputToUART, NULL, pcOutputString, configCOMMAND_INT_MAX_OUTPUT_SIZE );
 
     /* Initialise the UART. */
     xPort = xSerialPortInitMinimal( configCLI_BAUD_RATE, cmdQUEUE_LENGTH );
@@ -154,18 +166,10 @@ static void prvUARTCommandConsoleTask( void * pvParameters )
                     strcpy( cInputString, cLastInputString );
                 }
 
-                /* Pass the received command to the command interpreter.  The
-                 * command interpreter is called repeatedly until it returns
-                 * pdFALSE	(indicating there is no more output) as it might
-                 * generate more than one string. */
-                do
-                {
-                    /* Get the next output string from the command interpreter. */
-                    xReturned = FreeRTOS_CLIProcessCommand( cInputString, pcOutputString, configCOMMAND_INT_MAX_OUTPUT_SIZE );
-
-                    /* Write the generated string to the UART. */
-                    vSerialPutString( xPort, ( signed char * ) pcOutputString, ( unsigned short ) strlen( pcOutputString ) );
-                } while( xReturned != pdFALSE );
+                /* Pass the received command to the command interpreter.  All
+                 * the strings that the command generates are written to the
+                 * UART by prvOutputToUART(). */
+                ( void ) FreeRTOS_CLIExecuteCommand( &xSession, cInputString );
 
                 /* All the strings generated by the input command have been
                  * sent.  Clear the input string ready to receive the next command.
@@ -216,6 +220,19 @@ static void prvUARTCommandConsoleTask( void * pvParameters )
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvOutputToUART( void * pvOutputContext,
+                                   const char * pcData,
+                                   size_t xDataLength )
+{
+    ( void ) pvOutputContext;
+
+    /* Called from the console task, which already holds xTxMutex. */
+    vSerialPutString( xPort, ( signed char * ) pcData, ( unsigned short ) xDataLength );
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
 void vOutputString( const char * const pcMessage )
 {
     if( xSemaphoreTake( xTxMutex, cmdMAX_MUTEX_WAIT ) == pdPASS )
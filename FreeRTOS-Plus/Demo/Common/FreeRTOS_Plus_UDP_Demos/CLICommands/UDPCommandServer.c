@@ -85,6 +85,7 @@ void vUDPCommandInterpreterTask( void * pvParameters )
     struct freertos_sockaddr xClient;
     socklen_t xClientAddressLength = 0; /* This is required as a parameter to maintain the sendto() Berkeley sockets API - but it is not actually used so can take any value. */
     xSocket_t xSocket;
+    CLI_Session_t xSession;
 
     /* Just to prevent compiler warnings. */
     ( void ) pvParameters;
@@ -94,6 +95,10 @@ void vUDPCommandInterpreterTask( void * pvParameters )
      * machines. */
     xSocket = prvOpenUDPServerSocket( ( uint16_t ) ( ( uint32_t ) pvParameters ) & 0xffffUL );
 
+    /* This console keeps its own command interpreter state and output buffer,
+     * so it can be used while another console is processing a command. */
+    FreeRTOS_CLISessionInit( &xSession, NULL, NULL, NULL, 0 );
+
     if( xSocket != FREERTOS_INVALID_SOCKET )
     {
         for( ; ; )
@@ -121,7 +126,7 @@ void vUDPCommandInterpreterTask( void * pvParameters )
                         do
                         {
                             /* Pass the string to FreeRTOS+CLI. */
-                            xMoreDataToFollow = FreeRTOS_CLIProcessCommand( cInputString, cOutputString, cmdMAX_OUTPUT_SIZE );
+                            xMoreDataToFollow = FreeRTOS_CLIProcessCommandSession( &xSession, cInputString, cOutputString, cmdMAX_OUTPUT_SIZE );
 
                             /* Send the output generated by the command's
                              * implementation. */
@@ -0,0 +1,1273 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+/*
+ * A logging backend for the LogError(), LogInfo() etc. macros that keeps the
+ * formatting out of the tasks that log, see logging_binary.h.
+ *
+ * A message is captured as the address of the constant record of its call
+ * site, a time stamp, the task name and the raw values of its arguments.  The
+ * types of the arguments are found by parsing the format string; strings are
+ * copied, as they may not live until the message is formatted.  The message is
+ * written to a ring buffer of the core that logs it.  Space is reserved with a
+ * compare-and-swap on the head of the ring buffer, and the length of the entry
+ * is written last, which marks it complete.  Tasks and interrupts may therefore
+ * log at the same time, and nobody waits for a lock or for the output.  When the
+ * ring buffer is full, the message is dropped and counted.
+ *
+ * A low priority task empties the ring buffers, in the order of the time
+ * stamps, and either formats the messages itself or passes them in binary
+ * frames to the output, to be formatted on the host by decode_binary_log.py.
+ * The binary stream is a series of frames: a one byte type, a two byte little
+ * endian length and the payload:
+ *
+ * 'H' "FRLB", version, 1 if little endian, then the sizes of int, long,
+ *     long long, size_t, intmax_t, ptrdiff_t, void * and double.
+ * 'D' Message ID (the address of the record), level, line (little endian),
+ *     then the format, library and function names, each terminated by a 0.
+ * 'M' Message ID, time stamp (uint32_t), task name terminated by a 0, then the
+ *     argument values.
+ * 'X' The number of messages that were dropped since the last 'X' (uint32_t).
+ *
+ * Integers in 'M' and 'X' frames have the byte order of the target.  A 'D'
+ * frame is sent before the first message with a new ID.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "atomic.h"
+
+/* Demo includes. */
+#include "logging_levels.h"
+#include "logging_binary.h"
+
+/*-----------------------------------------------------------*/
+
+/* The size of the ring buffer of each core, in bytes.  Must be a power of
+ * two. */
+#ifndef logbinBUFFER_SIZE
+    #define logbinBUFFER_SIZE        4096U
+#endif
+
+/* The maximum number of bytes of argument values in one message.  Arguments
+ * that do not fit are left out, and the rest of the format string is printed
+ * as it is. */
+#ifndef logbinMAX_ARGUMENT_SIZE
+    #define logbinMAX_ARGUMENT_SIZE    128U
+#endif
+
+/* Strings that are passed as arguments are cut to this length. */
+#ifndef logbinMAX_STRING_LENGTH
+    #define logbinMAX_STRING_LENGTH    48U
+#endif
+
+/* The number of characters of the task name that are kept. */
+#ifndef logbinTASK_NAME_LENGTH
+    #define logbinTASK_NAME_LENGTH     8U
+#endif
+
+/* The time between two runs of the task that empties the ring buffers. */
+#ifndef logbinDRAIN_PERIOD_MS
+    #define logbinDRAIN_PERIOD_MS      20U
+#endif
+
+/* The number of message IDs of which the definition is remembered as sent to
+ * the host.  Must be a power of two.  When 3/4 of it is used, all definitions
+ * are sent again. */
+#ifndef logbinDICTIONARY_SIZE
+    #define logbinDICTIONARY_SIZE      128U
+#endif
+
+/* The maximum length of a line that is formatted on the target. */
+#ifndef logbinMAX_LINE_LENGTH
+    #define logbinMAX_LINE_LENGTH      256U
+#endif
+
+/* The time stamp of a message.  It is read from tasks and from interrupts. */
+#ifndef logbinTIMESTAMP
+    #define logbinTIMESTAMP()    ( ( uint32_t ) xTaskGetTickCountFromISR() )
+#endif
+
+#ifndef configNUMBER_OF_CORES
+    #define configNUMBER_OF_CORES    1
+#endif
+
+#if ( configNUMBER_OF_CORES > 1 )
+    #define logbinCORE_ID()    ( ( UBaseType_t ) portGET_CORE_ID() )
+#else
+    #define logbinCORE_ID()    ( ( UBaseType_t ) 0U )
+#endif
+
+#if ( ( logbinBUFFER_SIZE & ( logbinBUFFER_SIZE - 1U ) ) != 0U ) || ( ( logbinDICTIONARY_SIZE & ( logbinDICTIONARY_SIZE - 1U ) ) != 0U )
+    #error "logbinBUFFER_SIZE and logbinDICTIONARY_SIZE must be powers of two."
+#endif
+
+/* Frame types of the binary output. */
+#define logbinFRAME_HEADER        ( ( uint8_t ) 'H' )
+#define logbinFRAME_DEFINITION    ( ( uint8_t ) 'D' )
+#define logbinFRAME_MESSAGE       ( ( uint8_t ) 'M' )
+#define logbinFRAME_DROPPED       ( ( uint8_t ) 'X' )
+
+/* Type and length in front of every frame. */
+#define logbinFRAME_HEADER_SIZE    3U
+
+#define logbinFORMAT_VERSION       1U
+
+/* Entries in the ring buffer are a multiple of 4 bytes long, so the length
+ * word of an entry is always aligned and never wraps. */
+#define logbinROUND_UP( x )    ( ( ( x ) + 3U ) & ~( ( uint32_t ) 3U ) )
+
+/* The length word of the entry at ulOffset. */
+#define logbinENTRY_LENGTH( pxRing, ulOffset ) \
+    ( *( ( volatile uint32_t * ) &( ( pxRing )->ulBuffer[ ( ( ulOffset ) & ( logbinBUFFER_SIZE - 1U ) ) / sizeof( uint32_t ) ] ) ) )
+
+/*-----------------------------------------------------------*/
+
+/* How an argument is passed and stored. */
+typedef enum
+{
+    eArgNone,       /* "%%", or a conversion that is not known. */
+    eArgInt,        /* Also char and short, which are promoted to int. */
+    eArgLong,
+    eArgLongLong,
+    eArgSize,
+    eArgIntMax,
+    eArgPtrDiff,
+    eArgDouble,
+    eArgLongDouble, /* Stored as a double. */
+    eArgPointer,
+    eArgString,     /* Stored as a length byte followed by the characters. */
+    eArgCount       /* "%n": the pointer is taken, nothing is stored. */
+} LogBinaryArgument_t;
+
+/* One conversion specification of a format string. */
+typedef struct LogBinarySpec
+{
+    const char * pcEnd;        /* One past the conversion character. */
+    UBaseType_t uxStars;       /* The number of '*' widths and precisions, each an int argument. */
+    LogBinaryArgument_t eArgument;
+    char cConversion;
+} LogBinarySpec_t;
+
+/* Reads the argument values of a message one by one. */
+typedef struct LogBinaryReader
+{
+    const uint8_t * pucData;
+    size_t xLength;
+    size_t xRead;
+} LogBinaryReader_t;
+
+/* A message as it is stored in a ring buffer.  The argument values follow. */
+typedef struct LogBinaryEntry
+{
+    uint32_t ulLength; /* Length of the entry, a multiple of 4.  Written last: 0 means the entry is not complete yet. */
+    uint32_t ulTimeStamp;
+    const LogBinaryRecord_t * pxRecord;
+    char cTaskName[ logbinTASK_NAME_LENGTH ]; /* Not terminated if the name is logbinTASK_NAME_LENGTH long. */
+    uint16_t usArgumentLength;
+} LogBinaryEntry_t;
+
+/* The ring buffer of one core.  Any task or interrupt may write, whichever
+ * core it runs on; only the drain reads. */
+typedef struct LogBinaryRing
+{
+    volatile uint32_t ulHead;    /* Bytes reserved by writers, free running. */
+    volatile uint32_t ulTail;    /* Bytes released by the drain, free running. */
+    volatile uint32_t ulDropped; /* Messages that did not fit. */
+    uint32_t ulBuffer[ logbinBUFFER_SIZE / sizeof( uint32_t ) ];
+} LogBinaryRing_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Parse the conversion specification that starts at the '%' pcPercent.
+ * Returns pdFALSE if the format string ends within it.
+ */
+static BaseType_t prvParseSpec( const char * pcPercent,
+                                LogBinarySpec_t * pxSpec );
+
+/*
+ * Store the values of the arguments of pcFormat in pucBuffer.  Returns the
+ * number of bytes used.
+ */
+static size_t prvEncodeArguments( const char * pcFormat,
+                                  va_list xArgs,
+                                  uint8_t * pucBuffer,
+                                  size_t xBufferSize );
+
+/*
+ * Format the message pcFormat with the argument values that were stored by
+ * prvEncodeArguments().  Returns the number of characters written to
+ * pcBuffer, which is always terminated.
+ */
+static size_t prvFormatMessage( const char * pcFormat,
+                                const uint8_t * pucArguments,
+                                size_t xArgumentLength,
+                                char * pcBuffer,
+                                size_t xBufferSize );
+
+/*
+ * Copy into or out of a ring buffer, from the free running offset ulOffset,
+ * wrapping at the end.
+ */
+static void prvRingWrite( LogBinaryRing_t * pxRing,
+                          uint32_t ulOffset,
+                          const void * pvSource,
+                          size_t xLength );
+static void prvRingRead( const LogBinaryRing_t * pxRing,
+                         uint32_t ulOffset,
+                         void * pvTarget,
+                         size_t xLength );
+
+/*
+ * Clear ulLength bytes of a ring buffer, a multiple of 4, from ulOffset.
+ */
+static void prvRingClear( LogBinaryRing_t * pxRing,
+                          uint32_t ulOffset,
+                          uint32_t ulLength );
+
+/*
+ * Read the oldest complete entry of a ring buffer, without its argument
+ * values.  Returns pdFALSE if there is none.
+ */
+static BaseType_t prvRingPeek( const LogBinaryRing_t * pxRing,
+                               LogBinaryEntry_t * pxEntry );
+
+/*
+ * Pass one message to the output, formatted or as binary frames.
+ */
+static void prvOutputText( const LogBinaryEntry_t * pxEntry,
+                           const uint8_t * pucArguments );
+static void prvOutputBinary( const LogBinaryEntry_t * pxEntry,
+                             const uint8_t * pucArguments );
+
+/*
+ * Report the messages that were dropped since the last call.
+ */
+static void prvOutputDropped( void );
+
+/*
+ * The task that empties the ring buffers.
+ */
+static void prvDrainTask( void * pvParameters );
+
+/*-----------------------------------------------------------*/
+
+static LogBinaryRing_t xRings[ configNUMBER_OF_CORES ];
+
+/* The parameters of xLoggingBinaryInit(). */
+static LoggingBinaryOutput_t pxOutputFunction = NULL;
+static BaseType_t xFormatLines = pdTRUE;
+
+/* The state of the output, only used by the drain. */
+static uint32_t ulMessageNumber = 0U;
+static uint32_t ulDroppedReported = 0U;
+static BaseType_t xHeaderSent = pdFALSE;
+static const LogBinaryRecord_t * pxDefinitionsSent[ logbinDICTIONARY_SIZE ];
+static UBaseType_t uxDefinitionCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseSpec( const char * pcPercent,
+                                LogBinarySpec_t * pxSpec )
+{
+    const char * pcChar = pcPercent + 1;
+    char cLength = '\0';
+    BaseType_t xReturn = pdTRUE;
+
+    pxSpec->uxStars = 0U;
+
+    /* Flags. */
+    while( ( *pcChar != '\0' ) && ( strchr( "-+ #0'", *pcChar ) != NULL ) )
+    {
+        pcChar++;
+    }
+
+    /* Width and precision. */
+    if( *pcChar == '*' )
+    {
+        pxSpec->uxStars++;
+        pcChar++;
+    }
+
+    while( ( *pcChar >= '0' ) && ( *pcChar <= '9' ) )
+    {
+        pcChar++;
+    }
+
+    if( *pcChar == '.' )
+    {
+        pcChar++;
+
+        if( *pcChar == '*' )
+        {
+            pxSpec->uxStars++;
+            pcChar++;
+        }
+
+        while( ( *pcChar >= '0' ) && ( *pcChar <= '9' ) )
+        {
+            pcChar++;
+        }
+    }
+
+    /* Length modifier, "ll" and "q" become 'q', "hh" becomes 'h'. */
+    switch( *pcChar )
+    {
+        case 'h':
+        case 'l':
+            cLength = *pcChar;
+            pcChar++;
+
+            if( *pcChar == cLength )
+            {
+                cLength = ( cLength == 'l' ) ? 'q' : 'h';
+                pcChar++;
+            }
+
+            break;
+
+        case 'q':
+        case 'z':
+        case 'j':
+        case 't':
+        case 'L':
+            cLength = *pcChar;
+            pcChar++;
+            break;
+
+        default:
+            break;
+    }
+
+    pxSpec->cConversion = *pcChar;
+
+    switch( *pcChar )
+    {
+        case '\0':
+            xReturn = pdFALSE;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+
+            switch( cLength )
+            {
+                case 'l':
+                    pxSpec->eArgument = eArgLong;
+                    break;
+
+                case 'q':
+                    pxSpec->eArgument = eArgLongLong;
+                    break;
+
+                case 'z':
+                    pxSpec->eArgument = eArgSize;
+                    break;
+
+                case 'j':
+                    pxSpec->eArgument = eArgIntMax;
+                    break;
+
+                case 't':
+                    pxSpec->eArgument = eArgPtrDiff;
+                    break;
+
+                default:
+                    pxSpec->eArgument = eArgInt;
+                    break;
+            }
+
+            break;
+
+        case 'c':
+            pxSpec->eArgument = eArgInt;
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            pxSpec->eArgument = ( cLength == 'L' ) ? eArgLongDouble : eArgDouble;
+            break;
+
+        case 's':
+            pxSpec->eArgument = eArgString;
+            break;
+
+        case 'p':
+            pxSpec->eArgument = eArgPointer;
+            break;
+
+        case 'n':
+            pxSpec->eArgument = eArgCount;
+            break;
+
+        default:
+            pxSpec->eArgument = eArgNone;
+            pxSpec->uxStars = 0U;
+            break;
+    }
+
+    pxSpec->pcEnd = pcChar + 1;
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvEncodeArguments( const char * pcFormat,
+                                  va_list xArgs,
+                                  uint8_t * pucBuffer,
+                                  size_t xBufferSize )
+{
+    const char * pcChar = pcFormat;
+    const char * pcString;
+    LogBinarySpec_t xSpec;
+    size_t xUsed = 0U, xSize = 0U;
+    UBaseType_t uxStar;
+    BaseType_t xFull = pdFALSE;
+
+    union
+    {
+        int iValue;
+        long lValue;
+        long long llValue;
+        size_t xValue;
+        intmax_t xMaxValue;
+        ptrdiff_t xDifference;
+        double dValue;
+        void * pvValue;
+    }
+    xValue;
+
+    while( ( *pcChar != '\0' ) && ( xFull == pdFALSE ) )
+    {
+        if( *pcChar != '%' )
+        {
+            pcChar++;
+        }
+        else if( prvParseSpec( pcChar, &xSpec ) == pdFALSE )
+        {
+            break;
+        }
+        else
+        {
+            for( uxStar = 0U; ( uxStar < xSpec.uxStars ) && ( xFull == pdFALSE ); uxStar++ )
+            {
+                xValue.iValue = va_arg( xArgs, int );
+
+                if( ( xUsed + sizeof( int ) ) <= xBufferSize )
+                {
+                    memcpy( &( pucBuffer[ xUsed ] ), &( xValue.iValue ), sizeof( int ) );
+                    xUsed += sizeof( int );
+                }
+                else
+                {
+                    xFull = pdTRUE;
+                }
+            }
+
+            switch( xSpec.eArgument )
+            {
+                case eArgInt:
+                    xValue.iValue = va_arg( xArgs, int );
+                    xSize = sizeof( int );
+                    break;
+
+                case eArgLong:
+                    xValue.lValue = va_arg( xArgs, long );
+                    xSize = sizeof( long );
+                    break;
+
+                case eArgLongLong:
+                    xValue.llValue = va_arg( xArgs, long long );
+                    xSize = sizeof( long long );
+                    break;
+
+                case eArgSize:
+                    xValue.xValue = va_arg( xArgs, size_t );
+                    xSize = sizeof( size_t );
+                    break;
+
+                case eArgIntMax:
+                    xValue.xMaxValue = va_arg( xArgs, intmax_t );
+                    xSize = sizeof( intmax_t );
+                    break;
+
+                case eArgPtrDiff:
+                    xValue.xDifference = va_arg( xArgs, ptrdiff_t );
+                    xSize = sizeof( ptrdiff_t );
+                    break;
+
+                case eArgDouble:
+                    xValue.dValue = va_arg( xArgs, double );
+                    xSize = sizeof( double );
+                    break;
+
+                case eArgLongDouble:
+                    xValue.dValue = ( double ) va_arg( xArgs, long double );
+                    xSize = sizeof( double );
+                    break;
+
+                case eArgPointer:
+                    xValue.pvValue = va_arg( xArgs, void * );
+                    xSize = sizeof( void * );
+                    break;
+
+                case eArgString:
+                    pcString = va_arg( xArgs, const char * );
+
+                    if( pcString == NULL )
+                    {
+                        pcString = "(null)";
+                    }
+
+                    for( xSize = 0U; ( xSize < logbinMAX_STRING_LENGTH ) && ( pcString[ xSize ] != '\0' ); xSize++ )
+                    {
+                    }
+
+                    /* Shorten the string rather than leave it out. */
+                    if( ( xUsed + 1U + xSize ) > xBufferSize )
+                    {
+                        xSize = ( ( xUsed + 1U ) < xBufferSize ) ? ( xBufferSize - xUsed - 1U ) : 0U;
+                    }
+
+                    if( ( xFull == pdFALSE ) && ( ( xUsed + 1U ) < xBufferSize ) )
+                    {
+                        pucBuffer[ xUsed ] = ( uint8_t ) xSize;
+                        memcpy( &( pucBuffer[ xUsed + 1U ] ), pcString, xSize );
+                        xUsed += 1U + xSize;
+                    }
+                    else
+                    {
+                        xFull = pdTRUE;
+                    }
+
+                    xSize = 0U;
+                    break;
+
+                case eArgCount:
+                    ( void ) va_arg( xArgs, void * );
+                    xSize = 0U;
+                    break;
+
+                default:
+                    xSize = 0U;
+                    break;
+            }
+
+            if( xSize != 0U )
+            {
+                if( ( xFull == pdFALSE ) && ( ( xUsed + xSize ) <= xBufferSize ) )
+                {
+                    memcpy( &( pucBuffer[ xUsed ] ), &xValue, xSize );
+                    xUsed += xSize;
+                }
+                else
+                {
+                    xFull = pdTRUE;
+                }
+            }
+
+            pcChar = xSpec.pcEnd;
+        }
+    }
+
+    return xUsed;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadArgument( LogBinaryReader_t * pxReader,
+                                   void * pvValue,
+                                   size_t xSize )
+{
+    BaseType_t xReturn = pdFALSE;
+
+    if( ( pxReader->xRead + xSize ) <= pxReader->xLength )
+    {
+        memcpy( pvValue, &( pxReader->pucData[ pxReader->xRead ] ), xSize );
+        pxReader->xRead += xSize;
+        xReturn = pdTRUE;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Format one conversion, starting at pcPercent, with the next argument values
+ * of pxReader.  Returns what snprintf() returns, or -1 if the values are
+ * missing.
+ */
+static int prvFormatConversion( const char * pcPercent,
+                                const LogBinarySpec_t * pxSpec,
+                                LogBinaryReader_t * pxReader,
+                                char * pcBuffer,
+                                size_t xBufferSize )
+{
+    char cSpec[ 32 ];
+    char cString[ logbinMAX_STRING_LENGTH + 1U ];
+    size_t xSpecLength = 0U;
+    const char * pcChar;
+    uint8_t ucStringLength;
+    int iStar, iReturn = 0;
+
+    union
+    {
+        int iValue;
+        long lValue;
+        long long llValue;
+        size_t xValue;
+        intmax_t xMaxValue;
+        ptrdiff_t xDifference;
+        double dValue;
+        void * pvValue;
+    }
+    xValue;
+
+    /* Copy the specification, with the values of '*' filled in and without
+     * 'L', as long doubles were stored as doubles. */
+    for( pcChar = pcPercent; ( pcChar < pxSpec->pcEnd ) && ( iReturn >= 0 ); pcChar++ )
+    {
+        if( ( xSpecLength + 12U ) > sizeof( cSpec ) )
+        {
+            iReturn = -1;
+        }
+        else if( ( *pcChar == '*' ) && ( pxSpec->uxStars != 0U ) )
+        {
+            if( prvReadArgument( pxReader, &iStar, sizeof( iStar ) ) == pdFALSE )
+            {
+                iReturn = -1;
+            }
+            else if( ( iStar < 0 ) && ( pcChar[ -1 ] == '.' ) )
+            {
+                /* A negative precision is taken as if it were omitted. */
+                xSpecLength--;
+            }
+            else
+            {
+                xSpecLength += ( size_t ) snprintf( &( cSpec[ xSpecLength ] ), sizeof( cSpec ) - xSpecLength, "%d", iStar );
+            }
+        }
+        else if( *pcChar != 'L' )
+        {
+            cSpec[ xSpecLength ] = *pcChar;
+            xSpecLength++;
+        }
+        else
+        {
+            /* Drop the 'L'. */
+        }
+    }
+
+    if( iReturn >= 0 )
+    {
+        cSpec[ xSpecLength ] = '\0';
+
+        switch( pxSpec->eArgument )
+        {
+            case eArgInt:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( int ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.iValue ) : -1;
+                break;
+
+            case eArgLong:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( long ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.lValue ) : -1;
+                break;
+
+            case eArgLongLong:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( long long ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.llValue ) : -1;
+                break;
+
+            case eArgSize:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( size_t ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.xValue ) : -1;
+                break;
+
+            case eArgIntMax:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( intmax_t ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.xMaxValue ) : -1;
+                break;
+
+            case eArgPtrDiff:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( ptrdiff_t ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.xDifference ) : -1;
+                break;
+
+            case eArgDouble:
+            case eArgLongDouble:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( double ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.dValue ) : -1;
+                break;
+
+            case eArgPointer:
+                iReturn = ( prvReadArgument( pxReader, &xValue, sizeof( void * ) ) == pdTRUE ) ? snprintf( pcBuffer, xBufferSize, cSpec, xValue.pvValue ) : -1;
+                break;
+
+            case eArgString:
+
+                if( ( prvReadArgument( pxReader, &ucStringLength, sizeof( ucStringLength ) ) == pdTRUE ) &&
+                    ( ucStringLength <= logbinMAX_STRING_LENGTH ) &&
+                    ( prvReadArgument( pxReader, cString, ucStringLength ) == pdTRUE ) )
+                {
+                    cString[ ucStringLength ] = '\0';
+                    iReturn = snprintf( pcBuffer, xBufferSize, cSpec, cString );
+                }
+                else
+                {
+                    iReturn = -1;
+                }
+
+                break;
+
+            case eArgCount:
+                iReturn = 0;
+                break;
+
+            default:
+
+                /* "%%" prints a '%', anything else is printed as it is. */
+                iReturn = ( pxSpec->cConversion == '%' ) ? snprintf( pcBuffer, xBufferSize, "%%" ) :
+                          snprintf( pcBuffer, xBufferSize, "%.*s", ( int ) ( pxSpec->pcEnd - pcPercent ), pcPercent );
+                break;
+        }
+    }
+
+    return iReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvFormatMessage( const char * pcFormat,
+                                const uint8_t * pucArguments,
+                                size_t xArgumentLength,
+                                char * pcBuffer,
+                                size_t xBufferSize )
+{
+    const char * pcChar = pcFormat;
+    const char * pcPercent;
+    LogBinaryReader_t xReader;
+    LogBinarySpec_t xSpec;
+    size_t xUsed = 0U;
+    int iReturned = 0;
+
+    xReader.pucData = pucArguments;
+    xReader.xLength = xArgumentLength;
+    xReader.xRead = 0U;
+
+    pcBuffer[ 0 ] = '\0';
+
+    while( ( *pcChar != '\0' ) && ( iReturned >= 0 ) )
+    {
+        if( *pcChar != '%' )
+        {
+            pcPercent = strchr( pcChar, '%' );
+
+            if( pcPercent == NULL )
+            {
+                pcPercent = pcChar + strlen( pcChar );
+            }
+
+            iReturned = snprintf( &( pcBuffer[ xUsed ] ), xBufferSize - xUsed, "%.*s", ( int ) ( pcPercent - pcChar ), pcChar );
+            pcChar = pcPercent;
+        }
+        else if( prvParseSpec( pcChar, &xSpec ) == pdFALSE )
+        {
+            iReturned = -1;
+        }
+        else
+        {
+            iReturned = prvFormatConversion( pcChar, &xSpec, &xReader, &( pcBuffer[ xUsed ] ), xBufferSize - xUsed );
+
+            if( iReturned >= 0 )
+            {
+                pcChar = xSpec.pcEnd;
+            }
+        }
+
+        if( iReturned > 0 )
+        {
+            xUsed += ( size_t ) iReturned;
+
+            if( xUsed >= xBufferSize )
+            {
+                xUsed = xBufferSize - 1U;
+            }
+        }
+    }
+
+    if( iReturned < 0 )
+    {
+        /* The argument values were cut, print the rest of the format. */
+        ( void ) snprintf( &( pcBuffer[ xUsed ] ), xBufferSize - xUsed, "%s", pcChar );
+        xUsed += strlen( &( pcBuffer[ xUsed ] ) );
+    }
+
+    return xUsed;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRingWrite( LogBinaryRing_t * pxRing,
+                          uint32_t ulOffset,
+                          const void * pvSource,
+                          size_t xLength )
+{
+    uint8_t * pucBuffer = ( uint8_t * ) pxRing->ulBuffer;
+    uint32_t ulStart = ulOffset & ( logbinBUFFER_SIZE - 1U );
+    size_t xFirst = logbinBUFFER_SIZE - ulStart;
+
+    if( xFirst > xLength )
+    {
+        xFirst = xLength;
+    }
+
+    memcpy( &( pucBuffer[ ulStart ] ), pvSource, xFirst );
+    memcpy( pucBuffer, &( ( ( const uint8_t * ) pvSource )[ xFirst ] ), xLength - xFirst );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRingRead( const LogBinaryRing_t * pxRing,
+                         uint32_t ulOffset,
+                         void * pvTarget,
+                         size_t xLength )
+{
+    const uint8_t * pucBuffer = ( const uint8_t * ) pxRing->ulBuffer;
+    uint32_t ulStart = ulOffset & ( logbinBUFFER_SIZE - 1U );
+    size_t xFirst = logbinBUFFER_SIZE - ulStart;
+
+    if( xFirst > xLength )
+    {
+        xFirst = xLength;
+    }
+
+    memcpy( pvTarget, &( pucBuffer[ ulStart ] ), xFirst );
+    memcpy( &( ( ( uint8_t * ) pvTarget )[ xFirst ] ), pucBuffer, xLength - xFirst );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRingClear( LogBinaryRing_t * pxRing,
+                          uint32_t ulOffset,
+                          uint32_t ulLength )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0U; ulIndex < ulLength; ulIndex += sizeof( uint32_t ) )
+    {
+        pxRing->ulBuffer[ ( ( ulOffset + ulIndex ) & ( logbinBUFFER_SIZE - 1U ) ) / sizeof( uint32_t ) ] = 0U;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRingPeek( const LogBinaryRing_t * pxRing,
+                               LogBinaryEntry_t * pxEntry )
+{
+    uint32_t ulTail = pxRing->ulTail;
+    BaseType_t xReturn = pdFALSE;
+
+    if( logbinENTRY_LENGTH( pxRing, ulTail ) != 0U )
+    {
+        /* The length is written after the rest of the entry. */
+        portMEMORY_BARRIER();
+        prvRingRead( pxRing, ulTail, pxEntry, sizeof( *pxEntry ) );
+        xReturn = pdTRUE;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vLoggingBinaryCapture( const LogBinaryRecord_t * pxRecord,
+                            const char * pcFormat,
+                            ... )
+{
+    LogBinaryEntry_t xEntry;
+    uint8_t ucArguments[ logbinMAX_ARGUMENT_SIZE ];
+    LogBinaryRing_t * pxRing;
+    const char * pcTaskName = "None";
+    uint32_t ulHead, ulTail, ulLength;
+    size_t xIndex;
+    BaseType_t xReserved;
+    va_list xArgs;
+
+    va_start( xArgs, pcFormat );
+    xEntry.usArgumentLength = ( uint16_t ) prvEncodeArguments( pcFormat, xArgs, ucArguments, sizeof( ucArguments ) );
+    va_end( xArgs );
+
+    xEntry.ulTimeStamp = logbinTIMESTAMP();
+    xEntry.pxRecord = pxRecord;
+
+    if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+    {
+        pcTaskName = pcTaskGetName( NULL );
+    }
+
+    for( xIndex = 0U; xIndex < sizeof( xEntry.cTaskName ); xIndex++ )
+    {
+        xEntry.cTaskName[ xIndex ] = *pcTaskName;
+
+        if( *pcTaskName != '\0' )
+        {
+            pcTaskName++;
+        }
+    }
+
+    ulLength = logbinROUND_UP( ( uint32_t ) ( sizeof( xEntry ) + xEntry.usArgumentLength ) );
+    xEntry.ulLength = ulLength;
+
+    /* The task may move to another core after reading the core ID: the ring
+     * buffers accept writers from any core, it only costs some contention. */
+    pxRing = &( xRings[ logbinCORE_ID() ] );
+
+    for( ; ; )
+    {
+        /* The tail is read first, so the head is never behind it. */
+        ulTail = pxRing->ulTail;
+        ulHead = pxRing->ulHead;
+
+        if( ( ulHead + ulLength - ulTail ) > logbinBUFFER_SIZE )
+        {
+            xReserved = pdFALSE;
+            break;
+        }
+
+        if( Atomic_CompareAndSwap_u32( &( pxRing->ulHead ), ulHead + ulLength, ulHead ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+        {
+            xReserved = pdTRUE;
+            break;
+        }
+    }
+
+    if( xReserved == pdTRUE )
+    {
+        prvRingWrite( pxRing, ulHead + sizeof( uint32_t ), &( ( ( const uint8_t * ) &xEntry )[ sizeof( uint32_t ) ] ), sizeof( xEntry ) - sizeof( uint32_t ) );
+        prvRingWrite( pxRing, ulHead + sizeof( xEntry ), ucArguments, xEntry.usArgumentLength );
+
+        /* Publish the entry. */
+        portMEMORY_BARRIER();
+        logbinENTRY_LENGTH( pxRing, ulHead ) = ulLength;
+    }
+    else
+    {
+        ( void ) Atomic_Increment_u32( &( pxRing->ulDropped ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvOutputText( const LogBinaryEntry_t * pxEntry,
+                           const uint8_t * pucArguments )
+{
+    static const char * const pcLevelNames[] = { "ALWAYS", "ERROR", "WARN", "INFO", "DEBUG" };
+    const LogBinaryRecord_t * pxRecord = pxEntry->pxRecord;
+    char cLine[ logbinMAX_LINE_LENGTH ];
+    char cTaskName[ logbinTASK_NAME_LENGTH + 1U ];
+    size_t xLength;
+    int iReturned;
+
+    memcpy( cTaskName, pxEntry->cTaskName, logbinTASK_NAME_LENGTH );
+    cTaskName[ logbinTASK_NAME_LENGTH ] = '\0';
+
+    iReturned = snprintf( cLine, sizeof( cLine ), "%lu %lu [%s] [%s] [%s] [%s:%u] ",
+                          ( unsigned long ) ulMessageNumber,
+                          ( unsigned long ) pxEntry->ulTimeStamp,
+                          cTaskName,
+                          ( pxRecord->ucLevel <= LOG_DEBUG ) ? pcLevelNames[ pxRecord->ucLevel ] : "?",
+                          pxRecord->pcLibrary,
+                          pxRecord->pcFunction,
+                          ( unsigned ) pxRecord->usLine );
+    ulMessageNumber++;
+
+    /* Leave room for at least one character of the message and the line
+     * break. */
+    xLength = ( iReturned < 0 ) ? 0U : ( size_t ) iReturned;
+
+    if( xLength > ( sizeof( cLine ) - 3U ) )
+    {
+        xLength = sizeof( cLine ) - 3U;
+    }
+
+    xLength += prvFormatMessage( pxRecord->pcFormat, pucArguments, pxEntry->usArgumentLength, &( cLine[ xLength ] ), sizeof( cLine ) - xLength - 2U );
+    cLine[ xLength ] = '\r';
+    cLine[ xLength + 1U ] = '\n';
+
+    pxOutputFunction( cLine, xLength + 2U );
+}
+/*-----------------------------------------------------------*/
+
+static void prvOutputFrameHeader( uint8_t ucType,
+                                  size_t xLength )
+{
+    uint8_t ucHeader[ logbinFRAME_HEADER_SIZE ];
+
+    ucHeader[ 0 ] = ucType;
+    ucHeader[ 1 ] = ( uint8_t ) ( xLength & 0xffU );
+    ucHeader[ 2 ] = ( uint8_t ) ( ( xLength >> 8 ) & 0xffU );
+    pxOutputFunction( ucHeader, sizeof( ucHeader ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvOutputStreamHeader( void )
+{
+    const uint16_t usOne = 1U;
+    const uint8_t ucHeader[] =
+    {
+        'F',                        'R',                       'L',                     'B',
+        logbinFORMAT_VERSION,
+        *( ( const uint8_t * ) &usOne ),
+        sizeof( int ),              sizeof( long ),            sizeof( long long ),
+        sizeof( size_t ),           sizeof( intmax_t ),        sizeof( ptrdiff_t ),
+        sizeof( void * ),           sizeof( double )
+    };
+
+    prvOutputFrameHeader( logbinFRAME_HEADER, sizeof( ucHeader ) );
+    pxOutputFunction( ucHeader, sizeof( ucHeader ) );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Return pdTRUE if the definition of pxRecord was not sent yet, and remember
+ * it as sent.
+ */
+static BaseType_t prvIsNewDefinition( const LogBinaryRecord_t * pxRecord )
+{
+    UBaseType_t uxStart = ( UBaseType_t ) ( ( ( ( uintptr_t ) pxRecord ) >> 2 ) * 2654435761UL ) & ( logbinDICTIONARY_SIZE - 1U );
+    UBaseType_t uxIndex = uxStart;
+    BaseType_t xReturn = pdFALSE;
+
+    while( ( pxDefinitionsSent[ uxIndex ] != NULL ) && ( pxDefinitionsSent[ uxIndex ] != pxRecord ) )
+    {
+        uxIndex = ( uxIndex + 1U ) & ( logbinDICTIONARY_SIZE - 1U );
+    }
+
+    if( pxDefinitionsSent[ uxIndex ] == NULL )
+    {
+        if( uxDefinitionCount >= ( ( logbinDICTIONARY_SIZE * 3U ) / 4U ) )
+        {
+            /* Forget all definitions, they are sent again when used.  The
+             * header is repeated as well, which lets a decoder that started
+             * late pick up the stream. */
+            memset( pxDefinitionsSent, 0, sizeof( pxDefinitionsSent ) );
+            uxDefinitionCount = 0U;
+            uxIndex = uxStart;
+            prvOutputStreamHeader();
+        }
+
+        pxDefinitionsSent[ uxIndex ] = pxRecord;
+        uxDefinitionCount++;
+        xReturn = pdTRUE;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvOutputBinary( const LogBinaryEntry_t * pxEntry,
+                             const uint8_t * pucArguments )
+{
+    const LogBinaryRecord_t * pxRecord = pxEntry->pxRecord;
+    uint8_t ucFrame[ logbinFRAME_HEADER_SIZE + sizeof( void * ) + sizeof( uint32_t ) + logbinTASK_NAME_LENGTH + 1U + logbinMAX_ARGUMENT_SIZE ];
+    size_t xFormatLength, xLibraryLength, xFunctionLength, xLength, xIndex;
+
+    if( xHeaderSent == pdFALSE )
+    {
+        prvOutputStreamHeader();
+        xHeaderSent = pdTRUE;
+    }
+
+    if( prvIsNewDefinition( pxRecord ) == pdTRUE )
+    {
+        xFormatLength = strlen( pxRecord->pcFormat ) + 1U;
+        xLibraryLength = strlen( pxRecord->pcLibrary ) + 1U;
+        xFunctionLength = strlen( pxRecord->pcFunction ) + 1U;
+
+        memcpy( ucFrame, &pxRecord, sizeof( void * ) );
+        ucFrame[ sizeof( void * ) ] = pxRecord->ucLevel;
+        ucFrame[ sizeof( void * ) + 1U ] = ( uint8_t ) ( pxRecord->usLine & 0xffU );
+        ucFrame[ sizeof( void * ) + 2U ] = ( uint8_t ) ( pxRecord->usLine >> 8 );
+
+        prvOutputFrameHeader( logbinFRAME_DEFINITION, sizeof( void * ) + 3U + xFormatLength + xLibraryLength + xFunctionLength );
+        pxOutputFunction( ucFrame, sizeof( void * ) + 3U );
+        pxOutputFunction( pxRecord->pcFormat, xFormatLength );
+        pxOutputFunction( pxRecord->pcLibrary, xLibraryLength );
+        pxOutputFunction( pxRecord->pcFunction, xFunctionLength );
+    }
+
+    xLength = logbinFRAME_HEADER_SIZE;
+    memcpy( &( ucFrame[ xLength ] ), &pxRecord, sizeof( void * ) );
+    xLength += sizeof( void * );
+    memcpy( &( ucFrame[ xLength ] ), &( pxEntry->ulTimeStamp ), sizeof( uint32_t ) );
+    xLength += sizeof( uint32_t );
+
+    for( xIndex = 0U; ( xIndex < logbinTASK_NAME_LENGTH ) && ( pxEntry->cTaskName[ xIndex ] != '\0' ); xIndex++ )
+    {
+        ucFrame[ xLength ] = ( uint8_t ) pxEntry->cTaskName[ xIndex ];
+        xLength++;
+    }
+
+    ucFrame[ xLength ] = 0U;
+    xLength++;
+    memcpy( &( ucFrame[ xLength ] ), pucArguments, pxEntry->usArgumentLength );
+    xLength += pxEntry->usArgumentLength;
+
+    ucFrame[ 0 ] = logbinFRAME_MESSAGE;
+    ucFrame[ 1 ] = ( uint8_t ) ( ( xLength - logbinFRAME_HEADER_SIZE ) & 0xffU );
+    ucFrame[ 2 ] = ( uint8_t ) ( ( xLength - logbinFRAME_HEADER_SIZE ) >> 8 );
+    pxOutputFunction( ucFrame, xLength );
+}
+/*-----------------------------------------------------------*/
+
+static void prvOutputDropped( void )
+{
+    uint32_t ulDropped = ulLoggingBinaryDropped();
+    uint32_t ulNew = ulDropped - ulDroppedReported;
+    char cLine[ 40 ];
+    int iReturned;
+
+    if( ulNew != 0U )
+    {
+        ulDroppedReported = ulDropped;
+
+        if( xFormatLines == pdTRUE )
+        {
+            iReturned = snprintf( cLine, sizeof( cLine ), "%lu messages dropped\r\n", ( unsigned long ) ulNew );
+
+            if( iReturned > 0 )
+            {
+                pxOutputFunction( cLine, ( size_t ) iReturned );
+            }
+        }
+        else
+        {
+            prvOutputFrameHeader( logbinFRAME_DROPPED, sizeof( ulNew ) );
+            pxOutputFunction( &ulNew, sizeof( ulNew ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vLoggingBinaryDrain( void )
+{
+    LogBinaryEntry_t xEntries[ configNUMBER_OF_CORES ];
+    uint8_t ucArguments[ logbinMAX_ARGUMENT_SIZE ];
+    LogBinaryRing_t * pxRing;
+    const LogBinaryEntry_t * pxEntry;
+    UBaseType_t uxCore, uxOldest = 0U;
+    BaseType_t xFound = pdTRUE;
+
+    if( pxOutputFunction != NULL )
+    {
+        while( xFound == pdTRUE )
+        {
+            /* Take the oldest message of all cores. */
+            xFound = pdFALSE;
+
+            for( uxCore = 0U; uxCore < ( UBaseType_t ) configNUMBER_OF_CORES; uxCore++ )
+            {
+                if( ( prvRingPeek( &( xRings[ uxCore ] ), &( xEntries[ uxCore ] ) ) == pdTRUE ) &&
+                    ( ( xFound == pdFALSE ) || ( ( int32_t ) ( xEntries[ uxCore ].ulTimeStamp - xEntries[ uxOldest ].ulTimeStamp ) < 0 ) ) )
+                {
+                    uxOldest = uxCore;
+                    xFound = pdTRUE;
+                }
+            }
+
+            if( xFound == pdTRUE )
+            {
+                pxRing = &( xRings[ uxOldest ] );
+                pxEntry = &( xEntries[ uxOldest ] );
+                prvRingRead( pxRing, pxRing->ulTail + sizeof( LogBinaryEntry_t ), ucArguments, pxEntry->usArgumentLength );
+
+                /* Clear the entry before releasing it, so its length reads as
+                 * 0 until a writer completes the next entry at the same place. */
+                prvRingClear( pxRing, pxRing->ulTail, pxEntry->ulLength );
+                portMEMORY_BARRIER();
+                pxRing->ulTail += pxEntry->ulLength;
+
+                if( xFormatLines == pdTRUE )
+                {
+                    prvOutputText( pxEntry, ucArguments );
+                }
+                else
+                {
+                    prvOutputBinary( pxEntry, ucArguments );
+                }
+            }
+        }
+
+        prvOutputDropped();
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulLoggingBinaryDropped( void )
+{
+    uint32_t ulDropped = 0U;
+    UBaseType_t uxCore;
+
+    for( uxCore = 0U; uxCore < ( UBaseType_t ) configNUMBER_OF_CORES; uxCore++ )
+    {
+        ulDropped += xRings[ uxCore ].ulDropped;
+    }
+
+    return ulDropped;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDrainTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        vLoggingBinaryDrain();
+        vTaskDelay( pdMS_TO_TICKS( logbinDRAIN_PERIOD_MS ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xLoggingBinaryInit( BaseType_t xFormatOnTarget,
+                               LoggingBinaryOutput_t pxOutput,
+                               configSTACK_DEPTH_TYPE usStackSize,
+                               UBaseType_t uxPriority )
+{
+    configASSERT( pxOutput != NULL );
+
+    xFormatLines = xFormatOnTarget;
+    pxOutputFunction = pxOutput;
+
+    return xTaskCreate( prvDrainTask, "LogDrain", usStackSize, NULL, uxPriority, NULL );
+}
+/*-----------------------------------------------------------*/
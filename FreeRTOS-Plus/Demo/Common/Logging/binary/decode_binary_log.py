@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+#
+# FreeRTOS V202212.00
+# Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+# https://www.FreeRTOS.org
+# https://github.com/FreeRTOS
+#
+"""
+Turn the binary output of Logging_Binary.c into the lines that it prints when
+it formats on the target.
+
+    decode_binary_log.py capture.bin        Decode a file.
+    decode_binary_log.py -                  Decode stdin, e.g. a serial port.
+    decode_binary_log.py --udp 9999         Decode the datagrams sent to a port.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import re
+import socket
+import struct
+import sys
+
+LEVEL_NAMES = ["ALWAYS", "ERROR", "WARN", "INFO", "DEBUG"]
+
+# The same conversion specifications as prvParseSpec().
+SPEC = re.compile(r"%([-+ #0']*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|q|z|j|t|L)?(.)?", re.S)
+
+
+class Decoder:
+    def __init__(self, output):
+        self.output = output
+        self.pending = b""
+        self.header = None
+        self.definitions = {}
+        self.message_number = 0
+
+    def feed(self, data):
+        self.pending += data
+
+        while True:
+            if self.header is None and not self._find_header():
+                return
+
+            if len(self.pending) < 3:
+                return
+
+            frame_type = self.pending[0:1]
+            length = self.pending[1] | (self.pending[2] << 8)
+
+            if frame_type not in b"HDMX":
+                # Lost track of the frames, wait for the next header.
+                self.header = None
+                self.pending = self.pending[1:]
+                continue
+
+            if len(self.pending) < 3 + length:
+                return
+
+            payload = self.pending[3:3 + length]
+            self.pending = self.pending[3 + length:]
+            self._frame(frame_type, payload)
+
+    def _find_header(self):
+        index = self.pending.find(b"H\x0e\x00FRLB")
+
+        if index < 0:
+            # Keep what may be the start of a header.
+            self.pending = self.pending[-6:]
+            return False
+
+        self.pending = self.pending[index:]
+        return len(self.pending) >= 3 + 14 and self._frame_header(self.pending[3:17])
+
+    def _frame_header(self, payload):
+        if payload[4] != 1:
+            sys.exit("Unknown format version %d" % payload[4])
+
+        order = "<" if payload[5] == 1 else ">"
+        names = ["int", "long", "long long", "size_t", "intmax_t", "ptrdiff_t", "void *", "double"]
+        self.header = {"order": order, "sizes": dict(zip(names, payload[6:14]))}
+        return True
+
+    def _frame(self, frame_type, payload):
+        sizes = self.header["sizes"]
+        id_size = sizes["void *"]
+
+        if frame_type == b"H":
+            self._frame_header(payload)
+        elif frame_type == b"D":
+            strings = payload[id_size + 3:].split(b"\0")
+            self.definitions[payload[:id_size]] = {
+                "level": payload[id_size],
+                "line": payload[id_size + 1] | (payload[id_size + 2] << 8),
+                "format": strings[0].decode("utf-8", "replace"),
+                "library": strings[1].decode("utf-8", "replace"),
+                "function": strings[2].decode("utf-8", "replace"),
+            }
+        elif frame_type == b"M":
+            definition = self.definitions.get(payload[:id_size])
+            (time_stamp,) = struct.unpack(self.header["order"] + "I", payload[id_size:id_size + 4])
+            end = payload.index(b"\0", id_size + 4)
+            task_name = payload[id_size + 4:end].decode("utf-8", "replace")
+            arguments = payload[end + 1:]
+
+            if definition is None:
+                text = "[?] [?] [?:0] <unknown message %s>" % payload[:id_size].hex()
+            else:
+                level = definition["level"]
+                text = "[%s] [%s] [%s:%u] %s" % (
+                    LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else "?",
+                    definition["library"],
+                    definition["function"],
+                    definition["line"],
+                    self._format(definition["format"], arguments),
+                )
+
+            self.output("%lu %lu [%s] %s" % (self.message_number, time_stamp, task_name, text))
+            self.message_number = (self.message_number + 1) & 0xFFFFFFFF
+        elif frame_type == b"X":
+            (dropped,) = struct.unpack(self.header["order"] + "I", payload[:4])
+            self.output("%lu messages dropped" % dropped)
+
+    def _read(self, arguments, offset, kind, signed=True):
+        """Return the value of type kind at offset and the offset after it, or
+        None when the values were cut."""
+        size = self.header["sizes"][kind]
+
+        if offset + size > len(arguments):
+            return None, offset
+
+        if kind == "double":
+            (value,) = struct.unpack(self.header["order"] + "d", arguments[offset:offset + size])
+        else:
+            value = int.from_bytes(arguments[offset:offset + size],
+                                   "little" if self.header["order"] == "<" else "big",
+                                   signed=signed)
+
+        return value, offset + size
+
+    def _format(self, fmt, arguments):
+        out = []
+        offset = 0
+        position = 0
+
+        while position < len(fmt):
+            percent = fmt.find("%", position)
+
+            if percent < 0:
+                out.append(fmt[position:])
+                break
+
+            out.append(fmt[position:percent])
+            match = SPEC.match(fmt, percent)
+            flags, width, precision, length, conversion = match.groups()
+
+            if conversion is None:
+                out.append(fmt[percent:])
+                break
+
+            text, offset = self._conversion(flags, width, precision, length, conversion, arguments, offset)
+
+            if text is None:
+                # The values were cut on the target, print the rest as it is.
+                out.append(fmt[percent:])
+                break
+
+            if text is False:
+                text = match.group(0)
+
+            out.append(text)
+            position = match.end()
+
+        return "".join(out)
+
+    def _conversion(self, flags, width, precision, length, conversion, arguments, offset):
+        """Return the text of one conversion and the offset after its values.
+        The text is None when the values are missing, False when the
+        conversion is not known."""
+        if conversion == "%":
+            return "%", offset
+
+        if conversion not in "diouxXcfFeEgGaAspn":
+            return False, offset
+
+        flags = flags.replace("'", "")
+
+        if width == "*":
+            value, offset = self._read(arguments, offset, "int")
+
+            if value is None:
+                return None, offset
+
+            if value < 0:
+                flags += "-"
+
+            width = str(abs(value))
+
+        if precision == "*":
+            value, offset = self._read(arguments, offset, "int")
+
+            if value is None:
+                return None, offset
+
+            precision = None if value < 0 else str(value)
+
+        spec = "%" + flags + (width or "") + ("" if precision is None else "." + (precision or "0"))
+
+        if conversion in "diouxXc":
+            kind = {"l": "long", "ll": "long long", "q": "long long", "z": "size_t",
+                    "j": "intmax_t", "t": "ptrdiff_t"}.get(length, "int")
+            value, offset = self._read(arguments, offset, kind, signed=conversion in "dic")
+
+            if value is None:
+                return None, offset
+
+            if length in ("h", "hh") or conversion == "c":
+                bits = 8 if length == "hh" or conversion == "c" else 16
+                value &= (1 << bits) - 1
+
+                if conversion in "di" and value >= 1 << (bits - 1):
+                    value -= 1 << bits
+
+            if conversion == "c":
+                return (spec + "s") % chr(value), offset
+
+            if conversion == "o" and "#" in flags:
+                # C prints a leading 0 instead of Python's 0o.
+                return (spec.replace("#", "").split(".")[0] + "s") % ("0%o" % value if value != 0 else "0"), offset
+
+            return (spec + conversion.replace("i", "d")) % value, offset
+
+        if conversion in "fFeEgGaA":
+            value, offset = self._read(arguments, offset, "double")
+
+            if value is None:
+                return None, offset
+
+            if conversion in "aA":
+                text = value.hex()
+                return (text.upper() if conversion == "A" else text), offset
+
+            return (spec + conversion) % value, offset
+
+        if conversion == "s":
+            if offset >= len(arguments) or offset + 1 + arguments[offset] > len(arguments):
+                return None, len(arguments)
+
+            string = arguments[offset + 1:offset + 1 + arguments[offset]].decode("utf-8", "replace")
+            return (spec + "s") % string, offset + 1 + arguments[offset]
+
+        if conversion == "p":
+            value, offset = self._read(arguments, offset, "void *", signed=False)
+
+            if value is None:
+                return None, offset
+
+            return ((spec.split(".")[0] + "s") % ("(nil)" if value == 0 else "0x%x" % value)), offset
+
+        # "%n" has no value.
+        return "", offset
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", default="-", help="file to decode, - for stdin")
+    parser.add_argument("--udp", type=int, metavar="PORT", help="decode the datagrams sent to PORT")
+    arguments = parser.parse_args()
+
+    decoder = Decoder(lambda line: print(line, flush=True))
+
+    if arguments.udp is not None:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind(("", arguments.udp))
+
+        while True:
+            decoder.feed(sock.recv(65535))
+    else:
+        stream = sys.stdin.buffer if arguments.input == "-" else open(arguments.input, "rb")
+
+        with stream:
+            while True:
+                data = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+
+                if not data:
+                    break
+
+                decoder.feed(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,571 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+/*
+ * Logging utility for the POSIX port that allows FreeRTOS tasks to log to
+ * stdout, a disk file and a UDP port without making any system calls
+ * themselves.
+ *
+ * vLoggingPrintf() formats the message in the calling task and copies it into
+ * a ring buffer.  Space in the ring buffer is reserved with a compare-and-swap
+ * on its head, and the length of a message is written after the message
+ * itself, so tasks and native threads can log at the same time without a lock.
+ * A task that is switched out half way through writing its message therefore
+ * cannot block any other task.  When the ring buffer is full the message is
+ * dropped and counted, rather than making the task wait.
+ *
+ * A native pthread, which is not a FreeRTOS task, polls the ring buffer and
+ * performs the actual output, so the time spent in the host's I/O is not spent
+ * in the simulated tasks.  The log file is renamed when it reaches
+ * dlLOGGING_FILE_SIZE, keeping the last dlLOGGING_FILE_COUNT files.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Demo includes. */
+#include "logging.h"
+
+/*-----------------------------------------------------------*/
+
+/* The maximum size to which the log file may grow, before being renamed. */
+#ifndef dlLOGGING_FILE_SIZE
+    #define dlLOGGING_FILE_SIZE           ( 40ul * 1024ul * 1024ul )
+#endif
+
+/* The number of full log files that are kept, as RTOSDemo.log.1 (the most
+ * recent) to RTOSDemo.log.<dlLOGGING_FILE_COUNT>.  Must be at least 1. */
+#ifndef dlLOGGING_FILE_COUNT
+    #define dlLOGGING_FILE_COUNT          3
+#endif
+
+/* Dimensions the arrays into which print messages are created. */
+#ifndef dlMAX_PRINT_STRING_LENGTH
+    #define dlMAX_PRINT_STRING_LENGTH     255
+#endif
+
+/* The size of the ring buffer used to pass messages from FreeRTOS tasks to the
+ * pthread that performs the output.  Must be a power of two. */
+#ifndef dlLOGGING_RING_BUFFER_SIZE
+    #define dlLOGGING_RING_BUFFER_SIZE    32768U
+#endif
+
+/* How long the pthread sleeps when the ring buffer is empty. */
+#ifndef dlLOGGING_POLL_PERIOD_MS
+    #define dlLOGGING_POLL_PERIOD_MS      5
+#endif
+
+#if ( ( dlLOGGING_RING_BUFFER_SIZE & ( dlLOGGING_RING_BUFFER_SIZE - 1U ) ) != 0U )
+    #error "dlLOGGING_RING_BUFFER_SIZE must be a power of two."
+#endif
+
+/* Messages are stored as a 32-bit length followed by the text, padded to a
+ * multiple of 4 bytes so the length is always aligned and never wraps. */
+#define dlRING_ENTRY_SIZE( xLength )    ( ( ( uint32_t ) ( xLength ) + sizeof( uint32_t ) + 3U ) & ~( ( uint32_t ) 3U ) )
+#define dlRING_INDEX( ulOffset )        ( ( ulOffset ) & ( dlLOGGING_RING_BUFFER_SIZE - 1U ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Called from vLoggingInit() to find the size of an existing log file.
+ */
+static void prvFileLoggingInit( void );
+
+/*
+ * Attempt to write a message to the file, renaming the file when it is full.
+ */
+static void prvLogToFile( const char * pcMessage,
+                          size_t xLength );
+
+/*
+ * Copy a message into the ring buffer.  Called by any task or thread.
+ */
+static void prvRingBufferAdd( const char * pcMessage,
+                              size_t xLength );
+
+/*
+ * Output all the messages that are in the ring buffer.  Returns the number of
+ * messages written.  Only called by prvLoggingThread(), or at exit.
+ */
+static size_t prvLoggingFlushBuffer( void );
+
+/*
+ * The pthread that performs the actual writing of the messages.
+ */
+static void * prvLoggingThread( void * pvParameters );
+
+/*
+ * Write out what is left in the ring buffer when the process exits.
+ */
+static void prvLoggingFlushAtExit( void );
+
+/*-----------------------------------------------------------*/
+
+/* Stores the selected logging targets passed in as parameters to the
+ * vLoggingInit() function. */
+static BaseType_t xStdoutLoggingUsed = pdFALSE, xDiskFileLoggingUsed = pdFALSE, xUDPLoggingUsed = pdFALSE;
+
+/* Set once the pthread is running.  Until then vLoggingPrintf() prints
+ * directly. */
+static BaseType_t xLoggingThreadRunning = pdFALSE;
+
+/* The ring buffer.  ulRingHead counts the bytes reserved by writers and
+ * ulRingTail the bytes released by the pthread, both free running.  A length
+ * of 0 marks a message that is not complete yet. */
+static uint32_t ulRingBuffer[ dlLOGGING_RING_BUFFER_SIZE / sizeof( uint32_t ) ];
+static uint32_t ulRingHead = 0U;
+static uint32_t ulRingTail = 0U;
+
+/* The number of messages that were dropped because the ring buffer was full,
+ * and the number that was last reported. */
+static uint32_t ulDroppedMessages = 0U;
+static uint32_t ulDroppedReported = 0U;
+
+/* Serialises the readers of the ring buffer: the pthread and the exit
+ * handler.  Never taken by a FreeRTOS task. */
+static pthread_mutex_t xFlushMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Handle to the file used for logging, left open between messages. */
+static FILE * pxLoggingFileHandle = NULL;
+
+/* File name of the in use log file.  Full files get a numbered suffix. */
+static const char * pcLogFileName = "RTOSDemo.log";
+
+/* As an optimization, the current file size is kept in a variable. */
+static size_t ulSizeOfLoggingFile = 0ul;
+
+/* The host socket and address to which UDP messages are sent. */
+static int iPrintSocket = -1;
+static struct sockaddr_in xPrintUDPAddress;
+
+/*-----------------------------------------------------------*/
+
+void vLoggingInit( BaseType_t xLogToStdout,
+                   BaseType_t xLogToFile,
+                   BaseType_t xLogToUDP,
+                   uint32_t ulRemoteIPAddress,
+                   uint16_t usRemotePort )
+{
+    pthread_t xLoggingThread;
+    sigset_t xAllSignals, xOriginalSignals;
+
+    /* Can only be called before the scheduler has started. */
+    configASSERT( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED );
+
+    /* Record which output methods are to be used. */
+    xStdoutLoggingUsed = xLogToStdout;
+    xDiskFileLoggingUsed = xLogToFile;
+    xUDPLoggingUsed = xLogToUDP;
+
+    /* If a disk file is used then initialize it now. */
+    if( xDiskFileLoggingUsed != pdFALSE )
+    {
+        prvFileLoggingInit();
+    }
+
+    /* The UDP messages are sent by the pthread through a host socket, so do
+     * not depend on FreeRTOS+TCP.  ulRemoteIPAddress is in network byte order,
+     * as returned by FreeRTOS_inet_addr(). */
+    if( xUDPLoggingUsed != pdFALSE )
+    {
+        memset( &xPrintUDPAddress, 0, sizeof( xPrintUDPAddress ) );
+        xPrintUDPAddress.sin_family = AF_INET;
+        xPrintUDPAddress.sin_port = htons( usRemotePort );
+        xPrintUDPAddress.sin_addr.s_addr = ulRemoteIPAddress;
+        iPrintSocket = socket( AF_INET, SOCK_DGRAM, 0 );
+    }
+
+    if( ( xStdoutLoggingUsed != pdFALSE ) || ( xDiskFileLoggingUsed != pdFALSE ) || ( xUDPLoggingUsed != pdFALSE ) )
+    {
+        /* The POSIX port drives the scheduler with signals.  Block them all in
+         * the new thread, so it is never mistaken for a FreeRTOS task. */
+        sigfillset( &xAllSignals );
+        pthread_sigmask( SIG_SETMASK, &xAllSignals, &xOriginalSignals );
+
+        if( pthread_create( &xLoggingThread, NULL, prvLoggingThread, NULL ) == 0 )
+        {
+            pthread_detach( xLoggingThread );
+            xLoggingThreadRunning = pdTRUE;
+            atexit( prvLoggingFlushAtExit );
+        }
+
+        pthread_sigmask( SIG_SETMASK, &xOriginalSignals, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    char cPrintString[ dlMAX_PRINT_STRING_LENGTH ];
+    size_t xLength;
+    int iLength;
+    static uint32_t ulMessageNumber = 0;
+    static BaseType_t xAfterLineBreak = pdTRUE;
+    va_list args;
+    const char * pcTaskName;
+    const char * pcNoTask = "None";
+
+    va_start( args, pcFormat );
+
+    if( xLoggingThreadRunning == pdFALSE )
+    {
+        /* vLoggingInit() was not called, or no output was selected: behave as
+         * the POSIX demos did before this file existed. */
+        vprintf( pcFormat, args );
+    }
+    else
+    {
+        /* Additional info to place at the start of the log. */
+        if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+        {
+            pcTaskName = pcTaskGetName( NULL );
+        }
+        else
+        {
+            pcTaskName = pcNoTask;
+        }
+
+        if( ( xAfterLineBreak == pdTRUE ) && ( strcmp( pcFormat, "\r\n" ) != 0 ) )
+        {
+            iLength = snprintf( cPrintString, dlMAX_PRINT_STRING_LENGTH, "%lu %lu [%s] ",
+                                ( unsigned long ) __atomic_fetch_add( &ulMessageNumber, 1U, __ATOMIC_RELAXED ),
+                                ( unsigned long ) xTaskGetTickCount(),
+                                pcTaskName );
+            xLength = ( iLength < 0 ) ? 0U : ( size_t ) iLength;
+            xAfterLineBreak = pdFALSE;
+        }
+        else
+        {
+            xLength = 0;
+            xAfterLineBreak = pdTRUE;
+        }
+
+        if( xLength >= dlMAX_PRINT_STRING_LENGTH )
+        {
+            xLength = dlMAX_PRINT_STRING_LENGTH - 1;
+        }
+
+        iLength = vsnprintf( cPrintString + xLength, dlMAX_PRINT_STRING_LENGTH - xLength, pcFormat, args );
+
+        if( iLength > 0 )
+        {
+            xLength += ( size_t ) iLength;
+        }
+
+        if( xLength >= dlMAX_PRINT_STRING_LENGTH )
+        {
+            /* The message was cut. */
+            xLength = dlMAX_PRINT_STRING_LENGTH - 1;
+        }
+
+        prvRingBufferAdd( cPrintString, xLength );
+    }
+
+    va_end( args );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRingBufferAdd( const char * pcMessage,
+                              size_t xLength )
+{
+    uint8_t * pucBuffer = ( uint8_t * ) ulRingBuffer;
+    uint32_t ulHead, ulTail, ulEntrySize, ulStart;
+    size_t xFirst;
+    BaseType_t xReserved = pdFALSE;
+
+    if( xLength > 0U )
+    {
+        ulEntrySize = dlRING_ENTRY_SIZE( xLength );
+
+        for( ; ; )
+        {
+            /* The tail is read first, so the head is never behind it. */
+            ulTail = __atomic_load_n( &ulRingTail, __ATOMIC_ACQUIRE );
+            ulHead = __atomic_load_n( &ulRingHead, __ATOMIC_RELAXED );
+
+            if( ( ulHead + ulEntrySize - ulTail ) > dlLOGGING_RING_BUFFER_SIZE )
+            {
+                break;
+            }
+
+            if( __atomic_compare_exchange_n( &ulRingHead, &ulHead, ulHead + ulEntrySize, pdFALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            {
+                xReserved = pdTRUE;
+                break;
+            }
+        }
+
+        if( xReserved == pdFALSE )
+        {
+            __atomic_fetch_add( &ulDroppedMessages, 1U, __ATOMIC_RELAXED );
+        }
+        else
+        {
+            /* Copy the text, wrapping at the end of the buffer, then publish
+             * it by writing its length. */
+            ulStart = dlRING_INDEX( ulHead + sizeof( uint32_t ) );
+            xFirst = dlLOGGING_RING_BUFFER_SIZE - ulStart;
+
+            if( xFirst > xLength )
+            {
+                xFirst = xLength;
+            }
+
+            memcpy( &( pucBuffer[ ulStart ] ), pcMessage, xFirst );
+            memcpy( pucBuffer, &( pcMessage[ xFirst ] ), xLength - xFirst );
+
+            __atomic_store_n( &( ulRingBuffer[ dlRING_INDEX( ulHead ) / sizeof( uint32_t ) ] ), ( uint32_t ) xLength, __ATOMIC_RELEASE );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvLoggingFlushBuffer( void )
+{
+    const uint8_t * pucBuffer = ( const uint8_t * ) ulRingBuffer;
+    char cPrintString[ dlMAX_PRINT_STRING_LENGTH + 64 ];
+    uint32_t ulTail, ulLength, ulEntrySize, ulStart, ulIndex, ulDropped;
+    size_t xFirst, xMessages = 0U;
+    int iLength;
+
+    pthread_mutex_lock( &xFlushMutex );
+
+    ulTail = __atomic_load_n( &ulRingTail, __ATOMIC_RELAXED );
+
+    for( ; ; )
+    {
+        ulLength = __atomic_load_n( &( ulRingBuffer[ dlRING_INDEX( ulTail ) / sizeof( uint32_t ) ] ), __ATOMIC_ACQUIRE );
+
+        if( ulLength == 0U )
+        {
+            /* Empty, or the next message is still being written. */
+            break;
+        }
+
+        ulEntrySize = dlRING_ENTRY_SIZE( ulLength );
+        ulStart = dlRING_INDEX( ulTail + sizeof( uint32_t ) );
+        xFirst = dlLOGGING_RING_BUFFER_SIZE - ulStart;
+
+        if( xFirst > ulLength )
+        {
+            xFirst = ulLength;
+        }
+
+        memcpy( cPrintString, &( pucBuffer[ ulStart ] ), xFirst );
+        memcpy( &( cPrintString[ xFirst ] ), pucBuffer, ulLength - xFirst );
+
+        /* Clear the entry, so its length reads as 0 until a writer completes
+         * the next message at the same place, before releasing it. */
+        for( ulIndex = 0U; ulIndex < ulEntrySize; ulIndex += sizeof( uint32_t ) )
+        {
+            ulRingBuffer[ dlRING_INDEX( ulTail + ulIndex ) / sizeof( uint32_t ) ] = 0U;
+        }
+
+        ulTail += ulEntrySize;
+        __atomic_store_n( &ulRingTail, ulTail, __ATOMIC_RELEASE );
+
+        /* Write the message to standard out if requested to do so when
+         * vLoggingInit() was called. */
+        if( xStdoutLoggingUsed != pdFALSE )
+        {
+            ( void ) fwrite( cPrintString, 1, ulLength, stdout );
+        }
+
+        /* Write the message to a file if requested to do so when
+         * vLoggingInit() was called. */
+        if( xDiskFileLoggingUsed != pdFALSE )
+        {
+            prvLogToFile( cPrintString, ulLength );
+        }
+
+        if( iPrintSocket >= 0 )
+        {
+            ( void ) sendto( iPrintSocket, cPrintString, ulLength, MSG_DONTWAIT,
+                             ( const struct sockaddr * ) &xPrintUDPAddress, sizeof( xPrintUDPAddress ) );
+        }
+
+        xMessages++;
+    }
+
+    /* Report the messages that were lost since the last report. */
+    ulDropped = __atomic_load_n( &ulDroppedMessages, __ATOMIC_RELAXED );
+
+    if( ulDropped != ulDroppedReported )
+    {
+        iLength = snprintf( cPrintString, sizeof( cPrintString ), "\r\n%lu log messages dropped, the ring buffer was full\r\n",
+                            ( unsigned long ) ( ulDropped - ulDroppedReported ) );
+        ulDroppedReported = ulDropped;
+
+        if( xStdoutLoggingUsed != pdFALSE )
+        {
+            ( void ) fwrite( cPrintString, 1, ( size_t ) iLength, stdout );
+        }
+
+        if( xDiskFileLoggingUsed != pdFALSE )
+        {
+            prvLogToFile( cPrintString, ( size_t ) iLength );
+        }
+    }
+
+    if( xMessages > 0U )
+    {
+        if( xStdoutLoggingUsed != pdFALSE )
+        {
+            fflush( stdout );
+        }
+
+        if( pxLoggingFileHandle != NULL )
+        {
+            fflush( pxLoggingFileHandle );
+        }
+    }
+
+    pthread_mutex_unlock( &xFlushMutex );
+
+    return xMessages;
+}
+/*-----------------------------------------------------------*/
+
+static void * prvLoggingThread( void * pvParameters )
+{
+    const struct timespec xPollPeriod = { 0, dlLOGGING_POLL_PERIOD_MS * 1000000L };
+
+    ( void ) pvParameters;
+
+    #ifdef SCHED_IDLE
+    {
+        /* Only run when the host has nothing else to do, as the Win32
+         * simulator does with THREAD_PRIORITY_IDLE.  Failure is harmless. */
+        struct sched_param xParameters = { 0 };
+
+        ( void ) pthread_setschedparam( pthread_self(), SCHED_IDLE, &xParameters );
+    }
+    #endif
+
+    for( ; ; )
+    {
+        /* Write out all waiting messages, then wait for more. */
+        if( prvLoggingFlushBuffer() == 0U )
+        {
+            ( void ) nanosleep( &xPollPeriod, NULL );
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLoggingFlushAtExit( void )
+{
+    ( void ) prvLoggingFlushBuffer();
+
+    if( pxLoggingFileHandle != NULL )
+    {
+        fclose( pxLoggingFileHandle );
+        pxLoggingFileHandle = NULL;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvFileLoggingInit( void )
+{
+    FILE * pxHandle = fopen( pcLogFileName, "a" );
+
+    if( pxHandle != NULL )
+    {
+        fseek( pxHandle, 0L, SEEK_END );
+        ulSizeOfLoggingFile = ftell( pxHandle );
+        fclose( pxHandle );
+    }
+    else
+    {
+        ulSizeOfLoggingFile = 0ul;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvLogToFile( const char * pcMessage,
+                          size_t xLength )
+{
+    char cOldName[ 64 ], cNewName[ 64 ];
+    int iFile;
+
+    if( pxLoggingFileHandle == NULL )
+    {
+        pxLoggingFileHandle = fopen( pcLogFileName, "a" );
+    }
+
+    if( pxLoggingFileHandle != NULL )
+    {
+        fwrite( pcMessage, 1, xLength, pxLoggingFileHandle );
+        ulSizeOfLoggingFile += xLength;
+
+        /* If the file has grown to its maximum permissible size then close it
+         * and shift the names of the full files up by one, dropping the
+         * oldest - then start with a new file. */
+        if( ulSizeOfLoggingFile > ( size_t ) dlLOGGING_FILE_SIZE )
+        {
+            fclose( pxLoggingFileHandle );
+            pxLoggingFileHandle = NULL;
+
+            for( iFile = dlLOGGING_FILE_COUNT - 1; iFile > 0; iFile-- )
+            {
+                ( void ) snprintf( cOldName, sizeof( cOldName ), "%s.%d", pcLogFileName, iFile );
+                ( void ) snprintf( cNewName, sizeof( cNewName ), "%s.%d", pcLogFileName, iFile + 1 );
+                ( void ) rename( cOldName, cNewName );
+            }
+
+            ( void ) snprintf( cNewName, sizeof( cNewName ), "%s.1", pcLogFileName );
+            ( void ) rename( pcLogFileName, cNewName );
+            ulSizeOfLoggingFile = 0;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vPlatformInitLogging( void )
+{
+    vLoggingInit( pdTRUE, pdFALSE, pdFALSE, 0U, 0U );
+}
+/*-----------------------------------------------------------*/
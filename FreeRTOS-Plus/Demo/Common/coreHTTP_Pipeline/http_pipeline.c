@@ -0,0 +1,233 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file http_pipeline.c
+ * @brief Pipelined HTTP range requests. See http_pipeline.h.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Header include. */
+#include "http_pipeline.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send function given to coreHTTP. The request has already been
+ * written by xHTTPPipeline_Send(), so nothing is sent.
+ */
+static int32_t prvShimSend( NetworkContext_t * pxNetworkContext,
+                            const void * pvBuffer,
+                            size_t xBytesToSend );
+
+/**
+ * @brief Receive function given to coreHTTP. Returns the bytes carried over
+ * from the previous response before reading from the connection.
+ */
+static int32_t prvShimRecv( NetworkContext_t * pxNetworkContext,
+                            void * pvBuffer,
+                            size_t xBytesToRecv );
+
+/**
+ * @brief Write the headers of a GET request for a range to the request
+ * buffer of the pipeline.
+ */
+static HTTPStatus_t prvSerializeRequest( HTTPPipeline_t * pxPipeline,
+                                         size_t xRangeStart,
+                                         size_t xRangeEnd,
+                                         HTTPRequestHeaders_t * pxHeaders );
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvShimSend( NetworkContext_t * pxNetworkContext,
+                            const void * pvBuffer,
+                            size_t xBytesToSend )
+{
+    ( void ) pxNetworkContext;
+    ( void ) pvBuffer;
+
+    return ( int32_t ) xBytesToSend;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvShimRecv( NetworkContext_t * pxNetworkContext,
+                            void * pvBuffer,
+                            size_t xBytesToRecv )
+{
+    /* coreHTTP does not look into the network context, so the shim is given
+     * the pipeline in its place. */
+    HTTPPipeline_t * pxPipeline = ( HTTPPipeline_t * ) pxNetworkContext;
+    int32_t lBytesReceived;
+    size_t xCopyLength;
+
+    if( pxPipeline->xCarryLength > 0U )
+    {
+        xCopyLength = ( xBytesToRecv < pxPipeline->xCarryLength ) ? xBytesToRecv : pxPipeline->xCarryLength;
+
+        /* The carried bytes are further into the response buffer than the
+         * place coreHTTP reads to, so the areas may overlap. */
+        memmove( pvBuffer, pxPipeline->pucCarry, xCopyLength );
+        pxPipeline->pucCarry += xCopyLength;
+        pxPipeline->xCarryLength -= xCopyLength;
+        lBytesReceived = ( int32_t ) xCopyLength;
+    }
+    else
+    {
+        lBytesReceived = pxPipeline->xTransport.recv( pxPipeline->xTransport.pNetworkContext,
+                                                      pvBuffer,
+                                                      xBytesToRecv );
+    }
+
+    if( lBytesReceived > 0 )
+    {
+        pxPipeline->xReceived += ( size_t ) lBytesReceived;
+    }
+
+    return lBytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t prvSerializeRequest( HTTPPipeline_t * pxPipeline,
+                                         size_t xRangeStart,
+                                         size_t xRangeEnd,
+                                         HTTPRequestHeaders_t * pxHeaders )
+{
+    HTTPRequestInfo_t xRequestInfo;
+    HTTPStatus_t xHTTPStatus;
+
+    ( void ) memset( &xRequestInfo, 0, sizeof( xRequestInfo ) );
+    xRequestInfo.pHost = pxPipeline->pcHost;
+    xRequestInfo.hostLen = pxPipeline->xHostLength;
+    xRequestInfo.pMethod = HTTP_METHOD_GET;
+    xRequestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
+    xRequestInfo.pPath = pxPipeline->pcPath;
+    xRequestInfo.pathLen = pxPipeline->xPathLength;
+    xRequestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    ( void ) memset( pxHeaders, 0, sizeof( HTTPRequestHeaders_t ) );
+    pxHeaders->pBuffer = pxPipeline->pucRequestBuffer;
+    pxHeaders->bufferLen = pxPipeline->xRequestBufferLength;
+
+    xHTTPStatus = HTTPClient_InitializeRequestHeaders( pxHeaders, &xRequestInfo );
+
+    if( xHTTPStatus == HTTPSuccess )
+    {
+        xHTTPStatus = HTTPClient_AddRangeHeader( pxHeaders,
+                                                 ( int32_t ) xRangeStart,
+                                                 ( int32_t ) xRangeEnd );
+    }
+
+    return xHTTPStatus;
+}
+/*-----------------------------------------------------------*/
+
+void vHTTPPipeline_Reset( HTTPPipeline_t * pxPipeline )
+{
+    pxPipeline->pucCarry = NULL;
+    pxPipeline->xCarryLength = 0U;
+    pxPipeline->xReceived = 0U;
+}
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t xHTTPPipeline_Send( HTTPPipeline_t * pxPipeline,
+                                 size_t xRangeStart,
+                                 size_t xRangeEnd )
+{
+    HTTPRequestHeaders_t xHeaders;
+    HTTPStatus_t xHTTPStatus;
+    size_t xSent;
+    int32_t lBytesSent;
+
+    xHTTPStatus = prvSerializeRequest( pxPipeline, xRangeStart, xRangeEnd, &xHeaders );
+
+    for( xSent = 0U; ( xHTTPStatus == HTTPSuccess ) && ( xSent < xHeaders.headersLen ); xSent += ( size_t ) lBytesSent )
+    {
+        lBytesSent = pxPipeline->xTransport.send( pxPipeline->xTransport.pNetworkContext,
+                                                  &( xHeaders.pBuffer[ xSent ] ),
+                                                  xHeaders.headersLen - xSent );
+
+        if( lBytesSent <= 0 )
+        {
+            xHTTPStatus = HTTPNetworkError;
+        }
+    }
+
+    return xHTTPStatus;
+}
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t xHTTPPipeline_Receive( HTTPPipeline_t * pxPipeline,
+                                    size_t xRangeStart,
+                                    size_t xRangeEnd,
+                                    HTTPResponse_t * pxResponse )
+{
+    TransportInterface_t xShimTransport;
+    HTTPRequestHeaders_t xHeaders;
+    HTTPStatus_t xHTTPStatus;
+    size_t xConsumed;
+
+    ( void ) memset( &xShimTransport, 0, sizeof( xShimTransport ) );
+    xShimTransport.pNetworkContext = ( NetworkContext_t * ) pxPipeline;
+    xShimTransport.send = prvShimSend;
+    xShimTransport.recv = prvShimRecv;
+
+    /* coreHTTP checks the request before it reads the response, so it is
+     * given the request again, but the shim does not send it. */
+    xHTTPStatus = prvSerializeRequest( pxPipeline, xRangeStart, xRangeEnd, &xHeaders );
+
+    if( xHTTPStatus == HTTPSuccess )
+    {
+        ( void ) memset( pxResponse, 0, sizeof( HTTPResponse_t ) );
+        pxResponse->pBuffer = pxPipeline->pucResponseBuffer;
+        pxResponse->bufferLen = pxPipeline->xResponseBufferLength;
+        pxPipeline->xReceived = 0U;
+
+        xHTTPStatus = HTTPClient_Send( &xShimTransport,
+                                       &xHeaders,
+                                       NULL,
+                                       0,
+                                       pxResponse,
+                                       0 );
+    }
+
+    if( xHTTPStatus == HTTPSuccess )
+    {
+        /* coreHTTP stops at the end of the response. Anything read past it
+         * belongs to the next response, and is still in the buffer. */
+        xConsumed = ( size_t ) ( ( pxResponse->pBody + pxResponse->bodyLen ) - pxResponse->pBuffer );
+
+        if( pxPipeline->xReceived > xConsumed )
+        {
+            pxPipeline->pucCarry = &( pxPipeline->pucResponseBuffer[ xConsumed ] );
+            pxPipeline->xCarryLength = pxPipeline->xReceived - xConsumed;
+        }
+    }
+
+    return xHTTPStatus;
+}
+/*-----------------------------------------------------------*/
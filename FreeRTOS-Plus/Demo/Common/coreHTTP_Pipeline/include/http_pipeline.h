@@ -0,0 +1,119 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file http_pipeline.h
+ * @brief Pipelined HTTP range requests on one keep-alive connection.
+ *
+ * xHTTPPipeline_Send() writes a GET request for a range without waiting for
+ * the responses to the requests written before it. xHTTPPipeline_Receive()
+ * then reads the responses with coreHTTP, oldest first. As HTTPClient_Send()
+ * writes a request before reading its response, it is given a transport shim
+ * that discards the request, which was already written, and that returns the
+ * bytes of the next response read together with the previous one before
+ * reading from the connection.
+ *
+ * The caller keeps the ranges in flight, in the order they were sent.
+ */
+
+#ifndef HTTP_PIPELINE_H
+#define HTTP_PIPELINE_H
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/**
+ * @brief A pipelined connection.
+ *
+ * The caller sets the public members, then calls vHTTPPipeline_Reset()
+ * before the first request. The other members are private to
+ * http_pipeline.c.
+ */
+typedef struct HTTPPipeline
+{
+    TransportInterface_t xTransport; /**< @brief The connection the requests are sent on. */
+    const char * pcHost;             /**< @brief Host to send the requests to. */
+    size_t xHostLength;              /**< @brief Length of pcHost. */
+    const char * pcPath;             /**< @brief Path, including any query, of the file. */
+    size_t xPathLength;              /**< @brief Length of pcPath. */
+    uint8_t * pucRequestBuffer;      /**< @brief Holds the headers of one request. */
+    size_t xRequestBufferLength;
+    uint8_t * pucResponseBuffer;     /**< @brief Holds one response, headers included. */
+    size_t xResponseBufferLength;
+
+    const uint8_t * pucCarry;        /**< @brief Bytes of the next response read with the previous one. */
+    size_t xCarryLength;
+    size_t xReceived;                /**< @brief Bytes handed to coreHTTP for the current response. */
+} HTTPPipeline_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Forget the bytes carried over from the last response. Call before
+ * the first request, and whenever the connection is re-established, as the
+ * requests in flight are lost with it.
+ *
+ * @param[in] pxPipeline The pipeline.
+ */
+void vHTTPPipeline_Reset( HTTPPipeline_t * pxPipeline );
+
+/**
+ * @brief Write a GET request for a range, without reading any response.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[in] xRangeStart First byte of the range.
+ * @param[in] xRangeEnd Last byte of the range.
+ *
+ * @return HTTPSuccess if the whole request was written; HTTPNetworkError if
+ * the transport failed; the error of coreHTTP if the request could not be
+ * serialized.
+ */
+HTTPStatus_t xHTTPPipeline_Send( HTTPPipeline_t * pxPipeline,
+                                 size_t xRangeStart,
+                                 size_t xRangeEnd );
+
+/**
+ * @brief Read the response to the oldest request in flight.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[in] xRangeStart First byte of the range of the oldest request.
+ * @param[in] xRangeEnd Last byte of the range of the oldest request.
+ * @param[out] pxResponse The response, in the response buffer of the
+ * pipeline. Valid until the next call.
+ *
+ * @return The status returned by HTTPClient_Send(). After an error, where
+ * the next response starts is not known, so the connection should be closed.
+ */
+HTTPStatus_t xHTTPPipeline_Receive( HTTPPipeline_t * pxPipeline,
+                                    size_t xRangeStart,
+                                    size_t xRangeEnd,
+                                    HTTPResponse_t * pxResponse );
+
+#endif /* ifndef HTTP_PIPELINE_H */
@@ -0,0 +1,766 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file freertos_agent_message_mpsc.c
+ * @brief Implements the agent message interface with a lock-free
+ * multi-producer, single-consumer ring.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "atomic.h"
+
+/* Header include. */
+#include "freertos_agent_message_mpsc.h"
+#include "core_mqtt_agent_message_interface.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Index of the task notification used to wake the agent task when a
+ * command is sent to an empty ring.
+ */
+#ifndef agentMESSAGE_NOTIFICATION_INDEX
+    #define agentMESSAGE_NOTIFICATION_INDEX    ( 0U )
+#endif
+
+/**
+ * @brief Index of the task notification used to wake a task blocked in
+ * Agent_MessageSend() on a full ring.
+ *
+ * @note Tasks sending commands often wait for command completion on index 0,
+ * so this needs a separate index.
+ */
+#ifndef agentMESSAGE_PRODUCER_NOTIFICATION_INDEX
+    #define agentMESSAGE_PRODUCER_NOTIFICATION_INDEX    ( 1U )
+#endif
+
+#if ( agentMESSAGE_PRODUCER_NOTIFICATION_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES )
+    #error "configTASK_NOTIFICATION_ARRAY_ENTRIES must be larger than agentMESSAGE_PRODUCER_NOTIFICATION_INDEX."
+#endif
+
+/**
+ * @brief A task blocked in Agent_MessageSend() because the ring is full.
+ * Lives on the stack of that task.
+ */
+typedef struct AgentMessageWaiter
+{
+    TaskHandle_t task;
+    struct AgentMessageWaiter * pNext;
+} AgentMessageWaiter_t;
+
+/**
+ * @brief Message contexts that coalesce sends, searched by network context in
+ * Agent_MessageCoalescingSend().
+ */
+static MQTTAgentMessageContext_t * pCoalescingContexts = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Claim a slot and store a command in it. Safe to call from any number
+ * of tasks at once.
+ *
+ * @return `true` if the command was stored, `false` if the ring is full.
+ */
+static bool enqueueCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t * pCommand );
+
+/**
+ * @brief Take the oldest command from the ring. Must only be called by the
+ * agent task.
+ *
+ * @return `true` if a command was taken, `false` if the ring is empty.
+ */
+static bool dequeueCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t ** ppCommand );
+
+/**
+ * @brief Check, without taking it, whether a command is waiting in the ring.
+ * Gives an exact answer only when called by the agent task.
+ */
+static bool commandWaiting( const MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Add a task to the end of the list of tasks waiting for a free slot.
+ */
+static void addWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageWaiter_t * pWaiter );
+
+/**
+ * @brief Remove a task from the list of tasks waiting for a free slot, if it
+ * is still in it.
+ */
+static void removeWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx,
+                                   AgentMessageWaiter_t * pWaiter );
+
+/**
+ * @brief Wake the task that has waited longest for a free slot.
+ */
+static void wakeWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Take the oldest command from the ring, blocking for up to
+ * ticksToWait if the ring is empty, and update the send coalescing state for
+ * the command taken.
+ */
+static bool receiveCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t ** ppCommand,
+                            TickType_t ticksToWait );
+
+/**
+ * @brief Write the coalescing buffer to the network.
+ */
+static void flushCoalescedSends( MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Write the coalescing buffer to the network if it has been held for
+ * the flush latency, and stop coalescing once it is empty.
+ *
+ * @return The number of ticks the buffered data may still be held, or
+ * portMAX_DELAY if nothing is buffered.
+ */
+static TickType_t flushIfDue( MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Whether the coalesced data may stay buffered while the agent goes on
+ * working. With a flush latency, no byte is held longer than the latency.
+ * Without one, data is only held while more commands are queued to send with
+ * it.
+ */
+static bool holdCoalescedSends( const MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Find the message context that coalesces the sends to a network
+ * context.
+ */
+static MQTTAgentMessageContext_t * findCoalescingContext( const NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static bool enqueueCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t * pCommand )
+{
+    AgentMessageSlot_t * pSlot = NULL;
+    uint32_t position = pMsgCtx->enqueuePosition;
+    int32_t difference = 0;
+    bool enqueued = false;
+    bool full = false;
+
+    while( ( enqueued == false ) && ( full == false ) )
+    {
+        pSlot = &( pMsgCtx->pSlots[ position & pMsgCtx->mask ] );
+        difference = ( int32_t ) ( pSlot->sequence - position );
+
+        if( difference == 0 )
+        {
+            /* The slot is free. Claim it by moving the enqueue position past
+             * it, unless another producer got there first. */
+            if( Atomic_CompareAndSwap_u32( &( pMsgCtx->enqueuePosition ),
+                                           position + 1U,
+                                           position ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+            {
+                pSlot->pCommand = pCommand;
+
+                /* Publish the command to the consumer. */
+                portMEMORY_BARRIER();
+                pSlot->sequence = position + 1U;
+                enqueued = true;
+            }
+            else
+            {
+                position = pMsgCtx->enqueuePosition;
+            }
+        }
+        else if( difference < 0 )
+        {
+            /* The slot still holds a command from the previous lap. */
+            full = true;
+        }
+        else
+        {
+            /* Another producer claimed the slot. */
+            position = pMsgCtx->enqueuePosition;
+        }
+    }
+
+    return enqueued;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool dequeueCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t ** ppCommand )
+{
+    uint32_t position = pMsgCtx->dequeuePosition;
+    AgentMessageSlot_t * pSlot = &( pMsgCtx->pSlots[ position & pMsgCtx->mask ] );
+    bool dequeued = false;
+
+    if( pSlot->sequence == ( position + 1U ) )
+    {
+        portMEMORY_BARRIER();
+        *ppCommand = pSlot->pCommand;
+        pSlot->pCommand = NULL;
+
+        /* Hand the slot back to the producers for the next lap. */
+        portMEMORY_BARRIER();
+        pSlot->sequence = position + pMsgCtx->mask + 1U;
+        pMsgCtx->dequeuePosition = position + 1U;
+        dequeued = true;
+
+        if( pMsgCtx->pWaitingProducers != NULL )
+        {
+            wakeWaitingProducer( pMsgCtx );
+        }
+    }
+
+    return dequeued;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool commandWaiting( const MQTTAgentMessageContext_t * pMsgCtx )
+{
+    uint32_t position = pMsgCtx->dequeuePosition;
+
+    return( pMsgCtx->pSlots[ position & pMsgCtx->mask ].sequence == ( position + 1U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void addWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx,
+                                AgentMessageWaiter_t * pWaiter )
+{
+    AgentMessageWaiter_t ** ppLink = NULL;
+
+    pWaiter->task = xTaskGetCurrentTaskHandle();
+    pWaiter->pNext = NULL;
+
+    taskENTER_CRITICAL();
+    {
+        ppLink = &( pMsgCtx->pWaitingProducers );
+
+        while( *ppLink != NULL )
+        {
+            ppLink = &( ( *ppLink )->pNext );
+        }
+
+        *ppLink = pWaiter;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx,
+                                   AgentMessageWaiter_t * pWaiter )
+{
+    AgentMessageWaiter_t ** ppLink = NULL;
+
+    taskENTER_CRITICAL();
+    {
+        ppLink = &( pMsgCtx->pWaitingProducers );
+
+        while( ( *ppLink != NULL ) && ( *ppLink != pWaiter ) )
+        {
+            ppLink = &( ( *ppLink )->pNext );
+        }
+
+        if( *ppLink != NULL )
+        {
+            *ppLink = pWaiter->pNext;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void wakeWaitingProducer( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    TaskHandle_t task = NULL;
+
+    taskENTER_CRITICAL();
+    {
+        /* The waiter lives on the stack of its task, so take the handle before
+         * that task can leave Agent_MessageSend(). */
+        if( pMsgCtx->pWaitingProducers != NULL )
+        {
+            task = pMsgCtx->pWaitingProducers->task;
+            pMsgCtx->pWaitingProducers = pMsgCtx->pWaitingProducers->pNext;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    /* If the task has stopped waiting, this only causes a spurious wake up of
+     * its next wait for a free slot. */
+    if( task != NULL )
+    {
+        ( void ) xTaskNotifyGiveIndexed( task, agentMESSAGE_PRODUCER_NOTIFICATION_INDEX );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveCommand( MQTTAgentMessageContext_t * pMsgCtx,
+                            MQTTAgentCommand_t ** ppCommand,
+                            TickType_t ticksToWait )
+{
+    TimeOut_t timeOut;
+    TickType_t holdTicks;
+    TickType_t waitTicks;
+    bool received = false;
+
+    received = dequeueCommand( pMsgCtx, ppCommand );
+
+    if( received == false )
+    {
+        /* The agent has caught up. What was coalesced is written out now, or
+         * held for up to the flush latency in case more publishes follow. */
+        holdTicks = flushIfDue( pMsgCtx );
+
+        vTaskSetTimeOutState( &timeOut );
+        pMsgCtx->consumerTask = xTaskGetCurrentTaskHandle();
+
+        while( ( received == false ) && ( ticksToWait > 0U ) )
+        {
+            waitTicks = ( holdTicks < ticksToWait ) ? holdTicks : ticksToWait;
+
+            /* Announce that the agent is about to block, then check the ring
+             * again so that a command sent in between is not missed. */
+            pMsgCtx->consumerWaiting = 1U;
+            portMEMORY_BARRIER();
+            received = dequeueCommand( pMsgCtx, ppCommand );
+
+            if( received == false )
+            {
+                ( void ) ulTaskNotifyTakeIndexed( agentMESSAGE_NOTIFICATION_INDEX, pdTRUE, waitTicks );
+                received = dequeueCommand( pMsgCtx, ppCommand );
+            }
+
+            /* A notification sent after this point finds the flag clear and
+             * only causes a spurious wake up of the next wait. */
+            pMsgCtx->consumerWaiting = 0U;
+
+            if( xTaskCheckForTimeOut( &timeOut, &ticksToWait ) != pdFALSE )
+            {
+                ticksToWait = 0U;
+            }
+
+            if( received == false )
+            {
+                holdTicks = flushIfDue( pMsgCtx );
+            }
+        }
+    }
+
+    if( ( received == true ) && ( pMsgCtx->pCoalesceBuffer != NULL ) )
+    {
+        /* A PUBLISH is only held back when there is another command to send
+         * with it, or a flush latency to wait for one. */
+        if( ( ( *ppCommand )->commandType == PUBLISH ) &&
+            ( ( commandWaiting( pMsgCtx ) == true ) || ( pMsgCtx->flushLatencyTicks > 0U ) ) )
+        {
+            pMsgCtx->coalescing = true;
+        }
+        else
+        {
+            flushCoalescedSends( pMsgCtx );
+            pMsgCtx->coalescing = false;
+        }
+    }
+
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+static void flushCoalescedSends( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    size_t bytesSent = 0;
+    int32_t sendResult = 0;
+
+    while( bytesSent < pMsgCtx->coalesceLength )
+    {
+        sendResult = pMsgCtx->transportSend( pMsgCtx->pNetworkContext,
+                                             &( pMsgCtx->pCoalesceBuffer[ bytesSent ] ),
+                                             pMsgCtx->coalesceLength - bytesSent );
+
+        if( sendResult <= 0 )
+        {
+            LogError( ( "Failed to send %u coalesced bytes. Transport send returned %d.",
+                        ( unsigned int ) ( pMsgCtx->coalesceLength - bytesSent ),
+                        ( int ) sendResult ) );
+            pMsgCtx->pendingSendError = ( sendResult < 0 ) ? sendResult : -1;
+            break;
+        }
+
+        bytesSent += ( size_t ) sendResult;
+    }
+
+    pMsgCtx->coalesceLength = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static TickType_t flushIfDue( MQTTAgentMessageContext_t * pMsgCtx )
+{
+    TickType_t holdTicks = portMAX_DELAY;
+    TickType_t heldTicks = 0U;
+
+    if( pMsgCtx->coalesceLength > 0U )
+    {
+        heldTicks = xTaskGetTickCount() - pMsgCtx->coalesceStartTick;
+
+        if( heldTicks < pMsgCtx->flushLatencyTicks )
+        {
+            holdTicks = pMsgCtx->flushLatencyTicks - heldTicks;
+        }
+        else
+        {
+            flushCoalescedSends( pMsgCtx );
+        }
+    }
+
+    if( pMsgCtx->coalesceLength == 0U )
+    {
+        pMsgCtx->coalescing = false;
+    }
+
+    return holdTicks;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool holdCoalescedSends( const MQTTAgentMessageContext_t * pMsgCtx )
+{
+    bool hold = false;
+
+    if( pMsgCtx->flushLatencyTicks == 0U )
+    {
+        hold = commandWaiting( pMsgCtx );
+    }
+    else
+    {
+        hold = ( ( xTaskGetTickCount() - pMsgCtx->coalesceStartTick ) < pMsgCtx->flushLatencyTicks );
+    }
+
+    return hold;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentMessageContext_t * findCoalescingContext( const NetworkContext_t * pNetworkContext )
+{
+    MQTTAgentMessageContext_t * pMsgCtx = pCoalescingContexts;
+
+    while( ( pMsgCtx != NULL ) && ( pMsgCtx->pNetworkContext != pNetworkContext ) )
+    {
+        pMsgCtx = pMsgCtx->pNextCoalescing;
+    }
+
+    configASSERT( pMsgCtx != NULL );
+
+    return pMsgCtx;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MessageInit( MQTTAgentMessageContext_t * pMsgCtx,
+                        AgentMessageSlot_t * pSlots,
+                        uint32_t slotCount )
+{
+    uint32_t i;
+
+    configASSERT( ( pMsgCtx != NULL ) && ( pSlots != NULL ) );
+
+    /* The slot index is taken from the position with a mask. */
+    configASSERT( ( slotCount > 0U ) && ( ( slotCount & ( slotCount - 1U ) ) == 0U ) );
+
+    ( void ) memset( pMsgCtx, 0x00, sizeof( MQTTAgentMessageContext_t ) );
+
+    for( i = 0; i < slotCount; i++ )
+    {
+        pSlots[ i ].sequence = i;
+        pSlots[ i ].pCommand = NULL;
+    }
+
+    pMsgCtx->pSlots = pSlots;
+    pMsgCtx->mask = slotCount - 1U;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageSend( const MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t * const * pCommandToSend,
+                        uint32_t blockTimeMs )
+{
+    MQTTAgentMessageContext_t * pContext = ( MQTTAgentMessageContext_t * ) pMsgCtx;
+    AgentMessageWaiter_t waiter;
+    TimeOut_t timeOut;
+    TickType_t ticksToWait = pdMS_TO_TICKS( blockTimeMs );
+    bool sent = false;
+
+    if( ( pContext != NULL ) && ( pCommandToSend != NULL ) )
+    {
+        vTaskSetTimeOutState( &timeOut );
+        sent = enqueueCommand( pContext, *pCommandToSend );
+
+        while( ( sent == false ) && ( xTaskCheckForTimeOut( &timeOut, &ticksToWait ) == pdFALSE ) )
+        {
+            /* Join the waiting list, then try again so that a slot freed in
+             * between is not missed. */
+            addWaitingProducer( pContext, &waiter );
+            sent = enqueueCommand( pContext, *pCommandToSend );
+
+            if( sent == false )
+            {
+                ( void ) ulTaskNotifyTakeIndexed( agentMESSAGE_PRODUCER_NOTIFICATION_INDEX, pdTRUE, ticksToWait );
+            }
+
+            removeWaitingProducer( pContext, &waiter );
+
+            if( sent == false )
+            {
+                sent = enqueueCommand( pContext, *pCommandToSend );
+            }
+        }
+
+        /* Only enter the kernel if the agent is blocked waiting for a command. */
+        if( ( sent == true ) &&
+            ( Atomic_CompareAndSwap_u32( &( pContext->consumerWaiting ), 0U, 1U ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS ) )
+        {
+            ( void ) xTaskNotifyGiveIndexed( pContext->consumerTask, agentMESSAGE_NOTIFICATION_INDEX );
+        }
+    }
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageReceive( const MQTTAgentMessageContext_t * pMsgCtx,
+                           MQTTAgentCommand_t ** pReceivedCommand,
+                           uint32_t blockTimeMs )
+{
+    bool received = false;
+
+    if( ( pMsgCtx != NULL ) && ( pReceivedCommand != NULL ) )
+    {
+        received = receiveCommand( ( MQTTAgentMessageContext_t * ) pMsgCtx,
+                                   pReceivedCommand,
+                                   pdMS_TO_TICKS( blockTimeMs ) );
+    }
+
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t Agent_MessageReceiveBatch( const MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pReceivedCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs )
+{
+    MQTTAgentMessageContext_t * pContext = ( MQTTAgentMessageContext_t * ) pMsgCtx;
+    size_t receivedCount = 0U;
+
+    if( ( pContext != NULL ) && ( pReceivedCommands != NULL ) && ( maxCommands > 0U ) )
+    {
+        if( receiveCommand( pContext, &( pReceivedCommands[ 0 ] ), pdMS_TO_TICKS( blockTimeMs ) ) == true )
+        {
+            receivedCount = 1U;
+
+            while( ( receivedCount < maxCommands ) &&
+                   ( receiveCommand( pContext, &( pReceivedCommands[ receivedCount ] ), 0U ) == true ) )
+            {
+                receivedCount++;
+            }
+        }
+    }
+
+    return receivedCount;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageCommandWaiting( const MQTTAgentMessageContext_t * pMsgCtx )
+{
+    bool waiting = false;
+
+    if( pMsgCtx != NULL )
+    {
+        waiting = commandWaiting( pMsgCtx );
+    }
+
+    return waiting;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MessageEnableSendCoalescing( MQTTAgentMessageContext_t * pMsgCtx,
+                                        TransportInterface_t * pTransportInterface,
+                                        uint8_t * pBuffer,
+                                        size_t bufferSize )
+{
+    configASSERT( ( pMsgCtx != NULL ) && ( pTransportInterface != NULL ) );
+    configASSERT( ( pBuffer != NULL ) && ( bufferSize > 0U ) );
+    configASSERT( pTransportInterface->send != Agent_MessageCoalescingSend );
+
+    pMsgCtx->pNetworkContext = pTransportInterface->pNetworkContext;
+    pMsgCtx->transportSend = pTransportInterface->send;
+    pMsgCtx->transportRecv = pTransportInterface->recv;
+    pMsgCtx->pCoalesceBuffer = pBuffer;
+    pMsgCtx->coalesceBufferSize = bufferSize;
+    pMsgCtx->coalesceLength = 0U;
+    pMsgCtx->flushLatencyTicks = 0U;
+    pMsgCtx->flushThreshold = bufferSize;
+    pMsgCtx->pendingSendError = 0;
+    pMsgCtx->coalescing = false;
+
+    pMsgCtx->pNextCoalescing = pCoalescingContexts;
+    pCoalescingContexts = pMsgCtx;
+
+    pTransportInterface->send = Agent_MessageCoalescingSend;
+    pTransportInterface->recv = Agent_MessageCoalescingRecv;
+    pTransportInterface->writev = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MessageSetCoalescingLimits( MQTTAgentMessageContext_t * pMsgCtx,
+                                       uint32_t flushLatencyMs,
+                                       size_t flushThresholdBytes )
+{
+    configASSERT( ( pMsgCtx != NULL ) && ( pMsgCtx->pCoalesceBuffer != NULL ) );
+    configASSERT( ( flushThresholdBytes > 0U ) && ( flushThresholdBytes <= pMsgCtx->coalesceBufferSize ) );
+
+    pMsgCtx->flushLatencyTicks = pdMS_TO_TICKS( flushLatencyMs );
+    pMsgCtx->flushThreshold = flushThresholdBytes;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t Agent_MessageCoalescingSend( NetworkContext_t * pNetworkContext,
+                                     const void * pBuffer,
+                                     size_t bytesToSend )
+{
+    MQTTAgentMessageContext_t * pMsgCtx = findCoalescingContext( pNetworkContext );
+    int32_t sendResult = 0;
+
+    if( pMsgCtx->pendingSendError != 0 )
+    {
+        /* Report the failure of an earlier coalesced send. */
+        sendResult = pMsgCtx->pendingSendError;
+        pMsgCtx->pendingSendError = 0;
+    }
+    else
+    {
+        /* Write out what is held if this send does not fit with it, or if it
+         * has been held for as long as it may be. */
+        if( ( bytesToSend > ( pMsgCtx->coalesceBufferSize - pMsgCtx->coalesceLength ) ) ||
+            ( ( pMsgCtx->coalesceLength > 0U ) && ( holdCoalescedSends( pMsgCtx ) == false ) ) )
+        {
+            flushCoalescedSends( pMsgCtx );
+        }
+
+        if( pMsgCtx->pendingSendError != 0 )
+        {
+            sendResult = pMsgCtx->pendingSendError;
+            pMsgCtx->pendingSendError = 0;
+        }
+        else if( ( pMsgCtx->coalescing == true ) && ( bytesToSend <= pMsgCtx->coalesceBufferSize ) )
+        {
+            if( pMsgCtx->coalesceLength == 0U )
+            {
+                /* The flush latency counts from the oldest byte held. */
+                pMsgCtx->coalesceStartTick = xTaskGetTickCount();
+            }
+
+            ( void ) memcpy( &( pMsgCtx->pCoalesceBuffer[ pMsgCtx->coalesceLength ] ), pBuffer, bytesToSend );
+            pMsgCtx->coalesceLength += bytesToSend;
+            sendResult = ( int32_t ) bytesToSend;
+
+            if( pMsgCtx->coalesceLength >= pMsgCtx->flushThreshold )
+            {
+                /* Any error is reported by the next call. */
+                flushCoalescedSends( pMsgCtx );
+            }
+        }
+        else
+        {
+            /* Nothing is buffered at this point, as coalescing stops with a
+             * flush and data larger than the buffer caused one above. */
+            sendResult = pMsgCtx->transportSend( pNetworkContext, pBuffer, bytesToSend );
+        }
+    }
+
+    return sendResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t Agent_MessageCoalescingRecv( NetworkContext_t * pNetworkContext,
+                                     void * pBuffer,
+                                     size_t bytesToRecv )
+{
+    MQTTAgentMessageContext_t * pMsgCtx = findCoalescingContext( pNetworkContext );
+    int32_t recvResult = 0;
+
+    if( ( pMsgCtx->coalesceLength > 0U ) && ( holdCoalescedSends( pMsgCtx ) == true ) )
+    {
+        /* This is the process loop of a PUBLISH whose packets are held back.
+         * Report no data rather than block in the read, so the agent returns
+         * to the ring and writes them out within the flush latency, or once
+         * the queued commands have been sent. */
+        recvResult = 0;
+    }
+    else
+    {
+        /* Write out anything held back before the read can block. */
+        flushCoalescedSends( pMsgCtx );
+
+        if( pMsgCtx->pendingSendError != 0 )
+        {
+            recvResult = pMsgCtx->pendingSendError;
+            pMsgCtx->pendingSendError = 0;
+        }
+        else
+        {
+            recvResult = pMsgCtx->transportRecv( pNetworkContext, pBuffer, bytesToRecv );
+        }
+    }
+
+    return recvResult;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,480 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file freertos_agent_multiplex.c
+ * @brief Implements servicing several MQTT agent contexts from one task.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "atomic.h"
+
+/* Header include. */
+#include "freertos_agent_multiplex.h"
+#include "core_mqtt_agent_command_functions.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Index of the task notification used to wake the multiplexing task.
+ */
+#ifndef agentMULTIPLEX_NOTIFICATION_INDEX
+    #define agentMULTIPLEX_NOTIFICATION_INDEX    ( 0U )
+#endif
+
+/**
+ * @brief Bits of MultiplexConnection_t::events.
+ */
+#define agentMULTIPLEX_EVENT_COMMAND     ( 1UL << 0 )
+#define agentMULTIPLEX_EVENT_READABLE    ( 1UL << 1 )
+
+/**
+ * @brief A context serviced by the multiplexing task, and the message
+ * interface and transport receive functions it was initialized with.
+ */
+typedef struct MultiplexConnection
+{
+    MQTTAgentContext_t * pAgentContext;
+    MQTTAgentMessageSend_t send;
+    MQTTAgentMessageRecv_t recv;
+    TransportRecv_t transportRecv;
+    volatile uint32_t events;   /**< @brief agentMULTIPLEX_EVENT_* bits not yet serviced. */
+    TickType_t lastServiceTick; /**< @brief When the command loop of the connection last ran. */
+} MultiplexConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the connection whose message interface uses a message context.
+ */
+static MultiplexConnection_t * findConnection( const MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Record an event for a connection and wake the multiplexing task.
+ */
+static void signalConnection( MultiplexConnection_t * pConnection,
+                              uint32_t event );
+
+/**
+ * @brief Send a command with the original function, then wake the
+ * multiplexing task.
+ */
+static bool multiplexMessageSend( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t * const * pCommandToSend,
+                                  uint32_t blockTimeMs );
+
+/**
+ * @brief Receive a command with the original function without blocking.
+ * Once the connection has had its share of commands for this pass, report
+ * none so that its command loop yields.
+ */
+static bool multiplexMessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
+                                     MQTTAgentCommand_t ** pReceivedCommand,
+                                     uint32_t blockTimeMs );
+
+/**
+ * @brief Read with the original transport function.  While reads return data
+ * the connection is kept readable, so that it is serviced again until the
+ * socket is drained.
+ */
+static int32_t multiplexTransportRecv( NetworkContext_t * pNetworkContext,
+                                       void * pBuffer,
+                                       size_t bytesToRecv );
+
+/**
+ * @brief Run the command loop of a connection until it yields or ends.
+ *
+ * @return `true` if the command loop ended, in which case the connection has
+ * been removed and *ppEndedContext and *pStatus are set.
+ */
+static bool serviceConnection( MultiplexConnection_t * pConnection,
+                               MQTTAgentContext_t ** ppEndedContext,
+                               MQTTStatus_t * pStatus );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The serviced contexts.  Unused entries have a NULL agent context.
+ */
+static MultiplexConnection_t connections[ MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS ];
+
+/**
+ * @brief The task running Agent_MultiplexCommandLoop(), or NULL.
+ */
+static TaskHandle_t multiplexTask = NULL;
+
+/**
+ * @brief The connection whose command loop is running, or NULL.
+ */
+static MultiplexConnection_t * pActiveConnection = NULL;
+
+/**
+ * @brief Commands the active connection has received during this pass.
+ */
+static uint32_t commandsThisPass = 0U;
+
+/**
+ * @brief Set by Agent_MultiplexIdleCommand() when it ends the command loop of
+ * the active connection, as opposed to a disconnect, MQTTAgent_Terminate() or
+ * an error ending it.
+ */
+static bool yielded = false;
+
+/*-----------------------------------------------------------*/
+
+static MultiplexConnection_t * findConnection( const MQTTAgentMessageContext_t * pMsgCtx )
+{
+    MultiplexConnection_t * pConnection = NULL;
+    size_t i;
+
+    for( i = 0U; i < MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS; i++ )
+    {
+        if( ( connections[ i ].pAgentContext != NULL ) &&
+            ( connections[ i ].pAgentContext->agentInterface.pMsgCtx == pMsgCtx ) )
+        {
+            pConnection = &( connections[ i ] );
+            break;
+        }
+    }
+
+    return pConnection;
+}
+
+/*-----------------------------------------------------------*/
+
+static void signalConnection( MultiplexConnection_t * pConnection,
+                              uint32_t event )
+{
+    TaskHandle_t task = multiplexTask;
+
+    ( void ) Atomic_OR_u32( &( pConnection->events ), event );
+
+    if( task != NULL )
+    {
+        ( void ) xTaskNotifyGiveIndexed( task, agentMULTIPLEX_NOTIFICATION_INDEX );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool multiplexMessageSend( MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t * const * pCommandToSend,
+                                  uint32_t blockTimeMs )
+{
+    MultiplexConnection_t * pConnection = findConnection( pMsgCtx );
+    bool sent = false;
+
+    configASSERT( pConnection != NULL );
+
+    sent = pConnection->send( pMsgCtx, pCommandToSend, blockTimeMs );
+
+    if( sent == true )
+    {
+        signalConnection( pConnection, agentMULTIPLEX_EVENT_COMMAND );
+    }
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool multiplexMessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
+                                     MQTTAgentCommand_t ** pReceivedCommand,
+                                     uint32_t blockTimeMs )
+{
+    bool received = false;
+
+    /* The task blocks in Agent_MultiplexCommandLoop() instead. */
+    ( void ) blockTimeMs;
+
+    configASSERT( ( pActiveConnection != NULL ) &&
+                  ( pActiveConnection->pAgentContext->agentInterface.pMsgCtx == pMsgCtx ) );
+
+    if( commandsThisPass < MQTT_AGENT_MULTIPLEX_COMMANDS_PER_PASS )
+    {
+        received = pActiveConnection->recv( pMsgCtx, pReceivedCommand, 0U );
+
+        if( received == true )
+        {
+            commandsThisPass++;
+        }
+    }
+    else
+    {
+        /* Carry on with the rest of the commands on the next pass. */
+        ( void ) Atomic_OR_u32( &( pActiveConnection->events ), agentMULTIPLEX_EVENT_COMMAND );
+    }
+
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t multiplexTransportRecv( NetworkContext_t * pNetworkContext,
+                                       void * pBuffer,
+                                       size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+
+    /* Only the multiplexing task reads, from within a command loop. */
+    configASSERT( ( pActiveConnection != NULL ) &&
+                  ( pActiveConnection->pAgentContext->mqttContext.transportInterface.pNetworkContext == pNetworkContext ) );
+
+    bytesReceived = pActiveConnection->transportRecv( pNetworkContext, pBuffer, bytesToRecv );
+
+    if( bytesReceived > 0 )
+    {
+        ( void ) Atomic_OR_u32( &( pActiveConnection->events ), agentMULTIPLEX_EVENT_READABLE );
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool serviceConnection( MultiplexConnection_t * pConnection,
+                               MQTTAgentContext_t ** ppEndedContext,
+                               MQTTStatus_t * pStatus )
+{
+    MQTTAgentContext_t * pAgentContext = pConnection->pAgentContext;
+    MQTTStatus_t status = MQTTSuccess;
+    bool loopEnded = false;
+
+    pActiveConnection = pConnection;
+    pConnection->lastServiceTick = xTaskGetTickCount();
+    commandsThisPass = 0U;
+    yielded = false;
+
+    /* Returns through Agent_MultiplexIdleCommand() once the connection has
+     * nothing more to do for now. */
+    status = MQTTAgent_CommandLoop( pAgentContext );
+
+    pActiveConnection = NULL;
+
+    if( ( status != MQTTSuccess ) || ( yielded == false ) )
+    {
+        /* Hand the connection back to the caller to deal with. */
+        Agent_MultiplexRemoveConnection( pAgentContext );
+        *ppEndedContext = pAgentContext;
+        *pStatus = status;
+        loopEnded = true;
+    }
+
+    return loopEnded;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MultiplexAddConnection( MQTTAgentContext_t * pAgentContext )
+{
+    MultiplexConnection_t * pConnection = NULL;
+    size_t i;
+
+    configASSERT( pAgentContext != NULL );
+
+    taskENTER_CRITICAL();
+    {
+        for( i = 0U; i < MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS; i++ )
+        {
+            if( connections[ i ].pAgentContext == NULL )
+            {
+                pConnection = &( connections[ i ] );
+                pConnection->send = pAgentContext->agentInterface.send;
+                pConnection->recv = pAgentContext->agentInterface.recv;
+                pConnection->transportRecv = pAgentContext->mqttContext.transportInterface.recv;
+                pConnection->events = 0U;
+                pConnection->lastServiceTick = xTaskGetTickCount();
+                pConnection->pAgentContext = pAgentContext;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if( pConnection != NULL )
+    {
+        pAgentContext->agentInterface.send = multiplexMessageSend;
+        pAgentContext->agentInterface.recv = multiplexMessageReceive;
+        pAgentContext->mqttContext.transportInterface.recv = multiplexTransportRecv;
+
+        /* Give the new connection a pass straight away, for anything queued
+         * or received before it was added. */
+        signalConnection( pConnection, agentMULTIPLEX_EVENT_COMMAND | agentMULTIPLEX_EVENT_READABLE );
+    }
+    else
+    {
+        LogError( ( "No room to multiplex another agent context. Increase MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS." ) );
+    }
+
+    return( pConnection != NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MultiplexRemoveConnection( MQTTAgentContext_t * pAgentContext )
+{
+    MultiplexConnection_t * pConnection = NULL;
+
+    configASSERT( pAgentContext != NULL );
+
+    pConnection = findConnection( pAgentContext->agentInterface.pMsgCtx );
+
+    if( pConnection != NULL )
+    {
+        pAgentContext->agentInterface.send = pConnection->send;
+        pAgentContext->agentInterface.recv = pConnection->recv;
+        pAgentContext->mqttContext.transportInterface.recv = pConnection->transportRecv;
+
+        taskENTER_CRITICAL();
+        {
+            pConnection->pAgentContext = NULL;
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t Agent_MultiplexCommandLoop( MQTTAgentContext_t ** ppEndedContext )
+{
+    MQTTStatus_t status = MQTTSuccess;
+    MultiplexConnection_t * pConnection = NULL;
+    const TickType_t idleTicks = pdMS_TO_TICKS( MQTT_AGENT_MULTIPLEX_IDLE_WAIT_TIME );
+    TickType_t idleForTicks = 0U;
+    TickType_t waitTicks = 0U;
+    bool loopEnded = false;
+    bool anyConnection = false;
+    size_t i;
+
+    configASSERT( ppEndedContext != NULL );
+
+    multiplexTask = xTaskGetCurrentTaskHandle();
+    *ppEndedContext = NULL;
+
+    while( loopEnded == false )
+    {
+        anyConnection = false;
+        waitTicks = idleTicks;
+
+        for( i = 0U; ( i < MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS ) && ( loopEnded == false ); i++ )
+        {
+            pConnection = &( connections[ i ] );
+
+            if( pConnection->pAgentContext != NULL )
+            {
+                anyConnection = true;
+                idleForTicks = xTaskGetTickCount() - pConnection->lastServiceTick;
+
+                /* Only connections with a command or data waiting are run,
+                 * and the others once they are due a process loop, for
+                 * example to send a keep-alive ping. */
+                if( ( Atomic_AND_u32( &( pConnection->events ), 0U ) != 0U ) || ( idleForTicks >= idleTicks ) )
+                {
+                    loopEnded = serviceConnection( pConnection, ppEndedContext, &status );
+                    idleForTicks = 0U;
+                }
+
+                if( pConnection->events != 0U )
+                {
+                    /* Left over from this pass, or signalled during it. */
+                    waitTicks = 0U;
+                }
+                else if( ( idleTicks - idleForTicks ) < waitTicks )
+                {
+                    waitTicks = idleTicks - idleForTicks;
+                }
+                else
+                {
+                    /* Not due before the others. */
+                }
+            }
+        }
+
+        if( anyConnection == false )
+        {
+            status = MQTTBadParameter;
+            loopEnded = true;
+        }
+        else if( ( loopEnded == false ) && ( waitTicks > 0U ) )
+        {
+            ( void ) ulTaskNotifyTakeIndexed( agentMULTIPLEX_NOTIFICATION_INDEX,
+                                              pdTRUE,
+                                              waitTicks );
+        }
+        else
+        {
+            /* Loop straight back round. */
+        }
+    }
+
+    multiplexTask = NULL;
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void Agent_MultiplexNotify( MQTTAgentContext_t * pAgentContext )
+{
+    size_t i;
+
+    for( i = 0U; i < MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS; i++ )
+    {
+        if( connections[ i ].pAgentContext == pAgentContext )
+        {
+            signalConnection( &( connections[ i ] ), agentMULTIPLEX_EVENT_READABLE );
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t Agent_MultiplexIdleCommand( MQTTAgentContext_t * pMqttAgentContext,
+                                         void * pUnusedArg,
+                                         MQTTAgentCommandFuncReturns_t * pReturnFlags )
+{
+    MQTTStatus_t status;
+
+    status = MQTTAgentCommand_ProcessLoop( pMqttAgentContext, pUnusedArg, pReturnFlags );
+
+    if( ( pActiveConnection != NULL ) &&
+        ( pActiveConnection->pAgentContext == pMqttAgentContext ) &&
+        ( xTaskGetCurrentTaskHandle() == multiplexTask ) )
+    {
+        /* The agent still runs the process loop before it acts on this. */
+        pReturnFlags->endLoop = true;
+        yielded = true;
+    }
+
+    return status;
+}
@@ -26,7 +26,8 @@
 
 /**
  * @file freertos_command_pool.c
- * @brief Implements functions to obtain and release commands.
+ * @brief Implements functions to obtain and release commands, and the optional
+ * arena used to publish payloads the caller does not have to keep alive.
  */
 
 /* Standard includes. */
@@ -35,17 +36,71 @@
 
 /* Kernel includes. */
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "task.h"
+#include "queue.h"
+#include "event_groups.h"
 
 /* Header include. */
 #include "freertos_command_pool.h"
-#include "freertos_agent_message.h"
 
 /*-----------------------------------------------------------*/
 
 #define QUEUE_NOT_INITIALIZED    ( 0U )
 #define QUEUE_INITIALIZED        ( 1U )
 
+/**
+ * @brief Event bit set each time a command is returned to the pool.
+ */
+#define COMMAND_RELEASED_BIT     ( ( EventBits_t ) 1U )
+
+/**
+ * @brief Reserves are only looked up when the application configured some,
+ * so that uxTaskPriorityGet() is not needed otherwise.
+ */
+#if defined( MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY ) || ( MQTT_COMMAND_POOL_RESERVED_COMMANDS > 0 )
+    #define commandPoolUSE_RESERVES    1
+#else
+    #define commandPoolUSE_RESERVES    0
+#endif
+
+#ifndef MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY
+    #define MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY( uxPriority )   \
+    ( ( ( uxPriority ) >= MQTT_COMMAND_POOL_RESERVED_PRIORITY ) ? \
+      0U : ( size_t ) MQTT_COMMAND_POOL_RESERVED_COMMANDS )
+#endif
+
+#if ( MQTT_USE_PAYLOAD_ARENA == 1 )
+
+    /**
+     * @brief A slab of the payload arena.
+     *
+     * The copy of the publish information is handed to the agent in place of the
+     * caller's, and the topic and payload it points to live in ucData.
+     */
+    typedef struct PayloadSlab
+    {
+        MQTTPublishInfo_t publishInfo;                /**< @brief Copy of the caller's publish information. */
+        MQTTAgentCommandCallback_t userCallback;      /**< @brief Caller's completion callback, may be NULL. */
+        MQTTAgentCommandContext_t * pUserContext;     /**< @brief Context passed to userCallback. */
+        uint8_t ucData[ MQTT_PAYLOAD_ARENA_SLAB_SIZE ]; /**< @brief Storage for the topic and payload. */
+    } PayloadSlab_t;
+
+/*-----------------------------------------------------------*/
+
+    /**
+     * @brief Called by the agent when a publish made from the arena completes.
+     * Forwards the result to the caller's callback, then frees the slab.
+     *
+     * @param[in] pCmdCallbackContext The slab holding the publish.
+     * @param[in] pReturnInfo Result of the publish.
+     */
+    static void prvArenaPublishComplete( MQTTAgentCommandContext_t * pCmdCallbackContext,
+                                         MQTTAgentReturnInfo_t * pReturnInfo );
+
+#endif /* if ( MQTT_USE_PAYLOAD_ARENA == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief The pool of command structures used to hold information on commands (such
  * as PUBLISH or SUBSCRIBE) between the command being created by an API call and
@@ -54,15 +109,39 @@
 static MQTTAgentCommand_t commandStructurePool[ MQTT_COMMAND_CONTEXTS_POOL_SIZE ];
 
 /**
- * @brief The message context used to guard the pool of MQTTAgentCommand_t structures.
- * For FreeRTOS, this is implemented with a queue. Structures may be
- * obtained by receiving a pointer from the queue, and returned by
- * sending the pointer back into it.
+ * @brief Stack of the commands currently in the pool.  Only accessed from
+ * within a critical section, so the number of free commands can be compared
+ * against the caller's reserve and a command taken in one step.
  */
-static MQTTAgentMessageContext_t commandStructMessageCtx;
+static MQTTAgentCommand_t * freeCommands[ MQTT_COMMAND_CONTEXTS_POOL_SIZE ];
 
 /**
- * @brief Initialization status of the queue.
+ * @brief Number of valid entries in freeCommands.
+ */
+static size_t freeCommandCount;
+
+/**
+ * @brief Used to wake tasks waiting for a command to be released.
+ */
+static EventGroupHandle_t commandPoolEvents;
+
+#if ( MQTT_USE_PAYLOAD_ARENA == 1 )
+
+    /**
+     * @brief The slabs of the payload arena.
+     */
+    static PayloadSlab_t payloadSlabs[ MQTT_PAYLOAD_ARENA_SLAB_COUNT ];
+
+    /**
+     * @brief The queue used to guard the payload arena.  Slabs are obtained by
+     * receiving a pointer from the queue, and returned by sending it back.
+     */
+    static QueueHandle_t payloadSlabQueue;
+
+#endif /* if ( MQTT_USE_PAYLOAD_ARENA == 1 ) */
+
+/**
+ * @brief Initialization status of the pool.
  */
 static volatile uint8_t initStatus = QUEUE_NOT_INITIALIZED;
 
@@ -71,28 +150,44 @@ static volatile uint8_t initStatus = QUEUE_NOT_INITIALIZED;
 void Agent_InitializePool( void )
 {
     size_t i;
-    MQTTAgentCommand_t * pCommand;
-    static uint8_t staticQueueStorageArea[ MQTT_COMMAND_CONTEXTS_POOL_SIZE * sizeof( MQTTAgentCommand_t * ) ];
-    static StaticQueue_t staticQueueStructure;
-    bool commandAdded = false;
 
     if( initStatus == QUEUE_NOT_INITIALIZED )
     {
+        /* A reserve as large as the pool would leave nothing for low priority
+         * tasks. */
+        configASSERT( MQTT_COMMAND_POOL_RESERVED_COMMANDS < MQTT_COMMAND_CONTEXTS_POOL_SIZE );
+
         memset( ( void * ) commandStructurePool, 0x00, sizeof( commandStructurePool ) );
-        commandStructMessageCtx.queue = xQueueCreate( MQTT_COMMAND_CONTEXTS_POOL_SIZE,
-                                                      sizeof( MQTTAgentCommand_t * ) );
-        configASSERT( commandStructMessageCtx.queue );
 
-        /* Populate the queue. */
         for( i = 0; i < MQTT_COMMAND_CONTEXTS_POOL_SIZE; i++ )
         {
-            /* Store the address as a variable. */
-            pCommand = &commandStructurePool[ i ];
-            /* Send the pointer to the queue. */
-            commandAdded = Agent_MessageSend( &commandStructMessageCtx, &pCommand, 0U );
-            configASSERT( commandAdded );
+            freeCommands[ i ] = &commandStructurePool[ i ];
         }
 
+        freeCommandCount = MQTT_COMMAND_CONTEXTS_POOL_SIZE;
+        commandPoolEvents = xEventGroupCreate();
+        configASSERT( commandPoolEvents );
+
+        #if ( MQTT_USE_PAYLOAD_ARENA == 1 )
+        {
+            PayloadSlab_t * pSlab;
+            bool slabAdded = false;
+
+            payloadSlabQueue = xQueueCreate( MQTT_PAYLOAD_ARENA_SLAB_COUNT,
+                                             sizeof( PayloadSlab_t * ) );
+            configASSERT( payloadSlabQueue );
+
+            for( i = 0; i < MQTT_PAYLOAD_ARENA_SLAB_COUNT; i++ )
+            {
+                pSlab = &payloadSlabs[ i ];
+                slabAdded = ( xQueueSendToBack( payloadSlabQueue, &pSlab, 0U ) == pdPASS );
+                configASSERT( slabAdded );
+            }
+
+            ( void ) slabAdded;
+        }
+        #endif /* if ( MQTT_USE_PAYLOAD_ARENA == 1 ) */
+
         initStatus = QUEUE_INITIALIZED;
     }
 }
@@ -102,15 +197,55 @@ void Agent_InitializePool( void )
 MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs )
 {
     MQTTAgentCommand_t * structToUse = NULL;
-    bool structRetrieved = false;
+    size_t reserve = 0U;
+    TimeOut_t timeOut;
+    TickType_t ticksToWait = pdMS_TO_TICKS( blockTimeMs );
 
-    /* Check queue has been created. */
+    /* Check the pool has been initialized. */
     configASSERT( initStatus == QUEUE_INITIALIZED );
 
-    /* Retrieve a struct from the queue. */
-    structRetrieved = Agent_MessageReceive( &commandStructMessageCtx, &( structToUse ), blockTimeMs );
+    #if ( commandPoolUSE_RESERVES == 1 )
+    {
+        reserve = ( size_t ) MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY( uxTaskPriorityGet( NULL ) );
+    }
+    #endif
 
-    if( !structRetrieved )
+    vTaskSetTimeOutState( &timeOut );
+
+    for( ; ; )
+    {
+        /* Clear the event bit before looking at the pool, so a command released
+         * after the check below still wakes this task. */
+        ( void ) xEventGroupClearBits( commandPoolEvents, COMMAND_RELEASED_BIT );
+
+        taskENTER_CRITICAL();
+        {
+            if( freeCommandCount > reserve )
+            {
+                freeCommandCount--;
+                structToUse = freeCommands[ freeCommandCount ];
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( structToUse != NULL )
+        {
+            break;
+        }
+
+        if( xTaskCheckForTimeOut( &timeOut, &ticksToWait ) != pdFALSE )
+        {
+            break;
+        }
+
+        ( void ) xEventGroupWaitBits( commandPoolEvents,
+                                      COMMAND_RELEASED_BIT,
+                                      pdFALSE,
+                                      pdFALSE,
+                                      ticksToWait );
+    }
+
+    if( structToUse == NULL )
     {
         LogError( ( "No command structure available." ) );
     }
@@ -130,14 +265,114 @@ bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease )
     if( ( pCommandToRelease >= commandStructurePool ) &&
         ( pCommandToRelease < ( commandStructurePool + MQTT_COMMAND_CONTEXTS_POOL_SIZE ) ) )
     {
-        structReturned = Agent_MessageSend( &commandStructMessageCtx, &pCommandToRelease, 0U );
+        taskENTER_CRITICAL();
+        {
+            /* The stack cannot overflow as it was sized to hold every command
+             * in the pool. */
+            configASSERT( freeCommandCount < MQTT_COMMAND_CONTEXTS_POOL_SIZE );
+            freeCommands[ freeCommandCount ] = pCommandToRelease;
+            freeCommandCount++;
+        }
+        taskEXIT_CRITICAL();
 
-        /* The send should not fail as the queue was created to hold every command
-         * in the pool. */
-        configASSERT( structReturned );
+        ( void ) xEventGroupSetBits( commandPoolEvents, COMMAND_RELEASED_BIT );
+        structReturned = true;
         LogDebug( ( "Returned Command Context %d to pool",
                     ( int ) ( pCommandToRelease - commandStructurePool ) ) );
     }
 
     return structReturned;
 }
+
+/*-----------------------------------------------------------*/
+
+#if ( MQTT_USE_PAYLOAD_ARENA == 1 )
+
+    MQTTStatus_t Agent_PublishCopy( const MQTTAgentContext_t * pMqttAgentContext,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    const MQTTAgentCommandInfo_t * pCommandInfo )
+    {
+        MQTTStatus_t status = MQTTSuccess;
+        PayloadSlab_t * pSlab = NULL;
+        MQTTAgentCommandInfo_t arenaCommandInfo;
+        bool slabReturned = false;
+
+        configASSERT( initStatus == QUEUE_INITIALIZED );
+
+        if( ( pMqttAgentContext == NULL ) || ( pPublishInfo == NULL ) || ( pCommandInfo == NULL ) ||
+            ( ( pPublishInfo->pPayload == NULL ) && ( pPublishInfo->payloadLength > 0U ) ) )
+        {
+            status = MQTTBadParameter;
+        }
+        else if( ( ( size_t ) pPublishInfo->topicNameLength + pPublishInfo->payloadLength ) > MQTT_PAYLOAD_ARENA_SLAB_SIZE )
+        {
+            LogError( ( "Publish of %u bytes does not fit in an arena slab of %u bytes.",
+                        ( unsigned int ) ( pPublishInfo->topicNameLength + pPublishInfo->payloadLength ),
+                        ( unsigned int ) MQTT_PAYLOAD_ARENA_SLAB_SIZE ) );
+            status = MQTTNoMemory;
+        }
+        else if( xQueueReceive( payloadSlabQueue, &pSlab, pdMS_TO_TICKS( pCommandInfo->blockTimeMs ) ) != pdPASS )
+        {
+            LogError( ( "No payload arena slab available." ) );
+            status = MQTTNoMemory;
+        }
+        else
+        {
+            pSlab->publishInfo = *pPublishInfo;
+            pSlab->userCallback = pCommandInfo->cmdCompleteCallback;
+            pSlab->pUserContext = pCommandInfo->pCmdCompleteCallbackContext;
+
+            ( void ) memcpy( pSlab->ucData, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+            pSlab->publishInfo.pTopicName = ( const char * ) pSlab->ucData;
+
+            if( pPublishInfo->payloadLength > 0U )
+            {
+                ( void ) memcpy( &( pSlab->ucData[ pPublishInfo->topicNameLength ] ),
+                                 pPublishInfo->pPayload,
+                                 pPublishInfo->payloadLength );
+                pSlab->publishInfo.pPayload = &( pSlab->ucData[ pPublishInfo->topicNameLength ] );
+            }
+
+            /* The agent copies the callback and its context into the command, so
+             * this structure does not need to outlive the call. */
+            arenaCommandInfo = *pCommandInfo;
+            arenaCommandInfo.cmdCompleteCallback = prvArenaPublishComplete;
+            arenaCommandInfo.pCmdCompleteCallbackContext = ( MQTTAgentCommandContext_t * ) pSlab;
+
+            status = MQTTAgent_Publish( pMqttAgentContext, &( pSlab->publishInfo ), &arenaCommandInfo );
+
+            if( status != MQTTSuccess )
+            {
+                /* The command was never queued so the callback will not run. */
+                slabReturned = ( xQueueSendToBack( payloadSlabQueue, &pSlab, 0U ) == pdPASS );
+                configASSERT( slabReturned );
+                ( void ) slabReturned;
+            }
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvArenaPublishComplete( MQTTAgentCommandContext_t * pCmdCallbackContext,
+                                         MQTTAgentReturnInfo_t * pReturnInfo )
+    {
+        PayloadSlab_t * pSlab = ( PayloadSlab_t * ) pCmdCallbackContext;
+        bool slabReturned = false;
+
+        configASSERT( ( pSlab >= payloadSlabs ) &&
+                      ( pSlab < ( payloadSlabs + MQTT_PAYLOAD_ARENA_SLAB_COUNT ) ) );
+
+        if( pSlab->userCallback != NULL )
+        {
+            pSlab->userCallback( pSlab->pUserContext, pReturnInfo );
+        }
+
+        /* The queue holds every slab, so the send cannot fail. */
+        slabReturned = ( xQueueSendToBack( payloadSlabQueue, &pSlab, 0U ) == pdPASS );
+        configASSERT( slabReturned );
+        ( void ) slabReturned;
+    }
+
+#endif /* if ( MQTT_USE_PAYLOAD_ARENA == 1 ) */
@@ -0,0 +1,260 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file freertos_agent_message_mpsc.h
+ * @brief Agent message interface backed by a lock-free multi-producer,
+ * single-consumer ring of command pointers.
+ *
+ * This is an alternative to freertos_agent_message.c. Build exactly one of the
+ * two files, and include the matching header, as both implement
+ * Agent_MessageSend() and Agent_MessageReceive(). The coreMQTT multitask demo
+ * for the Windows simulator builds this one.
+ *
+ * Enqueuing and dequeuing only use the atomic operations of atomic.h. The
+ * kernel is entered when the agent task has to block because the ring is
+ * empty, and by the producer that then wakes it. All the commands queued while
+ * the agent was busy are drained without further kernel calls.
+ *
+ * Optionally, the transport sends made while the agent works through a run of
+ * queued PUBLISH commands can be coalesced into one transport send. See
+ * Agent_MessageEnableSendCoalescing().
+ */
+#ifndef FREERTOS_AGENT_MESSAGE_MPSC_H
+#define FREERTOS_AGENT_MESSAGE_MPSC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* MQTT agent includes. */
+#include "core_mqtt_agent.h"
+
+/* Include MQTT agent messaging interface. */
+#include "core_mqtt_agent_message_interface.h"
+
+/**
+ * @brief A slot of the ring.
+ *
+ * The sequence number tells producers and the consumer whose turn it is to use
+ * the slot, so that no lock is needed around the command pointer.
+ */
+typedef struct AgentMessageSlot
+{
+    volatile uint32_t sequence;
+    MQTTAgentCommand_t * pCommand;
+} AgentMessageSlot_t;
+
+/**
+ * @ingroup mqtt_agent_struct_types
+ * @brief Context with which tasks may deliver messages to the agent.
+ *
+ * Initialize with Agent_MessageInit(). The members are private to
+ * freertos_agent_message_mpsc.c.
+ */
+struct MQTTAgentMessageContext
+{
+    AgentMessageSlot_t * pSlots;
+    uint32_t mask;                   /**< @brief Number of slots minus one. */
+    volatile uint32_t enqueuePosition;
+    volatile uint32_t dequeuePosition;
+    volatile uint32_t consumerWaiting;
+    TaskHandle_t consumerTask;
+    struct AgentMessageWaiter * pWaitingProducers; /**< @brief Tasks blocked on a full ring, oldest first. */
+
+    /* Send coalescing, see Agent_MessageEnableSendCoalescing(). */
+    NetworkContext_t * pNetworkContext;
+    TransportSend_t transportSend;
+    TransportRecv_t transportRecv;
+    uint8_t * pCoalesceBuffer;
+    size_t coalesceBufferSize;
+    size_t coalesceLength;
+    size_t flushThreshold;           /**< @brief Buffered bytes that cause an immediate flush. */
+    TickType_t flushLatencyTicks;    /**< @brief Longest time data is held, or 0 to hold it only while commands are queued. */
+    TickType_t coalesceStartTick;    /**< @brief When the oldest buffered byte was written. */
+    int32_t pendingSendError;
+    bool coalescing;
+    struct MQTTAgentMessageContext * pNextCoalescing;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initialize a message context. Not thread safe.
+ *
+ * @param[in] pMsgCtx The message context to initialize.
+ * @param[in] pSlots Storage for the ring. Must stay in scope while the context
+ * is in use.
+ * @param[in] slotCount Number of slots in pSlots. Must be a power of two.
+ */
+void Agent_MessageInit( MQTTAgentMessageContext_t * pMsgCtx,
+                        AgentMessageSlot_t * pSlots,
+                        uint32_t slotCount );
+
+/**
+ * @brief Send a message to the specified context.
+ * Must be thread safe.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[in] pCommandToSend Pointer to address to send to queue.
+ * @param[in] blockTimeMs Block time to wait for a send. A task that finds the
+ * ring full waits on task notification index
+ * agentMESSAGE_PRODUCER_NOTIFICATION_INDEX, 1 by default, until the agent takes
+ * a command.
+ *
+ * @return `true` if send was successful, else `false`.
+ */
+bool Agent_MessageSend( const MQTTAgentMessageContext_t * pMsgCtx,
+                        MQTTAgentCommand_t * const * pCommandToSend,
+                        uint32_t blockTimeMs );
+
+/**
+ * @brief Receive a message from the specified context.
+ * Must only be called by the agent task.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[in] pReceivedCommand Pointer to write address of received command.
+ * @param[in] blockTimeMs Block time to wait for a receive.
+ *
+ * @return `true` if receive was successful, else `false`.
+ */
+bool Agent_MessageReceive( const MQTTAgentMessageContext_t * pMsgCtx,
+                           MQTTAgentCommand_t ** pReceivedCommand,
+                           uint32_t blockTimeMs );
+
+/**
+ * @brief Receive up to maxCommands messages from the specified context.
+ * Must only be called by the agent task.
+ *
+ * Blocks for up to blockTimeMs until at least one command is available, then
+ * returns every command that is queued, up to maxCommands, without blocking
+ * again.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[out] pReceivedCommands Array to write the addresses of the received commands.
+ * @param[in] maxCommands Number of entries in pReceivedCommands.
+ * @param[in] blockTimeMs Block time to wait for the first command.
+ *
+ * @return Number of commands received.
+ */
+size_t Agent_MessageReceiveBatch( const MQTTAgentMessageContext_t * pMsgCtx,
+                                  MQTTAgentCommand_t ** pReceivedCommands,
+                                  size_t maxCommands,
+                                  uint32_t blockTimeMs );
+
+/**
+ * @brief Check, without taking it, whether a command is waiting for the agent.
+ * May be called from any task.
+ *
+ * The result is a hint, as the agent may take the command at any time. It
+ * lets a task skip queuing a command that only wakes the agent when one is
+ * already waiting.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ *
+ * @return `true` if a command is waiting, else `false`.
+ */
+bool Agent_MessageCommandWaiting( const MQTTAgentMessageContext_t * pMsgCtx );
+
+/**
+ * @brief Coalesce the transport sends of consecutive PUBLISH commands.
+ * Not thread safe, and must be called before the transport interface is
+ * passed to MQTTAgent_Init().
+ *
+ * The send and receive functions of pTransportInterface are replaced by
+ * Agent_MessageCoalescingSend() and Agent_MessageCoalescingRecv(), and its
+ * writev function is cleared, so that coreMQTT writes each part of a packet
+ * through send. While the agent is processing a PUBLISH command and more
+ * commands are already queued, the data written is copied to pBuffer. The
+ * buffer is written to the network in one send when it is full, when the agent
+ * takes a command of another type, and before the agent blocks, either on an
+ * empty ring or in a transport read. The process loop run for a PUBLISH with
+ * more commands queued behind it does not read the socket, so that the whole
+ * run of queued publishes leaves together. By default no latency is added when
+ * the agent is not behind; Agent_MessageSetCoalescingLimits() can trade some
+ * latency for fuller writes.
+ *
+ * @note A send error found while writing out the buffer is returned by the
+ * next call to Agent_MessageCoalescingSend(), so it is reported against a
+ * later packet than the one that failed.
+ *
+ * @param[in] pMsgCtx An initialized #MQTTAgentMessageContext_t.
+ * @param[in,out] pTransportInterface The transport interface of the agent.
+ * @param[in] pBuffer Coalescing buffer. Must stay in scope while the context
+ * is in use.
+ * @param[in] bufferSize Size of pBuffer. Packets larger than this are sent
+ * directly.
+ */
+void Agent_MessageEnableSendCoalescing( MQTTAgentMessageContext_t * pMsgCtx,
+                                        TransportInterface_t * pTransportInterface,
+                                        uint8_t * pBuffer,
+                                        size_t bufferSize );
+
+/**
+ * @brief Set how long coalesced data may wait for more publishes, and how much
+ * of it causes an immediate write. Not thread safe. Must be called after
+ * Agent_MessageEnableSendCoalescing().
+ *
+ * With a non-zero flush latency, every PUBLISH is coalesced, and the agent
+ * waits up to flushLatencyMs, measured from the oldest byte buffered, for
+ * another PUBLISH to add to it, in the same way as Nagle's algorithm. The
+ * bound holds while the agent works through queued commands, as the next send
+ * or read writes out data held that long, and while it runs the process loop
+ * of a PUBLISH, which does not read the socket until the data is written. Any
+ * other command still writes the buffer out before it is processed.
+ *
+ * @param[in] pMsgCtx A message context with coalescing enabled.
+ * @param[in] flushLatencyMs Longest time data is held, in milliseconds and to
+ * the resolution of the tick. 0, the default, only holds data while more
+ * commands are queued, and writes it out as soon as the ring runs empty.
+ * @param[in] flushThresholdBytes The buffer is written as soon as it holds
+ * this many bytes. Defaults to the buffer size, and must not exceed it.
+ */
+void Agent_MessageSetCoalescingLimits( MQTTAgentMessageContext_t * pMsgCtx,
+                                       uint32_t flushLatencyMs,
+                                       size_t flushThresholdBytes );
+
+/**
+ * @brief Transport send function installed by
+ * Agent_MessageEnableSendCoalescing().
+ */
+int32_t Agent_MessageCoalescingSend( NetworkContext_t * pNetworkContext,
+                                     const void * pBuffer,
+                                     size_t bytesToSend );
+
+/**
+ * @brief Transport receive function installed by
+ * Agent_MessageEnableSendCoalescing().
+ */
+int32_t Agent_MessageCoalescingRecv( NetworkContext_t * pNetworkContext,
+                                     void * pBuffer,
+                                     size_t bytesToRecv );
+
+#endif /* FREERTOS_AGENT_MESSAGE_MPSC_H */
@@ -0,0 +1,151 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file freertos_agent_multiplex.h
+ * @brief Functions to service several MQTT agent contexts, each with its own
+ * broker connection, from a single agent task.
+ *
+ * MQTTAgent_CommandLoop() only returns once its connection fails or is
+ * terminated, so normally every connection needs a task of its own.  To share
+ * one task, the agent's function table must map the NONE command to
+ * Agent_MultiplexIdleCommand() by defining MQTT_AGENT_FUNCTION_TABLE in
+ * core_mqtt_agent_config.h, as the multitask demo does.  The command loop
+ * of a multiplexed context then returns to Agent_MultiplexCommandLoop()
+ * whenever the context has no command waiting and its socket has been read.
+ * The task blocks until a command is sent to, or data arrives for, any of the
+ * connections, and then only runs the command loops of those connections.
+ * Each extra connection costs its agent context, network buffer and command
+ * queue, but no task stack.
+ *
+ * The transport receive function of every connection must return straight
+ * away when there is no data, for example by setting FREERTOS_SO_RCVTIMEO to
+ * 0 as the multitask demo does, or a connection with nothing to read holds up
+ * the others.  Data arriving must be reported with Agent_MultiplexNotify().
+ */
+#ifndef FREERTOS_AGENT_MULTIPLEX_H
+#define FREERTOS_AGENT_MULTIPLEX_H
+
+/* MQTT agent includes. */
+#include "core_mqtt_agent.h"
+
+/**
+ * @brief Maximum number of agent contexts one task can service.
+ */
+#ifndef MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS
+    #define MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS    ( 4U )
+#endif
+
+/**
+ * @brief Number of commands a connection may process before the others get a
+ * turn, so that one busy connection cannot starve the rest.
+ */
+#ifndef MQTT_AGENT_MULTIPLEX_COMMANDS_PER_PASS
+    #define MQTT_AGENT_MULTIPLEX_COMMANDS_PER_PASS    ( 8U )
+#endif
+
+/**
+ * @brief Longest time in MS a connection goes without its command loop
+ * running, and so without MQTT_ProcessLoop() sending keep-alive pings, while
+ * it has no command or data waiting.
+ */
+#ifndef MQTT_AGENT_MULTIPLEX_IDLE_WAIT_TIME
+    #define MQTT_AGENT_MULTIPLEX_IDLE_WAIT_TIME    MQTT_AGENT_MAX_EVENT_QUEUE_WAIT_TIME
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Add an initialized agent context to the set serviced by
+ * Agent_MultiplexCommandLoop().  Thread safe.
+ *
+ * The send and receive functions of the context's message interface are
+ * wrapped so that sending a command wakes the multiplexing task, and so is its
+ * transport receive function, so that a connection is serviced until its
+ * socket is drained.  Commands must therefore only be sent through the agent
+ * API after the context has been added.
+ *
+ * @note A message interface that holds sends back, such as send coalescing
+ * with a non-zero flush latency, only flushes when the task next wakes.
+ *
+ * @param[in] pAgentContext The agent context, initialized with
+ * MQTTAgent_Init() and connected.
+ *
+ * @return `true` if the context was added, `false` if
+ * MQTT_AGENT_MULTIPLEX_MAX_CONNECTIONS contexts are already serviced.
+ */
+bool Agent_MultiplexAddConnection( MQTTAgentContext_t * pAgentContext );
+
+/**
+ * @brief Remove an agent context from the set serviced by
+ * Agent_MultiplexCommandLoop(), restoring its original message interface and
+ * transport receive function.
+ * Must be called from the multiplexing task, or while it is not running.
+ *
+ * @param[in] pAgentContext A context added with Agent_MultiplexAddConnection().
+ */
+void Agent_MultiplexRemoveConnection( MQTTAgentContext_t * pAgentContext );
+
+/**
+ * @brief Run the command loops of all added contexts from the calling task.
+ *
+ * Returns as soon as the command loop of one context ends, that is on an
+ * error, a disconnect or MQTTAgent_Terminate(), in the same way as
+ * MQTTAgent_CommandLoop() does for a single context.  The context is removed
+ * from the set before returning, so that the caller can clean up, reconnect
+ * and add it again, then call this function again to carry on servicing the
+ * others.
+ *
+ * @param[out] ppEndedContext Set to the context whose command loop ended.
+ *
+ * @return The status MQTTAgent_CommandLoop() returned for that context, or
+ * MQTTBadParameter if no context has been added.
+ */
+MQTTStatus_t Agent_MultiplexCommandLoop( MQTTAgentContext_t ** ppEndedContext );
+
+/**
+ * @brief Tell the multiplexing task that data has arrived for a connection,
+ * so that it reads from that connection's socket.  Meant to be called from a
+ * FREERTOS_SO_WAKEUP_CALLBACK.  Contexts that are not being serviced are
+ * ignored.
+ *
+ * @param[in] pAgentContext The agent context of the connection.
+ */
+void Agent_MultiplexNotify( MQTTAgentContext_t * pAgentContext );
+
+/**
+ * @brief Function for the NONE entry of MQTT_AGENT_FUNCTION_TABLE.
+ *
+ * Runs the process loop like MQTTAgentCommand_ProcessLoop(), then, if the
+ * context is being serviced by Agent_MultiplexCommandLoop(), ends its command
+ * loop so that the other connections get a turn.  Contexts run directly with
+ * MQTTAgent_CommandLoop() are not affected.
+ */
+MQTTStatus_t Agent_MultiplexIdleCommand( MQTTAgentContext_t * pMqttAgentContext,
+                                         void * pUnusedArg,
+                                         MQTTAgentCommandFuncReturns_t * pReturnFlags );
+
+#endif /* FREERTOS_AGENT_MULTIPLEX_H */
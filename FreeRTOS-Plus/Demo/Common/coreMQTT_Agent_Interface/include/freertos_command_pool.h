@@ -26,7 +26,8 @@
 
 /**
  * @file freertos_command_pool.h
- * @brief Functions to obtain and release a command.
+ * @brief Functions to obtain and release a command, and to publish without
+ * keeping the payload alive until the publish completes.
  */
 #ifndef FREERTOS_COMMAND_POOL_H
 #define FREERTOS_COMMAND_POOL_H
@@ -35,7 +36,57 @@
 #include "core_mqtt_agent.h"
 
 /**
- * @brief Initialize the common task pool. Not thread safe.
+ * @brief Number of commands kept back for tasks running at or above
+ * MQTT_COMMAND_POOL_RESERVED_PRIORITY.
+ *
+ * Lower priority tasks, typically those doing bulk publishing, block once only
+ * this many commands remain in the pool, so control commands such as
+ * SUBSCRIBE or PING issued by higher priority tasks still find one.  Defaults
+ * to 0, which makes the whole pool available to every task.
+ */
+#ifndef MQTT_COMMAND_POOL_RESERVED_COMMANDS
+    #define MQTT_COMMAND_POOL_RESERVED_COMMANDS    ( 0U )
+#endif
+
+/**
+ * @brief Lowest task priority allowed to take the reserved commands.
+ *
+ * For finer control, define MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY( uxPriority )
+ * to return the number of commands a task of that priority must leave in the
+ * pool.  Either way INCLUDE_uxTaskPriorityGet must be set to 1.
+ */
+#ifndef MQTT_COMMAND_POOL_RESERVED_PRIORITY
+    #define MQTT_COMMAND_POOL_RESERVED_PRIORITY    ( configMAX_PRIORITIES - 1U )
+#endif
+
+/**
+ * @brief Set to 1 to build the payload arena and Agent_PublishCopy().
+ *
+ * Defaults to 0 so that applications that do not use Agent_PublishCopy() do
+ * not pay for the arena's slabs and queue.
+ */
+#ifndef MQTT_USE_PAYLOAD_ARENA
+    #define MQTT_USE_PAYLOAD_ARENA    ( 0 )
+#endif
+
+/**
+ * @brief Number of slabs in the payload arena used by Agent_PublishCopy(),
+ * which is also the maximum number of such publishes outstanding at once.
+ */
+#ifndef MQTT_PAYLOAD_ARENA_SLAB_COUNT
+    #define MQTT_PAYLOAD_ARENA_SLAB_COUNT    ( 4U )
+#endif
+
+/**
+ * @brief Bytes of topic name plus payload each arena slab can hold.
+ */
+#ifndef MQTT_PAYLOAD_ARENA_SLAB_SIZE
+    #define MQTT_PAYLOAD_ARENA_SLAB_SIZE    ( 256U )
+#endif
+
+/**
+ * @brief Initialize the common task pool, and the payload arena when
+ * MQTT_USE_PAYLOAD_ARENA is 1. Not thread safe.
  */
 void Agent_InitializePool( void );
 
@@ -50,6 +101,10 @@ void Agent_InitializePool( void );
  * The MQTT_COMMAND_CONTEXTS_POOL_SIZE configuration file constant defines how many
  * structures the pool contains.
  *
+ * If MQTT_COMMAND_POOL_RESERVED_COMMANDS or MQTT_COMMAND_POOL_RESERVE_FOR_PRIORITY
+ * is set, a structure is only handed to the calling task while more remain in
+ * the pool than are reserved for tasks of higher priority.
+ *
  * @param[in] blockTimeMs The length of time the calling task should remain in the
  * Blocked state (so not consuming any CPU time) to wait for a MQTTAgentCommand_t structure to
  * become available should one not be immediately at the time of the call.
@@ -80,4 +135,31 @@ MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs );
  */
 bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease );
 
+#if ( MQTT_USE_PAYLOAD_ARENA == 1 )
+
+/**
+ * @brief Publish through the agent after copying the topic and payload into a
+ * slab of the payload arena.  Only available when MQTT_USE_PAYLOAD_ARENA is 1.
+ *
+ * Unlike MQTTAgent_Publish(), neither pPublishInfo nor the buffers it points to
+ * need to remain valid after this function returns, so the caller does not
+ * have to wait for the completion callback.  The slab is freed once the agent
+ * completes the publish.
+ *
+ * @param[in] pMqttAgentContext The MQTT agent to publish through.
+ * @param[in] pPublishInfo The publish to send.  The topic name and payload
+ * together must not exceed MQTT_PAYLOAD_ARENA_SLAB_SIZE bytes.
+ * @param[in] pCommandInfo As for MQTTAgent_Publish().  blockTimeMs also bounds
+ * the wait for a free slab.  The callback, if any, is called before the slab
+ * is freed.
+ *
+ * @return MQTTNoMemory if the publish is too large for a slab or no slab became
+ * free in time, otherwise the status returned by MQTTAgent_Publish().
+ */
+    MQTTStatus_t Agent_PublishCopy( const MQTTAgentContext_t * pMqttAgentContext,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    const MQTTAgentCommandInfo_t * pCommandInfo );
+
+#endif /* if ( MQTT_USE_PAYLOAD_ARENA == 1 ) */
+
 #endif /* FREERTOS_COMMAND_POOL_H */
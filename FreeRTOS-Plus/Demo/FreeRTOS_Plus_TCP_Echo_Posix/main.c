@@ -61,6 +61,7 @@
 
 /* Local includes. */
 #include "console.h"
+#include "logging.h"
 
 #include <trcRecorder.h>
 
@@ -126,6 +127,11 @@ int main( void )
     #endif
 
     console_init();
+
+    /* Log to stdout from a native thread, so the FreeRTOS tasks do not wait
+     * for the host's I/O. */
+    vLoggingInit( pdTRUE, pdFALSE, pdFALSE, 0U, 0U );
+
     #if ( mainSELECTED_APPLICATION == ECHO_CLIENT_DEMO )
     {
         console_print( "Starting echo client demo\n" );
@@ -231,17 +237,6 @@ void traceOnEnter()
     }
 }
 
-void vLoggingPrintf( const char * pcFormat,
-                     ... )
-{
-    va_list arg;
-
-    va_start( arg, pcFormat );
-    vprintf( pcFormat, arg );
-    va_end( arg );
-}
-/*-----------------------------------------------------------*/
-
 void vApplicationDaemonTaskStartupHook( void )
 {
     /* This function will be called once only, when the daemon task starts to
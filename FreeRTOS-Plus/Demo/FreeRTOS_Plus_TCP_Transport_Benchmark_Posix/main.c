@@ -0,0 +1,290 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/******************************************************************************
+ * This project benchmarks the transport interface implementations in
+ * FreeRTOS-Plus/Source/Application-Protocols/network_transport.  The
+ * transport under test is selected with the TRANSPORT option of the Makefile,
+ * and the benchmark itself is implemented and described in
+ * transport_benchmark.c.
+ *
+ * This file implements the code that is not benchmark specific, including the
+ * network setup and FreeRTOS hook functions.  The network uses the libslirp
+ * backend, so the benchmark connects to an echo server running on the host
+ * without any network configuration.  See README.txt for instructions.
+ *
+ *******************************************************************************
+ * NOTE: Linux will not be running the FreeRTOS threads continuously, so do not
+ * expect to get real time behaviour from the FreeRTOS Linux port.  The
+ * benchmark reports wall clock and process CPU time read from the host, which
+ * are meaningful, rather than tick counts.  See the documentation page for the
+ * Linux port for further information:
+ * https://freertos.org/FreeRTOS-simulator-for-Linux.html
+ *
+ *******************************************************************************
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
+
+/* FreeRTOS kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+/* Benchmark includes. */
+#include "transport_benchmark_config.h"
+#include "transport_benchmark.h"
+
+/* This demo uses heap_4.c so xPortGetMinimumEverFreeHeapSize() is available. */
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Prototypes for the standard FreeRTOS application hook (callback) functions
+ * implemented within this file.  See http://www.freertos.org/a00016.html .
+ */
+void vApplicationMallocFailedHook( void );
+void vApplicationIdleHook( void );
+void vApplicationStackOverflowHook( TaskHandle_t pxTask,
+                                    char * pcTaskName );
+void vApplicationTickHook( void );
+
+/*-----------------------------------------------------------*/
+
+/* The default IP and MAC address used by the demo.  The address configuration
+ * defined here will be used if ipconfigUSE_DHCP is 0, or if ipconfigUSE_DHCP is
+ * 1 but a DHCP server could not be contacted.  See the online documentation for
+ * more information. */
+static const uint8_t ucIPAddress[ 4 ] = { configIP_ADDR0, configIP_ADDR1, configIP_ADDR2, configIP_ADDR3 };
+static const uint8_t ucNetMask[ 4 ] = { configNET_MASK0, configNET_MASK1, configNET_MASK2, configNET_MASK3 };
+static const uint8_t ucGatewayAddress[ 4 ] = { configGATEWAY_ADDR0, configGATEWAY_ADDR1, configGATEWAY_ADDR2, configGATEWAY_ADDR3 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { configDNS_SERVER_ADDR0, configDNS_SERVER_ADDR1, configDNS_SERVER_ADDR2, configDNS_SERVER_ADDR3 };
+
+/* Default MAC address configuration. */
+const uint8_t ucMACAddress[ 6 ] = { configMAC_ADDR0, configMAC_ADDR1, configMAC_ADDR2, configMAC_ADDR3, configMAC_ADDR4, configMAC_ADDR5 };
+
+/* There is only 1 physical interface, with a single end-point. */
+static NetworkInterface_t xInterfaces[ 1 ];
+static NetworkEndPoint_t xEndPoints[ 1 ];
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    extern NetworkInterface_t * pxLibslirp_FillInterfaceDescriptor( BaseType_t xEMACIndex,
+                                                                    NetworkInterface_t * pxInterface );
+
+    /* Results are printed as they become available. */
+    setvbuf( stdout, NULL, _IONBF, 0 );
+
+    pxLibslirp_FillInterfaceDescriptor( 0, &( xInterfaces[ 0 ] ) );
+    FreeRTOS_FillEndPoint( &( xInterfaces[ 0 ] ), &( xEndPoints[ 0 ] ), ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+
+    #if ( ipconfigUSE_DHCP != 0 )
+    {
+        /* End-point 0 wants to use DHCPv4. */
+        xEndPoints[ 0 ].bits.bWantDHCP = pdTRUE;
+    }
+    #endif /* ( ipconfigUSE_DHCP != 0 ) */
+
+    FreeRTOS_IPInit_Multi();
+
+    /* Start the RTOS scheduler.  The benchmark task is created from the
+     * network event hook once the network is up, and ends the process when
+     * the benchmark is complete. */
+    vTaskStartScheduler();
+
+    /* If all is well, the scheduler will now be running, and the following
+     * line will never be reached. */
+    return 1;
+}
+/*-----------------------------------------------------------*/
+
+/* Called by FreeRTOS+TCP when the network connects or disconnects. */
+void vApplicationIPNetworkEventHook_Multi( eIPCallbackEvent_t eNetworkEvent,
+                                           struct xNetworkEndPoint * pxEndPoint )
+{
+    static BaseType_t xTasksAlreadyCreated = pdFALSE;
+
+    ( void ) pxEndPoint;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTasksAlreadyCreated == pdFALSE ) )
+    {
+        vStartTransportBenchmarkTask( benchmarkconfigTASK_STACK_SIZE, benchmarkconfigTASK_PRIORITY );
+        xTasksAlreadyCreated = pdTRUE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationMallocFailedHook( void )
+{
+    /* The benchmark measures peak heap use, so running out of heap means
+     * configTOTAL_HEAP_SIZE needs to be increased. */
+    vAssertCalled( __FILE__, __LINE__ );
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIdleHook( void )
+{
+    /* Yield the host CPU so the idle task does not inflate the process CPU
+     * time measured by the benchmark. */
+    usleep( 15000 );
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationStackOverflowHook( TaskHandle_t pxTask,
+                                    char * pcTaskName )
+{
+    ( void ) pcTaskName;
+    ( void ) pxTask;
+
+    /* Run time stack overflow checking is performed if
+     * configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2.  This hook
+     * function is called if a stack overflow is detected.  This function is
+     * provided as an example only as stack overflow checking does not function
+     * when running the FreeRTOS POSIX port. */
+    vAssertCalled( __FILE__, __LINE__ );
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationTickHook( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    va_list arg;
+
+    va_start( arg, pcFormat );
+    vprintf( pcFormat, arg );
+    va_end( arg );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * const pcFileName,
+                    unsigned long ulLine )
+{
+    volatile uint32_t ulSetToNonZeroInDebuggerToContinue = 0;
+
+    /* Called if an assertion passed to configASSERT() fails.  See
+     * https://www.FreeRTOS.org/a00110.html#configASSERT for more information. */
+
+    taskENTER_CRITICAL();
+    {
+        printf( "vAssertCalled( %s %lu )\n", pcFileName, ulLine );
+
+        /* You can step out of this function to debug the assertion by using
+         * the debugger to set ulSetToNonZeroInDebuggerToContinue to a non-zero
+         * value. */
+        while( ulSetToNonZeroInDebuggerToContinue == 0 )
+        {
+            __asm volatile ( "NOP" );
+            __asm volatile ( "NOP" );
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+#if ( ipconfigUSE_LLMNR != 0 ) || ( ipconfigUSE_NBNS != 0 ) || ( ipconfigDHCP_REGISTER_HOSTNAME == 1 )
+
+    const char * pcApplicationHostnameHook( void )
+    {
+        return "Benchmark";
+    }
+
+#endif
+/*-----------------------------------------------------------*/
+
+#if ( ipconfigUSE_LLMNR != 0 ) || ( ipconfigUSE_NBNS != 0 )
+
+    BaseType_t xApplicationDNSQueryHook_Multi( struct xNetworkEndPoint * pxEndPoint,
+                                               const char * pcName )
+    {
+        ( void ) pxEndPoint;
+
+        return ( strcasecmp( pcName, pcApplicationHostnameHook() ) == 0 ) ? pdPASS : pdFAIL;
+    }
+
+#endif /* if ( ipconfigUSE_LLMNR != 0 ) || ( ipconfigUSE_NBNS != 0 ) */
+/*-----------------------------------------------------------*/
+
+/*
+ * Supply a random number to FreeRTOS+TCP stack.  The host's random number
+ * generator is used, as wolfSSL may also seed itself through this function.
+ */
+BaseType_t xApplicationGetRandomNumber( uint32_t * pulNumber )
+{
+    BaseType_t xReturn = pdFALSE;
+
+    if( getrandom( pulNumber, sizeof( *pulNumber ), 0 ) == ( ssize_t ) sizeof( *pulNumber ) )
+    {
+        xReturn = pdTRUE;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Callback that provides the inputs necessary to generate a randomized TCP
+ * Initial Sequence Number per RFC 6528.  A random number is returned, which
+ * is sufficient for a benchmark but does not follow the RFC.
+ */
+extern uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                                    uint16_t usSourcePort,
+                                                    uint32_t ulDestinationAddress,
+                                                    uint16_t usDestinationPort )
+{
+    uint32_t ulNumber = 0;
+
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    ( void ) xApplicationGetRandomNumber( &ulNumber );
+
+    return ulNumber;
+}
+/*-----------------------------------------------------------*/
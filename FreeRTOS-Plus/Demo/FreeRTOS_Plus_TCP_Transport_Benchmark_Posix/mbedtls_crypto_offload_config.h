@@ -0,0 +1,41 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_crypto_offload_config.h
+ * @brief mbedTLS user configuration of the CRYPTO_OFFLOAD=1 build, included
+ * by mbedtls/build_info.h after mbedtls_config_v3.5.1.h.
+ */
+
+#ifndef MBEDTLS_CRYPTO_OFFLOAD_CONFIG_H
+#define MBEDTLS_CRYPTO_OFFLOAD_CONFIG_H
+
+/* Implemented by network_transport/mbedtls_crypto_offload.c. GCM and SHA-256
+ * are reached through the linker options of the Makefile instead, so that
+ * mbedTLS keeps its own code for them. */
+#define MBEDTLS_ECDH_COMPUTE_SHARED_ALT
+
+#endif /* MBEDTLS_CRYPTO_OFFLOAD_CONFIG_H */
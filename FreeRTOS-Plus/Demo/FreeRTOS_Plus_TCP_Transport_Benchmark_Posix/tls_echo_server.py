@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Plaintext and TLS echo server for the FreeRTOS transport benchmark.
+
+A single SSL context is shared by all TLS connections so that clients can
+resume sessions, both through the TLS 1.2 session cache and TLS 1.3 session
+tickets. Client certificates are required, as the wolfSSL transport always
+presents one.
+
+The first byte received on each connection is answered with b"R" if the TLS
+session was resumed and b"F" otherwise, so the benchmark can tell a resumed
+handshake from a full one. Everything after it is echoed.
+"""
+
+import argparse
+import socket
+import ssl
+import threading
+
+
+def echo(conn):
+    with conn:
+        first = True
+        while True:
+            data = conn.recv(65536)
+            if not data:
+                break
+            if first:
+                resumed = getattr(conn, "session_reused", False)
+                data = (b"R" if resumed else b"F") + data[1:]
+                first = False
+            conn.sendall(data)
+
+
+def serve(listener, context):
+    while True:
+        conn, _ = listener.accept()
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        if context is not None:
+            try:
+                conn = context.wrap_socket(conn, server_side=True)
+            except (ssl.SSLError, OSError) as err:
+                print(f"TLS handshake failed: {err}")
+                conn.close()
+                continue
+        threading.Thread(target=echo, args=(conn,), daemon=True).start()
+
+
+def listen(port):
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(("127.0.0.1", port))
+    listener.listen(8)
+    return listener
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--plaintext-port", type=int, default=5000)
+    parser.add_argument("--tls-port", type=int, default=5443)
+    parser.add_argument("--certs", default="certs")
+    parser.add_argument("--tls-version", choices=["1.2", "1.3"], default="1.3")
+    args = parser.parse_args()
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(f"{args.certs}/server.crt", f"{args.certs}/server.key")
+    context.load_verify_locations(f"{args.certs}/ca.crt")
+    context.verify_mode = ssl.CERT_REQUIRED
+    version = ssl.TLSVersion.TLSv1_2 if args.tls_version == "1.2" else ssl.TLSVersion.TLSv1_3
+    context.minimum_version = version
+    context.maximum_version = version
+
+    threading.Thread(target=serve, args=(listen(args.plaintext_port), None), daemon=True).start()
+    print(f"Echo server listening on plaintext port {args.plaintext_port} "
+          f"and TLS {args.tls_version} port {args.tls_port}")
+    serve(listen(args.tls_port), context)
+
+
+if __name__ == "__main__":
+    main()
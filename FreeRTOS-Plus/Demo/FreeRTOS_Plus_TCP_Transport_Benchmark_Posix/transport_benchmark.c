@@ -0,0 +1,875 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ * Measures the cost of the transport interface implementation selected at
+ * build time (see the TRANSPORT option in the Makefile) when talking to an echo
+ * server on the host:
+ *
+ * - Handshake latency.  The time taken by the transport's connect function,
+ *   first with a full handshake, then resuming the session of the previous
+ *   connection.  For the plaintext transport only the TCP connect is timed.
+ * - Bulk throughput.  A fixed amount of data is echoed through one connection
+ *   using writes of each of the sizes in benchmarkconfigRECORD_SIZES.
+ * - Heap high-water mark.  The peak FreeRTOS heap use of the connection, which
+ *   includes the TCP stream buffers and network buffers used by the IP task.
+ * - CPU time.  Process CPU time, so the time spent in the IP task and the
+ *   libslirp backend threads is included.
+ *
+ * Each result is printed on a line that starts with "RESULT" so the output of
+ * the different transport builds can be compared with a simple grep.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Benchmark configuration, including the logging configuration. */
+#include "transport_benchmark_config.h"
+#include "transport_benchmark.h"
+
+/* Transport interface implementation under test. */
+#if defined( benchmarkTRANSPORT_PLAINTEXT )
+    #include "transport_plaintext.h"
+#elif defined( benchmarkTRANSPORT_MBEDTLS )
+    #include "transport_mbedtls.h"
+    #if defined( benchmarkCRYPTO_OFFLOAD )
+        #include "mbedtls_crypto_offload.h"
+    #endif
+#elif defined( benchmarkTRANSPORT_WOLFSSL )
+    #include "transport_wolfSSL.h"
+#else
+    #error "Define one of benchmarkTRANSPORT_PLAINTEXT, benchmarkTRANSPORT_MBEDTLS or benchmarkTRANSPORT_WOLFSSL."
+#endif
+
+/*-----------------------------------------------------------*/
+
+#if defined( benchmarkTRANSPORT_PLAINTEXT )
+    #define benchmarkTRANSPORT_NAME                     "plaintext"
+    #define benchmarkSERVER_PORT                        benchmarkconfigPLAINTEXT_SERVER_PORT
+    #define benchmarkTRANSPORT_SEND                     Plaintext_FreeRTOS_send
+    #define benchmarkTRANSPORT_RECV                     Plaintext_FreeRTOS_recv
+#elif defined( benchmarkTRANSPORT_MBEDTLS )
+    #define benchmarkTRANSPORT_NAME                     "mbedtls"
+    #define benchmarkSERVER_PORT                        benchmarkconfigTLS_SERVER_PORT
+    #define benchmarkTRANSPORT_SEND                     TLS_FreeRTOS_send
+    #define benchmarkTRANSPORT_RECV                     TLS_FreeRTOS_recv
+#else
+    #define benchmarkTRANSPORT_NAME                     "wolfSSL"
+    #define benchmarkSERVER_PORT                        benchmarkconfigTLS_SERVER_PORT
+    #define benchmarkTRANSPORT_SEND                     TLS_FreeRTOS_send
+    #define benchmarkTRANSPORT_RECV                     TLS_FreeRTOS_recv
+#endif /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+
+/* Size of the transmit and receive buffers, which limits the largest entry
+ * of benchmarkconfigRECORD_SIZES. */
+#define benchmarkBUFFER_SIZE                            ( 16384U )
+
+/* Number of bytes in the MB used when reporting throughput and CPU time. */
+#define benchmarkBYTES_PER_MB                           ( 1024.0 * 1024.0 )
+
+#define benchmarkNS_PER_MS                              ( 1000000.0 )
+#define benchmarkNS_PER_S                               ( 1000000000ULL )
+
+/* Size of the header that the wolfSSL allocator wrappers place in front of
+ * each block to remember its size, rounded up to keep the block aligned. */
+#define benchmarkALLOCATION_HEADER_SIZE                 ( ( sizeof( size_t ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+/*-----------------------------------------------------------*/
+
+#if defined( benchmarkTRANSPORT_PLAINTEXT ) || defined( benchmarkTRANSPORT_MBEDTLS )
+
+/* The transport implementations leave the definition of the network context
+ * to the application.  The wolfSSL transport defines it itself. */
+    struct NetworkContext
+    {
+        #if defined( benchmarkTRANSPORT_PLAINTEXT )
+            PlaintextTransportParams_t * pParams;
+        #else
+            TlsTransportParams_t * pParams;
+        #endif
+    };
+
+#endif /* if defined( benchmarkTRANSPORT_PLAINTEXT ) || defined( benchmarkTRANSPORT_MBEDTLS ) */
+
+/* Accumulated timings of a series of operations. */
+typedef struct BenchmarkStats
+{
+    uint32_t ulCount;
+    uint32_t ulFailures;
+    uint64_t ullMinNs;
+    uint64_t ullMaxNs;
+    uint64_t ullTotalNs;
+    uint64_t ullTotalCpuNs;
+    size_t xHeapPeak;
+} BenchmarkStats_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The task that runs all the measurements.
+ */
+static void prvTransportBenchmarkTask( void * pvParameters );
+
+/*
+ * Prepare the socket options and, for the TLS transports, the credentials.
+ */
+static BaseType_t prvTransportInit( void );
+
+/*
+ * Connect to the echo server.  If xResume is pdTRUE the TLS transports offer
+ * the session saved by prvSaveSession().
+ */
+static BaseType_t prvTransportConnect( BaseType_t xResume );
+
+/*
+ * Close the connection opened by prvTransportConnect().
+ */
+static void prvTransportDisconnect( void );
+
+/*
+ * Save the session of the current connection for the next resumed handshake.
+ */
+static void prvSaveSession( void );
+
+/*
+ * Send xLength bytes of the transmit buffer and receive xLength bytes into the
+ * receive buffer.
+ */
+static BaseType_t prvExchange( size_t xLength );
+
+/*
+ * Send xLength bytes of the transmit buffer and wait for the echo server to
+ * return them, checking the echoed data is correct.
+ */
+static BaseType_t prvEcho( size_t xLength );
+
+/*
+ * Exchange the first byte of a connection, which the echo server answers with
+ * whether it resumed the TLS session.
+ */
+static BaseType_t prvReadSessionStatus( BaseType_t * pxResumed );
+
+/*
+ * Time benchmarkconfigHANDSHAKE_ITERATIONS connections, either with full or
+ * with resumed handshakes.
+ */
+static void prvMeasureHandshakes( BaseType_t xResume );
+
+/*
+ * Time the transfer of benchmarkconfigBULK_TRANSFER_BYTES bytes using writes
+ * of xRecordSize bytes.
+ */
+static void prvMeasureThroughput( size_t xRecordSize );
+
+/*
+ * Read the given clock in nanoseconds.
+ */
+static uint64_t prvGetTimeNs( clockid_t xClock );
+
+/*
+ * Reset the heap minimum ever free size so prvGetHeapPeak() returns the peak
+ * heap use from this point onwards.
+ */
+static void prvResetHeapPeak( void );
+static size_t prvGetHeapPeak( void );
+
+#if defined( benchmarkTRANSPORT_MBEDTLS )
+
+/*
+ * Read a PEM file into a NULL terminated buffer, as expected by mbedTLS.
+ */
+    static BaseType_t prvReadPemFile( const char * pcPath,
+                                      const uint8_t ** ppucBuffer,
+                                      size_t * pxSize );
+
+#endif /* defined( benchmarkTRANSPORT_MBEDTLS ) */
+
+#if defined( benchmarkTRANSPORT_WOLFSSL )
+
+/*
+ * Allocator wrappers that make wolfSSL allocate from the FreeRTOS heap, so
+ * its heap use is measured in the same way as that of mbedTLS.
+ */
+    static void * prvWolfSSLMalloc( size_t xSize );
+    static void prvWolfSSLFree( void * pvBuffer );
+    static void * prvWolfSSLRealloc( void * pvBuffer,
+                                     size_t xSize );
+
+#endif /* defined( benchmarkTRANSPORT_WOLFSSL ) */
+
+/*-----------------------------------------------------------*/
+
+static NetworkContext_t xNetworkContext;
+static TcpSocketsOptions_t xTcpSocketsOptions;
+
+#if defined( benchmarkTRANSPORT_PLAINTEXT )
+    static PlaintextTransportParams_t xPlaintextTransportParams;
+#elif defined( benchmarkTRANSPORT_MBEDTLS )
+    static TlsTransportParams_t xTlsTransportParams;
+    static NetworkCredentials_t xNetworkCredentials;
+    static mbedtls_ssl_session xSavedSession;
+    static BaseType_t xSessionSaved = pdFALSE;
+#else
+    static NetworkCredentials_t xNetworkCredentials;
+    static WOLFSSL_SESSION * pxSavedSession = NULL;
+#endif /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+
+/* Data sent to, and received back from, the echo server. */
+static uint8_t ucTxBuffer[ benchmarkBUFFER_SIZE ];
+static uint8_t ucRxBuffer[ benchmarkBUFFER_SIZE ];
+
+/* Free heap space when prvResetHeapPeak() was last called. */
+static size_t xHeapFreeAtReset = 0;
+
+/* Number of measurements that failed, used as the exit code. */
+static uint32_t ulTotalFailures = 0;
+
+/*-----------------------------------------------------------*/
+
+void vStartTransportBenchmarkTask( configSTACK_DEPTH_TYPE uxTaskStackSize,
+                                   UBaseType_t uxTaskPriority )
+{
+    xTaskCreate( prvTransportBenchmarkTask, /* The function that implements the task. */
+                 "Benchmark",               /* Just a text name for the task to aid debugging. */
+                 uxTaskStackSize,           /* The stack size is defined in transport_benchmark_config.h. */
+                 NULL,                      /* The task parameter, not used in this case. */
+                 uxTaskPriority,            /* The priority is defined in transport_benchmark_config.h. */
+                 NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTransportBenchmarkTask( void * pvParameters )
+{
+    static const size_t xRecordSizes[] = benchmarkconfigRECORD_SIZES;
+    size_t x;
+
+    ( void ) pvParameters;
+
+    /* Fill the transmit buffer with a pattern that does not repeat on any
+     * record boundary, so misordered data is detected. */
+    for( x = 0; x < benchmarkBUFFER_SIZE; x++ )
+    {
+        ucTxBuffer[ x ] = ( uint8_t ) ( ( x * 7U ) + ( x >> 8 ) );
+    }
+
+    if( prvTransportInit() == pdPASS )
+    {
+        LogInfo( ( "Benchmarking the %s transport against %s.",
+                   benchmarkTRANSPORT_NAME,
+                   benchmarkconfigSERVER_HOST_NAME ) );
+
+        prvMeasureHandshakes( pdFALSE );
+
+        #if !defined( benchmarkTRANSPORT_PLAINTEXT )
+        {
+            prvMeasureHandshakes( pdTRUE );
+        }
+        #endif
+
+        for( x = 0; x < ( sizeof( xRecordSizes ) / sizeof( xRecordSizes[ 0 ] ) ); x++ )
+        {
+            configASSERT( xRecordSizes[ x ] <= benchmarkBUFFER_SIZE );
+            prvMeasureThroughput( xRecordSizes[ x ] );
+        }
+
+        #if defined( benchmarkCRYPTO_OFFLOAD )
+        {
+            CryptoOffloadCounters_t xCounters;
+
+            vCryptoOffload_GetCounters( &xCounters );
+            LogInfo( ( "RESULT %s offload: gcm=%u/%u sha256=%u/%u ecdh=%u/%u (backend/software)",
+                       benchmarkTRANSPORT_NAME,
+                       ( unsigned ) xCounters.ulGcmBackend,
+                       ( unsigned ) xCounters.ulGcmSoftware,
+                       ( unsigned ) xCounters.ulSha256Backend,
+                       ( unsigned ) xCounters.ulSha256Software,
+                       ( unsigned ) xCounters.ulEcdhBackend,
+                       ( unsigned ) xCounters.ulEcdhSoftware ) );
+        }
+        #endif
+
+        LogInfo( ( "Benchmark of the %s transport complete with %u failure(s).",
+                   benchmarkTRANSPORT_NAME,
+                   ( unsigned ) ulTotalFailures ) );
+    }
+    else
+    {
+        ulTotalFailures++;
+    }
+
+    /* The results have been printed, so end the process with an exit code
+     * that scripts comparing several builds can check. */
+    fflush( stdout );
+    exit( ( ulTotalFailures == 0U ) ? 0 : 1 );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTransportInit( void )
+{
+    BaseType_t xReturn = pdPASS;
+
+    /* Use the same TCP buffer sizes for every transport so only the cost of
+     * the transport itself differs between the builds. Window sizes and water
+     * marks are left to the defaults derived from the buffer sizes. */
+    memset( &xTcpSocketsOptions, 0, sizeof( xTcpSocketsOptions ) );
+    xTcpSocketsOptions.rxBufferSize = benchmarkconfigTCP_BUFFER_SIZE;
+    xTcpSocketsOptions.txBufferSize = benchmarkconfigTCP_BUFFER_SIZE;
+
+    #if defined( benchmarkTRANSPORT_PLAINTEXT )
+    {
+        xPlaintextTransportParams.pTcpSocketsOptions = &xTcpSocketsOptions;
+        xNetworkContext.pParams = &xPlaintextTransportParams;
+    }
+    #elif defined( benchmarkTRANSPORT_MBEDTLS )
+    {
+        xTlsTransportParams.pTcpSocketsOptions = &xTcpSocketsOptions;
+        xNetworkContext.pParams = &xTlsTransportParams;
+        mbedtls_ssl_session_init( &xSavedSession );
+
+        #if defined( benchmarkCRYPTO_OFFLOAD )
+        {
+            /* Route GCM, SHA-256 and ECDH through the offload layer. The
+             * software backend stands in for an accelerator, so the result
+             * shows the cost of the dispatch itself. */
+            vCryptoOffload_SetBackend( pxCryptoOffload_GetSoftwareBackend() );
+        }
+        #endif
+
+        memset( &xNetworkCredentials, 0, sizeof( xNetworkCredentials ) );
+
+        if( ( prvReadPemFile( benchmarkconfigROOT_CA_PATH,
+                              &( xNetworkCredentials.pRootCa ),
+                              &( xNetworkCredentials.rootCaSize ) ) != pdPASS ) ||
+            ( prvReadPemFile( benchmarkconfigCLIENT_CERT_PATH,
+                              &( xNetworkCredentials.pClientCert ),
+                              &( xNetworkCredentials.clientCertSize ) ) != pdPASS ) ||
+            ( prvReadPemFile( benchmarkconfigCLIENT_KEY_PATH,
+                              &( xNetworkCredentials.pPrivateKey ),
+                              &( xNetworkCredentials.privateKeySize ) ) != pdPASS ) )
+        {
+            xReturn = pdFAIL;
+        }
+    }
+    #else /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+    {
+        xNetworkContext.pTcpSocketsOptions = &xTcpSocketsOptions;
+
+        /* wolfSSL_Init() is called by the first connect, so the allocators
+         * are replaced before any wolfSSL memory is allocated. */
+        if( wolfSSL_SetAllocators( prvWolfSSLMalloc, prvWolfSSLFree, prvWolfSSLRealloc ) != 0 )
+        {
+            LogError( ( "Failed to set the wolfSSL allocators." ) );
+            xReturn = pdFAIL;
+        }
+
+        /* The wolfSSL transport loads the credentials from file. */
+        memset( &xNetworkCredentials, 0, sizeof( xNetworkCredentials ) );
+        xNetworkCredentials.pRootCa = ( const unsigned char * ) benchmarkconfigROOT_CA_PATH;
+        xNetworkCredentials.pClientCert = ( const unsigned char * ) benchmarkconfigCLIENT_CERT_PATH;
+        xNetworkCredentials.pPrivateKey = ( const unsigned char * ) benchmarkconfigCLIENT_KEY_PATH;
+    }
+    #endif /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTransportConnect( BaseType_t xResume )
+{
+    BaseType_t xReturn = pdFAIL;
+
+    #if defined( benchmarkTRANSPORT_PLAINTEXT )
+    {
+        ( void ) xResume;
+
+        if( Plaintext_FreeRTOS_Connect( &xNetworkContext,
+                                        benchmarkconfigSERVER_HOST_NAME,
+                                        benchmarkSERVER_PORT,
+                                        benchmarkconfigTRANSPORT_TIMEOUT_MS,
+                                        benchmarkconfigTRANSPORT_TIMEOUT_MS ) == PLAINTEXT_TRANSPORT_SUCCESS )
+        {
+            xReturn = pdPASS;
+        }
+    }
+    #else /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+    {
+        #if defined( benchmarkTRANSPORT_MBEDTLS )
+        {
+            xNetworkCredentials.pResumeSession = ( ( xResume == pdTRUE ) && ( xSessionSaved == pdTRUE ) ) ? &xSavedSession : NULL;
+        }
+        #else
+        {
+            xNetworkCredentials.pResumeSession = ( xResume == pdTRUE ) ? pxSavedSession : NULL;
+            xNetworkContext.sslContext.ctx = NULL;
+            xNetworkContext.sslContext.ssl = NULL;
+        }
+        #endif
+
+        if( TLS_FreeRTOS_Connect( &xNetworkContext,
+                                  benchmarkconfigSERVER_HOST_NAME,
+                                  benchmarkSERVER_PORT,
+                                  &xNetworkCredentials,
+                                  benchmarkconfigTRANSPORT_TIMEOUT_MS,
+                                  benchmarkconfigTRANSPORT_TIMEOUT_MS ) == TLS_TRANSPORT_SUCCESS )
+        {
+            xReturn = pdPASS;
+        }
+    }
+    #endif /* if defined( benchmarkTRANSPORT_PLAINTEXT ) */
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTransportDisconnect( void )
+{
+    #if defined( benchmarkTRANSPORT_PLAINTEXT )
+    {
+        ( void ) Plaintext_FreeRTOS_Disconnect( &xNetworkContext );
+    }
+    #else
+    {
+        TLS_FreeRTOS_Disconnect( &xNetworkContext );
+    }
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+static void prvSaveSession( void )
+{
+    #if defined( benchmarkTRANSPORT_MBEDTLS )
+    {
+        int lResult;
+
+        mbedtls_ssl_session_free( &xSavedSession );
+        mbedtls_ssl_session_init( &xSavedSession );
+
+        lResult = mbedtls_ssl_get_session( &( xTlsTransportParams.sslContext.context ), &xSavedSession );
+        xSessionSaved = ( lResult == 0 ) ? pdTRUE : pdFALSE;
+
+        if( lResult != 0 )
+        {
+            LogWarn( ( "Failed to save the session: mbedTLSError=-0x%04x.", ( unsigned ) -lResult ) );
+        }
+    }
+    #elif defined( benchmarkTRANSPORT_WOLFSSL )
+    {
+        if( pxSavedSession != NULL )
+        {
+            wolfSSL_SESSION_free( pxSavedSession );
+        }
+
+        pxSavedSession = wolfSSL_get1_session( xNetworkContext.sslContext.ssl );
+
+        if( pxSavedSession == NULL )
+        {
+            LogWarn( ( "Failed to save the session." ) );
+        }
+    }
+    #endif /* if defined( benchmarkTRANSPORT_MBEDTLS ) */
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvExchange( size_t xLength )
+{
+    BaseType_t xReturn = pdPASS;
+    size_t xSent = 0, xReceived = 0;
+    int32_t lResult;
+    TimeOut_t xTimeOut;
+    TickType_t xTicksToWait = pdMS_TO_TICKS( benchmarkconfigTRANSPORT_TIMEOUT_MS );
+
+    configASSERT( xLength <= benchmarkBUFFER_SIZE );
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    /* A return value of 0 means the transport timed out without making
+     * progress, which is only an error once the overall timeout expires. */
+    while( ( xReturn == pdPASS ) && ( xSent < xLength ) )
+    {
+        lResult = benchmarkTRANSPORT_SEND( &xNetworkContext, &( ucTxBuffer[ xSent ] ), xLength - xSent );
+
+        if( ( lResult < 0 ) ||
+            ( ( lResult == 0 ) && ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdTRUE ) ) )
+        {
+            LogError( ( "Failed to send %lu bytes, sent %lu.", ( unsigned long ) xLength, ( unsigned long ) xSent ) );
+            xReturn = pdFAIL;
+        }
+        else
+        {
+            xSent += ( size_t ) lResult;
+        }
+    }
+
+    while( ( xReturn == pdPASS ) && ( xReceived < xLength ) )
+    {
+        lResult = benchmarkTRANSPORT_RECV( &xNetworkContext, &( ucRxBuffer[ xReceived ] ), xLength - xReceived );
+
+        if( ( lResult < 0 ) ||
+            ( ( lResult == 0 ) && ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdTRUE ) ) )
+        {
+            LogError( ( "Failed to receive %lu bytes, received %lu.", ( unsigned long ) xLength, ( unsigned long ) xReceived ) );
+            xReturn = pdFAIL;
+        }
+        else
+        {
+            xReceived += ( size_t ) lResult;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvEcho( size_t xLength )
+{
+    BaseType_t xReturn;
+
+    xReturn = prvExchange( xLength );
+
+    if( ( xReturn == pdPASS ) && ( memcmp( ucTxBuffer, ucRxBuffer, xLength ) != 0 ) )
+    {
+        LogError( ( "Echoed data does not match the data sent." ) );
+        xReturn = pdFAIL;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReadSessionStatus( BaseType_t * pxResumed )
+{
+    BaseType_t xReturn;
+
+    /* Exchanging a byte also makes the client process TLS 1.3 session
+     * tickets, which the server sends after the handshake, before the session
+     * is saved. */
+    xReturn = prvExchange( 1 );
+
+    if( xReturn == pdPASS )
+    {
+        if( ucRxBuffer[ 0 ] == ( uint8_t ) 'R' )
+        {
+            *pxResumed = pdTRUE;
+        }
+        else if( ucRxBuffer[ 0 ] == ( uint8_t ) 'F' )
+        {
+            *pxResumed = pdFALSE;
+        }
+        else
+        {
+            LogError( ( "Unexpected session status 0x%02x, is tls_echo_server.py running?",
+                        ( unsigned ) ucRxBuffer[ 0 ] ) );
+            xReturn = pdFAIL;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMeasureHandshakes( BaseType_t xResume )
+{
+    BenchmarkStats_t xStats;
+    uint32_t ulIteration;
+    uint64_t ullStartNs, ullStartCpuNs, ullElapsedNs, ullCpuNs;
+    size_t xHeapPeak;
+    BaseType_t xResumed = pdFALSE;
+    const char * pcKind;
+
+    #if defined( benchmarkTRANSPORT_PLAINTEXT )
+        pcKind = "tcp_connect";
+    #else
+        pcKind = ( xResume == pdTRUE ) ? "handshake_resumed" : "handshake_full";
+    #endif
+
+    memset( &xStats, 0, sizeof( xStats ) );
+    xStats.ullMinNs = UINT64_MAX;
+
+    for( ulIteration = 0; ulIteration < benchmarkconfigHANDSHAKE_ITERATIONS; ulIteration++ )
+    {
+        prvResetHeapPeak();
+        ullStartCpuNs = prvGetTimeNs( CLOCK_PROCESS_CPUTIME_ID );
+        ullStartNs = prvGetTimeNs( CLOCK_MONOTONIC );
+
+        if( prvTransportConnect( xResume ) == pdPASS )
+        {
+            ullElapsedNs = prvGetTimeNs( CLOCK_MONOTONIC ) - ullStartNs;
+            ullCpuNs = prvGetTimeNs( CLOCK_PROCESS_CPUTIME_ID ) - ullStartCpuNs;
+
+            if( prvReadSessionStatus( &xResumed ) != pdPASS )
+            {
+                xStats.ulFailures++;
+            }
+            else if( ( xResume == pdTRUE ) && ( xResumed == pdFALSE ) )
+            {
+                /* A full handshake would skew the resumed timings. */
+                LogError( ( "The server did not resume the session." ) );
+                xStats.ulFailures++;
+                prvSaveSession();
+            }
+            else
+            {
+                xStats.ullTotalCpuNs += ullCpuNs;
+                xStats.ullTotalNs += ullElapsedNs;
+                xStats.ulCount++;
+
+                if( ullElapsedNs < xStats.ullMinNs )
+                {
+                    xStats.ullMinNs = ullElapsedNs;
+                }
+
+                if( ullElapsedNs > xStats.ullMaxNs )
+                {
+                    xStats.ullMaxNs = ullElapsedNs;
+                }
+
+                prvSaveSession();
+            }
+
+            xHeapPeak = prvGetHeapPeak();
+
+            if( xHeapPeak > xStats.xHeapPeak )
+            {
+                xStats.xHeapPeak = xHeapPeak;
+            }
+
+            prvTransportDisconnect();
+        }
+        else
+        {
+            xStats.ulFailures++;
+        }
+    }
+
+    ulTotalFailures += xStats.ulFailures;
+
+    if( xStats.ulCount > 0U )
+    {
+        LogInfo( ( "RESULT %s %s: n=%u failed=%u min=%.3f ms avg=%.3f ms max=%.3f ms cpu_avg=%.3f ms heap_peak=%lu bytes",
+                   benchmarkTRANSPORT_NAME,
+                   pcKind,
+                   ( unsigned ) xStats.ulCount,
+                   ( unsigned ) xStats.ulFailures,
+                   ( double ) xStats.ullMinNs / benchmarkNS_PER_MS,
+                   ( ( double ) xStats.ullTotalNs / xStats.ulCount ) / benchmarkNS_PER_MS,
+                   ( double ) xStats.ullMaxNs / benchmarkNS_PER_MS,
+                   ( ( double ) xStats.ullTotalCpuNs / xStats.ulCount ) / benchmarkNS_PER_MS,
+                   ( unsigned long ) xStats.xHeapPeak ) );
+    }
+    else
+    {
+        LogError( ( "RESULT %s %s: all %u connections failed.",
+                    benchmarkTRANSPORT_NAME,
+                    pcKind,
+                    ( unsigned ) xStats.ulFailures ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvMeasureThroughput( size_t xRecordSize )
+{
+    BaseType_t xResult;
+    size_t xRemaining = benchmarkconfigBULK_TRANSFER_BYTES, xChunk;
+    uint64_t ullStartNs, ullStartCpuNs, ullElapsedNs = 0, ullCpuNs = 0;
+    double dMegabytes;
+    BaseType_t xResumed;
+
+    prvResetHeapPeak();
+    xResult = prvTransportConnect( pdFALSE );
+
+    if( xResult == pdPASS )
+    {
+        /* The echo server answers the first byte with the session status. */
+        xResult = prvReadSessionStatus( &xResumed );
+
+        if( xResult == pdPASS )
+        {
+            ullStartCpuNs = prvGetTimeNs( CLOCK_PROCESS_CPUTIME_ID );
+            ullStartNs = prvGetTimeNs( CLOCK_MONOTONIC );
+
+            while( ( xResult == pdPASS ) && ( xRemaining > 0U ) )
+            {
+                xChunk = ( xRemaining < xRecordSize ) ? xRemaining : xRecordSize;
+                xResult = prvEcho( xChunk );
+                xRemaining -= xChunk;
+            }
+
+            ullElapsedNs = prvGetTimeNs( CLOCK_MONOTONIC ) - ullStartNs;
+            ullCpuNs = prvGetTimeNs( CLOCK_PROCESS_CPUTIME_ID ) - ullStartCpuNs;
+        }
+
+        prvTransportDisconnect();
+    }
+
+    if( ( xResult == pdPASS ) && ( ullElapsedNs > 0U ) )
+    {
+        dMegabytes = ( double ) benchmarkconfigBULK_TRANSFER_BYTES / benchmarkBYTES_PER_MB;
+
+        LogInfo( ( "RESULT %s throughput record=%lu: %.3f MB/s cpu=%.3f ms/MB heap_peak=%lu bytes",
+                   benchmarkTRANSPORT_NAME,
+                   ( unsigned long ) xRecordSize,
+                   dMegabytes / ( ( double ) ullElapsedNs / ( double ) benchmarkNS_PER_S ),
+                   ( ( double ) ullCpuNs / benchmarkNS_PER_MS ) / dMegabytes,
+                   ( unsigned long ) prvGetHeapPeak() ) );
+    }
+    else
+    {
+        ulTotalFailures++;
+        LogError( ( "RESULT %s throughput record=%lu: failed.",
+                    benchmarkTRANSPORT_NAME,
+                    ( unsigned long ) xRecordSize ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetTimeNs( clockid_t xClock )
+{
+    struct timespec xNow;
+
+    clock_gettime( xClock, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * benchmarkNS_PER_S ) + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvResetHeapPeak( void )
+{
+    xPortResetHeapMinimumEverFreeHeapSize();
+    xHeapFreeAtReset = xPortGetFreeHeapSize();
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvGetHeapPeak( void )
+{
+    return xHeapFreeAtReset - xPortGetMinimumEverFreeHeapSize();
+}
+/*-----------------------------------------------------------*/
+
+#if defined( benchmarkTRANSPORT_MBEDTLS )
+
+    static BaseType_t prvReadPemFile( const char * pcPath,
+                                      const uint8_t ** ppucBuffer,
+                                      size_t * pxSize )
+    {
+        BaseType_t xReturn = pdFAIL;
+        FILE * pxFile;
+        long lLength;
+        uint8_t * pucBuffer = NULL;
+
+        pxFile = fopen( pcPath, "rb" );
+
+        if( pxFile != NULL )
+        {
+            if( ( fseek( pxFile, 0, SEEK_END ) == 0 ) &&
+                ( ( lLength = ftell( pxFile ) ) > 0 ) &&
+                ( fseek( pxFile, 0, SEEK_SET ) == 0 ) )
+            {
+                /* The buffer is allocated with malloc() rather than from the
+                 * FreeRTOS heap so it does not count towards the measured heap
+                 * use. It is kept for the lifetime of the process. */
+                pucBuffer = malloc( ( size_t ) lLength + 1U );
+            }
+
+            if( ( pucBuffer != NULL ) &&
+                ( fread( pucBuffer, 1, ( size_t ) lLength, pxFile ) == ( size_t ) lLength ) )
+            {
+                /* mbedTLS requires PEM buffers to be NULL terminated, with
+                 * the terminator included in the size. */
+                pucBuffer[ lLength ] = '\0';
+                *ppucBuffer = pucBuffer;
+                *pxSize = ( size_t ) lLength + 1U;
+                xReturn = pdPASS;
+            }
+            else
+            {
+                free( pucBuffer );
+            }
+
+            ( void ) fclose( pxFile );
+        }
+
+        if( xReturn != pdPASS )
+        {
+            LogError( ( "Failed to read %s.", pcPath ) );
+        }
+
+        return xReturn;
+    }
+
+#endif /* defined( benchmarkTRANSPORT_MBEDTLS ) */
+/*-----------------------------------------------------------*/
+
+#if defined( benchmarkTRANSPORT_WOLFSSL )
+
+    static void * prvWolfSSLMalloc( size_t xSize )
+    {
+        uint8_t * pucBlock = pvPortMalloc( xSize + benchmarkALLOCATION_HEADER_SIZE );
+        void * pvReturn = NULL;
+
+        if( pucBlock != NULL )
+        {
+            *( ( size_t * ) pucBlock ) = xSize;
+            pvReturn = &( pucBlock[ benchmarkALLOCATION_HEADER_SIZE ] );
+        }
+
+        return pvReturn;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvWolfSSLFree( void * pvBuffer )
+    {
+        if( pvBuffer != NULL )
+        {
+            vPortFree( ( ( uint8_t * ) pvBuffer ) - benchmarkALLOCATION_HEADER_SIZE );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static void * prvWolfSSLRealloc( void * pvBuffer,
+                                     size_t xSize )
+    {
+        void * pvReturn = prvWolfSSLMalloc( xSize );
+        size_t xOldSize;
+
+        if( ( pvReturn != NULL ) && ( pvBuffer != NULL ) )
+        {
+            xOldSize = *( ( size_t * ) ( ( ( uint8_t * ) pvBuffer ) - benchmarkALLOCATION_HEADER_SIZE ) );
+            memcpy( pvReturn, pvBuffer, ( xOldSize < xSize ) ? xOldSize : xSize );
+            prvWolfSSLFree( pvBuffer );
+        }
+
+        return pvReturn;
+    }
+
+#endif /* defined( benchmarkTRANSPORT_WOLFSSL ) */
+/*-----------------------------------------------------------*/
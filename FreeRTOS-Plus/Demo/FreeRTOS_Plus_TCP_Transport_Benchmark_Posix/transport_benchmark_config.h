@@ -0,0 +1,125 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#ifndef TRANSPORT_BENCHMARK_CONFIG_H
+#define TRANSPORT_BENCHMARK_CONFIG_H
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Include logging header files and define logging macros in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for DEMO.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for DEMO.
+ */
+
+#include "logging_levels.h"
+
+/* Logging configuration for the Demo. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Benchmark"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Host name or IP address of the echo server.
+ *
+ * The libslirp network backend maps 10.0.2.2 to the loopback address of the
+ * host, so an echo server started on the host with tls_echo_server.py can be
+ * reached without any further network configuration.
+ */
+#define benchmarkconfigSERVER_HOST_NAME           "10.0.2.2"
+
+/**
+ * @brief Port of the plaintext echo server.
+ */
+#define benchmarkconfigPLAINTEXT_SERVER_PORT      ( 5000 )
+
+/**
+ * @brief Port of the TLS echo server.
+ */
+#define benchmarkconfigTLS_SERVER_PORT            ( 5443 )
+
+/**
+ * @brief Paths to the PEM files used by the TLS transports.
+ *
+ * The echo server requires a client certificate, as the wolfSSL transport
+ * always authenticates the client. README.txt describes how to generate a test
+ * certificate authority, server and client certificate with openssl. The
+ * server certificate's common name must be #benchmarkconfigSERVER_HOST_NAME.
+ */
+#define benchmarkconfigROOT_CA_PATH               "certs/ca.crt"
+#define benchmarkconfigCLIENT_CERT_PATH           "certs/client.crt"
+#define benchmarkconfigCLIENT_KEY_PATH            "certs/client.key"
+
+/**
+ * @brief Number of full and of resumed handshakes to time. The first resumed
+ * handshake reuses the session of the last full handshake. A resumed handshake
+ * that the server turns into a full one counts as a failure.
+ */
+#define benchmarkconfigHANDSHAKE_ITERATIONS       ( 10 )
+
+/**
+ * @brief Number of bytes echoed through the connection for every record size
+ * in #benchmarkconfigRECORD_SIZES.
+ */
+#define benchmarkconfigBULK_TRANSFER_BYTES        ( 1024UL * 1024UL )
+
+/**
+ * @brief Sizes, in bytes, of the writes made to the transport in the bulk
+ * throughput test. Each write is sent as a single TLS record when it is not
+ * larger than the negotiated maximum fragment length.
+ */
+#define benchmarkconfigRECORD_SIZES               { 64, 256, 1024, 4096, 16384 }
+
+/**
+ * @brief Size in bytes of the TCP stream buffers of the benchmark connection.
+ *
+ * Set to 0 to use ipconfigTCP_RX_BUFFER_LENGTH and ipconfigTCP_TX_BUFFER_LENGTH.
+ */
+#define benchmarkconfigTCP_BUFFER_SIZE            ( 32U * 1024U )
+
+/**
+ * @brief Timeout in milliseconds for transport send and receive calls.
+ */
+#define benchmarkconfigTRANSPORT_TIMEOUT_MS       ( 5000U )
+
+/**
+ * @brief Stack size and priority of the benchmark task.
+ */
+#define benchmarkconfigTASK_STACK_SIZE            ( configMINIMAL_STACK_SIZE * 4 )
+#define benchmarkconfigTASK_PRIORITY              ( tskIDLE_PRIORITY + 1 )
+
+#endif /* ifndef TRANSPORT_BENCHMARK_CONFIG_H */
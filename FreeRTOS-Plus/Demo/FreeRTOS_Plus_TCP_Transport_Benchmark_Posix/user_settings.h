@@ -0,0 +1,100 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ * wolfSSL build options for the transport benchmark. The cipher related
+ * options match the coreMQTT wolfSSL demo so both TLS libraries negotiate
+ * comparable cipher suites. Only the benchmark task uses wolfSSL, so it is
+ * built single threaded.
+ */
+
+#ifndef USER_SETTINGS_H
+#define USER_SETTINGS_H
+
+#define FREERTOS_TCP
+#define WOLFSSL_USER_IO
+#define USE_WOLFSSL_IO
+#define WOLFSSL_IGNORE_FILE_WARN
+#define SINGLE_THREADED
+
+/*-- Cipher related definitions  -----------------------------------------------
+ *
+ *
+ *----------------------------------------------------------------------------*/
+#define WOLFSSL_HAVE_MAX
+#define WOLFSSL_HAVE_MIN
+
+#define WOLFSSL_TLS13
+#define HAVE_TLS_EXTENSIONS
+
+#define HAVE_SUPPORTED_CURVES
+#define HAVE_FFDHE_2048
+
+#define TFM_TIMING_RESISTANT
+#define ECC_TIMING_RESISTANT
+#define WC_RSA_BLINDING
+
+#define HAVE_AESGCM
+#define HAVE_AESCCM
+#define HAVE_AES_ECB
+#define WOLFSSL_AES_COUNTER
+#define WOLFSSL_AES_DIRECT
+
+#define WOLFSSL_SHA512
+#define WOLFSSL_SHA384
+#define HAVE_HKDF
+#define HAVE_ECC
+#define TFM_ECC256
+#define ECC_SHAMIR
+#define WC_RSA_PSS
+#define WOLFSSL_BASE64_ENCODE
+#define HAVE_EXTENDED_MASTER
+#define HAVE_ENCRYPT_THEN_MAC
+#define HAVE_HASHDRBG
+#define HAVE_DH_DEFAULT_PARAMS
+
+#define USE_FAST_MATH
+#define WOLFSSL_X86_64_BUILD
+#define HAVE___UINT128_T    1
+
+/*-- Session resumption --------------------------------------------------------
+ *
+ * The client session cache is used for TLS 1.2 resumption and session tickets
+ * for TLS 1.3 resumption.
+ *
+ *----------------------------------------------------------------------------*/
+#define HAVE_SESSION_TICKET
+#define SMALL_SESSION_CACHE
+
+#define NO_DSA
+#define NO_HC128
+#define NO_RABBIT
+#define NO_RC4
+#define NO_PSK
+#define NO_MD4
+#define NO_PWDBASED
+
+#endif /* USER_SETTINGS_H */
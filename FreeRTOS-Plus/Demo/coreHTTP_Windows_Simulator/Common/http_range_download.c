@@ -0,0 +1,800 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file http_range_download.c
+ * @brief Parallel, pipelined HTTP range download. See http_range_download.h.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Demo Specific configs, for the logging macros. */
+#include "demo_config.h"
+
+#include "http_range_download.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Field name of the HTTP range header to read from the server response.
+ */
+#define httpdownloadCONTENT_RANGE_FIELD           "Content-Range"
+
+/**
+ * @brief Length of httpdownloadCONTENT_RANGE_FIELD.
+ */
+#define httpdownloadCONTENT_RANGE_FIELD_LENGTH    ( sizeof( httpdownloadCONTENT_RANGE_FIELD ) - 1 )
+
+/**
+ * @brief The HTTP status code returned for partial content.
+ */
+#define httpdownloadSTATUS_PARTIAL_CONTENT        ( 206U )
+
+/**
+ * @brief How long a connection with nothing to request waits before checking
+ * whether a range failed on another connection.
+ */
+#define httpdownloadIDLE_POLL_TICKS               ( pdMS_TO_TICKS( 10U ) )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Point the pipeline of a connection at the file, the transport of the
+ * configuration and the buffers of the connection.
+ */
+static void prvInitPipeline( RangeDownloadConnection_t * pxConnection );
+
+/**
+ * @brief Length of the next range to request on a connection.
+ */
+static size_t prvNextRangeLength( const RangeDownloadConnection_t * pxConnection );
+
+/**
+ * @brief Take the next range to request, a failed one first, and add it to
+ * the ranges in flight on the connection.
+ *
+ * @return pdTRUE if a range was taken; pdFALSE if none is left.
+ */
+static BaseType_t prvClaimRange( RangeDownloadConnection_t * pxConnection,
+                                 RangeDownloadRange_t * pxRange );
+
+/**
+ * @brief Request ranges until the pipeline of the connection is full.
+ *
+ * @param[in] pxConnection The connection.
+ * @param[out] ppxFailedRange The range in flight whose request could not be
+ * sent, or NULL.
+ *
+ * @return pdPASS on success; pdFAIL if a request could not be sent.
+ */
+static BaseType_t prvFillPipeline( RangeDownloadConnection_t * pxConnection,
+                                   RangeDownloadRange_t ** ppxFailedRange );
+
+/**
+ * @brief Read the response to the oldest request in flight on a connection.
+ *
+ * @param[in] pxConnection The connection.
+ * @param[out] pxResponse The response, valid until the next call.
+ *
+ * @return pdPASS if it holds the requested range; pdFAIL otherwise.
+ */
+static BaseType_t prvReceiveResponse( RangeDownloadConnection_t * pxConnection,
+                                      HTTPResponse_t * pxResponse );
+
+/**
+ * @brief Pass the range of the oldest request to the sink and retire it.
+ *
+ * @return pdPASS on success; pdFAIL if the sink failed.
+ */
+static BaseType_t prvCompleteRange( RangeDownloadConnection_t * pxConnection,
+                                    const HTTPResponse_t * pxResponse );
+
+/**
+ * @brief Close a connection and hand the ranges in flight on it to the other
+ * connections.
+ *
+ * @param[in] pxConnection The connection.
+ * @param[in] pxFailedRange The range in flight on the connection that caused
+ * the failure, which counts as an attempt for it, or NULL.
+ */
+static void prvAbandonConnection( RangeDownloadConnection_t * pxConnection,
+                                  RangeDownloadRange_t * pxFailedRange );
+
+/**
+ * @brief Whether any range is left to request.
+ */
+static BaseType_t prvWorkRemaining( RangeDownload_t * pxDownload );
+
+/**
+ * @brief Request the first byte of the file on the first connection, to read
+ * the size of the file from the Content-Range header of the response.
+ *
+ * @return pdPASS on success; pdFAIL otherwise.
+ */
+static BaseType_t prvRequestFileSize( RangeDownload_t * pxDownload );
+
+/**
+ * @brief Task servicing a connection until the file is downloaded.
+ *
+ * @param[in] pvParameters The #RangeDownloadConnection_t.
+ */
+static void prvConnectionTask( void * pvParameters );
+
+/*-----------------------------------------------------------*/
+
+static void prvInitPipeline( RangeDownloadConnection_t * pxConnection )
+{
+    const RangeDownloadConfig_t * pxConfig = &( pxConnection->pxDownload->xConfig );
+    HTTPPipeline_t * pxPipeline = &( pxConnection->xPipeline );
+
+    ( void ) memset( pxPipeline, 0, sizeof( HTTPPipeline_t ) );
+    pxPipeline->xTransport.pNetworkContext = pxConnection->pxNetworkContext;
+    pxPipeline->xTransport.send = pxConfig->xSend;
+    pxPipeline->xTransport.recv = pxConfig->xRecv;
+    pxPipeline->pcHost = pxConfig->pcHost;
+    pxPipeline->xHostLength = pxConfig->xHostLength;
+    pxPipeline->pcPath = pxConfig->pcPath;
+    pxPipeline->xPathLength = pxConfig->xPathLength;
+    pxPipeline->pucRequestBuffer = pxConnection->pucRequestBuffer;
+    pxPipeline->xRequestBufferLength = pxConnection->xRequestBufferLength;
+    pxPipeline->pucResponseBuffer = pxConnection->pucResponseBuffer;
+    pxPipeline->xResponseBufferLength = pxConnection->xResponseBufferLength;
+    vHTTPPipeline_Reset( pxPipeline );
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvNextRangeLength( const RangeDownloadConnection_t * pxConnection )
+{
+    const RangeDownloadConfig_t * pxConfig = &( pxConnection->pxDownload->xConfig );
+    uint64_t ullLength = pxConfig->xMinRangeLength;
+
+    if( pxConnection->ulBytesPerSecond != 0U )
+    {
+        ullLength = ( ( uint64_t ) pxConnection->ulBytesPerSecond * httpdownloadTARGET_RANGE_TIME_MS ) / 1000U;
+
+        if( ullLength < pxConfig->xMinRangeLength )
+        {
+            ullLength = pxConfig->xMinRangeLength;
+        }
+        else if( ullLength > pxConfig->xMaxRangeLength )
+        {
+            ullLength = pxConfig->xMaxRangeLength;
+        }
+    }
+
+    return ( size_t ) ullLength;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvClaimRange( RangeDownloadConnection_t * pxConnection,
+                                 RangeDownloadRange_t * pxRange )
+{
+    RangeDownload_t * pxDownload = pxConnection->pxDownload;
+    BaseType_t xClaimed = pdFALSE;
+    size_t xLength = prvNextRangeLength( pxConnection );
+    UBaseType_t uxSlot;
+
+    ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+
+    if( pxDownload->xFailed == pdFALSE )
+    {
+        if( pxDownload->uxRetryCount > 0U )
+        {
+            pxDownload->uxRetryCount--;
+            *pxRange = pxDownload->xRetry[ pxDownload->uxRetryCount ];
+            xClaimed = pdTRUE;
+        }
+        else if( pxDownload->xNextOffset < pxDownload->xFileSize )
+        {
+            if( xLength > ( pxDownload->xFileSize - pxDownload->xNextOffset ) )
+            {
+                xLength = pxDownload->xFileSize - pxDownload->xNextOffset;
+            }
+
+            pxRange->xStart = pxDownload->xNextOffset;
+            pxRange->xEnd = pxDownload->xNextOffset + xLength - 1U;
+            pxRange->uxAttempts = 0U;
+            pxDownload->xNextOffset += xLength;
+            xClaimed = pdTRUE;
+        }
+    }
+
+    /* The range is in flight from now on, so that it holds back the resume
+     * offset until it has been written to the sink. */
+    if( xClaimed == pdTRUE )
+    {
+        uxSlot = ( pxConnection->uxInFlightHead + pxConnection->uxInFlightCount ) % httpdownloadMAX_PIPELINE_DEPTH;
+        pxConnection->xInFlight[ uxSlot ] = *pxRange;
+        pxConnection->uxInFlightCount++;
+        pxDownload->uxInFlightTotal++;
+    }
+
+    ( void ) xSemaphoreGive( pxDownload->xLock );
+
+    return xClaimed;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFillPipeline( RangeDownloadConnection_t * pxConnection,
+                                   RangeDownloadRange_t ** ppxFailedRange )
+{
+    const RangeDownloadConfig_t * pxConfig = &( pxConnection->pxDownload->xConfig );
+    RangeDownloadRange_t xRange;
+    BaseType_t xStatus = pdPASS;
+    HTTPStatus_t xHTTPStatus;
+
+    *ppxFailedRange = NULL;
+
+    while( ( xStatus == pdPASS ) &&
+           ( pxConnection->uxInFlightCount < pxConfig->uxPipelineDepth ) )
+    {
+        /* Bandwidth is measured from when the connection starts to be busy. */
+        if( pxConnection->uxInFlightCount == 0U )
+        {
+            pxConnection->xLastCompletion = xTaskGetTickCount();
+        }
+
+        if( prvClaimRange( pxConnection, &xRange ) == pdFALSE )
+        {
+            break;
+        }
+
+        xHTTPStatus = xHTTPPipeline_Send( &( pxConnection->xPipeline ), xRange.xStart, xRange.xEnd );
+
+        /* The range just claimed is the newest in flight. */
+        if( xHTTPStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to send the request for bytes %u to %u: Error=%s.",
+                        ( unsigned ) xRange.xStart,
+                        ( unsigned ) xRange.xEnd,
+                        HTTPClient_strerror( xHTTPStatus ) ) );
+            xStatus = pdFAIL;
+            *ppxFailedRange = &( pxConnection->xInFlight[ ( pxConnection->uxInFlightHead + pxConnection->uxInFlightCount - 1U ) %
+                                                          httpdownloadMAX_PIPELINE_DEPTH ] );
+        }
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvReceiveResponse( RangeDownloadConnection_t * pxConnection,
+                                      HTTPResponse_t * pxResponse )
+{
+    const RangeDownloadRange_t * pxRange = &( pxConnection->xInFlight[ pxConnection->uxInFlightHead ] );
+    HTTPStatus_t xHTTPStatus;
+    BaseType_t xStatus = pdPASS;
+
+    xHTTPStatus = xHTTPPipeline_Receive( &( pxConnection->xPipeline ), pxRange->xStart, pxRange->xEnd, pxResponse );
+
+    if( xHTTPStatus != HTTPSuccess )
+    {
+        LogError( ( "Failed to receive the response for bytes %u to %u: Error=%s.",
+                    ( unsigned ) pxRange->xStart,
+                    ( unsigned ) pxRange->xEnd,
+                    HTTPClient_strerror( xHTTPStatus ) ) );
+        xStatus = pdFAIL;
+    }
+    else if( ( pxResponse->statusCode != httpdownloadSTATUS_PARTIAL_CONTENT ) ||
+             ( pxResponse->bodyLen != ( pxRange->xEnd - pxRange->xStart + 1U ) ) )
+    {
+        LogError( ( "Unexpected response for bytes %u to %u: Status=%u, Body length=%u.",
+                    ( unsigned ) pxRange->xStart,
+                    ( unsigned ) pxRange->xEnd,
+                    ( unsigned ) pxResponse->statusCode,
+                    ( unsigned ) pxResponse->bodyLen ) );
+        xStatus = pdFAIL;
+    }
+    else
+    {
+        /* Received the requested range. */
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCompleteRange( RangeDownloadConnection_t * pxConnection,
+                                    const HTTPResponse_t * pxResponse )
+{
+    RangeDownload_t * pxDownload = pxConnection->pxDownload;
+    const RangeDownloadRange_t * pxRange = &( pxConnection->xInFlight[ pxConnection->uxInFlightHead ] );
+    BaseType_t xStatus;
+    TickType_t xNow;
+    TickType_t xElapsed;
+    uint32_t ulSample;
+
+    ( void ) xSemaphoreTake( pxDownload->xSinkLock, portMAX_DELAY );
+    xStatus = pxDownload->xConfig.xSink( pxDownload->xConfig.pvSinkContext,
+                                         pxRange->xStart,
+                                         pxResponse->pBody,
+                                         pxResponse->bodyLen );
+    ( void ) xSemaphoreGive( pxDownload->xSinkLock );
+
+    if( xStatus != pdPASS )
+    {
+        LogError( ( "The sink failed to write bytes %u to %u.",
+                    ( unsigned ) pxRange->xStart,
+                    ( unsigned ) pxRange->xEnd ) );
+    }
+    else
+    {
+        /* The connection has been busy since the previous completion, so the
+         * time since then is the time this range took. */
+        xNow = xTaskGetTickCount();
+        xElapsed = xNow - pxConnection->xLastCompletion;
+        pxConnection->xLastCompletion = xNow;
+
+        if( xElapsed > 0U )
+        {
+            ulSample = ( uint32_t ) ( ( ( uint64_t ) pxResponse->bodyLen * configTICK_RATE_HZ ) / xElapsed );
+            pxConnection->ulBytesPerSecond = ( pxConnection->ulBytesPerSecond == 0U ) ? ulSample :
+                                             ( ( pxConnection->ulBytesPerSecond / 4U ) * 3U ) + ( ulSample / 4U );
+        }
+
+        ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+        pxConnection->uxInFlightHead = ( pxConnection->uxInFlightHead + 1U ) % httpdownloadMAX_PIPELINE_DEPTH;
+        pxConnection->uxInFlightCount--;
+        pxDownload->uxInFlightTotal--;
+        pxDownload->xBytesWritten += pxResponse->bodyLen;
+        ( void ) xSemaphoreGive( pxDownload->xLock );
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAbandonConnection( RangeDownloadConnection_t * pxConnection,
+                                  RangeDownloadRange_t * pxFailedRange )
+{
+    RangeDownload_t * pxDownload = pxConnection->pxDownload;
+
+    if( pxConnection->xConnected == pdTRUE )
+    {
+        pxDownload->xConfig.xDisconnect( pxConnection->pxNetworkContext );
+        pxConnection->xConnected = pdFALSE;
+    }
+
+    vHTTPPipeline_Reset( &( pxConnection->xPipeline ) );
+
+    ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+
+    if( pxFailedRange != NULL )
+    {
+        pxFailedRange->uxAttempts++;
+
+        if( pxFailedRange->uxAttempts >= httpdownloadMAX_RANGE_ATTEMPTS )
+        {
+            LogError( ( "Bytes %u to %u failed %u times. Stopping the download.",
+                        ( unsigned ) pxFailedRange->xStart,
+                        ( unsigned ) pxFailedRange->xEnd,
+                        ( unsigned ) pxFailedRange->uxAttempts ) );
+            pxDownload->xFailed = pdTRUE;
+        }
+    }
+
+    /* The retry list can hold every range that can be in flight. */
+    while( pxConnection->uxInFlightCount > 0U )
+    {
+        configASSERT( pxDownload->uxRetryCount < ( sizeof( pxDownload->xRetry ) / sizeof( pxDownload->xRetry[ 0 ] ) ) );
+        pxDownload->xRetry[ pxDownload->uxRetryCount ] = pxConnection->xInFlight[ pxConnection->uxInFlightHead ];
+        pxDownload->uxRetryCount++;
+        pxConnection->uxInFlightHead = ( pxConnection->uxInFlightHead + 1U ) % httpdownloadMAX_PIPELINE_DEPTH;
+        pxConnection->uxInFlightCount--;
+        pxDownload->uxInFlightTotal--;
+    }
+
+    ( void ) xSemaphoreGive( pxDownload->xLock );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWorkRemaining( RangeDownload_t * pxDownload )
+{
+    BaseType_t xRemaining;
+
+    ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+    xRemaining = ( ( pxDownload->xFailed == pdFALSE ) &&
+                   ( ( pxDownload->uxRetryCount > 0U ) ||
+                     ( pxDownload->xNextOffset < pxDownload->xFileSize ) ||
+                     ( pxDownload->uxInFlightTotal > 0U ) ) ) ? pdTRUE : pdFALSE;
+    ( void ) xSemaphoreGive( pxDownload->xLock );
+
+    return xRemaining;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRequestFileSize( RangeDownload_t * pxDownload )
+{
+    RangeDownloadConnection_t * pxConnection = &( pxDownload->pxConnections[ 0 ] );
+    HTTPResponse_t xResponse;
+    HTTPStatus_t xHTTPStatus;
+    const char * pcValue = NULL;
+    size_t xValueLength = 0U;
+    const char * pcSlash = NULL;
+    RangeDownloadRange_t * pxFailedRange = NULL;
+    BaseType_t xStatus;
+
+    /* Request bytes 0 to 0. The server responds with a Content-Range header of
+     * the form "bytes 0-0/FILESIZE". The byte of the body is ignored. */
+    pxDownload->xFileSize = 1U;
+    pxDownload->xNextOffset = 0U;
+    xStatus = connectToServerWithBackoffRetries( pxDownload->xConfig.xConnect,
+                                                 pxConnection->pxNetworkContext );
+
+    if( xStatus == pdPASS )
+    {
+        pxConnection->xConnected = pdTRUE;
+        xStatus = prvFillPipeline( pxConnection, &pxFailedRange );
+    }
+
+    if( xStatus == pdPASS )
+    {
+        xStatus = prvReceiveResponse( pxConnection, &xResponse );
+    }
+
+    if( xStatus == pdPASS )
+    {
+        xHTTPStatus = HTTPClient_ReadHeader( &xResponse,
+                                             httpdownloadCONTENT_RANGE_FIELD,
+                                             httpdownloadCONTENT_RANGE_FIELD_LENGTH,
+                                             &pcValue,
+                                             &xValueLength );
+
+        if( xHTTPStatus == HTTPSuccess )
+        {
+            pcSlash = memchr( pcValue, '/', xValueLength );
+        }
+
+        /* strtoul() stops at the CR ending the header value. */
+        if( pcSlash != NULL )
+        {
+            pxDownload->xFileSize = ( size_t ) strtoul( pcSlash + 1, NULL, 10 );
+        }
+
+        if( ( pcSlash == NULL ) || ( pxDownload->xFileSize == 0U ) || ( pxDownload->xFileSize == UINT32_MAX ) )
+        {
+            LogError( ( "Failed to read the file size from the Content-Range header." ) );
+            xStatus = pdFAIL;
+        }
+    }
+
+    /* The probe is not written to the sink, so the range is dropped rather
+     * than completed. */
+    pxConnection->uxInFlightCount = 0U;
+    pxConnection->uxInFlightHead = 0U;
+    pxDownload->uxInFlightTotal = 0U;
+
+    if( ( xStatus == pdPASS ) && ( ( xResponse.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U ) )
+    {
+        prvAbandonConnection( pxConnection, NULL );
+    }
+    else if( xStatus != pdPASS )
+    {
+        prvAbandonConnection( pxConnection, NULL );
+        pxDownload->xFileSize = 0U;
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvConnectionTask( void * pvParameters )
+{
+    RangeDownloadConnection_t * pxConnection = ( RangeDownloadConnection_t * ) pvParameters;
+    RangeDownload_t * pxDownload = pxConnection->pxDownload;
+    RangeDownloadRange_t * pxFailedRange = NULL;
+    HTTPResponse_t xResponse;
+
+    while( prvWorkRemaining( pxDownload ) == pdTRUE )
+    {
+        if( pxConnection->xConnected == pdFALSE )
+        {
+            if( connectToServerWithBackoffRetries( pxDownload->xConfig.xConnect,
+                                                   pxConnection->pxNetworkContext ) != pdPASS )
+            {
+                /* The other connections carry on without this one. */
+                LogError( ( "Failed to connect to %.*s. Closing a download connection.",
+                            ( int ) pxDownload->xConfig.xHostLength,
+                            pxDownload->xConfig.pcHost ) );
+                break;
+            }
+
+            pxConnection->xConnected = pdTRUE;
+        }
+
+        if( prvFillPipeline( pxConnection, &pxFailedRange ) != pdPASS )
+        {
+            prvAbandonConnection( pxConnection, pxFailedRange );
+        }
+        else if( pxConnection->uxInFlightCount == 0U )
+        {
+            /* Nothing left to request, but a range in flight elsewhere may
+             * still fail and need requesting again. */
+            vTaskDelay( httpdownloadIDLE_POLL_TICKS );
+        }
+        else if( prvReceiveResponse( pxConnection, &xResponse ) != pdPASS )
+        {
+            prvAbandonConnection( pxConnection, &( pxConnection->xInFlight[ pxConnection->uxInFlightHead ] ) );
+        }
+        else if( prvCompleteRange( pxConnection, &xResponse ) != pdPASS )
+        {
+            ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+            pxDownload->xFailed = pdTRUE;
+            ( void ) xSemaphoreGive( pxDownload->xLock );
+            prvAbandonConnection( pxConnection, NULL );
+        }
+        else if( ( xResponse.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U )
+        {
+            /* The requests written after this one will not be answered. */
+            LogInfo( ( "The server closed a download connection. Reconnecting." ) );
+            prvAbandonConnection( pxConnection, NULL );
+        }
+        else
+        {
+            /* Received a range. */
+        }
+    }
+
+    prvAbandonConnection( pxConnection, NULL );
+
+    xTaskNotifyGive( pxDownload->xWaitingTask );
+    vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRangeDownload_Init( RangeDownload_t * pxDownload,
+                                const RangeDownloadConfig_t * pxConfig,
+                                RangeDownloadConnection_t * pxConnections,
+                                UBaseType_t uxConnectionCount )
+{
+    BaseType_t xStatus = pdPASS;
+    UBaseType_t uxIdx;
+
+    configASSERT( pxDownload != NULL );
+    configASSERT( pxConfig != NULL );
+    configASSERT( pxConnections != NULL );
+
+    ( void ) memset( pxDownload, 0, sizeof( RangeDownload_t ) );
+    pxDownload->xConfig = *pxConfig;
+    pxDownload->pxConnections = pxConnections;
+    pxDownload->uxConnectionCount = uxConnectionCount;
+
+    if( ( uxConnectionCount == 0U ) || ( uxConnectionCount > httpdownloadMAX_CONNECTIONS ) ||
+        ( pxConfig->uxPipelineDepth == 0U ) || ( pxConfig->uxPipelineDepth > httpdownloadMAX_PIPELINE_DEPTH ) ||
+        ( pxConfig->xMinRangeLength == 0U ) || ( pxConfig->xMinRangeLength > pxConfig->xMaxRangeLength ) ||
+        ( pxConfig->xSink == NULL ) || ( pxConfig->xConnect == NULL ) || ( pxConfig->xDisconnect == NULL ) ||
+        ( pxConfig->xSend == NULL ) || ( pxConfig->xRecv == NULL ) )
+    {
+        LogError( ( "Invalid range download configuration." ) );
+        xStatus = pdFAIL;
+    }
+
+    for( uxIdx = 0U; ( xStatus == pdPASS ) && ( uxIdx < uxConnectionCount ); uxIdx++ )
+    {
+        if( ( pxConnections[ uxIdx ].pxNetworkContext == NULL ) ||
+            ( pxConnections[ uxIdx ].pucRequestBuffer == NULL ) ||
+            ( pxConnections[ uxIdx ].pucResponseBuffer == NULL ) ||
+            ( pxConnections[ uxIdx ].xResponseBufferLength < ( pxConfig->xMaxRangeLength + httpdownloadRESPONSE_HEADER_RESERVE ) ) )
+        {
+            LogError( ( "Download connection %u needs buffers and a response buffer of at least %u bytes.",
+                        ( unsigned ) uxIdx,
+                        ( unsigned ) ( pxConfig->xMaxRangeLength + httpdownloadRESPONSE_HEADER_RESERVE ) ) );
+            xStatus = pdFAIL;
+        }
+        else
+        {
+            pxConnections[ uxIdx ].pxDownload = pxDownload;
+            pxConnections[ uxIdx ].xConnected = pdFALSE;
+            prvInitPipeline( &( pxConnections[ uxIdx ] ) );
+        }
+    }
+
+    pxDownload->xFileSize = pxConfig->xFileSize;
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRangeDownload_Run( RangeDownload_t * pxDownload,
+                               size_t xStartOffset )
+{
+    BaseType_t xStatus = pdPASS;
+    RangeDownloadConnection_t * pxConnection;
+    UBaseType_t uxIdx;
+    UBaseType_t uxTasksCreated = 0U;
+    UBaseType_t uxTasksFinished = 0U;
+    TickType_t xStartTime;
+    TickType_t xElapsed;
+
+    configASSERT( pxDownload != NULL );
+    configASSERT( pxDownload->pxConnections != NULL );
+
+    pxDownload->xWaitingTask = xTaskGetCurrentTaskHandle();
+    pxDownload->xNextOffset = xStartOffset;
+    pxDownload->uxRetryCount = 0U;
+    pxDownload->uxInFlightTotal = 0U;
+    pxDownload->xBytesWritten = 0U;
+    pxDownload->xFailed = pdFALSE;
+
+    for( uxIdx = 0U; uxIdx < pxDownload->uxConnectionCount; uxIdx++ )
+    {
+        pxConnection = &( pxDownload->pxConnections[ uxIdx ] );
+        pxConnection->uxInFlightHead = 0U;
+        pxConnection->uxInFlightCount = 0U;
+        vHTTPPipeline_Reset( &( pxConnection->xPipeline ) );
+        pxConnection->ulBytesPerSecond = 0U;
+    }
+
+    pxDownload->xLock = xSemaphoreCreateMutex();
+    pxDownload->xSinkLock = xSemaphoreCreateMutex();
+
+    if( ( pxDownload->xLock == NULL ) || ( pxDownload->xSinkLock == NULL ) )
+    {
+        LogError( ( "Failed to create the range download mutexes." ) );
+        xStatus = pdFAIL;
+    }
+
+    if( ( xStatus == pdPASS ) && ( pxDownload->xFileSize == 0U ) )
+    {
+        xStatus = prvRequestFileSize( pxDownload );
+        pxDownload->xNextOffset = xStartOffset;
+    }
+
+    if( ( xStatus == pdPASS ) && ( xStartOffset > pxDownload->xFileSize ) )
+    {
+        LogError( ( "Resume offset %u is past the end of the %u byte file.",
+                    ( unsigned ) xStartOffset,
+                    ( unsigned ) pxDownload->xFileSize ) );
+        xStatus = pdFAIL;
+    }
+
+    if( xStatus == pdPASS )
+    {
+        LogInfo( ( "Downloading bytes %u to %u over %u connections.",
+                   ( unsigned ) xStartOffset,
+                   ( unsigned ) pxDownload->xFileSize,
+                   ( unsigned ) pxDownload->uxConnectionCount ) );
+
+        xStartTime = xTaskGetTickCount();
+
+        for( uxIdx = 0U; uxIdx < pxDownload->uxConnectionCount; uxIdx++ )
+        {
+            if( xTaskCreate( prvConnectionTask,
+                             "RangeDl",
+                             httpdownloadTASK_STACK_SIZE,
+                             &( pxDownload->pxConnections[ uxIdx ] ),
+                             httpdownloadTASK_PRIORITY,
+                             NULL ) == pdPASS )
+            {
+                uxTasksCreated++;
+            }
+            else
+            {
+                LogWarn( ( "Failed to create the task of download connection %u.",
+                           ( unsigned ) uxIdx ) );
+            }
+        }
+
+        while( uxTasksFinished < uxTasksCreated )
+        {
+            uxTasksFinished += ( UBaseType_t ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        }
+
+        xElapsed = xTaskGetTickCount() - xStartTime;
+
+        /* The first connection may still be open from prvRequestFileSize() if
+         * its task could not be created. */
+        prvAbandonConnection( &( pxDownload->pxConnections[ 0 ] ), NULL );
+
+        xStatus = ( ( pxDownload->xFailed == pdFALSE ) &&
+                    ( xRangeDownload_GetResumeOffset( pxDownload ) == pxDownload->xFileSize ) ) ? pdPASS : pdFAIL;
+
+        LogInfo( ( "Wrote %u bytes in %u ms. Resume offset is %u.",
+                   ( unsigned ) pxDownload->xBytesWritten,
+                   ( unsigned ) ( xElapsed * portTICK_PERIOD_MS ),
+                   ( unsigned ) xRangeDownload_GetResumeOffset( pxDownload ) ) );
+    }
+
+    if( pxDownload->xLock != NULL )
+    {
+        vSemaphoreDelete( pxDownload->xLock );
+        pxDownload->xLock = NULL;
+    }
+
+    if( pxDownload->xSinkLock != NULL )
+    {
+        vSemaphoreDelete( pxDownload->xSinkLock );
+        pxDownload->xSinkLock = NULL;
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+size_t xRangeDownload_GetResumeOffset( RangeDownload_t * pxDownload )
+{
+    const RangeDownloadConnection_t * pxConnection;
+    size_t xOffset;
+    UBaseType_t uxIdx;
+    UBaseType_t uxRange;
+    UBaseType_t uxSlot;
+
+    configASSERT( pxDownload != NULL );
+
+    /* The lock only exists while the download runs. */
+    if( pxDownload->xLock != NULL )
+    {
+        ( void ) xSemaphoreTake( pxDownload->xLock, portMAX_DELAY );
+    }
+
+    xOffset = pxDownload->xNextOffset;
+
+    for( uxIdx = 0U; uxIdx < pxDownload->uxRetryCount; uxIdx++ )
+    {
+        if( pxDownload->xRetry[ uxIdx ].xStart < xOffset )
+        {
+            xOffset = pxDownload->xRetry[ uxIdx ].xStart;
+        }
+    }
+
+    for( uxIdx = 0U; uxIdx < pxDownload->uxConnectionCount; uxIdx++ )
+    {
+        pxConnection = &( pxDownload->pxConnections[ uxIdx ] );
+
+        for( uxRange = 0U; uxRange < pxConnection->uxInFlightCount; uxRange++ )
+        {
+            uxSlot = ( pxConnection->uxInFlightHead + uxRange ) % httpdownloadMAX_PIPELINE_DEPTH;
+
+            if( pxConnection->xInFlight[ uxSlot ].xStart < xOffset )
+            {
+                xOffset = pxConnection->xInFlight[ uxSlot ].xStart;
+            }
+        }
+    }
+
+    if( pxDownload->xLock != NULL )
+    {
+        ( void ) xSemaphoreGive( pxDownload->xLock );
+    }
+
+    return xOffset;
+}
+/*-----------------------------------------------------------*/
+
+size_t xRangeDownload_GetFileSize( const RangeDownload_t * pxDownload )
+{
+    configASSERT( pxDownload != NULL );
+
+    return pxDownload->xFileSize;
+}
+/*-----------------------------------------------------------*/
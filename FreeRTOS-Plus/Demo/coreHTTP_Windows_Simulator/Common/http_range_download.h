@@ -0,0 +1,277 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file http_range_download.h
+ * @brief Download a file with HTTP range requests over several keep-alive
+ * connections at once.
+ *
+ * Each connection is serviced by its own task. A task keeps up to
+ * httpdownloadMAX_PIPELINE_DEPTH range requests in flight on its connection,
+ * writing the next request before the response to the previous one has been
+ * read, so that the round trip is not paid for every range. The length of
+ * each range follows the bandwidth measured on the connection, between the
+ * minimum and maximum lengths of the configuration.
+ *
+ * Completed ranges are passed to a sink as they arrive, which is generally
+ * not in file order. The sink is never called by two tasks at once.
+ *
+ * A range that fails is requested again, on whichever connection is free,
+ * and a connection that fails or is closed by the server is re-established.
+ * When a download stops short, xRangeDownload_GetResumeOffset() gives the
+ * offset below which every byte has been written to the sink, from which a
+ * later xRangeDownload_Run() can resume.
+ *
+ * The requests are written and the responses read with http_pipeline.h.
+ */
+
+#ifndef HTTP_RANGE_DOWNLOAD_H
+#define HTTP_RANGE_DOWNLOAD_H
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/* Pipelined HTTP requests. */
+#include "http_pipeline.h"
+
+/**
+ * @brief Largest number of connections of a download.
+ */
+#ifndef httpdownloadMAX_CONNECTIONS
+    #define httpdownloadMAX_CONNECTIONS         ( 4U )
+#endif
+
+/**
+ * @brief Largest number of range requests in flight on a connection.
+ */
+#ifndef httpdownloadMAX_PIPELINE_DEPTH
+    #define httpdownloadMAX_PIPELINE_DEPTH      ( 4U )
+#endif
+
+/**
+ * @brief Space kept in each response buffer for the response headers. The
+ * maximum range length plus this must fit in the response buffer.
+ */
+#ifndef httpdownloadRESPONSE_HEADER_RESERVE
+    #define httpdownloadRESPONSE_HEADER_RESERVE    ( 1024U )
+#endif
+
+/**
+ * @brief Time in milliseconds that receiving one range should take at the
+ * measured bandwidth. Longer ranges mean fewer requests, shorter ones less
+ * data to request again after an error.
+ */
+#ifndef httpdownloadTARGET_RANGE_TIME_MS
+    #define httpdownloadTARGET_RANGE_TIME_MS    ( 250U )
+#endif
+
+/**
+ * @brief Number of times a range is requested before the download fails.
+ */
+#ifndef httpdownloadMAX_RANGE_ATTEMPTS
+    #define httpdownloadMAX_RANGE_ATTEMPTS      ( 3U )
+#endif
+
+/**
+ * @brief Stack size and priority of the connection tasks.
+ */
+#ifndef httpdownloadTASK_STACK_SIZE
+    #define httpdownloadTASK_STACK_SIZE         ( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+#ifndef httpdownloadTASK_PRIORITY
+    #define httpdownloadTASK_PRIORITY           ( tskIDLE_PRIORITY + 1 )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Function pointer for closing a connection opened with a
+ * #TransportConnect_t.
+ *
+ * @param[in] pxNetworkContext Implementation-defined network context.
+ */
+typedef void ( * TransportDisconnect_t )( NetworkContext_t * pxNetworkContext );
+
+/**
+ * @brief Called with each range of the file that has been received.
+ *
+ * @param[in] pvSinkContext The context of the configuration.
+ * @param[in] xOffset Offset of pucData in the file.
+ * @param[in] pucData The data. Only valid during the call.
+ * @param[in] xLength Length of pucData.
+ *
+ * @return pdPASS if the data was written; pdFAIL to stop the download.
+ */
+typedef BaseType_t ( * RangeDownloadSink_t )( void * pvSinkContext,
+                                               size_t xOffset,
+                                               const uint8_t * pucData,
+                                               size_t xLength );
+
+/**
+ * @brief How to reach the file and where to write it.
+ */
+typedef struct RangeDownloadConfig
+{
+    const char * pcHost;             /**< @brief Host to send the requests to. */
+    size_t xHostLength;              /**< @brief Length of pcHost. */
+    const char * pcPath;             /**< @brief Path, including any query, of the file. */
+    size_t xPathLength;              /**< @brief Length of pcPath. */
+    TransportConnect_t xConnect;     /**< @brief Opens a connection to the host. */
+    TransportDisconnect_t xDisconnect;
+    TransportSend_t xSend;           /**< @brief Sends on a connection opened with xConnect. */
+    TransportRecv_t xRecv;           /**< @brief Receives on a connection opened with xConnect. */
+    RangeDownloadSink_t xSink;       /**< @brief Receives the data of the file. */
+    void * pvSinkContext;            /**< @brief Passed to xSink. */
+    size_t xFileSize;                /**< @brief Size of the file, or 0 to ask the server for it. */
+    size_t xMinRangeLength;          /**< @brief Length of the first ranges of each connection. */
+    size_t xMaxRangeLength;          /**< @brief Longest range ever requested. */
+    UBaseType_t uxPipelineDepth;     /**< @brief Requests in flight per connection, at most httpdownloadMAX_PIPELINE_DEPTH. */
+} RangeDownloadConfig_t;
+
+/**
+ * @brief A range of the file, from xStart to xEnd inclusive.
+ */
+typedef struct RangeDownloadRange
+{
+    size_t xStart;
+    size_t xEnd;
+    UBaseType_t uxAttempts;
+} RangeDownloadRange_t;
+
+struct RangeDownload;
+
+/**
+ * @brief A connection of a download.
+ *
+ * The caller sets the public members before xRangeDownload_Init(). The
+ * buffers are used by one connection only, so that the connections run in
+ * parallel. The other members are private to http_range_download.c.
+ */
+typedef struct RangeDownloadConnection
+{
+    NetworkContext_t * pxNetworkContext;
+    uint8_t * pucRequestBuffer;      /**< @brief Holds the headers of one request. */
+    size_t xRequestBufferLength;
+    uint8_t * pucResponseBuffer;     /**< @brief Holds one response, headers included. */
+    size_t xResponseBufferLength;
+
+    struct RangeDownload * pxDownload;
+    BaseType_t xConnected;
+    RangeDownloadRange_t xInFlight[ httpdownloadMAX_PIPELINE_DEPTH ];
+    UBaseType_t uxInFlightHead;
+    UBaseType_t uxInFlightCount;
+    HTTPPipeline_t xPipeline;        /**< @brief Writes the requests and reads the responses. */
+    uint32_t ulBytesPerSecond;       /**< @brief Smoothed bandwidth of the connection, 0 until measured. */
+    TickType_t xLastCompletion;      /**< @brief When the last response completed, or the pipeline started. */
+} RangeDownloadConnection_t;
+
+/**
+ * @brief A download. The members are private to http_range_download.c.
+ */
+typedef struct RangeDownload
+{
+    RangeDownloadConfig_t xConfig;
+    RangeDownloadConnection_t * pxConnections;
+    UBaseType_t uxConnectionCount;
+    SemaphoreHandle_t xLock;         /**< @brief Guards the members below and the in flight ranges. */
+    SemaphoreHandle_t xSinkLock;     /**< @brief Serializes the calls to the sink. */
+    TaskHandle_t xWaitingTask;
+    size_t xFileSize;
+    size_t xNextOffset;              /**< @brief Start of the part of the file never requested. */
+    RangeDownloadRange_t xRetry[ httpdownloadMAX_CONNECTIONS * httpdownloadMAX_PIPELINE_DEPTH ];
+    UBaseType_t uxRetryCount;
+    UBaseType_t uxInFlightTotal;
+    size_t xBytesWritten;
+    BaseType_t xFailed;
+} RangeDownload_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Prepare a download. Not thread safe.
+ *
+ * @param[out] pxDownload The download.
+ * @param[in] pxConfig The configuration, copied into pxDownload.
+ * @param[in] pxConnections The connections, with their public members set.
+ * Must stay in scope while the download is in use.
+ * @param[in] uxConnectionCount Number of entries in pxConnections, at most
+ * httpdownloadMAX_CONNECTIONS.
+ *
+ * @return pdPASS if the configuration is usable; pdFAIL otherwise.
+ */
+BaseType_t xRangeDownload_Init( RangeDownload_t * pxDownload,
+                                const RangeDownloadConfig_t * pxConfig,
+                                RangeDownloadConnection_t * pxConnections,
+                                UBaseType_t uxConnectionCount );
+
+/**
+ * @brief Download the file from xStartOffset to its end.
+ *
+ * Blocks the calling task, using its direct to task notification, until the
+ * connection tasks have finished.
+ *
+ * @param[in] pxDownload A download prepared with xRangeDownload_Init().
+ * @param[in] xStartOffset Offset to start from, 0 or an earlier value of
+ * xRangeDownload_GetResumeOffset().
+ *
+ * @return pdPASS if every byte from xStartOffset was written to the sink;
+ * pdFAIL otherwise.
+ */
+BaseType_t xRangeDownload_Run( RangeDownload_t * pxDownload,
+                               size_t xStartOffset );
+
+/**
+ * @brief Get the offset below which the file has been written to the sink.
+ *
+ * @param[in] pxDownload The download.
+ *
+ * @return The offset to resume from.
+ */
+size_t xRangeDownload_GetResumeOffset( RangeDownload_t * pxDownload );
+
+/**
+ * @brief Get the size of the file, known once xRangeDownload_Run() has been
+ * called.
+ *
+ * @param[in] pxDownload The download.
+ *
+ * @return The size of the file, or 0 if it is not known yet.
+ */
+size_t xRangeDownload_GetFileSize( const RangeDownload_t * pxDownload );
+
+#endif /* ifndef HTTP_RANGE_DOWNLOAD_H */
@@ -92,6 +92,9 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Parallel range download engine. */
+#include "http_range_download.h"
+
 /*------------- Demo configurations -------------------------*/
 
 /* Check that the root CA certificate is defined. */
@@ -129,6 +132,25 @@
     #define democonfigRANGE_REQUEST_LENGTH    ( 1024 )
 #endif
 
+/* Check whether the range download engine is used. */
+#ifndef democonfigUSE_RANGE_DOWNLOAD
+    #define democonfigUSE_RANGE_DOWNLOAD    ( 0 )
+#endif
+
+#if ( democonfigUSE_RANGE_DOWNLOAD == 1 )
+    #ifndef democonfigDOWNLOAD_CONNECTIONS
+        #define democonfigDOWNLOAD_CONNECTIONS         ( 3 )
+    #endif
+
+    #ifndef democonfigDOWNLOAD_PIPELINE_DEPTH
+        #define democonfigDOWNLOAD_PIPELINE_DEPTH      ( 3 )
+    #endif
+
+    #ifndef democonfigDOWNLOAD_MAX_RANGE_LENGTH
+        #define democonfigDOWNLOAD_MAX_RANGE_LENGTH    ( 16 * 1024 )
+    #endif
+#endif
+
 /**
  * @brief Length of the pre-signed GET URL defined in demo_config.h.
  */
@@ -333,6 +355,45 @@ static size_t xFileSize = 0;
  */
 static size_t xResponseCount = 0;
 
+#if ( democonfigUSE_RANGE_DOWNLOAD == 1 )
+
+/**
+ * @brief The TLS sessions of the range download engine, one per connection.
+ */
+    static TlsTransportParams_t xDownloadTlsTransportParams[ democonfigDOWNLOAD_CONNECTIONS ];
+
+/**
+ * @brief The network contexts of the range download engine.
+ */
+    static NetworkContext_t xDownloadNetworkContexts[ democonfigDOWNLOAD_CONNECTIONS ];
+
+/**
+ * @brief The request header buffers of the range download engine.
+ */
+    static uint8_t ucDownloadRequestBuffers[ democonfigDOWNLOAD_CONNECTIONS ][ democonfigUSER_BUFFER_LENGTH ];
+
+/**
+ * @brief The response buffers of the range download engine, each able to hold
+ * the longest range along with the response headers.
+ */
+    static uint8_t ucDownloadResponseBuffers[ democonfigDOWNLOAD_CONNECTIONS ][ democonfigDOWNLOAD_MAX_RANGE_LENGTH + httpdownloadRESPONSE_HEADER_RESERVE ];
+
+/**
+ * @brief The connections of the range download engine.
+ */
+    static RangeDownloadConnection_t xDownloadConnections[ democonfigDOWNLOAD_CONNECTIONS ];
+
+/**
+ * @brief The range download.
+ */
+    static RangeDownload_t xRangeDownload;
+
+/**
+ * @brief The offset to resume the download from if a demo iteration fails.
+ */
+    static size_t xDownloadResumeOffset = 0;
+#endif /* democonfigUSE_RANGE_DOWNLOAD == 1 */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -427,6 +488,26 @@ static void prvResponseTask( void * pvArgs );
  */
 static BaseType_t prvDownloadLoop( void );
 
+#if ( democonfigUSE_RANGE_DOWNLOAD == 1 )
+
+/**
+ * @brief Download the S3 file with the range download engine, resuming from
+ * where a previous call stopped.
+ *
+ * @return pdFAIL on failure; pdPASS on success.
+ */
+    static BaseType_t prvRangeDownload( void );
+
+/**
+ * @brief Sink of the range download engine. As this demo does not store the
+ * file, it only logs the ranges received.
+ */
+    static BaseType_t prvRangeDownloadSink( void * pvSinkContext,
+                                            size_t xOffset,
+                                            const uint8_t * pucData,
+                                            size_t xLength );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -548,62 +629,69 @@ static void prvHTTPDemoTask( void * pvParameters )
             }
         }
 
-        if( xDemoStatus == pdPASS )
-        {
-            /* Attempt to connect to the HTTP server. If connection fails, retry after a
-             * timeout. The timeout value will be exponentially increased until either the
-             * maximum number of attempts or the maximum timeout value is reached. The
-             * function returns pdFAIL if the TCP connection cannot be established with
-             * the server after the configured number of attempts. */
-            xDemoStatus = connectToServerWithBackoffRetries( prvConnectToServer,
-                                                             &xNetworkContext );
-        }
-
-        if( xDemoStatus == pdPASS )
-        {
-            /* Set a flag indicating that a TLS connection exists. */
-            xIsConnectionEstablished = pdTRUE;
-        }
-        else
-        {
-            /* Log an error to indicate connection failure after all reconnect
-             * attempts are over. */
-            LogError( ( "Failed to connect to HTTP server %s.",
-                        cServerHost ) );
-        }
-
-        /************* Open queues and create additional tasks. *************/
-        if( xDemoStatus == pdPASS )
-        {
-            /* Open request and response queues. */
-            xRequestQueue = xQueueCreate( democonfigQUEUE_SIZE,
-                                          sizeof( RequestItem_t ) );
-
-            xResponseQueue = xQueueCreate( democonfigQUEUE_SIZE,
-                                           sizeof( ResponseItem_t ) );
+        #if ( democonfigUSE_RANGE_DOWNLOAD == 0 )
+            if( xDemoStatus == pdPASS )
+            {
+                /* Attempt to connect to the HTTP server. If connection fails, retry after a
+                 * timeout. The timeout value will be exponentially increased until either the
+                 * maximum number of attempts or the maximum timeout value is reached. The
+                 * function returns pdFAIL if the TCP connection cannot be established with
+                 * the server after the configured number of attempts. */
+                xDemoStatus = connectToServerWithBackoffRetries( prvConnectToServer,
+                                                                 &xNetworkContext );
+            }
 
-            /* Open request and response tasks. */
-            xDemoStatus = xTaskCreate( prvRequestTask,
-                                       "RequestTask",
-                                       democonfigDEMO_STACKSIZE,
-                                       NULL,
-                                       tskIDLE_PRIORITY,
-                                       &xRequestTask );
+            if( xDemoStatus == pdPASS )
+            {
+                /* Set a flag indicating that a TLS connection exists. */
+                xIsConnectionEstablished = pdTRUE;
+            }
+            else
+            {
+                /* Log an error to indicate connection failure after all reconnect
+                 * attempts are over. */
+                LogError( ( "Failed to connect to HTTP server %s.",
+                            cServerHost ) );
+            }
 
-            xDemoStatus = xTaskCreate( prvResponseTask,
-                                       "ResponseTask",
-                                       democonfigDEMO_STACKSIZE,
-                                       NULL,
-                                       tskIDLE_PRIORITY,
-                                       &xResponseTask );
-        }
+            /************* Open queues and create additional tasks. *************/
+            if( xDemoStatus == pdPASS )
+            {
+                /* Open request and response queues. */
+                xRequestQueue = xQueueCreate( democonfigQUEUE_SIZE,
+                                              sizeof( RequestItem_t ) );
+
+                xResponseQueue = xQueueCreate( democonfigQUEUE_SIZE,
+                                               sizeof( ResponseItem_t ) );
+
+                /* Open request and response tasks. */
+                xDemoStatus = xTaskCreate( prvRequestTask,
+                                           "RequestTask",
+                                           democonfigDEMO_STACKSIZE,
+                                           NULL,
+                                           tskIDLE_PRIORITY,
+                                           &xRequestTask );
+
+                xDemoStatus = xTaskCreate( prvResponseTask,
+                                           "ResponseTask",
+                                           democonfigDEMO_STACKSIZE,
+                                           NULL,
+                                           tskIDLE_PRIORITY,
+                                           &xResponseTask );
+            }
+        #endif /* democonfigUSE_RANGE_DOWNLOAD == 0 */
 
         /******************** Download S3 Object File. **********************/
 
         if( xDemoStatus == pdPASS )
         {
-            /* Enter main HTTP task download loop. */
-            xDemoStatus = prvDownloadLoop();
+            #if ( democonfigUSE_RANGE_DOWNLOAD == 1 )
+                /* The range download engine opens its own connections. */
+                xDemoStatus = prvRangeDownload();
+            #else
+                /* Enter main HTTP task download loop. */
+                xDemoStatus = prvDownloadLoop();
+            #endif
         }
 
         /************************** Disconnect. *****************************/
@@ -1186,3 +1274,87 @@ static BaseType_t prvDownloadLoop( void )
 
     return xStatus;
 }
+
+/*-----------------------------------------------------------*/
+
+#if ( democonfigUSE_RANGE_DOWNLOAD == 1 )
+
+    static BaseType_t prvRangeDownload( void )
+    {
+        BaseType_t xStatus;
+        RangeDownloadConfig_t xConfig = { 0 };
+        UBaseType_t uxIdx;
+
+        for( uxIdx = 0; uxIdx < democonfigDOWNLOAD_CONNECTIONS; uxIdx++ )
+        {
+            xDownloadNetworkContexts[ uxIdx ].pParams = &( xDownloadTlsTransportParams[ uxIdx ] );
+            xDownloadConnections[ uxIdx ].pxNetworkContext = &( xDownloadNetworkContexts[ uxIdx ] );
+            xDownloadConnections[ uxIdx ].pucRequestBuffer = ucDownloadRequestBuffers[ uxIdx ];
+            xDownloadConnections[ uxIdx ].xRequestBufferLength = sizeof( ucDownloadRequestBuffers[ uxIdx ] );
+            xDownloadConnections[ uxIdx ].pucResponseBuffer = ucDownloadResponseBuffers[ uxIdx ];
+            xDownloadConnections[ uxIdx ].xResponseBufferLength = sizeof( ucDownloadResponseBuffers[ uxIdx ] );
+        }
+
+        /* The path used for the requests in this demo requires all the query
+         * information following the location of the object, to the end of the
+         * S3 presigned URL. */
+        xConfig.pcHost = cServerHost;
+        xConfig.xHostLength = xServerHostLength;
+        xConfig.pcPath = pcPath;
+        xConfig.xPathLength = strlen( pcPath );
+        xConfig.xConnect = prvConnectToServer;
+        xConfig.xDisconnect = TLS_FreeRTOS_Disconnect;
+        xConfig.xSend = TLS_FreeRTOS_send;
+        xConfig.xRecv = TLS_FreeRTOS_recv;
+        xConfig.xSink = prvRangeDownloadSink;
+        xConfig.pvSinkContext = NULL;
+        xConfig.xFileSize = xFileSize;
+        xConfig.xMinRangeLength = democonfigRANGE_REQUEST_LENGTH;
+        xConfig.xMaxRangeLength = democonfigDOWNLOAD_MAX_RANGE_LENGTH;
+        xConfig.uxPipelineDepth = democonfigDOWNLOAD_PIPELINE_DEPTH;
+
+        xStatus = xRangeDownload_Init( &xRangeDownload,
+                                       &xConfig,
+                                       xDownloadConnections,
+                                       democonfigDOWNLOAD_CONNECTIONS );
+
+        if( xStatus == pdPASS )
+        {
+            if( xDownloadResumeOffset != 0 )
+            {
+                LogInfo( ( "Resuming the download from byte %u.",
+                           ( unsigned ) xDownloadResumeOffset ) );
+            }
+
+            xStatus = xRangeDownload_Run( &xRangeDownload, xDownloadResumeOffset );
+
+            /* Remember how much of the file was received, so that the next
+             * demo iteration does not download it again. */
+            xFileSize = xRangeDownload_GetFileSize( &xRangeDownload );
+            xDownloadResumeOffset = ( xStatus == pdPASS ) ? 0 : xRangeDownload_GetResumeOffset( &xRangeDownload );
+        }
+
+        return xStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvRangeDownloadSink( void * pvSinkContext,
+                                            size_t xOffset,
+                                            const uint8_t * pucData,
+                                            size_t xLength )
+    {
+        ( void ) pvSinkContext;
+        ( void ) pucData;
+
+        LogInfo( ( "Received bytes %u to %u of the S3 object.",
+                   ( unsigned ) xOffset,
+                   ( unsigned ) ( xOffset + xLength - 1 ) ) );
+        LogDebug( ( "Response Body:\n%.*s\n",
+                    ( int32_t ) xLength,
+                    pucData ) );
+
+        return pdPASS;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* democonfigUSE_RANGE_DOWNLOAD == 1 */
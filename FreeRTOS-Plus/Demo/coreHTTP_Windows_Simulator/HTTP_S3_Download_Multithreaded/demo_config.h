@@ -141,6 +141,35 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigQUEUE_SIZE                        ( 10 )
 
+/**
+ * @brief Set to 1 to download the file with the range download engine of
+ * Common/http_range_download.c instead of the request and response tasks.
+ *
+ * The engine requests ranges over democonfigDOWNLOAD_CONNECTIONS connections
+ * at once, with up to democonfigDOWNLOAD_PIPELINE_DEPTH requests in flight on
+ * each, and sizes the ranges to the bandwidth of each connection. A failed
+ * demo iteration resumes from where the previous one stopped.
+ */
+#define democonfigUSE_RANGE_DOWNLOAD                ( 0 )
+
+/**
+ * @brief Number of connections used by the range download engine.
+ */
+#define democonfigDOWNLOAD_CONNECTIONS              ( 3 )
+
+/**
+ * @brief Number of range requests in flight on each connection of the range
+ * download engine.
+ */
+#define democonfigDOWNLOAD_PIPELINE_DEPTH           ( 3 )
+
+/**
+ * @brief Longest range requested by the range download engine. Each
+ * connection needs a response buffer of this size plus
+ * httpdownloadRESPONSE_HEADER_RESERVE.
+ */
+#define democonfigDOWNLOAD_MAX_RANGE_LENGTH         ( 16 * 1024 )
+
 /**
  * @brief Set the stack size of the main demo task.
  *
@@ -75,8 +75,11 @@
 #include "core_mqtt_agent.h"
 
 /* MQTT Agent ports. */
-#include "freertos_agent_message.h"
+#include "freertos_agent_message_mpsc.h"
 #include "freertos_command_pool.h"
+#if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 )
+    #include "freertos_agent_multiplex.h"
+#endif
 
 /* Exponential backoff retry include. */
 #include "backoff_algorithm.h"
@@ -183,6 +186,46 @@
     #define MQTT_AGENT_COMMAND_QUEUE_LENGTH    ( 10U )
 #endif
 
+/**
+ * @brief The number of slots in the agent's command ring. Must be a power of
+ * two no smaller than MQTT_AGENT_COMMAND_QUEUE_LENGTH.
+ */
+#ifndef democonfigMQTT_AGENT_COMMAND_RING_LENGTH
+    #define democonfigMQTT_AGENT_COMMAND_RING_LENGTH    ( 16U )
+#endif
+
+/**
+ * @brief Set to 1 to have the agent serialize queued publishes back to back
+ * and write them to the network together.
+ */
+#ifndef democonfigMQTT_AGENT_COALESCE_SENDS
+    #define democonfigMQTT_AGENT_COALESCE_SENDS    0
+#endif
+
+#if ( democonfigMQTT_AGENT_COALESCE_SENDS == 1 )
+
+/**
+ * @brief Longest time the agent may hold a coalesced publish waiting for more
+ * to send with it. Incoming packets are not read in that time either.
+ *
+ * @note Specified in milliseconds. 0 only coalesces publishes that are queued
+ * back to back, and writes them out as soon as the agent is idle.
+ */
+    #ifndef democonfigMQTT_AGENT_COALESCE_FLUSH_LATENCY_MS
+        #define democonfigMQTT_AGENT_COALESCE_FLUSH_LATENCY_MS    ( 5U )
+    #endif
+
+/**
+ * @brief Coalesced publishes are written out as soon as they fill this many
+ * bytes, regardless of the flush latency.
+ *
+ * @note Must not exceed MQTT_AGENT_NETWORK_BUFFER_SIZE.
+ */
+    #ifndef democonfigMQTT_AGENT_COALESCE_FLUSH_THRESHOLD
+        #define democonfigMQTT_AGENT_COALESCE_FLUSH_THRESHOLD    ( 1400U )
+    #endif
+#endif /* if ( democonfigMQTT_AGENT_COALESCE_SENDS == 1 ) */
+
 
 /**
  * These configuration settings are required to run the demo.
@@ -350,8 +393,9 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pMqttAgentContext,
  * enqueue commands to the MQTT Agent queue and will be processed once the
  * command loop starts.
  *
- * @return `MQTTSuccess` if adding subscribes to the command queue succeeds, else
- * appropriate error code from MQTTAgent_Subscribe.
+ * @return `MQTTSuccess` if adding subscribes to the command queue succeeds,
+ * `MQTTNoMemory` if the subscribe list cannot be allocated, else appropriate
+ * error code from MQTTAgent_Subscribe.
  * */
 static MQTTStatus_t prvHandleResubscribe( void );
 
@@ -453,16 +497,26 @@ static uint8_t xNetworkBuffer[ MQTT_AGENT_NETWORK_BUFFER_SIZE ];
 
 static MQTTAgentMessageContext_t xCommandQueue;
 
+#if ( democonfigMQTT_AGENT_COALESCE_SENDS == 1 )
+
 /**
- * @brief The global array of subscription elements.
+ * @brief Buffer the agent serializes publishes into before writing them out.
  *
- * @note No thread safety is required to this array, since the updates the array
- * elements are done only from one task at a time. The subscription manager
- * implementation expects that the array of the subscription elements used for
- * storing subscriptions to be initialized to 0. As this is a global array, it
- * will be initialized to 0 by default.
+ * @note coreMQTT serializes each packet at the start of xNetworkBuffer, so the
+ * packets are gathered here rather than in the network buffer itself.
  */
-SubscriptionElement_t xGlobalSubscriptionList[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
+    static uint8_t xCoalesceBuffer[ MQTT_AGENT_NETWORK_BUFFER_SIZE ];
+#endif
+
+/**
+ * @brief The global subscription manager.
+ *
+ * @note No thread safety is required to this structure, since the subscriptions
+ * are updated only from one task at a time. The subscription manager
+ * implementation expects the structure to be initialized to 0. As this is a
+ * global variable, it will be initialized to 0 by default.
+ */
+SubscriptionManager_t xGlobalSubscriptionManager;
 
 /*-----------------------------------------------------------*/
 
@@ -491,6 +545,7 @@ static MQTTStatus_t prvMQTTInit( void )
     MQTTFixedBuffer_t xFixedBuffer = { .pBuffer = xNetworkBuffer, .size = MQTT_AGENT_NETWORK_BUFFER_SIZE };
     static uint8_t staticQueueStorageArea[ MQTT_AGENT_COMMAND_QUEUE_LENGTH * sizeof( MQTTAgentCommand_t * ) ];
     static StaticQueue_t staticQueueStructure;
+    static AgentMessageSlot_t xCommandRing[ democonfigMQTT_AGENT_COMMAND_RING_LENGTH ];
     MQTTAgentMessageInterface_t messageInterface =
     {
         .pMsgCtx        = NULL,
@@ -501,9 +556,7 @@ static MQTTStatus_t prvMQTTInit( void )
     };
 
     LogDebug( ( "Creating command queue." ) );
-    xCommandQueue.queue = xQueueCreate( MQTT_AGENT_COMMAND_QUEUE_LENGTH,
-                                        sizeof( MQTTAgentCommand_t * ) );
-    configASSERT( xCommandQueue.queue );
+    Agent_MessageInit( &xCommandQueue, xCommandRing, democonfigMQTT_AGENT_COMMAND_RING_LENGTH );
     messageInterface.pMsgCtx = &xCommandQueue;
 
     /* Initialize the task pool. */
@@ -521,6 +574,15 @@ static MQTTStatus_t prvMQTTInit( void )
         xTransport.writev = NULL;
     #endif
 
+    #if ( democonfigMQTT_AGENT_COALESCE_SENDS == 1 )
+        /* Route the agent's sends through the message context so that queued
+         * publishes leave in as few transport writes as possible. */
+        Agent_MessageEnableSendCoalescing( &xCommandQueue, &xTransport, xCoalesceBuffer, sizeof( xCoalesceBuffer ) );
+        Agent_MessageSetCoalescingLimits( &xCommandQueue,
+                                          democonfigMQTT_AGENT_COALESCE_FLUSH_LATENCY_MS,
+                                          democonfigMQTT_AGENT_COALESCE_FLUSH_THRESHOLD );
+    #endif
+
     /* Initialize MQTT library. */
     xReturn = MQTTAgent_Init( &xGlobalMqttAgentContext,
                               &messageInterface,
@@ -528,8 +590,8 @@ static MQTTStatus_t prvMQTTInit( void )
                               &xTransport,
                               prvGetTimeMs,
                               prvIncomingPublishCallback,
-                              /* Context to pass into the callback. Passing the pointer to subscription array. */
-                              xGlobalSubscriptionList );
+                              /* Context to pass into the callback. Passing the pointer to the subscription manager. */
+                              &xGlobalSubscriptionManager );
 
     return xReturn;
 }
@@ -611,41 +673,52 @@ static MQTTStatus_t prvMQTTConnect( bool xCleanSession )
 
 static MQTTStatus_t prvHandleResubscribe( void )
 {
-    MQTTStatus_t xResult = MQTTBadParameter;
-    uint32_t ulIndex = 0U;
-    uint16_t usNumSubscriptions = 0U;
-
-    /* These variables need to stay in scope until command completes. */
+    /* Resubscribing is a success if there is nothing to subscribe to. */
+    MQTTStatus_t xResult = MQTTSuccess;
+    const SubscriptionElement_t * pxSubscription = NULL;
+    MQTTSubscribeInfo_t * pxSubInfo = NULL;
+    size_t xNumSubscriptions = 0U;
+
+    /* These variables need to stay in scope until command completes. The
+     * subscribe info array is freed by prvSubscriptionCommandCallback(). */
     static MQTTAgentSubscribeArgs_t xSubArgs = { 0 };
-    static MQTTSubscribeInfo_t xSubInfo[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ] = { 0 };
     static MQTTAgentCommandInfo_t xCommandParams = { 0 };
 
-    /* Loop through each subscription in the subscription list and add a subscribe
-     * command to the command queue. */
-    for( ulIndex = 0U; ulIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; ulIndex++ )
+    if( xGlobalSubscriptionManager.xSubscriptionCount > 0U )
     {
-        /* Check if there is a subscription in the subscription list. This demo
-         * doesn't check for duplicate subscriptions. */
-        if( xGlobalSubscriptionList[ ulIndex ].usFilterStringLength != 0 )
+        pxSubInfo = pvPortMalloc( sizeof( MQTTSubscribeInfo_t ) * xGlobalSubscriptionManager.xSubscriptionCount );
+
+        if( pxSubInfo == NULL )
         {
-            xSubInfo[ usNumSubscriptions ].pTopicFilter = xGlobalSubscriptionList[ ulIndex ].pcSubscriptionFilterString;
-            xSubInfo[ usNumSubscriptions ].topicFilterLength = xGlobalSubscriptionList[ ulIndex ].usFilterStringLength;
+            xResult = MQTTNoMemory;
+        }
+    }
 
-            /* QoS1 is used for all the subscriptions in this demo. */
-            xSubInfo[ usNumSubscriptions ].qos = MQTTQoS1;
+    /* Loop through each subscription held by the subscription manager and add
+     * a subscribe command to the command queue. This demo doesn't check for
+     * duplicate subscriptions. */
+    for( pxSubscription = xGlobalSubscriptionManager.pxSubscriptions;
+         ( pxSubscription != NULL ) && ( pxSubInfo != NULL ) &&
+         ( xNumSubscriptions < xGlobalSubscriptionManager.xSubscriptionCount );
+         pxSubscription = pxSubscription->pxNext )
+    {
+        pxSubInfo[ xNumSubscriptions ].pTopicFilter = pxSubscription->pcSubscriptionFilterString;
+        pxSubInfo[ xNumSubscriptions ].topicFilterLength = pxSubscription->usFilterStringLength;
 
-            LogInfo( ( "Resubscribe to the topic %.*s will be attempted.",
-                       xSubInfo[ usNumSubscriptions ].topicFilterLength,
-                       xSubInfo[ usNumSubscriptions ].pTopicFilter ) );
+        /* QoS1 is used for all the subscriptions in this demo. */
+        pxSubInfo[ xNumSubscriptions ].qos = MQTTQoS1;
 
-            usNumSubscriptions++;
-        }
+        LogInfo( ( "Resubscribe to the topic %.*s will be attempted.",
+                   pxSubInfo[ xNumSubscriptions ].topicFilterLength,
+                   pxSubInfo[ xNumSubscriptions ].pTopicFilter ) );
+
+        xNumSubscriptions++;
     }
 
-    if( usNumSubscriptions > 0U )
+    if( xNumSubscriptions > 0U )
     {
-        xSubArgs.pSubscribeInfo = xSubInfo;
-        xSubArgs.numSubscriptions = usNumSubscriptions;
+        xSubArgs.pSubscribeInfo = pxSubInfo;
+        xSubArgs.numSubscriptions = xNumSubscriptions;
 
         /* The block time can be 0 as the command loop is not running at this point. */
         xCommandParams.blockTimeMs = 0U;
@@ -656,16 +729,22 @@ static MQTTStatus_t prvHandleResubscribe( void )
          * when command loop starts. */
         xResult = MQTTAgent_Subscribe( &xGlobalMqttAgentContext, &xSubArgs, &xCommandParams );
     }
-    else
-    {
-        /* Mark the resubscribe as success if there is nothing to be subscribed. */
-        xResult = MQTTSuccess;
-    }
 
     if( xResult != MQTTSuccess )
     {
         LogError( ( "Failed to enqueue the MQTT subscribe command. xResult=%s.",
                     MQTT_Status_strerror( xResult ) ) );
+        vPortFree( pxSubInfo );
+    }
+    else if( xNumSubscriptions == 0U )
+    {
+        /* Nothing was handed to the agent, so the list is not freed by the
+         * subscribe completion callback. */
+        vPortFree( pxSubInfo );
+    }
+    else
+    {
+        /* The list is freed by prvSubscriptionCommandCallback(). */
     }
 
     return xResult;
@@ -693,7 +772,7 @@ static void prvSubscriptionCommandCallback( void * pxCommandContext,
                             pxSubscribeArgs->pSubscribeInfo[ lIndex ].topicFilterLength,
                             pxSubscribeArgs->pSubscribeInfo[ lIndex ].pTopicFilter ) );
                 /* Remove subscription callback for unsubscribe. */
-                removeSubscription( xGlobalSubscriptionList,
+                removeSubscription( &xGlobalSubscriptionManager,
                                     pxSubscribeArgs->pSubscribeInfo[ lIndex ].pTopicFilter,
                                     pxSubscribeArgs->pSubscribeInfo[ lIndex ].topicFilterLength );
             }
@@ -703,6 +782,9 @@ static void prvSubscriptionCommandCallback( void * pxCommandContext,
          * the subscriptions. This logic will be updated with exponential backoff and retry.  */
         configASSERT( pdTRUE );
     }
+
+    vPortFree( pxSubscribeArgs->pSubscribeInfo );
+    pxSubscribeArgs->pSubscribeInfo = NULL;
 }
 
 /*-----------------------------------------------------------*/
@@ -896,12 +978,26 @@ static void prvMQTTClientSocketWakeupCallback( Socket_t pxSocket )
 
     /* A socket used by the MQTT task may need attention.  Send an event
      * to the MQTT task to make sure the task is not blocked on xCommandQueue. */
-    if( ( uxQueueMessagesWaiting( xCommandQueue.queue ) == 0U ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
-    {
-        /* Don't block as this is called from the context of the IP task. */
-        xCommandParams.blockTimeMs = 0U;
-        MQTTAgent_ProcessLoop( &xGlobalMqttAgentContext, &xCommandParams );
-    }
+    #if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 )
+        /* The multiplexing task only needs to know which connection to
+         * read, so no command is needed. */
+        ( void ) xCommandParams;
+
+        if( FreeRTOS_recvcount( pxSocket ) > 0 )
+        {
+            Agent_MultiplexNotify( &xGlobalMqttAgentContext );
+        }
+    #else /* if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 ) */
+        /* A waiting command, including a process loop queued by an earlier
+         * wakeup, already makes the agent read the socket.  Queuing one per
+         * received segment would only drain the command pool. */
+        if( ( Agent_MessageCommandWaiting( &xCommandQueue ) == false ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
+        {
+            /* Don't block as this is called from the context of the IP task. */
+            xCommandParams.blockTimeMs = 0U;
+            MQTTAgent_ProcessLoop( &xGlobalMqttAgentContext, &xCommandParams );
+        }
+    #endif /* if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 ) */
 }
 
 /*-----------------------------------------------------------*/
@@ -917,7 +1013,7 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pMqttAgentContext,
 
     /* Fan out the incoming publishes to the callbacks registered using
      * subscription manager. */
-    xPublishHandled = handleIncomingPublishes( ( SubscriptionElement_t * ) pMqttAgentContext->pIncomingCallbackContext,
+    xPublishHandled = handleIncomingPublishes( ( SubscriptionManager_t * ) pMqttAgentContext->pIncomingCallbackContext,
                                                pxPublishInfo );
 
     /* If there are no callbacks to handle the incoming publishes,
@@ -942,6 +1038,10 @@ static void prvMQTTAgentTask( void * pvParameters )
     MQTTStatus_t xMQTTStatus = MQTTSuccess, xConnectStatus = MQTTSuccess;
     MQTTContext_t * pMqttContext = &( xGlobalMqttAgentContext.mqttContext );
 
+    #if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 )
+        MQTTAgentContext_t * pxEndedContext = NULL;
+    #endif
+
     ( void ) pvParameters;
 
     do
@@ -951,7 +1051,17 @@ static void prvMQTTAgentTask( void * pvParameters )
          * which could be a disconnect.  If an error occurs the MQTT context on
          * which the error happened is returned so there can be an attempt to
          * clean up and reconnect however the application writer prefers. */
-        xMQTTStatus = MQTTAgent_CommandLoop( &xGlobalMqttAgentContext );
+        #if defined( MQTT_AGENT_MULTIPLEX ) && ( MQTT_AGENT_MULTIPLEX == 1 )
+            /* The same task could service further broker connections, for
+             * example a separate telemetry endpoint, by adding their agent
+             * contexts here too.  Only the context whose loop ended is handed
+             * back, and is added again on the next iteration. */
+            ( void ) Agent_MultiplexAddConnection( &xGlobalMqttAgentContext );
+            xMQTTStatus = Agent_MultiplexCommandLoop( &pxEndedContext );
+            configASSERT( pxEndedContext == &xGlobalMqttAgentContext );
+        #else
+            xMQTTStatus = MQTTAgent_CommandLoop( &xGlobalMqttAgentContext );
+        #endif
 
         /* Success is returned for disconnect or termination. The socket should
          * be disconnected. */
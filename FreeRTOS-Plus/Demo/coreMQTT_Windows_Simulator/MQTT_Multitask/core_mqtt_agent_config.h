@@ -0,0 +1,77 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file core_mqtt_agent_config.h
+ * @brief coreMQTT-Agent settings for the multitask demo.
+ *
+ * The agent settings shared with the other MQTT demos are in
+ * core_mqtt_config.h.  This file is included by the agent headers after the
+ * coreMQTT types are declared.
+ */
+#ifndef CORE_MQTT_AGENT_CONFIG_H
+#define CORE_MQTT_AGENT_CONFIG_H
+
+/**
+ * @brief Set to 1 to service the demo's agent context from
+ * Agent_MultiplexCommandLoop(), the loop that lets one task serve several
+ * broker connections.  See freertos_agent_multiplex.h.
+ *
+ * @note The project builds freertos_agent_multiplex.c either way.
+ */
+#ifndef MQTT_AGENT_MULTIPLEX
+    #define MQTT_AGENT_MULTIPLEX    0
+#endif
+
+#if ( MQTT_AGENT_MULTIPLEX == 1 )
+
+/* Declared in freertos_agent_multiplex.h, which cannot be included before the
+ * agent types it uses. */
+    struct MQTTAgentContext;
+    struct MQTTAgentCommandFuncReturns;
+    MQTTStatus_t Agent_MultiplexIdleCommand( struct MQTTAgentContext * pMqttAgentContext,
+                                             void * pUnusedArg,
+                                             struct MQTTAgentCommandFuncReturns * pReturnFlags );
+
+/**
+ * @brief The agent's standard function table, except that a pass with no
+ * command hands control back to the multiplexing task.
+ */
+    #define MQTT_AGENT_FUNCTION_TABLE                        \
+    {                                                        \
+        [ NONE ] = Agent_MultiplexIdleCommand,               \
+        [ PROCESSLOOP ] = MQTTAgentCommand_ProcessLoop,      \
+        [ PUBLISH ] = MQTTAgentCommand_Publish,              \
+        [ SUBSCRIBE ] = MQTTAgentCommand_Subscribe,          \
+        [ UNSUBSCRIBE ] = MQTTAgentCommand_Unsubscribe,      \
+        [ PING ] = MQTTAgentCommand_Ping,                    \
+        [ CONNECT ] = MQTTAgentCommand_Connect,              \
+        [ DISCONNECT ] = MQTTAgentCommand_Disconnect,        \
+        [ TERMINATE ] = MQTTAgentCommand_Terminate           \
+    }
+#endif /* if ( MQTT_AGENT_MULTIPLEX == 1 ) */
+
+#endif /* ifndef CORE_MQTT_AGENT_CONFIG_H */
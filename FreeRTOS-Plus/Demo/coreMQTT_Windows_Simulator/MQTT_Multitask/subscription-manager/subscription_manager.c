@@ -32,65 +32,634 @@
 /* Standard includes. */
 #include <string.h>
 
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
 /* Subscription manager header include. */
 #include "subscription_manager.h"
 
+/**
+ * @brief Value of the offset of the next topic level once the last level of a
+ * topic or topic filter has been consumed.
+ */
+#define subscriptionNO_MORE_LEVELS( usLength )    ( ( uint32_t ) ( usLength ) + 1U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the length of the topic level starting at ulOffset.
+ *
+ * @param[in] pcString Topic or topic filter.
+ * @param[in] usLength Length of pcString.
+ * @param[in] ulOffset Offset of the start of the level.
+ *
+ * @return Number of characters up to the next '/' or the end of the string.
+ */
+static uint16_t prvLevelLength( const char * pcString,
+                                uint16_t usLength,
+                                uint32_t ulOffset );
+
+/**
+ * @brief Check that a topic filter only uses wildcards as whole levels, and
+ * the multi level wildcard only as its last level.
+ */
+static bool prvIsValidTopicFilter( const char * pcTopicFilterString,
+                                   uint16_t usTopicFilterLength );
+
+/**
+ * @brief Hash a literal level of a child of pxParent.
+ */
+static uint32_t prvHashLevel( const TopicNode_t * pxParent,
+                              const char * pcLevel,
+                              uint16_t usLevelLength );
+
+/**
+ * @brief Find the literal child of pxParent whose level is pcLevel.
+ *
+ * @return The child, or NULL if pxParent has no such child.
+ */
+static TopicNode_t * prvFindLiteralChild( const SubscriptionManager_t * pxSubscriptionManager,
+                                          const TopicNode_t * pxParent,
+                                          const char * pcLevel,
+                                          uint16_t usLevelLength );
+
+/**
+ * @brief Find the child of pxParent that holds the topic filter level pcLevel,
+ * which may be a wildcard.
+ *
+ * @param[in] xCreate Whether to add the child if it does not exist.
+ *
+ * @return The child, or NULL if it does not exist and could not be added.
+ */
+static TopicNode_t * prvGetChild( SubscriptionManager_t * pxSubscriptionManager,
+                                  TopicNode_t * pxParent,
+                                  const char * pcLevel,
+                                  uint16_t usLevelLength,
+                                  bool xCreate );
+
+/**
+ * @brief Detach a node with no remaining subscriptions from its parent and
+ * return it to the pool.
+ */
+static void prvReleaseNode( SubscriptionManager_t * pxSubscriptionManager,
+                            TopicNode_t * pxNode );
+
+/**
+ * @brief Release every node from pxNode towards the root that has no remaining
+ * subscriptions.
+ */
+static void prvPruneBranch( SubscriptionManager_t * pxSubscriptionManager,
+                            TopicNode_t * pxNode );
+
+/**
+ * @brief Point the level text of pxNode and its ancestors into the topic filter
+ * of a subscription that is still held below pxNode.
+ *
+ * Called after an unsubscribe, as the level text may point into a topic filter
+ * string that the application no longer keeps in scope.
+ */
+static void prvRefreshLevelText( const SubscriptionManager_t * pxSubscriptionManager,
+                                 TopicNode_t * pxNode );
+
+/**
+ * @brief Get a subscription element from the pool, growing the pool if it is
+ * empty.
+ *
+ * @return A zeroed element, or NULL if there is insufficient memory.
+ */
+static SubscriptionElement_t * prvAllocateElement( SubscriptionManager_t * pxSubscriptionManager );
+
+/**
+ * @brief Get a topic node from the pool, growing the pool if it is empty.
+ *
+ * @return A zeroed node, or NULL if there is insufficient memory.
+ */
+static TopicNode_t * prvAllocateNode( SubscriptionManager_t * pxSubscriptionManager );
+
+/**
+ * @brief Invoke the callbacks of every subscription under pxNode that matches
+ * the levels of the topic from ulOffset onwards.
+ */
+static void prvDispatchPublish( const SubscriptionManager_t * pxSubscriptionManager,
+                                const TopicNode_t * pxNode,
+                                uint32_t ulOffset,
+                                MQTTPublishInfo_t * pxPublishInfo,
+                                bool * pxPublishHandled );
+
+/**
+ * @brief Invoke the callbacks of the subscriptions whose topic filter ends at
+ * pxNode.
+ */
+static void prvInvokeCallbacks( const TopicNode_t * pxNode,
+                                MQTTPublishInfo_t * pxPublishInfo,
+                                bool * pxPublishHandled );
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvLevelLength( const char * pcString,
+                                uint16_t usLength,
+                                uint32_t ulOffset )
+{
+    uint32_t ulEnd = ulOffset;
+
+    while( ( ulEnd < usLength ) && ( pcString[ ulEnd ] != '/' ) )
+    {
+        ulEnd++;
+    }
+
+    return ( uint16_t ) ( ulEnd - ulOffset );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsValidTopicFilter( const char * pcTopicFilterString,
+                                   uint16_t usTopicFilterLength )
+{
+    bool xValid = true;
+    uint32_t ulOffset = 0U;
+    uint16_t usLevelLength = 0U;
+    uint32_t ulIndex = 0U;
+
+    while( ( xValid == true ) && ( ulOffset < subscriptionNO_MORE_LEVELS( usTopicFilterLength ) ) )
+    {
+        usLevelLength = prvLevelLength( pcTopicFilterString, usTopicFilterLength, ulOffset );
+
+        for( ulIndex = ulOffset; ulIndex < ( ulOffset + usLevelLength ); ulIndex++ )
+        {
+            if( ( ( pcTopicFilterString[ ulIndex ] == '+' ) || ( pcTopicFilterString[ ulIndex ] == '#' ) ) &&
+                ( usLevelLength != 1U ) )
+            {
+                xValid = false;
+            }
+        }
+
+        ulOffset += ( uint32_t ) usLevelLength + 1U;
+
+        if( ( usLevelLength == 1U ) && ( pcTopicFilterString[ ulOffset - 2U ] == '#' ) &&
+            ( ulOffset < subscriptionNO_MORE_LEVELS( usTopicFilterLength ) ) )
+        {
+            xValid = false;
+        }
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHashLevel( const TopicNode_t * pxParent,
+                              const char * pcLevel,
+                              uint16_t usLevelLength )
+{
+    /* FNV-1a, seeded with the parent so that the same level text under
+     * different parents lands in different buckets. */
+    uint32_t ulHash = 2166136261UL ^ ( uint32_t ) ( ( uintptr_t ) pxParent );
+    uint16_t usIndex = 0U;
+
+    for( usIndex = 0U; usIndex < usLevelLength; usIndex++ )
+    {
+        ulHash ^= ( uint8_t ) pcLevel[ usIndex ];
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash % SUBSCRIPTION_MANAGER_HASH_BUCKETS;
+}
+
+/*-----------------------------------------------------------*/
+
+static TopicNode_t * prvFindLiteralChild( const SubscriptionManager_t * pxSubscriptionManager,
+                                          const TopicNode_t * pxParent,
+                                          const char * pcLevel,
+                                          uint16_t usLevelLength )
+{
+    TopicNode_t * pxNode = pxSubscriptionManager->pxBuckets[ prvHashLevel( pxParent, pcLevel, usLevelLength ) ];
+
+    while( pxNode != NULL )
+    {
+        if( ( pxNode->pxParent == pxParent ) &&
+            ( pxNode->usLevelLength == usLevelLength ) &&
+            ( memcmp( pxNode->pcLevel, pcLevel, usLevelLength ) == 0 ) )
+        {
+            break;
+        }
+
+        pxNode = pxNode->pxHashNext;
+    }
+
+    return pxNode;
+}
+
+/*-----------------------------------------------------------*/
+
+static TopicNode_t * prvGetChild( SubscriptionManager_t * pxSubscriptionManager,
+                                  TopicNode_t * pxParent,
+                                  const char * pcLevel,
+                                  uint16_t usLevelLength,
+                                  bool xCreate )
+{
+    TopicNode_t ** ppxSlot = NULL;
+    TopicNode_t * pxChild = NULL;
+    uint32_t ulBucket = 0U;
+
+    if( ( usLevelLength == 1U ) && ( pcLevel[ 0 ] == '+' ) )
+    {
+        ppxSlot = &( pxParent->pxSingleLevelWildcard );
+        pxChild = *ppxSlot;
+    }
+    else if( ( usLevelLength == 1U ) && ( pcLevel[ 0 ] == '#' ) )
+    {
+        ppxSlot = &( pxParent->pxMultiLevelWildcard );
+        pxChild = *ppxSlot;
+    }
+    else
+    {
+        pxChild = prvFindLiteralChild( pxSubscriptionManager, pxParent, pcLevel, usLevelLength );
+    }
+
+    if( ( pxChild == NULL ) && ( xCreate == true ) )
+    {
+        pxChild = prvAllocateNode( pxSubscriptionManager );
+
+        if( pxChild != NULL )
+        {
+            pxChild->pxParent = pxParent;
+            pxChild->pcLevel = pcLevel;
+            pxChild->usLevelLength = usLevelLength;
+            pxChild->usDepth = pxParent->usDepth + 1U;
+
+            if( ppxSlot != NULL )
+            {
+                *ppxSlot = pxChild;
+            }
+            else
+            {
+                ulBucket = prvHashLevel( pxParent, pcLevel, usLevelLength );
+                pxChild->pxHashNext = pxSubscriptionManager->pxBuckets[ ulBucket ];
+                pxSubscriptionManager->pxBuckets[ ulBucket ] = pxChild;
+            }
+        }
+    }
+
+    return pxChild;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseNode( SubscriptionManager_t * pxSubscriptionManager,
+                            TopicNode_t * pxNode )
+{
+    TopicNode_t * pxParent = pxNode->pxParent;
+    TopicNode_t ** ppxLink = NULL;
+
+    if( pxParent->pxSingleLevelWildcard == pxNode )
+    {
+        pxParent->pxSingleLevelWildcard = NULL;
+    }
+    else if( pxParent->pxMultiLevelWildcard == pxNode )
+    {
+        pxParent->pxMultiLevelWildcard = NULL;
+    }
+    else
+    {
+        ppxLink = &( pxSubscriptionManager->pxBuckets[ prvHashLevel( pxParent, pxNode->pcLevel, pxNode->usLevelLength ) ] );
+
+        while( *ppxLink != pxNode )
+        {
+            ppxLink = &( ( *ppxLink )->pxHashNext );
+        }
+
+        *ppxLink = pxNode->pxHashNext;
+    }
+
+    pxNode->pxHashNext = pxSubscriptionManager->pxFreeNodes;
+    pxSubscriptionManager->pxFreeNodes = pxNode;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPruneBranch( SubscriptionManager_t * pxSubscriptionManager,
+                            TopicNode_t * pxNode )
+{
+    TopicNode_t * pxParent = NULL;
+
+    while( ( pxNode != &( pxSubscriptionManager->xRoot ) ) && ( pxNode->ulReferenceCount == 0U ) )
+    {
+        pxParent = pxNode->pxParent;
+        prvReleaseNode( pxSubscriptionManager, pxNode );
+        pxNode = pxParent;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRefreshLevelText( const SubscriptionManager_t * pxSubscriptionManager,
+                                 TopicNode_t * pxNode )
+{
+    const SubscriptionElement_t * pxElement = pxSubscriptionManager->pxSubscriptions;
+    const TopicNode_t * pxAncestor = NULL;
+    uint32_t ulOffset = 0U;
+    uint16_t usLevel = 0U;
+    uint16_t usLevelLength = 0U;
+
+    /* Find a subscription whose topic filter passes through pxNode. One
+     * exists, as pxNode is still referenced. */
+    while( pxElement != NULL )
+    {
+        pxAncestor = pxElement->pxNode;
+
+        while( pxAncestor->usDepth > pxNode->usDepth )
+        {
+            pxAncestor = pxAncestor->pxParent;
+        }
+
+        if( pxAncestor == pxNode )
+        {
+            break;
+        }
+
+        pxElement = pxElement->pxNext;
+    }
+
+    configASSERT( pxElement != NULL );
+
+    /* Walk the levels of that topic filter up to pxNode, pointing each node on
+     * the path at its level. Wildcard nodes are pointed as well, which is
+     * harmless as their text is never compared. */
+    while( ( pxElement != NULL ) && ( pxNode->usDepth > 0U ) )
+    {
+        ulOffset = 0U;
+
+        for( usLevel = 1U; usLevel < pxNode->usDepth; usLevel++ )
+        {
+            ulOffset += ( uint32_t ) prvLevelLength( pxElement->pcSubscriptionFilterString,
+                                                     pxElement->usFilterStringLength,
+                                                     ulOffset ) + 1U;
+        }
+
+        usLevelLength = prvLevelLength( pxElement->pcSubscriptionFilterString,
+                                        pxElement->usFilterStringLength,
+                                        ulOffset );
+
+        /* The level text is part of the hash key, which is unchanged as the
+         * new text compares equal to the old. */
+        pxNode->pcLevel = &( pxElement->pcSubscriptionFilterString[ ulOffset ] );
+        pxNode->usLevelLength = usLevelLength;
+        pxNode = pxNode->pxParent;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionElement_t * prvAllocateElement( SubscriptionManager_t * pxSubscriptionManager )
+{
+    SubscriptionElement_t * pxBlock = NULL;
+    SubscriptionElement_t * pxElement = NULL;
+    uint32_t ulIndex = 0U;
+
+    if( pxSubscriptionManager->pxFreeElements == NULL )
+    {
+        pxBlock = pvPortMalloc( sizeof( SubscriptionElement_t ) * SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH );
+
+        if( pxBlock != NULL )
+        {
+            for( ulIndex = 0U; ulIndex < SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH; ulIndex++ )
+            {
+                pxBlock[ ulIndex ].pxNext = pxSubscriptionManager->pxFreeElements;
+                pxSubscriptionManager->pxFreeElements = &( pxBlock[ ulIndex ] );
+            }
+        }
+    }
+
+    pxElement = pxSubscriptionManager->pxFreeElements;
+
+    if( pxElement != NULL )
+    {
+        pxSubscriptionManager->pxFreeElements = pxElement->pxNext;
+        ( void ) memset( pxElement, 0x00, sizeof( SubscriptionElement_t ) );
+    }
+
+    return pxElement;
+}
+
+/*-----------------------------------------------------------*/
+
+static TopicNode_t * prvAllocateNode( SubscriptionManager_t * pxSubscriptionManager )
+{
+    TopicNode_t * pxBlock = NULL;
+    TopicNode_t * pxNode = NULL;
+    uint32_t ulIndex = 0U;
+
+    if( pxSubscriptionManager->pxFreeNodes == NULL )
+    {
+        pxBlock = pvPortMalloc( sizeof( TopicNode_t ) * SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH );
+
+        if( pxBlock != NULL )
+        {
+            for( ulIndex = 0U; ulIndex < SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH; ulIndex++ )
+            {
+                pxBlock[ ulIndex ].pxHashNext = pxSubscriptionManager->pxFreeNodes;
+                pxSubscriptionManager->pxFreeNodes = &( pxBlock[ ulIndex ] );
+            }
+        }
+    }
+
+    pxNode = pxSubscriptionManager->pxFreeNodes;
+
+    if( pxNode != NULL )
+    {
+        pxSubscriptionManager->pxFreeNodes = pxNode->pxHashNext;
+        ( void ) memset( pxNode, 0x00, sizeof( TopicNode_t ) );
+    }
+
+    return pxNode;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvInvokeCallbacks( const TopicNode_t * pxNode,
+                                MQTTPublishInfo_t * pxPublishInfo,
+                                bool * pxPublishHandled )
+{
+    const SubscriptionElement_t * pxElement = pxNode->pxSubscriptions;
+
+    while( pxElement != NULL )
+    {
+        pxElement->pxIncomingPublishCallback( pxElement->pvIncomingPublishCallbackContext,
+                                              pxPublishInfo );
+        *pxPublishHandled = true;
+        pxElement = pxElement->pxNodeNext;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDispatchPublish( const SubscriptionManager_t * pxSubscriptionManager,
+                                const TopicNode_t * pxNode,
+                                uint32_t ulOffset,
+                                MQTTPublishInfo_t * pxPublishInfo,
+                                bool * pxPublishHandled )
+{
+    const char * pcTopic = pxPublishInfo->pTopicName;
+    uint16_t usTopicLength = pxPublishInfo->topicNameLength;
+    uint16_t usLevelLength = 0U;
+    uint32_t ulNextOffset = 0U;
+    const TopicNode_t * pxChild = NULL;
+    bool xWildcardsAllowed = true;
+
+    /* Topics starting with '$' are reserved for the broker and are not matched
+     * by a wildcard in the first level of a topic filter. */
+    if( ( pxNode->usDepth == 0U ) && ( usTopicLength > 0U ) && ( pcTopic[ 0 ] == '$' ) )
+    {
+        xWildcardsAllowed = false;
+    }
+
+    /* "#" also matches the parent level, so it matches whether or not any
+     * levels remain. */
+    if( ( pxNode->pxMultiLevelWildcard != NULL ) && ( xWildcardsAllowed == true ) )
+    {
+        prvInvokeCallbacks( pxNode->pxMultiLevelWildcard, pxPublishInfo, pxPublishHandled );
+    }
+
+    if( ulOffset >= subscriptionNO_MORE_LEVELS( usTopicLength ) )
+    {
+        prvInvokeCallbacks( pxNode, pxPublishInfo, pxPublishHandled );
+    }
+    else
+    {
+        usLevelLength = prvLevelLength( pcTopic, usTopicLength, ulOffset );
+        ulNextOffset = ulOffset + ( uint32_t ) usLevelLength + 1U;
+
+        pxChild = prvFindLiteralChild( pxSubscriptionManager, pxNode, &( pcTopic[ ulOffset ] ), usLevelLength );
+
+        if( pxChild != NULL )
+        {
+            prvDispatchPublish( pxSubscriptionManager, pxChild, ulNextOffset, pxPublishInfo, pxPublishHandled );
+        }
+
+        if( ( pxNode->pxSingleLevelWildcard != NULL ) && ( xWildcardsAllowed == true ) )
+        {
+            prvDispatchPublish( pxSubscriptionManager, pxNode->pxSingleLevelWildcard, ulNextOffset, pxPublishInfo, pxPublishHandled );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
 
-bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
+bool addSubscription( SubscriptionManager_t * pxSubscriptionManager,
                       const char * pcTopicFilterString,
                       uint16_t usTopicFilterLength,
                       IncomingPubCallback_t pxIncomingPublishCallback,
                       void * pvIncomingPublishCallbackContext )
 {
-    int32_t lIndex = 0;
-    size_t xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
+    TopicNode_t * pxNode = NULL;
+    TopicNode_t * pxChild = NULL;
+    SubscriptionElement_t * pxElement = NULL;
+    uint32_t ulOffset = 0U;
+    uint16_t usLevelLength = 0U;
     bool xReturnStatus = false;
 
-    if( ( pxSubscriptionList == NULL ) ||
+    if( ( pxSubscriptionManager == NULL ) ||
         ( pcTopicFilterString == NULL ) ||
         ( usTopicFilterLength == 0U ) ||
         ( pxIncomingPublishCallback == NULL ) )
     {
-        LogError( ( "Invalid parameter. pxSubscriptionList=%p, pcTopicFilterString=%p,"
+        LogError( ( "Invalid parameter. pxSubscriptionManager=%p, pcTopicFilterString=%p,"
                     " usTopicFilterLength=%u, pxIncomingPublishCallback=%p.",
-                    pxSubscriptionList,
+                    pxSubscriptionManager,
                     pcTopicFilterString,
                     ( unsigned int ) usTopicFilterLength,
                     pxIncomingPublishCallback ) );
     }
+    else if( prvIsValidTopicFilter( pcTopicFilterString, usTopicFilterLength ) == false )
+    {
+        LogError( ( "Invalid topic filter %.*s.",
+                    ( int ) usTopicFilterLength,
+                    pcTopicFilterString ) );
+    }
     else
     {
-        /* Start at end of array, so that we will insert at the first available index.
-         * Scans backwards to find duplicates. */
-        for( lIndex = ( int32_t ) SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS - 1; lIndex >= 0; lIndex-- )
+        /* Walk the trie one level at a time, adding the levels that are
+         * missing. */
+        pxNode = &( pxSubscriptionManager->xRoot );
+
+        while( ( pxNode != NULL ) && ( ulOffset < subscriptionNO_MORE_LEVELS( usTopicFilterLength ) ) )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == 0 )
+            usLevelLength = prvLevelLength( pcTopicFilterString, usTopicFilterLength, ulOffset );
+            pxChild = prvGetChild( pxSubscriptionManager, pxNode, &( pcTopicFilterString[ ulOffset ] ), usLevelLength, true );
+
+            if( pxChild == NULL )
             {
-                xAvailableIndex = lIndex;
+                /* Release the levels added so far. */
+                prvPruneBranch( pxSubscriptionManager, pxNode );
             }
-            else if( ( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength ) &&
-                     ( strncmp( pcTopicFilterString, pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, ( size_t ) usTopicFilterLength ) == 0 ) )
+
+            pxNode = pxChild;
+            ulOffset += ( uint32_t ) usLevelLength + 1U;
+        }
+
+        if( pxNode != NULL )
+        {
+            /* If a subscription already exists, don't do anything. */
+            for( pxElement = pxNode->pxSubscriptions; pxElement != NULL; pxElement = pxElement->pxNodeNext )
             {
-                /* If a subscription already exists, don't do anything. */
-                if( ( pxSubscriptionList[ lIndex ].pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
-                    ( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
+                if( ( pxElement->pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
+                    ( pxElement->pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
                 {
                     LogWarn( ( "Subscription already exists.\n" ) );
-                    xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
                     xReturnStatus = true;
                     break;
                 }
             }
+
+            if( xReturnStatus == false )
+            {
+                pxElement = prvAllocateElement( pxSubscriptionManager );
+
+                if( pxElement == NULL )
+                {
+                    prvPruneBranch( pxSubscriptionManager, pxNode );
+                }
+            }
         }
 
-        if( xAvailableIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS )
+        if( ( xReturnStatus == false ) && ( pxElement != NULL ) )
         {
-            pxSubscriptionList[ xAvailableIndex ].pcSubscriptionFilterString = pcTopicFilterString;
-            pxSubscriptionList[ xAvailableIndex ].usFilterStringLength = usTopicFilterLength;
-            pxSubscriptionList[ xAvailableIndex ].pxIncomingPublishCallback = pxIncomingPublishCallback;
-            pxSubscriptionList[ xAvailableIndex ].pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
+            pxElement->pcSubscriptionFilterString = pcTopicFilterString;
+            pxElement->usFilterStringLength = usTopicFilterLength;
+            pxElement->pxIncomingPublishCallback = pxIncomingPublishCallback;
+            pxElement->pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
+            pxElement->pxNode = pxNode;
+
+            pxElement->pxNodeNext = pxNode->pxSubscriptions;
+            pxNode->pxSubscriptions = pxElement;
+
+            pxElement->pxNext = pxSubscriptionManager->pxSubscriptions;
+
+            if( pxElement->pxNext != NULL )
+            {
+                pxElement->pxNext->pxPrevious = pxElement;
+            }
+
+            pxSubscriptionManager->pxSubscriptions = pxElement;
+            pxSubscriptionManager->xSubscriptionCount++;
+
+            for( ; pxNode != &( pxSubscriptionManager->xRoot ); pxNode = pxNode->pxParent )
+            {
+                pxNode->ulReferenceCount++;
+            }
+
             xReturnStatus = true;
         }
+        else if( xReturnStatus == false )
+        {
+            LogError( ( "Insufficient memory to add subscription to %.*s.",
+                        ( int ) usTopicFilterLength,
+                        pcTopicFilterString ) );
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
     }
 
     return xReturnStatus;
@@ -98,32 +667,97 @@ bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
 
 /*-----------------------------------------------------------*/
 
-void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
+void removeSubscription( SubscriptionManager_t * pxSubscriptionManager,
                          const char * pcTopicFilterString,
                          uint16_t usTopicFilterLength )
 {
-    int32_t lIndex = 0;
+    TopicNode_t * pxNode = NULL;
+    TopicNode_t * pxParent = NULL;
+    SubscriptionElement_t * pxElement = NULL;
+    uint32_t ulOffset = 0U;
+    uint32_t ulRemoved = 0U;
+    uint16_t usLevelLength = 0U;
 
-    if( ( pxSubscriptionList == NULL ) ||
+    if( ( pxSubscriptionManager == NULL ) ||
         ( pcTopicFilterString == NULL ) ||
         ( usTopicFilterLength == 0U ) )
     {
-        LogError( ( "Invalid parameter. pxSubscriptionList=%p, pcTopicFilterString=%p,"
+        LogError( ( "Invalid parameter. pxSubscriptionManager=%p, pcTopicFilterString=%p,"
                     " usTopicFilterLength=%u.",
-                    pxSubscriptionList,
+                    pxSubscriptionManager,
                     pcTopicFilterString,
                     ( unsigned int ) usTopicFilterLength ) );
     }
     else
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
+        pxNode = &( pxSubscriptionManager->xRoot );
+
+        while( ( pxNode != NULL ) && ( ulOffset < subscriptionNO_MORE_LEVELS( usTopicFilterLength ) ) )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength )
+            usLevelLength = prvLevelLength( pcTopicFilterString, usTopicFilterLength, ulOffset );
+            pxNode = prvGetChild( pxSubscriptionManager, pxNode, &( pcTopicFilterString[ ulOffset ] ), usLevelLength, false );
+            ulOffset += ( uint32_t ) usLevelLength + 1U;
+        }
+
+        if( pxNode != NULL )
+        {
+            /* Return every subscription to this topic filter to the pool. */
+            while( pxNode->pxSubscriptions != NULL )
+            {
+                pxElement = pxNode->pxSubscriptions;
+                pxNode->pxSubscriptions = pxElement->pxNodeNext;
+
+                if( pxElement->pxPrevious != NULL )
+                {
+                    pxElement->pxPrevious->pxNext = pxElement->pxNext;
+                }
+                else
+                {
+                    pxSubscriptionManager->pxSubscriptions = pxElement->pxNext;
+                }
+
+                if( pxElement->pxNext != NULL )
+                {
+                    pxElement->pxNext->pxPrevious = pxElement->pxPrevious;
+                }
+
+                ( void ) memset( pxElement, 0x00, sizeof( SubscriptionElement_t ) );
+                pxElement->pxNext = pxSubscriptionManager->pxFreeElements;
+                pxSubscriptionManager->pxFreeElements = pxElement;
+                pxSubscriptionManager->xSubscriptionCount--;
+                ulRemoved++;
+            }
+        }
+
+        if( ulRemoved > 0U )
+        {
+            /* Release the levels no other subscription uses. */
+            while( pxNode != &( pxSubscriptionManager->xRoot ) )
+            {
+                pxParent = pxNode->pxParent;
+                pxNode->ulReferenceCount -= ulRemoved;
+
+                if( pxNode->ulReferenceCount == 0U )
+                {
+                    prvReleaseNode( pxSubscriptionManager, pxNode );
+                }
+                else
+                {
+                    break;
+                }
+
+                pxNode = pxParent;
+            }
+
+            /* The remaining levels are shared with other subscriptions. */
+            if( pxNode != &( pxSubscriptionManager->xRoot ) )
             {
-                if( strncmp( pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, pcTopicFilterString, usTopicFilterLength ) == 0 )
+                for( pxParent = pxNode->pxParent; pxParent != &( pxSubscriptionManager->xRoot ); pxParent = pxParent->pxParent )
                 {
-                    memset( &( pxSubscriptionList[ lIndex ] ), 0x00, sizeof( SubscriptionElement_t ) );
+                    pxParent->ulReferenceCount -= ulRemoved;
                 }
+
+                prvRefreshLevelText( pxSubscriptionManager, pxNode );
             }
         }
     }
@@ -131,40 +765,28 @@ void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
 
 /*-----------------------------------------------------------*/
 
-bool handleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool handleIncomingPublishes( SubscriptionManager_t * pxSubscriptionManager,
                               MQTTPublishInfo_t * pxPublishInfo )
 {
-    int32_t lIndex = 0;
-    bool isMatched = false, publishHandled = false;
+    bool publishHandled = false;
 
-    if( ( pxSubscriptionList == NULL ) ||
+    if( ( pxSubscriptionManager == NULL ) ||
         ( pxPublishInfo == NULL ) )
     {
-        LogError( ( "Invalid parameter. pxSubscriptionList=%p, pxPublishInfo=%p,",
-                    pxSubscriptionList,
+        LogError( ( "Invalid parameter. pxSubscriptionManager=%p, pxPublishInfo=%p,",
+                    pxSubscriptionManager,
                     pxPublishInfo ) );
     }
     else
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
-        {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength > 0 )
-            {
-                MQTT_MatchTopic( pxPublishInfo->pTopicName,
-                                 pxPublishInfo->topicNameLength,
-                                 pxSubscriptionList[ lIndex ].pcSubscriptionFilterString,
-                                 pxSubscriptionList[ lIndex ].usFilterStringLength,
-                                 &isMatched );
-
-                if( isMatched == true )
-                {
-                    pxSubscriptionList[ lIndex ].pxIncomingPublishCallback( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext,
-                                                                            pxPublishInfo );
-                    publishHandled = true;
-                }
-            }
-        }
+        prvDispatchPublish( pxSubscriptionManager,
+                            &( pxSubscriptionManager->xRoot ),
+                            0U,
+                            pxPublishInfo,
+                            &publishHandled );
     }
 
     return publishHandled;
 }
+
+/*-----------------------------------------------------------*/
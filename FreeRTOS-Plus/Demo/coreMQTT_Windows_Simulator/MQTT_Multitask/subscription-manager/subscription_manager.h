@@ -63,11 +63,22 @@
 
 
 /**
- * @brief Maximum number of subscriptions maintained by the subscription manager
- * simultaneously in a list.
+ * @brief Number of subscription elements, and of topic nodes, that are
+ * allocated together when a pool runs out.
+ *
+ * Pools only grow. Memory released by unsubscribing is kept for reuse by later
+ * subscriptions rather than returned to the heap.
+ */
+#ifndef SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH
+    #define SUBSCRIPTION_MANAGER_POOL_BLOCK_LENGTH    16U
+#endif
+
+/**
+ * @brief Number of buckets in the hash table used to find the child of a topic
+ * node that matches a topic level.
  */
-#ifndef SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS
-    #define SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS    10U
+#ifndef SUBSCRIPTION_MANAGER_HASH_BUCKETS
+    #define SUBSCRIPTION_MANAGER_HASH_BUCKETS    64U
 #endif
 
 /**
@@ -79,14 +90,13 @@
 typedef void (* IncomingPubCallback_t )( void * pvIncomingPublishCallbackContext,
                                          MQTTPublishInfo_t * pxPublishInfo );
 
+struct topicNode;
+
 /**
- * @brief An element in the list of subscriptions.
- *
- * This subscription manager implementation expects that the array of the
- * subscription elements used for storing subscriptions to be initialized to 0.
+ * @brief A subscription held by the subscription manager.
  *
  * @note This implementation allows multiple tasks to subscribe to the same topic.
- * In this case, another element is added to the subscription list, differing
+ * In this case, another element is added to the subscription manager, differing
  * in the intended publish callback. Also note that the topic filters are not
  * copied in the subscription manager and hence the topic filter strings need to
  * stay in scope until unsubscribed.
@@ -97,40 +107,81 @@ typedef struct subscriptionElement
     void * pvIncomingPublishCallbackContext;
     uint16_t usFilterStringLength;
     const char * pcSubscriptionFilterString;
+    struct subscriptionElement * pxNext;     /**< @brief Next subscription held by the manager, or next free element. */
+    struct subscriptionElement * pxPrevious; /**< @brief Previous subscription held by the manager. */
+    struct subscriptionElement * pxNodeNext; /**< @brief Next subscription with the same topic filter. */
+    struct topicNode * pxNode;               /**< @brief Node of the last level of the topic filter. */
 } SubscriptionElement_t;
 
 /**
- * @brief Add a subscription to the subscription list.
+ * @brief A level of a topic filter in the subscription trie.
+ *
+ * Literal children are found through the hash table of the subscription
+ * manager, while the single level and multi level wildcard children are held
+ * directly, so dispatching a publish only costs a lookup per topic level.
+ */
+typedef struct topicNode
+{
+    struct topicNode * pxParent;
+    struct topicNode * pxHashNext;            /**< @brief Next node in the same hash bucket, or next free node. */
+    struct topicNode * pxSingleLevelWildcard; /**< @brief The "+" child. */
+    struct topicNode * pxMultiLevelWildcard;  /**< @brief The "#" child. */
+    SubscriptionElement_t * pxSubscriptions;  /**< @brief Subscriptions whose topic filter ends at this node. */
+    const char * pcLevel;                     /**< @brief Level text, pointing into the topic filter of a subscription below this node. */
+    uint16_t usLevelLength;
+    uint16_t usDepth;                         /**< @brief Number of levels from the root, 0 for the root. */
+    uint32_t ulReferenceCount;                /**< @brief Number of subscriptions at or below this node. */
+} TopicNode_t;
+
+/**
+ * @brief Subscriptions organised as a trie of topic levels.
+ *
+ * This subscription manager implementation expects that the structure is
+ * initialized to 0 before it is first used.
+ */
+typedef struct subscriptionManager
+{
+    TopicNode_t xRoot;
+    TopicNode_t * pxBuckets[ SUBSCRIPTION_MANAGER_HASH_BUCKETS ];
+    TopicNode_t * pxFreeNodes;
+    SubscriptionElement_t * pxFreeElements;
+    SubscriptionElement_t * pxSubscriptions; /**< @brief All subscriptions, linked through pxNext. */
+    size_t xSubscriptionCount;
+} SubscriptionManager_t;
+
+/**
+ * @brief Add a subscription to the subscription manager.
  *
  * @note Multiple tasks can be subscribed to the same topic with different
  * context-callback pairs. However, a single context-callback pair may only be
  * associated to the same topic filter once.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionManager The subscription manager.
  * @param[in] pcTopicFilterString Topic filter string of subscription.
  * @param[in] usTopicFilterLength Length of topic filter string.
  * @param[in] pxIncomingPublishCallback Callback function for the subscription.
  * @param[in] pvIncomingPublishCallbackContext Context for the subscription callback.
  *
- * @return `true` if subscription added or exists, `false` if insufficient memory.
+ * @return `true` if subscription added or exists, `false` if the topic filter
+ * is invalid or there is insufficient memory.
  */
-bool addSubscription( SubscriptionElement_t * pxSubscriptionList,
+bool addSubscription( SubscriptionManager_t * pxSubscriptionManager,
                       const char * pcTopicFilterString,
                       uint16_t usTopicFilterLength,
                       IncomingPubCallback_t pxIncomingPublishCallback,
                       void * pvIncomingPublishCallbackContext );
 
 /**
- * @brief Remove a subscription from the subscription list.
+ * @brief Remove a subscription from the subscription manager.
  *
- * @note If the topic filter exists multiple times in the subscription list,
- * then every instance of the subscription will be removed.
+ * @note If the topic filter has been subscribed multiple times, then every
+ * instance of the subscription will be removed.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionManager The subscription manager.
  * @param[in] pcTopicFilterString Topic filter of subscription.
  * @param[in] usTopicFilterLength Length of topic filter.
  */
-void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
+void removeSubscription( SubscriptionManager_t * pxSubscriptionManager,
                          const char * pcTopicFilterString,
                          uint16_t usTopicFilterLength );
 
@@ -138,13 +189,13 @@ void removeSubscription( SubscriptionElement_t * pxSubscriptionList,
  * @brief Handle incoming publishes by invoking the callbacks registered
  * for the incoming publish's topic filter.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionManager The subscription manager.
  * @param[in] pxPublishInfo Info of incoming publish.
  *
  * @return `true` if an application callback could be invoked;
  *  `false` otherwise.
  */
-bool handleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool handleIncomingPublishes( SubscriptionManager_t * pxSubscriptionManager,
                               MQTTPublishInfo_t * pxPublishInfo );
 
 #endif /* SUBSCRIPTION_MANAGER_H */
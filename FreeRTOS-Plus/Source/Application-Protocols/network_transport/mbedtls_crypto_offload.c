@@ -0,0 +1,634 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#include "logging_levels.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "CryptoOffload"
+#endif /* LIBRARY_LOG_NAME */
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif /* LIBRARY_LOG_LEVEL */
+
+#include "logging_stack.h"
+
+/**
+ * @file mbedtls_crypto_offload.c
+ * @brief Implements the linker wrappers of the mbedTLS GCM and SHA-256
+ * functions and the ECDH alternative, which forward each operation to the
+ * registered backend, or to mbedTLS's own code when it declines.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Mbedtls Includes */
+#ifndef MBEDTLS_ALLOW_PRIVATE_ACCESS
+    #define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#endif /* MBEDTLS_ALLOW_PRIVATE_ACCESS */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "mbedtls_crypto_offload.h"
+#include "mbedtls_crypto_offload_wrap.h"
+
+#include "mbedtls/ecdh.h"
+#include "mbedtls/constant_time.h"
+#include "mbedtls/platform_util.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The backend registered by the application, or NULL to use the
+ * software backend only.
+ */
+static const CryptoOffloadBackend_t * pxRegisteredBackend = NULL;
+
+/**
+ * @brief Operation counters.
+ */
+static CryptoOffloadCounters_t xCounters = { 0 };
+
+/**
+ * @brief A GCM or SHA-256 context whose key or hash is held by a backend.
+ */
+typedef struct CryptoOffloadEntry
+{
+    const void * pvContext;                  /**< @brief The mbedTLS context, NULL if the entry is free. */
+    const CryptoOffloadBackend_t * pxBackend; /**< @brief The backend holding pvHandle. */
+    void * pvHandle;                          /**< @brief Key or hash handle of pxBackend. */
+    BaseType_t xMultiPart;                    /**< @brief pdTRUE while pxBackend runs a multi-part GCM operation. */
+} CryptoOffloadEntry_t;
+
+/**
+ * @brief The contexts held by backends. The other contexts run in software.
+ */
+static CryptoOffloadEntry_t xEntries[ cryptooffloadMAX_CONTEXTS ];
+
+/*-----------------------------------------------------------*/
+
+void vCryptoOffload_SetBackend( const CryptoOffloadBackend_t * pxBackend )
+{
+    pxRegisteredBackend = pxBackend;
+
+    if( pxBackend != NULL )
+    {
+        LogInfo( ( "Crypto offload backend set to %s.",
+                   ( pxBackend->pcName != NULL ) ? pxBackend->pcName : "<unnamed>" ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+const CryptoOffloadBackend_t * pxCryptoOffload_GetBackend( void )
+{
+    return pxRegisteredBackend;
+}
+/*-----------------------------------------------------------*/
+
+void vCryptoOffload_GetCounters( CryptoOffloadCounters_t * pxCounters )
+{
+    if( pxCounters != NULL )
+    {
+        *pxCounters = xCounters;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vCryptoOffload_ResetCounters( void )
+{
+    ( void ) memset( &xCounters, 0, sizeof( xCounters ) );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the entry of an mbedTLS context held by the registered backend.
+ *
+ * Only the task using a context claims or releases its entry, so the search
+ * needs no lock.
+ *
+ * @return The entry, or NULL if the context runs in software.
+ */
+static CryptoOffloadEntry_t * prvFindEntry( const void * pvContext )
+{
+    CryptoOffloadEntry_t * pxEntry = NULL;
+    size_t uxIdx;
+
+    for( uxIdx = 0U; ( uxIdx < cryptooffloadMAX_CONTEXTS ) && ( pxEntry == NULL ) && ( pvContext != NULL ); uxIdx++ )
+    {
+        if( xEntries[ uxIdx ].pvContext == pvContext )
+        {
+            pxEntry = &( xEntries[ uxIdx ] );
+        }
+    }
+
+    return pxEntry;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Record that a backend holds pvHandle for an mbedTLS context.
+ *
+ * @return The entry, or NULL if every entry is in use.
+ */
+static CryptoOffloadEntry_t * prvClaimEntry( const void * pvContext,
+                                             const CryptoOffloadBackend_t * pxBackend,
+                                             void * pvHandle )
+{
+    CryptoOffloadEntry_t * pxEntry = NULL;
+    size_t uxIdx;
+
+    taskENTER_CRITICAL();
+    {
+        for( uxIdx = 0U; ( uxIdx < cryptooffloadMAX_CONTEXTS ) && ( pxEntry == NULL ); uxIdx++ )
+        {
+            if( xEntries[ uxIdx ].pvContext == NULL )
+            {
+                pxEntry = &( xEntries[ uxIdx ] );
+                pxEntry->pvContext = pvContext;
+                pxEntry->pxBackend = pxBackend;
+                pxEntry->pvHandle = pvHandle;
+                pxEntry->xMultiPart = pdFALSE;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if( pxEntry == NULL )
+    {
+        LogWarn( ( "All %d offload entries are in use, running in software.", cryptooffloadMAX_CONTEXTS ) );
+    }
+
+    return pxEntry;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseEntry( CryptoOffloadEntry_t * pxEntry )
+{
+    taskENTER_CRITICAL();
+    {
+        ( void ) memset( pxEntry, 0, sizeof( *pxEntry ) );
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+#if defined( MBEDTLS_GCM_C )
+
+/**
+ * @brief Free the backend key of a GCM context, if it has one.
+ */
+    static void prvGcmReleaseKey( const mbedtls_gcm_context * ctx )
+    {
+        CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+
+        if( pxEntry != NULL )
+        {
+            if( pxEntry->pxBackend->xGcmFreeKey != NULL )
+            {
+                pxEntry->pxBackend->xGcmFreeKey( pxEntry->pxBackend->pvContext, pxEntry->pvHandle );
+            }
+
+            prvReleaseEntry( pxEntry );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    void __wrap_mbedtls_gcm_free( mbedtls_gcm_context * ctx )
+    {
+        prvGcmReleaseKey( ctx );
+        __real_mbedtls_gcm_free( ctx );
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_setkey( mbedtls_gcm_context * ctx,
+                                   mbedtls_cipher_id_t cipher,
+                                   const unsigned char * key,
+                                   unsigned int keybits )
+    {
+        const CryptoOffloadBackend_t * pxBackend = pxRegisteredBackend;
+        void * pvKey = NULL;
+        int lResult;
+
+        /* A context may be given a new key. */
+        prvGcmReleaseKey( ctx );
+
+        /* The software key is always set up, for the operations the backend
+         * declines. */
+        lResult = __real_mbedtls_gcm_setkey( ctx, cipher, key, keybits );
+
+        if( ( lResult == 0 ) && ( pxBackend != NULL ) && ( pxBackend->xGcmSetKey != NULL ) )
+        {
+            lResult = pxBackend->xGcmSetKey( pxBackend->pvContext, &pvKey, cipher, key, keybits );
+
+            if( lResult == 0 )
+            {
+                if( prvClaimEntry( ctx, pxBackend, pvKey ) == NULL )
+                {
+                    if( pxBackend->xGcmFreeKey != NULL )
+                    {
+                        pxBackend->xGcmFreeKey( pxBackend->pvContext, pvKey );
+                    }
+                }
+            }
+            else if( lResult == CRYPTO_OFFLOAD_NOT_SUPPORTED )
+            {
+                lResult = 0;
+            }
+            else
+            {
+                LogError( ( "Failed to set the GCM key in the offload backend: %d", lResult ) );
+            }
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context * ctx,
+                                          int mode,
+                                          size_t length,
+                                          const unsigned char * iv,
+                                          size_t iv_len,
+                                          const unsigned char * add,
+                                          size_t add_len,
+                                          const unsigned char * input,
+                                          unsigned char * output,
+                                          size_t tag_len,
+                                          unsigned char * tag )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult = CRYPTO_OFFLOAD_NOT_SUPPORTED;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->pxBackend->xGcmCrypt != NULL ) )
+        {
+            lResult = pxEntry->pxBackend->xGcmCrypt( pxEntry->pxBackend->pvContext, pxEntry->pvHandle, mode, iv, iv_len,
+                                                     add, add_len, input, output, length, tag, tag_len );
+        }
+
+        if( lResult != CRYPTO_OFFLOAD_NOT_SUPPORTED )
+        {
+            xCounters.ulGcmBackend++;
+        }
+        else
+        {
+            lResult = __real_mbedtls_gcm_crypt_and_tag( ctx, mode, length, iv, iv_len, add, add_len,
+                                                        input, output, tag_len, tag );
+            xCounters.ulGcmSoftware++;
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_auth_decrypt( mbedtls_gcm_context * ctx,
+                                         size_t length,
+                                         const unsigned char * iv,
+                                         size_t iv_len,
+                                         const unsigned char * add,
+                                         size_t add_len,
+                                         const unsigned char * tag,
+                                         size_t tag_len,
+                                         const unsigned char * input,
+                                         unsigned char * output )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        unsigned char ucCheckTag[ 16 ];
+        int lResult = CRYPTO_OFFLOAD_NOT_SUPPORTED;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->pxBackend->xGcmCrypt != NULL ) &&
+            ( tag_len >= 4U ) && ( tag_len <= sizeof( ucCheckTag ) ) )
+        {
+            lResult = pxEntry->pxBackend->xGcmCrypt( pxEntry->pxBackend->pvContext, pxEntry->pvHandle, MBEDTLS_GCM_DECRYPT,
+                                                     iv, iv_len, add, add_len, input, output, length, ucCheckTag, tag_len );
+
+            /* As mbedTLS does: decrypt, then compare the tags in constant time. */
+            if( ( lResult == 0 ) && ( mbedtls_ct_memcmp( tag, ucCheckTag, tag_len ) != 0 ) )
+            {
+                mbedtls_platform_zeroize( output, length );
+                lResult = MBEDTLS_ERR_GCM_AUTH_FAILED;
+            }
+
+            mbedtls_platform_zeroize( ucCheckTag, sizeof( ucCheckTag ) );
+        }
+
+        if( lResult != CRYPTO_OFFLOAD_NOT_SUPPORTED )
+        {
+            xCounters.ulGcmBackend++;
+        }
+        else
+        {
+            lResult = __real_mbedtls_gcm_auth_decrypt( ctx, length, iv, iv_len, add, add_len,
+                                                       tag, tag_len, input, output );
+            xCounters.ulGcmSoftware++;
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_starts( mbedtls_gcm_context * ctx,
+                                   int mode,
+                                   const unsigned char * iv,
+                                   size_t iv_len )
+    {
+        CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        const CryptoOffloadBackend_t * pxBackend;
+        int lResult;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->pxBackend->xGcmStarts != NULL ) && ( pxEntry->pxBackend->xGcmUpdateAd != NULL ) &&
+            ( pxEntry->pxBackend->xGcmUpdate != NULL ) && ( pxEntry->pxBackend->xGcmFinish != NULL ) )
+        {
+            pxBackend = pxEntry->pxBackend;
+            lResult = pxBackend->xGcmStarts( pxBackend->pvContext, pxEntry->pvHandle, mode, iv, iv_len );
+            pxEntry->xMultiPart = ( lResult == 0 ) ? pdTRUE : pdFALSE;
+            xCounters.ulGcmBackend++;
+        }
+        else
+        {
+            if( pxEntry != NULL )
+            {
+                pxEntry->xMultiPart = pdFALSE;
+            }
+
+            lResult = __real_mbedtls_gcm_starts( ctx, mode, iv, iv_len );
+            xCounters.ulGcmSoftware++;
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_update_ad( mbedtls_gcm_context * ctx,
+                                      const unsigned char * add,
+                                      size_t add_len )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->xMultiPart == pdTRUE ) )
+        {
+            lResult = pxEntry->pxBackend->xGcmUpdateAd( pxEntry->pxBackend->pvContext, pxEntry->pvHandle, add, add_len );
+        }
+        else
+        {
+            lResult = __real_mbedtls_gcm_update_ad( ctx, add, add_len );
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_update( mbedtls_gcm_context * ctx,
+                                   const unsigned char * input,
+                                   size_t input_length,
+                                   unsigned char * output,
+                                   size_t output_size,
+                                   size_t * output_length )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->xMultiPart == pdTRUE ) )
+        {
+            lResult = pxEntry->pxBackend->xGcmUpdate( pxEntry->pxBackend->pvContext, pxEntry->pvHandle,
+                                                      input, input_length, output, output_size, output_length );
+        }
+        else
+        {
+            lResult = __real_mbedtls_gcm_update( ctx, input, input_length, output, output_size, output_length );
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_gcm_finish( mbedtls_gcm_context * ctx,
+                                   unsigned char * output,
+                                   size_t output_size,
+                                   size_t * output_length,
+                                   unsigned char * tag,
+                                   size_t tag_len )
+    {
+        CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult;
+
+        if( ( pxEntry != NULL ) && ( pxEntry->xMultiPart == pdTRUE ) )
+        {
+            lResult = pxEntry->pxBackend->xGcmFinish( pxEntry->pxBackend->pvContext, pxEntry->pvHandle,
+                                                      output, output_size, output_length, tag, tag_len );
+            pxEntry->xMultiPart = pdFALSE;
+        }
+        else
+        {
+            lResult = __real_mbedtls_gcm_finish( ctx, output, output_size, output_length, tag, tag_len );
+        }
+
+        return lResult;
+    }
+
+#endif /* MBEDTLS_GCM_C */
+/*-----------------------------------------------------------*/
+
+#if defined( MBEDTLS_SHA256_C )
+
+/**
+ * @brief Free the backend hash of a SHA-256 context, if it has one.
+ */
+    static void prvSha256ReleaseHash( const mbedtls_sha256_context * ctx )
+    {
+        CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+
+        if( pxEntry != NULL )
+        {
+            if( pxEntry->pxBackend->xSha256Free != NULL )
+            {
+                pxEntry->pxBackend->xSha256Free( pxEntry->pxBackend->pvContext, pxEntry->pvHandle );
+            }
+
+            prvReleaseEntry( pxEntry );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    void __wrap_mbedtls_sha256_free( mbedtls_sha256_context * ctx )
+    {
+        prvSha256ReleaseHash( ctx );
+        __real_mbedtls_sha256_free( ctx );
+    }
+/*-----------------------------------------------------------*/
+
+    void __wrap_mbedtls_sha256_clone( mbedtls_sha256_context * dst,
+                                      const mbedtls_sha256_context * src )
+    {
+        const CryptoOffloadEntry_t * pxSource = prvFindEntry( src );
+        void * pvHash = NULL;
+
+        prvSha256ReleaseHash( dst );
+        __real_mbedtls_sha256_clone( dst, src );
+
+        if( pxSource != NULL )
+        {
+            if( ( pxSource->pxBackend->xSha256Clone == NULL ) ||
+                ( pxSource->pxBackend->xSha256Clone( pxSource->pxBackend->pvContext, &pvHash, pxSource->pvHandle ) != 0 ) )
+            {
+                /* mbedtls_sha256_clone() cannot fail. dst holds the software
+                 * state of src, which was never updated, so its digest will
+                 * not match and the handshake using it fails. */
+                LogError( ( "Failed to clone a SHA-256 context." ) );
+            }
+            else if( prvClaimEntry( dst, pxSource->pxBackend, pvHash ) == NULL )
+            {
+                LogError( ( "Failed to clone a SHA-256 context." ) );
+
+                if( pxSource->pxBackend->xSha256Free != NULL )
+                {
+                    pxSource->pxBackend->xSha256Free( pxSource->pxBackend->pvContext, pvHash );
+                }
+            }
+            else
+            {
+                /* The clone is held by the backend. */
+            }
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_sha256_starts( mbedtls_sha256_context * ctx,
+                                      int is224 )
+    {
+        const CryptoOffloadBackend_t * pxBackend = pxRegisteredBackend;
+        void * pvHash = NULL;
+        int lResult = CRYPTO_OFFLOAD_NOT_SUPPORTED;
+
+        /* A context may be restarted after mbedtls_sha256_finish(). */
+        prvSha256ReleaseHash( ctx );
+
+        if( ( pxBackend != NULL ) && ( pxBackend->xSha256Starts != NULL ) )
+        {
+            lResult = pxBackend->xSha256Starts( pxBackend->pvContext, &pvHash, is224 );
+        }
+
+        if( ( lResult == 0 ) && ( prvClaimEntry( ctx, pxBackend, pvHash ) == NULL ) )
+        {
+            if( pxBackend->xSha256Free != NULL )
+            {
+                pxBackend->xSha256Free( pxBackend->pvContext, pvHash );
+            }
+
+            lResult = CRYPTO_OFFLOAD_NOT_SUPPORTED;
+        }
+
+        if( lResult == CRYPTO_OFFLOAD_NOT_SUPPORTED )
+        {
+            lResult = __real_mbedtls_sha256_starts( ctx, is224 );
+            xCounters.ulSha256Software++;
+        }
+        else
+        {
+            xCounters.ulSha256Backend++;
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_sha256_update( mbedtls_sha256_context * ctx,
+                                      const unsigned char * input,
+                                      size_t ilen )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult;
+
+        if( pxEntry != NULL )
+        {
+            lResult = pxEntry->pxBackend->xSha256Update( pxEntry->pxBackend->pvContext, pxEntry->pvHandle, input, ilen );
+        }
+        else
+        {
+            lResult = __real_mbedtls_sha256_update( ctx, input, ilen );
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    int __wrap_mbedtls_sha256_finish( mbedtls_sha256_context * ctx,
+                                      unsigned char * output )
+    {
+        const CryptoOffloadEntry_t * pxEntry = prvFindEntry( ctx );
+        int lResult;
+
+        if( pxEntry != NULL )
+        {
+            lResult = pxEntry->pxBackend->xSha256Finish( pxEntry->pxBackend->pvContext, pxEntry->pvHandle, output );
+        }
+        else
+        {
+            lResult = __real_mbedtls_sha256_finish( ctx, output );
+        }
+
+        return lResult;
+    }
+
+#endif /* MBEDTLS_SHA256_C */
+/*-----------------------------------------------------------*/
+
+#if defined( MBEDTLS_ECDH_C ) && defined( MBEDTLS_ECDH_COMPUTE_SHARED_ALT )
+
+    int mbedtls_ecdh_compute_shared( mbedtls_ecp_group * grp,
+                                     mbedtls_mpi * z,
+                                     const mbedtls_ecp_point * Q,
+                                     const mbedtls_mpi * d,
+                                     int ( * f_rng )( void *, unsigned char *, size_t ),
+                                     void * p_rng )
+    {
+        const CryptoOffloadBackend_t * pxBackend = pxRegisteredBackend;
+        const CryptoOffloadBackend_t * pxSoftware = pxCryptoOffload_GetSoftwareBackend();
+        int lResult = CRYPTO_OFFLOAD_NOT_SUPPORTED;
+
+        if( ( pxBackend != NULL ) && ( pxBackend->xEcdhComputeShared != NULL ) )
+        {
+            lResult = pxBackend->xEcdhComputeShared( pxBackend->pvContext, grp, z, Q, d, f_rng, p_rng );
+        }
+
+        if( lResult == CRYPTO_OFFLOAD_NOT_SUPPORTED )
+        {
+            lResult = pxSoftware->xEcdhComputeShared( pxSoftware->pvContext, grp, z, Q, d, f_rng, p_rng );
+            xCounters.ulEcdhSoftware++;
+        }
+        else
+        {
+            xCounters.ulEcdhBackend++;
+        }
+
+        return lResult;
+    }
+
+#endif /* if defined( MBEDTLS_ECDH_C ) && defined( MBEDTLS_ECDH_COMPUTE_SHARED_ALT ) */
+/*-----------------------------------------------------------*/
@@ -0,0 +1,286 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_crypto_offload.h
+ * @brief Routes mbedTLS AES-GCM, SHA-256 and ECDH operations to a pluggable
+ * accelerator backend.
+ *
+ * mbedTLS offers two ways to accelerate a primitive: replacing a whole module
+ * with an alternative implementation (MBEDTLS_xxx_ALT), or a PSA accelerator
+ * driver. PSA drivers are bound into the driver wrappers when mbedTLS is
+ * built, and a module alternative removes mbedTLS's own code, which is then
+ * no longer there to fall back on. This layer therefore stands in front of
+ * the unmodified mbedTLS functions, which lets the backend be chosen at run
+ * time:
+ *
+ * - AES-GCM: link with -Wl,--wrap=<name> for each GCM function listed in
+ *   mbedtls_crypto_offload_wrap.h. A TLS record is encrypted or decrypted with
+ *   one call, on both the legacy cipher and the PSA code paths, so the backend
+ *   gets whole records rather than single blocks.
+ * - SHA-256 and SHA-224: the same for each SHA-256 function listed there. The
+ *   backend gets one call per update.
+ * - ECDH: define MBEDTLS_ECDH_COMPUTE_SHARED_ALT in the mbedTLS configuration,
+ *   e.g. through MBEDTLS_USER_CONFIG_FILE.
+ *
+ * Operations that the registered backend declines, or that arrive when
+ * #cryptooffloadMAX_CONTEXTS contexts are already held by the backend, run on
+ * mbedTLS's own code. Calls that mbedTLS makes within gcm.c or sha256.c, such
+ * as mbedtls_sha256(), are not wrapped by the linker and always run there.
+ */
+
+#ifndef MBEDTLS_CRYPTO_OFFLOAD_H
+#define MBEDTLS_CRYPTO_OFFLOAD_H
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* MBedTLS Includes */
+#if !defined( MBEDTLS_CONFIG_FILE )
+    #include "mbedtls/mbedtls_config.h"
+#else
+    #include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/build_info.h"
+#include "mbedtls/cipher.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/bignum.h"
+#include "mbedtls/platform.h"
+
+/**
+ * @brief The number of GCM and SHA-256 contexts that can be held by the
+ * registered backend at once. Further contexts run in software.
+ */
+#ifndef cryptooffloadMAX_CONTEXTS
+    #define cryptooffloadMAX_CONTEXTS    16
+#endif
+
+/**
+ * @brief Value a backend returns to ask the offload layer to complete the
+ * operation with the software backend.
+ */
+#define CRYPTO_OFFLOAD_NOT_SUPPORTED    MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Table of accelerator entry points.
+ *
+ * Each callback returns 0 on success, #CRYPTO_OFFLOAD_NOT_SUPPORTED to fall
+ * back to software, or any other negative mbedTLS error code on failure. A
+ * NULL callback is equivalent to always returning #CRYPTO_OFFLOAD_NOT_SUPPORTED.
+ *
+ * Keys and hashes are referred to by handles that the backend allocates in
+ * xGcmSetKey and xSha256Starts. A backend may decline a GCM operation on a key
+ * it accepted, in which case the operation runs on mbedTLS's own code, which
+ * always has the key set up as well. A started hash stays with the backend
+ * that started it, so xSha256Update, xSha256Finish and xSha256Clone must not
+ * decline. A backend that needs software GCM or SHA-256 itself must call the
+ * __real_ functions of mbedtls_crypto_offload_wrap.h, as the wrapped ones
+ * would come back to the offload layer.
+ */
+typedef struct CryptoOffloadBackend
+{
+    const char * pcName; /**< @brief Name used in log messages. */
+    void * pvContext;    /**< @brief Passed unchanged to every callback. */
+
+    /**
+     * @brief Set up a GCM key and return its handle in ppvKey. xCipher is
+     * MBEDTLS_CIPHER_ID_AES for TLS; decline others unless supported.
+     */
+    int ( * xGcmSetKey )( void * pvContext,
+                          void ** ppvKey,
+                          mbedtls_cipher_id_t xCipher,
+                          const unsigned char * pucKey,
+                          unsigned int uxKeyBits );
+
+    /**
+     * @brief Release a key handle returned by xGcmSetKey.
+     */
+    void ( * xGcmFreeKey )( void * pvContext,
+                            void * pvKey );
+
+    /**
+     * @brief Encrypt or decrypt xLength bytes and compute the tag, with the
+     * same arguments as mbedtls_gcm_crypt_and_tag(). The tag is always written,
+     * the layer checks it when decrypting.
+     */
+    int ( * xGcmCrypt )( void * pvContext,
+                         void * pvKey,
+                         int lMode,
+                         const unsigned char * pucIv,
+                         size_t xIvLength,
+                         const unsigned char * pucAad,
+                         size_t xAadLength,
+                         const unsigned char * pucInput,
+                         unsigned char * pucOutput,
+                         size_t xLength,
+                         unsigned char * pucTag,
+                         size_t xTagLength );
+
+    /**
+     * @brief The multi-part GCM functions, with the same arguments as
+     * mbedtls_gcm_starts(), mbedtls_gcm_update_ad(), mbedtls_gcm_update() and
+     * mbedtls_gcm_finish(). TLS does not use them. Either all four are given
+     * or the layer runs multi-part operations in software.
+     */
+    int ( * xGcmStarts )( void * pvContext,
+                          void * pvKey,
+                          int lMode,
+                          const unsigned char * pucIv,
+                          size_t xIvLength );
+    int ( * xGcmUpdateAd )( void * pvContext,
+                            void * pvKey,
+                            const unsigned char * pucAad,
+                            size_t xAadLength );
+    int ( * xGcmUpdate )( void * pvContext,
+                          void * pvKey,
+                          const unsigned char * pucInput,
+                          size_t xInputLength,
+                          unsigned char * pucOutput,
+                          size_t xOutputSize,
+                          size_t * pxOutputLength );
+    int ( * xGcmFinish )( void * pvContext,
+                          void * pvKey,
+                          unsigned char * pucOutput,
+                          size_t xOutputSize,
+                          size_t * pxOutputLength,
+                          unsigned char * pucTag,
+                          size_t xTagLength );
+
+    /**
+     * @brief Start a SHA-256, or SHA-224 when lIs224 is 1, and return its
+     * handle in ppvHash.
+     */
+    int ( * xSha256Starts )( void * pvContext,
+                             void ** ppvHash,
+                             int lIs224 );
+
+    /**
+     * @brief Add xLength bytes of any length to a hash.
+     */
+    int ( * xSha256Update )( void * pvContext,
+                             void * pvHash,
+                             const unsigned char * pucInput,
+                             size_t xLength );
+
+    /**
+     * @brief Write the digest, 32 bytes, or 28 for SHA-224.
+     */
+    int ( * xSha256Finish )( void * pvContext,
+                             void * pvHash,
+                             unsigned char pucOutput[ 32 ] );
+
+    /**
+     * @brief Copy a hash in progress to a new handle. TLS clones the
+     * handshake transcript hash.
+     */
+    int ( * xSha256Clone )( void * pvContext,
+                            void ** ppvDestination,
+                            const void * pvSource );
+
+    /**
+     * @brief Release a hash handle.
+     */
+    void ( * xSha256Free )( void * pvContext,
+                            void * pvHash );
+
+    /**
+     * @brief Compute the ECDH shared secret, i.e. the X coordinate of
+     * pxPrivate * pxPeerPoint, into pxSharedSecret.
+     */
+    int ( * xEcdhComputeShared )( void * pvContext,
+                                  mbedtls_ecp_group * pxGroup,
+                                  mbedtls_mpi * pxSharedSecret,
+                                  const mbedtls_ecp_point * pxPeerPoint,
+                                  const mbedtls_mpi * pxPrivate,
+                                  int ( * pxRng )( void *, unsigned char *, size_t ),
+                                  void * pvRng );
+} CryptoOffloadBackend_t;
+
+/**
+ * @brief The number of operations done by the registered backend and by the
+ * software backend.
+ */
+typedef struct CryptoOffloadCounters
+{
+    uint32_t ulGcmBackend;     /**< @brief GCM operations, i.e. TLS records, done by the registered backend. */
+    uint32_t ulGcmSoftware;    /**< @brief GCM operations done in software. A multi-part operation counts once. */
+    uint32_t ulSha256Backend;  /**< @brief SHA-256 and SHA-224 hashes started by the registered backend. */
+    uint32_t ulSha256Software; /**< @brief Hashes started in software. */
+    uint32_t ulEcdhBackend;    /**< @brief ECDH shared secrets computed by the registered backend. */
+    uint32_t ulEcdhSoftware;   /**< @brief ECDH shared secrets computed in software. */
+} CryptoOffloadCounters_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Register the backend that receives offloaded operations.
+ *
+ * @param[in] pxBackend The backend to use, or NULL to use the software
+ * backend only. The structure must remain valid while registered.
+ *
+ * @note Call this before any TLS connection is established. Keys and hashes
+ * stay with the backend that set them up.
+ */
+void vCryptoOffload_SetBackend( const CryptoOffloadBackend_t * pxBackend );
+
+/**
+ * @brief Get the backend registered with vCryptoOffload_SetBackend().
+ *
+ * @return The registered backend, or NULL if there is none.
+ */
+const CryptoOffloadBackend_t * pxCryptoOffload_GetBackend( void );
+
+/**
+ * @brief Get the software backend, which calls mbedTLS's own implementations.
+ *
+ * It can be registered, to exercise the backend interface without an
+ * accelerator, or wrapped by an accelerator backend that handles only part of
+ * the work.
+ *
+ * @return Pointer to the software backend.
+ */
+const CryptoOffloadBackend_t * pxCryptoOffload_GetSoftwareBackend( void );
+
+/**
+ * @brief Read the operation counters.
+ *
+ * @param[out] pxCounters Filled with the current counter values.
+ *
+ * @note Counters are not updated atomically. Read them when no TLS connection
+ * is active for exact values.
+ */
+void vCryptoOffload_GetCounters( CryptoOffloadCounters_t * pxCounters );
+
+/**
+ * @brief Reset the operation counters to 0.
+ */
+void vCryptoOffload_ResetCounters( void );
+
+#endif /* MBEDTLS_CRYPTO_OFFLOAD_H */
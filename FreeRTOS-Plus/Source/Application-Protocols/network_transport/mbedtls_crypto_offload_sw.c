@@ -0,0 +1,412 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_crypto_offload_sw.c
+ * @brief Software backend for the mbedTLS crypto offload layer.
+ *
+ * GCM and SHA-256 call mbedTLS's own functions through the __real_ names of
+ * mbedtls_crypto_offload_wrap.h, since the wrapped names lead back to the
+ * offload layer. ECDH calls mbedtls_ecp_mul(), which is what
+ * mbedtls_ecdh_compute_shared() itself uses.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Mbedtls Includes */
+#ifndef MBEDTLS_ALLOW_PRIVATE_ACCESS
+    #define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#endif /* MBEDTLS_ALLOW_PRIVATE_ACCESS */
+
+#include "mbedtls_crypto_offload.h"
+#include "mbedtls_crypto_offload_wrap.h"
+
+#if defined( MBEDTLS_GCM_C )
+    #define cryptooffloadSOFTWARE_GCM
+#endif
+
+#if defined( MBEDTLS_SHA256_C )
+    #define cryptooffloadSOFTWARE_SHA256
+#endif
+
+#include "mbedtls/ecp.h"
+
+/*-----------------------------------------------------------*/
+
+#ifdef cryptooffloadSOFTWARE_GCM
+
+    static int prvGcmSetKey( void * pvContext,
+                             void ** ppvKey,
+                             mbedtls_cipher_id_t xCipher,
+                             const unsigned char * pucKey,
+                             unsigned int uxKeyBits );
+    static void prvGcmFreeKey( void * pvContext,
+                               void * pvKey );
+    static int prvGcmCrypt( void * pvContext,
+                            void * pvKey,
+                            int lMode,
+                            const unsigned char * pucIv,
+                            size_t xIvLength,
+                            const unsigned char * pucAad,
+                            size_t xAadLength,
+                            const unsigned char * pucInput,
+                            unsigned char * pucOutput,
+                            size_t xLength,
+                            unsigned char * pucTag,
+                            size_t xTagLength );
+    static int prvGcmStarts( void * pvContext,
+                             void * pvKey,
+                             int lMode,
+                             const unsigned char * pucIv,
+                             size_t xIvLength );
+    static int prvGcmUpdateAd( void * pvContext,
+                               void * pvKey,
+                               const unsigned char * pucAad,
+                               size_t xAadLength );
+    static int prvGcmUpdate( void * pvContext,
+                             void * pvKey,
+                             const unsigned char * pucInput,
+                             size_t xInputLength,
+                             unsigned char * pucOutput,
+                             size_t xOutputSize,
+                             size_t * pxOutputLength );
+    static int prvGcmFinish( void * pvContext,
+                             void * pvKey,
+                             unsigned char * pucOutput,
+                             size_t xOutputSize,
+                             size_t * pxOutputLength,
+                             unsigned char * pucTag,
+                             size_t xTagLength );
+
+#endif /* cryptooffloadSOFTWARE_GCM */
+
+#ifdef cryptooffloadSOFTWARE_SHA256
+
+    static int prvSha256Starts( void * pvContext,
+                                void ** ppvHash,
+                                int lIs224 );
+    static int prvSha256Update( void * pvContext,
+                                void * pvHash,
+                                const unsigned char * pucInput,
+                                size_t xLength );
+    static int prvSha256Finish( void * pvContext,
+                                void * pvHash,
+                                unsigned char pucOutput[ 32 ] );
+    static int prvSha256Clone( void * pvContext,
+                               void ** ppvDestination,
+                               const void * pvSource );
+    static void prvSha256Free( void * pvContext,
+                               void * pvHash );
+
+#endif /* cryptooffloadSOFTWARE_SHA256 */
+
+static int prvEcdhComputeShared( void * pvContext,
+                                 mbedtls_ecp_group * pxGroup,
+                                 mbedtls_mpi * pxSharedSecret,
+                                 const mbedtls_ecp_point * pxPeerPoint,
+                                 const mbedtls_mpi * pxPrivate,
+                                 int ( * pxRng )( void *, unsigned char *, size_t ),
+                                 void * pvRng );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The software backend. It handles every operation that is built.
+ */
+static const CryptoOffloadBackend_t xSoftwareBackend =
+{
+    .pcName             = "software",
+    .pvContext          = NULL,
+    #ifdef cryptooffloadSOFTWARE_GCM
+        .xGcmSetKey     = prvGcmSetKey,
+        .xGcmFreeKey    = prvGcmFreeKey,
+        .xGcmCrypt      = prvGcmCrypt,
+        .xGcmStarts     = prvGcmStarts,
+        .xGcmUpdateAd   = prvGcmUpdateAd,
+        .xGcmUpdate     = prvGcmUpdate,
+        .xGcmFinish     = prvGcmFinish,
+    #endif
+    #ifdef cryptooffloadSOFTWARE_SHA256
+        .xSha256Starts  = prvSha256Starts,
+        .xSha256Update  = prvSha256Update,
+        .xSha256Finish  = prvSha256Finish,
+        .xSha256Clone   = prvSha256Clone,
+        .xSha256Free    = prvSha256Free,
+    #endif
+    .xEcdhComputeShared = prvEcdhComputeShared
+};
+
+/*-----------------------------------------------------------*/
+
+#ifdef cryptooffloadSOFTWARE_GCM
+
+    static int prvGcmSetKey( void * pvContext,
+                             void ** ppvKey,
+                             mbedtls_cipher_id_t xCipher,
+                             const unsigned char * pucKey,
+                             unsigned int uxKeyBits )
+    {
+        mbedtls_gcm_context * pxGcm;
+        int lResult;
+
+        ( void ) pvContext;
+
+        pxGcm = mbedtls_calloc( 1, sizeof( *pxGcm ) );
+
+        if( pxGcm == NULL )
+        {
+            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        }
+
+        mbedtls_gcm_init( pxGcm );
+        lResult = __real_mbedtls_gcm_setkey( pxGcm, xCipher, pucKey, uxKeyBits );
+
+        if( lResult == 0 )
+        {
+            *ppvKey = pxGcm;
+        }
+        else
+        {
+            prvGcmFreeKey( NULL, pxGcm );
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvGcmFreeKey( void * pvContext,
+                               void * pvKey )
+    {
+        ( void ) pvContext;
+
+        __real_mbedtls_gcm_free( pvKey );
+        mbedtls_free( pvKey );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvGcmCrypt( void * pvContext,
+                            void * pvKey,
+                            int lMode,
+                            const unsigned char * pucIv,
+                            size_t xIvLength,
+                            const unsigned char * pucAad,
+                            size_t xAadLength,
+                            const unsigned char * pucInput,
+                            unsigned char * pucOutput,
+                            size_t xLength,
+                            unsigned char * pucTag,
+                            size_t xTagLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_gcm_crypt_and_tag( pvKey, lMode, xLength, pucIv, xIvLength, pucAad, xAadLength,
+                                                   pucInput, pucOutput, xTagLength, pucTag );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvGcmStarts( void * pvContext,
+                             void * pvKey,
+                             int lMode,
+                             const unsigned char * pucIv,
+                             size_t xIvLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_gcm_starts( pvKey, lMode, pucIv, xIvLength );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvGcmUpdateAd( void * pvContext,
+                               void * pvKey,
+                               const unsigned char * pucAad,
+                               size_t xAadLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_gcm_update_ad( pvKey, pucAad, xAadLength );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvGcmUpdate( void * pvContext,
+                             void * pvKey,
+                             const unsigned char * pucInput,
+                             size_t xInputLength,
+                             unsigned char * pucOutput,
+                             size_t xOutputSize,
+                             size_t * pxOutputLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_gcm_update( pvKey, pucInput, xInputLength, pucOutput, xOutputSize, pxOutputLength );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvGcmFinish( void * pvContext,
+                             void * pvKey,
+                             unsigned char * pucOutput,
+                             size_t xOutputSize,
+                             size_t * pxOutputLength,
+                             unsigned char * pucTag,
+                             size_t xTagLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_gcm_finish( pvKey, pucOutput, xOutputSize, pxOutputLength, pucTag, xTagLength );
+    }
+
+#endif /* cryptooffloadSOFTWARE_GCM */
+/*-----------------------------------------------------------*/
+
+#ifdef cryptooffloadSOFTWARE_SHA256
+
+    static int prvSha256Starts( void * pvContext,
+                                void ** ppvHash,
+                                int lIs224 )
+    {
+        mbedtls_sha256_context * pxSha256;
+        int lResult;
+
+        ( void ) pvContext;
+
+        pxSha256 = mbedtls_calloc( 1, sizeof( *pxSha256 ) );
+
+        if( pxSha256 == NULL )
+        {
+            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        }
+
+        mbedtls_sha256_init( pxSha256 );
+        lResult = __real_mbedtls_sha256_starts( pxSha256, lIs224 );
+
+        if( lResult == 0 )
+        {
+            *ppvHash = pxSha256;
+        }
+        else
+        {
+            prvSha256Free( NULL, pxSha256 );
+        }
+
+        return lResult;
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvSha256Update( void * pvContext,
+                                void * pvHash,
+                                const unsigned char * pucInput,
+                                size_t xLength )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_sha256_update( pvHash, pucInput, xLength );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvSha256Finish( void * pvContext,
+                                void * pvHash,
+                                unsigned char pucOutput[ 32 ] )
+    {
+        ( void ) pvContext;
+
+        return __real_mbedtls_sha256_finish( pvHash, pucOutput );
+    }
+/*-----------------------------------------------------------*/
+
+    static int prvSha256Clone( void * pvContext,
+                               void ** ppvDestination,
+                               const void * pvSource )
+    {
+        mbedtls_sha256_context * pxSha256;
+
+        ( void ) pvContext;
+
+        pxSha256 = mbedtls_calloc( 1, sizeof( *pxSha256 ) );
+
+        if( pxSha256 == NULL )
+        {
+            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        }
+
+        mbedtls_sha256_init( pxSha256 );
+        __real_mbedtls_sha256_clone( pxSha256, pvSource );
+        *ppvDestination = pxSha256;
+
+        return 0;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvSha256Free( void * pvContext,
+                               void * pvHash )
+    {
+        ( void ) pvContext;
+
+        __real_mbedtls_sha256_free( pvHash );
+        mbedtls_free( pvHash );
+    }
+
+#endif /* cryptooffloadSOFTWARE_SHA256 */
+/*-----------------------------------------------------------*/
+
+static int prvEcdhComputeShared( void * pvContext,
+                                 mbedtls_ecp_group * pxGroup,
+                                 mbedtls_mpi * pxSharedSecret,
+                                 const mbedtls_ecp_point * pxPeerPoint,
+                                 const mbedtls_mpi * pxPrivate,
+                                 int ( * pxRng )( void *, unsigned char *, size_t ),
+                                 void * pvRng )
+{
+    mbedtls_ecp_point xPoint;
+    int lResult;
+
+    ( void ) pvContext;
+
+    mbedtls_ecp_point_init( &xPoint );
+
+    /* Same steps as the built in mbedtls_ecdh_compute_shared(). */
+    lResult = mbedtls_ecp_mul( pxGroup, &xPoint, pxPrivate, pxPeerPoint, pxRng, pvRng );
+
+    if( ( lResult == 0 ) && ( mbedtls_ecp_is_zero( &xPoint ) != 0 ) )
+    {
+        lResult = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_mpi_copy( pxSharedSecret, &( xPoint.X ) );
+    }
+
+    mbedtls_ecp_point_free( &xPoint );
+
+    return lResult;
+}
+/*-----------------------------------------------------------*/
+
+const CryptoOffloadBackend_t * pxCryptoOffload_GetSoftwareBackend( void )
+{
+    return &xSoftwareBackend;
+}
+/*-----------------------------------------------------------*/
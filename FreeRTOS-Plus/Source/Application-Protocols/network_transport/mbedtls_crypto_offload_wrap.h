@@ -0,0 +1,121 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file mbedtls_crypto_offload_wrap.h
+ * @brief mbedTLS's own GCM and SHA-256 functions, reached through the GNU
+ * linker option --wrap while the offload layer stands in for them.
+ *
+ * Link with -Wl,--wrap=<name> for every function below. Calls to <name> from
+ * other object files then go to __wrap_<name> in mbedtls_crypto_offload.c,
+ * and __real_<name> is the unmodified mbedTLS function.
+ */
+
+#ifndef MBEDTLS_CRYPTO_OFFLOAD_WRAP_H
+#define MBEDTLS_CRYPTO_OFFLOAD_WRAP_H
+
+#include "mbedtls_crypto_offload.h"
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+
+#if defined( MBEDTLS_GCM_C )
+
+    int __real_mbedtls_gcm_setkey( mbedtls_gcm_context * ctx,
+                                   mbedtls_cipher_id_t cipher,
+                                   const unsigned char * key,
+                                   unsigned int keybits );
+
+    void __real_mbedtls_gcm_free( mbedtls_gcm_context * ctx );
+
+    int __real_mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context * ctx,
+                                          int mode,
+                                          size_t length,
+                                          const unsigned char * iv,
+                                          size_t iv_len,
+                                          const unsigned char * add,
+                                          size_t add_len,
+                                          const unsigned char * input,
+                                          unsigned char * output,
+                                          size_t tag_len,
+                                          unsigned char * tag );
+
+    int __real_mbedtls_gcm_auth_decrypt( mbedtls_gcm_context * ctx,
+                                         size_t length,
+                                         const unsigned char * iv,
+                                         size_t iv_len,
+                                         const unsigned char * add,
+                                         size_t add_len,
+                                         const unsigned char * tag,
+                                         size_t tag_len,
+                                         const unsigned char * input,
+                                         unsigned char * output );
+
+    int __real_mbedtls_gcm_starts( mbedtls_gcm_context * ctx,
+                                   int mode,
+                                   const unsigned char * iv,
+                                   size_t iv_len );
+
+    int __real_mbedtls_gcm_update_ad( mbedtls_gcm_context * ctx,
+                                      const unsigned char * add,
+                                      size_t add_len );
+
+    int __real_mbedtls_gcm_update( mbedtls_gcm_context * ctx,
+                                   const unsigned char * input,
+                                   size_t input_length,
+                                   unsigned char * output,
+                                   size_t output_size,
+                                   size_t * output_length );
+
+    int __real_mbedtls_gcm_finish( mbedtls_gcm_context * ctx,
+                                   unsigned char * output,
+                                   size_t output_size,
+                                   size_t * output_length,
+                                   unsigned char * tag,
+                                   size_t tag_len );
+
+#endif /* MBEDTLS_GCM_C */
+
+#if defined( MBEDTLS_SHA256_C )
+
+    void __real_mbedtls_sha256_free( mbedtls_sha256_context * ctx );
+
+    void __real_mbedtls_sha256_clone( mbedtls_sha256_context * dst,
+                                      const mbedtls_sha256_context * src );
+
+    int __real_mbedtls_sha256_starts( mbedtls_sha256_context * ctx,
+                                      int is224 );
+
+    int __real_mbedtls_sha256_update( mbedtls_sha256_context * ctx,
+                                      const unsigned char * input,
+                                      size_t ilen );
+
+    int __real_mbedtls_sha256_finish( mbedtls_sha256_context * ctx,
+                                      unsigned char * output );
+
+#endif /* MBEDTLS_SHA256_C */
+
+#endif /* MBEDTLS_CRYPTO_OFFLOAD_WRAP_H */
@@ -58,6 +58,24 @@
     typedef struct xSOCKET * Socket_t; /**< @brief Socket handle data type. */
 #endif
 
+/**
+ * @brief Optional per-connection tuning of the underlying TCP socket.
+ *
+ * Any member left as 0 keeps the default of the TCP/IP stack, so a zero
+ * initialized structure behaves exactly like TCP_Sockets_Connect(). The
+ * options are applied before the connection is established, as most stacks
+ * do not allow the stream buffers to be resized once they are in use.
+ */
+typedef struct TcpSocketsOptions
+{
+    uint32_t rxBufferSize;  /**< @brief Size in bytes of the receive stream buffer. */
+    uint32_t txBufferSize;  /**< @brief Size in bytes of the transmit stream buffer. */
+    uint32_t rxWindowSize;  /**< @brief Receive window size, in units of MSS. */
+    uint32_t txWindowSize;  /**< @brief Transmit window size, in units of MSS. */
+    size_t lowWaterMark;    /**< @brief Free space in the receive buffer below which the peer is told to stop sending. */
+    size_t highWaterMark;   /**< @brief Free space in the receive buffer above which the peer may resume sending. */
+} TcpSocketsOptions_t;
+
 /**
  * @brief Establish a connection to server.
  *
@@ -77,6 +95,28 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
                                 uint32_t receiveTimeoutMs,
                                 uint32_t sendTimeoutMs );
 
+/**
+ * @brief Establish a connection to server, applying socket buffer and window
+ * options before connecting.
+ *
+ * @param[out] pTcpSocket The output parameter to return the created socket descriptor.
+ * @param[in] pHostName Server hostname to connect to.
+ * @param[in] port Server port to connect to.
+ * @param[in] receiveTimeoutMs Timeout (in milliseconds) for transport receive.
+ * @param[in] sendTimeoutMs Timeout (in milliseconds) for transport send.
+ * @param[in] pOptions Socket options to apply, or NULL to use the stack defaults.
+ *
+ * @note A timeout of 0 means infinite timeout.
+ *
+ * @return Non-zero value on error, 0 on success.
+ */
+BaseType_t TCP_Sockets_ConnectWithOptions( Socket_t * pTcpSocket,
+                                           const char * pHostName,
+                                           uint16_t port,
+                                           uint32_t receiveTimeoutMs,
+                                           uint32_t sendTimeoutMs,
+                                           const TcpSocketsOptions_t * pOptions );
+
 /**
  * @brief End connection to server.
  *
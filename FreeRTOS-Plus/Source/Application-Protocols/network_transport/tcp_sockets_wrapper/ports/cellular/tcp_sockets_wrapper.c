@@ -58,6 +58,8 @@ extern void vLoggingPrintf( const char * pcFormatString,
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "event_groups.h"
+#include "semphr.h"
+#include "timers.h"
 
 /* TCP sockets wrapper includes. */
 #include "tcp_sockets_wrapper.h"
@@ -102,6 +104,7 @@ extern uint8_t CellularSocketPdnContextId;
 #define SOCKET_OPEN_CALLBACK_BIT             ( 0x00000002U )
 #define SOCKET_OPEN_FAILED_CALLBACK_BIT      ( 0x00000004U )
 #define SOCKET_CLOSE_CALLBACK_BIT            ( 0x00000008U )
+#define SOCKET_TIMER_TASK_SYNC_BIT           ( 0x00000010U )
 
 /* Ticks MS conversion macros. */
 #define TICKS_TO_MS( xTicks )    ( ( ( xTicks ) * 1000U ) / ( ( uint32_t ) configTICK_RATE_HZ ) )
@@ -122,6 +125,32 @@ extern uint8_t CellularSocketPdnContextId;
 /* Invalid socket. */
 #define CELLULAR_INVALID_SOCKET                ( ( Socket_t ) ~0U )
 
+/* Default size of the per-socket receive ring buffer. Overridden by
+ * TcpSocketsOptions_t.rxBufferSize. Each modem read requests at most
+ * CELLULAR_MAX_RECV_DATA_LEN bytes, the most the modem returns for one receive
+ * command. */
+#ifndef CELLULAR_SOCKET_RX_BUFFER_SIZE
+    #define CELLULAR_SOCKET_RX_BUFFER_SIZE    ( CELLULAR_MAX_RECV_DATA_LEN )
+#endif
+
+/* Default size of the per-socket send staging buffer, one modem send command.
+ * Overridden by TcpSocketsOptions_t.txBufferSize. Define as 0 to pass every
+ * send straight to the modem. */
+#ifndef CELLULAR_SOCKET_TX_BUFFER_SIZE
+    #define CELLULAR_SOCKET_TX_BUFFER_SIZE    ( CELLULAR_MAX_SEND_DATA_LEN )
+#endif
+
+/* Longest time in milliseconds that data may stay in the send staging buffer.
+ * A one-shot timer writes out whatever no later send, blocking receive or
+ * disconnect has, from the timer task and with the socket send timeout. */
+#ifndef CELLULAR_SOCKET_TX_FLUSH_DELAY_MS
+    #define CELLULAR_SOCKET_TX_FLUSH_DELAY_MS    ( 10U )
+#endif
+
+#define CELLULAR_SOCKET_TX_FLUSH_DELAY_TICKS                              \
+    ( ( pdMS_TO_TICKS( CELLULAR_SOCKET_TX_FLUSH_DELAY_MS ) > 0U ) ?       \
+      pdMS_TO_TICKS( CELLULAR_SOCKET_TX_FLUSH_DELAY_MS ) : ( TickType_t ) 1U )
+
 /*-----------------------------------------------------------*/
 
 typedef struct xSOCKET
@@ -133,6 +162,35 @@ typedef struct xSOCKET
     TickType_t sendTimeout;
 
     EventGroupHandle_t socketEventGroupHandle;
+
+    /* Receive ring buffer. The timer task fills it with the modem reads queued
+     * by the data ready callback, and the socket user drains it. rxTail is only
+     * written by the timer task and rxHead only by the socket user. One byte is
+     * kept free to tell a full ring from an empty one. */
+    uint8_t * pRxBuffer;
+    size_t rxBufferSize;
+    volatile size_t rxHead;
+    volatile size_t rxTail;
+
+    /* rxFillQueued is set while a modem read is queued to the timer task, and
+     * rxModemPending when the modem may hold data the ring had no room for.
+     * rxStatus keeps the result of a failed modem read for the socket user. */
+    volatile BaseType_t rxFillQueued;
+    volatile BaseType_t rxModemPending;
+    volatile CellularError_t rxStatus;
+
+    /* Send staging buffer, NULL unless TcpSocketsOptions_t.txBufferSize is set.
+     * Small sends are coalesced here and written to the modem in one command. */
+    uint8_t * pTxBuffer;
+    size_t txBufferSize;
+    size_t txLength;
+
+    /* Writes out staged data after CELLULAR_SOCKET_TX_FLUSH_DELAY_MS. txMutex
+     * protects the staging buffer from concurrent use by the timer task, and
+     * txFlushError keeps the failure of a timer flush for the next call. */
+    TimerHandle_t txFlushTimer;
+    SemaphoreHandle_t txMutex;
+    BaseType_t txFlushError;
 } cellularSocketWrapper_t;
 
 /*-----------------------------------------------------------*/
@@ -144,6 +202,37 @@ typedef struct xSOCKET
  */
 static uint64_t getTimeMs( void );
 
+/**
+ * @brief Get the number of bytes in the socket receive ring buffer.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ *
+ * @return The number of bytes that can be returned without reading the modem.
+ */
+static size_t prvRxRingUsed( const cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Queue a modem read into the socket receive ring buffer to the timer task.
+ *
+ * Never blocks, so it can be called from the cellular library callbacks. If
+ * the timer command queue is full, the next receive queues the read instead.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ */
+static void prvRequestRxFill( cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Read the modem into the free space of the socket receive ring buffer.
+ *
+ * Runs in the timer task, as the data ready callback runs in the context that
+ * parses AT responses and cannot issue the receive command itself.
+ *
+ * @param[in] pvParameter1 Cellular socket wrapper context for socket operations.
+ * @param[in] ulParameter2 Unused.
+ */
+static void prvFillRxBuffer( void * pvParameter1,
+                             uint32_t ulParameter2 );
+
 /**
  * @brief Receive data from cellular socket.
  *
@@ -157,13 +246,114 @@ static uint64_t getTimeMs( void );
  * In this case, this function waits portMAX_DELAY until non-zero bytes of data is received
  * or until an error occurs.
  *
+ * Data is returned from the socket receive ring buffer, which the timer task
+ * fills when the data ready callback reports pending data. A read is also
+ * queued when the timeout expires, in case a data ready URC was missed.
+ *
  * @return Positive value indicate the number of bytes received. Otherwise, error code defined
  * in sockets_wrapper.h is returned.
  */
-static BaseType_t prvNetworkRecvCellular( const cellularSocketWrapper_t * pCellularSocketContext,
+static BaseType_t prvNetworkRecvCellular( cellularSocketWrapper_t * pCellularSocketContext,
                                           uint8_t * buf,
                                           size_t len );
 
+/**
+ * @brief Get the send timeout of a socket in milliseconds.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ *
+ * @return Send timeout in milliseconds, UINT32_MAX_DELAY_MS to wait forever.
+ */
+static uint32_t prvGetSendTimeoutMs( const cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Send data to the modem until all of it is sent, an error occurs or
+ * the send timeout expires.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ * @param[in] buf The data to send.
+ * @param[in] len The length of the data.
+ * @param[in] entryTimeMs The time the send timeout is measured from.
+ *
+ * @return Number of bytes sent, 0 if the socket was closed by the remote end, or
+ * TCP_SOCKETS_ERRNO_ERROR.
+ */
+static BaseType_t prvSendCellular( const cellularSocketWrapper_t * pCellularSocketContext,
+                                   const uint8_t * buf,
+                                   size_t len,
+                                   uint64_t entryTimeMs );
+
+/**
+ * @brief Write out the data staged in the socket send buffer.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ *
+ * @return TCP_SOCKETS_ERRNO_NONE if the staged data was sent completely. Otherwise,
+ * error code defined in sockets_wrapper.h is returned.
+ */
+static BaseType_t prvFlushTxBuffer( cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Write out the staged data on behalf of the socket user.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ *
+ * @return TCP_SOCKETS_ERRNO_NONE if nothing is staged or the staged data was sent
+ * completely, including by the flush timer. Otherwise, error code defined in
+ * sockets_wrapper.h is returned.
+ */
+static BaseType_t prvFlushStagedData( cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Stage data in the send buffer, or send it directly when it does not fit.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ * @param[in] buf The data to send.
+ * @param[in] len The length of the data.
+ * @param[in] entryTimeMs The time the send timeout is measured from.
+ *
+ * @note Must be called with txMutex held.
+ *
+ * @return Number of bytes sent or staged, 0 if the socket was closed by the remote
+ * end, or an error code defined in sockets_wrapper.h.
+ */
+static BaseType_t prvStageSend( cellularSocketWrapper_t * pCellularSocketContext,
+                                const uint8_t * buf,
+                                size_t len,
+                                uint64_t entryTimeMs );
+
+/**
+ * @brief Timer callback that writes out data left in the send staging buffer.
+ *
+ * @param[in] xTimer The flush timer, its ID is the socket context.
+ */
+static void prvTxFlushTimerCallback( TimerHandle_t xTimer );
+
+/**
+ * @brief Run by the timer task once it has processed the commands queued before it.
+ *
+ * @param[in] pvParameter1 The socket event group to signal.
+ * @param[in] ulParameter2 Unused.
+ */
+static void prvTimerTaskSynced( void * pvParameter1,
+                                uint32_t ulParameter2 );
+
+/**
+ * @brief Wait until the timer task has run the receive fills and timer
+ * commands queued for the socket so far.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ */
+static void prvSyncWithTimerTask( cellularSocketWrapper_t * pCellularSocketContext );
+
+/**
+ * @brief Delete the flush timer and its mutex, waiting until the timer callback
+ * can no longer run.
+ *
+ * @param[in] pCellularSocketContext Cellular socket wrapper context for socket operations.
+ */
+static void prvDeleteTxFlushTimer( cellularSocketWrapper_t * pCellularSocketContext );
+
 /**
  * @brief Callback used to inform about the status of socket open.
  *
@@ -278,88 +468,228 @@ static uint64_t getTimeMs( void )
 
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvNetworkRecvCellular( const cellularSocketWrapper_t * pCellularSocketContext,
-                                          uint8_t * buf,
-                                          size_t len )
+static size_t prvRxRingUsed( const cellularSocketWrapper_t * pCellularSocketContext )
 {
-    CellularSocketHandle_t cellularSocketHandle = NULL;
-    BaseType_t retRecvLength = 0;
+    size_t head = pCellularSocketContext->rxHead;
+    size_t tail = pCellularSocketContext->rxTail;
+    size_t usedLength = 0;
+
+    if( tail >= head )
+    {
+        usedLength = tail - head;
+    }
+    else
+    {
+        usedLength = ( pCellularSocketContext->rxBufferSize - head ) + tail;
+    }
+
+    return usedLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRequestRxFill( cellularSocketWrapper_t * pCellularSocketContext )
+{
+    if( pCellularSocketContext->rxFillQueued == pdFALSE )
+    {
+        pCellularSocketContext->rxFillQueued = pdTRUE;
+
+        if( xTimerPendFunctionCall( prvFillRxBuffer, pCellularSocketContext, 0, 0 ) != pdPASS )
+        {
+            pCellularSocketContext->rxFillQueued = pdFALSE;
+            pCellularSocketContext->rxModemPending = pdTRUE;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFillRxBuffer( void * pvParameter1,
+                             uint32_t ulParameter2 )
+{
+    cellularSocketWrapper_t * pCellularSocketContext = ( cellularSocketWrapper_t * ) pvParameter1;
+    size_t head = pCellularSocketContext->rxHead;
+    size_t tail = pCellularSocketContext->rxTail;
+    size_t freeLength = 0;
     uint32_t recvLength = 0;
-    TickType_t recvTimeout = 0;
-    TickType_t recvStartTime = 0;
     CellularError_t socketStatus = CELLULAR_SUCCESS;
-    EventBits_t waitEventBits = 0;
 
-    cellularSocketHandle = pCellularSocketContext->cellularSocketHandle;
+    ( void ) ulParameter2;
 
-    if( pCellularSocketContext->receiveTimeout >= portMAX_DELAY )
+    /* Clear the flag before reading so that a URC raised while the read is in
+     * progress queues another read. */
+    pCellularSocketContext->rxFillQueued = pdFALSE;
+
+    /* Only the contiguous free space is read into, the next read wraps. */
+    if( tail >= head )
     {
-        recvTimeout = portMAX_DELAY;
+        freeLength = pCellularSocketContext->rxBufferSize - tail;
+
+        if( head == 0U )
+        {
+            freeLength--;
+        }
     }
     else
     {
-        recvTimeout = pCellularSocketContext->receiveTimeout;
+        freeLength = head - tail - 1U;
     }
 
-    recvStartTime = xTaskGetTickCount();
-
-    ( void ) xEventGroupClearBits( pCellularSocketContext->socketEventGroupHandle,
-                                   SOCKET_DATA_RECEIVED_CALLBACK_BIT );
-    socketStatus = Cellular_SocketRecv( CellularHandle, cellularSocketHandle, buf, len, &recvLength );
+    if( freeLength > CELLULAR_MAX_RECV_DATA_LEN )
+    {
+        freeLength = CELLULAR_MAX_RECV_DATA_LEN;
+    }
 
-    /* Calculate remain recvTimeout. */
-    if( recvTimeout != portMAX_DELAY )
+    if( pCellularSocketContext->rxStatus != CELLULAR_SUCCESS )
     {
-        if( ( recvStartTime + recvTimeout ) > xTaskGetTickCount() )
+        /* The socket user has not seen the previous failure yet. */
+    }
+    else if( freeLength == 0U )
+    {
+        /* The socket user queues the read again once it has made room. */
+        pCellularSocketContext->rxModemPending = pdTRUE;
+    }
+    else
+    {
+        socketStatus = Cellular_SocketRecv( CellularHandle,
+                                            pCellularSocketContext->cellularSocketHandle,
+                                            &pCellularSocketContext->pRxBuffer[ tail ],
+                                            ( uint32_t ) freeLength,
+                                            &recvLength );
+
+        if( socketStatus == CELLULAR_SUCCESS )
         {
-            recvTimeout = recvTimeout - ( xTaskGetTickCount() - recvStartTime );
+            pCellularSocketContext->rxTail = ( tail + recvLength ) % pCellularSocketContext->rxBufferSize;
+
+            /* A full read means the modem may still hold data for this socket.
+             * Modems only raise the data ready URC again once their buffer has
+             * been drained, so read again. */
+            if( recvLength >= ( uint32_t ) freeLength )
+            {
+                prvRequestRxFill( pCellularSocketContext );
+            }
         }
         else
         {
-            recvTimeout = 0;
+            pCellularSocketContext->rxStatus = socketStatus;
+        }
+
+        if( ( recvLength > 0U ) || ( socketStatus != CELLULAR_SUCCESS ) )
+        {
+            ( void ) xEventGroupSetBits( pCellularSocketContext->socketEventGroupHandle,
+                                         SOCKET_DATA_RECEIVED_CALLBACK_BIT );
         }
     }
 
-    if( ( socketStatus == CELLULAR_SUCCESS ) && ( recvLength == 0U ) &&
-        ( recvTimeout != 0U ) )
+    LogDebug( ( "prvFillRxBuffer read %lu status %d", ( unsigned long ) recvLength, socketStatus ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvNetworkRecvCellular( cellularSocketWrapper_t * pCellularSocketContext,
+                                          uint8_t * buf,
+                                          size_t len )
+{
+    BaseType_t retRecvLength = 0;
+    size_t copyLength = 0;
+    size_t firstLength = 0;
+    size_t head = 0;
+    TickType_t recvTimeout = 0;
+    TimeOut_t recvTimeOut = { 0 };
+    EventBits_t waitEventBits = 0;
+    BaseType_t timedOut = pdFALSE;
+
+    if( pCellularSocketContext->receiveTimeout >= portMAX_DELAY )
     {
+        recvTimeout = portMAX_DELAY;
+    }
+    else
+    {
+        recvTimeout = pCellularSocketContext->receiveTimeout;
+    }
+
+    vTaskSetTimeOutState( &recvTimeOut );
+
+    /* Only wait when the ring buffer is empty. */
+    while( ( prvRxRingUsed( pCellularSocketContext ) == 0U ) &&
+           ( pCellularSocketContext->rxStatus == CELLULAR_SUCCESS ) &&
+           ( ( waitEventBits & SOCKET_CLOSE_CALLBACK_BIT ) == 0U ) &&
+           ( timedOut == pdFALSE ) )
+    {
+        if( pCellularSocketContext->rxModemPending != pdFALSE )
+        {
+            pCellularSocketContext->rxModemPending = pdFALSE;
+            prvRequestRxFill( pCellularSocketContext );
+        }
+
         waitEventBits = xEventGroupWaitBits( pCellularSocketContext->socketEventGroupHandle,
                                              SOCKET_DATA_RECEIVED_CALLBACK_BIT | SOCKET_CLOSE_CALLBACK_BIT,
-                                             pdTRUE,
+                                             pdFALSE,
                                              pdFALSE,
                                              recvTimeout );
 
-        if( ( waitEventBits & SOCKET_CLOSE_CALLBACK_BIT ) != 0U )
-        {
-            socketStatus = CELLULAR_SOCKET_CLOSED;
-        }
-        else if( ( waitEventBits & SOCKET_DATA_RECEIVED_CALLBACK_BIT ) != 0U )
+        if( ( waitEventBits & ( SOCKET_DATA_RECEIVED_CALLBACK_BIT | SOCKET_CLOSE_CALLBACK_BIT ) ) == 0U )
         {
-            socketStatus = Cellular_SocketRecv( CellularHandle, cellularSocketHandle, buf, len, &recvLength );
+            /* Read once on timeout in case a data ready URC was missed. */
+            LogInfo( ( "prvNetworkRecv timeout" ) );
+            prvRequestRxFill( pCellularSocketContext );
+            timedOut = pdTRUE;
         }
         else
         {
-            LogInfo( ( "prvNetworkRecv timeout" ) );
-            socketStatus = CELLULAR_SUCCESS;
-            recvLength = 0;
+            /* Clear the bit before the ring is checked again, so that data
+             * added after the check still ends the next wait. */
+            ( void ) xEventGroupClearBits( pCellularSocketContext->socketEventGroupHandle,
+                                           SOCKET_DATA_RECEIVED_CALLBACK_BIT );
+            timedOut = xTaskCheckForTimeOut( &recvTimeOut, &recvTimeout );
         }
     }
 
-    if( socketStatus == CELLULAR_SUCCESS )
+    copyLength = prvRxRingUsed( pCellularSocketContext );
+
+    if( copyLength > 0U )
     {
-        retRecvLength = ( BaseType_t ) recvLength;
+        if( copyLength > len )
+        {
+            copyLength = len;
+        }
+
+        head = pCellularSocketContext->rxHead;
+        firstLength = pCellularSocketContext->rxBufferSize - head;
+
+        if( firstLength > copyLength )
+        {
+            firstLength = copyLength;
+        }
+
+        ( void ) memcpy( buf, &pCellularSocketContext->pRxBuffer[ head ], firstLength );
+        ( void ) memcpy( &buf[ firstLength ], pCellularSocketContext->pRxBuffer, copyLength - firstLength );
+        pCellularSocketContext->rxHead = ( head + copyLength ) % pCellularSocketContext->rxBufferSize;
+        retRecvLength = ( BaseType_t ) copyLength;
+
+        /* Room has been made for the data the modem still holds. */
+        if( pCellularSocketContext->rxModemPending != pdFALSE )
+        {
+            pCellularSocketContext->rxModemPending = pdFALSE;
+            prvRequestRxFill( pCellularSocketContext );
+        }
     }
-    else if( socketStatus == CELLULAR_SOCKET_CLOSED )
+    else if( ( ( waitEventBits & SOCKET_CLOSE_CALLBACK_BIT ) != 0U ) ||
+             ( pCellularSocketContext->rxStatus == CELLULAR_SOCKET_CLOSED ) )
     {
         retRecvLength = TCP_SOCKETS_ERRNO_ECLOSED;
     }
-    else
+    else if( pCellularSocketContext->rxStatus != CELLULAR_SUCCESS )
     {
-        LogError( ( "prvNetworkRecv failed %d", socketStatus ) );
+        LogError( ( "prvNetworkRecv failed %d", pCellularSocketContext->rxStatus ) );
         retRecvLength = TCP_SOCKETS_ERRNO_ERROR;
     }
+    else
+    {
+        /* Timed out without data. */
+    }
 
-    LogDebug( ( "prvNetworkRecv expect %d read %d", len, recvLength ) );
+    LogDebug( ( "prvNetworkRecv expect %lu read %lu", ( unsigned long ) len, ( unsigned long ) copyLength ) );
     return retRecvLength;
 }
 
@@ -409,8 +739,10 @@ static void prvCellularSocketDataReadyCallback( CellularSocketHandle_t socketHan
     if( pCellularSocketContext != NULL )
     {
         LogDebug( ( "Data ready on Socket %p", pCellularSocketContext ) );
-        ( void ) xEventGroupSetBits( pCellularSocketContext->socketEventGroupHandle,
-                                     SOCKET_DATA_RECEIVED_CALLBACK_BIT );
+
+        /* This callback runs in the context that parses AT responses and
+         * cannot issue the receive command itself, so the read is queued. */
+        prvRequestRxFill( pCellularSocketContext );
     }
     else
     {
@@ -597,11 +929,310 @@ static bool _calculateElapsedTime( uint64_t entryTimeMs,
 
 /*-----------------------------------------------------------*/
 
+static uint32_t prvGetSendTimeoutMs( const cellularSocketWrapper_t * pCellularSocketContext )
+{
+    uint32_t sendTimeoutMs = 0;
+
+    /* Convert ticks to ms delay. */
+    if( ( pCellularSocketContext->sendTimeout >= UINT32_MAX_MS_TICKS ) || ( pCellularSocketContext->sendTimeout >= portMAX_DELAY ) )
+    {
+        /* Check if the ticks cause overflow. */
+        sendTimeoutMs = UINT32_MAX_DELAY_MS;
+    }
+    else
+    {
+        sendTimeoutMs = TICKS_TO_MS( pCellularSocketContext->sendTimeout );
+    }
+
+    return sendTimeoutMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendCellular( const cellularSocketWrapper_t * pCellularSocketContext,
+                                   const uint8_t * buf,
+                                   size_t len,
+                                   uint64_t entryTimeMs )
+{
+    BaseType_t retSendLength = 0;
+    uint32_t sentLength = 0;
+    CellularError_t socketStatus = CELLULAR_SUCCESS;
+    uint32_t bytesToSend = ( uint32_t ) len;
+    uint64_t elapsedTimeMs = 0;
+    uint32_t sendTimeoutMs = prvGetSendTimeoutMs( pCellularSocketContext );
+
+    /* Loop sending data until data is sent completely or timeout. The cellular
+     * library splits each call into commands of at most CELLULAR_MAX_SEND_DATA_LEN
+     * bytes and reports how much of it was accepted. */
+    while( bytesToSend > 0U )
+    {
+        socketStatus = Cellular_SocketSend( CellularHandle,
+                                            pCellularSocketContext->cellularSocketHandle,
+                                            &buf[ retSendLength ],
+                                            bytesToSend,
+                                            &sentLength );
+
+        if( socketStatus == CELLULAR_SUCCESS )
+        {
+            retSendLength = retSendLength + ( BaseType_t ) sentLength;
+            bytesToSend = bytesToSend - sentLength;
+        }
+
+        /* Check socket status or timeout break. */
+        if( ( socketStatus != CELLULAR_SUCCESS ) ||
+            ( _calculateElapsedTime( entryTimeMs, sendTimeoutMs, &elapsedTimeMs ) ) )
+        {
+            if( socketStatus == CELLULAR_SOCKET_CLOSED )
+            {
+                /* Socket already closed. No data is sent. */
+                retSendLength = 0;
+            }
+            else if( socketStatus != CELLULAR_SUCCESS )
+            {
+                retSendLength = ( BaseType_t ) TCP_SOCKETS_ERRNO_ERROR;
+            }
+
+            break;
+        }
+    }
+
+    LogDebug( ( "prvSendCellular expect %lu write %ld", ( unsigned long ) len, ( long ) retSendLength ) );
+    return retSendLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFlushTxBuffer( cellularSocketWrapper_t * pCellularSocketContext )
+{
+    BaseType_t retFlush = TCP_SOCKETS_ERRNO_NONE;
+    BaseType_t sentLength = 0;
+
+    if( pCellularSocketContext->txLength > 0U )
+    {
+        sentLength = prvSendCellular( pCellularSocketContext,
+                                      pCellularSocketContext->pTxBuffer,
+                                      pCellularSocketContext->txLength,
+                                      getTimeMs() );
+
+        /* The caller has already been told the staged data was sent, so a
+         * partial write leaves the stream in an unknown state. */
+        if( sentLength == 0 )
+        {
+            retFlush = TCP_SOCKETS_ERRNO_ECLOSED;
+        }
+        else if( sentLength != ( BaseType_t ) pCellularSocketContext->txLength )
+        {
+            LogError( ( "Failed to flush %lu staged bytes, %ld sent.",
+                        ( unsigned long ) pCellularSocketContext->txLength, ( long ) sentLength ) );
+            retFlush = TCP_SOCKETS_ERRNO_ERROR;
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+
+        pCellularSocketContext->txLength = 0;
+    }
+
+    return retFlush;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFlushStagedData( cellularSocketWrapper_t * pCellularSocketContext )
+{
+    BaseType_t retFlush = TCP_SOCKETS_ERRNO_NONE;
+
+    if( pCellularSocketContext->pTxBuffer != NULL )
+    {
+        ( void ) xSemaphoreTake( pCellularSocketContext->txMutex, portMAX_DELAY );
+
+        retFlush = pCellularSocketContext->txFlushError;
+
+        if( retFlush == TCP_SOCKETS_ERRNO_NONE )
+        {
+            retFlush = prvFlushTxBuffer( pCellularSocketContext );
+        }
+
+        ( void ) xSemaphoreGive( pCellularSocketContext->txMutex );
+    }
+
+    return retFlush;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvStageSend( cellularSocketWrapper_t * pCellularSocketContext,
+                                const uint8_t * buf,
+                                size_t len,
+                                uint64_t entryTimeMs )
+{
+    BaseType_t retSendLength = pCellularSocketContext->txFlushError;
+    BaseType_t retFlush = TCP_SOCKETS_ERRNO_NONE;
+    size_t stagedLength = pCellularSocketContext->txLength;
+
+    if( retSendLength != TCP_SOCKETS_ERRNO_NONE )
+    {
+        /* The flush timer failed to send data reported as sent. */
+    }
+    else if( len <= ( pCellularSocketContext->txBufferSize - pCellularSocketContext->txLength ) )
+    {
+        /* Coalesce with the data already staged. */
+        ( void ) memcpy( &pCellularSocketContext->pTxBuffer[ pCellularSocketContext->txLength ], buf, len );
+        pCellularSocketContext->txLength += len;
+        retSendLength = ( BaseType_t ) len;
+    }
+    else
+    {
+        /* Keep the byte order by writing out the staged data first. */
+        retSendLength = prvFlushTxBuffer( pCellularSocketContext );
+
+        if( retSendLength == TCP_SOCKETS_ERRNO_NONE )
+        {
+            if( len < pCellularSocketContext->txBufferSize )
+            {
+                ( void ) memcpy( pCellularSocketContext->pTxBuffer, buf, len );
+                pCellularSocketContext->txLength = len;
+                retSendLength = ( BaseType_t ) len;
+            }
+            else
+            {
+                retSendLength = prvSendCellular( pCellularSocketContext, buf, len, entryTimeMs );
+            }
+        }
+    }
+
+    /* A full staging buffer is a maximal modem send, so there is nothing to
+     * gain from waiting for the flush timer. */
+    if( ( retSendLength > 0 ) && ( pCellularSocketContext->txLength == pCellularSocketContext->txBufferSize ) )
+    {
+        retFlush = prvFlushTxBuffer( pCellularSocketContext );
+
+        if( retFlush != TCP_SOCKETS_ERRNO_NONE )
+        {
+            retSendLength = retFlush;
+        }
+    }
+
+    if( retSendLength == TCP_SOCKETS_ERRNO_ECLOSED )
+    {
+        /* Socket already closed. No data is sent. */
+        retSendLength = 0;
+    }
+
+    /* The timer is already running if data was staged before this call. */
+    if( ( stagedLength == 0U ) && ( pCellularSocketContext->txLength > 0U ) )
+    {
+        ( void ) xTimerReset( pCellularSocketContext->txFlushTimer, portMAX_DELAY );
+    }
+
+    return retSendLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTxFlushTimerCallback( TimerHandle_t xTimer )
+{
+    cellularSocketWrapper_t * pCellularSocketContext = ( cellularSocketWrapper_t * ) pvTimerGetTimerID( xTimer );
+    BaseType_t retFlush = TCP_SOCKETS_ERRNO_NONE;
+
+    /* Never block the timer task. If the socket user holds the buffer, it may
+     * flush the data itself, otherwise try again one period later. */
+    if( xSemaphoreTake( pCellularSocketContext->txMutex, 0 ) == pdTRUE )
+    {
+        if( pCellularSocketContext->txFlushError == TCP_SOCKETS_ERRNO_NONE )
+        {
+            retFlush = prvFlushTxBuffer( pCellularSocketContext );
+
+            if( retFlush != TCP_SOCKETS_ERRNO_NONE )
+            {
+                LogWarn( ( "Failed to send staged data from the flush timer." ) );
+                pCellularSocketContext->txFlushError = retFlush;
+            }
+        }
+
+        ( void ) xSemaphoreGive( pCellularSocketContext->txMutex );
+    }
+    else
+    {
+        ( void ) xTimerReset( xTimer, 0 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTimerTaskSynced( void * pvParameter1,
+                                uint32_t ulParameter2 )
+{
+    ( void ) ulParameter2;
+
+    ( void ) xEventGroupSetBits( ( EventGroupHandle_t ) pvParameter1, SOCKET_TIMER_TASK_SYNC_BIT );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSyncWithTimerTask( cellularSocketWrapper_t * pCellularSocketContext )
+{
+    /* The timer task runs timer callbacks and queued commands one at a time,
+     * so once this function call has run the earlier ones have completed. */
+    if( ( pCellularSocketContext->socketEventGroupHandle != NULL ) &&
+        ( xTimerPendFunctionCall( prvTimerTaskSynced,
+                                  pCellularSocketContext->socketEventGroupHandle,
+                                  0,
+                                  portMAX_DELAY ) == pdPASS ) )
+    {
+        ( void ) xEventGroupWaitBits( pCellularSocketContext->socketEventGroupHandle,
+                                      SOCKET_TIMER_TASK_SYNC_BIT,
+                                      pdTRUE,
+                                      pdFALSE,
+                                      portMAX_DELAY );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDeleteTxFlushTimer( cellularSocketWrapper_t * pCellularSocketContext )
+{
+    if( pCellularSocketContext->txFlushTimer != NULL )
+    {
+        ( void ) xTimerDelete( pCellularSocketContext->txFlushTimer, portMAX_DELAY );
+
+        /* Once the deletion has been processed the callback cannot run again. */
+        prvSyncWithTimerTask( pCellularSocketContext );
+        pCellularSocketContext->txFlushTimer = NULL;
+    }
+
+    if( pCellularSocketContext->txMutex != NULL )
+    {
+        vSemaphoreDelete( pCellularSocketContext->txMutex );
+        pCellularSocketContext->txMutex = NULL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
                                 const char * pHostName,
                                 uint16_t port,
                                 uint32_t receiveTimeoutMs,
                                 uint32_t sendTimeoutMs )
+{
+    return TCP_Sockets_ConnectWithOptions( pTcpSocket,
+                                           pHostName,
+                                           port,
+                                           receiveTimeoutMs,
+                                           sendTimeoutMs,
+                                           NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TCP_Sockets_ConnectWithOptions( Socket_t * pTcpSocket,
+                                           const char * pHostName,
+                                           uint16_t port,
+                                           uint32_t receiveTimeoutMs,
+                                           uint32_t sendTimeoutMs,
+                                           const TcpSocketsOptions_t * pOptions )
 {
     CellularSocketHandle_t cellularSocketHandle = NULL;
     cellularSocketWrapper_t * pCellularSocketContext = NULL;
@@ -610,6 +1241,29 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
     CellularSocketAddress_t serverAddress = { 0 };
     EventBits_t waitEventBits = 0;
     BaseType_t retConnect = TCP_SOCKETS_ERRNO_NONE;
+    size_t rxBufferSize = CELLULAR_SOCKET_RX_BUFFER_SIZE;
+    size_t txBufferSize = CELLULAR_SOCKET_TX_BUFFER_SIZE;
+
+    /* The buffer sizes select the size of the wrapper receive buffer and send
+     * staging buffer. The TCP window lives in the modem and is not configurable
+     * through the cellular API. */
+    if( pOptions != NULL )
+    {
+        if( pOptions->rxBufferSize != 0U )
+        {
+            rxBufferSize = pOptions->rxBufferSize;
+        }
+
+        if( pOptions->txBufferSize != 0U )
+        {
+            txBufferSize = pOptions->txBufferSize;
+        }
+
+        LogDebug( ( "TCP window and watermark options are ignored by the cellular socket wrapper." ) );
+    }
+
+    /* One byte of the ring buffer is always kept free. */
+    rxBufferSize++;
 
     /* Create a new TCP socket. */
     cellularSocketStatus = Cellular_CreateSocket( CellularHandle,
@@ -625,10 +1279,10 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
         retConnect = TCP_SOCKETS_ERRNO_ERROR;
     }
 
-    /* Allocate socket context. */
+    /* Allocate socket context, followed by its receive and send buffers. */
     if( retConnect == TCP_SOCKETS_ERRNO_NONE )
     {
-        pCellularSocketContext = pvPortMalloc( sizeof( cellularSocketWrapper_t ) );
+        pCellularSocketContext = pvPortMalloc( sizeof( cellularSocketWrapper_t ) + rxBufferSize + txBufferSize );
 
         if( pCellularSocketContext == NULL )
         {
@@ -644,6 +1298,15 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
             pCellularSocketContext->cellularSocketHandle = cellularSocketHandle;
             pCellularSocketContext->ulFlags |= CELLULAR_SOCKET_OPEN_FLAG;
             pCellularSocketContext->socketEventGroupHandle = NULL;
+            pCellularSocketContext->pRxBuffer = ( uint8_t * ) &pCellularSocketContext[ 1 ];
+            pCellularSocketContext->rxBufferSize = rxBufferSize;
+            pCellularSocketContext->rxStatus = CELLULAR_SUCCESS;
+
+            if( txBufferSize != 0U )
+            {
+                pCellularSocketContext->pTxBuffer = &pCellularSocketContext->pRxBuffer[ rxBufferSize ];
+                pCellularSocketContext->txBufferSize = txBufferSize;
+            }
         }
     }
 
@@ -659,6 +1322,23 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
         }
     }
 
+    /* Allocate the flush timer of the send staging buffer. */
+    if( ( retConnect == TCP_SOCKETS_ERRNO_NONE ) && ( pCellularSocketContext->pTxBuffer != NULL ) )
+    {
+        pCellularSocketContext->txMutex = xSemaphoreCreateMutex();
+        pCellularSocketContext->txFlushTimer = xTimerCreate( "CellTxFlush",
+                                                             CELLULAR_SOCKET_TX_FLUSH_DELAY_TICKS,
+                                                             pdFALSE,
+                                                             pCellularSocketContext,
+                                                             prvTxFlushTimerCallback );
+
+        if( ( pCellularSocketContext->txMutex == NULL ) || ( pCellularSocketContext->txFlushTimer == NULL ) )
+        {
+            LogError( ( "Failed create cellular socket send flush timer %p.", pCellularSocketContext ) );
+            retConnect = TCP_SOCKETS_ERRNO_ENOMEM;
+        }
+    }
+
     /* Register cellular socket callback function. */
     if( retConnect == TCP_SOCKETS_ERRNO_NONE )
     {
@@ -709,6 +1389,12 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
             LogError( ( "Socket connect timeout." ) );
             retConnect = TCP_SOCKETS_ERRNO_ENOTCONN;
         }
+        else
+        {
+            /* Read the modem once in case data arrived before the data ready
+             * callback could report it. */
+            prvRequestRxFill( pCellularSocketContext );
+        }
     }
 
     /* Cleanup the socket if any error. */
@@ -716,8 +1402,15 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
     {
         if( cellularSocketHandle != NULL )
         {
-            ( void ) Cellular_SocketClose( CellularHandle, cellularSocketHandle );
+            /* Reads queued by the data ready callback use the socket handle. */
             ( void ) Cellular_SocketRegisterDataReadyCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
+
+            if( pCellularSocketContext != NULL )
+            {
+                prvSyncWithTimerTask( pCellularSocketContext );
+            }
+
+            ( void ) Cellular_SocketClose( CellularHandle, cellularSocketHandle );
             ( void ) Cellular_SocketRegisterSocketOpenCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
             ( void ) Cellular_SocketRegisterClosedCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
 
@@ -727,6 +1420,11 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
             }
         }
 
+        if( pCellularSocketContext != NULL )
+        {
+            prvDeleteTxFlushTimer( pCellularSocketContext );
+        }
+
         if( ( pCellularSocketContext != NULL ) && ( pCellularSocketContext->socketEventGroupHandle != NULL ) )
         {
             vEventGroupDelete( pCellularSocketContext->socketEventGroupHandle );
@@ -772,6 +1470,17 @@ void TCP_Sockets_Disconnect( Socket_t xSocket )
     {
         if( cellularSocketHandle != NULL )
         {
+            /* Send any staged data before socket close. */
+            if( prvFlushStagedData( pCellularSocketContext ) != TCP_SOCKETS_ERRNO_NONE )
+            {
+                LogWarn( ( "Failed to send staged data before close." ) );
+            }
+
+            /* Stop queuing reads and wait for those already queued, as they use
+             * the socket handle. */
+            ( void ) Cellular_SocketRegisterDataReadyCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
+            prvSyncWithTimerTask( pCellularSocketContext );
+
             /* Receive all the data before socket close. */
             do
             {
@@ -787,12 +1496,13 @@ void TCP_Sockets_Disconnect( Socket_t xSocket )
                 retClose = TCP_SOCKETS_ERRNO_ERROR;
             }
 
-            ( void ) Cellular_SocketRegisterDataReadyCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
             ( void ) Cellular_SocketRegisterSocketOpenCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
             ( void ) Cellular_SocketRegisterClosedCallback( CellularHandle, cellularSocketHandle, NULL, NULL );
             pCellularSocketContext->cellularSocketHandle = NULL;
         }
 
+        prvDeleteTxFlushTimer( pCellularSocketContext );
+
         if( pCellularSocketContext->socketEventGroupHandle != NULL )
         {
             vEventGroupDelete( pCellularSocketContext->socketEventGroupHandle );
@@ -829,7 +1539,27 @@ int32_t TCP_Sockets_Recv( Socket_t xSocket,
     }
     else
     {
-        retRecvLength = ( BaseType_t ) prvNetworkRecvCellular( pCellularSocketContext, buf, xBufferLength );
+        /* Staged sends are usually a request the caller now waits a response
+         * to, so write them out before blocking for longer than the flush timer
+         * would hold them. A poll leaves them to the timer. */
+        if( ( prvRxRingUsed( pCellularSocketContext ) == 0U ) &&
+            ( pCellularSocketContext->receiveTimeout > CELLULAR_SOCKET_TX_FLUSH_DELAY_TICKS ) )
+        {
+            retRecvLength = prvFlushStagedData( pCellularSocketContext );
+        }
+        else if( pCellularSocketContext->pTxBuffer != NULL )
+        {
+            retRecvLength = pCellularSocketContext->txFlushError;
+        }
+        else
+        {
+            /* Empty else for MISRA 15.7 compliance. */
+        }
+
+        if( retRecvLength == TCP_SOCKETS_ERRNO_NONE )
+        {
+            retRecvLength = ( BaseType_t ) prvNetworkRecvCellular( pCellularSocketContext, buf, xBufferLength );
+        }
     }
 
     return retRecvLength;
@@ -840,21 +1570,21 @@ int32_t TCP_Sockets_Recv( Socket_t xSocket,
 /* This function sends the data until timeout or data is completely sent to server.
  * Send timeout unit is TickType_t. Any timeout value greater than UINT32_MAX_MS_TICKS
  * or portMAX_DELAY will be regarded as MAX delay. In this case, this function
- * will not return until all bytes of data are sent successfully or until an error occurs. */
+ * will not return until all bytes of data are sent successfully or until an error occurs.
+ *
+ * When the socket has a send staging buffer, data that fits in it is copied there
+ * and reported as sent. The staged data is written to the modem in one go when the
+ * buffer is full, when the next send does not fit, before a receive that blocks,
+ * on disconnect, or by a timer CELLULAR_SOCKET_TX_FLUSH_DELAY_MS after it was
+ * first staged. */
 int32_t TCP_Sockets_Send( Socket_t xSocket,
                           const void * pvBuffer,
                           size_t xDataLength )
 {
-    uint8_t * buf = ( uint8_t * ) pvBuffer;
-    CellularSocketHandle_t cellularSocketHandle = NULL;
+    const uint8_t * buf = ( const uint8_t * ) pvBuffer;
     BaseType_t retSendLength = 0;
-    uint32_t sentLength = 0;
-    CellularError_t socketStatus = CELLULAR_SUCCESS;
     cellularSocketWrapper_t * pCellularSocketContext = ( cellularSocketWrapper_t * ) xSocket;
-    uint32_t bytesToSend = xDataLength;
     uint64_t entryTimeMs = getTimeMs();
-    uint64_t elapsedTimeMs = 0;
-    uint32_t sendTimeoutMs = 0;
 
     if( pCellularSocketContext == NULL )
     {
@@ -868,55 +1598,15 @@ int32_t TCP_Sockets_Send( Socket_t xSocket,
                     pCellularSocketContext, pCellularSocketContext->ulFlags ) );
         retSendLength = ( BaseType_t ) TCP_SOCKETS_ERRNO_ERROR;
     }
+    else if( pCellularSocketContext->pTxBuffer == NULL )
+    {
+        retSendLength = prvSendCellular( pCellularSocketContext, buf, xDataLength, entryTimeMs );
+    }
     else
     {
-        cellularSocketHandle = pCellularSocketContext->cellularSocketHandle;
-
-        /* Convert ticks to ms delay. */
-        if( ( pCellularSocketContext->sendTimeout >= UINT32_MAX_MS_TICKS ) || ( pCellularSocketContext->sendTimeout >= portMAX_DELAY ) )
-        {
-            /* Check if the ticks cause overflow. */
-            sendTimeoutMs = UINT32_MAX_DELAY_MS;
-        }
-        else
-        {
-            sendTimeoutMs = TICKS_TO_MS( pCellularSocketContext->sendTimeout );
-        }
-
-        /* Loop sending data until data is sent completely or timeout. */
-        while( bytesToSend > 0U )
-        {
-            socketStatus = Cellular_SocketSend( CellularHandle,
-                                                cellularSocketHandle,
-                                                &buf[ retSendLength ],
-                                                bytesToSend,
-                                                &sentLength );
-
-            if( socketStatus == CELLULAR_SUCCESS )
-            {
-                retSendLength = retSendLength + ( BaseType_t ) sentLength;
-                bytesToSend = bytesToSend - sentLength;
-            }
-
-            /* Check socket status or timeout break. */
-            if( ( socketStatus != CELLULAR_SUCCESS ) ||
-                ( _calculateElapsedTime( entryTimeMs, sendTimeoutMs, &elapsedTimeMs ) ) )
-            {
-                if( socketStatus == CELLULAR_SOCKET_CLOSED )
-                {
-                    /* Socket already closed. No data is sent. */
-                    retSendLength = 0;
-                }
-                else if( socketStatus != CELLULAR_SUCCESS )
-                {
-                    retSendLength = ( BaseType_t ) TCP_SOCKETS_ERRNO_ERROR;
-                }
-
-                break;
-            }
-        }
-
-        LogDebug( ( "TCP_Sockets_Send expect %d write %d", xDataLength, sentLength ) );
+        ( void ) xSemaphoreTake( pCellularSocketContext->txMutex, portMAX_DELAY );
+        retSendLength = prvStageSend( pCellularSocketContext, buf, xDataLength, entryTimeMs );
+        ( void ) xSemaphoreGive( pCellularSocketContext->txMutex );
     }
 
     return retSendLength;
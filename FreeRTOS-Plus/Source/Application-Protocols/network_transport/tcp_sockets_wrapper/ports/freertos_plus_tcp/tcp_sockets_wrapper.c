@@ -73,6 +73,97 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define FREERTOS_SOCKETS_WRAPPER_NETWORK_ERROR    ( -1 )
 
+/**
+ * @brief Apply the stream buffer, window and watermark options to a socket
+ * that has not been connected yet.
+ *
+ * @param[in] tcpSocket The socket to configure.
+ * @param[in] pOptions The options to apply.
+ *
+ * @return 0 on success, or the negative value returned by FreeRTOS_setsockopt().
+ */
+static BaseType_t prvSetSocketOptions( Socket_t tcpSocket,
+                                       const TcpSocketsOptions_t * pOptions );
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSetSocketOptions( Socket_t tcpSocket,
+                                       const TcpSocketsOptions_t * pOptions )
+{
+    BaseType_t socketStatus = 0;
+    WinProperties_t winProperties = { 0 };
+    LowHighWater_t lowHighWater = { 0 };
+
+    configASSERT( pOptions != NULL );
+
+    if( ( pOptions->rxBufferSize != 0U ) || ( pOptions->txBufferSize != 0U ) ||
+        ( pOptions->rxWindowSize != 0U ) || ( pOptions->txWindowSize != 0U ) )
+    {
+        /* FREERTOS_SO_WIN_PROPERTIES sets all four values at once, so fill in
+         * the stack defaults for the ones the caller left as 0. The default
+         * window is half of the stream buffer, as chosen by FreeRTOS_socket(). */
+        winProperties.lRxBufSize = ( pOptions->rxBufferSize != 0U ) ?
+                                   ( int32_t ) pOptions->rxBufferSize : ( int32_t ) ipconfigTCP_RX_BUFFER_LENGTH;
+        winProperties.lTxBufSize = ( pOptions->txBufferSize != 0U ) ?
+                                   ( int32_t ) pOptions->txBufferSize : ( int32_t ) ipconfigTCP_TX_BUFFER_LENGTH;
+        winProperties.lRxWinSize = ( pOptions->rxWindowSize != 0U ) ?
+                                   ( int32_t ) pOptions->rxWindowSize : ( winProperties.lRxBufSize / 2 ) / ( int32_t ) ipconfigTCP_MSS;
+        winProperties.lTxWinSize = ( pOptions->txWindowSize != 0U ) ?
+                                   ( int32_t ) pOptions->txWindowSize : ( winProperties.lTxBufSize / 2 ) / ( int32_t ) ipconfigTCP_MSS;
+
+        if( winProperties.lRxWinSize < 1 )
+        {
+            winProperties.lRxWinSize = 1;
+        }
+
+        if( winProperties.lTxWinSize < 1 )
+        {
+            winProperties.lTxWinSize = 1;
+        }
+
+        socketStatus = FreeRTOS_setsockopt( tcpSocket,
+                                            0,
+                                            FREERTOS_SO_WIN_PROPERTIES,
+                                            &winProperties,
+                                            sizeof( winProperties ) );
+
+        if( socketStatus != 0 )
+        {
+            LogError( ( "Failed to set window properties: ReturnCode=%d, "
+                        "RxBuf=%d, TxBuf=%d, RxWin=%d, TxWin=%d.",
+                        socketStatus,
+                        ( int ) winProperties.lRxBufSize,
+                        ( int ) winProperties.lTxBufSize,
+                        ( int ) winProperties.lRxWinSize,
+                        ( int ) winProperties.lTxWinSize ) );
+        }
+    }
+
+    if( ( socketStatus == 0 ) && ( pOptions->highWaterMark != 0U ) )
+    {
+        lowHighWater.uxLittleSpace = pOptions->lowWaterMark;
+        lowHighWater.uxEnoughSpace = pOptions->highWaterMark;
+
+        socketStatus = FreeRTOS_setsockopt( tcpSocket,
+                                            0,
+                                            FREERTOS_SO_SET_LOW_HIGH_WATER,
+                                            &lowHighWater,
+                                            sizeof( lowHighWater ) );
+
+        if( socketStatus != 0 )
+        {
+            LogError( ( "Failed to set low/high water marks: ReturnCode=%d, Low=%u, High=%u.",
+                        socketStatus,
+                        ( unsigned ) pOptions->lowWaterMark,
+                        ( unsigned ) pOptions->highWaterMark ) );
+        }
+    }
+
+    return socketStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Establish a connection to server.
  *
@@ -91,6 +182,38 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
                                 uint16_t port,
                                 uint32_t receiveTimeoutMs,
                                 uint32_t sendTimeoutMs )
+{
+    return TCP_Sockets_ConnectWithOptions( pTcpSocket,
+                                           pHostName,
+                                           port,
+                                           receiveTimeoutMs,
+                                           sendTimeoutMs,
+                                           NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Establish a connection to server, applying socket buffer and window
+ * options before connecting.
+ *
+ * @param[out] pTcpSocket The output parameter to return the created socket descriptor.
+ * @param[in] pHostName Server hostname to connect to.
+ * @param[in] port Server port to connect to.
+ * @param[in] receiveTimeoutMs Timeout (in milliseconds) for transport receive.
+ * @param[in] sendTimeoutMs Timeout (in milliseconds) for transport send.
+ * @param[in] pOptions Socket options to apply, or NULL to use the stack defaults.
+ *
+ * @note A timeout of 0 means infinite timeout.
+ *
+ * @return Non-zero value on error, 0 on success.
+ */
+BaseType_t TCP_Sockets_ConnectWithOptions( Socket_t * pTcpSocket,
+                                           const char * pHostName,
+                                           uint16_t port,
+                                           uint32_t receiveTimeoutMs,
+                                           uint32_t sendTimeoutMs,
+                                           const TcpSocketsOptions_t * pOptions )
 {
     Socket_t tcpSocket = FREERTOS_INVALID_SOCKET;
     BaseType_t socketStatus = 0;
@@ -136,6 +259,12 @@ BaseType_t TCP_Sockets_Connect( Socket_t * pTcpSocket,
         }
     }
 
+    /* Stream buffers are created on connect, so size them first. */
+    if( ( socketStatus == 0 ) && ( pOptions != NULL ) )
+    {
+        socketStatus = prvSetSocketOptions( tcpSocket, pOptions );
+    }
+
     if( socketStatus == 0 )
     {
         /* Establish connection. */
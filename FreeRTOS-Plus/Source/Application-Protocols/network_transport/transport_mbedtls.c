@@ -203,6 +203,22 @@ static void setOptionalConfigurations( SSLContext_t * pSslContext,
                                        const char * pHostName,
                                        const NetworkCredentials_t * pNetworkCredentials );
 
+/**
+ * @brief Convert a maximum fragment length in bytes to the code used by the
+ * max_fragment_length extension.
+ *
+ * @param[in] maxFragmentLength Fragment length in bytes, or 0 to not request
+ * the extension.
+ * @param[out] pMflCode The MBEDTLS_SSL_MAX_FRAG_LEN_* code, or
+ * MBEDTLS_SSL_MAX_FRAG_LEN_NONE to not request the extension.
+ *
+ * @return 0 on success; -1 if the length is not one the extension can express.
+ */
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    static int32_t getMaxFragmentLengthCode( uint16_t maxFragmentLength,
+                                             unsigned char * pMflCode );
+#endif
+
 /**
  * @brief Setup TLS by initializing contexts and setting configurations.
  *
@@ -432,12 +448,57 @@ static int32_t setCredentials( SSLContext_t * pSslContext,
 }
 /*-----------------------------------------------------------*/
 
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    static int32_t getMaxFragmentLengthCode( uint16_t maxFragmentLength,
+                                             unsigned char * pMflCode )
+    {
+        int32_t returnStatus = 0;
+
+        configASSERT( pMflCode != NULL );
+
+        switch( maxFragmentLength )
+        {
+            case 512U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+                break;
+
+            case 1024U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+                break;
+
+            case 2048U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+                break;
+
+            case 4096U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+                break;
+
+            case 0U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+                break;
+
+            default:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+                returnStatus = -1;
+                break;
+        }
+
+        return returnStatus;
+    }
+#endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+/*-----------------------------------------------------------*/
+
 static void setOptionalConfigurations( SSLContext_t * pSslContext,
                                        const char * pHostName,
                                        const NetworkCredentials_t * pNetworkCredentials )
 {
     int32_t mbedtlsError = -1;
 
+    #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+        unsigned char mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+    #endif
+
     configASSERT( pSslContext != NULL );
     configASSERT( pHostName != NULL );
     configASSERT( pNetworkCredentials != NULL );
@@ -474,18 +535,27 @@ static void setOptionalConfigurations( SSLContext_t * pSslContext,
     /* Set Maximum Fragment Length if enabled. */
     #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
-        /* Enable the max fragment extension. 4096 bytes is currently the largest fragment size permitted.
-         * See RFC 8449 https://tools.ietf.org/html/rfc8449 for more information.
-         *
-         * Smaller values can be found in "mbedtls/include/ssl.h".
+        /* Request the max fragment extension only for connections whose
+         * credentials ask for it, so servers that reject the extension can still
+         * be reached. 4096 bytes is the largest fragment size the extension can
+         * express. See RFC 6066 https://tools.ietf.org/html/rfc6066 for more information.
          */
-        mbedtlsError = mbedtls_ssl_conf_max_frag_len( &( pSslContext->config ), MBEDTLS_SSL_MAX_FRAG_LEN_4096 );
+        if( getMaxFragmentLengthCode( pNetworkCredentials->maxFragmentLength, &mflCode ) != 0 )
+        {
+            LogWarn( ( "Unsupported maximum fragment length %u, not requesting the extension.",
+                       ( unsigned ) pNetworkCredentials->maxFragmentLength ) );
+        }
 
-        if( mbedtlsError != 0 )
+        if( mflCode != MBEDTLS_SSL_MAX_FRAG_LEN_NONE )
         {
-            LogError( ( "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
-                        mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
-                        mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+            mbedtlsError = mbedtls_ssl_conf_max_frag_len( &( pSslContext->config ), mflCode );
+
+            if( mbedtlsError != 0 )
+            {
+                LogError( ( "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
+                            mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                            mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+            }
         }
     #endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
 }
@@ -588,6 +658,21 @@ static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
                              xMbedTLSBioTCPSocketsWrapperSend,
                              xMbedTLSBioTCPSocketsWrapperRecv,
                              NULL );
+
+        if( pNetworkCredentials->pResumeSession != NULL )
+        {
+            /* Offer the saved session. A failure here is not fatal as the
+             * handshake falls back to a full handshake. */
+            mbedtlsError = mbedtls_ssl_set_session( &( pTlsTransportParams->sslContext.context ),
+                                                    pNetworkCredentials->pResumeSession );
+
+            if( mbedtlsError != 0 )
+            {
+                LogWarn( ( "Failed to set the session to resume: mbedTLSError= %s : %s.",
+                           mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                           mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+            }
+        }
     }
 
     if( returnStatus == TLS_TRANSPORT_SUCCESS )
@@ -611,6 +696,11 @@ static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pNetworkContext,
         {
             LogInfo( ( "(Network connection %p) TLS handshake successful.",
                        pNetworkContext ) );
+
+            LogDebug( ( "(Network connection %p) Maximum record payload: in=%d, out=%d.",
+                        pNetworkContext,
+                        mbedtls_ssl_get_max_in_record_payload( &( pTlsTransportParams->sslContext.context ) ),
+                        mbedtls_ssl_get_max_out_record_payload( &( pTlsTransportParams->sslContext.context ) ) ) );
         }
     }
 
@@ -723,11 +813,12 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
         /* Initialize tcpSocket. */
         pTlsTransportParams->tcpSocket = NULL;
 
-        socketStatus = TCP_Sockets_Connect( &( pTlsTransportParams->tcpSocket ),
-                                            pHostName,
-                                            port,
-                                            receiveTimeoutMs,
-                                            sendTimeoutMs );
+        socketStatus = TCP_Sockets_ConnectWithOptions( &( pTlsTransportParams->tcpSocket ),
+                                                       pHostName,
+                                                       port,
+                                                       receiveTimeoutMs,
+                                                       sendTimeoutMs,
+                                                       pTlsTransportParams->pTcpSocketsOptions );
 
         if( socketStatus != 0 )
         {
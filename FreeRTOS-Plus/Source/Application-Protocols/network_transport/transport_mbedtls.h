@@ -116,6 +116,12 @@ typedef struct TlsTransportParams
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+
+    /**
+     * @brief Optional socket buffer and window settings applied on connect.
+     * Leave NULL to use the defaults of the TCP/IP stack.
+     */
+    const TcpSocketsOptions_t * pTcpSocketsOptions;
 } TlsTransportParams_t;
 
 /**
@@ -144,6 +150,36 @@ typedef struct NetworkCredentials
     size_t clientCertSize;       /**< @brief Size associated with #NetworkCredentials.pClientCert. */
     const uint8_t * pPrivateKey; /**< @brief String representing the client certificate's private key. */
     size_t privateKeySize;       /**< @brief Size associated with #NetworkCredentials.pPrivateKey. */
+
+    /**
+     * @brief Largest record plaintext, in bytes, this connection needs to
+     * receive. One of 512, 1024, 2048 or 4096, or 0 to not request a limit.
+     *
+     * The value is requested from the server with the max_fragment_length
+     * extension (RFC 6066), which requires MBEDTLS_SSL_MAX_FRAGMENT_LENGTH.
+     * When MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH is also enabled, mbedTLS shrinks
+     * the connection's record buffers to the negotiated size once the handshake
+     * completes, so small values cut the per-connection heap cost. Both options
+     * are off in the shared mbedtls_config_v3.5.1.h; a demo that sets this
+     * field enables them in its own mbedTLS configuration, for example through
+     * MBEDTLS_USER_CONFIG_FILE. The field is ignored when they are off.
+     *
+     * @note TLS 1.3 peers use the record_size_limit extension (RFC 8449)
+     * instead. mbedTLS advertises it from MBEDTLS_SSL_IN_CONTENT_LEN when
+     * MBEDTLS_SSL_RECORD_SIZE_LIMIT is enabled, which is a build wide setting.
+     */
+    uint16_t maxFragmentLength;
+
+    /**
+     * @brief Session to offer to the server for resumption, or NULL to always
+     * perform a full handshake.
+     *
+     * Save the session of an earlier connection with mbedtls_ssl_get_session()
+     * before disconnecting it. If the server declines the session, a full
+     * handshake is performed. Resuming a TLS 1.3 session requires
+     * MBEDTLS_SSL_SESSION_TICKETS.
+     */
+    const mbedtls_ssl_session * pResumeSession;
 } NetworkCredentials_t;
 
 /**
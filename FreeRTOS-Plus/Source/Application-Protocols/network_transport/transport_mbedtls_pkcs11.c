@@ -156,6 +156,22 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Convert a maximum fragment length in bytes to the code used by the
+ * max_fragment_length extension.
+ *
+ * @param[in] maxFragmentLength Fragment length in bytes, or 0 to not request
+ * the extension.
+ * @param[out] pMflCode The MBEDTLS_SSL_MAX_FRAG_LEN_* code, or
+ * MBEDTLS_SSL_MAX_FRAG_LEN_NONE to not request the extension.
+ *
+ * @return 0 on success; -1 if the length is not one the extension can express.
+ */
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    static int32_t getMaxFragmentLengthCode( uint16_t maxFragmentLength,
+                                             unsigned char * pMflCode );
+#endif
+
 /**
  * @brief Callback that wraps PKCS#11 for pseudo-random number generation.
  *
@@ -278,6 +294,47 @@ static void sslContextFree( SSLContext_t * pSslContext )
 
 /*-----------------------------------------------------------*/
 
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    static int32_t getMaxFragmentLengthCode( uint16_t maxFragmentLength,
+                                             unsigned char * pMflCode )
+    {
+        int32_t returnStatus = 0;
+
+        configASSERT( pMflCode != NULL );
+
+        switch( maxFragmentLength )
+        {
+            case 512U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+                break;
+
+            case 1024U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+                break;
+
+            case 2048U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+                break;
+
+            case 4096U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+                break;
+
+            case 0U:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+                break;
+
+            default:
+                *pMflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+                returnStatus = -1;
+                break;
+        }
+
+        return returnStatus;
+    }
+#endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+/*-----------------------------------------------------------*/
+
 static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
                                       const char * pHostName,
                                       const NetworkCredentials_t * pNetworkCredentials )
@@ -287,6 +344,10 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
     int32_t mbedtlsError = 0;
     CK_RV xResult = CKR_OK;
 
+    #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+        unsigned char mflCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+    #endif
+
     configASSERT( pNetworkContext != NULL );
     configASSERT( pNetworkContext->pParams != NULL );
     configASSERT( pHostName != NULL );
@@ -479,19 +540,28 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
     #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
         if( returnStatus == TLS_TRANSPORT_SUCCESS )
         {
-            /* Enable the max fragment extension. 4096 bytes is currently the largest fragment size permitted.
-             * See RFC 8449 https://tools.ietf.org/html/rfc8449 for more information.
-             *
-             * Smaller values can be found in "mbedtls/include/ssl.h".
+            /* Request the max fragment extension only for connections whose
+             * credentials ask for it, so servers that reject the extension can still
+             * be reached. 4096 bytes is the largest fragment size the extension can
+             * express. See RFC 6066 https://tools.ietf.org/html/rfc6066 for more information.
              */
-            mbedtlsError = mbedtls_ssl_conf_max_frag_len( &( pTlsTransportParams->sslContext.config ), MBEDTLS_SSL_MAX_FRAG_LEN_4096 );
+            if( getMaxFragmentLengthCode( pNetworkCredentials->maxFragmentLength, &mflCode ) != 0 )
+            {
+                LogWarn( ( "Unsupported maximum fragment length %u, not requesting the extension.",
+                           ( unsigned ) pNetworkCredentials->maxFragmentLength ) );
+            }
 
-            if( mbedtlsError != 0 )
+            if( mflCode != MBEDTLS_SSL_MAX_FRAG_LEN_NONE )
             {
-                LogError( ( "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
-                            mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
-                            mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
-                returnStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                mbedtlsError = mbedtls_ssl_conf_max_frag_len( &( pTlsTransportParams->sslContext.config ), mflCode );
+
+                if( mbedtlsError != 0 )
+                {
+                    LogError( ( "Failed to maximum fragment length extension: mbedTLSError= %s : %s.",
+                                mbedtlsHighLevelCodeOrDefault( mbedtlsError ),
+                                mbedtlsLowLevelCodeOrDefault( mbedtlsError ) ) );
+                    returnStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                }
             }
         }
     #endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
@@ -531,6 +601,11 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetworkContext,
     {
         LogInfo( ( "(Network connection %p) TLS handshake successful.",
                    pNetworkContext ) );
+
+        LogDebug( ( "(Network connection %p) Maximum record payload: in=%d, out=%d.",
+                    pNetworkContext,
+                    mbedtls_ssl_get_max_in_record_payload( &( pTlsTransportParams->sslContext.context ) ),
+                    mbedtls_ssl_get_max_out_record_payload( &( pTlsTransportParams->sslContext.context ) ) ) );
     }
 
     return returnStatus;
@@ -756,11 +831,12 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
         /* Initialize tcpSocket. */
         pTlsTransportParams->tcpSocket = NULL;
 
-        socketStatus = TCP_Sockets_Connect( &( pTlsTransportParams->tcpSocket ),
-                                            pHostName,
-                                            port,
-                                            receiveTimeoutMs,
-                                            sendTimeoutMs );
+        socketStatus = TCP_Sockets_ConnectWithOptions( &( pTlsTransportParams->tcpSocket ),
+                                                       pHostName,
+                                                       port,
+                                                       receiveTimeoutMs,
+                                                       sendTimeoutMs,
+                                                       pTlsTransportParams->pTcpSocketsOptions );
 
         if( socketStatus != 0 )
         {
@@ -93,6 +93,12 @@ typedef struct TlsTransportParams
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+
+    /**
+     * @brief Optional socket buffer and window settings applied on connect.
+     * Leave NULL to use the defaults of the TCP/IP stack.
+     */
+    const TcpSocketsOptions_t * pTcpSocketsOptions;
 } TlsTransportParams_t;
 
 /**
@@ -123,6 +129,25 @@ typedef struct NetworkCredentials
     size_t passwordSize;             /**< @brief Size associated with #NetworkCredentials.pPassword. */
     const char * pClientCertLabel;   /**< @brief PKCS #11 label string of the client certificate. */
     const char * pPrivateKeyLabel;   /**< @brief PKCS #11 label for the private key. */
+
+    /**
+     * @brief Largest record plaintext, in bytes, this connection needs to
+     * receive. One of 512, 1024, 2048 or 4096, or 0 to not request a limit.
+     *
+     * The value is requested from the server with the max_fragment_length
+     * extension (RFC 6066), which requires MBEDTLS_SSL_MAX_FRAGMENT_LENGTH.
+     * When MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH is also enabled, mbedTLS shrinks
+     * the connection's record buffers to the negotiated size once the handshake
+     * completes, so small values cut the per-connection heap cost. Both options
+     * are off in the shared mbedtls_config_v3.5.1.h; a demo that sets this
+     * field enables them in its own mbedTLS configuration, for example through
+     * MBEDTLS_USER_CONFIG_FILE. The field is ignored when they are off.
+     *
+     * @note TLS 1.3 peers use the record_size_limit extension (RFC 8449)
+     * instead. mbedTLS advertises it from MBEDTLS_SSL_IN_CONTENT_LEN when
+     * MBEDTLS_SSL_RECORD_SIZE_LIMIT is enabled, which is a build wide setting.
+     */
+    uint16_t maxFragmentLength;
 } NetworkCredentials_t;
 
 /**
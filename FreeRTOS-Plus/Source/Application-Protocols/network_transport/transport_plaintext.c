@@ -76,11 +76,12 @@ PlaintextTransportStatus_t Plaintext_FreeRTOS_Connect( NetworkContext_t * pNetwo
         pPlaintextTransportParams->tcpSocket = NULL;
 
         /* Establish a TCP connection with the server. */
-        socketStatus = TCP_Sockets_Connect( &( pPlaintextTransportParams->tcpSocket ),
-                                            pHostName,
-                                            port,
-                                            receiveTimeoutMs,
-                                            sendTimeoutMs );
+        socketStatus = TCP_Sockets_ConnectWithOptions( &( pPlaintextTransportParams->tcpSocket ),
+                                                       pHostName,
+                                                       port,
+                                                       receiveTimeoutMs,
+                                                       sendTimeoutMs,
+                                                       pPlaintextTransportParams->pTcpSocketsOptions );
 
         /* A non zero status is an error. */
         if( socketStatus != 0 )
@@ -77,6 +77,12 @@ extern void vLoggingPrintf( const char * pcFormatString,
 typedef struct PlaintextTransportParams
 {
     Socket_t tcpSocket;
+
+    /**
+     * @brief Optional socket buffer and window settings applied on connect.
+     * Leave NULL to use the defaults of the TCP/IP stack.
+     */
+    const TcpSocketsOptions_t * pTcpSocketsOptions;
 } PlaintextTransportParams_t;
 
 /**
@@ -321,6 +321,15 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pNetCtx,
                 wolfSSL_SetIOReadCtx( pNetCtx->sslContext.ssl, xSocket );
                 wolfSSL_SetIOWriteCtx( pNetCtx->sslContext.ssl, xSocket );
 
+                /* offer a saved session, falling back to a full handshake if
+                 * it can not be used */
+                if( ( pNetCred->pResumeSession != NULL ) &&
+                    ( wolfSSL_set_session( pNetCtx->sslContext.ssl,
+                                           pNetCred->pResumeSession ) != SSL_SUCCESS ) )
+                {
+                    LogWarn( ( "Failed to set the session to resume" ) );
+                }
+
                 /* let wolfSSL perform tls handshake */
                 if( wolfSSL_connect( pNetCtx->sslContext.ssl )
                     == SSL_SUCCESS )
@@ -404,11 +413,12 @@ TlsTransportStatus_t TLS_FreeRTOS_Connect( NetworkContext_t * pNetworkContext,
     {
         pNetworkContext->tcpSocket = NULL;
 
-        socketStatus = TCP_Sockets_Connect( &( pNetworkContext->tcpSocket ),
-                                            pHostName,
-                                            port,
-                                            receiveTimeoutMs,
-                                            sendTimeoutMs );
+        socketStatus = TCP_Sockets_ConnectWithOptions( &( pNetworkContext->tcpSocket ),
+                                                       pHostName,
+                                                       port,
+                                                       receiveTimeoutMs,
+                                                       sendTimeoutMs,
+                                                       pNetworkContext->pTcpSocketsOptions );
 
         if( socketStatus != 0 )
         {
@@ -60,6 +60,9 @@
 /* FreeRTOS+TCP include. */
 #include "FreeRTOS_Sockets.h"
 
+/* TCP Sockets Wrapper include.*/
+#include "tcp_sockets_wrapper.h"
+
 /* Transport interface include. */
 #include "transport_interface.h"
 
@@ -83,6 +86,12 @@ struct NetworkContext
 {
     Socket_t tcpSocket;
     SSLContext_t sslContext;
+
+    /**
+     * @brief Optional socket buffer and window settings applied on connect.
+     * Leave NULL to use the defaults of the TCP/IP stack.
+     */
+    const TcpSocketsOptions_t * pTcpSocketsOptions;
 };
 
 /**
@@ -116,6 +125,16 @@ typedef struct NetworkCredentials
     size_t userNameSize;               /**< @brief Size associated with #IotNetworkCredentials.pUserName. */
     const unsigned char * pPassword;   /**< @brief String representing the password for MQTT. */
     size_t passwordSize;               /**< @brief Size associated with #IotNetworkCredentials.pPassword. */
+
+    /**
+     * @brief Session to offer to the server for resumption, or NULL to always
+     * perform a full handshake.
+     *
+     * Save the session of an earlier connection with wolfSSL_get1_session()
+     * before disconnecting it. If the server declines the session, a full
+     * handshake is performed.
+     */
+    WOLFSSL_SESSION * pResumeSession;
 } NetworkCredentials_t;
 
 /**
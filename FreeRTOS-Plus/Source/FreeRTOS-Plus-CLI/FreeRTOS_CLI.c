@@ -45,6 +45,12 @@
     #define configAPPLICATION_PROVIDES_cOutputBuffer    0
 #endif
 
+/* The number of entries in the hash table that is used to find a command.
+ * Commands are hashed on their first word. */
+#ifndef configCOMMAND_INT_HASH_TABLE_SIZE
+    #define configCOMMAND_INT_HASH_TABLE_SIZE    16
+#endif
+
 /*
  * Register the command passed in using the pxCommandToRegister parameter
  * and using pxCliDefinitionListItemBuffer as the memory for command line
@@ -59,8 +65,7 @@ static void prvRegisterCommand( const CLI_Command_Definition_t * const pxCommand
  * The callback function that is executed when "help" is entered.  This is the
  * only default command that is always present.
  */
-static BaseType_t prvHelpCommand( char * pcWriteBuffer,
-                                  size_t xWriteBufferLen,
+static BaseType_t prvHelpCommand( CLI_Session_t * pxSession,
                                   const char * pcCommandString );
 
 /*
@@ -68,14 +73,44 @@ static BaseType_t prvHelpCommand( char * pcWriteBuffer,
  */
 static int8_t prvGetNumberOfParameters( const char * pcCommandString );
 
+/*
+ * Return the hash table entry for the first word of pcCommandString.
+ */
+static UBaseType_t prvHashFirstWord( const char * pcCommandString );
+
+/*
+ * Add a list item to the end of its entry in the hash table.  Must be called
+ * from within a critical section.
+ */
+static void prvAddToHashTable( CLI_Definition_List_Item_t * pxListItem );
+
+/*
+ * Return pdTRUE if pcCommandInput starts with the name of pxCommand, followed
+ * by a space or the end of the string.
+ */
+static BaseType_t prvMatchCommand( const CLI_Definition_List_Item_t * pxCommand,
+                                   const char * pcCommandInput );
+
+/*
+ * Return the registered command that matches pcCommandInput, or NULL.
+ */
+static const CLI_Definition_List_Item_t * prvFindCommand( const char * pcCommandInput );
+
+/*
+ * Pass the contents of the write buffer to the output function of the session
+ * and empty the buffer.
+ */
+static void prvFlushOutput( CLI_Session_t * pxSession );
+
 /* The definition of the "help" command.  This command is always at the front
  * of the list of registered commands. */
 static const CLI_Command_Definition_t xHelpCommand =
 {
     "help",
     "\r\nhelp:\r\n Lists all the registered commands\r\n\r\n",
-    prvHelpCommand,
-    0
+    NULL,
+    0,
+    prvHelpCommand
 };
 
 /* The definition of the list of commands.  Commands that are registered are
@@ -83,9 +118,19 @@ static const CLI_Command_Definition_t xHelpCommand =
 static CLI_Definition_List_Item_t xRegisteredCommands =
 {
     &xHelpCommand, /* The first command in the list is always the help command, defined in this file. */
-    NULL           /* The next pointer is initialised to NULL, as there are no other registered commands yet. */
+    NULL,          /* The next pointer is initialised to NULL, as there are no other registered commands yet. */
+    NULL
 };
 
+/* The registered commands, hashed on their first word.  The list above still
+ * holds them in the order of registration, for the help command.  The help
+ * command itself is added to the table when the first command is registered. */
+static CLI_Definition_List_Item_t * pxCommandHashTable[ configCOMMAND_INT_HASH_TABLE_SIZE ];
+static volatile BaseType_t xHelpCommandHashed = pdFALSE;
+
+/* The session used by FreeRTOS_CLIProcessCommand(). */
+static CLI_Session_t xDefaultSession;
+
 /* A buffer into which command outputs can be written is declared here, rather
 * than in the command console implementation, to allow multiple command consoles
 * to share the same buffer.  For example, an application may allow access to the
@@ -154,66 +199,96 @@ BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput,
                                        char * pcWriteBuffer,
                                        size_t xWriteBufferLen )
 {
-    static const CLI_Definition_List_Item_t * pxCommand = NULL;
-    BaseType_t xReturn = pdTRUE;
-    const char * pcRegisteredCommandString;
-    size_t xCommandStringLength;
-
     /* Note:  This function is not re-entrant.  It must not be called from more
      * thank one task. */
+    return FreeRTOS_CLIProcessCommandSession( &xDefaultSession, pcCommandInput, pcWriteBuffer, xWriteBufferLen );
+}
+/*-----------------------------------------------------------*/
 
-    if( pxCommand == NULL )
+void FreeRTOS_CLISessionInit( CLI_Session_t * pxSession,
+                              pdCOMMAND_LINE_OUTPUT pxOutput,
+                              void * pvOutputContext,
+                              char * pcBuffer,
+                              size_t xBufferLen )
+{
+    configASSERT( pxSession != NULL );
+
+    memset( pxSession, 0x00, sizeof( *pxSession ) );
+    pxSession->pxOutput = pxOutput;
+    pxSession->pvOutputContext = pvOutputContext;
+    pxSession->pcBuffer = pcBuffer;
+    pxSession->xBufferLen = xBufferLen;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIProcessCommandSession( CLI_Session_t * pxSession,
+                                              const char * const pcCommandInput,
+                                              char * pcWriteBuffer,
+                                              size_t xWriteBufferLen )
+{
+    BaseType_t xReturn = pdTRUE;
+    const CLI_Command_Definition_t * pxDefinition;
+
+    configASSERT( pxSession != NULL );
+
+    pxSession->pcWriteBuffer = pcWriteBuffer;
+    pxSession->xWriteBufferLen = xWriteBufferLen;
+    pxSession->xWriteIndex = 0;
+
+    if( xWriteBufferLen > 0 )
     {
-        /* Search for the command string in the list of registered commands. */
-        for( pxCommand = &xRegisteredCommands; pxCommand != NULL; pxCommand = pxCommand->pxNext )
+        pcWriteBuffer[ 0 ] = 0x00;
+    }
+
+    if( pxSession->pxCommand == NULL )
+    {
+        /* Search for the command string in the table of registered commands. */
+        pxSession->pxCommand = prvFindCommand( pcCommandInput );
+        pxSession->pvCommandState = NULL;
+
+        if( pxSession->pxCommand != NULL )
         {
-            pcRegisteredCommandString = pxCommand->pxCommandLineDefinition->pcCommand;
-            xCommandStringLength = strlen( pcRegisteredCommandString );
-
-            /* To ensure the string lengths match exactly, so as not to pick up
-             * a sub-string of a longer command, check the byte after the expected
-             * end of the string is either the end of the string or a space before
-             * a parameter. */
-            if( strncmp( pcCommandInput, pcRegisteredCommandString, xCommandStringLength ) == 0 )
+            /* The command has been found.  Check it has the expected
+             * number of parameters.  If cExpectedNumberOfParameters is -1,
+             * then there could be a variable number of parameters and no
+             * check is made. */
+            if( pxSession->pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters >= 0 )
             {
-                if( ( pcCommandInput[ xCommandStringLength ] == ' ' ) || ( pcCommandInput[ xCommandStringLength ] == 0x00 ) )
+                if( prvGetNumberOfParameters( pcCommandInput ) != pxSession->pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters )
                 {
-                    /* The command has been found.  Check it has the expected
-                     * number of parameters.  If cExpectedNumberOfParameters is -1,
-                     * then there could be a variable number of parameters and no
-                     * check is made. */
-                    if( pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters >= 0 )
-                    {
-                        if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters )
-                        {
-                            xReturn = pdFALSE;
-                        }
-                    }
-
-                    break;
+                    xReturn = pdFALSE;
                 }
             }
         }
     }
 
-    if( ( pxCommand != NULL ) && ( xReturn == pdFALSE ) )
+    if( ( pxSession->pxCommand != NULL ) && ( xReturn == pdFALSE ) )
     {
         /* The command was found, but the number of parameters with the command
          * was incorrect. */
         strncpy( pcWriteBuffer, "Incorrect command parameter(s).  Enter \"help\" to view a list of available commands.\r\n\r\n", xWriteBufferLen );
-        pxCommand = NULL;
+        pxSession->pxCommand = NULL;
     }
-    else if( pxCommand != NULL )
+    else if( pxSession->pxCommand != NULL )
     {
         /* Call the callback function that is registered to this command. */
-        xReturn = pxCommand->pxCommandLineDefinition->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+        pxDefinition = pxSession->pxCommand->pxCommandLineDefinition;
+
+        if( pxDefinition->pxSessionInterpreter != NULL )
+        {
+            xReturn = pxDefinition->pxSessionInterpreter( pxSession, pcCommandInput );
+        }
+        else
+        {
+            xReturn = pxDefinition->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+        }
 
         /* If xReturn is pdFALSE, then no further strings will be returned
          * after this one, and	pxCommand can be reset to NULL ready to search
          * for the next entered command. */
         if( xReturn == pdFALSE )
         {
-            pxCommand = NULL;
+            pxSession->pxCommand = NULL;
         }
     }
     else
@@ -227,6 +302,93 @@ BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput,
 }
 /*-----------------------------------------------------------*/
 
+BaseType_t FreeRTOS_CLIExecuteCommand( CLI_Session_t * pxSession,
+                                       const char * const pcCommandInput )
+{
+    BaseType_t xMoreDataToFollow;
+
+    configASSERT( pxSession != NULL );
+    configASSERT( pxSession->pxOutput != NULL );
+    configASSERT( ( pxSession->pcBuffer != NULL ) && ( pxSession->xBufferLen > 0 ) );
+
+    pxSession->xOutputFailed = pdFALSE;
+
+    do
+    {
+        xMoreDataToFollow = FreeRTOS_CLIProcessCommandSession( pxSession, pcCommandInput, pxSession->pcBuffer, pxSession->xBufferLen );
+
+        /* The commands that fill the buffer themselves are not required to
+         * terminate it when it is full. */
+        pxSession->pcBuffer[ pxSession->xBufferLen - 1 ] = 0x00;
+        pxSession->xWriteIndex = strlen( pxSession->pcBuffer );
+        prvFlushOutput( pxSession );
+    } while( xMoreDataToFollow != pdFALSE );
+
+    return ( pxSession->xOutputFailed == pdFALSE ) ? pdPASS : pdFAIL;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIWrite( CLI_Session_t * pxSession,
+                              const char * pcData,
+                              size_t xDataLength )
+{
+    BaseType_t xReturn = pdPASS;
+    size_t xSpace, xCopyLength;
+
+    configASSERT( pxSession != NULL );
+    configASSERT( pxSession->pcWriteBuffer != NULL );
+
+    /* A buffer that only holds the terminating zero, or not even that, can
+     * never take any data however often it is flushed. */
+    if( pxSession->xWriteBufferLen < 2U )
+    {
+        xReturn = ( xDataLength == 0U ) ? pdPASS : pdFAIL;
+    }
+
+    while( ( xDataLength > 0U ) && ( xReturn == pdPASS ) )
+    {
+        /* Leave space for the terminating zero. */
+        xSpace = pxSession->xWriteBufferLen - pxSession->xWriteIndex - 1U;
+
+        if( xSpace > 0U )
+        {
+            xCopyLength = ( xDataLength < xSpace ) ? xDataLength : xSpace;
+            memcpy( &( pxSession->pcWriteBuffer[ pxSession->xWriteIndex ] ), pcData, xCopyLength );
+            pxSession->xWriteIndex += xCopyLength;
+            pxSession->pcWriteBuffer[ pxSession->xWriteIndex ] = 0x00;
+            pcData += xCopyLength;
+            xDataLength -= xCopyLength;
+        }
+        else if( pxSession->pxOutput != NULL )
+        {
+            prvFlushOutput( pxSession );
+        }
+        else
+        {
+            /* Nowhere to put the rest. */
+            xReturn = pdFAIL;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFlushOutput( CLI_Session_t * pxSession )
+{
+    if( ( pxSession->xWriteIndex > 0U ) && ( pxSession->xOutputFailed == pdFALSE ) )
+    {
+        if( pxSession->pxOutput( pxSession->pvOutputContext, pxSession->pcWriteBuffer, pxSession->xWriteIndex ) != pdPASS )
+        {
+            pxSession->xOutputFailed = pdTRUE;
+        }
+    }
+
+    pxSession->xWriteIndex = 0;
+    pxSession->pcWriteBuffer[ 0 ] = 0x00;
+}
+/*-----------------------------------------------------------*/
+
 char * FreeRTOS_CLIGetOutputBuffer( void )
 {
     return cOutputBuffer;
@@ -317,20 +479,31 @@ static void prvRegisterCommand( const CLI_Command_Definition_t * const pxCommand
 
         /* Set the end of list marker to the new list item. */
         pxLastCommandInList = pxCliDefinitionListItemBuffer;
+
+        if( xHelpCommandHashed == pdFALSE )
+        {
+            prvAddToHashTable( &xRegisteredCommands );
+            xHelpCommandHashed = pdTRUE;
+        }
+
+        prvAddToHashTable( pxCliDefinitionListItemBuffer );
     }
     taskEXIT_CRITICAL();
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvHelpCommand( char * pcWriteBuffer,
-                                  size_t xWriteBufferLen,
+static BaseType_t prvHelpCommand( CLI_Session_t * pxSession,
                                   const char * pcCommandString )
 {
-    static const CLI_Definition_List_Item_t * pxCommand = NULL;
+    const CLI_Definition_List_Item_t * pxCommand;
     BaseType_t xReturn;
 
     ( void ) pcCommandString;
 
+    /* The position in the list is kept in the session, so that help can be
+     * listed by several sessions at once. */
+    pxCommand = ( const CLI_Definition_List_Item_t * ) pxSession->pvCommandState;
+
     if( pxCommand == NULL )
     {
         /* Reset the pxCommand pointer back to the start of the list. */
@@ -339,8 +512,9 @@ static BaseType_t prvHelpCommand( char * pcWriteBuffer,
 
     /* Return the next command help string, before moving the pointer on to
      * the next command in the list. */
-    strncpy( pcWriteBuffer, pxCommand->pxCommandLineDefinition->pcHelpString, xWriteBufferLen );
+    ( void ) FreeRTOS_CLIWrite( pxSession, pxCommand->pxCommandLineDefinition->pcHelpString, strlen( pxCommand->pxCommandLineDefinition->pcHelpString ) );
     pxCommand = pxCommand->pxNext;
+    pxSession->pvCommandState = ( void * ) pxCommand;
 
     if( pxCommand == NULL )
     {
@@ -393,3 +567,85 @@ static int8_t prvGetNumberOfParameters( const char * pcCommandString )
     return cParameters;
 }
 /*-----------------------------------------------------------*/
+
+static UBaseType_t prvHashFirstWord( const char * pcCommandString )
+{
+    uint32_t ulHash = 2166136261UL;
+
+    /* FNV-1a over the characters up to the first space. */
+    while( ( *pcCommandString != 0x00 ) && ( *pcCommandString != ' ' ) )
+    {
+        ulHash ^= ( uint8_t ) *pcCommandString;
+        ulHash *= 16777619UL;
+        pcCommandString++;
+    }
+
+    return ( UBaseType_t ) ( ulHash % ( uint32_t ) configCOMMAND_INT_HASH_TABLE_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddToHashTable( CLI_Definition_List_Item_t * pxListItem )
+{
+    CLI_Definition_List_Item_t ** ppxEntry;
+
+    /* Append, so that commands that start with the same word are tried in the
+     * order in which they were registered, as they were in the list. */
+    ppxEntry = &( pxCommandHashTable[ prvHashFirstWord( pxListItem->pxCommandLineDefinition->pcCommand ) ] );
+
+    while( *ppxEntry != NULL )
+    {
+        ppxEntry = &( ( *ppxEntry )->pxNextInBucket );
+    }
+
+    pxListItem->pxNextInBucket = NULL;
+    *ppxEntry = pxListItem;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvMatchCommand( const CLI_Definition_List_Item_t * pxCommand,
+                                   const char * pcCommandInput )
+{
+    const char * pcRegisteredCommandString = pxCommand->pxCommandLineDefinition->pcCommand;
+    size_t xCommandStringLength = strlen( pcRegisteredCommandString );
+    BaseType_t xReturn = pdFALSE;
+
+    /* To ensure the string lengths match exactly, so as not to pick up
+     * a sub-string of a longer command, check the byte after the expected
+     * end of the string is either the end of the string or a space before
+     * a parameter. */
+    if( strncmp( pcCommandInput, pcRegisteredCommandString, xCommandStringLength ) == 0 )
+    {
+        if( ( pcCommandInput[ xCommandStringLength ] == ' ' ) || ( pcCommandInput[ xCommandStringLength ] == 0x00 ) )
+        {
+            xReturn = pdTRUE;
+        }
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static const CLI_Definition_List_Item_t * prvFindCommand( const char * pcCommandInput )
+{
+    const CLI_Definition_List_Item_t * pxCommand;
+
+    for( pxCommand = pxCommandHashTable[ prvHashFirstWord( pcCommandInput ) ]; pxCommand != NULL; pxCommand = pxCommand->pxNextInBucket )
+    {
+        if( prvMatchCommand( pxCommand, pcCommandInput ) != pdFALSE )
+        {
+            break;
+        }
+    }
+
+    if( ( pxCommand == NULL ) && ( xHelpCommandHashed == pdFALSE ) )
+    {
+        /* No command has been registered yet, only help is present. */
+        if( prvMatchCommand( &xRegisteredCommands, pcCommandInput ) != pdFALSE )
+        {
+            pxCommand = &xRegisteredCommands;
+        }
+    }
+
+    return pxCommand;
+}
+/*-----------------------------------------------------------*/
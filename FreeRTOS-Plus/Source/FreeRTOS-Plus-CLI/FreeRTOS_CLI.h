@@ -42,6 +42,22 @@ typedef BaseType_t (* pdCOMMAND_LINE_CALLBACK)( char * pcWriteBuffer,
                                                 size_t xWriteBufferLen,
                                                 const char * pcCommandString );
 
+struct xCLI_SESSION;
+
+/* The prototype of a command that keeps its state in the session that runs it,
+ * rather than in static variables, so that it can run in several sessions at
+ * once.  Output is written with FreeRTOS_CLIWrite().  Return pdTRUE to be
+ * called again for more output, or pdFALSE when the command is complete. */
+typedef BaseType_t (* pdCOMMAND_LINE_SESSION_CALLBACK)( struct xCLI_SESSION * pxSession,
+                                                        const char * pcCommandString );
+
+/* The prototype of a function that receives the output of a session, for
+ * example by writing it to a UART or a socket.  Returns pdPASS if the data was
+ * written. */
+typedef BaseType_t (* pdCOMMAND_LINE_OUTPUT)( void * pvOutputContext,
+                                              const char * pcData,
+                                              size_t xDataLength );
+
 /* The structure that defines command line commands.  A command line command
  * should be defined by declaring a const structure of this type. */
 typedef struct xCOMMAND_LINE_INPUT
@@ -50,6 +66,7 @@ typedef struct xCOMMAND_LINE_INPUT
     const char * const pcHelpString;                    /* String that describes how to use the command.  Should start with the command itself, and end with "\r\n".  For example "help: Returns a list of all the commands\r\n". */
     const pdCOMMAND_LINE_CALLBACK pxCommandInterpreter; /* A pointer to the callback function that will return the output generated by the command. */
     int8_t cExpectedNumberOfParameters;                 /* Commands expect a fixed number of parameters, which may be zero. */
+    const pdCOMMAND_LINE_SESSION_CALLBACK pxSessionInterpreter; /* Optional.  When not NULL it is called instead of pxCommandInterpreter, which may then be NULL. */
 } CLI_Command_Definition_t;
 
 /* The structure that defines a command line list entry. */
@@ -57,8 +74,27 @@ typedef struct xCOMMAND_INPUT_LIST
 {
     const CLI_Command_Definition_t * pxCommandLineDefinition;
     struct xCOMMAND_INPUT_LIST * pxNext;
+    struct xCOMMAND_INPUT_LIST * pxNextInBucket; /* The next command in the same entry of the hash table. */
 } CLI_Definition_List_Item_t;
 
+/* The state of one command console.  Each task that calls the command
+ * interpreter uses its own session, so that several consoles can process
+ * commands at the same time.  Initialise with FreeRTOS_CLISessionInit().  The
+ * members are private to FreeRTOS_CLI.c, except for pvCommandState. */
+typedef struct xCLI_SESSION
+{
+    const CLI_Definition_List_Item_t * pxCommand; /* The command that is producing output, or NULL. */
+    void * pvCommandState;                        /* Free for use by a session callback between its calls.  Set to NULL when a command starts. */
+    char * pcWriteBuffer;                         /* The buffer of the current call. */
+    size_t xWriteBufferLen;
+    size_t xWriteIndex;                           /* The number of bytes in pcWriteBuffer. */
+    pdCOMMAND_LINE_OUTPUT pxOutput;
+    void * pvOutputContext;
+    char * pcBuffer;                              /* The buffer used by FreeRTOS_CLIExecuteCommand(). */
+    size_t xBufferLen;
+    BaseType_t xOutputFailed;
+} CLI_Session_t;
+
 /* For backward compatibility. */
 #define xCommandLineInput    CLI_Command_Definition_t
 
@@ -90,12 +126,57 @@ typedef struct xCOMMAND_INPUT_LIST
  * FreeRTOS_CLIProcessCommand should be called repeatedly until it returns pdFALSE.
  *
  * pcCmdIntProcessCommand is not reentrant.  It must not be called from more
- * than one task - or at least - by more than one task at a time.
+ * than one task - or at least - by more than one task at a time.  Tasks that
+ * need their own console use FreeRTOS_CLIProcessCommandSession() instead.
  */
 BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput,
                                        char * pcWriteBuffer,
                                        size_t xWriteBufferLen );
 
+/*
+ * Initialise a session.  pxOutput, pvOutputContext, pcBuffer and xBufferLen
+ * are only needed by FreeRTOS_CLIExecuteCommand(), and may be NULL and 0 when
+ * the session is only used with FreeRTOS_CLIProcessCommandSession().  If
+ * pxOutput is given, a session callback that writes more than fits in the
+ * write buffer has it passed to pxOutput, rather than truncated.
+ */
+void FreeRTOS_CLISessionInit( CLI_Session_t * pxSession,
+                              pdCOMMAND_LINE_OUTPUT pxOutput,
+                              void * pvOutputContext,
+                              char * pcBuffer,
+                              size_t xBufferLen );
+
+/*
+ * The same as FreeRTOS_CLIProcessCommand(), but the state kept between the
+ * calls is stored in pxSession.  Different sessions may be used by different
+ * tasks at the same time.  Commands that use pdCOMMAND_LINE_CALLBACK keep their
+ * own state though, so those must not run in two sessions at once unless they
+ * are re-entrant themselves.
+ */
+BaseType_t FreeRTOS_CLIProcessCommandSession( CLI_Session_t * pxSession,
+                                              const char * const pcCommandInput,
+                                              char * pcWriteBuffer,
+                                              size_t xWriteBufferLen );
+
+/*
+ * Run the command string to completion, passing all of its output to the
+ * output function of the session.  Returns pdFAIL if the output function
+ * failed, in which case the command still runs to completion but the rest of
+ * its output is discarded.
+ */
+BaseType_t FreeRTOS_CLIExecuteCommand( CLI_Session_t * pxSession,
+                                       const char * const pcCommandInput );
+
+/*
+ * Called by a session callback to add output.  The data is appended to the
+ * write buffer.  When the buffer is full, it is passed to the output function
+ * of the session, if there is one, otherwise the data is truncated and pdFAIL
+ * is returned.
+ */
+BaseType_t FreeRTOS_CLIWrite( CLI_Session_t * pxSession,
+                              const char * pcData,
+                              size_t xDataLength );
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -103,9 +184,10 @@ BaseType_t FreeRTOS_CLIProcessCommand( const char * const pcCommandInput,
  * main command interpreter, rather than in the command console implementation,
  * to allow application that provide access to the command console via multiple
  * interfaces to share a buffer, and therefore save RAM.  Note, however, that
- * the command interpreter itself is not re-entrant, so only one command
+ * FreeRTOS_CLIProcessCommand() is not re-entrant, so only one command
  * console interface can be used at any one time.  For that reason, no attempt
  * is made to provide any mutual exclusion mechanism on the output buffer.
+ * Consoles that run concurrently each need a buffer of their own.
  *
  * FreeRTOS_CLIGetOutputBuffer() returns the address of the output buffer.
  */
@@ -31,7 +31,8 @@
 
 /*
  * Initialize a logging system that can be used from FreeRTOS tasks and Win32
- * threads.  Do not call printf() directly while the scheduler is running.
+ * or POSIX threads.  Do not call printf() directly while the scheduler is
+ * running.
  *
  * Set xLogToStdout, xLogToFile and xLogToUDP to either pdTRUE or pdFALSE to
  * lot to stdout, a disk file and a UDP port respectively.
@@ -0,0 +1,140 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file logging_binary.h
+ * @brief Logging macros that capture a message in binary form, to be formatted
+ * later by a low priority task or on the host.
+ *
+ * Selected by defining LOGGING_BINARY_BACKEND as 1 before logging_stack.h is
+ * included.  Each call site of LogError(), LogInfo() etc. then has a constant
+ * #LogBinaryRecord_t that holds the format string and the metadata.  At run
+ * time only the address of the record, a time stamp, the task name and the
+ * raw values of the arguments are copied to a ring buffer; nothing is
+ * formatted.  The implementation is in
+ * FreeRTOS-Plus/Demo/Common/Logging/binary/Logging_Binary.c.
+ *
+ * @note The format string must be a string literal.
+ */
+
+#ifndef LOGGING_BINARY_H
+#define LOGGING_BINARY_H
+
+/* Standard Include. */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Level of the messages of LogAlways(), which are never filtered.
+ */
+#define LOG_BINARY_LEVEL_ALWAYS    LOG_NONE
+
+/**
+ * @brief The constant part of a log message, one per call site.  Its address
+ * identifies the message.
+ */
+typedef struct LogBinaryRecord
+{
+    const char * pcFormat;   /**< @brief The printf() format of the message. */
+    const char * pcLibrary;  /**< @brief LIBRARY_LOG_NAME of the caller. */
+    const char * pcFunction; /**< @brief The function that logs the message. */
+    uint16_t usLine;         /**< @brief The line that logs the message. */
+    uint8_t ucLevel;         /**< @brief LOG_ERROR .. LOG_DEBUG, or LOG_BINARY_LEVEL_ALWAYS. */
+} LogBinaryRecord_t;
+
+/**
+ * @brief Receives the output of the drain task: formatted lines, or binary
+ * frames for the host decoder.
+ */
+typedef void (* LoggingBinaryOutput_t)( const void * pvData,
+                                        size_t xLength );
+
+/* Helpers to take the format string out of the parenthesised message. */
+#define logbinFORMAT( ... )              logbinFIRST_ARGUMENT( __VA_ARGS__, 0 )
+#define logbinFIRST_ARGUMENT( x, ... )    x
+#define logbinCAPTURE( ... )             vLoggingBinaryCapture( &xLogBinaryRecord, __VA_ARGS__ )
+
+/**
+ * @brief Log a message, given in the same form as to LogInfo(), at ucLevel.
+ */
+#define LogBinary( ucLevel, message )                     \
+    do                                                    \
+    {                                                     \
+        static const LogBinaryRecord_t xLogBinaryRecord = \
+        {                                                 \
+            logbinFORMAT message,                         \
+            LIBRARY_LOG_NAME,                             \
+            __FUNCTION__,                                 \
+            ( uint16_t ) __LINE__,                        \
+            ( uint8_t ) ( ucLevel )                       \
+        };                                                \
+        logbinCAPTURE message;                            \
+    } while( 0 )
+
+/**
+ * @brief Copy a message to the ring buffer of the current core.  Safe to call
+ * from any task or interrupt; it never blocks.  When the ring buffer is full,
+ * the message is dropped and counted.
+ *
+ * @param[in] pxRecord The record of the call site.
+ * @param[in] pcFormat The format string, equal to pxRecord->pcFormat.  It is
+ * parsed to find the types of the arguments.
+ */
+void vLoggingBinaryCapture( const LogBinaryRecord_t * pxRecord,
+                            const char * pcFormat,
+                            ... );
+
+/**
+ * @brief Start the task that empties the ring buffers.
+ *
+ * @param[in] xFormatOnTarget pdTRUE to pass formatted lines to pxOutput,
+ * pdFALSE to pass binary frames, which decode_binary_log.py turns into the
+ * same lines on the host.
+ * @param[in] pxOutput Where the output goes, e.g. a UART or a UDP socket.  It
+ * is only called from the drain task.
+ * @param[in] usStackSize Stack size of the drain task.
+ * @param[in] uxPriority Priority of the drain task, normally just above idle.
+ */
+BaseType_t xLoggingBinaryInit( BaseType_t xFormatOnTarget,
+                               LoggingBinaryOutput_t pxOutput,
+                               configSTACK_DEPTH_TYPE usStackSize,
+                               UBaseType_t uxPriority );
+
+/**
+ * @brief Empty the ring buffers once.  Called by the drain task; call it
+ * directly only when the drain task is not used.
+ */
+void vLoggingBinaryDrain( void );
+
+/**
+ * @brief Return the number of messages that were dropped because a ring
+ * buffer was full.
+ */
+uint32_t ulLoggingBinaryDropped( void );
+
+#endif /* ifndef LOGGING_BINARY_H */
@@ -78,6 +78,27 @@
     #define SdkLog( message )    vLoggingPrintf message
 #endif
 
+/**
+ * @brief Set to 1 to capture log messages in binary form, see logging_binary.h.
+ * The messages are then formatted later, by a low priority task or on the
+ * host, instead of by the task that logs them.
+ */
+#ifndef LOGGING_BINARY_BACKEND
+    #define LOGGING_BINARY_BACKEND    0
+#endif
+
+/**
+ * @brief Common macro behind all the logging interfaces: log one message at
+ * ucLevel, whose name is pcLevelName.
+ */
+#if ( LOGGING_BINARY_BACKEND == 1 )
+    #include "logging_binary.h"
+
+    #define SdkLogMessage( ucLevel, pcLevelName, message )    LogBinary( ucLevel, message )
+#else
+    #define SdkLogMessage( ucLevel, pcLevelName, message )    SdkLog( ( "[" pcLevelName "] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+#endif
+
 /**
  * Disable definition of logging interface macros when generating doxygen output,
  * to avoid conflict with documentation of macros at the end of the file.
@@ -93,32 +114,32 @@
 #else
     #if LIBRARY_LOG_LEVEL == LOG_DEBUG
         /* All log level messages will logged. */
-        #define LogAlways( message )    SdkLog( ( "[ALWAYS] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogError( message )     SdkLog( ( "[ERROR] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )      SdkLog( ( "[WARN] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )      SdkLog( ( "[INFO] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogDebug( message )     SdkLog( ( "[DEBUG] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogAlways( message )    SdkLogMessage( LOG_BINARY_LEVEL_ALWAYS, "ALWAYS", message )
+        #define LogError( message )     SdkLogMessage( LOG_ERROR, "ERROR", message )
+        #define LogWarn( message )      SdkLogMessage( LOG_WARN, "WARN", message )
+        #define LogInfo( message )      SdkLogMessage( LOG_INFO, "INFO", message )
+        #define LogDebug( message )     SdkLogMessage( LOG_DEBUG, "DEBUG", message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_INFO
         /* Only INFO, WARNING, ERROR, and ALWAYS messages will be logged. */
-        #define LogAlways( message )    SdkLog( ( "[ALWAYS] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogError( message )     SdkLog( ( "[ERROR] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )      SdkLog( ( "[WARN] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )      SdkLog( ( "[INFO] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogAlways( message )    SdkLogMessage( LOG_BINARY_LEVEL_ALWAYS, "ALWAYS", message )
+        #define LogError( message )     SdkLogMessage( LOG_ERROR, "ERROR", message )
+        #define LogWarn( message )      SdkLogMessage( LOG_WARN, "WARN", message )
+        #define LogInfo( message )      SdkLogMessage( LOG_INFO, "INFO", message )
         #define LogDebug( message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_WARN
         /* Only WARNING, ERROR, and ALWAYS messages will be logged. */
-        #define LogAlways( message )    SdkLog( ( "[ALWAYS] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogError( message )     SdkLog( ( "[ERROR] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )      SdkLog( ( "[WARN] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogAlways( message )    SdkLogMessage( LOG_BINARY_LEVEL_ALWAYS, "ALWAYS", message )
+        #define LogError( message )     SdkLogMessage( LOG_ERROR, "ERROR", message )
+        #define LogWarn( message )      SdkLogMessage( LOG_WARN, "WARN", message )
         #define LogInfo( message )
         #define LogDebug( message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_ERROR
         /* Only ERROR and ALWAYS messages will be logged. */
-        #define LogAlways( message )    SdkLog( ( "[ALWAYS] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogError( message )     SdkLog( ( "[ERROR] [%s] "LOG_METADATA_FORMAT, LIBRARY_LOG_NAME, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogAlways( message )    SdkLogMessage( LOG_BINARY_LEVEL_ALWAYS, "ALWAYS", message )
+        #define LogError( message )     SdkLogMessage( LOG_ERROR, "ERROR", message )
         #define LogWarn( message )
         #define LogInfo( message )
         #define LogDebug( message )
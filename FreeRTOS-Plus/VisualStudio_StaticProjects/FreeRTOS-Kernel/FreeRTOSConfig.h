@@ -62,6 +62,7 @@
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS    8
 #define configENABLE_BACKWARD_COMPATIBILITY        1
 #define configSUPPORT_STATIC_ALLOCATION            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES      2
 
 /* Hook function related definitions. */
 #define configUSE_TICK_HOOK                        0
@@ -72,11 +72,28 @@
 
 #define configMAX_PRIORITIES                       ( 7 )
 
-/* Run time stats gathering configuration options. */
-unsigned long ulGetRunTimeCounterValue( void ); /* Prototype of function that returns run time counter. */
-void vConfigureTimerForRunTimeStats( void );    /* Prototype of function that initialises the run time counter. */
+/* Run time stats gathering configuration options.  Set projRUN_TIME_COUNTER_64_BIT
+ * to 0 to use the kernel's default 32-bit counter, which counts microseconds and
+ * wraps after about 71 minutes, rather than a 64-bit count of nanoseconds. */
+#ifndef projRUN_TIME_COUNTER_64_BIT
+    #define projRUN_TIME_COUNTER_64_BIT           1
+#endif
+#if ( projRUN_TIME_COUNTER_64_BIT == 1 )
+    #define configRUN_TIME_COUNTER_TYPE           uint64_t
+#else
+    #define configRUN_TIME_COUNTER_TYPE           uint32_t
+#endif
+configRUN_TIME_COUNTER_TYPE ulGetRunTimeCounterValue( void ); /* Prototype of function that returns run time counter. */
+void vConfigureTimerForRunTimeStats( void );                  /* Prototype of function that initialises the run time counter. */
 #define configGENERATE_RUN_TIME_STATS             1
 
+/* Used in place of the port's own counter, which is 32-bit and has the
+ * resolution of times(). */
+#define portALT_GET_RUN_TIME_COUNTER_VALUE( ulCountValue )    ( ulCountValue ) = ulGetRunTimeCounterValue()
+
+/* The size of the buffer used by FreeRTOS+CLI, see run-time-stats-utils.c. */
+#define configCOMMAND_INT_MAX_OUTPUT_SIZE         512
+
 /* Co-routine related configuration options. */
 #define configUSE_CO_ROUTINES                     0
 #define configMAX_CO_ROUTINE_PRIORITIES           ( 2 )
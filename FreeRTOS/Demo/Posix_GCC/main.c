@@ -65,8 +65,12 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+/* FreeRTOS+CLI includes. */
+#include "FreeRTOS_CLI.h"
+
 /* Local includes. */
 #include "console.h"
+#include "run-time-stats-utils.h"
 
 #if ( projCOVERAGE_TEST != 1 )
     #include <trcRecorder.h>
@@ -90,6 +94,14 @@
 
 /* This demo uses heap_3.c (the libc provided malloc() and free()). */
 
+/* The longest command line read from stdin, and the size of the buffer that
+ * the command output is formatted into. */
+#define mainCLI_MAX_INPUT_LENGTH     64
+#define mainCLI_OUTPUT_LENGTH        configCOMMAND_INT_MAX_OUTPUT_SIZE
+
+/* How often stdin is polled for a command. */
+#define mainCLI_POLL_PERIOD_MS       100
+
 /*-----------------------------------------------------------*/
 extern void main_blinky( void );
 extern void main_full( void );
@@ -130,6 +142,17 @@ static void prvSaveTraceFile( void );
  */
 static void handle_sigint( int signal );
 
+/*
+ * Runs the commands typed on stdin, e.g. "task-stats".  Not created when
+ * TRACE_ON_ENTER is 1, as Enter then saves the trace.
+ */
+#if ( TRACE_ON_ENTER != 1 )
+    static void prvCLITask( void * pvParameters );
+    static BaseType_t prvCLIOutput( void * pvOutputContext,
+                                    const char * pcData,
+                                    size_t xDataLength );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* When configSUPPORT_STATIC_ALLOCATION is set to 1 the application writer can
@@ -310,9 +333,86 @@ void vApplicationDaemonTaskStartupHook( void )
      * execute    (sometimes called the timer task).  This is useful if the
      * application includes initialisation code that would benefit from executing
      * after the scheduler has been started. */
+
+    /* Measure the CPU use of the tasks, see run-time-stats-utils.c. */
+    vRunTimeStatsStart();
+
+    #if ( TRACE_ON_ENTER != 1 )
+    {
+        xTaskCreate( prvCLITask, "CLI", configMINIMAL_STACK_SIZE * 2, NULL, tskIDLE_PRIORITY + 1, NULL );
+    }
+    #endif
 }
 /*-----------------------------------------------------------*/
 
+#if ( TRACE_ON_ENTER != 1 )
+    static void prvCLITask( void * pvParameters )
+    {
+        static char cOutputBuffer[ mainCLI_OUTPUT_LENGTH ];
+        char cInput[ mainCLI_MAX_INPUT_LENGTH ];
+        size_t xInputLength = 0;
+        CLI_Session_t xSession;
+        struct timeval tv;
+        fd_set fds;
+        char cChar;
+
+        ( void ) pvParameters;
+
+        FreeRTOS_CLISessionInit( &xSession, prvCLIOutput, NULL, cOutputBuffer, sizeof( cOutputBuffer ) );
+
+        for( ; ; )
+        {
+            /* Poll, as blocking in read() would stop the scheduler running
+             * other tasks. */
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+            FD_ZERO( &fds );
+            FD_SET( STDIN_FILENO, &fds );
+
+            if( select( STDIN_FILENO + 1, &fds, NULL, NULL, &tv ) <= 0 )
+            {
+                vTaskDelay( pdMS_TO_TICKS( mainCLI_POLL_PERIOD_MS ) );
+                continue;
+            }
+
+            if( read( STDIN_FILENO, &cChar, 1 ) != 1 )
+            {
+                /* End of input, e.g. when run from a script. */
+                break;
+            }
+
+            if( ( cChar == '\n' ) || ( cChar == '\r' ) )
+            {
+                if( xInputLength > 0U )
+                {
+                    cInput[ xInputLength ] = 0x00;
+                    ( void ) FreeRTOS_CLIExecuteCommand( &xSession, cInput );
+                    xInputLength = 0;
+                }
+            }
+            else if( xInputLength < ( sizeof( cInput ) - 1U ) )
+            {
+                cInput[ xInputLength++ ] = cChar;
+            }
+        }
+
+        vTaskDelete( NULL );
+    }
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvCLIOutput( void * pvOutputContext,
+                                    const char * pcData,
+                                    size_t xDataLength )
+    {
+        ( void ) pvOutputContext;
+
+        console_print( "%.*s", ( int ) xDataLength, pcData );
+
+        return pdPASS;
+    }
+#endif /* if ( TRACE_ON_ENTER != 1 ) */
+/*-----------------------------------------------------------*/
+
 void vAssertCalled( const char * const pcFileName,
                     unsigned long ulLine )
 {
@@ -32,17 +32,144 @@
  * real time, therefore the run time counter values have no real meaningful
  * units.
  *
- * Also note that it is assumed this demo is going to be used for short periods
- * of time only, and therefore timer overflows are not handled.
+ * When projRUN_TIME_COUNTER_64_BIT is 1 the run time counter counts
+ * nanoseconds in 64 bits, which does not wrap for centuries, so soak tests can
+ * run for as long as needed.  When it is 0 the counter counts microseconds in
+ * the kernel's default 32 bits, and wraps after about 71 minutes.  The windows
+ * below are measured with wrap safe arithmetic in either case.
+ *
+ * On top of the counters kept by the kernel, a software timer measures the CPU
+ * use of each task over windows of statsWINDOW_MS, and keeps the last
+ * statsWINDOW_COUNT windows of each task for its histogram.  The statistics are
+ * read with vRunTimeStatsGetSnapshot(), formatted with
+ * xRunTimeStatsFormatJSON(), or printed by the "task-stats" CLI command.
  */
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 #include <time.h>
 
 /* FreeRTOS includes. */
 #include <FreeRTOS.h>
+#include "task.h"
+#include "timers.h"
+
+/* FreeRTOS+CLI includes. */
+#include "FreeRTOS_CLI.h"
+
+#include "run-time-stats-utils.h"
+
+#if ( projRUN_TIME_COUNTER_64_BIT == 1 )
+    #define statsCOUNTER_BITS       64U
+    #define statsCOUNTER_UNIT       "ns"
+    #define statsCOUNTER_DIVISOR    1ULL
+#else
+    #define statsCOUNTER_BITS       32U
+    #define statsCOUNTER_UNIT       "us"
+    #define statsCOUNTER_DIVISOR    1000ULL
+#endif
+
+/* The size of the buffer used to format one part of the JSON text. */
+#define statsJSON_PART_LENGTH       384U
+
+/* The state kept for a task between two windows. */
+typedef struct RunTimeStatsEntry
+{
+    BaseType_t xInUse;
+    BaseType_t xSeen;                                  /* Used while a window is measured. */
+    char cName[ configMAX_TASK_NAME_LEN ];
+    UBaseType_t uxTaskNumber;
+    UBaseType_t uxPriority;
+    eTaskState eState;
+    configRUN_TIME_COUNTER_TYPE ulLastRunTimeCounter;  /* The task's counter at the end of the last window. */
+    uint64_t ullRunTime;
+    uint16_t usWindows;
+    uint16_t usPermille[ statsWINDOW_COUNT ];          /* Indexed like uxNextWindow. */
+} RunTimeStatsEntry_t;
+
+/* The state of the "task-stats" command in a session. */
+typedef struct RunTimeStatsCommandState
+{
+    RunTimeStatsSnapshot_t xSnapshot;
+    UBaseType_t uxNextTask;
+} RunTimeStatsCommandState_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Measure one window, or when xRecordWindow is pdFALSE only take the counters
+ * from which the first window is measured.
+ */
+static void prvSample( BaseType_t xRecordWindow );
+
+/*
+ * The callback of the timer that ends each window.
+ */
+static void prvWindowTimerCallback( TimerHandle_t xTimer );
+
+/*
+ * Append formatted text to pcBuffer at *pxUsed, with snprintf() semantics:
+ * *pxUsed grows by the full length of the text even when it does not fit.
+ */
+static void prvPrint( char * pcBuffer,
+                      size_t xBufferLength,
+                      size_t * pxUsed,
+                      const char * pcFormat,
+                      ... );
+
+/*
+ * Append pcString as a quoted JSON string.
+ */
+static void prvPrintString( char * pcBuffer,
+                            size_t xBufferLength,
+                            size_t * pxUsed,
+                            const char * pcString );
+
+/*
+ * The three parts of the JSON text: the fields of the snapshot, one task, and
+ * the end.  The CLI command writes them one call at a time.
+ */
+static void prvFormatJSONHead( const RunTimeStatsSnapshot_t * pxSnapshot,
+                               char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed );
+static void prvFormatJSONTask( const RunTimeStatsSnapshot_t * pxSnapshot,
+                               UBaseType_t uxTask,
+                               char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed );
+static void prvFormatJSONTail( char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed );
+
+/*
+ * Implements the "task-stats" command.
+ */
+static BaseType_t prvTaskStatsCommand( CLI_Session_t * pxSession,
+                                       const char * pcCommandString );
+
+/*-----------------------------------------------------------*/
 
 /* Time at start of day (in ns). */
-static unsigned long ulStartTimeNs;
+static uint64_t ullStartTimeNs;
+
+static RunTimeStatsEntry_t xEntries[ statsMAX_TASKS ];
+static TaskStatus_t xTaskStatus[ statsMAX_TASKS ];
+static configRUN_TIME_COUNTER_TYPE ulLastTotalRunTimeCounter;
+static uint64_t ullTotalRunTime;
+static uint32_t ulWindows;
+static UBaseType_t uxNextWindow;
+static BaseType_t xTasksMissed;
+
+static const CLI_Command_Definition_t xTaskStatsCommand =
+{
+    "task-stats",
+    "\r\ntask-stats:\r\n Displays the CPU use of each task over the last windows, as JSON\r\n",
+    NULL,
+    0,
+    prvTaskStatsCommand
+};
 
 /*-----------------------------------------------------------*/
 
@@ -51,17 +178,479 @@ void vConfigureTimerForRunTimeStats( void )
     struct timespec xNow;
 
     clock_gettime( CLOCK_MONOTONIC, &xNow );
-    ulStartTimeNs = xNow.tv_sec * 1000000000ul + xNow.tv_nsec;
+    ullStartTimeNs = ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec;
 }
 /*-----------------------------------------------------------*/
 
-unsigned long ulGetRunTimeCounterValue( void )
+configRUN_TIME_COUNTER_TYPE ulGetRunTimeCounterValue( void )
 {
     struct timespec xNow;
 
-    /* Time at start. */
+    /* The POSIX port does not call portCONFIGURE_TIMER_FOR_RUN_TIME_STATS(),
+     * so start the counter on first use. */
+    if( ullStartTimeNs == 0ULL )
+    {
+        vConfigureTimerForRunTimeStats();
+    }
+
     clock_gettime( CLOCK_MONOTONIC, &xNow );
 
-    return xNow.tv_sec * 1000000000ul + xNow.tv_nsec - ulStartTimeNs;
+    /* In 32 bit mode the result is truncated, which the kernel and prvSample()
+     * handle as a wrap. */
+    return ( configRUN_TIME_COUNTER_TYPE ) ( ( ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec - ullStartTimeNs ) / statsCOUNTER_DIVISOR );
+}
+/*-----------------------------------------------------------*/
+
+void vRunTimeStatsStart( void )
+{
+    static StaticTimer_t xWindowTimerBuffer;
+    TimerHandle_t xWindowTimer;
+
+    prvSample( pdFALSE );
+
+    xWindowTimer = xTimerCreateStatic( "Stats",
+                                       pdMS_TO_TICKS( statsWINDOW_MS ),
+                                       pdTRUE,
+                                       NULL,
+                                       prvWindowTimerCallback,
+                                       &xWindowTimerBuffer );
+    configASSERT( xWindowTimer );
+    xTimerStart( xWindowTimer, portMAX_DELAY );
+
+    FreeRTOS_CLIRegisterCommand( &xTaskStatsCommand );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWindowTimerCallback( TimerHandle_t xTimer )
+{
+    ( void ) xTimer;
+
+    prvSample( pdTRUE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSample( BaseType_t xRecordWindow )
+{
+    configRUN_TIME_COUNTER_TYPE ulTotalRunTimeCounter, ulElapsed, ulTaskElapsed;
+    UBaseType_t uxTaskCount, uxTask, uxEntry;
+    RunTimeStatsEntry_t * pxEntry;
+    uint64_t ullPermille;
+
+    /* Only the timer task writes xTaskStatus. */
+    uxTaskCount = uxTaskGetSystemState( xTaskStatus, statsMAX_TASKS, &ulTotalRunTimeCounter );
+
+    if( uxTaskCount == 0U )
+    {
+        /* There are more tasks than fit in xTaskStatus.  Keep the previous
+         * counters, so the next window that fits covers the time in between. */
+        xTasksMissed = pdTRUE;
+        return;
+    }
+
+    /* Stop vRunTimeStatsGetSnapshot() seeing a half updated window. */
+    vTaskSuspendAll();
+    {
+        /* Unsigned subtraction gives the right result across a wrap of the
+         * 32 bit counter, as long as a window is shorter than the wrap. */
+        ulElapsed = ulTotalRunTimeCounter - ulLastTotalRunTimeCounter;
+        ulLastTotalRunTimeCounter = ulTotalRunTimeCounter;
+
+        for( uxEntry = 0; uxEntry < statsMAX_TASKS; uxEntry++ )
+        {
+            xEntries[ uxEntry ].xSeen = pdFALSE;
+        }
+
+        for( uxTask = 0; uxTask < uxTaskCount; uxTask++ )
+        {
+            pxEntry = NULL;
+
+            /* Task numbers are unique, unlike handles which are reused once a
+             * deleted task is freed. */
+            for( uxEntry = 0; uxEntry < statsMAX_TASKS; uxEntry++ )
+            {
+                if( ( xEntries[ uxEntry ].xInUse != pdFALSE ) &&
+                    ( xEntries[ uxEntry ].uxTaskNumber == xTaskStatus[ uxTask ].xTaskNumber ) )
+                {
+                    pxEntry = &( xEntries[ uxEntry ] );
+                    break;
+                }
+            }
+
+            if( pxEntry == NULL )
+            {
+                for( uxEntry = 0; uxEntry < statsMAX_TASKS; uxEntry++ )
+                {
+                    if( xEntries[ uxEntry ].xInUse == pdFALSE )
+                    {
+                        pxEntry = &( xEntries[ uxEntry ] );
+                        memset( pxEntry, 0x00, sizeof( *pxEntry ) );
+                        pxEntry->xInUse = pdTRUE;
+                        pxEntry->uxTaskNumber = xTaskStatus[ uxTask ].xTaskNumber;
+
+                        /* A task that exists before the first window only
+                         * counts from there.  One created later ran for no
+                         * longer than the window it was created in. */
+                        if( xRecordWindow == pdFALSE )
+                        {
+                            pxEntry->ulLastRunTimeCounter = xTaskStatus[ uxTask ].ulRunTimeCounter;
+                        }
+
+                        break;
+                    }
+                }
+            }
+
+            if( pxEntry == NULL )
+            {
+                /* Only possible while entries of deleted tasks are still held. */
+                xTasksMissed = pdTRUE;
+                continue;
+            }
+
+            pxEntry->xSeen = pdTRUE;
+            strncpy( pxEntry->cName, xTaskStatus[ uxTask ].pcTaskName, sizeof( pxEntry->cName ) - 1U );
+            pxEntry->uxPriority = xTaskStatus[ uxTask ].uxCurrentPriority;
+            pxEntry->eState = xTaskStatus[ uxTask ].eCurrentState;
+
+            ulTaskElapsed = xTaskStatus[ uxTask ].ulRunTimeCounter - pxEntry->ulLastRunTimeCounter;
+            pxEntry->ulLastRunTimeCounter = xTaskStatus[ uxTask ].ulRunTimeCounter;
+
+            if( xRecordWindow != pdFALSE )
+            {
+                pxEntry->ullRunTime += ulTaskElapsed;
+
+                if( ulElapsed != 0U )
+                {
+                    ullPermille = ( ( uint64_t ) ulTaskElapsed * 1000ULL ) / ( uint64_t ) ulElapsed;
+                }
+                else
+                {
+                    ullPermille = 0ULL;
+                }
+
+                /* The task and total counters are not read at exactly the same
+                 * time. */
+                if( ullPermille > 1000ULL )
+                {
+                    ullPermille = 1000ULL;
+                }
+
+                pxEntry->usPermille[ uxNextWindow ] = ( uint16_t ) ullPermille;
+
+                if( pxEntry->usWindows < statsWINDOW_COUNT )
+                {
+                    pxEntry->usWindows++;
+                }
+            }
+        }
+
+        /* Free the entries of the tasks that were deleted. */
+        for( uxEntry = 0; uxEntry < statsMAX_TASKS; uxEntry++ )
+        {
+            if( xEntries[ uxEntry ].xSeen == pdFALSE )
+            {
+                xEntries[ uxEntry ].xInUse = pdFALSE;
+            }
+        }
+
+        if( xRecordWindow != pdFALSE )
+        {
+            ullTotalRunTime += ulElapsed;
+            ulWindows++;
+            uxNextWindow = ( uxNextWindow + 1U ) % statsWINDOW_COUNT;
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void vRunTimeStatsGetSnapshot( RunTimeStatsSnapshot_t * pxSnapshot )
+{
+    const RunTimeStatsEntry_t * pxEntry;
+    RunTimeStatsTask_t * pxTask;
+    UBaseType_t uxEntry, uxWindow, uxIndex, uxBucket;
+    uint32_t ulSum;
+    uint16_t usPermille;
+
+    memset( pxSnapshot, 0x00, sizeof( *pxSnapshot ) );
+
+    vTaskSuspendAll();
+    {
+        pxSnapshot->ullTotalRunTime = ullTotalRunTime;
+        pxSnapshot->ulWindows = ulWindows;
+        pxSnapshot->xTasksMissed = xTasksMissed;
+
+        for( uxEntry = 0; uxEntry < statsMAX_TASKS; uxEntry++ )
+        {
+            pxEntry = &( xEntries[ uxEntry ] );
+
+            if( pxEntry->xInUse == pdFALSE )
+            {
+                continue;
+            }
+
+            pxTask = &( pxSnapshot->xTasks[ pxSnapshot->uxTaskCount ] );
+            pxSnapshot->uxTaskCount++;
+
+            memcpy( pxTask->cName, pxEntry->cName, sizeof( pxTask->cName ) );
+            pxTask->uxTaskNumber = pxEntry->uxTaskNumber;
+            pxTask->uxPriority = pxEntry->uxPriority;
+            pxTask->eState = pxEntry->eState;
+            pxTask->ullRunTime = pxEntry->ullRunTime;
+            pxTask->usWindows = pxEntry->usWindows;
+            ulSum = 0U;
+
+            /* The windows of a task are the usWindows most recent ones. */
+            for( uxWindow = 0; uxWindow < pxEntry->usWindows; uxWindow++ )
+            {
+                uxIndex = ( uxNextWindow + statsWINDOW_COUNT - 1U - uxWindow ) % statsWINDOW_COUNT;
+                usPermille = pxEntry->usPermille[ uxIndex ];
+
+                if( uxWindow == 0U )
+                {
+                    pxTask->usLastPermille = usPermille;
+                }
+
+                if( usPermille > pxTask->usPeakPermille )
+                {
+                    pxTask->usPeakPermille = usPermille;
+                }
+
+                uxBucket = ( ( UBaseType_t ) usPermille * statsHISTOGRAM_BUCKETS ) / 1000U;
+
+                if( uxBucket >= statsHISTOGRAM_BUCKETS )
+                {
+                    /* 100 % goes in the last bucket. */
+                    uxBucket = statsHISTOGRAM_BUCKETS - 1U;
+                }
+
+                pxTask->usHistogram[ uxBucket ]++;
+                ulSum += usPermille;
+            }
+
+            if( pxEntry->usWindows != 0U )
+            {
+                pxTask->usAveragePermille = ( uint16_t ) ( ulSum / pxEntry->usWindows );
+            }
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t xRunTimeStatsFormatJSON( const RunTimeStatsSnapshot_t * pxSnapshot,
+                                char * pcBuffer,
+                                size_t xBufferLength )
+{
+    size_t xUsed = 0;
+    UBaseType_t uxTask;
+
+    if( xBufferLength > 0U )
+    {
+        pcBuffer[ 0 ] = 0x00;
+    }
+
+    prvFormatJSONHead( pxSnapshot, pcBuffer, xBufferLength, &xUsed );
+
+    for( uxTask = 0; uxTask < pxSnapshot->uxTaskCount; uxTask++ )
+    {
+        prvFormatJSONTask( pxSnapshot, uxTask, pcBuffer, xBufferLength, &xUsed );
+    }
+
+    prvFormatJSONTail( pcBuffer, xBufferLength, &xUsed );
+
+    return xUsed;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrint( char * pcBuffer,
+                      size_t xBufferLength,
+                      size_t * pxUsed,
+                      const char * pcFormat,
+                      ... )
+{
+    va_list xArgs;
+    int iLength;
+
+    va_start( xArgs, pcFormat );
+
+    if( *pxUsed < xBufferLength )
+    {
+        iLength = vsnprintf( &( pcBuffer[ *pxUsed ] ), xBufferLength - *pxUsed, pcFormat, xArgs );
+    }
+    else
+    {
+        /* Only measure the text. */
+        iLength = vsnprintf( NULL, 0, pcFormat, xArgs );
+    }
+
+    va_end( xArgs );
+
+    if( iLength > 0 )
+    {
+        *pxUsed += ( size_t ) iLength;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintString( char * pcBuffer,
+                            size_t xBufferLength,
+                            size_t * pxUsed,
+                            const char * pcString )
+{
+    unsigned char ucChar;
+
+    prvPrint( pcBuffer, xBufferLength, pxUsed, "\"" );
+
+    while( *pcString != 0x00 )
+    {
+        ucChar = ( unsigned char ) *pcString;
+
+        if( ( ucChar == '"' ) || ( ucChar == '\\' ) )
+        {
+            prvPrint( pcBuffer, xBufferLength, pxUsed, "\\%c", ucChar );
+        }
+        else if( ucChar < 0x20U )
+        {
+            prvPrint( pcBuffer, xBufferLength, pxUsed, "\\u%04x", ( unsigned ) ucChar );
+        }
+        else
+        {
+            prvPrint( pcBuffer, xBufferLength, pxUsed, "%c", ucChar );
+        }
+
+        pcString++;
+    }
+
+    prvPrint( pcBuffer, xBufferLength, pxUsed, "\"" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFormatJSONHead( const RunTimeStatsSnapshot_t * pxSnapshot,
+                               char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed )
+{
+    prvPrint( pcBuffer, xBufferLength, pxUsed,
+              "{\"counter_bits\":%u,\"counter_unit\":\"%s\",\"total_run_time\":%llu,"
+              "\"window_ms\":%u,\"window_count\":%u,\"windows\":%lu,\"buckets\":%u,"
+              "\"tasks_missed\":%s,\"tasks\":[",
+              statsCOUNTER_BITS,
+              statsCOUNTER_UNIT,
+              ( unsigned long long ) pxSnapshot->ullTotalRunTime,
+              ( unsigned ) statsWINDOW_MS,
+              ( unsigned ) statsWINDOW_COUNT,
+              ( unsigned long ) pxSnapshot->ulWindows,
+              ( unsigned ) statsHISTOGRAM_BUCKETS,
+              ( pxSnapshot->xTasksMissed != pdFALSE ) ? "true" : "false" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFormatJSONTask( const RunTimeStatsSnapshot_t * pxSnapshot,
+                               UBaseType_t uxTask,
+                               char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed )
+{
+    static const char * const pcStates[] = { "running", "ready", "blocked", "suspended", "deleted", "invalid" };
+    const RunTimeStatsTask_t * pxTask = &( pxSnapshot->xTasks[ uxTask ] );
+    UBaseType_t uxBucket, uxState;
+    unsigned uPermille = 0U;
+
+    if( pxSnapshot->ullTotalRunTime != 0ULL )
+    {
+        uPermille = ( unsigned ) ( ( pxTask->ullRunTime * 1000ULL ) / pxSnapshot->ullTotalRunTime );
+    }
+
+    uxState = ( UBaseType_t ) pxTask->eState;
+
+    if( uxState >= ( sizeof( pcStates ) / sizeof( pcStates[ 0 ] ) ) )
+    {
+        uxState = ( sizeof( pcStates ) / sizeof( pcStates[ 0 ] ) ) - 1U;
+    }
+
+    prvPrint( pcBuffer, xBufferLength, pxUsed, "%s{\"name\":", ( uxTask == 0U ) ? "" : "," );
+    prvPrintString( pcBuffer, xBufferLength, pxUsed, pxTask->cName );
+    prvPrint( pcBuffer, xBufferLength, pxUsed,
+              ",\"number\":%lu,\"priority\":%lu,\"state\":\"%s\",\"run_time\":%llu,"
+              "\"cpu_permille\":%u,\"last_permille\":%u,\"average_permille\":%u,"
+              "\"peak_permille\":%u,\"windows\":%u,\"histogram\":[",
+              ( unsigned long ) pxTask->uxTaskNumber,
+              ( unsigned long ) pxTask->uxPriority,
+              pcStates[ uxState ],
+              ( unsigned long long ) pxTask->ullRunTime,
+              uPermille,
+              ( unsigned ) pxTask->usLastPermille,
+              ( unsigned ) pxTask->usAveragePermille,
+              ( unsigned ) pxTask->usPeakPermille,
+              ( unsigned ) pxTask->usWindows );
+
+    for( uxBucket = 0; uxBucket < statsHISTOGRAM_BUCKETS; uxBucket++ )
+    {
+        prvPrint( pcBuffer, xBufferLength, pxUsed, "%s%u", ( uxBucket == 0U ) ? "" : ",", ( unsigned ) pxTask->usHistogram[ uxBucket ] );
+    }
+
+    prvPrint( pcBuffer, xBufferLength, pxUsed, "]}" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFormatJSONTail( char * pcBuffer,
+                               size_t xBufferLength,
+                               size_t * pxUsed )
+{
+    prvPrint( pcBuffer, xBufferLength, pxUsed, "]}" );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTaskStatsCommand( CLI_Session_t * pxSession,
+                                       const char * pcCommandString )
+{
+    RunTimeStatsCommandState_t * pxState = ( RunTimeStatsCommandState_t * ) pxSession->pvCommandState;
+    char cPart[ statsJSON_PART_LENGTH ];
+    size_t xUsed = 0;
+    BaseType_t xReturn = pdTRUE;
+
+    ( void ) pcCommandString;
+
+    if( pxState == NULL )
+    {
+        /* The snapshot is too large for the stack of a console task, and is
+         * kept in the session so several consoles can run the command. */
+        pxState = ( RunTimeStatsCommandState_t * ) pvPortMalloc( sizeof( *pxState ) );
+
+        if( pxState == NULL )
+        {
+            ( void ) FreeRTOS_CLIWrite( pxSession, "Out of memory.\r\n", strlen( "Out of memory.\r\n" ) );
+            return pdFALSE;
+        }
+
+        vRunTimeStatsGetSnapshot( &( pxState->xSnapshot ) );
+        pxState->uxNextTask = 0;
+        pxSession->pvCommandState = pxState;
+        prvFormatJSONHead( &( pxState->xSnapshot ), cPart, sizeof( cPart ), &xUsed );
+    }
+    else if( pxState->uxNextTask < pxState->xSnapshot.uxTaskCount )
+    {
+        prvFormatJSONTask( &( pxState->xSnapshot ), pxState->uxNextTask, cPart, sizeof( cPart ), &xUsed );
+        pxState->uxNextTask++;
+    }
+    else
+    {
+        prvFormatJSONTail( cPart, sizeof( cPart ), &xUsed );
+        prvPrint( cPart, sizeof( cPart ), &xUsed, "\r\n" );
+        vPortFree( pxState );
+        pxSession->pvCommandState = NULL;
+        xReturn = pdFALSE;
+    }
+
+    if( xUsed >= sizeof( cPart ) )
+    {
+        /* Cannot happen with the task names and numbers printed. */
+        xUsed = sizeof( cPart ) - 1U;
+    }
+
+    ( void ) FreeRTOS_CLIWrite( pxSession, cPart, xUsed );
+
+    return xReturn;
 }
 /*-----------------------------------------------------------*/
@@ -0,0 +1,106 @@
+/*
+ * FreeRTOS V202212.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+
+/*
+ * Run time statistics for the POSIX port, see run-time-stats-utils.c.
+ */
+
+#ifndef RUN_TIME_STATS_UTILS_H
+#define RUN_TIME_STATS_UTILS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* The length of a window over which the CPU use of each task is measured. */
+#ifndef statsWINDOW_MS
+    #define statsWINDOW_MS           1000U
+#endif
+
+/* The number of most recent windows that make up the histograms. */
+#ifndef statsWINDOW_COUNT
+    #define statsWINDOW_COUNT        60U
+#endif
+
+/* The number of buckets of a histogram, each covering an equal part of 0 to
+ * 100 % CPU use. */
+#ifndef statsHISTOGRAM_BUCKETS
+    #define statsHISTOGRAM_BUCKETS    10U
+#endif
+
+/* The maximum number of tasks that are tracked. */
+#ifndef statsMAX_TASKS
+    #define statsMAX_TASKS           64U
+#endif
+
+/* The statistics of one task.  CPU use is given in tenths of a percent. */
+typedef struct RunTimeStatsTask
+{
+    char cName[ configMAX_TASK_NAME_LEN ];
+    UBaseType_t uxTaskNumber;
+    UBaseType_t uxPriority;
+    eTaskState eState;
+    uint64_t ullRunTime;                               /* Time in the Running state since the task was first seen, never wraps. */
+    uint16_t usLastPermille;                           /* CPU use in the most recent window. */
+    uint16_t usAveragePermille;                        /* Average CPU use over usWindows windows. */
+    uint16_t usPeakPermille;                           /* Highest CPU use in any of those windows. */
+    uint16_t usWindows;                                /* Windows in the histogram, up to statsWINDOW_COUNT. */
+    uint16_t usHistogram[ statsHISTOGRAM_BUCKETS ];    /* The number of windows per range of CPU use. */
+} RunTimeStatsTask_t;
+
+typedef struct RunTimeStatsSnapshot
+{
+    uint64_t ullTotalRunTime;  /* Run time counter since the first window, never wraps. */
+    uint32_t ulWindows;        /* The number of windows measured so far. */
+    BaseType_t xTasksMissed;   /* pdTRUE if there were more than statsMAX_TASKS tasks. */
+    UBaseType_t uxTaskCount;
+    RunTimeStatsTask_t xTasks[ statsMAX_TASKS ];
+} RunTimeStatsSnapshot_t;
+
+/*
+ * Start measuring the windows, and register the "task-stats" command with
+ * FreeRTOS+CLI.  Call once, after the scheduler has started.
+ */
+void vRunTimeStatsStart( void );
+
+/*
+ * Copy the current statistics to pxSnapshot.
+ */
+void vRunTimeStatsGetSnapshot( RunTimeStatsSnapshot_t * pxSnapshot );
+
+/*
+ * Write a snapshot as JSON to pcBuffer, which is always terminated.  Returns
+ * the length of the complete JSON text, which is more than xBufferLength - 1
+ * if it did not fit.
+ */
+size_t xRunTimeStatsFormatJSON( const RunTimeStatsSnapshot_t * pxSnapshot,
+                                char * pcBuffer,
+                                size_t xBufferLength );
+
+#endif /* RUN_TIME_STATS_UTILS_H */